@@ -0,0 +1,59 @@
+/**
+ * @file
+ * @brief CRC-8 throughput for each software CRUMBS_CRC_BACKEND.
+ *
+ * Built once per back end (see CRUMBS_BUILD_BENCHMARKS in CMakeLists.txt).
+ * Times crumbs_crc8() over a minimum (4-byte) and a maximum (31-byte)
+ * CRUMBS frame, the two sizes that bound encode/decode cost.
+ *
+ * Host timings are only meaningful relative to each other.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "crumbs.h"
+
+#ifndef BENCH_ITERATIONS
+#define BENCH_ITERATIONS 2000000u
+#endif
+
+static volatile uint32_t g_sink;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static double time_crc(uint8_t *buf, size_t len)
+{
+    uint64_t t0 = now_ns();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        buf[0] = (uint8_t)i; /* defeat hoisting out of the loop */
+        g_sink += crumbs_crc8(buf, len);
+    }
+    return (double)(now_ns() - t0) / BENCH_ITERATIONS;
+}
+
+int main(void)
+{
+    static const char *const backend_names[] = {"nibble", "byte", "slice4", "slice8", "hw"};
+    uint8_t buf[CRUMBS_MESSAGE_MAX_SIZE];
+
+    for (size_t i = 0; i < sizeof(buf); i++)
+    {
+        buf[i] = (uint8_t)(i * 29u + 7u);
+    }
+
+    printf("backend=%s iterations=%u\n",
+           backend_names[CRUMBS_CRC_BACKEND], (unsigned)BENCH_ITERATIONS);
+    printf("  crc8  4 bytes: %8.2f ns\n", time_crc(buf, 4));
+    printf("  crc8 31 bytes: %8.2f ns\n", time_crc(buf, CRUMBS_MESSAGE_MAX_SIZE));
+    return 0;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file
+ * @brief Worst-case dispatch cost for each CRUMBS_DISPATCH strategy.
+ *
+ * Built once per strategy (see CRUMBS_BUILD_BENCHMARKS in CMakeLists.txt).
+ * The handler and reply tables are filled to CRUMBS_MAX_HANDLERS and the
+ * benchmark times crumbs_peripheral_handle_receive() and
+ * crumbs_peripheral_build_reply() for the opcode each strategy finds last,
+ * plus an unregistered opcode (full miss). Those are the paths that bound
+ * ISR time on a peripheral.
+ *
+ * Host timings are only meaningful relative to each other; absolute MCU
+ * numbers scale with clock speed and handler count.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "crumbs.h"
+
+#ifndef BENCH_ITERATIONS
+#define BENCH_ITERATIONS 200000u
+#endif
+
+static volatile uint32_t g_sink;
+
+static void bench_handler(crumbs_context_t *ctx, uint8_t opcode,
+                          const uint8_t *data, uint8_t data_len, void *user_data)
+{
+    (void)ctx;
+    (void)data;
+    (void)user_data;
+    g_sink += (uint32_t)opcode + data_len;
+}
+
+static void bench_reply(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)user_data;
+    reply->type_id = 0x01;
+    reply->opcode = ctx->requested_opcode;
+    reply->data_len = 0;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static double time_receive(crumbs_context_t *ctx, uint8_t opcode)
+{
+    crumbs_message_t msg;
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    memset(&msg, 0, sizeof(msg));
+    msg.type_id = 0x01;
+    msg.opcode = opcode;
+    size_t len = crumbs_encode_message(&msg, frame, sizeof(frame));
+
+    uint64_t t0 = now_ns();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        (void)crumbs_peripheral_handle_receive(ctx, frame, len);
+    }
+    return (double)(now_ns() - t0) / BENCH_ITERATIONS;
+}
+
+static double time_reply(crumbs_context_t *ctx, uint8_t opcode)
+{
+    uint8_t out[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t out_len = 0;
+    ctx->requested_opcode = opcode;
+
+    uint64_t t0 = now_ns();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        (void)crumbs_peripheral_build_reply(ctx, out, sizeof(out), &out_len);
+    }
+    return (double)(now_ns() - t0) / BENCH_ITERATIONS;
+}
+
+int main(void)
+{
+    static const char *const mode_names[] = {"linear", "sorted", "direct"};
+    static crumbs_context_t ctx;
+
+    crumbs_init(&ctx, CRUMBS_ROLE_PERIPHERAL, 0x08);
+
+    /* Register in descending order so a linear scan finds opcode 0x01 last
+       and a sorted table has to insert at the front every time. */
+    uint8_t last = 0;
+    for (int i = CRUMBS_MAX_HANDLERS; i >= 1; i--)
+    {
+        last = (uint8_t)i;
+        crumbs_register_handler(&ctx, last, bench_handler, NULL);
+        crumbs_register_reply_handler(&ctx, (uint8_t)(0x80 + i), bench_reply, NULL);
+    }
+
+    printf("mode=%s handlers=%d iterations=%u\n",
+           mode_names[CRUMBS_DISPATCH], CRUMBS_MAX_HANDLERS, (unsigned)BENCH_ITERATIONS);
+    printf("  handle_receive hit  (0x%02X): %8.1f ns\n", last, time_receive(&ctx, last));
+    printf("  handle_receive miss (0xF0): %8.1f ns\n", time_receive(&ctx, 0xF0));
+    printf("  build_reply    hit  (0x%02X): %8.1f ns\n",
+           (unsigned)(0x80 + last), time_reply(&ctx, (uint8_t)(0x80 + last)));
+    printf("  build_reply    miss (0xF0): %8.1f ns\n", time_reply(&ctx, 0xF0));
+    return 0;
+}
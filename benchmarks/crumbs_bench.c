@@ -0,0 +1,276 @@
+/**
+ * @file
+ * @brief Microbenchmark suite with JSON output (the crumbs_bench target).
+ *
+ * Times the hot paths of the library as configured by the build:
+ *   - crumbs_encode_message() and crumbs_decode_message() by payload length
+ *   - crumbs_crc8() by buffer length
+ *   - crumbs_peripheral_handle_receive() with 1, 8 and 16 handlers
+ *     registered, for the opcode the dispatch strategy finds last
+ *   - a full SET_REPLY receive followed by crumbs_peripheral_build_reply(),
+ *     the peripheral-side cost of one GET
+ *
+ * Results go to stdout (or the file given as the first argument) as one
+ * JSON object, so two runs can be compared with scripts/bench_compare.py.
+ * Host timings are only meaningful relative to each other.
+ *
+ * Usage: crumbs_bench [out.json] [iterations]
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "crumbs.h"
+#include "crumbs_version.h"
+
+#ifndef BENCH_ITERATIONS
+#define BENCH_ITERATIONS 200000u
+#endif
+
+#define BENCH_MAX_RESULTS 48u
+#define BENCH_REPLY_OPCODE 0x80u
+
+typedef struct
+{
+    const char *bench; /**< Benchmark group ("encode", "dispatch", ...). */
+    const char *param; /**< Name of the swept parameter. */
+    unsigned value;    /**< Parameter value. */
+    double ns;         /**< Mean time per operation. */
+} bench_result_t;
+
+static bench_result_t g_results[BENCH_MAX_RESULTS];
+static unsigned g_result_count;
+static uint32_t g_iterations = BENCH_ITERATIONS;
+static volatile uint32_t g_sink;
+
+/* ---- Helpers ------------------------------------------------------------ */
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static double elapsed_per_op(uint64_t t0)
+{
+    return (double)(now_ns() - t0) / g_iterations;
+}
+
+static void record(const char *bench, const char *param, unsigned value, double ns)
+{
+    if (g_result_count < BENCH_MAX_RESULTS)
+    {
+        bench_result_t *r = &g_results[g_result_count++];
+        r->bench = bench;
+        r->param = param;
+        r->value = value;
+        r->ns = ns;
+    }
+}
+
+static void fill_message(crumbs_message_t *msg, uint8_t opcode, uint8_t payload)
+{
+    memset(msg, 0, sizeof(*msg));
+    msg->type_id = 0x01;
+    msg->opcode = opcode;
+    msg->data_len = payload;
+    for (uint8_t i = 0; i < payload; i++)
+    {
+        msg->data[i] = (uint8_t)(i * 29u + 7u);
+    }
+}
+
+static void bench_handler(crumbs_context_t *ctx, uint8_t opcode,
+                          const uint8_t *data, uint8_t data_len, void *user_data)
+{
+    (void)ctx;
+    (void)data;
+    (void)user_data;
+    g_sink += (uint32_t)opcode + data_len;
+}
+
+static void bench_reply(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)user_data;
+    fill_message(reply, ctx->requested_opcode, 8u);
+}
+
+/* ---- Benchmarks --------------------------------------------------------- */
+
+static void bench_codec(void)
+{
+    static const uint8_t payloads[] = {0u, 8u, 16u, CRUMBS_MAX_PAYLOAD};
+    crumbs_message_t msg;
+    crumbs_message_t out;
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+
+    for (size_t p = 0; p < sizeof(payloads); p++)
+    {
+        fill_message(&msg, 0x01, payloads[p]);
+
+        uint64_t t0 = now_ns();
+        for (uint32_t i = 0; i < g_iterations; i++)
+        {
+            msg.data[0] = (uint8_t)i; /* defeat hoisting out of the loop */
+            g_sink += (uint32_t)crumbs_encode_message(&msg, frame, sizeof(frame));
+        }
+        record("encode", "payload", payloads[p], elapsed_per_op(t0));
+
+        size_t len = crumbs_encode_message(&msg, frame, sizeof(frame));
+        t0 = now_ns();
+        for (uint32_t i = 0; i < g_iterations; i++)
+        {
+            g_sink += (uint32_t)crumbs_decode_message(frame, len, &out, NULL);
+        }
+        record("decode", "payload", payloads[p], elapsed_per_op(t0));
+    }
+}
+
+static void bench_crc(void)
+{
+    static const uint8_t lengths[] = {4u, 8u, 16u, 24u, CRUMBS_MESSAGE_MAX_SIZE};
+    uint8_t buf[CRUMBS_MESSAGE_MAX_SIZE];
+
+    for (size_t i = 0; i < sizeof(buf); i++)
+    {
+        buf[i] = (uint8_t)(i * 29u + 7u);
+    }
+    for (size_t l = 0; l < sizeof(lengths); l++)
+    {
+        uint64_t t0 = now_ns();
+        for (uint32_t i = 0; i < g_iterations; i++)
+        {
+            buf[0] = (uint8_t)i;
+            g_sink += crumbs_crc8(buf, lengths[l]);
+        }
+        record("crc8", "bytes", lengths[l], elapsed_per_op(t0));
+    }
+}
+
+static void bench_dispatch(void)
+{
+    static const int counts[] = {1, 8, 16};
+    static crumbs_context_t ctx;
+    crumbs_message_t msg;
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+    {
+        if (counts[c] > CRUMBS_MAX_HANDLERS)
+        {
+            break;
+        }
+        crumbs_init(&ctx, CRUMBS_ROLE_PERIPHERAL, 0x08);
+
+        /* Descending order: a linear scan finds opcode 0x01 last. */
+        for (int i = counts[c]; i >= 1; i--)
+        {
+            crumbs_register_handler(&ctx, (uint8_t)i, bench_handler, NULL);
+        }
+        fill_message(&msg, 0x01, 2u);
+        size_t len = crumbs_encode_message(&msg, frame, sizeof(frame));
+
+        uint64_t t0 = now_ns();
+        for (uint32_t i = 0; i < g_iterations; i++)
+        {
+            (void)crumbs_peripheral_handle_receive(&ctx, frame, len);
+        }
+        record("dispatch", "handlers", (unsigned)counts[c], elapsed_per_op(t0));
+    }
+}
+
+static void bench_round_trip(void)
+{
+    static crumbs_context_t ctx;
+    crumbs_message_t msg;
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    uint8_t out[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t out_len = 0;
+
+    crumbs_init(&ctx, CRUMBS_ROLE_PERIPHERAL, 0x08);
+    crumbs_register_reply_handler(&ctx, BENCH_REPLY_OPCODE, bench_reply, NULL);
+
+    memset(&msg, 0, sizeof(msg));
+    msg.opcode = CRUMBS_CMD_SET_REPLY;
+    msg.data_len = 1u;
+    msg.data[0] = BENCH_REPLY_OPCODE;
+    size_t len = crumbs_encode_message(&msg, frame, sizeof(frame));
+
+    uint64_t t0 = now_ns();
+    for (uint32_t i = 0; i < g_iterations; i++)
+    {
+        (void)crumbs_peripheral_handle_receive(&ctx, frame, len);
+        (void)crumbs_peripheral_build_reply(&ctx, out, sizeof(out), &out_len);
+        g_sink += (uint32_t)out_len;
+    }
+    record("round_trip", "payload", 8u, elapsed_per_op(t0));
+}
+
+/* ---- Output ------------------------------------------------------------- */
+
+static void write_json(FILE *f)
+{
+    static const char *const backend_names[] = {"nibble", "byte", "slice4", "slice8", "hw"};
+    static const char *const mode_names[] = {"linear", "sorted", "direct"};
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"crumbs_version\": \"%s\",\n", CRUMBS_VERSION_STRING);
+    fprintf(f, "  \"iterations\": %lu,\n", (unsigned long)g_iterations);
+    fprintf(f, "  \"config\": {\n");
+    fprintf(f, "    \"crc_backend\": \"%s\",\n", backend_names[CRUMBS_CRC_BACKEND]);
+    fprintf(f, "    \"dispatch\": \"%s\",\n", mode_names[CRUMBS_DISPATCH]);
+    fprintf(f, "    \"max_handlers\": %d,\n", CRUMBS_MAX_HANDLERS);
+    fprintf(f, "    \"context_bytes\": %lu\n", (unsigned long)crumbs_context_size());
+    fprintf(f, "  },\n");
+    fprintf(f, "  \"results\": [\n");
+    for (unsigned i = 0; i < g_result_count; i++)
+    {
+        const bench_result_t *r = &g_results[i];
+        fprintf(f, "    {\"bench\": \"%s\", \"%s\": %u, \"ns\": %.2f, \"ops_per_sec\": %.0f}%s\n",
+                r->bench, r->param, r->value, r->ns, r->ns > 0.0 ? 1e9 / r->ns : 0.0,
+                (i + 1u < g_result_count) ? "," : "");
+    }
+    fprintf(f, "  ]\n");
+    fprintf(f, "}\n");
+}
+
+int main(int argc, char **argv)
+{
+    FILE *out = stdout;
+
+    if (argc >= 3)
+    {
+        unsigned long n = strtoul(argv[2], NULL, 0);
+        if (n > 0ul)
+        {
+            g_iterations = (uint32_t)n;
+        }
+    }
+    if (argc >= 2 && strcmp(argv[1], "-") != 0)
+    {
+        out = fopen(argv[1], "w");
+        if (!out)
+        {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+
+    bench_codec();
+    bench_crc();
+    bench_dispatch();
+    bench_round_trip();
+
+    write_json(out);
+    if (out != stdout)
+    {
+        fclose(out);
+    }
+    return 0;
+}
@@ -54,13 +54,9 @@ static size_t sensor_count_effective()
 
 static crumbs_device_t make_sensor_dev(uint8_t addr)
 {
-    crumbs_device_t dev = {
-        &g_ctx,
-        addr,
-        crumbs_arduino_wire_write,
-        crumbs_arduino_read,
-        crumbs_arduino_delay_us,
-        NULL};
+    crumbs_device_t dev;
+    crumbs_device_bind(&dev, &g_ctx, addr, crumbs_arduino_wire_write, crumbs_arduino_read,
+                       crumbs_arduino_delay_us, NULL);
     return dev;
 }
 
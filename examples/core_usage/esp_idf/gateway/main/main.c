@@ -0,0 +1,121 @@
+/**
+ * @file main.c
+ * @brief ESP-IDF gateway: scan the bus, then poll every CRUMBS peripheral
+ *        from the engine task without blocking app_main.
+ *
+ * The engine task runs on core 1; app_main only queues requests and prints
+ * what the completion callbacks hand back through a FreeRTOS queue.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "crumbs.h"
+#include "crumbs_engine.h"
+#include "crumbs_esp_idf.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#define GATEWAY_PORT I2C_NUM_0
+#define GATEWAY_SDA 21
+#define GATEWAY_SCL 22
+#define GATEWAY_SCL_HZ 100000u
+#define GATEWAY_OPCODE CRUMBS_CMD_CAPABILITIES
+#define GATEWAY_PERIOD_MS 1000u
+#define GATEWAY_MAX_DEVICES 8u
+
+typedef struct
+{
+    uint8_t addr;
+    int status;
+    crumbs_message_t reply;
+} gateway_result_t;
+
+static crumbs_context_t ctx;
+static crumbs_esp_i2c_t i2c;
+static crumbs_esp_engine_task_t engine;
+static crumbs_device_t devs[GATEWAY_MAX_DEVICES];
+static crumbs_request_t reqs[GATEWAY_MAX_DEVICES];
+static QueueHandle_t results;
+
+/* Runs in the engine task: pass the result on, keep the bus work there. */
+static void on_done(crumbs_request_t *req, int status)
+{
+    gateway_result_t r;
+
+    r.addr = req->dev->addr;
+    r.status = status;
+    r.reply = req->reply;
+    (void)xQueueSend(results, &r, 0);
+}
+
+void app_main(void)
+{
+    uint8_t found[GATEWAY_MAX_DEVICES];
+    gateway_result_t r;
+    int n;
+
+    if (crumbs_esp_init_controller(&ctx, &i2c, GATEWAY_PORT, GATEWAY_SDA, GATEWAY_SCL,
+                                   GATEWAY_SCL_HZ) != 0)
+    {
+        printf("gateway: I2C bus init failed\n");
+        return;
+    }
+
+    n = crumbs_esp_scan(&i2c, 0x08, 0x77, 0, found, GATEWAY_MAX_DEVICES);
+    printf("gateway: %d device(s)\n", (n > 0) ? n : 0);
+    if (n <= 0)
+    {
+        return;
+    }
+
+    results = xQueueCreate(GATEWAY_MAX_DEVICES, sizeof(gateway_result_t));
+    if (!results || crumbs_esp_engine_start(&engine, 1, 5) != 0)
+    {
+        printf("gateway: engine task start failed\n");
+        return;
+    }
+    for (int i = 0; i < n; i++)
+    {
+        crumbs_device_init(&devs[i], &ctx, found[i], crumbs_esp_delay_us);
+    }
+
+    for (;;)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            if (reqs[i].state != CRUMBS_REQ_IDLE)
+            {
+                continue; /* previous round still in flight */
+            }
+            crumbs_request_init(&reqs[i], &devs[i], GATEWAY_OPCODE, on_done, NULL);
+            if (crumbs_esp_engine_submit(&engine, &reqs[i]) != 0)
+            {
+                printf("gateway: submit queue full\n");
+            }
+        }
+
+        /* Print until the next round is due. */
+        TickType_t until = xTaskGetTickCount() + pdMS_TO_TICKS(GATEWAY_PERIOD_MS);
+        while ((int32_t)(until - xTaskGetTickCount()) > 0)
+        {
+            if (xQueueReceive(results, &r, until - xTaskGetTickCount()) != pdTRUE)
+            {
+                break;
+            }
+            if (r.status != 0)
+            {
+                printf("0x%02X: error %d\n", r.addr, r.status);
+                continue;
+            }
+            printf("0x%02X: type 0x%02X, %u byte(s)", r.addr, r.reply.type_id, r.reply.data_len);
+            for (uint8_t b = 0; b < r.reply.data_len; b++)
+            {
+                printf(" %02X", r.reply.data[b]);
+            }
+            printf("\n");
+        }
+    }
+}
@@ -0,0 +1,198 @@
+/*
+ * crumbs_top: watch the live bus metrics a controller or crumbsd publishes
+ * in shared memory (see crumbs_linux_metrics.h), or print them once in the
+ * Prometheus text format.
+ *
+ * Mapping the region read-only is all it takes; the publishing process is
+ * not slowed down or even aware of readers. When the writer restarts, the
+ * new region is picked up on the next refresh.
+ *
+ * Usage: ./crumbs_top [name] [interval-ms]
+ *        ./crumbs_top [name] --prom
+ * Example: ./crumbs_top /crumbs-metrics 1000
+ *          ./crumbs_top /crumbs-metrics --prom > /var/lib/node_exporter/crumbs.prom
+ */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L /* nanosleep, kill */
+#endif
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "crumbs.h"
+#include "crumbs_linux_metrics.h"
+
+static crumbs_metrics_region_t g_prev;
+static crumbs_metrics_region_t g_snap;
+static char g_prom[256u * 1024u];
+
+/* Upper bound of the bucket holding the q-th fraction of transfers (0 = none). */
+static unsigned long percentile_us(const crumbs_metrics_addr_t *now,
+                                   const crumbs_metrics_addr_t *before, unsigned q_pct)
+{
+    unsigned long total = now->transfers - before->transfers;
+    unsigned long seen = 0u;
+
+    if (total == 0u)
+    {
+        return 0u;
+    }
+    for (unsigned b = 0u; b < CRUMBS_METRICS_BUCKETS; b++)
+    {
+        seen += now->hist[b] - before->hist[b];
+        if (seen * 100u >= total * q_pct)
+        {
+            return (b < CRUMBS_METRICS_BUCKETS - 1u) ? (16ul << b) : ~0ul;
+        }
+    }
+    return ~0ul;
+}
+
+static void print_us(unsigned long us)
+{
+    if (us == ~0ul)
+    {
+        printf(" %8s", "slow");
+    }
+    else
+    {
+        printf(" %6luus", us);
+    }
+}
+
+static void print_screen(const char *name, const crumbs_metrics_region_t *now,
+                         const crumbs_metrics_region_t *before)
+{
+    uint32_t dt = now->uptime_us - before->uptime_us;
+    uint32_t busy = now->busy_us - before->busy_us;
+
+    printf("\033[H\033[2J");
+    printf("crumbs_top  %s  pid %lu  up %lus  bus %lu%%  transfers %lu  errors %lu\n", name,
+           (unsigned long)now->pid, (unsigned long)(now->uptime_us / 1000000u),
+           dt ? (unsigned long)((uint64_t)busy * 100u / dt) : 0ul,
+           (unsigned long)now->transfers, (unsigned long)now->errors);
+    printf("queues");
+    for (unsigned q = 0u; q < CRUMBS_METRICS_QUEUES; q++)
+    {
+        printf("  %u: %lu (max %lu)", q, (unsigned long)now->queue_depth[q],
+               (unsigned long)now->queue_high[q]);
+    }
+    printf("\n\n%-6s %10s %8s %8s %8s %8s %8s  %s\n", "addr", "transfers", "per s", "errors",
+           "p50", "p99", "max", "errors by kind");
+
+    for (unsigned i = 0u; i < CRUMBS_METRICS_ADDRS; i++)
+    {
+        const crumbs_metrics_addr_t *a = &now->addr[i];
+        const crumbs_metrics_addr_t *b = &before->addr[i];
+        if (!a->transfers)
+        {
+            continue;
+        }
+        uint32_t n = a->transfers - b->transfers;
+        printf("0x%02X   %10lu %8lu %8lu", i, (unsigned long)a->transfers,
+               dt ? (unsigned long)((uint64_t)n * 1000000u / dt) : 0ul, (unsigned long)a->errors);
+        print_us(percentile_us(a, b, 50u));
+        print_us(percentile_us(a, b, 99u));
+        print_us(a->max_us);
+        printf(" ");
+        for (unsigned k = 0u; k < CRUMBS_METRICS_ERR_KINDS; k++)
+        {
+            if (a->err_kind[k])
+            {
+                printf(" %s=%lu", crumbs_linux_metrics_kind_name(k), (unsigned long)a->err_kind[k]);
+            }
+        }
+        printf("\n");
+    }
+    fflush(stdout);
+}
+
+/* The writer is gone (or was replaced): map whatever region has the name now. */
+static int remap_if_stale(crumbs_linux_metrics_reader_t *r, const char *name)
+{
+    if (r->region && (kill((pid_t)r->region->pid, 0) == 0 || errno != ESRCH))
+    {
+        return 0;
+    }
+    crumbs_linux_metrics_unmap(r);
+    if (crumbs_linux_metrics_map(r, name) != 0)
+    {
+        return -1;
+    }
+    memset(&g_prev, 0, sizeof(g_prev));
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    crumbs_linux_metrics_reader_t r = {NULL};
+    const char *name = CRUMBS_METRICS_NAME;
+    unsigned long interval_ms = 1000u;
+    int prom = 0;
+
+    if (argc >= 2 && argv[1] && argv[1][0] != '\0')
+    {
+        name = argv[1];
+    }
+    if (argc >= 3 && argv[2])
+    {
+        if (strcmp(argv[2], "--prom") == 0)
+        {
+            prom = 1;
+        }
+        else
+        {
+            interval_ms = strtoul(argv[2], NULL, 0);
+            if (interval_ms == 0u)
+            {
+                interval_ms = 1000u;
+            }
+        }
+    }
+
+    int rc = crumbs_linux_metrics_map(&r, name);
+    if (rc != 0)
+    {
+        fprintf(stderr, "ERROR: no metrics region %s (%d)\n", name, rc);
+        return 1;
+    }
+
+    if (prom)
+    {
+        if (crumbs_linux_metrics_snapshot(&r, &g_snap) != 0 ||
+            crumbs_linux_metrics_format_prom(&g_snap, g_prom, sizeof(g_prom)) < 0)
+        {
+            fprintf(stderr, "ERROR: cannot read %s\n", name);
+            crumbs_linux_metrics_unmap(&r);
+            return 1;
+        }
+        fputs(g_prom, stdout);
+        crumbs_linux_metrics_unmap(&r);
+        return 0;
+    }
+
+    (void)crumbs_linux_metrics_snapshot(&r, &g_prev);
+    for (;;)
+    {
+        struct timespec ts = {(time_t)(interval_ms / 1000u), (long)(interval_ms % 1000u) * 1000000L};
+        nanosleep(&ts, NULL);
+
+        if (remap_if_stale(&r, name) != 0)
+        {
+            printf("\033[H\033[2Jcrumbs_top  %s  waiting for a writer...\n", name);
+            fflush(stdout);
+            continue;
+        }
+        if (crumbs_linux_metrics_snapshot(&r, &g_snap) != 0)
+        {
+            continue;
+        }
+        print_screen(name, &g_snap, &g_prev);
+        g_prev = g_snap;
+    }
+}
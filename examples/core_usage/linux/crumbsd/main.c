@@ -0,0 +1,140 @@
+/*
+ * crumbsd: own an I2C bus and share it with other processes over a Unix
+ * socket (see crumbs_linux_daemon.h).
+ *
+ * Clients connect with crumbs_daemon_init_controller() and keep using
+ * their ops headers unchanged. Identical GETs from several clients share
+ * one bus transaction and replies are cached for a few milliseconds.
+ *
+ * With a capture file, every bus transfer is appended to it for
+ * crumbs_capture_replay (see crumbs_capture.h). With a metrics name, live
+ * counters are published in shared memory for crumbs_top (see
+ * crumbs_linux_metrics.h); queue slot 2 holds the connected clients.
+ *
+ * Usage: ./crumbsd [i2c-device] [socket] [cache-ttl-us] [capture] [metrics]
+ * Example: ./crumbsd /dev/i2c-1 /run/crumbsd.sock 5000 "" /crumbs-metrics
+ */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L /* sigaction */
+#endif
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include "crumbs.h"
+#include "crumbs_capture.h"
+#include "crumbs_linux.h"
+#include "crumbs_linux_capture.h"
+#include "crumbs_linux_daemon.h"
+#include "crumbs_linux_loop.h"
+#include "crumbs_linux_metrics.h"
+
+static crumbs_daemon_t g_daemon;
+static crumbs_capture_t g_capture;
+static crumbs_linux_capture_t g_capture_file = {-1, 0u};
+static crumbs_linux_metrics_t g_metrics = {.fd = -1};
+static volatile sig_atomic_t g_stop;
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    g_stop = 1;
+}
+
+int main(int argc, char **argv)
+{
+    crumbs_context_t ctx;
+    crumbs_linux_i2c_t lw;
+    struct sigaction sa;
+
+    const char *device_path = "/dev/i2c-1";
+    const char *socket_path = CRUMBS_DAEMON_SOCKET;
+
+    if (argc >= 2 && argv[1] && argv[1][0] != '\0')
+    {
+        device_path = argv[1];
+    }
+    if (argc >= 3 && argv[2] && argv[2][0] != '\0')
+    {
+        socket_path = argv[2];
+    }
+
+    int rc = crumbs_linux_init_controller(&ctx, &lw, device_path, 25000);
+    if (rc != 0)
+    {
+        fprintf(stderr, "ERROR: crumbs_linux_init_controller failed (%d)\n", rc);
+        return 1;
+    }
+
+    /* Under the capture, so latencies do not include writing the capture file. */
+    if (argc >= 6 && argv[5] && argv[5][0] != '\0')
+    {
+        rc = crumbs_linux_metrics_open(&g_metrics, argv[5]);
+        if (rc != 0 || crumbs_linux_metrics_attach(&g_metrics, &ctx) != 0)
+        {
+            fprintf(stderr, "ERROR: cannot publish metrics as %s (%d)\n", argv[5], rc);
+            crumbs_linux_metrics_close(&g_metrics);
+            crumbs_linux_close(&lw);
+            return 1;
+        }
+    }
+
+    if (argc >= 5 && argv[4] && argv[4][0] != '\0')
+    {
+        rc = crumbs_linux_capture_open(&g_capture_file, argv[4]);
+        if (rc != 0)
+        {
+            fprintf(stderr, "ERROR: cannot open capture %s (%d)\n", argv[4], rc);
+            crumbs_linux_metrics_close(&g_metrics);
+            crumbs_linux_close(&lw);
+            return 1;
+        }
+        crumbs_capture_attach(&g_capture, &ctx, crumbs_linux_capture_sink, &g_capture_file,
+                              crumbs_linux_loop_now_us);
+    }
+
+    rc = crumbs_daemon_init(&g_daemon, socket_path, ctx.transport, ctx.transport_io);
+    if (rc != 0)
+    {
+        fprintf(stderr, "ERROR: cannot listen on %s (%d)\n", socket_path, rc);
+        crumbs_linux_metrics_close(&g_metrics);
+        crumbs_linux_capture_close(&g_capture_file);
+        crumbs_linux_close(&lw);
+        return 1;
+    }
+    if (argc >= 4 && argv[3])
+    {
+        g_daemon.cache_ttl_us = (uint32_t)strtoul(argv[3], NULL, 0);
+    }
+    /* Group access decides who may use the bus. */
+    (void)chmod(socket_path, 0660);
+
+    sa.sa_handler = on_signal;
+    sa.sa_flags = 0;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    printf("crumbsd: %s on %s (cache %lu us)\n", device_path, socket_path,
+           (unsigned long)g_daemon.cache_ttl_us);
+
+    while (!g_stop)
+    {
+        crumbs_daemon_poll(&g_daemon, 1000);
+        crumbs_linux_metrics_set_queue(&g_metrics, 2u, g_daemon.stats.clients);
+    }
+
+    const crumbs_daemon_stats_t *s = &g_daemon.stats;
+    printf("crumbsd: %lu request(s), %lu bus transfer(s), %lu coalesced, %lu cache hit(s)\n",
+           (unsigned long)s->requests, (unsigned long)s->transfers,
+           (unsigned long)s->coalesced, (unsigned long)s->cache_hits);
+
+    crumbs_daemon_close(&g_daemon);
+    crumbs_linux_metrics_close(&g_metrics);
+    crumbs_linux_capture_close(&g_capture_file);
+    crumbs_linux_close(&lw);
+    return 0;
+}
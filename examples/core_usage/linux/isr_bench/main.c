@@ -0,0 +1,414 @@
+/*
+ * Drive the isr_bench firmware through a sweep of handler counts and
+ * payload lengths and print the per-phase ISR cycle counts as a table.
+ *
+ * For each point the peripheral is given the filler handlers, its timing
+ * is cleared and counting restricted to the echo opcode, the echo command
+ * and its reply are run ITERATIONS times, and the five phases are read
+ * back over CRUMBS_CMD_TIMING. Cycles are net of the hook overhead.
+ *
+ * The run can be saved as CSV and compared with an earlier one (another
+ * PlatformIO env, or the tree before a change): the second table then
+ * shows the change in average cycles per phase.
+ *
+ * Usage: ./crumbs_isr_bench [i2c-device] [addr] [out.csv] [baseline.csv]
+ * Example: ./crumbs_isr_bench /dev/i2c-1 0x08 f401_direct.csv f401_linear.csv
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_linux.h"
+#include "crumbs_message_helpers.h"
+#include "crumbs_timing.h"
+#include "isr_bench.h"
+
+#define ITERATIONS 64
+#define CONFIG_SETTLE_US 20000u
+#define MAX_ROWS 64
+
+static const uint8_t g_fillers[] = {0, 4, 8, 16, 255}; /* 255: as many as fit */
+static const uint8_t g_lens[] = {0, 1, 8, 16, 27};
+
+typedef struct
+{
+    uint8_t fillers;
+    uint8_t len;
+    uint32_t avg[CRUMBS_TIMING_PHASES]; /* net cycles */
+    uint32_t max[CRUMBS_TIMING_PHASES];
+    uint32_t count[CRUMBS_TIMING_PHASES];
+} row_t;
+
+typedef struct
+{
+    uint8_t dispatch;
+    uint8_t crc_backend;
+    uint8_t max_handlers;
+    uint8_t fillers;
+} bench_info_t;
+
+static row_t g_rows[MAX_ROWS];
+static row_t g_base[MAX_ROWS];
+
+/* ---- Bus helpers -------------------------------------------------------- */
+
+static int bench_send(const crumbs_device_t *dev, uint8_t opcode, const uint8_t *data, uint8_t len)
+{
+    crumbs_message_t m;
+    crumbs_msg_init(&m, ISR_BENCH_TYPE_ID, opcode);
+    crumbs_msg_add_bytes(&m, data, len);
+    return crumbs_controller_send(dev->ctx, dev->addr, &m, dev->write_fn, dev->io);
+}
+
+static int bench_get(const crumbs_device_t *dev, uint8_t opcode, crumbs_message_t *reply)
+{
+    crumbs_message_t m;
+    crumbs_msg_init(&m, 0x00, CRUMBS_CMD_SET_REPLY);
+    crumbs_msg_add_u8(&m, opcode);
+    int rc = crumbs_controller_send(dev->ctx, dev->addr, &m, dev->write_fn, dev->io);
+    if (rc != 0)
+    {
+        return rc;
+    }
+    dev->delay_fn(CRUMBS_DEFAULT_QUERY_DELAY_US);
+    rc = crumbs_controller_read(dev->ctx, dev->addr, reply, dev->read_fn, dev->io);
+    return (rc == 0 && reply->opcode != opcode) ? -1 : rc;
+}
+
+static int bench_info(const crumbs_device_t *dev, bench_info_t *out)
+{
+    crumbs_message_t reply;
+    int rc = bench_get(dev, ISR_BENCH_OP_INFO, &reply);
+    if (rc != 0)
+    {
+        return rc;
+    }
+    if (crumbs_msg_read_u8(reply.data, reply.data_len, 0, &out->dispatch) != 0 ||
+        crumbs_msg_read_u8(reply.data, reply.data_len, 1, &out->crc_backend) != 0 ||
+        crumbs_msg_read_u8(reply.data, reply.data_len, 2, &out->max_handlers) != 0 ||
+        crumbs_msg_read_u8(reply.data, reply.data_len, 3, &out->fillers) != 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+static uint32_t net(uint32_t ticks, uint16_t overhead)
+{
+    return (ticks > overhead) ? ticks - overhead : 0u;
+}
+
+/** @brief Run one sweep point; returns 0 and fills @p row, or the first error. */
+static int run_point(const crumbs_device_t *dev, uint8_t len, row_t *row, uint32_t *clock_hz,
+                     uint16_t *overhead)
+{
+    uint8_t payload[CRUMBS_MAX_PAYLOAD];
+    crumbs_message_t reply;
+    crumbs_timing_report_t r;
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+        payload[i] = (uint8_t)(0xA0u + i);
+    }
+
+    int rc = crumbs_controller_reset_timing(dev, ISR_BENCH_OP_ECHO);
+    for (int i = 0; rc == 0 && i < ITERATIONS; i++)
+    {
+        rc = bench_send(dev, ISR_BENCH_OP_ECHO, payload, len);
+        if (rc == 0)
+        {
+            rc = bench_get(dev, ISR_BENCH_OP_ECHO, &reply);
+        }
+        if (rc == 0 && (reply.data_len != len || memcmp(reply.data, payload, len) != 0))
+        {
+            rc = -1;
+        }
+    }
+
+    row->len = len;
+    for (uint8_t p = 0; rc == 0 && p < CRUMBS_TIMING_PHASES; p++)
+    {
+        rc = crumbs_controller_read_timing(dev, p, &r);
+        if (rc != 0)
+        {
+            break;
+        }
+        *clock_hz = r.clock_hz;
+        *overhead = r.overhead;
+        row->count[p] = r.stat.count;
+        row->avg[p] = r.stat.count ? net(r.stat.total / r.stat.count, r.overhead) : 0u;
+        row->max[p] = net(r.stat.max, r.overhead);
+    }
+    return rc;
+}
+
+/* ---- Output ------------------------------------------------------------- */
+
+static void print_header(void)
+{
+    printf("| handlers | len |");
+    for (uint8_t p = 0; p < CRUMBS_TIMING_PHASES; p++)
+    {
+        printf(" %-15s |", crumbs_timing_phase_name(p));
+    }
+    printf("\n|---------:|----:|");
+    for (uint8_t p = 0; p < CRUMBS_TIMING_PHASES; p++)
+    {
+        printf("----------------:|");
+    }
+    printf("\n");
+}
+
+static void print_table(const row_t *rows, int n)
+{
+    char cell[32];
+
+    print_header();
+    for (int i = 0; i < n; i++)
+    {
+        printf("| %8u | %3u |", (unsigned)(rows[i].fillers + ISR_BENCH_FIXED_HANDLERS),
+               (unsigned)rows[i].len);
+        for (uint8_t p = 0; p < CRUMBS_TIMING_PHASES; p++)
+        {
+            if (rows[i].count[p] == 0u)
+            {
+                snprintf(cell, sizeof(cell), "-");
+            }
+            else
+            {
+                snprintf(cell, sizeof(cell), "%lu (%lu)", (unsigned long)rows[i].avg[p],
+                         (unsigned long)rows[i].max[p]);
+            }
+            printf(" %15s |", cell);
+        }
+        printf("\n");
+    }
+}
+
+static const row_t *find_row(const row_t *rows, int n, uint8_t fillers, uint8_t len)
+{
+    for (int i = 0; i < n; i++)
+    {
+        if (rows[i].fillers == fillers && rows[i].len == len)
+        {
+            return &rows[i];
+        }
+    }
+    return NULL;
+}
+
+static void print_compare(const row_t *rows, int n, const row_t *base, int nbase)
+{
+    char cell[32];
+
+    print_header();
+    for (int i = 0; i < n; i++)
+    {
+        const row_t *b = find_row(base, nbase, rows[i].fillers, rows[i].len);
+        printf("| %8u | %3u |", (unsigned)(rows[i].fillers + ISR_BENCH_FIXED_HANDLERS),
+               (unsigned)rows[i].len);
+        for (uint8_t p = 0; p < CRUMBS_TIMING_PHASES; p++)
+        {
+            if (!b || b->count[p] == 0u || rows[i].count[p] == 0u || b->avg[p] == 0u)
+            {
+                snprintf(cell, sizeof(cell), "-");
+            }
+            else
+            {
+                double pct = 100.0 * ((double)rows[i].avg[p] - (double)b->avg[p]) / (double)b->avg[p];
+                snprintf(cell, sizeof(cell), "%lu->%lu %+.0f%%", (unsigned long)b->avg[p],
+                         (unsigned long)rows[i].avg[p], pct);
+            }
+            printf(" %15s |", cell);
+        }
+        printf("\n");
+    }
+}
+
+/* CSV: one line per point, count/avg/max per phase; '#' lines are comments. */
+static int save_csv(const char *path, const row_t *rows, int n, const bench_info_t *info,
+                    uint32_t clock_hz, uint16_t overhead)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+    {
+        return -1;
+    }
+    fprintf(f, "# dispatch=%u crc_backend=%u max_handlers=%u clock_hz=%lu overhead=%u\n",
+            (unsigned)info->dispatch, (unsigned)info->crc_backend, (unsigned)info->max_handlers,
+            (unsigned long)clock_hz, (unsigned)overhead);
+    for (int i = 0; i < n; i++)
+    {
+        fprintf(f, "%u,%u", (unsigned)rows[i].fillers, (unsigned)rows[i].len);
+        for (uint8_t p = 0; p < CRUMBS_TIMING_PHASES; p++)
+        {
+            fprintf(f, ",%lu,%lu,%lu", (unsigned long)rows[i].count[p],
+                    (unsigned long)rows[i].avg[p], (unsigned long)rows[i].max[p]);
+        }
+        fprintf(f, "\n");
+    }
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+static int load_csv(const char *path, row_t *rows, int max)
+{
+    char line[256];
+    int n = 0;
+    FILE *f = fopen(path, "r");
+    if (!f)
+    {
+        return -1;
+    }
+    while (n < max && fgets(line, sizeof(line), f))
+    {
+        if (line[0] == '#' || line[0] == '\n')
+        {
+            continue;
+        }
+        char *p = line;
+        unsigned long v[2 + 3 * CRUMBS_TIMING_PHASES];
+        size_t k = 0;
+        while (k < sizeof(v) / sizeof(v[0]))
+        {
+            char *end;
+            v[k] = strtoul(p, &end, 10);
+            if (end == p)
+            {
+                break;
+            }
+            k++;
+            p = (*end == ',') ? end + 1 : end;
+        }
+        if (k != sizeof(v) / sizeof(v[0]))
+        {
+            continue;
+        }
+        rows[n].fillers = (uint8_t)v[0];
+        rows[n].len = (uint8_t)v[1];
+        for (uint8_t ph = 0; ph < CRUMBS_TIMING_PHASES; ph++)
+        {
+            rows[n].count[ph] = (uint32_t)v[2 + 3 * ph];
+            rows[n].avg[ph] = (uint32_t)v[3 + 3 * ph];
+            rows[n].max[ph] = (uint32_t)v[4 + 3 * ph];
+        }
+        n++;
+    }
+    fclose(f);
+    return n;
+}
+
+int main(int argc, char **argv)
+{
+    crumbs_context_t ctx;
+    crumbs_linux_i2c_t lw;
+    crumbs_device_t dev;
+    crumbs_capabilities_t caps;
+    bench_info_t info;
+
+    const char *device_path = "/dev/i2c-1";
+    uint8_t addr = ISR_BENCH_ADDR;
+    const char *out_path = (argc >= 4) ? argv[3] : NULL;
+    const char *base_path = (argc >= 5) ? argv[4] : NULL;
+
+    if (argc >= 2 && argv[1] && argv[1][0] != '\0')
+    {
+        device_path = argv[1];
+    }
+    if (argc >= 3 && argv[2])
+    {
+        unsigned long val = strtoul(argv[2], NULL, 0);
+        if (val <= 0x7F)
+            addr = (uint8_t)val;
+    }
+
+    int rc = crumbs_linux_init_controller(&ctx, &lw, device_path, 25000);
+    if (rc != 0)
+    {
+        fprintf(stderr, "ERROR: crumbs_linux_init_controller failed (%d)\n", rc);
+        return 1;
+    }
+
+    memset(&dev, 0, sizeof(dev));
+    dev.ctx = &ctx;
+    dev.addr = addr;
+    dev.write_fn = crumbs_linux_i2c_write;
+    dev.read_fn = crumbs_linux_read;
+    dev.delay_fn = crumbs_linux_delay_us;
+    dev.io = (void *)&lw;
+
+    rc = crumbs_controller_get_capabilities(&dev, &caps);
+    if (rc != 0 || (caps.flags & CRUMBS_CAP_TIMING) == 0u || bench_info(&dev, &info) != 0)
+    {
+        fprintf(stderr, "ERROR: 0x%02X is not running isr_bench (rc=%d)\n", addr, rc);
+        crumbs_linux_close(&lw);
+        return 1;
+    }
+
+    uint8_t filler_max = (uint8_t)(info.max_handlers - ISR_BENCH_FIXED_HANDLERS);
+    uint32_t clock_hz = 0u;
+    uint16_t overhead = 0u;
+    int n = 0;
+
+    for (size_t f = 0; rc == 0 && f < sizeof(g_fillers); f++)
+    {
+        uint8_t fillers = (g_fillers[f] > filler_max) ? filler_max : g_fillers[f];
+        if (n > 0 && g_rows[n - 1].fillers == fillers)
+        {
+            continue; /* clipped onto the previous count */
+        }
+
+        rc = bench_send(&dev, ISR_BENCH_OP_CONFIG, &fillers, 1u);
+        dev.delay_fn(CONFIG_SETTLE_US);
+        if (rc == 0)
+        {
+            rc = bench_info(&dev, &info);
+        }
+        if (rc == 0 && info.fillers != fillers)
+        {
+            rc = -1;
+        }
+
+        for (size_t l = 0; rc == 0 && l < sizeof(g_lens) && n < MAX_ROWS; l++)
+        {
+            g_rows[n].fillers = fillers;
+            rc = run_point(&dev, g_lens[l], &g_rows[n], &clock_hz, &overhead);
+            if (rc == 0)
+            {
+                n++;
+            }
+        }
+    }
+    crumbs_linux_close(&lw);
+    if (rc != 0)
+    {
+        fprintf(stderr, "ERROR: sweep failed after %d point(s) (%d)\n", n, rc);
+        return 1;
+    }
+
+    printf("ISR cycles of 0x%02X on %s: dispatch=%u crc_backend=%u, %d iterations per point\n",
+           addr, device_path, (unsigned)info.dispatch, (unsigned)info.crc_backend, ITERATIONS);
+    printf("avg (max) cycles net of the %u-cycle hook overhead; %lu cycles = 1 us\n\n",
+           (unsigned)overhead, (unsigned long)(clock_hz / 1000000u));
+    print_table(g_rows, n);
+
+    if (out_path && save_csv(out_path, g_rows, n, &info, clock_hz, overhead) != 0)
+    {
+        fprintf(stderr, "ERROR: cannot write %s\n", out_path);
+        return 1;
+    }
+    if (base_path)
+    {
+        int nbase = load_csv(base_path, g_base, MAX_ROWS);
+        if (nbase < 0)
+        {
+            fprintf(stderr, "ERROR: cannot read %s\n", base_path);
+            return 1;
+        }
+        printf("\nAverage cycles against %s:\n\n", base_path);
+        print_compare(g_rows, n, g_base, nbase);
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+/*
+ * Read a peripheral's trace ring over CRUMBS_CMD_TRACE and print it as a
+ * timeline.
+ *
+ * The peripheral must be built with CRUMBS_ENABLE_TRACE=1 and attach a
+ * ring (crumbs_trace_ring_attach()). Times are in the units of the clock
+ * it attached, usually micros().
+ *
+ * Usage: ./crumbs_trace_dump [i2c-device] [addr]
+ * Example: ./crumbs_trace_dump /dev/i2c-1 0x08
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_linux.h"
+#include "crumbs_trace.h"
+
+#define DEFAULT_ADDR 0x08
+#define MAX_EVENTS 1024u
+
+static crumbs_trace_event_t g_events[MAX_EVENTS];
+
+static void print_timeline(const crumbs_trace_event_t *ev, int n)
+{
+    uint32_t t = 0u;
+
+    printf("%6s %10s %8s  %-14s %-6s %s\n", "index", "t", "+dt", "event", "opcode", "len");
+    for (int i = 0; i < n; i++)
+    {
+        /* The first delta is relative to an event that is no longer held. */
+        uint32_t dt = (i == 0) ? 0u : ev[i].delta;
+        t += dt;
+
+        if (i > 0 && ev[i].index != (uint16_t)(ev[i - 1].index + 1u))
+        {
+            printf("  ... %u event(s) lost ...\n", (unsigned)(uint16_t)(ev[i].index - ev[i - 1].index - 1u));
+        }
+        else if (i > 0 && ev[i].event == CRUMBS_TRACE_RX_START)
+        {
+            printf("\n");
+        }
+
+        printf("%6u %10lu %8lu  %-14s 0x%02X   %u\n",
+               (unsigned)ev[i].index, (unsigned long)t, (unsigned long)dt,
+               crumbs_trace_event_name(ev[i].event), ev[i].opcode, (unsigned)ev[i].len);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    crumbs_context_t ctx;
+    crumbs_linux_i2c_t lw;
+    crumbs_device_t dev;
+    crumbs_capabilities_t caps;
+
+    const char *device_path = "/dev/i2c-1";
+    uint8_t addr = DEFAULT_ADDR;
+
+    if (argc >= 2 && argv[1] && argv[1][0] != '\0')
+    {
+        device_path = argv[1];
+    }
+    if (argc >= 3 && argv[2])
+    {
+        unsigned long val = strtoul(argv[2], NULL, 0);
+        if (val <= 0x7F)
+            addr = (uint8_t)val;
+    }
+
+    int rc = crumbs_linux_init_controller(&ctx, &lw, device_path, 25000);
+    if (rc != 0)
+    {
+        fprintf(stderr, "ERROR: crumbs_linux_init_controller failed (%d)\n", rc);
+        return 1;
+    }
+
+    memset(&dev, 0, sizeof(dev));
+    dev.ctx = &ctx;
+    dev.addr = addr;
+    dev.write_fn = crumbs_linux_i2c_write;
+    dev.read_fn = crumbs_linux_read;
+    dev.delay_fn = crumbs_linux_delay_us;
+    dev.io = (void *)&lw;
+
+    rc = crumbs_controller_get_capabilities(&dev, &caps);
+    if (rc != 0 || (caps.flags & CRUMBS_CAP_TRACE) == 0u)
+    {
+        fprintf(stderr, "ERROR: 0x%02X has no trace ring (rc=%d)\n", addr, rc);
+        crumbs_linux_close(&lw);
+        return 1;
+    }
+
+    int n = crumbs_controller_read_trace(&dev, g_events, MAX_EVENTS);
+    crumbs_linux_close(&lw);
+    if (n < 0)
+    {
+        fprintf(stderr, "ERROR: trace read failed (%d)\n", n);
+        return 1;
+    }
+
+    printf("Trace of 0x%02X on %s: %d event(s)\n\n", addr, device_path, n);
+    print_timeline(g_events, n);
+    return 0;
+}
@@ -0,0 +1,30 @@
+/**
+ * @file
+ * @brief Commands of the ISR benchmark firmware, shared with the Linux driver.
+ *
+ * The firmware keeps a set of filler handlers registered in front of the
+ * echo handler so the dispatch lookup can be timed against the handler
+ * count. Results are read with CRUMBS_CMD_TIMING (see crumbs_timing.h).
+ */
+
+#ifndef ISR_BENCH_H
+#define ISR_BENCH_H
+
+#define ISR_BENCH_ADDR 0x08    /**< Default I2C address. */
+#define ISR_BENCH_TYPE_ID 0x7E /**< Device type of the benchmark firmware. */
+
+/** GET: version info (CRUMBS_VERSION, module 1.0.0) by the 0x00 convention. */
+#define ISR_BENCH_OP_VERSION 0x00
+/** SET: [fillers] handlers to register before the echo handler; applied by loop(). */
+#define ISR_BENCH_OP_CONFIG 0x01
+/** SET: [payload 0-27] stored by the handler; GET: the stored payload. */
+#define ISR_BENCH_OP_ECHO 0x02
+/** GET: [dispatch][crc_backend][max_handlers][fillers] build options and state. */
+#define ISR_BENCH_OP_INFO 0x03
+
+#define ISR_BENCH_FILLER_BASE 0x10 /**< Opcode of the first filler handler. */
+
+/** Handlers that are not fillers (CONFIG and ECHO). */
+#define ISR_BENCH_FIXED_HANDLERS 2
+
+#endif /* ISR_BENCH_H */
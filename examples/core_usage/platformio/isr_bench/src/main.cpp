@@ -0,0 +1,213 @@
+/**
+ * @file
+ * @brief ISR benchmark peripheral: cycle-accurate timing of the CRUMBS hot paths.
+ *
+ * Times the Wire receive and request callbacks phase by phase (decode,
+ * dispatch, reply build) with the CPU's own cycle counter and serves the
+ * results over CRUMBS_CMD_TIMING. Drive it with the Linux isr_bench
+ * program, which sweeps payload lengths and handler counts.
+ *
+ * Cycle counters:
+ *   AVR          Timer1 at F_CPU (prescaler 1), extended to 32 bits
+ *   Cortex-M3/4/7  DWT->CYCCNT at SystemCoreClock
+ */
+
+#include <Arduino.h>
+#include <crumbs_arduino.h>
+#include <crumbs_message_helpers.h>
+#include <crumbs_timing.h>
+
+#include "isr_bench.h"
+
+#if !CRUMBS_ENABLE_TRACE
+#error "Build with -DCRUMBS_ENABLE_TRACE=1 (see platformio.ini)"
+#endif
+
+#define FILLER_MAX (CRUMBS_MAX_HANDLERS - ISR_BENCH_FIXED_HANDLERS)
+
+crumbs_context_t per_ctx;
+static crumbs_timing_t timing;
+
+static uint8_t echo_buf[CRUMBS_MAX_PAYLOAD];
+static uint8_t echo_len;
+static uint8_t fillers;
+static volatile uint8_t fillers_wanted;
+static volatile uint8_t config_pending;
+
+/* ---- Cycle counter ------------------------------------------------------ */
+
+#if defined(__AVR__)
+static volatile uint16_t timer1_overflows;
+
+ISR(TIMER1_OVF_vect)
+{
+    timer1_overflows++;
+}
+
+static void cycles_begin(void)
+{
+    TCCR1A = 0;
+    TCCR1B = _BV(CS10); /* normal mode, clk/1 */
+    TCNT1 = 0;
+    TIFR1 = _BV(TOV1);
+    TIMSK1 = _BV(TOIE1);
+}
+
+/* Runs inside the TWI interrupt, where the overflow ISR cannot: count a
+ * pending overflow by hand if the low half has already wrapped. */
+static uint32_t cycles(void)
+{
+    uint8_t sreg = SREG;
+    cli();
+    uint16_t lo = TCNT1;
+    uint16_t hi = timer1_overflows;
+    if ((TIFR1 & _BV(TOV1)) && lo < 0x8000u)
+    {
+        hi++;
+    }
+    SREG = sreg;
+    return ((uint32_t)hi << 16) | lo;
+}
+
+static uint32_t cycles_hz(void)
+{
+    return F_CPU;
+}
+
+#elif defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+static void cycles_begin(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static uint32_t cycles(void)
+{
+    return DWT->CYCCNT;
+}
+
+static uint32_t cycles_hz(void)
+{
+    return SystemCoreClock;
+}
+
+#else
+#error "No cycle counter for this target (AVR or Cortex-M3/M4/M7 with DWT)"
+#endif
+
+/* ---- Handlers ----------------------------------------------------------- */
+
+static void handle_filler(crumbs_context_t *ctx, uint8_t opcode, const uint8_t *data,
+                          uint8_t data_len, void *user_data)
+{
+    (void)ctx;
+    (void)opcode;
+    (void)data;
+    (void)data_len;
+    (void)user_data;
+}
+
+static void handle_config(crumbs_context_t *ctx, uint8_t opcode, const uint8_t *data,
+                          uint8_t data_len, void *user_data)
+{
+    (void)ctx;
+    (void)opcode;
+    (void)user_data;
+    uint8_t n = 0;
+    if (crumbs_msg_read_u8(data, data_len, 0, &n) == 0)
+    {
+        fillers_wanted = (n > FILLER_MAX) ? FILLER_MAX : n;
+        config_pending = 1;
+    }
+}
+
+static void handle_echo(crumbs_context_t *ctx, uint8_t opcode, const uint8_t *data,
+                        uint8_t data_len, void *user_data)
+{
+    (void)ctx;
+    (void)opcode;
+    (void)user_data;
+    memcpy(echo_buf, data, data_len);
+    echo_len = data_len;
+}
+
+static void reply_version(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)ctx;
+    (void)user_data;
+    crumbs_msg_init(reply, ISR_BENCH_TYPE_ID, ISR_BENCH_OP_VERSION);
+    crumbs_msg_add_u16(reply, CRUMBS_VERSION);
+    crumbs_msg_add_u8(reply, 1);
+    crumbs_msg_add_u8(reply, 0);
+    crumbs_msg_add_u8(reply, 0);
+}
+
+static void reply_echo(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)ctx;
+    (void)user_data;
+    crumbs_msg_init(reply, ISR_BENCH_TYPE_ID, ISR_BENCH_OP_ECHO);
+    crumbs_msg_add_bytes(reply, echo_buf, echo_len);
+}
+
+static void reply_info(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)ctx;
+    (void)user_data;
+    crumbs_msg_init(reply, ISR_BENCH_TYPE_ID, ISR_BENCH_OP_INFO);
+    crumbs_msg_add_u8(reply, CRUMBS_DISPATCH);
+    crumbs_msg_add_u8(reply, CRUMBS_CRC_BACKEND);
+    crumbs_msg_add_u8(reply, CRUMBS_MAX_HANDLERS);
+    crumbs_msg_add_u8(reply, fillers);
+}
+
+/* Fillers go in front of ECHO so a linear lookup walks past all of them. */
+static void apply_fillers(uint8_t n)
+{
+    noInterrupts();
+    crumbs_unregister_handler(&per_ctx, ISR_BENCH_OP_ECHO);
+    for (uint8_t i = 0; i < fillers; i++)
+    {
+        crumbs_unregister_handler(&per_ctx, (uint8_t)(ISR_BENCH_FILLER_BASE + i));
+    }
+    for (uint8_t i = 0; i < n; i++)
+    {
+        crumbs_register_handler(&per_ctx, (uint8_t)(ISR_BENCH_FILLER_BASE + i), handle_filler, NULL);
+    }
+    crumbs_register_handler(&per_ctx, ISR_BENCH_OP_ECHO, handle_echo, NULL);
+    fillers = n;
+    interrupts();
+}
+
+void setup()
+{
+    Serial.begin(115200);
+    cycles_begin();
+
+    crumbs_arduino_init_peripheral(&per_ctx, ISR_BENCH_ADDR);
+    crumbs_register_handler(&per_ctx, ISR_BENCH_OP_CONFIG, handle_config, NULL);
+    crumbs_register_reply_handler(&per_ctx, ISR_BENCH_OP_VERSION, reply_version, NULL);
+    crumbs_register_reply_handler(&per_ctx, ISR_BENCH_OP_ECHO, reply_echo, NULL);
+    crumbs_register_reply_handler(&per_ctx, ISR_BENCH_OP_INFO, reply_info, NULL);
+    apply_fillers(0);
+
+    crumbs_timing_attach(&per_ctx, &timing, cycles, cycles_hz());
+
+    Serial.print(F("CRUMBS ISR bench at 0x"));
+    Serial.print(ISR_BENCH_ADDR, HEX);
+    Serial.print(F(", "));
+    Serial.print(cycles_hz());
+    Serial.print(F(" Hz, hook overhead "));
+    Serial.print(timing.overhead);
+    Serial.println(F(" cycles"));
+}
+
+void loop()
+{
+    if (config_pending)
+    {
+        config_pending = 0;
+        apply_fillers(fillers_wanted);
+    }
+}
@@ -0,0 +1,66 @@
+/**
+ * @file main.c
+ * @brief RP2040 peripheral on hardware I2C with DMA (I2C0, SDA GP4, SCL GP5, 1 MHz).
+ *
+ * SET 0x01 [n:u8] adds n to a counter; GET 0x80 returns it as u32. The
+ * main loop keeps the GET reply pre-built, so a read is served straight
+ * from the DMA buffer.
+ */
+
+#include "pico/stdlib.h"
+
+#include "crumbs.h"
+#include "crumbs_message_helpers.h"
+#include "crumbs_rp2040.h"
+
+#define DEMO_ADDR 0x08
+#define DEMO_TYPE_ID 0x42
+#define DEMO_OP_ADD 0x01
+#define DEMO_OP_GET 0x80
+
+static crumbs_context_t ctx;
+static crumbs_rp2040_peripheral_t periph;
+static volatile uint32_t counter;
+
+static void on_add(crumbs_context_t *c, uint8_t opcode, const uint8_t *data, uint8_t len,
+                   void *user)
+{
+    uint8_t n;
+    (void)opcode;
+    (void)user;
+
+    if (crumbs_msg_read_u8(data, len, 0, &n) == 0)
+    {
+        counter += n;
+        crumbs_peripheral_invalidate_reply(c);
+    }
+}
+
+static void on_get(crumbs_context_t *c, crumbs_message_t *reply, void *user)
+{
+    (void)c;
+    (void)user;
+    crumbs_msg_init(reply, DEMO_TYPE_ID, DEMO_OP_GET);
+    crumbs_msg_add_u32(reply, counter);
+}
+
+int main(void)
+{
+    stdio_init_all();
+
+    if (crumbs_rp2040_init_peripheral(&periph, &ctx, i2c0, DEMO_ADDR, 4, 5, 1000000u) != 0)
+    {
+        for (;;)
+        {
+            tight_loop_contents();
+        }
+    }
+    crumbs_register_handler(&ctx, DEMO_OP_ADD, on_add, NULL);
+    crumbs_register_reply_handler(&ctx, DEMO_OP_GET, on_get, NULL);
+
+    for (;;)
+    {
+        crumbs_peripheral_refresh_reply(&ctx);
+        sleep_us(100);
+    }
+}
@@ -265,15 +265,14 @@ static void reply_handler_get_hist_meta(crumbs_context_t *ctx, crumbs_message_t
 }
 
 /*
- * History entry GET ops (CALC_OP_GET_HIST_0..11) are handled via on_request
- * fallback rather than individually-registered reply handlers. Registering
- * all 12 alongside the 4 SET handlers would exceed CRUMBS_MAX_HANDLERS (16
- * by default). The on_request callback is intentionally kept for this fan-out
- * case and serves as a practical illustration of the fallback model.
+ * History entry GET ops (CALC_OP_GET_HIST_0..11) share one reply range
+ * instead of twelve reply handler entries; the offset into the range is
+ * the history index.
  */
-static void on_request_hist(crumbs_context_t *ctx, crumbs_message_t *reply)
+static void reply_handler_get_hist(crumbs_context_t *ctx, crumbs_message_t *reply, void *user)
 {
-    uint8_t entry_idx = (uint8_t)(ctx->requested_opcode - CALC_OP_GET_HIST_0);
+    (void)user;
+    uint8_t entry_idx = crumbs_handler_offset(ctx);
 
     crumbs_msg_init(reply, CALC_TYPE_ID, ctx->requested_opcode);
 
@@ -286,6 +285,27 @@ static void on_request_hist(crumbs_context_t *ctx, crumbs_message_t *reply)
     /* else data_len stays 0 — empty reply for non-existent entry */
 }
 
+/* ============================================================================
+ * Static Handler Tables
+ * ============================================================================ */
+
+/*
+ * The handler set never changes at runtime, so both tables are declared in
+ * flash (PROGMEM on AVR) and the RAM tables are compiled out with
+ * -DCRUMBS_MAX_HANDLERS=0 in platformio.ini. Entries must stay sorted by
+ * ascending opcode.
+ */
+CRUMBS_STATIC_HANDLERS(g_calc_handlers,
+                       {CALC_OP_ADD, handler_add, nullptr},
+                       {CALC_OP_SUB, handler_sub, nullptr},
+                       {CALC_OP_MUL, handler_mul, nullptr},
+                       {CALC_OP_DIV, handler_div, nullptr});
+
+CRUMBS_STATIC_REPLY_HANDLERS(g_calc_replies,
+                             {0, reply_handler_version, nullptr},
+                             {CALC_OP_GET_RESULT, reply_handler_get_result, nullptr},
+                             {CALC_OP_GET_HIST_META, reply_handler_get_hist_meta, nullptr});
+
 /* ============================================================================
  * Setup & Loop
  * ============================================================================ */
@@ -306,19 +326,18 @@ void setup()
     /* Initialize CRUMBS context */
     crumbs_arduino_init_peripheral(&ctx, PERIPHERAL_ADDR);
 
-    /* Register SET operation handlers */
-    crumbs_register_handler(&ctx, CALC_OP_ADD, handler_add, nullptr);
-    crumbs_register_handler(&ctx, CALC_OP_SUB, handler_sub, nullptr);
-    crumbs_register_handler(&ctx, CALC_OP_MUL, handler_mul, nullptr);
-    crumbs_register_handler(&ctx, CALC_OP_DIV, handler_div, nullptr);
-
-    /* Register GET operation reply handlers */
-    crumbs_register_reply_handler(&ctx, 0,                   reply_handler_version,       nullptr);
-    crumbs_register_reply_handler(&ctx, CALC_OP_GET_RESULT,  reply_handler_get_result,    nullptr);
-    crumbs_register_reply_handler(&ctx, CALC_OP_GET_HIST_META, reply_handler_get_hist_meta, nullptr);
+    /* Install SET and GET handler tables (flash-resident) */
+    if (crumbs_set_static_handlers(&ctx, g_calc_handlers,
+                                   CRUMBS_STATIC_TABLE_LEN(g_calc_handlers)) != 0 ||
+        crumbs_set_static_reply_handlers(&ctx, g_calc_replies,
+                                         CRUMBS_STATIC_TABLE_LEN(g_calc_replies)) != 0)
+    {
+        Serial.println("ERROR: handler tables not sorted by opcode");
+    }
 
-    /* History entry GETs fall through to on_request_hist (see comment above that function) */
-    crumbs_set_callbacks(&ctx, nullptr, on_request_hist, nullptr);
+    /* One reply range serves all history entry GETs */
+    crumbs_register_reply_handler_range(&ctx, CALC_OP_GET_HIST_0, CALC_OP_GET_HIST_0 + HISTORY_SIZE - 1,
+                                        reply_handler_get_hist, nullptr);
 
     Serial.println("Ready");
 }
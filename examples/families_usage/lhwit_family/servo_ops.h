@@ -10,19 +10,24 @@
  * - SET operations (0x01-0x03): Control servo positions and sweep modes
  * - GET operations (0x80-0x81): Query current positions and settings
  *
+ * Generated by scripts/generate_family.py from servo.json; edit the
+ * schema and regenerate instead of editing this file.
+ *
  * Commands:
- * - SERVO_OP_SET_POS:    Set servo position immediately
- * - SERVO_OP_SET_SPEED:  Set servo movement speed limit
- * - SERVO_OP_SWEEP:      Configure sweep pattern
- * - SERVO_OP_GET_POS:    Request current positions (via SET_REPLY)
- * - SERVO_OP_GET_SPEED:  Request speed limits (via SET_REPLY)
+ * - SERVO_OP_SET_POS: Set servo position immediately.
+ * - SERVO_OP_SET_SPEED: Set servo movement speed limit.
+ * - SERVO_OP_SWEEP: Configure servo sweep pattern.
+ * - SERVO_OP_GET_POS: Request current servo positions.
+ * - SERVO_OP_GET_SPEED: Request servo speed limits.
  */
 
 #ifndef SERVO_OPS_H
 #define SERVO_OPS_H
 
 #include "crumbs.h"
-#include "crumbs_message_helpers.h"
+#include "crumbs_ops.h"
+
+#include <string.h> /* memcpy */
 
 #ifdef __cplusplus
 extern "C"
@@ -33,7 +38,7 @@ extern "C"
  * Device Identity
  * ============================================================================ */
 
-/** @brief Type ID for servo controller device. */
+/** @brief Type ID for servo devices. */
 #define SERVO_TYPE_ID 0x02
 
 /* Module protocol version (per versioning.md convention) */
@@ -42,35 +47,44 @@ extern "C"
 #define SERVO_MODULE_VER_PATCH 0
 
 /* ============================================================================
- * Command Definitions: SET Operations (Control Servos)
+ * Command Definitions: SET Operations
  * ============================================================================ */
 
 /**
  * @brief Set servo position immediately.
  * Payload: [servo_idx:u8][position:u8]
- *   - servo_idx: Servo index (0-1 for D9-D10)
- *   - position: Target position (0-180 degrees)
+ *   - servo_idx: Servo index (0-1 for D9-D10).
+ *   - position: Target position (0-180 degrees).
  */
 #define SERVO_OP_SET_POS 0x01
+/** @brief Payload bytes of SERVO_OP_SET_POS. */
+#define SERVO_OP_SET_POS_LEN 2u
+CRUMBS_STATIC_ASSERT(SERVO_OP_SET_POS_LEN <= CRUMBS_MAX_PAYLOAD, servo_set_pos_fits);
 
 /**
  * @brief Set servo movement speed limit.
  * Payload: [servo_idx:u8][speed:u8]
- *   - servo_idx: Servo index (0-1)
- *   - speed: Degrees per update (0=instant, 1-20=limited speed)
+ *   - servo_idx: Servo index (0-1).
+ *   - speed: Degrees per update (0=instant, 1-20=limited speed).
  */
 #define SERVO_OP_SET_SPEED 0x02
+/** @brief Payload bytes of SERVO_OP_SET_SPEED. */
+#define SERVO_OP_SET_SPEED_LEN 2u
+CRUMBS_STATIC_ASSERT(SERVO_OP_SET_SPEED_LEN <= CRUMBS_MAX_PAYLOAD, servo_set_speed_fits);
 
 /**
  * @brief Configure servo sweep pattern.
  * Payload: [servo_idx:u8][enable:u8][min_pos:u8][max_pos:u8][step:u8]
- *   - servo_idx: Servo index (0-1)
- *   - enable: 0=disable sweep, 1=enable sweep
- *   - min_pos: Minimum position (0-180 degrees)
- *   - max_pos: Maximum position (0-180 degrees)
- *   - step: Degrees to move per sweep update
+ *   - servo_idx: Servo index (0-1).
+ *   - enable: 0=disable sweep, 1=enable sweep.
+ *   - min_pos: Minimum position (0-180 degrees).
+ *   - max_pos: Maximum position (0-180 degrees).
+ *   - step: Degrees to move per sweep update.
  */
 #define SERVO_OP_SWEEP 0x03
+/** @brief Payload bytes of SERVO_OP_SWEEP. */
+#define SERVO_OP_SWEEP_LEN 5u
+CRUMBS_STATIC_ASSERT(SERVO_OP_SWEEP_LEN <= CRUMBS_MAX_PAYLOAD, servo_sweep_fits);
 
 /* ============================================================================
  * Command Definitions: GET Operations (Query State via SET_REPLY)
@@ -79,27 +93,49 @@ extern "C"
 /**
  * @brief Request current servo positions.
  * Payload: none
- * Reply: [pos0:u8][pos1:u8] (current positions in degrees)
+ * Reply: [pos:u8[2]]
+ *   - pos: Current positions in degrees, indexed by servo (0-1).
  */
 #define SERVO_OP_GET_POS 0x80
+/** @brief Reply payload bytes of SERVO_OP_GET_POS. */
+#define SERVO_OP_GET_POS_LEN 2u
+CRUMBS_STATIC_ASSERT(SERVO_OP_GET_POS_LEN <= CRUMBS_MAX_PAYLOAD, servo_pos_fits);
 
 /**
  * @brief Request servo speed limits.
  * Payload: none
- * Reply: [speed0:u8][speed1:u8] (speed limits in degrees/update)
+ * Reply: [speed:u8[2]]
+ *   - speed: Speed limits in degrees/update, indexed by servo (0-1).
  */
 #define SERVO_OP_GET_SPEED 0x81
+/** @brief Reply payload bytes of SERVO_OP_GET_SPEED. */
+#define SERVO_OP_GET_SPEED_LEN 2u
+CRUMBS_STATIC_ASSERT(SERVO_OP_GET_SPEED_LEN <= CRUMBS_MAX_PAYLOAD, servo_speed_fits);
 
     /* ============================================================================
      * Controller Side: Command Senders
      * ============================================================================ */
 
     /**
-     * @brief Set servo position.
+     * @brief Pack SERVO_OP_SET_POS into @p m (no bounds checks needed).
+     */
+    static inline void servo_pack_set_pos(crumbs_message_t *m,
+                                          uint8_t servo_idx,
+                                          uint8_t position)
+    {
+        m->type_id = SERVO_TYPE_ID;
+        m->opcode = SERVO_OP_SET_POS;
+        m->data_len = (uint8_t)SERVO_OP_SET_POS_LEN;
+        m->data[0] = (uint8_t)servo_idx;
+        m->data[1] = (uint8_t)position;
+    }
+
+    /**
+     * @brief Set servo position immediately.
      *
-     * @param dev       Bound device handle (see crumbs_device_t).
-     * @param servo_idx Servo index (0-1).
-     * @param position  Target position (0-180 degrees).
+     * @param dev Bound device handle (see crumbs_device_t).
+     * @param servo_idx Servo index (0-1 for D9-D10).
+     * @param position Target position (0-180 degrees).
      * @return 0 on success, non-zero on error.
      */
     static inline int servo_send_set_pos(const crumbs_device_t *dev,
@@ -107,18 +143,30 @@ extern "C"
                                          uint8_t position)
     {
         crumbs_message_t msg;
-        crumbs_msg_init(&msg, SERVO_TYPE_ID, SERVO_OP_SET_POS);
-        crumbs_msg_add_u8(&msg, servo_idx);
-        crumbs_msg_add_u8(&msg, position);
+        servo_pack_set_pos(&msg, servo_idx, position);
         return crumbs_controller_send(dev->ctx, dev->addr, &msg, dev->write_fn, dev->io);
     }
 
+    /**
+     * @brief Pack SERVO_OP_SET_SPEED into @p m (no bounds checks needed).
+     */
+    static inline void servo_pack_set_speed(crumbs_message_t *m,
+                                            uint8_t servo_idx,
+                                            uint8_t speed)
+    {
+        m->type_id = SERVO_TYPE_ID;
+        m->opcode = SERVO_OP_SET_SPEED;
+        m->data_len = (uint8_t)SERVO_OP_SET_SPEED_LEN;
+        m->data[0] = (uint8_t)servo_idx;
+        m->data[1] = (uint8_t)speed;
+    }
+
     /**
      * @brief Set servo movement speed limit.
      *
-     * @param dev       Bound device handle (see crumbs_device_t).
+     * @param dev Bound device handle (see crumbs_device_t).
      * @param servo_idx Servo index (0-1).
-     * @param speed     Speed limit (0=instant, 1-20=limited).
+     * @param speed Degrees per update (0=instant, 1-20=limited speed).
      * @return 0 on success, non-zero on error.
      */
     static inline int servo_send_set_speed(const crumbs_device_t *dev,
@@ -126,21 +174,39 @@ extern "C"
                                            uint8_t speed)
     {
         crumbs_message_t msg;
-        crumbs_msg_init(&msg, SERVO_TYPE_ID, SERVO_OP_SET_SPEED);
-        crumbs_msg_add_u8(&msg, servo_idx);
-        crumbs_msg_add_u8(&msg, speed);
+        servo_pack_set_speed(&msg, servo_idx, speed);
         return crumbs_controller_send(dev->ctx, dev->addr, &msg, dev->write_fn, dev->io);
     }
 
+    /**
+     * @brief Pack SERVO_OP_SWEEP into @p m (no bounds checks needed).
+     */
+    static inline void servo_pack_sweep(crumbs_message_t *m,
+                                        uint8_t servo_idx,
+                                        uint8_t enable,
+                                        uint8_t min_pos,
+                                        uint8_t max_pos,
+                                        uint8_t step)
+    {
+        m->type_id = SERVO_TYPE_ID;
+        m->opcode = SERVO_OP_SWEEP;
+        m->data_len = (uint8_t)SERVO_OP_SWEEP_LEN;
+        m->data[0] = (uint8_t)servo_idx;
+        m->data[1] = (uint8_t)enable;
+        m->data[2] = (uint8_t)min_pos;
+        m->data[3] = (uint8_t)max_pos;
+        m->data[4] = (uint8_t)step;
+    }
+
     /**
      * @brief Configure servo sweep pattern.
      *
-     * @param dev       Bound device handle (see crumbs_device_t).
+     * @param dev Bound device handle (see crumbs_device_t).
      * @param servo_idx Servo index (0-1).
-     * @param enable    Enable sweep (0=OFF, 1=ON).
-     * @param min_pos   Minimum position (0-180 degrees).
-     * @param max_pos   Maximum position (0-180 degrees).
-     * @param step      Step size (degrees per update).
+     * @param enable 0=disable sweep, 1=enable sweep.
+     * @param min_pos Minimum position (0-180 degrees).
+     * @param max_pos Maximum position (0-180 degrees).
+     * @param step Degrees to move per sweep update.
      * @return 0 on success, non-zero on error.
      */
     static inline int servo_send_sweep(const crumbs_device_t *dev,
@@ -151,125 +217,177 @@ extern "C"
                                        uint8_t step)
     {
         crumbs_message_t msg;
-        crumbs_msg_init(&msg, SERVO_TYPE_ID, SERVO_OP_SWEEP);
-        crumbs_msg_add_u8(&msg, servo_idx);
-        crumbs_msg_add_u8(&msg, enable);
-        crumbs_msg_add_u8(&msg, min_pos);
-        crumbs_msg_add_u8(&msg, max_pos);
-        crumbs_msg_add_u8(&msg, step);
+        servo_pack_sweep(&msg, servo_idx, enable, min_pos, max_pos, step);
         return crumbs_controller_send(dev->ctx, dev->addr, &msg, dev->write_fn, dev->io);
     }
 
+    /* ============================================================================
+     * Controller Side: Combined Query + Read (Receiver API)
+     * ============================================================================ */
+
     /**
-     * @brief Query current servo positions (peripheral will respond on next I2C read).
-     *
-     * @internal Used by servo_get_pos(); prefer that function for combined query+read.
+     * @brief Result struct for SERVO_OP_GET_POS.
+     */
+    typedef struct
+    {
+        uint8_t pos[2]; /**< Current positions in degrees, indexed by servo (0-1). */
+    } servo_pos_result_t;
+
+    /**
+     * @brief Parse a SERVO_OP_GET_POS reply payload (one length check).
      *
-     * @param dev  Bound device handle (see crumbs_device_t).
-     * @return 0 on success, non-zero on error.
+     * @return 0 on success, -1 if @p len is short or a pointer is NULL.
      */
-    static inline int servo_query_pos(const crumbs_device_t *dev)
+    static inline int servo_parse_pos(const uint8_t *data,
+                                      size_t len,
+                                      servo_pos_result_t *out)
     {
-        crumbs_message_t msg;
-        crumbs_msg_init(&msg, 0, CRUMBS_CMD_SET_REPLY);
-        crumbs_msg_add_u8(&msg, SERVO_OP_GET_POS);
-        return crumbs_controller_send(dev->ctx, dev->addr, &msg, dev->write_fn, dev->io);
+        if (!data || !out || len < SERVO_OP_GET_POS_LEN)
+            return -1;
+        out->pos[0] = (uint8_t)data[0];
+        out->pos[1] = (uint8_t)data[1];
+        return 0;
     }
 
+    CRUMBS_DEFINE_GET_OP_LEN(servo, pos, SERVO_TYPE_ID, SERVO_OP_GET_POS,
+                             servo_pos_result_t, servo_parse_pos, SERVO_OP_GET_POS_LEN)
+
     /**
-     * @brief Query servo speed limits (peripheral will respond on next I2C read).
-     *
-     * @internal Used by servo_get_speed(); prefer that function for combined query+read.
+     * @brief Result struct for SERVO_OP_GET_SPEED.
+     */
+    typedef struct
+    {
+        uint8_t speed[2]; /**< Speed limits in degrees/update, indexed by servo (0-1). */
+    } servo_speed_result_t;
+
+    /**
+     * @brief Parse a SERVO_OP_GET_SPEED reply payload (one length check).
      *
-     * @param dev  Bound device handle (see crumbs_device_t).
-     * @return 0 on success, non-zero on error.
+     * @return 0 on success, -1 if @p len is short or a pointer is NULL.
      */
-    static inline int servo_query_speed(const crumbs_device_t *dev)
+    static inline int servo_parse_speed(const uint8_t *data,
+                                        size_t len,
+                                        servo_speed_result_t *out)
     {
-        crumbs_message_t msg;
-        crumbs_msg_init(&msg, 0, CRUMBS_CMD_SET_REPLY);
-        crumbs_msg_add_u8(&msg, SERVO_OP_GET_SPEED);
-        return crumbs_controller_send(dev->ctx, dev->addr, &msg, dev->write_fn, dev->io);
+        if (!data || !out || len < SERVO_OP_GET_SPEED_LEN)
+            return -1;
+        out->speed[0] = (uint8_t)data[0];
+        out->speed[1] = (uint8_t)data[1];
+        return 0;
     }
 
+    CRUMBS_DEFINE_GET_OP_LEN(servo, speed, SERVO_TYPE_ID, SERVO_OP_GET_SPEED,
+                             servo_speed_result_t, servo_parse_speed, SERVO_OP_GET_SPEED_LEN)
+
     /* ============================================================================
-     * Controller Side: Combined Query + Read (Receiver API)
+     * Peripheral Side: Payload Decoders and Reply Builders
      * ============================================================================ */
 
     /**
-     * @brief Result struct for SERVO_OP_GET_POS.
-     *
-     * Current position of each servo in degrees (0-180).
+     * @brief Decoded SERVO_OP_SET_POS payload.
      */
     typedef struct
     {
-        uint8_t pos[2]; /**< Current positions in degrees, indexed by servo (0-1). */
-    } servo_pos_result_t;
+        uint8_t servo_idx; /**< Servo index (0-1 for D9-D10). */
+        uint8_t position;  /**< Target position (0-180 degrees). */
+    } servo_set_pos_args_t;
 
     /**
-     * @brief Result struct for SERVO_OP_GET_SPEED.
+     * @brief Decode a SERVO_OP_SET_POS payload in a command handler (one length check).
      *
-     * Speed limit of each servo in degrees/update (0=instant).
+     * @return 0 on success, -1 if @p len is short or a pointer is NULL.
+     */
+    static inline int servo_unpack_set_pos(const uint8_t *data,
+                                           uint8_t len,
+                                           servo_set_pos_args_t *out)
+    {
+        if (!data || !out || len < SERVO_OP_SET_POS_LEN)
+            return -1;
+        out->servo_idx = (uint8_t)data[0];
+        out->position = (uint8_t)data[1];
+        return 0;
+    }
+
+    /**
+     * @brief Decoded SERVO_OP_SET_SPEED payload.
      */
     typedef struct
     {
-        uint8_t speed[2]; /**< Speed limits, indexed by servo (0-1). */
-    } servo_speed_result_t;
+        uint8_t servo_idx; /**< Servo index (0-1). */
+        uint8_t speed;     /**< Degrees per update (0=instant, 1-20=limited speed). */
+    } servo_set_speed_args_t;
 
     /**
-     * @brief Combined SET_REPLY query + read + parse for servo positions.
+     * @brief Decode a SERVO_OP_SET_SPEED payload in a command handler (one length check).
      *
-     * @param dev  Bound device handle (see crumbs_device_t).
-     * @param out  Output struct (must not be NULL).
-     * @return 0 on success, non-zero on error.
+     * @return 0 on success, -1 if @p len is short or a pointer is NULL.
      */
-    static inline int servo_get_pos(const crumbs_device_t *dev, servo_pos_result_t *out)
+    static inline int servo_unpack_set_speed(const uint8_t *data,
+                                             uint8_t len,
+                                             servo_set_speed_args_t *out)
     {
-        crumbs_message_t reply;
-        int rc;
-        if (!out)
-            return -1;
-        rc = servo_query_pos(dev);
-        if (rc != 0)
-            return rc;
-        dev->delay_fn(CRUMBS_DEFAULT_QUERY_DELAY_US);
-        rc = crumbs_controller_read(dev->ctx, dev->addr, &reply, dev->read_fn, dev->io);
-        if (rc != 0)
-            return rc;
-        if (reply.type_id != SERVO_TYPE_ID || reply.opcode != SERVO_OP_GET_POS)
+        if (!data || !out || len < SERVO_OP_SET_SPEED_LEN)
             return -1;
-        rc = crumbs_msg_read_u8(reply.data, reply.data_len, 0, &out->pos[0]);
-        if (rc != 0)
-            return rc;
-        return crumbs_msg_read_u8(reply.data, reply.data_len, 1, &out->pos[1]);
+        out->servo_idx = (uint8_t)data[0];
+        out->speed = (uint8_t)data[1];
+        return 0;
     }
 
     /**
-     * @brief Combined SET_REPLY query + read + parse for servo speed limits.
+     * @brief Decoded SERVO_OP_SWEEP payload.
+     */
+    typedef struct
+    {
+        uint8_t servo_idx; /**< Servo index (0-1). */
+        uint8_t enable;    /**< 0=disable sweep, 1=enable sweep. */
+        uint8_t min_pos;   /**< Minimum position (0-180 degrees). */
+        uint8_t max_pos;   /**< Maximum position (0-180 degrees). */
+        uint8_t step;      /**< Degrees to move per sweep update. */
+    } servo_sweep_args_t;
+
+    /**
+     * @brief Decode a SERVO_OP_SWEEP payload in a command handler (one length check).
      *
-     * @param dev  Bound device handle (see crumbs_device_t).
-     * @param out  Output struct (must not be NULL).
-     * @return 0 on success, non-zero on error.
+     * @return 0 on success, -1 if @p len is short or a pointer is NULL.
      */
-    static inline int servo_get_speed(const crumbs_device_t *dev, servo_speed_result_t *out)
+    static inline int servo_unpack_sweep(const uint8_t *data,
+                                         uint8_t len,
+                                         servo_sweep_args_t *out)
     {
-        crumbs_message_t reply;
-        int rc;
-        if (!out)
-            return -1;
-        rc = servo_query_speed(dev);
-        if (rc != 0)
-            return rc;
-        dev->delay_fn(CRUMBS_DEFAULT_QUERY_DELAY_US);
-        rc = crumbs_controller_read(dev->ctx, dev->addr, &reply, dev->read_fn, dev->io);
-        if (rc != 0)
-            return rc;
-        if (reply.type_id != SERVO_TYPE_ID || reply.opcode != SERVO_OP_GET_SPEED)
+        if (!data || !out || len < SERVO_OP_SWEEP_LEN)
             return -1;
-        rc = crumbs_msg_read_u8(reply.data, reply.data_len, 0, &out->speed[0]);
-        if (rc != 0)
-            return rc;
-        return crumbs_msg_read_u8(reply.data, reply.data_len, 1, &out->speed[1]);
+        out->servo_idx = (uint8_t)data[0];
+        out->enable = (uint8_t)data[1];
+        out->min_pos = (uint8_t)data[2];
+        out->max_pos = (uint8_t)data[3];
+        out->step = (uint8_t)data[4];
+        return 0;
+    }
+
+    /**
+     * @brief Fill a SERVO_OP_GET_POS reply from a reply handler.
+     */
+    static inline void servo_reply_pos(crumbs_message_t *reply,
+                                       const servo_pos_result_t *v)
+    {
+        reply->type_id = SERVO_TYPE_ID;
+        reply->opcode = SERVO_OP_GET_POS;
+        reply->data_len = (uint8_t)SERVO_OP_GET_POS_LEN;
+        reply->data[0] = (uint8_t)v->pos[0];
+        reply->data[1] = (uint8_t)v->pos[1];
+    }
+
+    /**
+     * @brief Fill a SERVO_OP_GET_SPEED reply from a reply handler.
+     */
+    static inline void servo_reply_speed(crumbs_message_t *reply,
+                                         const servo_speed_result_t *v)
+    {
+        reply->type_id = SERVO_TYPE_ID;
+        reply->opcode = SERVO_OP_GET_SPEED;
+        reply->data_len = (uint8_t)SERVO_OP_GET_SPEED_LEN;
+        reply->data[0] = (uint8_t)v->speed[0];
+        reply->data[1] = (uint8_t)v->speed[1];
     }
 
 #ifdef __cplusplus
@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""Compare two crumbs_bench JSON files and flag regressions.
+
+Each result is matched by benchmark name and parameter value. A result is a
+regression when the new time per operation is more than --threshold percent
+above the baseline. Results present in only one file are listed but never
+fail the comparison.
+
+Usage:
+  ./build/crumbs_bench baseline.json
+  # ... change code, rebuild ...
+  ./build/crumbs_bench current.json
+  python scripts/bench_compare.py baseline.json current.json --threshold 15
+
+Exit status is 1 if any result regressed, 0 otherwise.
+"""
+
+from __future__ import annotations
+
+import argparse
+import json
+import sys
+from pathlib import Path
+
+
+def load(path: Path) -> tuple[dict, dict[tuple, float]]:
+    doc = json.loads(path.read_text())
+    results = {}
+    for r in doc.get("results", []):
+        params = tuple(sorted((k, v) for k, v in r.items() if k not in ("bench", "ns", "ops_per_sec")))
+        results[(r["bench"], params)] = float(r["ns"])
+    return doc, results
+
+
+def label(key: tuple) -> str:
+    bench, params = key
+    return bench + "".join(f" {k}={v}" for k, v in params)
+
+
+def main(argv: list[str]) -> int:
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("baseline", type=Path)
+    ap.add_argument("current", type=Path)
+    ap.add_argument("--threshold", type=float, default=10.0, help="allowed slowdown in percent (default 10)")
+    args = ap.parse_args(argv)
+
+    base_doc, base = load(args.baseline)
+    cur_doc, cur = load(args.current)
+
+    if base_doc.get("config") != cur_doc.get("config"):
+        print("note: build configurations differ:")
+        print(f"  baseline: {base_doc.get('config')}")
+        print(f"  current:  {cur_doc.get('config')}")
+
+    regressions = 0
+    width = max((len(label(k)) for k in base.keys() | cur.keys()), default=0)
+    for key in sorted(base.keys() | cur.keys()):
+        if key not in base or key not in cur:
+            where = "baseline" if key in base else "current"
+            print(f"{label(key):<{width}}  only in {where}")
+            continue
+        old, new = base[key], cur[key]
+        change = (new - old) / old * 100.0 if old > 0.0 else 0.0
+        mark = ""
+        if change > args.threshold:
+            mark = "  REGRESSION"
+            regressions += 1
+        print(f"{label(key):<{width}}  {old:10.2f} -> {new:10.2f} ns  {change:+6.1f}%{mark}")
+
+    if regressions:
+        print(f"{regressions} result(s) slower than {args.threshold:g}%")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
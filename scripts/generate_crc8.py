@@ -20,6 +20,10 @@ Usage examples:
 
   # generate all variants and stage all into src/crc
   python scripts/generate_crc8.py --algos bit,nibble,nibblem,byte
+
+  # regenerate src/crc/crc8_tables.c (byte + slice-by-N tables used by the
+  # CRUMBS_CRC_BACKEND_BYTE/SLICE4/SLICE8 back ends; does not need pycrc)
+  python scripts/generate_crc8.py --tables
 """
 
 from __future__ import annotations
@@ -39,6 +43,10 @@ SRC_CRC_DIR = REPO_ROOT / "src" / "crc"
 # Available algorithm tokens and flags passed through to `pycrc`
 MODEL = "crc-8"
 ALL_ALGOS = ["bit", "nibble", "nibblem", "byte"]
+POLY = 0x07  # must match MODEL
+SLICE_TABLES = 8
+TABLES_OUT = SRC_CRC_DIR / "crc8_tables.c"
+
 ALGO_FLAGS = {
     "bit": ["--algorithm", "bit-by-bit-fast"],
     "nibble": ["--algorithm", "table-driven", "--table-idx-width", "4"],
@@ -132,6 +140,57 @@ def stage_variants(algos: Iterable[str]) -> int:
     return 0
 
 
+def crc8_slice_tables(count: int) -> list[list[int]]:
+    """Return slice-by-N tables: tables[k][x] is the CRC of x followed by k zero bytes."""
+    t0 = []
+    for x in range(256):
+        crc = x
+        for _ in range(8):
+            crc = ((crc << 1) ^ POLY) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+        t0.append(crc)
+    tables = [t0]
+    for _ in range(1, count):
+        tables.append([t0[v] for v in tables[-1]])
+    return tables
+
+
+def write_tables() -> None:
+    """Emit src/crc/crc8_tables.c with the byte and slice-by-N tables."""
+    tables = crc8_slice_tables(SLICE_TABLES)
+    out = [
+        "/**",
+        " * @file",
+        " * @brief CRC-8 lookup tables for the byte and slice-by-N back ends.",
+        " *",
+        " * Generated by scripts/generate_crc8.py --tables; do not edit by hand.",
+        " * Poly 0x%02X, init 0x00, no reflection, no final XOR." % POLY,
+        " *",
+        " * crumbs_crc8_tables[k][x] is the CRC of byte x followed by k zero bytes.",
+        " * Only the tables the selected CRUMBS_CRC_BACKEND needs are emitted.",
+        " */",
+        "",
+        '#include "crumbs_crc_backends.h"',
+        "",
+        "#if CRUMBS_CRC8_TABLE_COUNT > 0",
+        "",
+        "const uint8_t crumbs_crc8_tables[CRUMBS_CRC8_TABLE_COUNT][256] CRUMBS_CRC8_TABLE_ATTR = {",
+    ]
+    for k, table in enumerate(tables):
+        if k == 1:
+            out.append("#if CRUMBS_CRC8_TABLE_COUNT > 1")
+        if k == 4:
+            out.append("#endif")
+            out.append("#if CRUMBS_CRC8_TABLE_COUNT > 4")
+        out.append("    {")
+        for row in range(0, 256, 16):
+            out.append("        " + ", ".join("0x%02X" % v for v in table[row:row + 16]) + ",")
+        out.append("    },")
+    out.append("#endif")
+    out += ["};", "", "#endif /* CRUMBS_CRC8_TABLE_COUNT > 0 */", ""]
+    TABLES_OUT.write_text("\n".join(out))
+    print(f"Wrote {TABLES_OUT}")
+
+
 def parse_algos_arg(val: str | None) -> list[str]:
     if not val:
         return ["nibble"]  # default to nibble to match current project usage
@@ -164,8 +223,18 @@ def main() -> None:
         help="Generate outputs under dist/crc/c99 but do not stage into src/crc",
     )
 
+    parser.add_argument(
+        "--tables",
+        action="store_true",
+        help="Write src/crc/crc8_tables.c (byte/slice-by-N tables) and exit",
+    )
+
     args = parser.parse_args()
 
+    if args.tables:
+        write_tables()
+        return
+
     algos = parse_algos_arg(args.algos)
 
     print("Generating C99 CRC-8 variants into:", C99_DIR)
@@ -0,0 +1,605 @@
+#!/usr/bin/env python3
+"""Generate a CRUMBS family ops header from a JSON/YAML schema.
+
+Hand-written ops headers pack payloads with one crumbs_msg_add_*() call per
+field, and every call re-checks data_len against CRUMBS_MAX_PAYLOAD. A
+schema fixes each payload's layout up front, so the generated code can:
+
+- define PREFIX_OP_<NAME>_LEN for every payload and static-assert that it
+  fits in CRUMBS_MAX_PAYLOAD (a bad schema fails the build, not the bus)
+- pack with straight-line stores at constant offsets (no per-field checks)
+- parse with a single length check per message
+
+The same schema gives both sides of the contract:
+
+- controller: family_send_<op>() for SETs, and the CRUMBS_DEFINE_GET_OP_LEN
+  set (family_get_<op>(), _ready, _combined, family_request_<op>()) for
+  GETs, reading only 4 + reply length bytes
+- peripheral: family_unpack_<op>() for SET handlers and
+  family_reply_<op>() for reply handlers; --stubs writes a handler
+  skeleton with a family_register_handlers() function
+
+Schema (JSON, or YAML when PyYAML is installed):
+
+  {
+    "family": "servo",              # C token prefix
+    "prefix": "SERVO",              # macro prefix (default: family upper-cased)
+    "type_id": "0x02",
+    "version": [1, 0, 0],           # module protocol version
+    "brief": "Servo control command definitions (Type ID 0x02)",
+    "description": ["Free text lines for the file comment."],
+    "ops": [
+      {"kind": "set", "name": "set_pos", "opcode": "0x01",
+       "brief": "Set servo position immediately.",
+       "fields": [{"name": "servo_idx", "type": "u8", "doc": "Servo index (0-1)"},
+                  {"name": "position", "type": "u8", "doc": "Degrees (0-180)"}]},
+      {"kind": "get", "name": "pos", "opcode": "0x80",
+       "brief": "Request current servo positions.",
+       "reply": [{"name": "pos", "type": "u8", "count": 2, "doc": "Degrees"}]}
+    ]
+  }
+
+Field types: u8, i8, u16, i16, u32, i32 (little-endian) and float (native
+order, as crumbs_msg_add_float()). "count" makes a fixed-size array. SET
+opcode macros are PREFIX_OP_<NAME>, GET macros PREFIX_OP_GET_<NAME>;
+"const" overrides the part after PREFIX_OP_. GETs carry no request payload.
+
+Usage:
+  # write servo_ops.h next to the schema
+  python scripts/generate_family.py examples/families_usage/lhwit_family/servo.json
+
+  # also write a peripheral handler skeleton
+  python scripts/generate_family.py servo.json --stubs servo/src/servo_handlers.c
+
+  # fail if the committed header is out of date (used by ctest)
+  python scripts/generate_family.py servo.json --check
+"""
+
+from __future__ import annotations
+
+import argparse
+import json
+import re
+import sys
+from dataclasses import dataclass
+from pathlib import Path
+from typing import Dict, List
+
+MAX_PAYLOAD = 27
+
+# type -> (C type, size, signed)
+TYPES: Dict[str, tuple] = {
+    "u8": ("uint8_t", 1, False),
+    "i8": ("int8_t", 1, True),
+    "u16": ("uint16_t", 2, False),
+    "i16": ("int16_t", 2, True),
+    "u32": ("uint32_t", 4, False),
+    "i32": ("int32_t", 4, True),
+    "float": ("float", 4, False),
+}
+
+IDENT = re.compile(r"^[A-Za-z_][A-Za-z0-9_]*$")
+
+
+class SchemaError(Exception):
+    pass
+
+
+@dataclass
+class Field:
+    name: str
+    type: str
+    count: int
+    doc: str
+
+    @property
+    def ctype(self) -> str:
+        return TYPES[self.type][0]
+
+    @property
+    def size(self) -> int:
+        return TYPES[self.type][1] * self.count
+
+    def wire(self) -> str:
+        suffix = f"[{self.count}]" if self.count > 1 else ""
+        return f"[{self.name}:{self.type}{suffix}]"
+
+
+@dataclass
+class Op:
+    kind: str
+    name: str
+    opcode: int
+    const: str
+    brief: str
+    fields: List[Field]
+
+    @property
+    def size(self) -> int:
+        return sum(f.size for f in self.fields)
+
+
+@dataclass
+class Family:
+    family: str
+    prefix: str
+    type_id: int
+    version: List[int]
+    brief: str
+    description: List[str]
+    ops: List[Op]
+    source: str
+
+
+# ---- Schema loading ---------------------------------------------------------
+
+
+def parse_int(value, what: str) -> int:
+    if isinstance(value, int):
+        return value
+    try:
+        return int(str(value), 0)
+    except ValueError:
+        raise SchemaError(f"{what}: not an integer: {value!r}")
+
+
+def load_fields(raw, where: str) -> List[Field]:
+    fields = []
+    seen = set()
+    for i, f in enumerate(raw or []):
+        name = f.get("name", "")
+        if not IDENT.match(name) or name in seen:
+            raise SchemaError(f"{where} field {i}: bad or duplicate name {name!r}")
+        seen.add(name)
+        ftype = f.get("type", "")
+        if ftype not in TYPES:
+            raise SchemaError(f"{where}.{name}: unknown type {ftype!r} (use {', '.join(TYPES)})")
+        count = parse_int(f.get("count", 1), f"{where}.{name}.count")
+        if count < 1:
+            raise SchemaError(f"{where}.{name}: count must be >= 1")
+        fields.append(Field(name, ftype, count, f.get("doc", "")))
+    return fields
+
+
+def load_schema(path: Path) -> Family:
+    text = path.read_text(encoding="utf-8")
+    if path.suffix in (".yaml", ".yml"):
+        try:
+            import yaml  # type: ignore
+        except ImportError:
+            raise SchemaError("YAML schemas need PyYAML (pip install pyyaml); JSON works without it")
+        raw = yaml.safe_load(text)
+    else:
+        raw = json.loads(text)
+
+    family = raw.get("family", "")
+    if not IDENT.match(family):
+        raise SchemaError(f"family: not a C identifier: {family!r}")
+    prefix = raw.get("prefix", family.upper())
+    version = list(raw.get("version", [1, 0, 0]))
+    if len(version) != 3:
+        raise SchemaError("version: expected [major, minor, patch]")
+
+    ops = []
+    opcodes = {}
+    for i, o in enumerate(raw.get("ops", [])):
+        kind = o.get("kind", "")
+        name = o.get("name", "")
+        where = f"ops[{i}] {name}"
+        if kind not in ("set", "get"):
+            raise SchemaError(f"{where}: kind must be 'set' or 'get'")
+        if not IDENT.match(name):
+            raise SchemaError(f"{where}: name is not a C identifier")
+        opcode = parse_int(o.get("opcode"), f"{where}.opcode")
+        if not 0 <= opcode <= 0xEF:
+            raise SchemaError(f"{where}: opcode 0x{opcode:02X} is outside 0x00-0xEF (0xF0+ is reserved)")
+        if opcode in opcodes:
+            raise SchemaError(f"{where}: opcode 0x{opcode:02X} already used by {opcodes[opcode]}")
+        opcodes[opcode] = name
+        if kind == "get" and o.get("fields"):
+            raise SchemaError(f"{where}: GET ops carry no request payload")
+        fields = load_fields(o.get("fields") if kind == "set" else o.get("reply"), where)
+        default_const = name.upper() if kind == "set" else "GET_" + name.upper()
+        op = Op(kind, name, opcode, o.get("const", default_const), o.get("brief", ""), fields)
+        # Checked here for a readable message; the header static-asserts it too.
+        if op.size > MAX_PAYLOAD:
+            raise SchemaError(f"{where}: payload is {op.size} bytes, more than {MAX_PAYLOAD}")
+        ops.append(op)
+
+    return Family(
+        family=family,
+        prefix=prefix,
+        type_id=parse_int(raw.get("type_id"), "type_id"),
+        version=[parse_int(v, "version") for v in version],
+        brief=raw.get("brief", f"{family} command definitions"),
+        description=list(raw.get("description", [])),
+        ops=ops,
+        source=path.name,
+    )
+
+
+# ---- Code fragments ---------------------------------------------------------
+
+
+def store(ftype: str, dst: str, off: int, val: str) -> List[str]:
+    """Straight-line stores of one value at a constant offset."""
+    size = TYPES[ftype][1]
+    if ftype == "float":
+        return [f"memcpy(&{dst}[{off}], &{val}, sizeof(float));"]
+    if size == 1:
+        return [f"{dst}[{off}] = (uint8_t){val};"]
+    utype = "uint16_t" if size == 2 else "uint32_t"
+    src = val if ftype.startswith("u") else f"({utype}){val}"
+    lines = [f"{dst}[{off}] = (uint8_t)({src} & 0xFFu);"]
+    for b in range(1, size):
+        lines.append(f"{dst}[{off + b}] = (uint8_t)({src} >> {8 * b});")
+    return lines
+
+
+def load(ftype: str, src: str, off: int, dst: str) -> List[str]:
+    """Straight-line load of one value from a constant offset."""
+    ctype, size, _ = TYPES[ftype]
+    if ftype == "float":
+        return [f"memcpy(&{dst}, &{src}[{off}], sizeof(float));"]
+    if size == 1:
+        return [f"{dst} = ({ctype}){src}[{off}];"]
+    utype = "uint16_t" if size == 2 else "uint32_t"
+    parts = [f"(({utype}){src}[{off + b}] << {8 * b})" if b else f"({utype}){src}[{off}]" for b in range(size)]
+    return [f"{dst} = ({ctype})({' | '.join(parts)});"]
+
+
+def field_stores(fields: List[Field], dst: str, val_prefix: str) -> List[str]:
+    lines = []
+    off = 0
+    for f in fields:
+        step = TYPES[f.type][1]
+        for k in range(f.count):
+            val = val_prefix + f.name + (f"[{k}]" if f.count > 1 else "")
+            lines += store(f.type, dst, off, val)
+            off += step
+    return lines
+
+
+def field_loads(fields: List[Field], src: str, dst_prefix: str) -> List[str]:
+    lines = []
+    off = 0
+    for f in fields:
+        step = TYPES[f.type][1]
+        for k in range(f.count):
+            dst = dst_prefix + f.name + (f"[{k}]" if f.count > 1 else "")
+            lines += load(f.type, src, off, dst)
+            off += step
+    return lines
+
+
+def length_check(o: "Op", P: str, indent: str) -> List[str]:
+    """The one bounds check a decoder makes."""
+    if not o.fields:
+        return [f"{indent}    (void)data;", f"{indent}    (void)len;",
+                f"{indent}    if (!out)", f"{indent}        return -1;"]
+    return [f"{indent}    if (!data || !out || len < {P}_OP_{o.const}_LEN)", f"{indent}        return -1;"]
+
+
+def payload_doc(fields: List[Field]) -> str:
+    return "".join(f.wire() for f in fields) if fields else "none"
+
+
+def struct_members(fields: List[Field], indent: str) -> List[str]:
+    decls = []
+    for f in fields:
+        arr = f"[{f.count}]" if f.count > 1 else ""
+        decls.append((f"{f.ctype} {f.name}{arr};", f.doc))
+    width = max(len(d) for d, _ in decls)
+    return [f"{indent}{d.ljust(width)} /**< {doc} */" if doc else f"{indent}{d}" for d, doc in decls]
+
+
+def params(fields: List[Field]) -> List[str]:
+    out = []
+    for f in fields:
+        if f.count > 1:
+            out.append(f"const {f.ctype} {f.name}[{f.count}]")
+        else:
+            out.append(f"{f.ctype} {f.name}")
+    return out
+
+
+def signature(ret: str, name: str, args: List[str], indent: str) -> List[str]:
+    head = f"{indent}static inline {ret} {name}("
+    if len(args) <= 1:
+        return [head + ", ".join(args) + ")"]
+    pad = " " * len(head)
+    lines = [head + args[0] + ","]
+    for a in args[1:-1]:
+        lines.append(pad + a + ",")
+    lines.append(pad + args[-1] + ")")
+    return lines
+
+
+def banner(title: str, indent: str = "") -> List[str]:
+    rule = "=" * 76
+    return [f"{indent}/* {rule}", f"{indent} * {title}", f"{indent} * {rule} */", ""]
+
+
+# ---- Header -----------------------------------------------------------------
+
+
+def generate_header(fam: Family) -> str:
+    P, f, I = fam.prefix, fam.family, "    "
+    sets = [o for o in fam.ops if o.kind == "set"]
+    gets = [o for o in fam.ops if o.kind == "get"]
+    guard = f"{P}_OPS_H"
+    out: List[str] = []
+    w = out.append
+
+    w("/**")
+    w(f" * @file {f}_ops.h")
+    w(f" * @brief {fam.brief}")
+    w(" *")
+    for line in fam.description:
+        w(f" * {line}".rstrip())
+    if fam.description:
+        w(" *")
+    w(f" * Generated by scripts/generate_family.py from {fam.source}; edit the")
+    w(" * schema and regenerate instead of editing this file.")
+    w(" *")
+    w(" * Commands:")
+    for o in fam.ops:
+        w(f" * - {P}_OP_{o.const}: {o.brief}")
+    w(" */")
+    w("")
+    w(f"#ifndef {guard}")
+    w(f"#define {guard}")
+    w("")
+    w('#include "crumbs.h"')
+    w('#include "crumbs_ops.h"')
+    w("")
+    w("#include <string.h> /* memcpy */")
+    w("")
+    w("#ifdef __cplusplus")
+    w('extern "C"')
+    w("{")
+    w("#endif")
+    w("")
+    out += banner("Device Identity")
+    w(f"/** @brief Type ID for {f} devices. */")
+    w(f"#define {P}_TYPE_ID 0x{fam.type_id:02X}")
+    w("")
+    w("/* Module protocol version (per versioning.md convention) */")
+    for part, v in zip(("MAJOR", "MINOR", "PATCH"), fam.version):
+        w(f"#define {P}_MODULE_VER_{part} {v}")
+    w("")
+
+    for title, group in (("Command Definitions: SET Operations", sets),
+                         ("Command Definitions: GET Operations (Query State via SET_REPLY)", gets)):
+        if not group:
+            continue
+        out += banner(title)
+        for o in group:
+            w("/**")
+            w(f" * @brief {o.brief}")
+            if o.kind == "set":
+                w(f" * Payload: {payload_doc(o.fields)}")
+            else:
+                w(" * Payload: none")
+                w(f" * Reply: {payload_doc(o.fields)}")
+            for fld in o.fields:
+                if fld.doc:
+                    w(f" *   - {fld.name}: {fld.doc}")
+            w(" */")
+            w(f"#define {P}_OP_{o.const} 0x{o.opcode:02X}")
+            what = "Payload" if o.kind == "set" else "Reply payload"
+            w(f"/** @brief {what} bytes of {P}_OP_{o.const}. */")
+            w(f"#define {P}_OP_{o.const}_LEN {o.size}u")
+            w(f"CRUMBS_STATIC_ASSERT({P}_OP_{o.const}_LEN <= CRUMBS_MAX_PAYLOAD, {f}_{o.name}_fits);")
+            w("")
+
+    if sets:
+        out += banner("Controller Side: Command Senders", I)
+        for o in sets:
+            args = params(o.fields)
+            w(f"{I}/**")
+            w(f"{I} * @brief Pack {P}_OP_{o.const} into @p m (no bounds checks needed).")
+            w(f"{I} */")
+            out += signature("void", f"{f}_pack_{o.name}", ["crumbs_message_t *m"] + args, I)
+            w(f"{I}{{")
+            w(f"{I}    m->type_id = {P}_TYPE_ID;")
+            w(f"{I}    m->opcode = {P}_OP_{o.const};")
+            w(f"{I}    m->data_len = (uint8_t){P}_OP_{o.const}_LEN;")
+            for line in field_stores(o.fields, "m->data", ""):
+                w(f"{I}    {line}")
+            w(f"{I}}}")
+            w("")
+            w(f"{I}/**")
+            w(f"{I} * @brief {o.brief}")
+            w(f"{I} *")
+            w(f"{I} * @param dev Bound device handle (see crumbs_device_t).")
+            for fld in o.fields:
+                w(f"{I} * @param {fld.name} {fld.doc}".rstrip())
+            w(f"{I} * @return 0 on success, non-zero on error.")
+            w(f"{I} */")
+            out += signature("int", f"{f}_send_{o.name}", ["const crumbs_device_t *dev"] + args, I)
+            w(f"{I}{{")
+            w(f"{I}    crumbs_message_t msg;")
+            call = ", ".join(["&msg"] + [fld.name for fld in o.fields])
+            w(f"{I}    {f}_pack_{o.name}({call});")
+            w(f"{I}    return crumbs_controller_send(dev->ctx, dev->addr, &msg, dev->write_fn, dev->io);")
+            w(f"{I}}}")
+            w("")
+
+    if gets:
+        out += banner("Controller Side: Combined Query + Read (Receiver API)", I)
+        for o in gets:
+            rt = f"{f}_{o.name}_result_t"
+            w(f"{I}/**")
+            w(f"{I} * @brief Result struct for {P}_OP_{o.const}.")
+            w(f"{I} */")
+            w(f"{I}typedef struct")
+            w(f"{I}{{")
+            if o.fields:
+                out += struct_members(o.fields, I + "    ")
+            else:
+                w(f"{I}    uint8_t _unused; /**< The reply carries no payload. */")
+            w(f"{I}}} {rt};")
+            w("")
+            w(f"{I}/**")
+            w(f"{I} * @brief Parse a {P}_OP_{o.const} reply payload (one length check).")
+            w(f"{I} *")
+            w(f"{I} * @return 0 on success, -1 if @p len is short or a pointer is NULL.")
+            w(f"{I} */")
+            out += signature("int", f"{f}_parse_{o.name}", ["const uint8_t *data", "size_t len", f"{rt} *out"], I)
+            w(f"{I}{{")
+            out += length_check(o, P, I)
+            for line in field_loads(o.fields, "data", "out->"):
+                w(f"{I}    {line}")
+            w(f"{I}    return 0;")
+            w(f"{I}}}")
+            w("")
+            w(f"{I}CRUMBS_DEFINE_GET_OP_LEN({f}, {o.name}, {P}_TYPE_ID, {P}_OP_{o.const},")
+            w(f"{I}                         {rt}, {f}_parse_{o.name}, {P}_OP_{o.const}_LEN)")
+            w("")
+
+    out += banner("Peripheral Side: Payload Decoders and Reply Builders", I)
+    for o in sets:
+        at = f"{f}_{o.name}_args_t"
+        w(f"{I}/**")
+        w(f"{I} * @brief Decoded {P}_OP_{o.const} payload.")
+        w(f"{I} */")
+        w(f"{I}typedef struct")
+        w(f"{I}{{")
+        if o.fields:
+            out += struct_members(o.fields, I + "    ")
+        else:
+            w(f"{I}    uint8_t _unused; /**< The command carries no payload. */")
+        w(f"{I}}} {at};")
+        w("")
+        w(f"{I}/**")
+        w(f"{I} * @brief Decode a {P}_OP_{o.const} payload in a command handler (one length check).")
+        w(f"{I} *")
+        w(f"{I} * @return 0 on success, -1 if @p len is short or a pointer is NULL.")
+        w(f"{I} */")
+        out += signature("int", f"{f}_unpack_{o.name}", ["const uint8_t *data", "uint8_t len", f"{at} *out"], I)
+        w(f"{I}{{")
+        out += length_check(o, P, I)
+        for line in field_loads(o.fields, "data", "out->"):
+            w(f"{I}    {line}")
+        w(f"{I}    return 0;")
+        w(f"{I}}}")
+        w("")
+    for o in gets:
+        rt = f"{f}_{o.name}_result_t"
+        w(f"{I}/**")
+        w(f"{I} * @brief Fill a {P}_OP_{o.const} reply from a reply handler.")
+        w(f"{I} */")
+        out += signature("void", f"{f}_reply_{o.name}", ["crumbs_message_t *reply", f"const {rt} *v"], I)
+        w(f"{I}{{")
+        if not o.fields:
+            w(f"{I}    (void)v;")
+        w(f"{I}    reply->type_id = {P}_TYPE_ID;")
+        w(f"{I}    reply->opcode = {P}_OP_{o.const};")
+        w(f"{I}    reply->data_len = (uint8_t){P}_OP_{o.const}_LEN;")
+        for line in field_stores(o.fields, "reply->data", "v->"):
+            w(f"{I}    {line}")
+        w(f"{I}}}")
+        w("")
+
+    w("#ifdef __cplusplus")
+    w("}")
+    w("#endif")
+    w("")
+    w(f"#endif /* {guard} */")
+    return "\n".join(out) + "\n"
+
+
+# ---- Peripheral skeleton ----------------------------------------------------
+
+
+def generate_stubs(fam: Family) -> str:
+    P, f = fam.prefix, fam.family
+    out: List[str] = []
+    w = out.append
+    w("/**")
+    w(f" * @file {f}_handlers.c")
+    w(f" * @brief {P} peripheral handler skeleton.")
+    w(" *")
+    w(f" * Generated once by scripts/generate_family.py from {fam.source}. Fill in")
+    w(f" * the bodies and call {f}_register_handlers() after crumbs_init().")
+    w(" */")
+    w("")
+    w(f'#include "{f}_ops.h"')
+    w("")
+    for o in fam.ops:
+        if o.kind == "set":
+            w(f"static void {f}_on_{o.name}(crumbs_context_t *ctx, uint8_t opcode, const uint8_t *data,")
+            w(f"{' ' * (len(f) + len(o.name) + 17)}uint8_t len, void *user_data)")
+            w("{")
+            w(f"    {f}_{o.name}_args_t args;")
+            w("    (void)ctx;")
+            w("    (void)opcode;")
+            w("    (void)user_data;")
+            w(f"    if ({f}_unpack_{o.name}(data, len, &args) != 0)")
+            w("        return;")
+            w(f"    /* Apply {P}_OP_{o.const}: {o.brief} */")
+            w("}")
+        else:
+            w(f"static void {f}_on_{o.name}(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)")
+            w("{")
+            w(f"    {f}_{o.name}_result_t state;")
+            w("    (void)ctx;")
+            w("    (void)user_data;")
+            w("    memset(&state, 0, sizeof(state));")
+            w(f"    /* Fill state for {P}_OP_{o.const}: {o.brief} */")
+            w(f"    {f}_reply_{o.name}(reply, &state);")
+            w("}")
+        w("")
+    w(f"int {f}_register_handlers(crumbs_context_t *ctx)")
+    w("{")
+    w("    int rc = 0;")
+    for o in fam.ops:
+        reg = "crumbs_register_handler" if o.kind == "set" else "crumbs_register_reply_handler"
+        w(f"    rc |= {reg}(ctx, {P}_OP_{o.const}, {f}_on_{o.name}, NULL);")
+    w("    return rc;")
+    w("}")
+    return "\n".join(out) + "\n"
+
+
+# ---- CLI --------------------------------------------------------------------
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Generate a CRUMBS family ops header from a schema")
+    parser.add_argument("schema", type=Path, help="Family schema (.json, .yaml or .yml)")
+    parser.add_argument("-o", "--output", type=Path, help="Header to write (default: <family>_ops.h next to the schema)")
+    parser.add_argument("--stubs", type=Path, help="Also write a peripheral handler skeleton (.c)")
+    parser.add_argument("--check", action="store_true", help="Exit 1 if the header differs from the schema")
+    args = parser.parse_args()
+
+    try:
+        fam = load_schema(args.schema)
+    except (SchemaError, json.JSONDecodeError) as e:
+        print(f"{args.schema}: {e}", file=sys.stderr)
+        return 2
+
+    out = args.output or args.schema.with_name(f"{fam.family}_ops.h")
+    header = generate_header(fam)
+
+    if args.check:
+        current = out.read_text(encoding="utf-8") if out.exists() else ""
+        if current != header:
+            print(f"{out} is out of date; run: python scripts/generate_family.py {args.schema}", file=sys.stderr)
+            return 1
+        print(f"{out} is up to date")
+        return 0
+
+    out.write_text(header, encoding="utf-8")
+    print(f"wrote {out}")
+    if args.stubs:
+        if args.stubs.exists():
+            print(f"{args.stubs} exists; not overwriting the handler skeleton", file=sys.stderr)
+            return 1
+        args.stubs.write_text(generate_stubs(fam), encoding="utf-8")
+        print(f"wrote {args.stubs}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
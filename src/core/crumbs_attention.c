@@ -0,0 +1,130 @@
+/**
+ * @file
+ * @brief Attention line and SMBus-style alert response.
+ *
+ * The line itself is driven through the crumbs_attention_fn given to
+ * crumbs_set_attention_pin(); crumbs_peripheral_build_reply() calls
+ * crumbs_attention_delivered() so a serviced peripheral lets go of it.
+ * The controller helper is always built.
+ */
+
+#include "crumbs_internal.h"
+
+/* ---- Peripheral side ---------------------------------------------------- */
+
+#if CRUMBS_ENABLE_ATTENTION
+static void crumbs_attention_drive(crumbs_context_t *ctx, uint8_t asserted)
+{
+    ctx->attention_pending = asserted;
+    if (ctx->attention_fn)
+    {
+        ctx->attention_fn(ctx->attention_user, asserted);
+    }
+}
+
+void crumbs_attention_delivered(crumbs_context_t *ctx, uint8_t reply_opcode)
+{
+    if (ctx->attention_pending && reply_opcode != CRUMBS_CMD_NOT_READY)
+    {
+        crumbs_attention_drive(ctx, 0u);
+    }
+}
+#endif
+
+int crumbs_set_attention_pin(crumbs_context_t *ctx, crumbs_attention_fn fn, void *user_data)
+{
+#if CRUMBS_ENABLE_ATTENTION
+    if (!ctx)
+    {
+        return -1;
+    }
+    if (ctx->attention_fn && ctx->attention_fn != fn)
+    {
+        ctx->attention_fn(ctx->attention_user, 0); /* leave the old pin released */
+    }
+    ctx->attention_fn = fn;
+    ctx->attention_user = user_data;
+    crumbs_attention_drive(ctx, ctx->attention_pending);
+    return 0;
+#else
+    (void)ctx;
+    (void)fn;
+    (void)user_data;
+    return -1;
+#endif
+}
+
+int crumbs_raise_attention(crumbs_context_t *ctx)
+{
+#if CRUMBS_ENABLE_ATTENTION
+    if (!ctx)
+    {
+        return -1;
+    }
+    crumbs_attention_drive(ctx, 1u);
+    return 0;
+#else
+    (void)ctx;
+    return -1;
+#endif
+}
+
+void crumbs_clear_attention(crumbs_context_t *ctx)
+{
+#if CRUMBS_ENABLE_ATTENTION
+    if (ctx)
+    {
+        crumbs_attention_drive(ctx, 0u);
+    }
+#else
+    (void)ctx;
+#endif
+}
+
+int crumbs_attention_pending(const crumbs_context_t *ctx)
+{
+#if CRUMBS_ENABLE_ATTENTION
+    return ctx ? ctx->attention_pending : 0;
+#else
+    (void)ctx;
+    return 0;
+#endif
+}
+
+int crumbs_peripheral_alert_response(crumbs_context_t *ctx, uint8_t *out)
+{
+    if (!ctx || !out)
+    {
+        return -1;
+    }
+#if CRUMBS_ENABLE_ATTENTION
+    if (!ctx->attention_pending)
+    {
+        return 0;
+    }
+    *out = (uint8_t)(ctx->address << 1);
+    crumbs_attention_drive(ctx, 0u);
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+/* ---- Controller side ---------------------------------------------------- */
+
+int crumbs_controller_alert_response(crumbs_i2c_read_fn read_fn, void *io, uint8_t *addr)
+{
+    if (!read_fn || !addr)
+    {
+        return -1;
+    }
+
+    uint8_t byte = 0xFFu;
+    int n = read_fn(io, CRUMBS_ALERT_RESPONSE_ADDR, &byte, 1u, 0u);
+    if (n != 1 || byte == 0xFFu)
+    {
+        return 0; /* NACK or released bus: nobody with alert response support */
+    }
+    *addr = (uint8_t)(byte >> 1);
+    return 1;
+}
@@ -0,0 +1,211 @@
+/**
+ * @file
+ * @brief Bulk queries: the CRUMBS_CMD_BULK_GET extension (0xF4).
+ *
+ * A SET_REPLY whose first byte is CRUMBS_CMD_BULK_GET selects the stream
+ * and stores the rest of its payload as the opcode list. Each entry is
+ * built by crumbs_peripheral_fill_reply() with ctx->requested_opcode
+ * pointing at that opcode, so reply handlers and on_request need no
+ * changes. The controller helpers are always built.
+ */
+
+#include "crumbs_internal.h"
+#include "crumbs_latency.h"
+
+#include <string.h> /* memcpy */
+
+/* ---- Peripheral side ---------------------------------------------------- */
+
+#if CRUMBS_ENABLE_BULK
+void crumbs_bulk_select(crumbs_context_t *ctx, const crumbs_frame_view_t *view)
+{
+    uint8_t count = (uint8_t)(view->data_len - 1u);
+    if (count > CRUMBS_BULK_MAX_OPS)
+    {
+        count = CRUMBS_BULK_MAX_OPS;
+    }
+    memcpy(ctx->bulk_ops, &view->data[1], count);
+    ctx->bulk_count = count;
+    ctx->bulk_next = 0u;
+}
+
+int crumbs_bulk_reply(crumbs_context_t *ctx, crumbs_message_t *msg)
+{
+    uint8_t first = ctx->bulk_next < ctx->bulk_count ? ctx->bulk_next : 0u;
+    uint8_t i = first;
+    uint8_t len = 1u;
+
+    msg->type_id = 0u;
+    msg->opcode = CRUMBS_CMD_BULK_GET;
+
+    while (i < ctx->bulk_count)
+    {
+        uint8_t op = ctx->bulk_ops[i];
+        crumbs_message_t entry;
+        int filled = 0;
+
+        if (op != CRUMBS_CMD_BULK_GET)
+        {
+            ctx->requested_opcode = op;
+            filled = crumbs_peripheral_fill_reply(ctx, &entry);
+            ctx->requested_opcode = CRUMBS_CMD_BULK_GET;
+        }
+
+        uint8_t n = filled ? entry.data_len : 0u;
+        uint8_t mark = n;
+        if (n > CRUMBS_MAX_PAYLOAD - 3u)
+        {
+            mark = CRUMBS_BULK_TOO_LARGE;
+            n = 0u;
+        }
+        if (len + 2u + n > CRUMBS_MAX_PAYLOAD)
+        {
+            break; /* whole entries only; this one opens the next frame */
+        }
+
+        if (i == first && filled)
+        {
+            msg->type_id = entry.type_id;
+        }
+        msg->data[len++] = op;
+        msg->data[len++] = mark;
+        memcpy(&msg->data[len], entry.data, n);
+        len = (uint8_t)(len + n);
+        i++;
+    }
+
+    int more = i < ctx->bulk_count;
+    ctx->bulk_next = more ? i : 0u;
+    msg->data[0] = (uint8_t)(first | (more ? CRUMBS_BULK_MORE : 0u));
+    msg->data_len = len;
+    return 1;
+}
+#endif
+
+/* ---- Controller side ---------------------------------------------------- */
+
+int crumbs_bulk_next(const crumbs_message_t *frame, uint8_t *pos, crumbs_message_t *entry)
+{
+    if (!frame || !pos || !entry || frame->opcode != CRUMBS_CMD_BULK_GET || frame->data_len < 1u)
+    {
+        return -1;
+    }
+
+    uint8_t at = *pos ? *pos : 1u; /* skip hdr */
+    if (at >= frame->data_len)
+    {
+        return 0;
+    }
+    if (at + 2u > frame->data_len)
+    {
+        return -1;
+    }
+
+    uint8_t n = frame->data[at + 1u];
+    int too_large = n == CRUMBS_BULK_TOO_LARGE;
+    if (too_large)
+    {
+        n = 0u;
+    }
+    if (at + 2u + n > frame->data_len)
+    {
+        return -1;
+    }
+
+    entry->type_id = frame->type_id;
+    entry->opcode = frame->data[at];
+    entry->data_len = n;
+    memcpy(entry->data, &frame->data[at + 2u], n);
+    entry->crc8 = 0u;
+    *pos = (uint8_t)(at + 2u + n);
+    return too_large ? 2 : 1;
+}
+
+int crumbs_controller_get_bulk(const crumbs_device_t *dev,
+                               const uint8_t *opcodes,
+                               uint8_t count,
+                               crumbs_message_t *out)
+{
+    if (!dev || !dev->ctx || !dev->write_fn || !dev->read_fn || !dev->delay_fn || !opcodes ||
+        !out || count == 0u || count > CRUMBS_BULK_MAX_QUERY)
+    {
+        return -1;
+    }
+
+    crumbs_frame_builder_t fb;
+    crumbs_fb_init(&fb, 0u, CRUMBS_CMD_SET_REPLY);
+    crumbs_fb_add_u8(&fb, CRUMBS_CMD_BULK_GET);
+    for (uint8_t i = 0; i < count; i++)
+    {
+        crumbs_fb_add_u8(&fb, opcodes[i]);
+    }
+    int rc = crumbs_controller_send_frame(dev->ctx, dev->addr, &fb, dev->write_fn, dev->io);
+    if (rc != 0)
+    {
+        return rc;
+    }
+
+    uint32_t delay_us = crumbs_device_query_delay(dev, CRUMBS_CMD_BULK_GET);
+    dev->delay_fn(delay_us);
+
+    uint32_t too_large = 0u; /* one bit per entry, CRUMBS_BULK_MAX_QUERY < 32 */
+    uint8_t next = 0u;
+    uint8_t more;
+    do
+    {
+        crumbs_message_t frame;
+        rc = crumbs_controller_read(dev->ctx, dev->addr, &frame, dev->read_fn, dev->io);
+        if (rc == 0 && (frame.opcode != CRUMBS_CMD_BULK_GET || frame.data_len < 1u ||
+                        (frame.data[0] & (uint8_t)~CRUMBS_BULK_MORE) != next))
+        {
+            rc = -1;
+        }
+        if (rc != 0)
+        {
+            crumbs_device_query_result(dev, CRUMBS_CMD_BULK_GET, delay_us, 0);
+            return rc;
+        }
+
+        uint8_t start = next;
+        uint8_t pos = 0u;
+        crumbs_message_t entry;
+        int got;
+        while ((got = crumbs_bulk_next(&frame, &pos, &entry)) > 0)
+        {
+            if (next >= count || entry.opcode != opcodes[next])
+            {
+                return -1;
+            }
+            if (got == 2)
+            {
+                too_large |= 1ul << next;
+            }
+            out[next++] = entry;
+        }
+
+        more = frame.data[0] & CRUMBS_BULK_MORE;
+        if (got < 0 || (more && next == start))
+        {
+            return -1;
+        }
+    } while (more);
+
+    crumbs_device_query_result(dev, CRUMBS_CMD_BULK_GET, delay_us, 1);
+    if (next != count)
+    {
+        return -1; /* the peripheral kept fewer opcodes than were asked for */
+    }
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (too_large & (1ul << i))
+        {
+            rc = crumbs_ext_query(dev, opcodes[i], &out[i]);
+            if (rc != 0)
+            {
+                return rc;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,327 @@
+/**
+ * @file
+ * @brief Bus traffic capture and replay (see crumbs_capture.h).
+ */
+
+#include "crumbs_capture.h"
+
+#include <string.h> /* memset, memcpy, memcmp */
+
+static const uint8_t crumbs_capture_magic[8] = {'C', 'R', 'U', 'M', 'B', 'C', 'A', 'P'};
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+static void crumbs_capture_put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void crumbs_capture_put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint16_t crumbs_capture_get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t crumbs_capture_get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+static void crumbs_capture_record(crumbs_capture_t *cap, uint8_t addr, uint8_t dir,
+                                  const uint8_t *data, size_t len, int rc)
+{
+    crumbs_capture_record_t rec;
+    crumbs_message_t m;
+    uint8_t raw[CRUMBS_CAPTURE_RECORD_SIZE];
+
+    if (cap->paused || !cap->sink)
+    {
+        return;
+    }
+
+    memset(&rec, 0, sizeof(rec));
+    rec.t_us = cap->clock ? cap->clock() : 0u;
+    rec.seq = cap->seq++;
+    rec.addr = addr;
+    rec.dir = dir;
+    rec.len = (uint8_t)((len > 255u) ? 255u : len);
+    rec.rc = (int16_t)((rc < -32768) ? -32768 : (rc > 32767) ? 32767 : rc);
+    rec.decode = (int8_t)((len > 0u && data) ? crumbs_decode_message(data, len, &m, NULL) : -1);
+    if (len > 0u && data)
+    {
+        memcpy(rec.data, data, (len < CRUMBS_CAPTURE_DATA_MAX) ? len : CRUMBS_CAPTURE_DATA_MAX);
+    }
+
+    crumbs_capture_encode(&rec, raw);
+    if (cap->sink(cap->sink_user, raw) != 0)
+    {
+        cap->dropped++;
+    }
+}
+
+static int crumbs_capture_send(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    crumbs_capture_t *cap = (crumbs_capture_t *)user_ctx;
+    int rc = cap->inner->send(cap->inner_io, addr, data, len);
+    crumbs_capture_record(cap, addr, CRUMBS_CAPTURE_TX, data, len, rc);
+    return rc;
+}
+
+static int crumbs_capture_receive(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len,
+                                  uint32_t timeout_us)
+{
+    crumbs_capture_t *cap = (crumbs_capture_t *)user_ctx;
+    int rc = cap->inner->receive(cap->inner_io, addr, buffer, len, timeout_us);
+    crumbs_capture_record(cap, addr, CRUMBS_CAPTURE_RX, buffer, (rc > 0) ? (size_t)rc : 0u, rc);
+    return rc;
+}
+
+static int crumbs_capture_transact(void *user_ctx, uint8_t addr, const uint8_t *tx, size_t tx_len,
+                                   uint8_t *rx, size_t rx_len, uint32_t timeout_us,
+                                   int require_repeated_start)
+{
+    crumbs_capture_t *cap = (crumbs_capture_t *)user_ctx;
+    int rc = cap->inner->transact(cap->inner_io, addr, tx, tx_len, rx, rx_len, timeout_us,
+                                  require_repeated_start);
+
+    /* Recorded as its two halves; a refused combined transfer is not recorded. */
+    if (rc == CRUMBS_I2C_DEV_E_NO_REPEATED_START)
+    {
+        return rc;
+    }
+    crumbs_capture_record(cap, addr, CRUMBS_CAPTURE_TX, tx, tx_len, (rc < 0) ? rc : 0);
+    if (rx_len > 0u)
+    {
+        crumbs_capture_record(cap, addr, CRUMBS_CAPTURE_RX, rx, (rc > 0) ? (size_t)rc : 0u, rc);
+    }
+    return rc;
+}
+
+/* ---- Format ------------------------------------------------------------ */
+
+void crumbs_capture_header(uint8_t *out)
+{
+    if (!out)
+    {
+        return;
+    }
+    memcpy(out, crumbs_capture_magic, sizeof(crumbs_capture_magic));
+    crumbs_capture_put_u16(&out[8], CRUMBS_CAPTURE_VERSION);
+    crumbs_capture_put_u16(&out[10], CRUMBS_CAPTURE_RECORD_SIZE);
+    crumbs_capture_put_u32(&out[12], 0u);
+}
+
+int crumbs_capture_check_header(const uint8_t *buf, size_t len)
+{
+    if (!buf || len < CRUMBS_CAPTURE_HEADER_SIZE ||
+        memcmp(buf, crumbs_capture_magic, sizeof(crumbs_capture_magic)) != 0 ||
+        crumbs_capture_get_u16(&buf[8]) != CRUMBS_CAPTURE_VERSION ||
+        crumbs_capture_get_u16(&buf[10]) != CRUMBS_CAPTURE_RECORD_SIZE)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+void crumbs_capture_encode(const crumbs_capture_record_t *rec, uint8_t *out)
+{
+    if (!rec || !out)
+    {
+        return;
+    }
+    crumbs_capture_put_u32(&out[0], rec->t_us);
+    crumbs_capture_put_u32(&out[4], rec->seq);
+    out[8] = rec->addr;
+    out[9] = rec->dir;
+    out[10] = rec->len;
+    out[11] = (uint8_t)rec->decode;
+    crumbs_capture_put_u16(&out[12], (uint16_t)rec->rc);
+    crumbs_capture_put_u16(&out[14], 0u);
+    memcpy(&out[16], rec->data, CRUMBS_CAPTURE_DATA_MAX);
+}
+
+void crumbs_capture_decode(const uint8_t *in, crumbs_capture_record_t *rec)
+{
+    if (!in || !rec)
+    {
+        return;
+    }
+    rec->t_us = crumbs_capture_get_u32(&in[0]);
+    rec->seq = crumbs_capture_get_u32(&in[4]);
+    rec->addr = in[8];
+    rec->dir = in[9];
+    rec->len = in[10];
+    rec->decode = (int8_t)in[11];
+    rec->rc = (int16_t)crumbs_capture_get_u16(&in[12]);
+    memcpy(rec->data, &in[16], CRUMBS_CAPTURE_DATA_MAX);
+}
+
+/* ---- Capture ----------------------------------------------------------- */
+
+int crumbs_capture_init(crumbs_capture_t *cap,
+                        const crumbs_transport_t *inner, void *inner_io,
+                        crumbs_capture_sink_fn sink, void *sink_user,
+                        crumbs_clock_us_fn clock)
+{
+    if (!cap || !inner || !inner->send || !sink)
+    {
+        return -1;
+    }
+
+    memset(cap, 0, sizeof(*cap));
+    cap->inner = inner;
+    cap->inner_io = inner_io;
+    cap->sink = sink;
+    cap->sink_user = sink_user;
+    cap->clock = clock;
+
+    cap->transport.name = "capture";
+    cap->transport.send = crumbs_capture_send;
+    cap->transport.receive = inner->receive ? crumbs_capture_receive : NULL;
+    cap->transport.transact = inner->transact ? crumbs_capture_transact : NULL;
+    cap->transport.caps = inner->caps;
+    cap->transport.max_frame = inner->max_frame;
+    return 0;
+}
+
+int crumbs_capture_attach(crumbs_capture_t *cap, crumbs_context_t *ctx,
+                          crumbs_capture_sink_fn sink, void *sink_user,
+                          crumbs_clock_us_fn clock)
+{
+    if (!ctx || !ctx->transport)
+    {
+        return -1;
+    }
+    if (crumbs_capture_init(cap, ctx->transport, ctx->transport_io, sink, sink_user, clock) != 0)
+    {
+        return -1;
+    }
+    return crumbs_set_transport(ctx, &cap->transport, cap);
+}
+
+/* ---- Replay ------------------------------------------------------------ */
+
+void crumbs_capture_replay_init(crumbs_capture_replay_t *r)
+{
+    if (r)
+    {
+        memset(r, 0, sizeof(*r));
+    }
+}
+
+int crumbs_capture_replay_record(crumbs_capture_replay_t *r, const crumbs_capture_record_t *rec)
+{
+    uint8_t buf[CRUMBS_MESSAGE_MAX_SIZE + 1u];
+    size_t got = 0u;
+    int rc;
+
+    if (!r || !rec || (!r->peripheral && !(r->bus && r->bus->send)))
+    {
+        return -1;
+    }
+
+    if (r->delay && r->started && rec->t_us != r->last_us)
+    {
+        r->delay(rec->t_us - r->last_us);
+    }
+    r->last_us = rec->t_us;
+    r->started = 1u;
+
+    /* Failed or truncated captures say nothing about the device. */
+    if (rec->rc < 0 || rec->len > CRUMBS_CAPTURE_DATA_MAX ||
+        (rec->dir != CRUMBS_CAPTURE_TX && rec->dir != CRUMBS_CAPTURE_RX))
+    {
+        r->skipped++;
+        return 0;
+    }
+
+    if (r->peripheral)
+    {
+        if (rec->addr != r->peripheral->address ||
+            (rec->dir == CRUMBS_CAPTURE_TX && rec->decode != 0))
+        {
+            r->skipped++;
+            return 0;
+        }
+        r->replayed++;
+        if (rec->dir == CRUMBS_CAPTURE_TX)
+        {
+            rc = crumbs_peripheral_handle_receive(r->peripheral, rec->data, rec->len);
+            if (rc < 0)
+            {
+                r->errors++;
+            }
+            return (rc < 0) ? rc : 0;
+        }
+        rc = crumbs_peripheral_build_reply(r->peripheral, buf, sizeof(buf), &got);
+        if (rc < 0)
+        {
+            r->errors++;
+            return rc;
+        }
+        /* A hardware read may be padded past the frame. */
+        if (got > rec->len || memcmp(buf, rec->data, got) != 0)
+        {
+            r->mismatches++;
+            return 1;
+        }
+        return 0;
+    }
+
+    r->replayed++;
+    if (rec->dir == CRUMBS_CAPTURE_TX)
+    {
+        rc = r->bus->send(r->bus_io, rec->addr, rec->data, rec->len);
+        if (rc < 0)
+        {
+            r->errors++;
+        }
+        return (rc < 0) ? rc : 0;
+    }
+    if (!r->bus->receive)
+    {
+        r->errors++;
+        return -1;
+    }
+    rc = r->bus->receive(r->bus_io, rec->addr, buf, rec->len, 0u);
+    if (rc < 0)
+    {
+        r->errors++;
+        return rc;
+    }
+    if ((size_t)rc != rec->len || memcmp(buf, rec->data, rec->len) != 0)
+    {
+        r->mismatches++;
+        return 1;
+    }
+    return 0;
+}
+
+int crumbs_capture_replay(crumbs_capture_replay_t *r, const uint8_t *records, size_t count)
+{
+    crumbs_capture_record_t rec;
+    int bad = 0;
+
+    if (!r || (!records && count > 0u))
+    {
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        crumbs_capture_decode(&records[i * CRUMBS_CAPTURE_RECORD_SIZE], &rec);
+        if (crumbs_capture_replay_record(r, &rec) != 0)
+        {
+            bad++;
+        }
+    }
+    return bad;
+}
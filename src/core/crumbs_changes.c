@@ -0,0 +1,199 @@
+/**
+ * @file
+ * @brief Change sequence and the CRUMBS_CMD_IF_CHANGED extension (0xF3).
+ *
+ * IF_CHANGED is a SET_REPLY with a sequence attached: it selects the
+ * opcode and sets cond_active. While that is set,
+ * crumbs_peripheral_fill_reply() comes here first, and the reply handler
+ * only runs when the sequence moved on. The controller helpers are always
+ * built.
+ */
+
+#include "crumbs_internal.h"
+#include "crumbs_latency.h"
+
+#include <string.h> /* memmove, memset */
+
+/* ---- Peripheral side ---------------------------------------------------- */
+
+void crumbs_mark_changed(crumbs_context_t *ctx)
+{
+#if CRUMBS_ENABLE_CHANGE_SEQ
+    if (!ctx)
+    {
+        return;
+    }
+    uint16_t seq = (uint16_t)(ctx->change_seq + 1u);
+    ctx->change_seq = seq ? seq : 1u;
+#else
+    (void)ctx;
+#endif
+}
+
+uint16_t crumbs_change_seq(const crumbs_context_t *ctx)
+{
+#if CRUMBS_ENABLE_CHANGE_SEQ
+    return ctx ? ctx->change_seq : 0u;
+#else
+    (void)ctx;
+    return 0u;
+#endif
+}
+
+int crumbs_set_change_seq(crumbs_context_t *ctx, uint16_t seq)
+{
+#if CRUMBS_ENABLE_CHANGE_SEQ
+    if (!ctx)
+    {
+        return -1;
+    }
+    ctx->change_seq = seq ? seq : 1u;
+    return 0;
+#else
+    (void)ctx;
+    (void)seq;
+    return -1;
+#endif
+}
+
+#if CRUMBS_ENABLE_CHANGE_SEQ
+int crumbs_changes_receive(crumbs_context_t *ctx, const crumbs_frame_view_t *view)
+{
+    if (view->data_len < 3u)
+    {
+        return 1;
+    }
+    ctx->requested_opcode = view->data[0];
+    ctx->cond_opcode = view->data[0];
+    ctx->cond_seen = (uint16_t)(view->data[1] | ((uint16_t)view->data[2] << 8));
+    ctx->cond_active = 1u;
+    return 1;
+}
+
+int crumbs_changes_reply(crumbs_context_t *ctx, crumbs_message_t *msg)
+{
+    uint16_t seq = ctx->change_seq;
+
+    if (ctx->requested_opcode == ctx->cond_opcode && seq == ctx->cond_seen)
+    {
+        memset(msg, 0, sizeof(*msg));
+        msg->opcode = CRUMBS_CMD_IF_CHANGED;
+        return 1;
+    }
+
+    /* Build the normal reply with the condition out of the way. */
+    uint8_t same = ctx->requested_opcode == ctx->cond_opcode;
+    ctx->cond_active = 0u;
+    int filled = crumbs_peripheral_fill_reply(ctx, msg);
+    ctx->cond_active = same; /* REG_READ and the like end the condition */
+
+    if (filled && same && msg->opcode != CRUMBS_CMD_NOT_READY &&
+        msg->data_len <= CRUMBS_CHANGED_MAX_PAYLOAD)
+    {
+        memmove(&msg->data[2], msg->data, msg->data_len);
+        msg->data[0] = (uint8_t)(seq & 0xFFu);
+        msg->data[1] = (uint8_t)(seq >> 8);
+        msg->data_len = (uint8_t)(msg->data_len + 2u);
+        msg->opcode = CRUMBS_CMD_IF_CHANGED;
+    }
+    return filled;
+}
+#endif
+
+/* ---- Controller side ---------------------------------------------------- */
+
+void crumbs_change_cache_init(crumbs_change_cache_t *cache, uint8_t opcode)
+{
+    if (!cache)
+    {
+        return;
+    }
+    memset(cache, 0, sizeof(*cache));
+    cache->opcode = opcode;
+}
+
+int crumbs_controller_get_if_changed(const crumbs_device_t *dev,
+                                     crumbs_change_cache_t *cache,
+                                     crumbs_message_t *out)
+{
+    if (!dev || !dev->ctx || !dev->write_fn || !dev->read_fn || !dev->delay_fn || !cache || !out)
+    {
+        return -1;
+    }
+
+    uint16_t seen = cache->valid ? cache->seq : 0u;
+    crumbs_frame_builder_t fb;
+    crumbs_fb_init(&fb, 0u, CRUMBS_CMD_IF_CHANGED);
+    crumbs_fb_add_u8(&fb, cache->opcode);
+    crumbs_fb_add_u16(&fb, seen);
+    int rc = crumbs_controller_send_frame(dev->ctx, dev->addr, &fb, dev->write_fn, dev->io);
+    if (rc != 0)
+    {
+        return rc;
+    }
+
+    uint32_t delay_us = crumbs_device_query_delay(dev, cache->opcode);
+    dev->delay_fn(delay_us);
+
+    /* The 4-byte "unchanged" frame is the whole read; a longer frame is
+     * read again at the length its header announces. */
+    crumbs_message_t reply;
+    uint8_t buf[4];
+    int n = dev->read_fn(dev->io, dev->addr, buf, sizeof(buf), 0u);
+    if (n == (int)sizeof(buf) && buf[2] == 0u)
+    {
+        rc = crumbs_decode_message(buf, sizeof(buf), &reply, dev->ctx);
+    }
+    else if (n >= 3 && buf[2] <= CRUMBS_MAX_PAYLOAD)
+    {
+        rc = crumbs_controller_read_len(dev->ctx, dev->addr, &reply, dev->read_fn, dev->io, buf[2]);
+    }
+    else
+    {
+        rc = -1;
+    }
+    crumbs_device_query_result(dev, cache->opcode, delay_us, rc == 0);
+    if (rc != 0)
+    {
+        return rc;
+    }
+
+    if (reply.opcode == CRUMBS_CMD_IF_CHANGED && reply.data_len == 0u)
+    {
+        if (!cache->valid || seen == 0u)
+        {
+            return -1;
+        }
+        cache->hits++;
+        if (out != &cache->reply)
+        {
+            *out = cache->reply;
+        }
+        return 0;
+    }
+
+    if (reply.opcode == CRUMBS_CMD_IF_CHANGED && reply.data_len >= 2u)
+    {
+        cache->seq = (uint16_t)(reply.data[0] | ((uint16_t)reply.data[1] << 8));
+        reply.opcode = cache->opcode;
+        reply.data_len = (uint8_t)(reply.data_len - 2u);
+        memmove(reply.data, &reply.data[2], reply.data_len);
+    }
+    else if (reply.opcode == cache->opcode)
+    {
+        cache->seq = 0u; /* sent as is: no sequence to compare next time */
+    }
+    else
+    {
+        return -1;
+    }
+
+    cache->reply = reply;
+    cache->valid = 1u;
+    cache->misses++;
+    if (out != &cache->reply)
+    {
+        *out = reply;
+    }
+    return 1;
+}
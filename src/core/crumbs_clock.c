@@ -0,0 +1,144 @@
+/**
+ * @file
+ * @brief Bus clock negotiation (see crumbs_clock.h).
+ */
+
+#include "crumbs_clock.h"
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+static const uint32_t k_clock_rates_hz[] = {
+    CRUMBS_BUS_KHZ_FAST_PLUS * 1000u,
+    CRUMBS_BUS_KHZ_FAST * 1000u,
+    CRUMBS_BUS_KHZ_STANDARD * 1000u,
+};
+
+#define CRUMBS_CLOCK_RATE_COUNT (sizeof(k_clock_rates_hz) / sizeof(k_clock_rates_hz[0]))
+#define CRUMBS_CLOCK_SLOWEST_HZ (CRUMBS_BUS_KHZ_STANDARD * 1000u)
+
+/** @brief Fastest standard rate not above @p limit_hz (never below standard mode). */
+static uint32_t crumbs_clock_snap(uint32_t limit_hz)
+{
+    for (size_t i = 0; i < CRUMBS_CLOCK_RATE_COUNT; i++)
+    {
+        if (k_clock_rates_hz[i] <= limit_hz)
+        {
+            return k_clock_rates_hz[i];
+        }
+    }
+    return CRUMBS_CLOCK_SLOWEST_HZ;
+}
+
+static int crumbs_clock_apply(crumbs_bus_clock_t *clk, uint32_t hz)
+{
+    if (clk->set_clock)
+    {
+        int rc = clk->set_clock(clk->io, hz);
+        if (rc != 0)
+        {
+            CRUMBS_DBG("clock: set_clock(%lu) failed (%d)\n", (unsigned long)hz, rc);
+            return rc;
+        }
+    }
+    clk->current_hz = hz;
+    clk->crc_mark = crumbs_get_crc_error_count(clk->ctx);
+    return 0;
+}
+
+/* ---- Public API --------------------------------------------------------- */
+
+void crumbs_bus_clock_init(crumbs_bus_clock_t *clk,
+                           crumbs_context_t *ctx,
+                           crumbs_set_clock_fn set_clock,
+                           void *io,
+                           uint32_t host_max_hz)
+{
+    if (!clk)
+    {
+        return;
+    }
+    clk->ctx = ctx;
+    clk->set_clock = set_clock;
+    clk->io = io;
+    clk->host_max_hz = host_max_hz ? host_max_hz : CRUMBS_BUS_KHZ_FAST_PLUS * 1000u;
+    clk->ceiling_hz = CRUMBS_CLOCK_SLOWEST_HZ;
+    clk->current_hz = CRUMBS_CLOCK_SLOWEST_HZ;
+    clk->crc_mark = crumbs_get_crc_error_count(ctx);
+    clk->fallbacks = 0u;
+}
+
+int32_t crumbs_bus_clock_negotiate(crumbs_bus_clock_t *clk,
+                                   const crumbs_device_t *devs,
+                                   size_t count)
+{
+    if (!clk || !clk->ctx || (!devs && count > 0u))
+    {
+        return -1;
+    }
+
+    /* Every device must be able to answer the query itself. */
+    int rc = crumbs_clock_apply(clk, CRUMBS_CLOCK_SLOWEST_HZ);
+    if (rc != 0)
+    {
+        return rc;
+    }
+
+    uint32_t limit = clk->host_max_hz;
+    for (size_t i = 0; i < count; i++)
+    {
+        crumbs_capabilities_t caps;
+        uint32_t dev_hz = CRUMBS_CLOCK_SLOWEST_HZ;
+        if (crumbs_controller_get_capabilities(&devs[i], &caps) == 0 && caps.max_bus_khz != 0u)
+        {
+            dev_hz = (uint32_t)caps.max_bus_khz * 1000u;
+        }
+        else
+        {
+            CRUMBS_DBG("clock: 0x%02X advertises no clock, assuming standard mode\n", devs[i].addr);
+        }
+        if (dev_hz < limit)
+        {
+            limit = dev_hz;
+        }
+    }
+
+    uint32_t hz = crumbs_clock_snap(limit);
+    clk->ceiling_hz = hz;
+    if (hz != clk->current_hz)
+    {
+        rc = crumbs_clock_apply(clk, hz);
+        if (rc != 0)
+        {
+            return rc;
+        }
+    }
+    return (int32_t)hz;
+}
+
+int crumbs_bus_clock_check(crumbs_bus_clock_t *clk)
+{
+    if (!clk || !clk->ctx)
+    {
+        return -1;
+    }
+
+    uint32_t errors = crumbs_get_crc_error_count(clk->ctx);
+    uint32_t fresh = errors - clk->crc_mark;
+    clk->crc_mark = errors;
+    if (fresh < CRUMBS_BUS_CLOCK_CRC_LIMIT || clk->current_hz <= CRUMBS_CLOCK_SLOWEST_HZ)
+    {
+        return 0;
+    }
+
+    uint32_t hz = crumbs_clock_snap(clk->current_hz - 1u);
+    CRUMBS_DBG("clock: %lu CRC errors, %lu -> %lu Hz\n",
+               (unsigned long)fresh, (unsigned long)clk->current_hz, (unsigned long)hz);
+    int rc = crumbs_clock_apply(clk, hz);
+    if (rc != 0)
+    {
+        return rc;
+    }
+    clk->ceiling_hz = hz;
+    clk->fallbacks++;
+    return 1;
+}
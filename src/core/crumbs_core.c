@@ -4,6 +4,7 @@
  */
 
 #include "crumbs.h"
+#include "crumbs_internal.h"
 
 #include <string.h> /* memcpy, memset */
 
@@ -20,6 +21,400 @@ _Static_assert(CRUMBS_MESSAGE_MAX_SIZE == 31u, "CRUMBS_MESSAGE_MAX_SIZE must be
 _Static_assert(CRUMBS_MAX_PAYLOAD == 27u, "CRUMBS_MAX_PAYLOAD must be 27");
 #endif
 
+/* ---- Handler table lookup (file-local) ---------------------------------- */
+
+#if CRUMBS_HAS_HANDLER_TABLES
+
+#if CRUMBS_DISPATCH == CRUMBS_DISPATCH_DIRECT
+#define CRUMBS_HANDLER_INDEX(p) ((p)->handler_index)
+#define CRUMBS_REPLY_INDEX(p) ((p)->reply_handler_index)
+#else
+#define CRUMBS_HANDLER_INDEX(p) ((const uint8_t *)NULL)
+#define CRUMBS_REPLY_INDEX(p) ((const uint8_t *)NULL)
+#endif
+
+#if CRUMBS_DISPATCH == CRUMBS_DISPATCH_SORTED
+/**
+ * @brief First slot whose opcode is not less than @p opcode (sorted tables).
+ */
+static uint8_t crumbs_table_lower_bound(const uint8_t *opcodes,
+                                        uint8_t count,
+                                        uint8_t opcode)
+{
+    uint8_t lo = 0u;
+    uint8_t hi = count;
+    while (lo < hi)
+    {
+        uint8_t mid = (uint8_t)(lo + ((hi - lo) >> 1));
+        if (opcodes[mid] < opcode)
+        {
+            lo = (uint8_t)(mid + 1u);
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+#endif
+
+/**
+ * @brief Locate the slot holding @p opcode in a handler table.
+ *
+ * @param opcodes Opcode array of the table.
+ * @param count   Number of live slots.
+ * @param index   Direct index (CRUMBS_DISPATCH_DIRECT only, else NULL).
+ * @param opcode  Opcode to look up.
+ * @return Slot number, or -1 if @p opcode is not registered.
+ */
+static int crumbs_table_find(const uint8_t *opcodes,
+                             uint8_t count,
+                             const uint8_t *index,
+                             uint8_t opcode)
+{
+#if CRUMBS_DISPATCH == CRUMBS_DISPATCH_DIRECT
+    /* The index is not cleared by crumbs_init(); only trust live entries. */
+    uint8_t slot = index[opcode];
+    if (slot != 0u && slot <= count && opcodes[slot - 1u] == opcode)
+    {
+        return (int)slot - 1;
+    }
+    return -1;
+#elif CRUMBS_DISPATCH == CRUMBS_DISPATCH_SORTED
+    (void)index;
+    uint8_t slot = crumbs_table_lower_bound(opcodes, count, opcode);
+    return (slot < count && opcodes[slot] == opcode) ? (int)slot : -1;
+#else
+    (void)index;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (opcodes[i] == opcode)
+        {
+            return (int)i;
+        }
+    }
+    return -1;
+#endif
+}
+
+#endif /* CRUMBS_HAS_HANDLER_TABLES */
+
+/* ---- Static (flash) table access (file-local) -------------------------- */
+
+#if defined(__AVR__)
+/* Static tables live in program memory; pointers are 16-bit words. */
+#define CRUMBS_PGM_U8(p) pgm_read_byte(p)
+#define CRUMBS_PGM_PTR(p) ((void *)pgm_read_word(p))
+#define CRUMBS_PGM_FN(type, p) ((type)pgm_read_word(p))
+#else
+#define CRUMBS_PGM_U8(p) (*(p))
+#define CRUMBS_PGM_PTR(p) (*(p))
+#define CRUMBS_PGM_FN(type, p) (*(p))
+#endif
+
+#if CRUMBS_CONTEXT_ROLE != CRUMBS_CONTEXT_CONTROLLER
+/**
+ * @brief Binary-search a static table for @p opcode.
+ *
+ * Works on both entry types: @p stride is the entry size and the opcode is
+ * the first member of each entry.
+ *
+ * @return Entry index, or -1 if not present.
+ */
+static int crumbs_static_find(const void *table,
+                              size_t stride,
+                              uint8_t count,
+                              uint8_t opcode)
+{
+    const uint8_t *base = (const uint8_t *)table;
+    uint8_t lo = 0u;
+    uint8_t hi = count;
+    while (lo < hi)
+    {
+        uint8_t mid = (uint8_t)(lo + ((hi - lo) >> 1));
+        uint8_t op = CRUMBS_PGM_U8(base + (size_t)mid * stride);
+        if (op == opcode)
+        {
+            return (int)mid;
+        }
+        if (op < opcode)
+        {
+            lo = (uint8_t)(mid + 1u);
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return -1;
+}
+#endif
+
+/**
+ * @brief Check that a static table is strictly ascending by opcode.
+ */
+static int crumbs_static_sorted(const void *table, size_t stride, size_t count)
+{
+    const uint8_t *base = (const uint8_t *)table;
+    for (size_t i = 1; i < count; i++)
+    {
+        if (CRUMBS_PGM_U8(base + (i - 1u) * stride) >= CRUMBS_PGM_U8(base + i * stride))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* ---- Opcode range tables (file-local) ---------------------------------- */
+
+#if CRUMBS_HAS_HANDLER_RANGES
+/*
+ * Both range entry types start with lo and hi, so one set of helpers
+ * serves both tables, addressed like the static tables by stride.
+ */
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
+_Static_assert(offsetof(crumbs_handler_range_t, hi) == 1u, "lo, hi lead the range entry");
+_Static_assert(offsetof(crumbs_reply_range_t, hi) == 1u, "lo, hi lead the range entry");
+#endif
+
+/**
+ * @brief Range containing @p opcode in a table sorted by lo.
+ *
+ * CRUMBS_DISPATCH_SORTED binary-searches; the other strategies scan the
+ * (at most CRUMBS_MAX_HANDLER_RANGES) entries and stop past @p opcode.
+ *
+ * @return Entry index, or -1 if no range contains @p opcode.
+ */
+static int crumbs_range_find(const void *table, size_t stride, uint8_t count, uint8_t opcode)
+{
+    const uint8_t *base = (const uint8_t *)table;
+#if CRUMBS_DISPATCH == CRUMBS_DISPATCH_SORTED
+    /* Last range starting at or below opcode. */
+    uint8_t lo = 0u;
+    uint8_t hi = count;
+    while (lo < hi)
+    {
+        uint8_t mid = (uint8_t)(lo + ((hi - lo) >> 1));
+        if (base[(size_t)mid * stride] <= opcode)
+        {
+            lo = (uint8_t)(mid + 1u);
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    if (lo == 0u || opcode > base[(size_t)(lo - 1u) * stride + 1u])
+    {
+        return -1;
+    }
+    return (int)lo - 1;
+#else
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const uint8_t *e = base + (size_t)i * stride;
+        if (opcode < e[0])
+        {
+            break;
+        }
+        if (opcode <= e[1])
+        {
+            return (int)i;
+        }
+    }
+    return -1;
+#endif
+}
+
+/**
+ * @brief Add or replace (@p entry set) or remove (@p entry NULL) lo..hi.
+ *
+ * @return 0 on success (removing an absent range included), -1 if a new
+ *         range overlaps another one or the table is full.
+ */
+static int crumbs_range_set(void *table, size_t stride, uint8_t *count,
+                            uint8_t lo, uint8_t hi, const void *entry)
+{
+    uint8_t *base = (uint8_t *)table;
+    uint8_t i = 0u;
+    while (i < *count && base[(size_t)i * stride] < lo)
+    {
+        i++;
+    }
+    uint8_t *at = base + (size_t)i * stride;
+
+    if (i < *count && at[0] == lo && at[1] == hi)
+    {
+        if (entry)
+        {
+            memcpy(at, entry, stride);
+        }
+        else
+        {
+            (*count)--;
+            memmove(at, at + stride, (size_t)(*count - i) * stride);
+        }
+        return 0;
+    }
+    if (!entry)
+    {
+        return 0;
+    }
+    if ((i > 0u && (at - stride)[1] >= lo) || (i < *count && at[0] <= hi) ||
+        *count >= CRUMBS_MAX_HANDLER_RANGES)
+    {
+        return -1;
+    }
+    memmove(at + stride, at, (size_t)(*count - i) * stride);
+    memcpy(at, entry, stride);
+    (*count)++;
+    return 0;
+}
+#endif /* CRUMBS_HAS_HANDLER_RANGES */
+
+/* ---- Handler lookup (runtime table first, then static table) ---------- */
+
+/**
+ * @brief Resolve the command handler for @p opcode.
+ *
+ * Exact entries (runtime, then static) win over opcode ranges; @p offset
+ * receives the opcode's position within its range (0 for exact entries).
+ *
+ * @return 1 if an entry exists (fn may still be NULL), 0 otherwise.
+ */
+static int crumbs_lookup_handler(const crumbs_context_t *ctx,
+                                 uint8_t opcode,
+                                 crumbs_handler_fn *fn,
+                                 void **user_data,
+                                 uint8_t *offset)
+{
+    *offset = 0u;
+#if CRUMBS_CONTEXT_ROLE != CRUMBS_CONTEXT_CONTROLLER
+    const crumbs_peripheral_ctx_t *p = &ctx->periph;
+#if CRUMBS_MAX_HANDLERS > 0
+    int slot = crumbs_table_find(p->handler_opcode, p->handler_count,
+                                 CRUMBS_HANDLER_INDEX(p), opcode);
+    if (slot >= 0)
+    {
+        *fn = p->handlers[slot];
+#if CRUMBS_HANDLER_USERDATA
+        *user_data = p->handler_userdata[slot];
+#else
+        *user_data = NULL;
+#endif
+        return 1;
+    }
+#endif
+    if (p->static_handlers)
+    {
+        int i = crumbs_static_find(p->static_handlers, sizeof(crumbs_handler_entry_t),
+                                   p->static_handler_count, opcode);
+        if (i >= 0)
+        {
+            const crumbs_handler_entry_t *e = &p->static_handlers[i];
+            *fn = CRUMBS_PGM_FN(crumbs_handler_fn, &e->fn);
+            *user_data = CRUMBS_PGM_PTR(&e->user_data);
+            return 1;
+        }
+    }
+#if CRUMBS_HAS_HANDLER_RANGES
+    int r = crumbs_range_find(p->ranges, sizeof(crumbs_handler_range_t), p->range_count, opcode);
+    if (r >= 0)
+    {
+        *fn = p->ranges[r].fn;
+        *user_data = p->ranges[r].user_data;
+        *offset = (uint8_t)(opcode - p->ranges[r].lo);
+        return 1;
+    }
+#endif
+#else
+    (void)ctx;
+    (void)opcode;
+    (void)fn;
+    (void)user_data;
+#endif
+    return 0;
+}
+
+/**
+ * @brief Resolve the reply handler for @p opcode.
+ *
+ * @return 1 if an entry exists (fn may still be NULL), 0 otherwise.
+ */
+static int crumbs_lookup_reply_handler(const crumbs_context_t *ctx,
+                                       uint8_t opcode,
+                                       crumbs_reply_fn *fn,
+                                       void **user_data)
+{
+#if CRUMBS_CONTEXT_ROLE != CRUMBS_CONTEXT_CONTROLLER
+    const crumbs_peripheral_ctx_t *p = &ctx->periph;
+#if CRUMBS_MAX_HANDLERS > 0
+    int slot = crumbs_table_find(p->reply_handler_opcode, p->reply_handler_count,
+                                 CRUMBS_REPLY_INDEX(p), opcode);
+    if (slot >= 0)
+    {
+        *fn = p->reply_handlers[slot];
+#if CRUMBS_HANDLER_USERDATA
+        *user_data = p->reply_handler_userdata[slot];
+#else
+        *user_data = NULL;
+#endif
+        return 1;
+    }
+#endif
+    if (p->static_reply_handlers)
+    {
+        int i = crumbs_static_find(p->static_reply_handlers, sizeof(crumbs_reply_entry_t),
+                                   p->static_reply_handler_count, opcode);
+        if (i >= 0)
+        {
+            const crumbs_reply_entry_t *e = &p->static_reply_handlers[i];
+            *fn = CRUMBS_PGM_FN(crumbs_reply_fn, &e->fn);
+            *user_data = CRUMBS_PGM_PTR(&e->user_data);
+            return 1;
+        }
+    }
+#else
+    (void)ctx;
+    (void)opcode;
+    (void)fn;
+    (void)user_data;
+#endif
+    return 0;
+}
+
+#if CRUMBS_HAS_HANDLER_RANGES
+/**
+ * @brief Resolve a reply range for @p opcode.
+ *
+ * Kept apart from crumbs_lookup_reply_handler() because ranges rank
+ * below the replies the core answers itself, so a 0x00-0xFF wildcard
+ * does not shadow CAPABILITIES and the other extension replies.
+ *
+ * @return 1 if a range contains @p opcode, 0 otherwise.
+ */
+static int crumbs_lookup_reply_range(const crumbs_context_t *ctx,
+                                     uint8_t opcode,
+                                     crumbs_reply_fn *fn,
+                                     void **user_data,
+                                     uint8_t *offset)
+{
+    const crumbs_peripheral_ctx_t *p = &ctx->periph;
+    int r = crumbs_range_find(p->reply_ranges, sizeof(crumbs_reply_range_t),
+                              p->reply_range_count, opcode);
+    if (r < 0)
+    {
+        return 0;
+    }
+    *fn = p->reply_ranges[r].fn;
+    *user_data = p->reply_ranges[r].user_data;
+    *offset = (uint8_t)(opcode - p->reply_ranges[r].lo);
+    return 1;
+}
+#endif
+
 /* ---- Public API implementation ---------------------------------------- */
 
 /**
@@ -60,15 +455,116 @@ void crumbs_init(crumbs_context_t *ctx,
     ctx->on_request = NULL;
     ctx->user_data = NULL;
     ctx->requested_opcode = 0u; /* Default: opcode 0 (device info by convention) */
+    ctx->max_bus_khz = 0u;
+    ctx->transport = NULL;
+    ctx->transport_io = NULL;
+#if CRUMBS_CONTEXT_ROLE != CRUMBS_CONTEXT_CONTROLLER
+    ctx->periph.static_handlers = NULL;
+    ctx->periph.static_reply_handlers = NULL;
+    ctx->periph.static_handler_count = 0u;
+    ctx->periph.static_reply_handler_count = 0u;
+#endif
+#if CRUMBS_ENABLE_FRAGMENTS
+    ctx->frag_buf = NULL;
+    ctx->on_fragment = NULL;
+    ctx->fragment_user_data = NULL;
+    ctx->frag_capacity = 0u;
+    ctx->frag_len = 0u;
+    ctx->frag_opcode = 0u;
+    ctx->frag_next = 0u;
+    ctx->frag_count = 0u;
+    ctx->frag_state = CRUMBS_FRAG_IDLE;
+    ctx->frag_errors = 0u;
+#endif
+#if CRUMBS_ENABLE_STATS
+    ctx->stats_clock = NULL;
+    ctx->stats_page = 0u;
+    (void)crumbs_reset_stats(ctx);
+#endif
+#if CRUMBS_ENABLE_TRACE
+    ctx->trace_fn = NULL;
+    ctx->trace_clock = NULL;
+    ctx->trace_user = NULL;
+#endif
+#if CRUMBS_ENABLE_BROADCAST
+    ctx->broadcast_rx = 0u;
+    ctx->broadcast_type = 0u;
+    ctx->in_broadcast = 0u;
+#endif
+#if CRUMBS_ENABLE_STAGING
+    memset(ctx->stage_latched, 0, sizeof(ctx->stage_latched));
+    ctx->stage_count = 0u;
+    ctx->stage_group = 0u;
+    ctx->stage_overflow = 0u;
+    ctx->in_commit = 0u;
+#endif
+#if CRUMBS_ENABLE_REGISTERS
+    ctx->reg_base = NULL;
+    ctx->reg_size = 0u;
+    ctx->reg_offset = 0u;
+    ctx->reg_count = 0u;
+#endif
+#if CRUMBS_ENABLE_BULK
+    memset(ctx->bulk_ops, 0, sizeof(ctx->bulk_ops));
+    ctx->bulk_count = 0u;
+    ctx->bulk_next = 0u;
+#endif
+#if CRUMBS_ENABLE_REPLY_CURSOR
+    ctx->cursor_mode = CRUMBS_CURSOR_OFF;
+    ctx->cursor_first = 0u;
+    ctx->cursor_count = 0u;
+    ctx->cursor_index = 0u;
+#endif
+#if CRUMBS_ENABLE_CHANGE_SEQ
+    ctx->change_seq = 1u;
+    ctx->cond_seen = 0u;
+    ctx->cond_opcode = 0u;
+    ctx->cond_active = 0u;
+#endif
+#if CRUMBS_ENABLE_SEQUENCED
+    ctx->seq_active = 0u;
+    ctx->seq_last = 0u;
+    ctx->seq_applied = 0u;
+    ctx->seq_duplicates = 0u;
+    ctx->seq_rejected = 0u;
+#endif
+#if CRUMBS_ENABLE_RESULT
+    ctx->result_opcode = 0u;
+    ctx->result_status = CRUMBS_RESULT_OK;
+    ctx->result_count = 0u;
+    ctx->result_armed = 0u;
+    ctx->result_set = 0u;
+#endif
+#if CRUMBS_ENABLE_ATTENTION
+    ctx->attention_fn = NULL;
+    ctx->attention_user = NULL;
+    ctx->attention_pending = 0u;
+#endif
+#if CRUMBS_ENABLE_REPLY_CACHE
+    ctx->reply_front = CRUMBS_REPLY_NONE;
+    ctx->reply_stale = 0u;
+#endif
+#if CRUMBS_ENABLE_RX_QUEUE
+    ctx->rxq_head = 0u;
+    ctx->rxq_tail = 0u;
+    ctx->rxq_enabled = 0u;
+    ctx->rxq_high_water = 0u;
+    ctx->rxq_overflows = 0u;
+#endif
 
     /*
      * Handler arrays are left untouched. If the context is in static storage,
      * they're already zero. If on stack, caller must have zero-initialized.
      * We reset handler_count to ensure no stale handlers are dispatched.
      */
-#if CRUMBS_MAX_HANDLERS > 0
-    ctx->handler_count = 0u;
-    ctx->reply_handler_count = 0u;
+#if CRUMBS_HAS_HANDLER_TABLES
+    ctx->periph.handler_count = 0u;
+    ctx->periph.reply_handler_count = 0u;
+#endif
+#if CRUMBS_HAS_HANDLER_RANGES
+    ctx->periph.range_count = 0u;
+    ctx->periph.reply_range_count = 0u;
+    ctx->periph.range_offset = 0u;
 #endif
 }
 
@@ -84,6 +580,25 @@ size_t crumbs_context_size(void)
     return sizeof(crumbs_context_t);
 }
 
+/**
+ * @brief Bytes left out by CRUMBS_CONTEXT_ROLE and CRUMBS_HANDLER_USERDATA.
+ */
+size_t crumbs_context_saved_bytes(void)
+{
+    size_t saved = 0u;
+#if CRUMBS_CONTEXT_ROLE == CRUMBS_CONTEXT_CONTROLLER
+    saved += sizeof(crumbs_peripheral_ctx_t);
+#endif
+#if CRUMBS_CONTEXT_ROLE == CRUMBS_CONTEXT_PERIPHERAL && CRUMBS_ENABLE_STATS
+    saved += sizeof(crumbs_controller_ctx_t);
+#endif
+#if !CRUMBS_HANDLER_USERDATA
+    /* Both user_data arrays, whether or not the tables themselves remain. */
+    saved += 2u * (size_t)CRUMBS_MAX_HANDLERS * sizeof(void *);
+#endif
+    return saved;
+}
+
 /**
  * @brief Install callbacks and user data on an existing context.
  */
@@ -105,15 +620,17 @@ void crumbs_set_callbacks(crumbs_context_t *ctx,
 /**
  * @brief Register a handler for a specific command type.
  *
- * Uses linear search for slot management (O(n) but safe and portable).
- * When CRUMBS_MAX_HANDLERS == 0, handlers are disabled.
+ * Slot management follows CRUMBS_DISPATCH: linear and direct tables remove
+ * by swapping with the last slot, sorted tables shift to stay in order.
+ * Handlers are disabled when CRUMBS_MAX_HANDLERS == 0 or the context has
+ * no peripheral section.
  */
 int crumbs_register_handler(crumbs_context_t *ctx,
                             uint8_t opcode,
                             crumbs_handler_fn fn,
                             void *user_data)
 {
-#if CRUMBS_MAX_HANDLERS == 0
+#if !CRUMBS_HAS_HANDLER_TABLES
     /* Handlers disabled */
     (void)ctx;
     (void)opcode;
@@ -121,36 +638,63 @@ int crumbs_register_handler(crumbs_context_t *ctx,
     (void)user_data;
     return -1;
 #else
-    /* Linear search table */
     if (!ctx)
     {
         return -1;
     }
+#if !CRUMBS_HANDLER_USERDATA
+    if (user_data)
+    {
+        /* No slot to keep it in; fail rather than drop it. */
+        return -1;
+    }
+#endif
+    crumbs_peripheral_ctx_t *p = &ctx->periph;
 
-    /* Check if command already registered (overwrite) */
-    for (uint8_t i = 0; i < ctx->handler_count; i++)
+    int found = crumbs_table_find(p->handler_opcode, p->handler_count,
+                                  CRUMBS_HANDLER_INDEX(p), opcode);
+    if (found >= 0)
     {
-        if (ctx->handler_opcode[i] == opcode)
+        uint8_t i = (uint8_t)found;
+        if (fn == NULL)
         {
-            if (fn == NULL)
-            {
-                /* Unregister: remove slot by swapping with last */
-                ctx->handler_count--;
-                if (i < ctx->handler_count)
-                {
-                    ctx->handler_opcode[i] = ctx->handler_opcode[ctx->handler_count];
-                    ctx->handlers[i] = ctx->handlers[ctx->handler_count];
-                    ctx->handler_userdata[i] = ctx->handler_userdata[ctx->handler_count];
-                }
-            }
-            else
+            p->handler_count--;
+#if CRUMBS_DISPATCH == CRUMBS_DISPATCH_SORTED
+            /* Unregister: close the gap so the table stays sorted */
+            uint8_t tail = (uint8_t)(p->handler_count - i);
+            memmove(&p->handler_opcode[i], &p->handler_opcode[i + 1u], tail);
+            memmove(&p->handlers[i], &p->handlers[i + 1u], tail * sizeof(p->handlers[0]));
+#if CRUMBS_HANDLER_USERDATA
+            memmove(&p->handler_userdata[i], &p->handler_userdata[i + 1u],
+                    tail * sizeof(p->handler_userdata[0]));
+#endif
+#else
+            /* Unregister: remove slot by swapping with last */
+            if (i < p->handler_count)
             {
-                /* Overwrite existing */
-                ctx->handlers[i] = fn;
-                ctx->handler_userdata[i] = user_data;
+                p->handler_opcode[i] = p->handler_opcode[p->handler_count];
+                p->handlers[i] = p->handlers[p->handler_count];
+#if CRUMBS_HANDLER_USERDATA
+                p->handler_userdata[i] = p->handler_userdata[p->handler_count];
+#endif
+#if CRUMBS_DISPATCH == CRUMBS_DISPATCH_DIRECT
+                p->handler_index[p->handler_opcode[i]] = (uint8_t)(i + 1u);
+#endif
             }
-            return 0;
+#if CRUMBS_DISPATCH == CRUMBS_DISPATCH_DIRECT
+            p->handler_index[opcode] = 0u;
+#endif
+#endif
+        }
+        else
+        {
+            /* Overwrite existing */
+            p->handlers[i] = fn;
+#if CRUMBS_HANDLER_USERDATA
+            p->handler_userdata[i] = user_data;
+#endif
         }
+        return 0;
     }
 
     /* Not found - add new handler if fn is non-NULL */
@@ -160,16 +704,34 @@ int crumbs_register_handler(crumbs_context_t *ctx,
         return 0;
     }
 
-    if (ctx->handler_count >= CRUMBS_MAX_HANDLERS)
+    if (p->handler_count >= CRUMBS_MAX_HANDLERS)
     {
         /* Table full */
         return -1;
     }
 
-    uint8_t slot = ctx->handler_count++;
-    ctx->handler_opcode[slot] = opcode;
-    ctx->handlers[slot] = fn;
-    ctx->handler_userdata[slot] = user_data;
+#if CRUMBS_DISPATCH == CRUMBS_DISPATCH_SORTED
+    /* Insert in opcode order, shifting larger opcodes up one slot */
+    uint8_t slot = crumbs_table_lower_bound(p->handler_opcode, p->handler_count, opcode);
+    uint8_t tail = (uint8_t)(p->handler_count - slot);
+    memmove(&p->handler_opcode[slot + 1u], &p->handler_opcode[slot], tail);
+    memmove(&p->handlers[slot + 1u], &p->handlers[slot], tail * sizeof(p->handlers[0]));
+#if CRUMBS_HANDLER_USERDATA
+    memmove(&p->handler_userdata[slot + 1u], &p->handler_userdata[slot],
+            tail * sizeof(p->handler_userdata[0]));
+#endif
+#else
+    uint8_t slot = p->handler_count;
+#endif
+    p->handler_count++;
+    p->handler_opcode[slot] = opcode;
+    p->handlers[slot] = fn;
+#if CRUMBS_HANDLER_USERDATA
+    p->handler_userdata[slot] = user_data;
+#endif
+#if CRUMBS_DISPATCH == CRUMBS_DISPATCH_DIRECT
+    p->handler_index[opcode] = (uint8_t)(slot + 1u);
+#endif
     return 0;
 #endif
 }
@@ -193,7 +755,7 @@ int crumbs_register_reply_handler(crumbs_context_t *ctx,
                                   crumbs_reply_fn fn,
                                   void *user_data)
 {
-#if CRUMBS_MAX_HANDLERS == 0
+#if !CRUMBS_HAS_HANDLER_TABLES
     /* Handlers disabled */
     (void)ctx;
     (void)opcode;
@@ -205,31 +767,61 @@ int crumbs_register_reply_handler(crumbs_context_t *ctx,
     {
         return -1;
     }
+#if !CRUMBS_HANDLER_USERDATA
+    if (user_data)
+    {
+        /* No slot to keep it in; fail rather than drop it. */
+        return -1;
+    }
+#endif
+    crumbs_peripheral_ctx_t *p = &ctx->periph;
 
     /* Check if opcode already registered (overwrite or unregister). */
-    for (uint8_t i = 0; i < ctx->reply_handler_count; i++)
+    int found = crumbs_table_find(p->reply_handler_opcode, p->reply_handler_count,
+                                  CRUMBS_REPLY_INDEX(p), opcode);
+    if (found >= 0)
     {
-        if (ctx->reply_handler_opcode[i] == opcode)
+        uint8_t i = (uint8_t)found;
+        if (fn == NULL)
         {
-            if (fn == NULL)
-            {
-                /* Unregister: remove slot by swapping with last */
-                ctx->reply_handler_count--;
-                if (i < ctx->reply_handler_count)
-                {
-                    ctx->reply_handler_opcode[i]   = ctx->reply_handler_opcode[ctx->reply_handler_count];
-                    ctx->reply_handlers[i]         = ctx->reply_handlers[ctx->reply_handler_count];
-                    ctx->reply_handler_userdata[i] = ctx->reply_handler_userdata[ctx->reply_handler_count];
-                }
-            }
-            else
+            p->reply_handler_count--;
+#if CRUMBS_DISPATCH == CRUMBS_DISPATCH_SORTED
+            /* Unregister: close the gap so the table stays sorted */
+            uint8_t tail = (uint8_t)(p->reply_handler_count - i);
+            memmove(&p->reply_handler_opcode[i], &p->reply_handler_opcode[i + 1u], tail);
+            memmove(&p->reply_handlers[i], &p->reply_handlers[i + 1u],
+                    tail * sizeof(p->reply_handlers[0]));
+#if CRUMBS_HANDLER_USERDATA
+            memmove(&p->reply_handler_userdata[i], &p->reply_handler_userdata[i + 1u],
+                    tail * sizeof(p->reply_handler_userdata[0]));
+#endif
+#else
+            /* Unregister: remove slot by swapping with last */
+            if (i < p->reply_handler_count)
             {
-                /* Overwrite existing */
-                ctx->reply_handlers[i]         = fn;
-                ctx->reply_handler_userdata[i] = user_data;
+                p->reply_handler_opcode[i]   = p->reply_handler_opcode[p->reply_handler_count];
+                p->reply_handlers[i]         = p->reply_handlers[p->reply_handler_count];
+#if CRUMBS_HANDLER_USERDATA
+                p->reply_handler_userdata[i] = p->reply_handler_userdata[p->reply_handler_count];
+#endif
+#if CRUMBS_DISPATCH == CRUMBS_DISPATCH_DIRECT
+                p->reply_handler_index[p->reply_handler_opcode[i]] = (uint8_t)(i + 1u);
+#endif
             }
-            return 0;
+#if CRUMBS_DISPATCH == CRUMBS_DISPATCH_DIRECT
+            p->reply_handler_index[opcode] = 0u;
+#endif
+#endif
+        }
+        else
+        {
+            /* Overwrite existing */
+            p->reply_handlers[i]         = fn;
+#if CRUMBS_HANDLER_USERDATA
+            p->reply_handler_userdata[i] = user_data;
+#endif
         }
+        return 0;
     }
 
     /* Not found - add new handler if fn is non-NULL */
@@ -239,20 +831,158 @@ int crumbs_register_reply_handler(crumbs_context_t *ctx,
         return 0;
     }
 
-    if (ctx->reply_handler_count >= CRUMBS_MAX_HANDLERS)
+    if (p->reply_handler_count >= CRUMBS_MAX_HANDLERS)
     {
         /* Table full */
         return -1;
     }
 
-    uint8_t slot = ctx->reply_handler_count++;
-    ctx->reply_handler_opcode[slot]   = opcode;
-    ctx->reply_handlers[slot]         = fn;
-    ctx->reply_handler_userdata[slot] = user_data;
+#if CRUMBS_DISPATCH == CRUMBS_DISPATCH_SORTED
+    /* Insert in opcode order, shifting larger opcodes up one slot */
+    uint8_t slot = crumbs_table_lower_bound(p->reply_handler_opcode,
+                                            p->reply_handler_count, opcode);
+    uint8_t tail = (uint8_t)(p->reply_handler_count - slot);
+    memmove(&p->reply_handler_opcode[slot + 1u], &p->reply_handler_opcode[slot], tail);
+    memmove(&p->reply_handlers[slot + 1u], &p->reply_handlers[slot],
+            tail * sizeof(p->reply_handlers[0]));
+#if CRUMBS_HANDLER_USERDATA
+    memmove(&p->reply_handler_userdata[slot + 1u], &p->reply_handler_userdata[slot],
+            tail * sizeof(p->reply_handler_userdata[0]));
+#endif
+#else
+    uint8_t slot = p->reply_handler_count;
+#endif
+    p->reply_handler_count++;
+    p->reply_handler_opcode[slot]   = opcode;
+    p->reply_handlers[slot]         = fn;
+#if CRUMBS_HANDLER_USERDATA
+    p->reply_handler_userdata[slot] = user_data;
+#endif
+#if CRUMBS_DISPATCH == CRUMBS_DISPATCH_DIRECT
+    p->reply_handler_index[opcode] = (uint8_t)(slot + 1u);
+#endif
     return 0;
 #endif
 }
 
+/**
+ * @brief Install a sorted, flash-resident command handler table.
+ */
+int crumbs_set_static_handlers(crumbs_context_t *ctx,
+                               const crumbs_handler_entry_t *table,
+                               size_t count)
+{
+    if (!ctx || count > 255u || (count > 0u && !table))
+    {
+        return -1;
+    }
+
+    if (!crumbs_static_sorted(table, sizeof(*table), count))
+    {
+        CRUMBS_DBG("static handlers: table not sorted by opcode\n");
+        return -1;
+    }
+
+#if CRUMBS_CONTEXT_ROLE != CRUMBS_CONTEXT_CONTROLLER
+    ctx->periph.static_handlers = (count > 0u) ? table : NULL;
+    ctx->periph.static_handler_count = (uint8_t)count;
+    return 0;
+#else
+    return -1; /* no peripheral section */
+#endif
+}
+
+/**
+ * @brief Install a sorted, flash-resident reply handler table.
+ */
+int crumbs_set_static_reply_handlers(crumbs_context_t *ctx,
+                                     const crumbs_reply_entry_t *table,
+                                     size_t count)
+{
+    if (!ctx || count > 255u || (count > 0u && !table))
+    {
+        return -1;
+    }
+
+    if (!crumbs_static_sorted(table, sizeof(*table), count))
+    {
+        CRUMBS_DBG("static reply handlers: table not sorted by opcode\n");
+        return -1;
+    }
+
+#if CRUMBS_CONTEXT_ROLE != CRUMBS_CONTEXT_CONTROLLER
+    ctx->periph.static_reply_handlers = (count > 0u) ? table : NULL;
+    ctx->periph.static_reply_handler_count = (uint8_t)count;
+    return 0;
+#else
+    return -1; /* no peripheral section */
+#endif
+}
+
+/**
+ * @brief Register (or with fn NULL, remove) a command handler for lo..hi.
+ */
+int crumbs_register_handler_range(crumbs_context_t *ctx,
+                                  uint8_t lo,
+                                  uint8_t hi,
+                                  crumbs_handler_fn fn,
+                                  void *user_data)
+{
+#if CRUMBS_HAS_HANDLER_RANGES
+    if (!ctx || lo > hi)
+    {
+        return -1;
+    }
+    crumbs_handler_range_t e = {lo, hi, fn, user_data};
+    return crumbs_range_set(ctx->periph.ranges, sizeof(e), &ctx->periph.range_count,
+                            lo, hi, fn ? &e : NULL);
+#else
+    (void)ctx;
+    (void)lo;
+    (void)hi;
+    (void)fn;
+    (void)user_data;
+    return -1;
+#endif
+}
+
+/**
+ * @brief Register (or with fn NULL, remove) a reply handler for lo..hi.
+ */
+int crumbs_register_reply_handler_range(crumbs_context_t *ctx,
+                                        uint8_t lo,
+                                        uint8_t hi,
+                                        crumbs_reply_fn fn,
+                                        void *user_data)
+{
+#if CRUMBS_HAS_HANDLER_RANGES
+    if (!ctx || lo > hi)
+    {
+        return -1;
+    }
+    crumbs_reply_range_t e = {lo, hi, fn, user_data};
+    return crumbs_range_set(ctx->periph.reply_ranges, sizeof(e), &ctx->periph.reply_range_count,
+                            lo, hi, fn ? &e : NULL);
+#else
+    (void)ctx;
+    (void)lo;
+    (void)hi;
+    (void)fn;
+    (void)user_data;
+    return -1;
+#endif
+}
+
+uint8_t crumbs_handler_offset(const crumbs_context_t *ctx)
+{
+#if CRUMBS_HAS_HANDLER_RANGES
+    return ctx ? ctx->periph.range_offset : 0u;
+#else
+    (void)ctx;
+    return 0u;
+#endif
+}
+
 /**
  * @brief Serialize a crumbs_message_t into a flat byte buffer.
  *
@@ -302,18 +1032,68 @@ size_t crumbs_encode_message(const crumbs_message_t *msg,
 }
 
 /**
- * @brief Decode a serialized frame into a crumbs_message_t.
+ * @brief Encode several messages into fixed-stride frame slots.
+ */
+size_t crumbs_encode_frames(const crumbs_message_t *msgs,
+                            size_t count,
+                            uint8_t (*frames)[CRUMBS_MESSAGE_MAX_SIZE],
+                            size_t *frame_lens)
+{
+    if (!msgs || !frames || !frame_lens)
+    {
+        return 0u;
+    }
+
+    size_t i;
+    for (i = 0u; i < count; i++)
+    {
+        frame_lens[i] = crumbs_encode_message(&msgs[i], frames[i], CRUMBS_MESSAGE_MAX_SIZE);
+        if (frame_lens[i] == 0u)
+        {
+            break;
+        }
+    }
+    return i;
+}
+
+/*
+ * CRC of [n, 0 x n]: the contribution of a data_len byte equal to n, shifted
+ * through the n payload bytes that follow it. XORing it into a CRC computed
+ * with data_len = 0 gives the CRC of the real frame.
+ */
+static const uint8_t k_fb_len_crc[CRUMBS_MAX_PAYLOAD + 1u] = {
+    0x00, 0x15, 0xD6, 0x3A, 0x8F, 0x8D, 0xCC, 0x79, 0xC1, 0x21,
+    0xC6, 0x01, 0xE2, 0x45, 0x04, 0x1E, 0xE0, 0x84, 0xE8, 0xBA,
+    0x7D, 0x26, 0x3E, 0x9C, 0x88, 0x61, 0x62, 0x93};
+
+/**
+ * @brief Patch data_len and the CRC into a frame builder's buffer.
+ */
+size_t crumbs_fb_finish(crumbs_frame_builder_t *fb)
+{
+    if (!fb || fb->data_len > CRUMBS_MAX_PAYLOAD)
+    {
+        return 0u;
+    }
+
+    fb->frame[2] = fb->data_len;
+    fb->frame[k_header_len + fb->data_len] = (uint8_t)(fb->crc ^ k_fb_len_crc[fb->data_len]);
+    return k_header_len + fb->data_len + 1u;
+}
+
+/**
+ * @brief Validate a serialized frame and describe it without copying.
  *
  * Validates frame structure and CRC. Updates CRC state in @p ctx if provided.
  */
-int crumbs_decode_message(const uint8_t *buffer,
-                          size_t buffer_len,
-                          crumbs_message_t *msg,
-                          crumbs_context_t *ctx)
+int crumbs_decode_view(const uint8_t *buffer,
+                       size_t buffer_len,
+                       crumbs_frame_view_t *view,
+                       crumbs_context_t *ctx)
 {
-    if (!buffer || !msg)
+    if (!buffer || !view)
     {
-        CRUMBS_DBG("decode: NULL buffer or msg\n");
+        CRUMBS_DBG("decode: NULL buffer or view\n");
         return -1;
     }
 
@@ -324,7 +1104,10 @@ int crumbs_decode_message(const uint8_t *buffer,
                    (unsigned)buffer_len, (unsigned)k_min_frame_len);
         if (ctx)
         {
-            ctx->last_crc_ok = 0u;
+            CRUMBS_STAT_SET(ctx->last_crc_ok, 0u);
+#if CRUMBS_ENABLE_STATS
+            crumbs_stats_decode_error(ctx, CRUMBS_STATS_ERR_SHORT);
+#endif
         }
         return -1; /* too small */
     }
@@ -337,7 +1120,10 @@ int crumbs_decode_message(const uint8_t *buffer,
                    data_len, CRUMBS_MAX_PAYLOAD);
         if (ctx)
         {
-            ctx->last_crc_ok = 0u;
+            CRUMBS_STAT_SET(ctx->last_crc_ok, 0u);
+#if CRUMBS_ENABLE_STATS
+            crumbs_stats_decode_error(ctx, CRUMBS_STATS_ERR_LEN);
+#endif
         }
         return -1; /* invalid data_len */
     }
@@ -350,7 +1136,10 @@ int crumbs_decode_message(const uint8_t *buffer,
                    (unsigned)buffer_len, (unsigned)expected_len);
         if (ctx)
         {
-            ctx->last_crc_ok = 0u;
+            CRUMBS_STAT_SET(ctx->last_crc_ok, 0u);
+#if CRUMBS_ENABLE_STATS
+            crumbs_stats_decode_error(ctx, CRUMBS_STATS_ERR_SHORT);
+#endif
         }
         return -1; /* truncated frame */
     }
@@ -366,32 +1155,158 @@ int crumbs_decode_message(const uint8_t *buffer,
                    received, computed);
         if (ctx)
         {
-            ctx->last_crc_ok = 0u;
-            ctx->crc_error_count++;
+            CRUMBS_STAT_SET(ctx->last_crc_ok, 0u);
+            CRUMBS_STAT_INC(ctx->crc_error_count);
+#if CRUMBS_ENABLE_STATS
+            crumbs_stats_decode_error(ctx, CRUMBS_STATS_ERR_CRC);
+#endif
         }
         return -2; /* CRC mismatch */
     }
 
+    view->type_id = buffer[0];
+    view->opcode = buffer[1];
+    view->data_len = data_len;
+    view->crc8 = received;
+    view->data = &buffer[k_header_len];
+
+    CRUMBS_DBG("decode: OK type=0x%02X cmd=0x%02X len=%u\n",
+               view->type_id, view->opcode, view->data_len);
+
+    if (ctx)
+    {
+        CRUMBS_STAT_SET(ctx->last_crc_ok, 1u);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Decode a serialized frame into a crumbs_message_t.
+ *
+ * Thin wrapper over crumbs_decode_view() that copies the payload.
+ */
+int crumbs_decode_message(const uint8_t *buffer,
+                          size_t buffer_len,
+                          crumbs_message_t *msg,
+                          crumbs_context_t *ctx)
+{
+    if (!buffer || !msg)
+    {
+        CRUMBS_DBG("decode: NULL buffer or msg\n");
+        return -1;
+    }
+
+    crumbs_frame_view_t view;
+    int rc = crumbs_decode_view(buffer, buffer_len, &view, ctx);
+    if (rc != 0)
+    {
+        return rc;
+    }
+
     /* Populate message fields. address is not transmitted. */
-    msg->type_id = buffer[0];
-    msg->opcode = buffer[1];
-    msg->data_len = data_len;
+    msg->type_id = view.type_id;
+    msg->opcode = view.opcode;
+    msg->data_len = view.data_len;
+    if (view.data_len > 0u)
+    {
+        memcpy(msg->data, view.data, view.data_len);
+    }
+    msg->crc8 = view.crc8;
+
+    return 0;
+}
+
+/* ---- Streaming receive ------------------------------------------------ */
+
+/**
+ * @brief Prepare a streaming decoder for a new frame.
+ */
+void crumbs_rx_reset(crumbs_rx_t *rx)
+{
+    if (!rx)
+    {
+        return;
+    }
+    rx->len = 0u;
+    rx->expected = 0u;
+    rx->crc = crumbs_crc8_init();
+    rx->status = CRUMBS_RX_PENDING;
+}
+
+/**
+ * @brief Append one byte and advance the frame state machine.
+ *
+ * Header and payload bytes are folded into the running CRC as they land;
+ * the CRC byte itself is compared instead of stored-then-rescanned.
+ */
+int crumbs_rx_feed_byte(crumbs_rx_t *rx, uint8_t byte)
+{
+    if (!rx)
+    {
+        return CRUMBS_RX_E_FRAME;
+    }
 
-    if (data_len > 0u)
+    if (rx->status != CRUMBS_RX_PENDING)
     {
-        memcpy(msg->data, &buffer[k_header_len], data_len);
+        return rx->status; /* trailing bytes or sticky error */
     }
 
-    msg->crc8 = received;
+    rx->buf[rx->len++] = byte;
 
-    CRUMBS_DBG("decode: OK type=0x%02X cmd=0x%02X len=%u\n",
-               msg->type_id, msg->opcode, msg->data_len);
+    if (rx->len == k_header_len)
+    {
+        if (byte > CRUMBS_MAX_PAYLOAD)
+        {
+            CRUMBS_DBG("rx: data_len %u > max %u\n", byte, CRUMBS_MAX_PAYLOAD);
+            rx->status = CRUMBS_RX_E_FRAME;
+            return rx->status;
+        }
+        rx->expected = (uint8_t)(k_header_len + byte + 1u);
+    }
 
-    if (ctx)
+    if (rx->len == rx->expected)
+    {
+        crumbs_crc8_t computed = crumbs_crc8_final(rx->crc);
+        if (computed != byte)
+        {
+            CRUMBS_DBG("rx: CRC mismatch (got 0x%02X, expected 0x%02X)\n", byte, computed);
+            rx->status = CRUMBS_RX_E_CRC;
+        }
+        else
+        {
+            rx->status = CRUMBS_RX_COMPLETE;
+        }
+        return rx->status;
+    }
+
+    rx->crc = crumbs_crc8_update(rx->crc, &byte, 1u);
+    return CRUMBS_RX_PENDING;
+}
+
+/**
+ * @brief Describe a completed streaming frame in place.
+ */
+int crumbs_rx_view(const crumbs_rx_t *rx, crumbs_frame_view_t *view)
+{
+    if (!rx || !view)
+    {
+        return -1;
+    }
+    if (rx->status == CRUMBS_RX_E_CRC)
+    {
+        return -2;
+    }
+    if (rx->status != CRUMBS_RX_COMPLETE)
     {
-        ctx->last_crc_ok = 1u;
+        return -1;
     }
 
+    view->type_id = rx->buf[0];
+    view->opcode = rx->buf[1];
+    view->data_len = rx->buf[2];
+    view->crc8 = rx->buf[rx->expected - 1u];
+    view->data = &rx->buf[k_header_len];
     return 0;
 }
 
@@ -427,11 +1342,72 @@ int crumbs_controller_send(const crumbs_context_t *ctx,
     CRUMBS_DBG("tx: addr=0x%02X %u bytes type=0x%02X cmd=0x%02X\n",
                target_addr, (unsigned)written, msg->type_id, msg->opcode);
 
+#if CRUMBS_ENABLE_STATS
+    uint32_t start_us = crumbs_stats_now(ctx);
+#endif
+    CRUMBS_TRACE(ctx, CRUMBS_TRACE_TX_START, msg->opcode, written);
     int rc = write_fn(write_ctx, target_addr, frame, written);
+    CRUMBS_TRACE(ctx, CRUMBS_TRACE_TX_DONE, msg->opcode, written);
+    if (rc != 0)
+    {
+        CRUMBS_DBG("tx: write failed (%d)\n", rc);
+    }
+#if CRUMBS_ENABLE_STATS
+    else
+    {
+        crumbs_stats_controller_tx(ctx, target_addr, start_us);
+    }
+#endif
+    return rc;
+}
+
+/**
+ * @brief Send a frame built in place by crumbs_frame_builder_t.
+ */
+int crumbs_controller_send_frame(const crumbs_context_t *ctx,
+                                 uint8_t target_addr,
+                                 crumbs_frame_builder_t *fb,
+                                 crumbs_i2c_write_fn write_fn,
+                                 void *write_ctx)
+{
+    if (!ctx || !fb || !write_fn)
+    {
+        CRUMBS_DBG("tx: invalid ctx/fb/write_fn\n");
+        return -1;
+    }
+
+    if (ctx->role != CRUMBS_ROLE_CONTROLLER)
+    {
+        CRUMBS_DBG("tx: not controller role\n");
+        return -2;
+    }
+
+    size_t written = crumbs_fb_finish(fb);
+    if (written == 0u)
+    {
+        CRUMBS_DBG("tx: frame finish failed\n");
+        return -1;
+    }
+
+    CRUMBS_DBG("tx: addr=0x%02X %u bytes type=0x%02X cmd=0x%02X\n",
+               target_addr, (unsigned)written, fb->frame[0], fb->frame[1]);
+
+#if CRUMBS_ENABLE_STATS
+    uint32_t start_us = crumbs_stats_now(ctx);
+#endif
+    CRUMBS_TRACE(ctx, CRUMBS_TRACE_TX_START, fb->frame[1], written);
+    int rc = write_fn(write_ctx, target_addr, fb->frame, written);
+    CRUMBS_TRACE(ctx, CRUMBS_TRACE_TX_DONE, fb->frame[1], written);
     if (rc != 0)
     {
         CRUMBS_DBG("tx: write failed (%d)\n", rc);
     }
+#if CRUMBS_ENABLE_STATS
+    else
+    {
+        crumbs_stats_controller_tx(ctx, target_addr, start_us);
+    }
+#endif
     return rc;
 }
 
@@ -443,6 +1419,20 @@ int crumbs_controller_read(crumbs_context_t *ctx,
                            crumbs_message_t *out_msg,
                            crumbs_i2c_read_fn read_fn,
                            void *read_ctx)
+{
+    return crumbs_controller_read_len(ctx, target_addr, out_msg, read_fn, read_ctx,
+                                      CRUMBS_MAX_PAYLOAD);
+}
+
+/**
+ * @brief Read at most 4 + max_payload bytes and decode them.
+ */
+int crumbs_controller_read_len(crumbs_context_t *ctx,
+                               uint8_t target_addr,
+                               crumbs_message_t *out_msg,
+                               crumbs_i2c_read_fn read_fn,
+                               void *read_ctx,
+                               uint8_t max_payload)
 {
     if (!ctx || !out_msg || !read_fn)
     {
@@ -450,125 +1440,557 @@ int crumbs_controller_read(crumbs_context_t *ctx,
         return -1;
     }
 
-    if (ctx->role != CRUMBS_ROLE_CONTROLLER)
+    if (ctx->role != CRUMBS_ROLE_CONTROLLER)
+    {
+        CRUMBS_DBG("rx: not controller role\n");
+        return -1;
+    }
+
+    if (max_payload > CRUMBS_MAX_PAYLOAD)
+    {
+        max_payload = CRUMBS_MAX_PAYLOAD;
+    }
+
+    uint8_t buf[CRUMBS_MESSAGE_MAX_SIZE];
+    CRUMBS_TRACE(ctx, CRUMBS_TRACE_RX_START, 0u, 0u);
+    int n = read_fn(read_ctx, target_addr, buf, k_header_len + max_payload + 1u, 0u);
+    if (n < 4)
+    {
+        CRUMBS_DBG("rx: short read (%d bytes)\n", n);
+        return -1;
+    }
+
+    CRUMBS_DBG("rx: addr=0x%02X %d bytes\n", target_addr, n);
+
+    int rc = crumbs_decode_message(buf, (size_t)n, out_msg, ctx);
+    if (rc == 0)
+    {
+        CRUMBS_TRACE(ctx, CRUMBS_TRACE_DECODE_DONE, out_msg->opcode, out_msg->data_len);
+#if CRUMBS_ENABLE_STATS
+        crumbs_stats_controller_rx(ctx, target_addr, out_msg);
+#endif
+    }
+    return rc;
+}
+
+/**
+ * @brief Peek the header, then read exactly the frame it announces.
+ */
+int crumbs_controller_read_two_phase(crumbs_context_t *ctx,
+                                     uint8_t target_addr,
+                                     crumbs_message_t *out_msg,
+                                     crumbs_i2c_read_fn read_fn,
+                                     void *read_ctx)
+{
+    if (!ctx || !out_msg || !read_fn)
+    {
+        CRUMBS_DBG("rx: invalid ctx/out_msg/read_fn\n");
+        return -1;
+    }
+
+    if (ctx->role != CRUMBS_ROLE_CONTROLLER)
+    {
+        CRUMBS_DBG("rx: not controller role\n");
+        return -1;
+    }
+
+    uint8_t hdr[3];
+    int n = read_fn(read_ctx, target_addr, hdr, sizeof(hdr), 0u);
+    if (n < (int)sizeof(hdr))
+    {
+        CRUMBS_DBG("rx: short header read (%d bytes)\n", n);
+        return -1;
+    }
+
+    if (hdr[2] > CRUMBS_MAX_PAYLOAD)
+    {
+        CRUMBS_DBG("rx: header data_len %u > max\n", hdr[2]);
+        return -1;
+    }
+
+    int rc = crumbs_controller_read_len(ctx, target_addr, out_msg, read_fn, read_ctx, hdr[2]);
+    if (rc == 0 && (out_msg->type_id != hdr[0] || out_msg->opcode != hdr[1] ||
+                    out_msg->data_len != hdr[2]))
+    {
+        /* A stateful reply (cursor page, unasked RESULT) moved on after the header read. */
+        CRUMBS_DBG("rx: reply changed between header and frame\n");
+        return -1;
+    }
+    return rc;
+}
+
+/**
+ * @brief Read a reply, re-reading while the peripheral answers NOT_READY.
+ */
+int crumbs_controller_read_ready(crumbs_context_t *ctx,
+                                 uint8_t target_addr,
+                                 crumbs_message_t *out_msg,
+                                 crumbs_i2c_read_fn read_fn,
+                                 void *read_ctx,
+                                 crumbs_delay_fn delay_fn,
+                                 uint32_t interval_us,
+                                 uint32_t timeout_us)
+{
+    if (!delay_fn)
+    {
+        CRUMBS_DBG("rx: read_ready needs delay_fn\n");
+        return -1;
+    }
+
+    if (interval_us == 0u)
+    {
+        interval_us = CRUMBS_READY_POLL_INTERVAL_US;
+    }
+
+    uint32_t waited = 0u;
+    for (;;)
+    {
+        int rc = crumbs_controller_read(ctx, target_addr, out_msg, read_fn, read_ctx);
+        if (rc != 0 || out_msg->opcode != CRUMBS_CMD_NOT_READY)
+        {
+            return rc;
+        }
+
+        if (waited >= timeout_us)
+        {
+            CRUMBS_DBG("rx: addr=0x%02X still not ready after %lu us\n",
+                       target_addr, (unsigned long)waited);
+            return -3;
+        }
+
+        delay_fn(interval_us);
+        waited += interval_us;
+    }
+}
+
+/**
+ * @brief SET_REPLY interception, on_message and handler dispatch for a
+ *        validated frame. Shared by the buffer and streaming receive paths,
+ *        and by batch records (crumbs_ext.c).
+ */
+void crumbs_peripheral_dispatch_view(crumbs_context_t *ctx,
+                                     const crumbs_frame_view_t *view)
+{
+    /*
+     * Intercept SET_REPLY (0xFE) before user callbacks.
+     * Store the target opcode and return without dispatching to user.
+     */
+    if (view->opcode == CRUMBS_CMD_SET_REPLY)
+    {
+        if (view->data_len >= 1)
+        {
+            ctx->requested_opcode = view->data[0];
+            CRUMBS_DBG("rx: SET_REPLY target=0x%02X\n", ctx->requested_opcode);
+#if CRUMBS_ENABLE_REPLY_CURSOR
+            crumbs_cursor_select(ctx, view);
+#endif
+#if CRUMBS_ENABLE_CHANGE_SEQ
+            ctx->cond_active = 0u;
+#endif
+#if CRUMBS_ENABLE_RESULT
+            ctx->result_armed = 0u;
+#endif
+#if CRUMBS_ENABLE_BULK
+            if (view->data[0] == CRUMBS_CMD_BULK_GET)
+            {
+                crumbs_bulk_select(ctx, view);
+            }
+#endif
+        }
+        else
+        {
+            CRUMBS_DBG("rx: SET_REPLY with no payload, ignoring\n");
+        }
+        return; /* Do not dispatch to user handlers */
+    }
+
+    /* Protocol extensions that are active on this context (0xF0-0xFD). */
+    if (crumbs_ext_handle_frame(ctx, view))
+    {
+        return;
+    }
+
+#if CRUMBS_ENABLE_STAGING
+    /* Latched opcodes wait for CRUMBS_CMD_COMMIT. */
+    if (crumbs_stage_capture(ctx, view))
+    {
+#if CRUMBS_ENABLE_RESULT
+        ctx->result_set = 0u;
+        crumbs_result_record(ctx, view->opcode, CRUMBS_RESULT_STAGED);
+#endif
+        return;
+    }
+#endif
+
+    CRUMBS_TRACE(ctx, CRUMBS_TRACE_DISPATCH_ENTER, view->opcode, view->data_len);
+#if CRUMBS_ENABLE_RESULT
+    ctx->result_set = 0u;
+    uint8_t result = ctx->on_message ? CRUMBS_RESULT_OK : CRUMBS_RESULT_UNHANDLED;
+#endif
+
+    /* Invoke general on_message callback if set (the only path that copies). */
+    if (ctx->on_message)
+    {
+        crumbs_message_t msg;
+        msg.type_id = view->type_id;
+        msg.opcode = view->opcode;
+        msg.data_len = view->data_len;
+        memcpy(msg.data, view->data, view->data_len);
+        msg.crc8 = view->crc8;
+
+        CRUMBS_DBG("rx: calling on_message\n");
+        ctx->on_message(ctx, &msg);
+    }
+
+    /* Dispatch to per-command handler if registered. */
+    crumbs_handler_fn handler = NULL;
+    void *handler_user = NULL;
+    uint8_t offset;
+    if (crumbs_lookup_handler(ctx, view->opcode, &handler, &handler_user, &offset))
+    {
+        if (handler)
+        {
+#if CRUMBS_HAS_HANDLER_RANGES
+            ctx->periph.range_offset = offset;
+#else
+            (void)offset;
+#endif
+#if CRUMBS_ENABLE_RESULT
+            result = CRUMBS_RESULT_OK;
+#endif
+            CRUMBS_DBG("rx: dispatch cmd 0x%02X\n", view->opcode);
+#if CRUMBS_ENABLE_STATS
+            uint32_t start_us = crumbs_stats_now(ctx);
+#endif
+            handler(ctx, view->opcode, view->data, view->data_len, handler_user);
+#if CRUMBS_ENABLE_STATS
+            crumbs_stats_handler(ctx, view->opcode, start_us);
+#endif
+        }
+    }
+    else
+    {
+        CRUMBS_DBG("rx: no handler for cmd 0x%02X\n", view->opcode);
+#if CRUMBS_ENABLE_STATS
+        if (!ctx->on_message)
+        {
+            crumbs_stats_unhandled(ctx);
+        }
+#endif
+    }
+
+#if CRUMBS_ENABLE_RESULT
+    crumbs_result_record(ctx, view->opcode, result);
+#endif
+    CRUMBS_TRACE(ctx, CRUMBS_TRACE_DISPATCH_EXIT, view->opcode, view->data_len);
+}
+
+/**
+ * @brief Dispatch a validated top-level frame now, or queue it for
+ *        crumbs_peripheral_process() when deferred dispatch is on.
+ *
+ * @return 0, or -3 if the ring was full and the frame was dropped.
+ */
+static int crumbs_peripheral_accept_view(crumbs_context_t *ctx,
+                                         const crumbs_frame_view_t *view)
+{
+#if CRUMBS_ENABLE_STATS
+    crumbs_stats_frame_rx(ctx);
+#endif
+#if CRUMBS_ENABLE_RX_QUEUE
+    if (ctx->rxq_enabled && view->opcode != CRUMBS_CMD_SET_REPLY)
+    {
+        uint8_t head = ctx->rxq_head; /* only this side writes it */
+        uint8_t used = (uint8_t)(head - CRUMBS_RING_LOAD(ctx->rxq_tail));
+        if (used >= CRUMBS_RX_QUEUE_DEPTH)
+        {
+            ctx->rxq_overflows++;
+            CRUMBS_DBG("rx: queue full, dropping cmd 0x%02X\n", view->opcode);
+            return -3;
+        }
+
+        crumbs_message_t *slot = &ctx->rxq[head & (CRUMBS_RX_QUEUE_DEPTH - 1u)];
+        slot->type_id = view->type_id;
+        slot->opcode = view->opcode;
+        slot->data_len = view->data_len;
+        memcpy(slot->data, view->data, view->data_len);
+        slot->crc8 = view->crc8;
+        CRUMBS_RING_STORE(ctx->rxq_head, (uint8_t)(head + 1u));
+
+        if ((uint8_t)(used + 1u) > ctx->rxq_high_water)
+        {
+            ctx->rxq_high_water = (uint8_t)(used + 1u);
+        }
+        return 0;
+    }
+#endif
+    crumbs_peripheral_dispatch_view(ctx, view);
+    return 0;
+}
+
+/**
+ * @brief Peripheral-side handler for raw bytes received by a HAL.
+ */
+int crumbs_peripheral_handle_receive(crumbs_context_t *ctx,
+                                     const uint8_t *buffer,
+                                     size_t len)
+{
+    if (!ctx || ctx->role != CRUMBS_ROLE_PERIPHERAL || !buffer)
+    {
+        CRUMBS_DBG("rx: invalid ctx/role/buffer\n");
+        return -1;
+    }
+
+    CRUMBS_TRACE(ctx, CRUMBS_TRACE_RX_START, len > 1u ? buffer[1] : 0u, len);
+    CRUMBS_DBG("rx: %u bytes [", (unsigned)len);
+#ifdef CRUMBS_DEBUG
+    for (size_t i = 0; i < len && i < 8; i++)
+    {
+        CRUMBS_DEBUG_PRINT("%02X ", buffer[i]);
+    }
+    if (len > 8)
+    {
+        CRUMBS_DEBUG_PRINT("...");
+    }
+    CRUMBS_DEBUG_PRINT("]\n");
+#endif
+
+    /* Validate in place; the payload is passed to handlers without copying. */
+    crumbs_frame_view_t view;
+    int rc = crumbs_decode_view(buffer, len, &view, ctx);
+    if (rc != 0)
+    {
+        CRUMBS_DBG("rx: decode failed (%d)\n", rc);
+        return rc;
+    }
+    CRUMBS_TRACE(ctx, CRUMBS_TRACE_DECODE_DONE, view.opcode, view.data_len);
+
+    return crumbs_peripheral_accept_view(ctx, &view);
+}
+
+/**
+ * @brief Dispatch a frame that a streaming decoder already validated.
+ */
+int crumbs_peripheral_handle_rx(crumbs_context_t *ctx, const crumbs_rx_t *rx)
+{
+    if (!ctx || ctx->role != CRUMBS_ROLE_PERIPHERAL || !rx)
+    {
+        CRUMBS_DBG("rx: invalid ctx/role/rx\n");
+        return -1;
+    }
+
+    crumbs_frame_view_t view;
+    int rc = crumbs_rx_view(rx, &view);
+    if (rc != 0)
+    {
+        /* Same statistics crumbs_decode_view() would have recorded. */
+        CRUMBS_STAT_SET(ctx->last_crc_ok, 0u);
+        if (rc == -2)
+        {
+            CRUMBS_STAT_INC(ctx->crc_error_count);
+        }
+#if CRUMBS_ENABLE_STATS
+        if (rc == -2)
+        {
+            crumbs_stats_decode_error(ctx, CRUMBS_STATS_ERR_CRC);
+        }
+        else
+        {
+            crumbs_stats_decode_error(ctx, rx->status == CRUMBS_RX_E_FRAME ? CRUMBS_STATS_ERR_LEN
+                                                                           : CRUMBS_STATS_ERR_SHORT);
+        }
+#endif
+        CRUMBS_DBG("rx: streamed frame rejected (%d)\n", rc);
+        return rc;
+    }
+
+    CRUMBS_STAT_SET(ctx->last_crc_ok, 1u);
+    CRUMBS_TRACE(ctx, CRUMBS_TRACE_DECODE_DONE, view.opcode, view.data_len);
+    return crumbs_peripheral_accept_view(ctx, &view);
+}
+
+int crumbs_set_deferred_dispatch(crumbs_context_t *ctx, int enable)
+{
+#if CRUMBS_ENABLE_RX_QUEUE
+    if (!ctx)
+    {
+        return -1;
+    }
+    ctx->rxq_enabled = enable ? 1u : 0u;
+    return 0;
+#else
+    (void)ctx;
+    (void)enable;
+    return -1;
+#endif
+}
+
+int crumbs_peripheral_process(crumbs_context_t *ctx)
+{
+#if CRUMBS_ENABLE_RX_QUEUE
+    if (!ctx || ctx->role != CRUMBS_ROLE_PERIPHERAL)
+    {
+        return -1;
+    }
+
+    int n = 0;
+    uint8_t tail = ctx->rxq_tail; /* only this side writes it */
+    while (tail != CRUMBS_RING_LOAD(ctx->rxq_head))
     {
-        CRUMBS_DBG("rx: not controller role\n");
-        return -1;
+        const crumbs_message_t *slot = &ctx->rxq[tail & (CRUMBS_RX_QUEUE_DEPTH - 1u)];
+        crumbs_frame_view_t view;
+        view.type_id = slot->type_id;
+        view.opcode = slot->opcode;
+        view.data_len = slot->data_len;
+        view.crc8 = slot->crc8;
+        view.data = slot->data;
+        crumbs_peripheral_dispatch_view(ctx, &view);
+
+        /* The slot is handed back only after its handler has returned. */
+        tail++;
+        CRUMBS_RING_STORE(ctx->rxq_tail, tail);
+        n++;
     }
+    return n;
+#else
+    (void)ctx;
+    return -1;
+#endif
+}
 
-    uint8_t buf[CRUMBS_MESSAGE_MAX_SIZE];
-    int n = read_fn(read_ctx, target_addr, buf, sizeof(buf), 0u);
-    if (n < 4)
+int crumbs_get_rx_queue_stats(const crumbs_context_t *ctx, crumbs_rx_queue_stats_t *out)
+{
+#if CRUMBS_ENABLE_RX_QUEUE
+    if (!ctx || !out)
     {
-        CRUMBS_DBG("rx: short read (%d bytes)\n", n);
         return -1;
     }
 
-    CRUMBS_DBG("rx: addr=0x%02X %d bytes\n", target_addr, n);
+    /* overflows is 16-bit and may change mid-read on 8-bit targets. */
+    uint16_t overflows;
+    do
+    {
+        overflows = ctx->rxq_overflows;
+    } while (overflows != ctx->rxq_overflows);
 
-    return crumbs_decode_message(buf, (size_t)n, out_msg, ctx);
+    out->pending = (uint8_t)(CRUMBS_RING_LOAD(ctx->rxq_head) - CRUMBS_RING_LOAD(ctx->rxq_tail));
+    out->high_water = ctx->rxq_high_water;
+    out->overflows = overflows;
+    return 0;
+#else
+    (void)ctx;
+    (void)out;
+    return -1;
+#endif
 }
 
 /**
- * @brief Peripheral-side handler for raw bytes received by a HAL.
+ * @brief Fill @p msg for ctx->requested_opcode.
+ *
+ * With CRUMBS_ENABLE_RESULT an armed command result comes first, once per
+ * read request. With CRUMBS_ENABLE_CHANGE_SEQ an IF_CHANGED query then
+ * hands the whole lookup to crumbs_changes_reply(), which wraps (or skips)
+ * the reply built by the steps below.
+ *
+ * Dispatch order:
+ *   1. Per-opcode reply handler tables for ctx->requested_opcode: the
+ *      runtime table (crumbs_register_reply_handler), then the static table.
+ *   2. Extension opcodes answered by the core (see crumbs_ext.c).
+ *   3. Reply handler ranges (crumbs_register_reply_range), with the offset
+ *      for crumbs_handler_offset().
+ *   4. on_request callback as fallback (backward-compatible).
+ *
+ * @return 1 if something filled @p msg, 0 if no reply is configured.
  */
-int crumbs_peripheral_handle_receive(crumbs_context_t *ctx,
-                                     const uint8_t *buffer,
-                                     size_t len)
+int crumbs_peripheral_fill_reply(crumbs_context_t *ctx, crumbs_message_t *msg)
 {
-    if (!ctx || ctx->role != CRUMBS_ROLE_PERIPHERAL || !buffer)
+#if CRUMBS_ENABLE_RESULT
+    /* The read after a command carries its result, once. */
+    if (ctx->result_armed)
     {
-        CRUMBS_DBG("rx: invalid ctx/role/buffer\n");
-        return -1;
+        ctx->result_armed = 0u;
+        return crumbs_result_reply(ctx, msg);
     }
+#endif
 
-    CRUMBS_DBG("rx: %u bytes [", (unsigned)len);
-#ifdef CRUMBS_DEBUG
-    for (size_t i = 0; i < len && i < 8; i++)
-    {
-        CRUMBS_DEBUG_PRINT("%02X ", buffer[i]);
-    }
-    if (len > 8)
+#if CRUMBS_ENABLE_CHANGE_SEQ
+    /* A conditional GET wraps the reply (or skips it) in crumbs_changes.c. */
+    if (ctx->cond_active)
     {
-        CRUMBS_DEBUG_PRINT("...");
+        return crumbs_changes_reply(ctx, msg);
     }
-    CRUMBS_DEBUG_PRINT("]\n");
 #endif
 
-    crumbs_message_t msg;
-    memset(&msg, 0, sizeof(msg));
+    memset(msg, 0, sizeof(*msg));
 
-    int rc = crumbs_decode_message(buffer, len, &msg, ctx);
-    if (rc != 0)
+    /* Check per-opcode reply handler tables first. */
+    crumbs_reply_fn reply_fn = NULL;
+    void *reply_user = NULL;
+    if (crumbs_lookup_reply_handler(ctx, ctx->requested_opcode, &reply_fn, &reply_user) &&
+        reply_fn)
     {
-        CRUMBS_DBG("rx: decode failed (%d)\n", rc);
-        return rc;
+        CRUMBS_DBG("reply: dispatch opcode 0x%02X via reply handler\n",
+                   ctx->requested_opcode);
+#if CRUMBS_HAS_HANDLER_RANGES
+        ctx->periph.range_offset = 0u;
+#endif
+#if CRUMBS_ENABLE_STATS
+        uint32_t start_us = crumbs_stats_now(ctx);
+#endif
+        reply_fn(ctx, msg, reply_user);
+#if CRUMBS_ENABLE_STATS
+        crumbs_stats_reply(ctx, ctx->requested_opcode, start_us);
+#endif
+        return 1;
     }
 
-    /*
-     * Intercept SET_REPLY (0xFE) before user callbacks.
-     * Store the target opcode and return without dispatching to user.
-     */
-    if (msg.opcode == CRUMBS_CMD_SET_REPLY)
+    /* Then extension opcodes the core answers itself (CAPABILITIES, ...). */
+    if (crumbs_ext_build_reply(ctx, msg))
     {
-        if (msg.data_len >= 1)
-        {
-            ctx->requested_opcode = msg.data[0];
-            CRUMBS_DBG("rx: SET_REPLY target=0x%02X\n", ctx->requested_opcode);
-        }
-        else
-        {
-            CRUMBS_DBG("rx: SET_REPLY with no payload, ignoring\n");
-        }
-        return 0; /* Do not dispatch to user handlers */
+        CRUMBS_DBG("reply: opcode 0x%02X answered by core\n", ctx->requested_opcode);
+        return 1;
     }
 
-    /* Invoke general on_message callback if set. */
-    if (ctx->on_message)
+#if CRUMBS_HAS_HANDLER_RANGES
+    /* Then opcode ranges, with the offset for crumbs_handler_offset(). */
+    if (crumbs_lookup_reply_range(ctx, ctx->requested_opcode, &reply_fn, &reply_user,
+                                  &ctx->periph.range_offset) &&
+        reply_fn)
     {
-        CRUMBS_DBG("rx: calling on_message\n");
-        ctx->on_message(ctx, &msg);
+        CRUMBS_DBG("reply: dispatch opcode 0x%02X via reply range\n", ctx->requested_opcode);
+#if CRUMBS_ENABLE_STATS
+        uint32_t start_us = crumbs_stats_now(ctx);
+#endif
+        reply_fn(ctx, msg, reply_user);
+#if CRUMBS_ENABLE_STATS
+        crumbs_stats_reply(ctx, ctx->requested_opcode, start_us);
+#endif
+        return 1;
     }
+#endif
 
-#if CRUMBS_MAX_HANDLERS > 0
-    /* Dispatch to per-command handler if registered (linear search). */
-    uint8_t found = 0;
-    for (uint8_t i = 0; i < ctx->handler_count; i++)
-    {
-        if (ctx->handler_opcode[i] == msg.opcode)
-        {
-            crumbs_handler_fn handler = ctx->handlers[i];
-            if (handler)
-            {
-                CRUMBS_DBG("rx: dispatch cmd 0x%02X (slot %u)\n", msg.opcode, i);
-                handler(ctx,
-                        msg.opcode,
-                        msg.data,
-                        msg.data_len,
-                        ctx->handler_userdata[i]);
-            }
-            found = 1;
-            break;
-        }
-    }
-    if (!found)
+    if (!ctx->on_request)
     {
-        CRUMBS_DBG("rx: no handler for cmd 0x%02X (searched %u slots)\n",
-                   msg.opcode, ctx->handler_count);
+        CRUMBS_DBG("reply: no reply handler or on_request callback\n");
+        return 0;
     }
-#endif /* CRUMBS_MAX_HANDLERS > 0 */
 
-    return 0;
+    CRUMBS_DBG("reply: calling on_request\n");
+#if CRUMBS_ENABLE_STATS
+    uint32_t start_us = crumbs_stats_now(ctx);
+#endif
+    ctx->on_request(ctx, msg);
+#if CRUMBS_ENABLE_STATS
+    crumbs_stats_reply(ctx, ctx->requested_opcode, start_us);
+#endif
+    return 1;
 }
 
 /**
- * @brief Build an encoded reply using reply handlers or the on_request callback.
+ * @brief Build an encoded reply: the ready pre-built frame if there is one,
+ *        otherwise crumbs_peripheral_fill_reply() and encode.
  *
- * Dispatch order:
- *   1. Per-opcode reply handler table (crumbs_register_reply_handler) for
- *      ctx->requested_opcode.
- *   2. on_request callback as fallback (backward-compatible).
- *   3. No reply configured — returns 0 with *out_len = 0.
+ * No reply configured returns 0 with *out_len = 0.
  */
 int crumbs_peripheral_build_reply(crumbs_context_t *ctx,
                                   uint8_t *out_buf,
@@ -586,40 +2008,32 @@ int crumbs_peripheral_build_reply(crumbs_context_t *ctx,
         return -1;
     }
 
-    crumbs_message_t msg;
-    memset(&msg, 0, sizeof(msg));
-
-    int dispatched = 0;
-
-#if CRUMBS_MAX_HANDLERS > 0
-    /* Check per-opcode reply handler table first. */
-    for (uint8_t i = 0; i < ctx->reply_handler_count; i++)
+    const uint8_t *ready = NULL;
+    size_t ready_len = 0u;
+    if (crumbs_peripheral_ready_reply(ctx, &ready, &ready_len) && ready_len <= out_buf_len)
     {
-        if (ctx->reply_handler_opcode[i] == ctx->requested_opcode)
+        memcpy(out_buf, ready, ready_len);
+        if (out_len)
         {
-            crumbs_reply_fn handler = ctx->reply_handlers[i];
-            if (handler)
-            {
-                CRUMBS_DBG("reply: dispatch opcode 0x%02X via reply handler (slot %u)\n",
-                           ctx->requested_opcode, i);
-                handler(ctx, &msg, ctx->reply_handler_userdata[i]);
-                dispatched = 1;
-            }
-            break;
+            *out_len = ready_len;
         }
+#if CRUMBS_ENABLE_STATS
+        crumbs_stats_frame_tx(ctx);
+#endif
+        CRUMBS_TRACE(ctx, CRUMBS_TRACE_REPLY_BUILT, ready[1], ready_len);
+#if CRUMBS_ENABLE_REPLY_CURSOR
+        crumbs_cursor_advance(ctx, ready[1]);
+#endif
+#if CRUMBS_ENABLE_ATTENTION
+        crumbs_attention_delivered(ctx, ready[1]);
+#endif
+        return 0;
     }
-#endif /* CRUMBS_MAX_HANDLERS > 0 */
 
-    if (!dispatched)
+    crumbs_message_t msg;
+    if (!crumbs_peripheral_fill_reply(ctx, &msg))
     {
-        if (!ctx->on_request)
-        {
-            CRUMBS_DBG("reply: no reply handler or on_request callback\n");
-            return 0;
-        }
-
-        CRUMBS_DBG("reply: calling on_request\n");
-        ctx->on_request(ctx, &msg);
+        return 0;
     }
 
     size_t written = crumbs_encode_message(&msg, out_buf, out_buf_len);
@@ -631,6 +2045,16 @@ int crumbs_peripheral_build_reply(crumbs_context_t *ctx,
 
     CRUMBS_DBG("reply: %u bytes type=0x%02X cmd=0x%02X\n",
                (unsigned)written, msg.type_id, msg.opcode);
+#if CRUMBS_ENABLE_STATS
+    crumbs_stats_frame_tx(ctx);
+#endif
+    CRUMBS_TRACE(ctx, CRUMBS_TRACE_REPLY_BUILT, msg.opcode, written);
+#if CRUMBS_ENABLE_REPLY_CURSOR
+    crumbs_cursor_advance(ctx, msg.opcode);
+#endif
+#if CRUMBS_ENABLE_ATTENTION
+    crumbs_attention_delivered(ctx, msg.opcode);
+#endif
 
     if (out_len)
     {
@@ -639,6 +2063,189 @@ int crumbs_peripheral_build_reply(crumbs_context_t *ctx,
     return 0;
 }
 
+#if CRUMBS_ENABLE_REPLY_CACHE
+/**
+ * @brief Encode @p msg into the back slot and make it current.
+ *
+ * The request handler only ever reads the front slot, and the swap is a
+ * single byte store, so it sees either the old frame or the new one.
+ */
+static int crumbs_reply_cache_store(crumbs_context_t *ctx, const crumbs_message_t *msg, uint8_t opcode)
+{
+    uint8_t back = (ctx->reply_front == 0u) ? 1u : 0u;
+    size_t written = crumbs_encode_message(msg, ctx->reply_frame[back], sizeof(ctx->reply_frame[back]));
+    if (written == 0u)
+    {
+        CRUMBS_DBG("reply cache: encode failed\n");
+        return -2;
+    }
+    ctx->reply_frame_len[back] = (uint8_t)written;
+    ctx->reply_frame_opcode[back] = opcode;
+    ctx->reply_front = back;
+    return 0;
+}
+#endif
+
+int crumbs_peripheral_refresh_reply(crumbs_context_t *ctx)
+{
+#if CRUMBS_ENABLE_REPLY_CACHE
+    if (!ctx || ctx->role != CRUMBS_ROLE_PERIPHERAL)
+    {
+        return -1;
+    }
+
+    uint8_t opcode = ctx->requested_opcode;
+    uint8_t front = ctx->reply_front;
+    if (front != CRUMBS_REPLY_NONE && !ctx->reply_stale &&
+        ctx->reply_frame_opcode[front] == opcode)
+    {
+        return 0;
+    }
+
+#if CRUMBS_ENABLE_RESULT
+    /* Building now would hand the pending result to the cache. */
+    if (ctx->result_armed)
+    {
+        return 0;
+    }
+#endif
+
+    /* Cleared before building, so an invalidate during the build sticks. */
+    ctx->reply_stale = 0u;
+
+    crumbs_message_t msg;
+    if (!crumbs_peripheral_fill_reply(ctx, &msg) || msg.opcode == CRUMBS_CMD_NOT_READY)
+    {
+        ctx->reply_front = CRUMBS_REPLY_NONE;
+        return 0;
+    }
+
+    int rc = crumbs_reply_cache_store(ctx, &msg, opcode);
+    return rc == 0 ? 1 : rc;
+#else
+    (void)ctx;
+    return -1;
+#endif
+}
+
+int crumbs_peripheral_publish_reply(crumbs_context_t *ctx, const crumbs_message_t *msg)
+{
+#if CRUMBS_ENABLE_REPLY_CACHE
+    if (!ctx || !msg || ctx->role != CRUMBS_ROLE_PERIPHERAL)
+    {
+        return -1;
+    }
+    ctx->reply_stale = 0u;
+    return crumbs_reply_cache_store(ctx, msg, msg->opcode);
+#else
+    (void)ctx;
+    (void)msg;
+    return -1;
+#endif
+}
+
+void crumbs_peripheral_invalidate_reply(crumbs_context_t *ctx)
+{
+#if CRUMBS_ENABLE_REPLY_CACHE
+    if (ctx)
+    {
+        ctx->reply_stale = 1u;
+    }
+#else
+    (void)ctx;
+#endif
+}
+
+int crumbs_peripheral_ready_reply(const crumbs_context_t *ctx, const uint8_t **frame, size_t *len)
+{
+#if CRUMBS_ENABLE_REPLY_CACHE
+    if (!ctx || !frame || !len)
+    {
+        return 0;
+    }
+
+    uint8_t front = ctx->reply_front;
+    if (front == CRUMBS_REPLY_NONE || ctx->reply_stale ||
+        ctx->reply_frame_opcode[front] != ctx->requested_opcode)
+    {
+        return 0;
+    }
+#if CRUMBS_ENABLE_RESULT
+    if (ctx->result_armed)
+    {
+        return 0;
+    }
+#endif
+    *frame = ctx->reply_frame[front];
+    *len = ctx->reply_frame_len[front];
+    return 1;
+#else
+    (void)ctx;
+    (void)frame;
+    (void)len;
+    return 0;
+#endif
+}
+
+/**
+ * @brief SET_REPLY + read in one repeated-START transaction.
+ */
+int crumbs_controller_query(crumbs_context_t *ctx,
+                            uint8_t target_addr,
+                            uint8_t opcode,
+                            crumbs_message_t *out_msg,
+                            crumbs_i2c_write_read_fn write_read_fn,
+                            void *io)
+{
+    if (!ctx || !out_msg || !write_read_fn)
+    {
+        CRUMBS_DBG("query: invalid ctx/out_msg/write_read_fn\n");
+        return -1;
+    }
+
+    if (ctx->role != CRUMBS_ROLE_CONTROLLER)
+    {
+        CRUMBS_DBG("query: not controller role\n");
+        return -1;
+    }
+
+    crumbs_frame_builder_t fb;
+    crumbs_fb_init(&fb, 0u, CRUMBS_CMD_SET_REPLY);
+    crumbs_fb_add_u8(&fb, opcode);
+    size_t tx_len = crumbs_fb_finish(&fb);
+
+    uint8_t buf[CRUMBS_MESSAGE_MAX_SIZE];
+    int n = write_read_fn(io, target_addr, fb.frame, tx_len, buf, sizeof(buf), 0u, 1);
+    if (n == CRUMBS_I2C_DEV_E_NO_REPEATED_START)
+    {
+        CRUMBS_DBG("query: transport has no repeated START\n");
+        return n;
+    }
+    if (n < 4)
+    {
+        CRUMBS_DBG("query: short transfer (%d bytes)\n", n);
+        return -1;
+    }
+
+    CRUMBS_DBG("query: addr=0x%02X opcode=0x%02X %d bytes\n", target_addr, opcode, n);
+
+    return crumbs_decode_message(buf, (size_t)n, out_msg, ctx);
+}
+
+/**
+ * @brief Mark a reply as NOT_READY: type_id 0, opcode 0xFA, no payload.
+ */
+void crumbs_reply_not_ready(crumbs_message_t *reply)
+{
+    if (!reply)
+    {
+        return;
+    }
+    reply->type_id = 0u;
+    reply->opcode = CRUMBS_CMD_NOT_READY;
+    reply->data_len = 0u;
+}
+
 /**
  * @brief Probe an address range looking for CRUMBS-capable devices with type IDs.
  *
@@ -807,6 +2414,79 @@ int crumbs_controller_scan_for_crumbs_candidates(const crumbs_context_t *ctx,
     return (int)total;
 }
 
+/**
+ * @brief Prefilter by address ACK, then probe only the addresses that answered.
+ */
+int crumbs_controller_scan_for_crumbs_fast(const crumbs_context_t *ctx,
+                                           uint8_t start_addr,
+                                           uint8_t end_addr,
+                                           int strict,
+                                           crumbs_i2c_scan_fn scan_fn,
+                                           crumbs_i2c_write_fn write_fn,
+                                           crumbs_i2c_read_fn read_fn,
+                                           crumbs_i2c_write_read_fn write_read_fn,
+                                           void *io_ctx,
+                                           uint8_t *found,
+                                           uint8_t *types,
+                                           size_t max_found,
+                                           uint32_t timeout_us)
+{
+    if (!scan_fn || (!read_fn && !write_read_fn) || !found || max_found == 0u)
+        return -1;
+
+    if (start_addr > end_addr || end_addr > 0x7Fu)
+        return -1;
+
+    /* Phase 1: address-only probe. Cheap on empty addresses. */
+    uint8_t acked[128];
+    int n_acked = scan_fn(io_ctx, start_addr, end_addr, 0, acked, sizeof(acked));
+    if (n_acked < 0)
+        return n_acked;
+    if ((size_t)n_acked > sizeof(acked))
+        n_acked = (int)sizeof(acked);
+
+    /* Phase 2: CRUMBS probe on ACKing addresses only. */
+    crumbs_frame_builder_t fb;
+    crumbs_fb_init(&fb, 0u, CRUMBS_CMD_SET_REPLY);
+    crumbs_fb_add_u8(&fb, 0x00u); /* version opcode, the peripheral default */
+    size_t probe_len = crumbs_fb_finish(&fb);
+
+    uint8_t buf[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t count = 0u;
+    for (int i = 0; i < n_acked && count < max_found; ++i)
+    {
+        uint8_t addr = acked[i];
+
+        if (write_read_fn)
+        {
+            int n = write_read_fn(io_ctx, addr, fb.frame, probe_len,
+                                  buf, sizeof(buf), timeout_us, 1);
+            crumbs_message_t m;
+            if (n >= (int)k_min_frame_len &&
+                crumbs_decode_message(buf, (size_t)n, &m, NULL) == 0)
+            {
+                found[count] = addr;
+                if (types)
+                    types[count] = m.type_id;
+                ++count;
+                continue;
+            }
+        }
+
+        if (!read_fn)
+            continue;
+
+        int n = crumbs_controller_scan_for_crumbs_with_types(
+            ctx, addr, addr, strict, write_fn, read_fn, io_ctx,
+            &found[count], types ? &types[count] : NULL, max_found - count, timeout_us);
+        if (n < 0)
+            return n;
+        count += (size_t)n;
+    }
+
+    return (int)count;
+}
+
 /* ---- CRC stats helpers ------------------------------------------------- */
 
 /**
@@ -817,7 +2497,7 @@ int crumbs_controller_scan_for_crumbs_candidates(const crumbs_context_t *ctx,
  */
 uint32_t crumbs_get_crc_error_count(const crumbs_context_t *ctx)
 {
-    return ctx ? ctx->crc_error_count : 0u;
+    return ctx ? CRUMBS_STAT_GET(ctx->crc_error_count) : 0u;
 }
 
 /**
@@ -828,7 +2508,7 @@ uint32_t crumbs_get_crc_error_count(const crumbs_context_t *ctx)
  */
 int crumbs_last_crc_ok(const crumbs_context_t *ctx)
 {
-    return (ctx && ctx->last_crc_ok) ? 1 : 0;
+    return (ctx && CRUMBS_STAT_GET(ctx->last_crc_ok)) ? 1 : 0;
 }
 
 /**
@@ -842,6 +2522,32 @@ void crumbs_reset_crc_stats(crumbs_context_t *ctx)
     {
         return;
     }
-    ctx->crc_error_count = 0u;
-    ctx->last_crc_ok = 1u;
+    CRUMBS_STAT_SET(ctx->crc_error_count, 0u);
+    CRUMBS_STAT_SET(ctx->last_crc_ok, 1u);
+}
+
+/**
+ * @brief Install the trace hook called at the CRUMBS_TRACE_* points.
+ */
+int crumbs_set_trace_hook(crumbs_context_t *ctx,
+                          crumbs_trace_fn fn,
+                          crumbs_clock_us_fn clock,
+                          void *user_data)
+{
+#if CRUMBS_ENABLE_TRACE
+    if (!ctx)
+    {
+        return -1;
+    }
+    ctx->trace_clock = clock;
+    ctx->trace_user = user_data;
+    ctx->trace_fn = fn;
+    return 0;
+#else
+    (void)ctx;
+    (void)fn;
+    (void)clock;
+    (void)user_data;
+    return -1;
+#endif
 }
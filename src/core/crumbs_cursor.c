@@ -0,0 +1,134 @@
+/**
+ * @file
+ * @brief Auto-advancing reply cursor for paged reads.
+ *
+ * crumbs_peripheral_dispatch_view() hands every SET_REPLY to
+ * crumbs_cursor_select(), and crumbs_peripheral_build_reply() calls
+ * crumbs_cursor_advance() once a reply frame is out. The controller
+ * helpers are always built.
+ */
+
+#include "crumbs_internal.h"
+#include "crumbs_latency.h"
+
+/* ---- Peripheral side ---------------------------------------------------- */
+
+uint8_t crumbs_reply_cursor(const crumbs_context_t *ctx)
+{
+#if CRUMBS_ENABLE_REPLY_CURSOR
+    return (ctx && ctx->cursor_mode != CRUMBS_CURSOR_OFF) ? ctx->cursor_index : 0u;
+#else
+    (void)ctx;
+    return 0u;
+#endif
+}
+
+#if CRUMBS_ENABLE_REPLY_CURSOR
+void crumbs_cursor_select(crumbs_context_t *ctx, const crumbs_frame_view_t *view)
+{
+    uint8_t mode = view->data_len >= 2u ? view->data[1] : CRUMBS_CURSOR_OFF;
+    if (view->data[0] == CRUMBS_CMD_BULK_GET ||
+        (mode != CRUMBS_CURSOR_OPCODE && mode != CRUMBS_CURSOR_INDEX))
+    {
+        mode = CRUMBS_CURSOR_OFF; /* the bulk list shares this payload */
+    }
+
+    ctx->cursor_mode = mode;
+    ctx->cursor_first = view->data[0];
+    ctx->cursor_count = view->data_len >= 3u ? view->data[2] : 0u;
+    ctx->cursor_index = 0u;
+}
+
+void crumbs_cursor_advance(crumbs_context_t *ctx, uint8_t reply_opcode)
+{
+    if (ctx->cursor_mode == CRUMBS_CURSOR_OFF || reply_opcode == CRUMBS_CMD_NOT_READY)
+    {
+        return;
+    }
+
+    uint8_t expected = ctx->cursor_first;
+    if (ctx->cursor_mode == CRUMBS_CURSOR_OPCODE)
+    {
+        expected = (uint8_t)(expected + ctx->cursor_index);
+    }
+    if (ctx->requested_opcode != expected)
+    {
+        ctx->cursor_mode = CRUMBS_CURSOR_OFF; /* REG_READ or similar took over */
+        return;
+    }
+
+    uint8_t next = (uint8_t)(ctx->cursor_index + 1u);
+    if (next == ctx->cursor_count)
+    {
+        next = 0u; /* count 0 wraps at 256 on its own */
+    }
+    ctx->cursor_index = next;
+    if (ctx->cursor_mode == CRUMBS_CURSOR_OPCODE)
+    {
+        ctx->requested_opcode = (uint8_t)(ctx->cursor_first + next);
+    }
+}
+#endif
+
+/* ---- Controller side ---------------------------------------------------- */
+
+int crumbs_controller_set_cursor(const crumbs_device_t *dev,
+                                 uint8_t opcode,
+                                 uint8_t mode,
+                                 uint8_t count)
+{
+    if (!dev || !dev->ctx || !dev->write_fn)
+    {
+        return -1;
+    }
+
+    crumbs_frame_builder_t fb;
+    crumbs_fb_init(&fb, 0u, CRUMBS_CMD_SET_REPLY);
+    crumbs_fb_add_u8(&fb, opcode);
+    crumbs_fb_add_u8(&fb, mode);
+    crumbs_fb_add_u8(&fb, count);
+    return crumbs_controller_send_frame(dev->ctx, dev->addr, &fb, dev->write_fn, dev->io);
+}
+
+int crumbs_controller_read_sequence(const crumbs_device_t *dev,
+                                    uint8_t opcode,
+                                    uint8_t mode,
+                                    uint8_t count,
+                                    crumbs_message_t *out)
+{
+    if (!dev || !dev->read_fn || !dev->delay_fn || !out || count == 0u ||
+        (mode != CRUMBS_CURSOR_OPCODE && mode != CRUMBS_CURSOR_INDEX))
+    {
+        return -1;
+    }
+
+    int rc = crumbs_controller_set_cursor(dev, opcode, mode, count);
+    if (rc != 0)
+    {
+        return rc;
+    }
+
+    uint32_t delay_us = crumbs_device_query_delay(dev, opcode);
+    dev->delay_fn(delay_us);
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        uint8_t expected = mode == CRUMBS_CURSOR_OPCODE ? (uint8_t)(opcode + i) : opcode;
+        rc = crumbs_controller_read_ready(dev->ctx, dev->addr, &out[i], dev->read_fn, dev->io,
+                                          dev->delay_fn, CRUMBS_READY_POLL_INTERVAL_US,
+                                          CRUMBS_READY_POLL_TIMEOUT_US);
+        if (rc == 0 && out[i].opcode != expected)
+        {
+            rc = -1;
+        }
+        if (i == 0u)
+        {
+            crumbs_device_query_result(dev, opcode, delay_us, rc == 0);
+        }
+        if (rc != 0)
+        {
+            return rc;
+        }
+    }
+    return 0;
+}
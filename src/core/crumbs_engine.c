@@ -0,0 +1,428 @@
+/**
+ * @file
+ * @brief Non-blocking controller request engine (see crumbs_engine.h).
+ */
+
+#include "crumbs_engine.h"
+
+#include <string.h> /* memset */
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+/** @brief Wraparound-safe "a is at or after b" for a free-running clock. */
+static int crumbs_time_reached(uint32_t now_us, uint32_t due_us)
+{
+    return (int32_t)(now_us - due_us) >= 0;
+}
+
+/** @brief Two devices are the same target if they share bus handle and address. */
+static int crumbs_same_target(const crumbs_device_t *a, const crumbs_device_t *b)
+{
+    return a->addr == b->addr && a->io == b->io && a->write_fn == b->write_fn;
+}
+
+/**
+ * @brief Request to the same device that is still awaiting its reply, if any.
+ *
+ * Looks at the whole queue, not just earlier entries: a control request is
+ * queued ahead of telemetry GETs that may already have written SET_REPLY.
+ */
+static crumbs_request_t *crumbs_target_blocker(const crumbs_engine_t *eng, const crumbs_request_t *req)
+{
+    for (crumbs_request_t *r = eng->head; r; r = r->next)
+    {
+        if (r != req && (r->state == CRUMBS_REQ_WAITING || r->state == CRUMBS_REQ_POLLING) &&
+            crumbs_same_target(r->dev, req->dev))
+        {
+            return r;
+        }
+    }
+    return NULL;
+}
+
+/** @brief Whether @p req can write now, postponing a lower-lane blocker if needed. */
+static int crumbs_target_ready(crumbs_engine_t *eng, crumbs_request_t *req)
+{
+    crumbs_request_t *r = crumbs_target_blocker(eng, req);
+    if (r && r->lane < req->lane)
+    {
+        /* The GET's reply is abandoned; it writes SET_REPLY again later. */
+        r->state = CRUMBS_REQ_QUEUED;
+        eng->lanes[r->lane].postponed++;
+        r = NULL;
+    }
+    return r == NULL;
+}
+
+static void crumbs_lane_record(crumbs_engine_t *eng, const crumbs_request_t *req, uint32_t now_us)
+{
+    crumbs_lane_stats_t *st = &eng->lanes[req->lane];
+    uint32_t latency = now_us - req->start_us;
+    st->completed++;
+    st->last_latency_us = latency;
+    if (latency > st->max_latency_us)
+    {
+        st->max_latency_us = latency;
+    }
+}
+
+/** @brief Unlink @p req (predecessor @p prev) and mark it idle. */
+static void crumbs_engine_unlink(crumbs_engine_t *eng, crumbs_request_t *prev, crumbs_request_t *req)
+{
+    if (prev)
+    {
+        prev->next = req->next;
+    }
+    else
+    {
+        eng->head = req->next;
+    }
+    if (eng->tail == req)
+    {
+        eng->tail = prev;
+    }
+    req->next = NULL;
+    req->state = CRUMBS_REQ_IDLE;
+}
+
+/* ---- Public API --------------------------------------------------------- */
+
+void crumbs_engine_init(crumbs_engine_t *eng)
+{
+    if (!eng)
+    {
+        return;
+    }
+    eng->head = NULL;
+    eng->tail = NULL;
+    memset(eng->lanes, 0, sizeof(eng->lanes));
+    eng->group_io = 0u;
+}
+
+void crumbs_request_init(crumbs_request_t *req,
+                         const crumbs_device_t *dev,
+                         uint8_t opcode,
+                         crumbs_request_cb on_done,
+                         void *user_data)
+{
+    if (!req)
+    {
+        return;
+    }
+    req->dev = dev;
+    req->on_done = on_done;
+    req->user_data = user_data;
+    req->delay_us = 0u;
+    req->opcode = opcode;
+    req->state = CRUMBS_REQ_IDLE;
+    req->reply_len = CRUMBS_MAX_PAYLOAD;
+    req->lane = CRUMBS_LANE_TELEMETRY;
+    req->stamped = 0u;
+    req->cmd = NULL;
+    req->start_us = 0u;
+    req->wait_us = 0u;
+    req->due_us = 0u;
+    req->poll_us = 0u;
+    req->next = NULL;
+}
+
+void crumbs_request_init_send(crumbs_request_t *req,
+                              const crumbs_device_t *dev,
+                              const crumbs_message_t *cmd,
+                              crumbs_request_cb on_done,
+                              void *user_data)
+{
+    if (!req)
+    {
+        return;
+    }
+    crumbs_request_init(req, dev, cmd ? cmd->opcode : 0u, on_done, user_data);
+    req->cmd = cmd;
+    req->lane = CRUMBS_LANE_CONTROL;
+}
+
+int crumbs_engine_submit(crumbs_engine_t *eng, crumbs_request_t *req)
+{
+    if (!eng || !req || !req->dev || !req->dev->ctx || !req->dev->write_fn ||
+        (!req->cmd && !req->dev->read_fn) || req->lane >= CRUMBS_ENGINE_LANES)
+    {
+        return -1;
+    }
+
+    if (req->state != CRUMBS_REQ_IDLE)
+    {
+        return -1; /* Already queued. */
+    }
+
+    req->state = CRUMBS_REQ_QUEUED;
+    req->stamped = 0u;
+
+    /* Insert after the last request of the same or a higher lane. */
+    crumbs_request_t *prev = NULL;
+    if (eng->tail && eng->tail->lane >= req->lane)
+    {
+        prev = eng->tail;
+    }
+    else
+    {
+        for (crumbs_request_t *r = eng->head; r && r->lane >= req->lane; r = r->next)
+        {
+            prev = r;
+        }
+    }
+    if (eng->group_io)
+    {
+        /* Join the last request of the lane on the same bus path, if any. */
+        for (crumbs_request_t *r = eng->head; r && r->lane >= req->lane; r = r->next)
+        {
+            if (r->lane == req->lane && r->dev->io == req->dev->io)
+            {
+                prev = r;
+            }
+        }
+    }
+
+    req->next = prev ? prev->next : eng->head;
+    if (prev)
+    {
+        prev->next = req;
+    }
+    else
+    {
+        eng->head = req;
+    }
+    if (!req->next)
+    {
+        eng->tail = req;
+    }
+    return 0;
+}
+
+int crumbs_engine_cancel(crumbs_engine_t *eng, crumbs_request_t *req)
+{
+    if (!eng || !req)
+    {
+        return -1;
+    }
+
+    crumbs_request_t *prev = NULL;
+    for (crumbs_request_t *r = eng->head; r; prev = r, r = r->next)
+    {
+        if (r == req)
+        {
+            crumbs_engine_unlink(eng, prev, req);
+            eng->lanes[req->lane].cancelled++;
+            if (req->on_done)
+            {
+                req->on_done(req, CRUMBS_REQ_CANCELLED);
+            }
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int crumbs_engine_cancel_lane(crumbs_engine_t *eng, uint8_t lane)
+{
+    if (!eng || lane >= CRUMBS_ENGINE_LANES)
+    {
+        return -1;
+    }
+
+    /* Detach first so callbacks that resubmit are not cancelled again. */
+    crumbs_request_t *done = NULL;
+    crumbs_request_t *done_tail = NULL;
+    crumbs_request_t *prev = NULL;
+    crumbs_request_t *r = eng->head;
+    int n = 0;
+    while (r)
+    {
+        crumbs_request_t *next = r->next;
+        if (r->lane == lane)
+        {
+            crumbs_engine_unlink(eng, prev, r);
+            if (done_tail)
+            {
+                done_tail->next = r;
+            }
+            else
+            {
+                done = r;
+            }
+            done_tail = r;
+            n++;
+        }
+        else
+        {
+            prev = r;
+        }
+        r = next;
+    }
+
+    eng->lanes[lane].cancelled += (uint32_t)n;
+    while (done)
+    {
+        crumbs_request_t *next = done->next;
+        done->next = NULL;
+        if (done->on_done)
+        {
+            done->on_done(done, CRUMBS_REQ_CANCELLED);
+        }
+        done = next;
+    }
+    return n;
+}
+
+int crumbs_engine_poll(crumbs_engine_t *eng, uint32_t now_us)
+{
+    if (!eng)
+    {
+        return -1;
+    }
+
+    crumbs_request_t *prev = NULL;
+    crumbs_request_t *req = eng->head;
+
+    while (req)
+    {
+        crumbs_request_t *next = req->next;
+        const crumbs_device_t *dev = req->dev;
+        int done = 0;
+        int status = 0;
+
+        if (!req->stamped)
+        {
+            req->stamped = 1u;
+            req->start_us = now_us;
+        }
+
+        if (req->state == CRUMBS_REQ_QUEUED && req->cmd && crumbs_target_ready(eng, req))
+        {
+            status = crumbs_controller_send(dev->ctx, dev->addr, req->cmd,
+                                            dev->write_fn, dev->io);
+            done = 1;
+        }
+        else if (req->state == CRUMBS_REQ_QUEUED && !req->cmd && crumbs_target_ready(eng, req))
+        {
+            crumbs_frame_builder_t fb;
+            crumbs_fb_init(&fb, 0u, CRUMBS_CMD_SET_REPLY);
+            crumbs_fb_add_u8(&fb, req->opcode);
+            status = crumbs_controller_send_frame(dev->ctx, dev->addr, &fb,
+                                                  dev->write_fn, dev->io);
+            if (status != 0)
+            {
+                done = 1;
+            }
+            else
+            {
+                req->state = CRUMBS_REQ_WAITING;
+                req->wait_us = req->delay_us ? req->delay_us
+                                             : crumbs_device_query_delay(dev, req->opcode);
+                req->due_us = now_us + req->wait_us;
+                req->poll_us = 0u;
+            }
+        }
+        else if ((req->state == CRUMBS_REQ_WAITING || req->state == CRUMBS_REQ_POLLING) &&
+                 crumbs_time_reached(now_us, req->due_us))
+        {
+            status = crumbs_controller_read_len(dev->ctx, dev->addr, &req->reply,
+                                                dev->read_fn, dev->io, req->reply_len);
+            int not_ready = (status == 0 && req->reply.opcode == CRUMBS_CMD_NOT_READY);
+            if (status == 0 && !not_ready && req->reply.opcode != req->opcode)
+            {
+                status = -1;
+            }
+            if (req->state == CRUMBS_REQ_WAITING && !req->delay_us)
+            {
+                /* Only the first read says anything about the delay. */
+                crumbs_device_query_result(dev, req->opcode, req->wait_us,
+                                           status == 0 && !not_ready);
+            }
+
+            if (not_ready && req->poll_us < CRUMBS_READY_POLL_TIMEOUT_US)
+            {
+                req->state = CRUMBS_REQ_POLLING;
+                req->poll_us += CRUMBS_READY_POLL_INTERVAL_US;
+                req->due_us = now_us + CRUMBS_READY_POLL_INTERVAL_US;
+            }
+            else
+            {
+                if (not_ready)
+                {
+                    status = -3;
+                }
+                done = 1;
+            }
+        }
+
+        if (done)
+        {
+            /* Unlink first so the callback may resubmit the request. */
+            crumbs_engine_unlink(eng, prev, req);
+            crumbs_lane_record(eng, req, now_us);
+
+            if (req->on_done)
+            {
+                req->on_done(req, status);
+                /* A resubmit may have been inserted between prev and next. */
+                for (crumbs_request_t *r = prev ? prev->next : eng->head; r && r != next; r = r->next)
+                {
+                    prev = r;
+                }
+            }
+        }
+        else
+        {
+            prev = req;
+        }
+
+        /*
+         * next is still queued unless a callback cancelled it, which is
+         * not allowed during a poll. A request resubmitted by a callback
+         * lands at the end of its lane and is picked up in this pass if
+         * the walk has not reached it yet.
+         */
+        req = next;
+    }
+
+    int pending = 0;
+    for (const crumbs_request_t *r = eng->head; r; r = r->next)
+    {
+        pending++;
+    }
+    return pending;
+}
+
+uint32_t crumbs_engine_idle_us(const crumbs_engine_t *eng, uint32_t now_us)
+{
+    if (!eng || !eng->head)
+    {
+        return UINT32_MAX;
+    }
+
+    uint32_t best = UINT32_MAX;
+    for (const crumbs_request_t *r = eng->head; r; r = r->next)
+    {
+        if (r->state == CRUMBS_REQ_QUEUED)
+        {
+            const crumbs_request_t *b = crumbs_target_blocker(eng, r);
+            if (!b || b->lane < r->lane)
+            {
+                return 0u;
+            }
+        }
+        if (r->state == CRUMBS_REQ_WAITING || r->state == CRUMBS_REQ_POLLING)
+        {
+            if (crumbs_time_reached(now_us, r->due_us))
+            {
+                return 0u;
+            }
+            uint32_t left = r->due_us - now_us;
+            if (left < best)
+            {
+                best = left;
+            }
+        }
+    }
+    return best;
+}
@@ -0,0 +1,463 @@
+/**
+ * @file
+ * @brief Protocol extension opcodes answered by the core (0xF0-0xFD).
+ *
+ * Extensions are only reached through crumbs_internal.h; each one decides
+ * whether it is active on the context, so a firmware that never enables a
+ * feature sees those opcodes exactly as before.
+ */
+
+#include "crumbs_internal.h"
+#include "crumbs_latency.h"
+
+#include <string.h> /* memset */
+
+/* ---- Peripheral side ---------------------------------------------------- */
+
+/**
+ * @brief Capability bitmap for the features active on @p ctx.
+ */
+uint32_t crumbs_peripheral_capabilities(const crumbs_context_t *ctx)
+{
+    uint32_t caps = 0u;
+
+    if (!ctx)
+    {
+        return 0u;
+    }
+
+#if CRUMBS_ENABLE_BATCH
+    caps |= CRUMBS_CAP_BATCH;
+#endif
+
+#if CRUMBS_ENABLE_FRAGMENTS
+    if (ctx->frag_buf)
+    {
+        caps |= CRUMBS_CAP_FRAGMENTS;
+    }
+#endif
+
+#if CRUMBS_ENABLE_STATS
+    caps |= CRUMBS_CAP_STATS;
+#endif
+
+#if CRUMBS_ENABLE_TRACE
+    if (crumbs_trace_ring_attached(ctx))
+    {
+        caps |= CRUMBS_CAP_TRACE;
+    }
+    if (crumbs_timing_attached(ctx))
+    {
+        caps |= CRUMBS_CAP_TIMING;
+    }
+#endif
+
+#if CRUMBS_ENABLE_BROADCAST
+    if (ctx->broadcast_rx)
+    {
+        caps |= CRUMBS_CAP_BROADCAST;
+    }
+#endif
+
+#if CRUMBS_ENABLE_STAGING
+    if (crumbs_stage_active(ctx))
+    {
+        caps |= CRUMBS_CAP_STAGING;
+    }
+#endif
+
+#if CRUMBS_ENABLE_REGISTERS
+    if (ctx->reg_base)
+    {
+        caps |= CRUMBS_CAP_REGISTERS;
+    }
+#endif
+
+#if CRUMBS_ENABLE_BULK
+    caps |= CRUMBS_CAP_BULK;
+#endif
+
+#if CRUMBS_ENABLE_CHANGE_SEQ
+    caps |= CRUMBS_CAP_CHANGES;
+#endif
+
+#if CRUMBS_ENABLE_SEQUENCED
+    caps |= CRUMBS_CAP_SEQUENCED;
+#endif
+
+#if CRUMBS_ENABLE_RESULT
+    caps |= CRUMBS_CAP_RESULT;
+#endif
+
+    return caps;
+}
+
+/**
+ * @brief Record the clock advertised in the CAPABILITIES reply.
+ */
+int crumbs_set_max_bus_clock(crumbs_context_t *ctx, uint16_t khz)
+{
+    if (!ctx)
+    {
+        return -1;
+    }
+    ctx->max_bus_khz = khz;
+    return 0;
+}
+
+/**
+ * @brief Switch unwrapping of CRUMBS_CMD_BROADCAST frames on or off.
+ */
+int crumbs_peripheral_set_broadcast(crumbs_context_t *ctx, int enable, uint8_t type_id)
+{
+#if CRUMBS_ENABLE_BROADCAST
+    if (!ctx)
+    {
+        return -1;
+    }
+    ctx->broadcast_rx = enable ? 1u : 0u;
+    ctx->broadcast_type = type_id;
+    return 0;
+#else
+    (void)ctx;
+    (void)enable;
+    (void)type_id;
+    return -1;
+#endif
+}
+
+/**
+ * @brief Whether the frame being dispatched came in as a broadcast.
+ */
+int crumbs_is_broadcast(const crumbs_context_t *ctx)
+{
+#if CRUMBS_ENABLE_BROADCAST
+    return (ctx && ctx->in_broadcast) ? 1 : 0;
+#else
+    (void)ctx;
+    return 0;
+#endif
+}
+
+#if CRUMBS_ENABLE_BROADCAST
+/**
+ * @brief Unwrap a BROADCAST frame and dispatch the inner opcode.
+ *
+ * Runs at dispatch time, so a broadcast queued by deferred dispatch is
+ * still marked when crumbs_peripheral_process() gets to it. Broadcasts
+ * for another device type, empty ones and nested ones are dropped.
+ *
+ * @return 1 if the frame was consumed, 0 if reception is off.
+ */
+static int crumbs_broadcast_dispatch(crumbs_context_t *ctx, const crumbs_frame_view_t *view)
+{
+    if (!ctx->broadcast_rx)
+    {
+        return 0;
+    }
+    if (view->data_len < 1u || view->data[0] == CRUMBS_CMD_BROADCAST)
+    {
+        CRUMBS_DBG("broadcast: empty or nested, dropped\n");
+        return 1;
+    }
+    if (ctx->broadcast_type != 0u && view->type_id != 0u && view->type_id != ctx->broadcast_type)
+    {
+        return 1;
+    }
+
+    crumbs_frame_view_t inner;
+    inner.type_id = view->type_id;
+    inner.opcode = view->data[0];
+    inner.data_len = (uint8_t)(view->data_len - 1u);
+    inner.data = &view->data[1];
+    inner.crc8 = view->crc8;
+
+    ctx->in_broadcast = 1u;
+    crumbs_peripheral_dispatch_view(ctx, &inner);
+    ctx->in_broadcast = 0u;
+    return 1;
+}
+#endif
+
+#if CRUMBS_ENABLE_BATCH
+/**
+ * @brief Dispatch each [opcode][len][data] record of a BATCH frame in order.
+ *
+ * The whole payload is checked before anything runs, so a truncated batch
+ * is dropped rather than half-applied. Records reuse the frame's type_id
+ * and CRC byte and point into the frame, so nothing is copied. Nested
+ * BATCH records are skipped.
+ */
+static void crumbs_batch_dispatch(crumbs_context_t *ctx, const crumbs_frame_view_t *view)
+{
+    size_t pos = 0u;
+    while (pos < view->data_len)
+    {
+        if (pos + CRUMBS_BATCH_RECORD_HEADER > view->data_len ||
+            pos + CRUMBS_BATCH_RECORD_HEADER + view->data[pos + 1u] > view->data_len)
+        {
+            CRUMBS_DBG("batch: record at %u overruns frame, dropped\n", (unsigned)pos);
+            return;
+        }
+        pos += CRUMBS_BATCH_RECORD_HEADER + view->data[pos + 1u];
+    }
+
+    crumbs_frame_view_t rec;
+    rec.type_id = view->type_id;
+    rec.crc8 = view->crc8;
+    for (pos = 0u; pos < view->data_len; pos += CRUMBS_BATCH_RECORD_HEADER + rec.data_len)
+    {
+        rec.opcode = view->data[pos];
+        rec.data_len = view->data[pos + 1u];
+        rec.data = &view->data[pos + CRUMBS_BATCH_RECORD_HEADER];
+        if (rec.opcode == CRUMBS_CMD_BATCH)
+        {
+            continue;
+        }
+        crumbs_peripheral_dispatch_view(ctx, &rec);
+    }
+}
+#endif
+
+/**
+ * @brief Route extension opcodes received by a peripheral.
+ */
+int crumbs_ext_handle_frame(crumbs_context_t *ctx, const crumbs_frame_view_t *view)
+{
+    switch (view->opcode)
+    {
+#if CRUMBS_ENABLE_BATCH
+    case CRUMBS_CMD_BATCH:
+        crumbs_batch_dispatch(ctx, view);
+        return 1;
+#endif
+
+#if CRUMBS_ENABLE_FRAGMENTS
+    case CRUMBS_CMD_FRAGMENT:
+        return crumbs_fragment_receive(ctx, view);
+#endif
+
+#if CRUMBS_ENABLE_STATS
+    case CRUMBS_CMD_STATS:
+        return crumbs_stats_receive(ctx, view);
+#endif
+
+#if CRUMBS_ENABLE_TRACE
+    case CRUMBS_CMD_TRACE:
+        return crumbs_trace_receive(ctx, view);
+
+    case CRUMBS_CMD_TIMING:
+        return crumbs_timing_receive(ctx, view);
+#endif
+
+#if CRUMBS_ENABLE_BROADCAST
+    case CRUMBS_CMD_BROADCAST:
+        return crumbs_broadcast_dispatch(ctx, view);
+#endif
+
+#if CRUMBS_ENABLE_STAGING
+    case CRUMBS_CMD_COMMIT:
+        return crumbs_stage_receive(ctx, view);
+#endif
+
+#if CRUMBS_ENABLE_REGISTERS
+    case CRUMBS_CMD_REG_READ:
+        return crumbs_regs_receive(ctx, view);
+#endif
+
+#if CRUMBS_ENABLE_CHANGE_SEQ
+    case CRUMBS_CMD_IF_CHANGED:
+        return crumbs_changes_receive(ctx, view);
+#endif
+
+#if CRUMBS_ENABLE_SEQUENCED
+    case CRUMBS_CMD_SEQUENCED:
+        return crumbs_seq_receive(ctx, view);
+#endif
+
+    default:
+        (void)ctx;
+        return 0;
+    }
+}
+
+/**
+ * @brief Answer extension opcodes selected with SET_REPLY.
+ */
+int crumbs_ext_build_reply(crumbs_context_t *ctx, crumbs_message_t *msg)
+{
+    switch (ctx->requested_opcode)
+    {
+    case CRUMBS_CMD_CAPABILITIES:
+    {
+        uint32_t caps = crumbs_peripheral_capabilities(ctx);
+        uint16_t frag_capacity = 0u;
+#if CRUMBS_ENABLE_FRAGMENTS
+        if (ctx->frag_buf)
+        {
+            frag_capacity = ctx->frag_capacity;
+        }
+#endif
+        msg->type_id = 0u;
+        msg->opcode = CRUMBS_CMD_CAPABILITIES;
+        msg->data_len = 8u;
+        msg->data[0] = (uint8_t)(caps);
+        msg->data[1] = (uint8_t)(caps >> 8);
+        msg->data[2] = (uint8_t)(caps >> 16);
+        msg->data[3] = (uint8_t)(caps >> 24);
+        msg->data[4] = (uint8_t)(frag_capacity & 0xFFu);
+        msg->data[5] = (uint8_t)(frag_capacity >> 8);
+        msg->data[6] = (uint8_t)(ctx->max_bus_khz & 0xFFu);
+        msg->data[7] = (uint8_t)(ctx->max_bus_khz >> 8);
+        return 1;
+    }
+
+#if CRUMBS_ENABLE_FRAGMENTS
+    case CRUMBS_CMD_FRAGMENT:
+        return crumbs_fragment_status_reply(ctx, msg);
+#endif
+
+#if CRUMBS_ENABLE_STATS
+    case CRUMBS_CMD_STATS:
+        return crumbs_stats_page_reply(ctx, msg);
+#endif
+
+#if CRUMBS_ENABLE_TRACE
+    case CRUMBS_CMD_TRACE:
+        return crumbs_trace_page_reply(ctx, msg);
+
+    case CRUMBS_CMD_TIMING:
+        return crumbs_timing_page_reply(ctx, msg);
+#endif
+
+#if CRUMBS_ENABLE_STAGING
+    case CRUMBS_CMD_COMMIT:
+        return crumbs_stage_status_reply(ctx, msg);
+#endif
+
+#if CRUMBS_ENABLE_REGISTERS
+    case CRUMBS_CMD_REG_READ:
+        return crumbs_regs_reply(ctx, msg);
+#endif
+
+#if CRUMBS_ENABLE_BULK
+    case CRUMBS_CMD_BULK_GET:
+        return crumbs_bulk_reply(ctx, msg);
+#endif
+
+#if CRUMBS_ENABLE_SEQUENCED
+    case CRUMBS_CMD_SEQUENCED:
+        return crumbs_seq_status_reply(ctx, msg);
+#endif
+
+#if CRUMBS_ENABLE_RESULT
+    case CRUMBS_CMD_RESULT:
+        return crumbs_result_reply(ctx, msg);
+#endif
+
+    default:
+        return 0;
+    }
+}
+
+/* ---- Controller side ---------------------------------------------------- */
+
+/**
+ * @brief Wrap @p msg in a BROADCAST frame and write it to the general-call address.
+ */
+int crumbs_controller_broadcast(const crumbs_context_t *ctx,
+                                const crumbs_message_t *msg,
+                                crumbs_i2c_write_fn write_fn,
+                                void *write_ctx)
+{
+    if (!msg || msg->data_len > CRUMBS_BROADCAST_MAX_PAYLOAD)
+    {
+        return -1;
+    }
+
+    crumbs_frame_builder_t fb;
+    crumbs_fb_init(&fb, msg->type_id, CRUMBS_CMD_BROADCAST);
+    crumbs_fb_add_u8(&fb, msg->opcode);
+    crumbs_fb_add_bytes(&fb, msg->data, msg->data_len);
+    return crumbs_controller_send_frame(ctx, CRUMBS_BROADCAST_ADDR, &fb, write_fn, write_ctx);
+}
+
+/**
+ * @brief SET_REPLY + delay + read for a core-answered opcode.
+ *
+ * Extension opcodes wait CRUMBS_EXT_QUERY_DELAY_US. Anything else (the
+ * bulk fallback) runs a reply handler and waits the device's learned
+ * delay, reporting the outcome back.
+ */
+int crumbs_ext_query(const crumbs_device_t *dev, uint8_t opcode, crumbs_message_t *out)
+{
+    if (!dev || !dev->ctx || !dev->write_fn || !dev->read_fn || !dev->delay_fn || !out)
+    {
+        return -1;
+    }
+
+    crumbs_frame_builder_t fb;
+    crumbs_fb_init(&fb, 0u, CRUMBS_CMD_SET_REPLY);
+    crumbs_fb_add_u8(&fb, opcode);
+    int rc = crumbs_controller_send_frame(dev->ctx, dev->addr, &fb, dev->write_fn, dev->io);
+    if (rc != 0)
+    {
+        return rc;
+    }
+
+    int core = opcode >= 0xF0u;
+    uint32_t delay_us = core ? CRUMBS_EXT_QUERY_DELAY_US : crumbs_device_query_delay(dev, opcode);
+    dev->delay_fn(delay_us);
+
+    rc = crumbs_controller_read(dev->ctx, dev->addr, out, dev->read_fn, dev->io);
+    if (!core)
+    {
+        crumbs_device_query_result(dev, opcode, delay_us, rc == 0 && out->opcode == opcode);
+    }
+    if (rc != 0)
+    {
+        return rc;
+    }
+
+    return (out->opcode == opcode) ? 0 : -1;
+}
+
+/**
+ * @brief Query and parse CRUMBS_CMD_CAPABILITIES.
+ */
+int crumbs_controller_get_capabilities(const crumbs_device_t *dev,
+                                       crumbs_capabilities_t *out)
+{
+    crumbs_message_t reply;
+
+    if (!out)
+    {
+        return -1;
+    }
+
+    int rc = crumbs_ext_query(dev, CRUMBS_CMD_CAPABILITIES, &reply);
+    if (rc != 0)
+    {
+        return rc;
+    }
+
+    if (reply.data_len < 4u)
+    {
+        return -1;
+    }
+
+    memset(out, 0, sizeof(*out));
+    out->flags = (uint32_t)reply.data[0] |
+                 ((uint32_t)reply.data[1] << 8) |
+                 ((uint32_t)reply.data[2] << 16) |
+                 ((uint32_t)reply.data[3] << 24);
+    if (reply.data_len >= 6u)
+    {
+        out->frag_capacity = (uint16_t)(reply.data[4] | (reply.data[5] << 8));
+    }
+    if (reply.data_len >= 8u)
+    {
+        out->max_bus_khz = (uint16_t)(reply.data[6] | (reply.data[7] << 8));
+    }
+    return 0;
+}
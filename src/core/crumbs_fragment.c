@@ -0,0 +1,317 @@
+/**
+ * @file
+ * @brief Fragmented transfers: controller-side splitting and peripheral-side
+ *        reassembly of CRUMBS_CMD_FRAGMENT frames.
+ *
+ * Every fragment except the last carries exactly CRUMBS_FRAGMENT_CHUNK bytes,
+ * so the peripheral places a fragment at index * CRUMBS_FRAGMENT_CHUNK
+ * without any per-fragment bookkeeping beyond the next expected index.
+ */
+
+#include "crumbs_internal.h"
+
+#include <string.h> /* memcpy */
+
+/* ---- Peripheral side ---------------------------------------------------- */
+
+/**
+ * @brief Install (or remove, with buf == NULL) the reassembly buffer.
+ */
+int crumbs_set_fragment_buffer(crumbs_context_t *ctx,
+                               uint8_t *buf,
+                               size_t capacity,
+                               crumbs_fragment_fn on_complete,
+                               void *user_data)
+{
+#if CRUMBS_ENABLE_FRAGMENTS
+    if (!ctx)
+    {
+        return -1;
+    }
+
+    if (capacity > CRUMBS_FRAGMENT_MAX_TRANSFER)
+    {
+        capacity = CRUMBS_FRAGMENT_MAX_TRANSFER;
+    }
+
+    ctx->frag_buf = buf;
+    ctx->frag_capacity = buf ? (uint16_t)capacity : 0u;
+    ctx->on_fragment = on_complete;
+    ctx->fragment_user_data = user_data;
+    ctx->frag_len = 0u;
+    ctx->frag_opcode = 0u;
+    ctx->frag_next = 0u;
+    ctx->frag_count = 0u;
+    ctx->frag_state = CRUMBS_FRAG_IDLE;
+    ctx->frag_errors = 0u;
+    return 0;
+#else
+    (void)ctx;
+    (void)buf;
+    (void)capacity;
+    (void)on_complete;
+    (void)user_data;
+    return -1;
+#endif
+}
+
+#if CRUMBS_ENABLE_FRAGMENTS
+
+static int crumbs_fragment_abort(crumbs_context_t *ctx)
+{
+    /* Count the transfer once, not every fragment that follows the abort. */
+    if (ctx->frag_state != CRUMBS_FRAG_ERROR)
+    {
+        ctx->frag_state = CRUMBS_FRAG_ERROR;
+        if (ctx->frag_errors != 0xFFu)
+        {
+            ctx->frag_errors++;
+        }
+        CRUMBS_DBG("frag: abort at index %u\n", (unsigned)ctx->frag_next);
+    }
+    return 1;
+}
+
+/**
+ * @brief Place one fragment into the reassembly buffer.
+ *
+ * Index 0 always (re)starts a transfer. A repeat of the fragment just
+ * accepted is ignored so a controller may resend from the peripheral's
+ * next_index without tracking what got through. Anything else out of order
+ * aborts the transfer until the next index 0.
+ */
+int crumbs_fragment_receive(crumbs_context_t *ctx, const crumbs_frame_view_t *view)
+{
+    if (!ctx->frag_buf)
+    {
+        return 0; /* Not enabled: FRAGMENT is an ordinary opcode. */
+    }
+
+    if (view->data_len < CRUMBS_FRAGMENT_HEADER)
+    {
+        return crumbs_fragment_abort(ctx);
+    }
+
+    uint8_t opcode = view->data[0];
+    uint8_t index = view->data[1];
+    uint8_t count = view->data[2];
+    const uint8_t *chunk = &view->data[CRUMBS_FRAGMENT_HEADER];
+    uint8_t chunk_len = (uint8_t)(view->data_len - CRUMBS_FRAGMENT_HEADER);
+
+    if (count == 0u || index >= count)
+    {
+        return crumbs_fragment_abort(ctx);
+    }
+
+    if (index == 0u)
+    {
+        ctx->frag_opcode = opcode;
+        ctx->frag_count = count;
+        ctx->frag_len = 0u;
+        ctx->frag_next = 0u;
+        ctx->frag_state = CRUMBS_FRAG_RECEIVING;
+    }
+    else if ((ctx->frag_state == CRUMBS_FRAG_RECEIVING || ctx->frag_state == CRUMBS_FRAG_COMPLETE) &&
+             opcode == ctx->frag_opcode && count == ctx->frag_count &&
+             (uint8_t)(index + 1u) == ctx->frag_next)
+    {
+        CRUMBS_DBG("frag: duplicate index %u ignored\n", (unsigned)index);
+        return 1;
+    }
+    else if (ctx->frag_state != CRUMBS_FRAG_RECEIVING ||
+             opcode != ctx->frag_opcode || count != ctx->frag_count ||
+             index != ctx->frag_next)
+    {
+        return crumbs_fragment_abort(ctx);
+    }
+
+    if ((uint8_t)(index + 1u) < count && chunk_len != CRUMBS_FRAGMENT_CHUNK)
+    {
+        return crumbs_fragment_abort(ctx);
+    }
+
+    if ((size_t)ctx->frag_len + chunk_len > ctx->frag_capacity)
+    {
+        return crumbs_fragment_abort(ctx);
+    }
+
+    memcpy(&ctx->frag_buf[ctx->frag_len], chunk, chunk_len);
+    ctx->frag_len = (uint16_t)(ctx->frag_len + chunk_len);
+    ctx->frag_next++;
+
+    if (ctx->frag_next == count)
+    {
+        ctx->frag_state = CRUMBS_FRAG_COMPLETE;
+        CRUMBS_DBG("frag: op 0x%02X complete, %u bytes\n",
+                   ctx->frag_opcode, (unsigned)ctx->frag_len);
+        if (ctx->on_fragment)
+        {
+            ctx->on_fragment(ctx, ctx->frag_opcode, ctx->frag_buf, ctx->frag_len,
+                             ctx->fragment_user_data);
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Status reply: [state][opcode][next_index][received:u16][errors].
+ */
+int crumbs_fragment_status_reply(const crumbs_context_t *ctx, crumbs_message_t *msg)
+{
+    if (!ctx->frag_buf)
+    {
+        return 0;
+    }
+
+    msg->type_id = 0u;
+    msg->opcode = CRUMBS_CMD_FRAGMENT;
+    msg->data_len = 6u;
+    msg->data[0] = ctx->frag_state;
+    msg->data[1] = ctx->frag_opcode;
+    msg->data[2] = ctx->frag_next;
+    msg->data[3] = (uint8_t)(ctx->frag_len & 0xFFu);
+    msg->data[4] = (uint8_t)(ctx->frag_len >> 8);
+    msg->data[5] = ctx->frag_errors;
+    return 1;
+}
+
+#endif /* CRUMBS_ENABLE_FRAGMENTS */
+
+/* ---- Controller side ---------------------------------------------------- */
+
+/**
+ * @brief Read and parse the peripheral's reassembly status.
+ */
+int crumbs_controller_get_fragment_status(const crumbs_device_t *dev,
+                                          crumbs_fragment_status_t *out)
+{
+    crumbs_message_t reply;
+
+    if (!out)
+    {
+        return -1;
+    }
+
+    int rc = crumbs_ext_query(dev, CRUMBS_CMD_FRAGMENT, &reply);
+    if (rc != 0)
+    {
+        return rc;
+    }
+
+    if (reply.data_len < 6u)
+    {
+        return -1;
+    }
+
+    out->state = reply.data[0];
+    out->opcode = reply.data[1];
+    out->next_index = reply.data[2];
+    out->received = (uint16_t)(reply.data[3] | (reply.data[4] << 8));
+    out->errors = reply.data[5];
+    return 0;
+}
+
+/**
+ * @brief Split @p data into FRAGMENT frames and send them back to back.
+ *
+ * Frames are built in place, so each byte is copied once into the wire
+ * buffer. With a window, the controller only reads status at window
+ * boundaries; a healthy transfer of N fragments costs N writes plus
+ * ceil(N / window) status reads instead of N round trips.
+ */
+int crumbs_controller_send_fragmented(const crumbs_device_t *dev,
+                                      uint8_t type_id,
+                                      uint8_t opcode,
+                                      const uint8_t *data,
+                                      size_t len,
+                                      uint8_t window)
+{
+    if (!dev || !dev->ctx || !dev->write_fn || (len > 0u && !data) ||
+        len > CRUMBS_FRAGMENT_MAX_TRANSFER)
+    {
+        return -1;
+    }
+
+    if (window > 0u && (!dev->read_fn || !dev->delay_fn))
+    {
+        return -1;
+    }
+
+    /* A zero-length transfer is still one (empty) fragment. */
+    unsigned count = (len == 0u) ? 1u
+                                 : (unsigned)((len + CRUMBS_FRAGMENT_CHUNK - 1u) / CRUMBS_FRAGMENT_CHUNK);
+    unsigned index = 0u;
+    unsigned retries = 0u;
+
+    while (index < count)
+    {
+        unsigned end = count;
+        if (window > 0u && index + window < count)
+        {
+            end = index + window;
+        }
+
+        for (; index < end; index++)
+        {
+            size_t offset = (size_t)index * CRUMBS_FRAGMENT_CHUNK;
+            size_t chunk = len - offset;
+            if (chunk > CRUMBS_FRAGMENT_CHUNK)
+            {
+                chunk = CRUMBS_FRAGMENT_CHUNK;
+            }
+
+            crumbs_frame_builder_t fb;
+            crumbs_fb_init(&fb, type_id, CRUMBS_CMD_FRAGMENT);
+            crumbs_fb_add_u8(&fb, opcode);
+            crumbs_fb_add_u8(&fb, (uint8_t)index);
+            crumbs_fb_add_u8(&fb, (uint8_t)count);
+            if (chunk > 0u)
+            {
+                crumbs_fb_add_bytes(&fb, &data[offset], (uint8_t)chunk);
+            }
+
+            int rc = crumbs_controller_send_frame(dev->ctx, dev->addr, &fb,
+                                                  dev->write_fn, dev->io);
+            if (rc != 0)
+            {
+                return rc;
+            }
+        }
+
+        if (window == 0u)
+        {
+            return 0;
+        }
+
+        crumbs_fragment_status_t st;
+        int rc = crumbs_controller_get_fragment_status(dev, &st);
+        if (rc != 0)
+        {
+            return rc;
+        }
+
+        int same = (st.opcode == opcode);
+        if (same && index == count && st.state == CRUMBS_FRAG_COMPLETE && st.received == len)
+        {
+            return 0;
+        }
+        if (same && index < count && st.state == CRUMBS_FRAG_RECEIVING && st.next_index == index)
+        {
+            continue; /* Window landed; send the next one. */
+        }
+
+        if (++retries > CRUMBS_FRAGMENT_MAX_RETRIES)
+        {
+            CRUMBS_DBG("frag: giving up after %u retries\n", retries - 1u);
+            return -4;
+        }
+
+        /* Resume where the peripheral stopped, or restart after an abort. */
+        index = (same && st.state == CRUMBS_FRAG_RECEIVING && st.next_index <= index)
+                    ? st.next_index
+                    : 0u;
+        CRUMBS_DBG("frag: resend from index %u\n", index);
+    }
+
+    return 0;
+}
@@ -5,12 +5,35 @@
 
 #include "crumbs.h"
 
-#include <string.h> /* memcpy */
+#include <string.h> /* memcpy, memset */
 
 #ifndef CRUMBS_I2C_DEV_MAX_WRITE
 #define CRUMBS_I2C_DEV_MAX_WRITE 64u
 #endif
 
+int crumbs_device_bind(crumbs_device_t *dev,
+                       crumbs_context_t *ctx,
+                       uint8_t addr,
+                       crumbs_i2c_write_fn write_fn,
+                       crumbs_i2c_read_fn read_fn,
+                       crumbs_delay_fn delay_fn,
+                       void *io)
+{
+    if (!dev || !ctx)
+    {
+        return -1;
+    }
+
+    memset(dev, 0, sizeof(*dev));
+    dev->ctx = ctx;
+    dev->addr = addr;
+    dev->write_fn = write_fn;
+    dev->read_fn = read_fn;
+    dev->delay_fn = delay_fn;
+    dev->io = io;
+    return 0;
+}
+
 int crumbs_i2c_dev_write(const crumbs_device_t *dev,
                          const uint8_t *data,
                          size_t len)
@@ -0,0 +1,246 @@
+/**
+ * @file
+ * @brief Hooks shared between the core translation units (not installed).
+ *
+ * crumbs_core.c owns framing and dispatch; protocol extensions live in their
+ * own files and are reached only through these functions.
+ */
+
+#ifndef CRUMBS_INTERNAL_H
+#define CRUMBS_INTERNAL_H
+
+#include "crumbs.h"
+
+/* ---- Context statistics ----------------------------------------------- */
+
+/*
+ * All writes and reads of ctx->crc_error_count / ctx->last_crc_ok go through
+ * these, so CRUMBS_THREAD_SAFE=1 makes a shared controller context race-free.
+ * Relaxed ordering: the counters carry no other data.
+ */
+#if CRUMBS_THREAD_SAFE
+#define CRUMBS_STAT_GET(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#define CRUMBS_STAT_SET(field, v) __atomic_store_n(&(field), (v), __ATOMIC_RELAXED)
+#define CRUMBS_STAT_INC(field) ((void)__atomic_add_fetch(&(field), 1u, __ATOMIC_RELAXED))
+#else
+#define CRUMBS_STAT_GET(field) (field)
+#define CRUMBS_STAT_SET(field, v) ((field) = (v))
+#define CRUMBS_STAT_INC(field) ((void)(field)++)
+#endif
+
+/* ---- Receive ring ------------------------------------------------------ */
+
+/*
+ * Index hand-off between the receive interrupt (or Wire task) and loop():
+ * the producer publishes a filled slot with a release store of rxq_head,
+ * the consumer frees it with a release store of rxq_tail. Both are single
+ * bytes, so plain volatile accesses suffice where __atomic is missing.
+ */
+#if defined(__GNUC__)
+#define CRUMBS_RING_LOAD(field) __atomic_load_n(&(field), __ATOMIC_ACQUIRE)
+#define CRUMBS_RING_STORE(field, v) __atomic_store_n(&(field), (v), __ATOMIC_RELEASE)
+#else
+#define CRUMBS_RING_LOAD(field) (field)
+#define CRUMBS_RING_STORE(field, v) ((field) = (v))
+#endif
+
+/* ---- Frame dispatch (crumbs_core.c) ------------------------------------ */
+
+/**
+ * @brief SET_REPLY interception, extensions, on_message and handler lookup
+ *        for one validated frame (or one batch record).
+ */
+void crumbs_peripheral_dispatch_view(crumbs_context_t *ctx, const crumbs_frame_view_t *view);
+
+/**
+ * @brief Fill @p msg for ctx->requested_opcode: reply handlers, extensions,
+ *        then on_request.
+ *
+ * @return 1 if something filled @p msg, 0 if no reply is configured.
+ */
+int crumbs_peripheral_fill_reply(crumbs_context_t *ctx, crumbs_message_t *msg);
+
+/* ---- Extension dispatch (crumbs_ext.c) --------------------------------- */
+
+/**
+ * @brief Give protocol extensions first look at a validated frame.
+ *
+ * @return 1 if the frame was consumed (do not dispatch to user code), else 0.
+ */
+int crumbs_ext_handle_frame(crumbs_context_t *ctx, const crumbs_frame_view_t *view);
+
+/**
+ * @brief Fill @p msg for ctx->requested_opcode if an extension answers it.
+ *
+ * @return 1 if @p msg was filled, else 0.
+ */
+int crumbs_ext_build_reply(crumbs_context_t *ctx, crumbs_message_t *msg);
+
+/**
+ * @brief SET_REPLY(@p opcode), wait, read and check the reply opcode.
+ *
+ * @return 0 on success, -1 on bad args or unexpected reply, else send/read error.
+ */
+int crumbs_ext_query(const crumbs_device_t *dev, uint8_t opcode, crumbs_message_t *out);
+
+/* ---- Fragment reassembly (crumbs_fragment.c) --------------------------- */
+
+#if CRUMBS_ENABLE_FRAGMENTS
+/** @brief Reassemble one FRAGMENT frame; returns 1 if consumed. */
+int crumbs_fragment_receive(crumbs_context_t *ctx, const crumbs_frame_view_t *view);
+
+/** @brief Fill the FRAGMENT status reply; returns 1 if filled. */
+int crumbs_fragment_status_reply(const crumbs_context_t *ctx, crumbs_message_t *msg);
+#endif
+
+/* ---- Statistics (crumbs_stats.c) --------------------------------------- */
+
+#if CRUMBS_ENABLE_STATS
+#define CRUMBS_STATS_ERR_SHORT 0u /**< Shorter than a header or its data_len. */
+#define CRUMBS_STATS_ERR_LEN 1u   /**< data_len above CRUMBS_MAX_PAYLOAD. */
+#define CRUMBS_STATS_ERR_CRC 2u   /**< CRC mismatch. */
+
+/** @brief Current stats clock reading, 0 without a clock. */
+uint32_t crumbs_stats_now(const crumbs_context_t *ctx);
+
+/** @brief Count a rejected frame (CRUMBS_STATS_ERR_*). */
+void crumbs_stats_decode_error(crumbs_context_t *ctx, uint8_t cause);
+
+/** @brief Count a valid frame accepted by a peripheral. */
+void crumbs_stats_frame_rx(crumbs_context_t *ctx);
+
+/** @brief Count a reply frame built by a peripheral. */
+void crumbs_stats_frame_tx(crumbs_context_t *ctx);
+
+/** @brief Count a command that reached neither a handler nor on_message. */
+void crumbs_stats_unhandled(crumbs_context_t *ctx);
+
+/** @brief Record the run time of the handler for @p opcode that started at @p start_us. */
+void crumbs_stats_handler(crumbs_context_t *ctx, uint8_t opcode, uint32_t start_us);
+
+/** @brief Record the build time of the reply for @p opcode that started at @p start_us. */
+void crumbs_stats_reply(crumbs_context_t *ctx, uint8_t opcode, uint32_t start_us);
+
+/** @brief Count a controller write that started at @p start_us and open a transaction to @p addr. */
+void crumbs_stats_controller_tx(const crumbs_context_t *ctx, uint8_t addr, uint32_t start_us);
+
+/** @brief Count a controller read and close the open transaction if @p msg is ready. */
+void crumbs_stats_controller_rx(crumbs_context_t *ctx, uint8_t addr, const crumbs_message_t *msg);
+
+/** @brief Handle a CRUMBS_CMD_STATS command (page select / reset); returns 1. */
+int crumbs_stats_receive(crumbs_context_t *ctx, const crumbs_frame_view_t *view);
+
+/** @brief Fill the CRUMBS_CMD_STATS reply for the selected page; returns 1. */
+int crumbs_stats_page_reply(const crumbs_context_t *ctx, crumbs_message_t *msg);
+#endif
+
+/* ---- Trace ring (crumbs_trace.c) --------------------------------------- */
+
+#if CRUMBS_ENABLE_TRACE
+/** @brief Whether a trace ring is the trace hook of @p ctx. */
+int crumbs_trace_ring_attached(const crumbs_context_t *ctx);
+
+/** @brief Handle a CRUMBS_CMD_TRACE command; returns 1 if a ring is attached. */
+int crumbs_trace_receive(crumbs_context_t *ctx, const crumbs_frame_view_t *view);
+
+/** @brief Fill the next CRUMBS_CMD_TRACE reply page; returns 1 if a ring is attached. */
+int crumbs_trace_page_reply(crumbs_context_t *ctx, crumbs_message_t *msg);
+#endif
+
+/* ---- Timing recorder (crumbs_timing.c) ---------------------------------- */
+
+#if CRUMBS_ENABLE_TRACE
+/** @brief Whether a timing recorder is the trace hook of @p ctx. */
+int crumbs_timing_attached(const crumbs_context_t *ctx);
+
+/** @brief Handle a CRUMBS_CMD_TIMING command; returns 1 if a recorder is attached. */
+int crumbs_timing_receive(crumbs_context_t *ctx, const crumbs_frame_view_t *view);
+
+/** @brief Fill the CRUMBS_CMD_TIMING reply for the selected phase; returns 1 if attached. */
+int crumbs_timing_page_reply(crumbs_context_t *ctx, crumbs_message_t *msg);
+#endif
+
+/* ---- Register file (crumbs_regs.c) ------------------------------------ */
+
+#if CRUMBS_ENABLE_REGISTERS
+/** @brief Select a REG_READ range; returns 1 if a register file is installed. */
+int crumbs_regs_receive(crumbs_context_t *ctx, const crumbs_frame_view_t *view);
+
+/** @brief Fill the REG_READ reply; returns 1 if a register file is installed. */
+int crumbs_regs_reply(const crumbs_context_t *ctx, crumbs_message_t *msg);
+#endif
+
+/* ---- Bulk query (crumbs_bulk.c) --------------------------------------- */
+
+#if CRUMBS_ENABLE_BULK
+/** @brief Store the opcode list of a SET_REPLY(CRUMBS_CMD_BULK_GET, ...). */
+void crumbs_bulk_select(crumbs_context_t *ctx, const crumbs_frame_view_t *view);
+
+/** @brief Pack the next frame of the bulk stream; always returns 1. */
+int crumbs_bulk_reply(crumbs_context_t *ctx, crumbs_message_t *msg);
+#endif
+
+/* ---- Reply cursor (crumbs_cursor.c) ----------------------------------- */
+
+#if CRUMBS_ENABLE_REPLY_CURSOR
+/** @brief Start or end the cursor for a SET_REPLY frame. */
+void crumbs_cursor_select(crumbs_context_t *ctx, const crumbs_frame_view_t *view);
+
+/** @brief Move the cursor on after a reply with @p reply_opcode was built. */
+void crumbs_cursor_advance(crumbs_context_t *ctx, uint8_t reply_opcode);
+#endif
+
+/* ---- Change sequence (crumbs_changes.c) ------------------------------- */
+
+#if CRUMBS_ENABLE_CHANGE_SEQ
+/** @brief Store an IF_CHANGED selection; always returns 1. */
+int crumbs_changes_receive(crumbs_context_t *ctx, const crumbs_frame_view_t *view);
+
+/** @brief Unchanged frame, or the wrapped reply, while IF_CHANGED is in force. */
+int crumbs_changes_reply(crumbs_context_t *ctx, crumbs_message_t *msg);
+#endif
+
+/* ---- Attention line (crumbs_attention.c) ------------------------------ */
+
+#if CRUMBS_ENABLE_ATTENTION
+/** @brief Release the line once a reply other than NOT_READY is out. */
+void crumbs_attention_delivered(crumbs_context_t *ctx, uint8_t reply_opcode);
+#endif
+
+/* ---- Sequenced commands (crumbs_seq.c) -------------------------------- */
+
+#if CRUMBS_ENABLE_SEQUENCED
+/** @brief Apply or drop one SEQUENCED frame; always returns 1. */
+int crumbs_seq_receive(crumbs_context_t *ctx, const crumbs_frame_view_t *view);
+
+/** @brief Fill the SEQUENCED status reply; returns 1. */
+int crumbs_seq_status_reply(const crumbs_context_t *ctx, crumbs_message_t *msg);
+#endif
+
+/* ---- Command results (crumbs_result.c) ------------------------------- */
+
+#if CRUMBS_ENABLE_RESULT
+/** @brief Record the result of a dispatched command and arm the next read. */
+void crumbs_result_record(crumbs_context_t *ctx, uint8_t opcode, uint8_t status);
+
+/** @brief Fill the CRUMBS_CMD_RESULT reply; returns 1. */
+int crumbs_result_reply(const crumbs_context_t *ctx, crumbs_message_t *msg);
+#endif
+
+/* ---- Staged commands (crumbs_stage.c) --------------------------------- */
+
+#if CRUMBS_ENABLE_STAGING
+/** @brief Stage @p view if its opcode is latched; returns 1 if it was taken. */
+int crumbs_stage_capture(crumbs_context_t *ctx, const crumbs_frame_view_t *view);
+
+/** @brief Handle a CRUMBS_CMD_COMMIT command; returns 1. */
+int crumbs_stage_receive(crumbs_context_t *ctx, const crumbs_frame_view_t *view);
+
+/** @brief Fill the CRUMBS_CMD_COMMIT status reply; returns 1. */
+int crumbs_stage_status_reply(const crumbs_context_t *ctx, crumbs_message_t *msg);
+
+/** @brief Whether any opcode is latched on @p ctx. */
+int crumbs_stage_active(const crumbs_context_t *ctx);
+#endif
+
+#endif /* CRUMBS_INTERNAL_H */
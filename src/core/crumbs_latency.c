@@ -0,0 +1,153 @@
+/**
+ * @file
+ * @brief Per-(address, opcode) reply-delay estimator (see crumbs_latency.h).
+ */
+
+#include "crumbs_latency.h"
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+/** @brief gain * pct / 100 without overflowing 32 bits. */
+static uint32_t crumbs_latency_scale(uint32_t gain, uint32_t pct)
+{
+    return (gain / 100u) * pct + ((gain % 100u) * pct) / 100u;
+}
+
+static uint32_t crumbs_latency_clamp(const crumbs_latency_t *lat, uint32_t d)
+{
+    if (d < lat->floor_us)
+    {
+        return lat->floor_us;
+    }
+    if (d > lat->ceiling_us)
+    {
+        return lat->ceiling_us;
+    }
+    return d;
+}
+
+static crumbs_latency_entry_t *crumbs_latency_find(const crumbs_latency_t *lat,
+                                                   uint8_t addr, uint8_t opcode)
+{
+    for (uint8_t i = 0; i < lat->count; i++)
+    {
+        const crumbs_latency_entry_t *e = &lat->entries[i];
+        if (e->addr == addr && e->opcode == opcode)
+        {
+            return (crumbs_latency_entry_t *)e;
+        }
+    }
+    return NULL;
+}
+
+/* ---- Public API --------------------------------------------------------- */
+
+void crumbs_latency_init(crumbs_latency_t *lat, uint32_t floor_us, uint32_t ceiling_us)
+{
+    if (!lat)
+    {
+        return;
+    }
+
+    lat->floor_us = floor_us ? floor_us : CRUMBS_LATENCY_FLOOR_US;
+    lat->ceiling_us = ceiling_us ? ceiling_us : CRUMBS_DEFAULT_QUERY_DELAY_US;
+    if (lat->ceiling_us < lat->floor_us)
+    {
+        lat->ceiling_us = lat->floor_us;
+    }
+    lat->count = 0u;
+    lat->next_evict = 0u;
+}
+
+uint32_t crumbs_latency_estimate(const crumbs_latency_t *lat, uint8_t addr, uint8_t opcode)
+{
+    if (!lat)
+    {
+        return CRUMBS_DEFAULT_QUERY_DELAY_US;
+    }
+
+    const crumbs_latency_entry_t *e = crumbs_latency_find(lat, addr, opcode);
+    return e ? e->delay_us : lat->ceiling_us;
+}
+
+void crumbs_latency_report(crumbs_latency_t *lat, uint8_t addr, uint8_t opcode,
+                           uint32_t waited_us, int ok)
+{
+    if (!lat)
+    {
+        return;
+    }
+
+    crumbs_latency_entry_t *e = crumbs_latency_find(lat, addr, opcode);
+    if (!e)
+    {
+        uint8_t slot;
+        if (lat->count < CRUMBS_LATENCY_ENTRIES)
+        {
+            slot = lat->count++;
+        }
+        else
+        {
+            slot = lat->next_evict;
+            lat->next_evict = (uint8_t)((lat->next_evict + 1u) % CRUMBS_LATENCY_ENTRIES);
+        }
+        e = &lat->entries[slot];
+        e->addr = addr;
+        e->opcode = opcode;
+        e->delay_us = lat->ceiling_us;
+        e->samples = 0u;
+    }
+
+    uint32_t d = e->delay_us;
+    uint32_t gain = d >> CRUMBS_LATENCY_GAIN_SHIFT;
+    if (gain == 0u)
+    {
+        gain = 1u;
+    }
+
+    if (ok)
+    {
+        /* Latency <= waited: creep down by (100 - P)% of the gain. */
+        uint32_t step = crumbs_latency_scale(gain, 100u - CRUMBS_LATENCY_PERCENTILE);
+        if (step == 0u)
+        {
+            step = 1u;
+        }
+        d = (d > step) ? d - step : 0u;
+    }
+    else
+    {
+        /* Latency > waited: jump up by P% of the gain from at least waited. */
+        if (waited_us > d)
+        {
+            d = waited_us;
+        }
+        uint32_t step = crumbs_latency_scale(gain, CRUMBS_LATENCY_PERCENTILE);
+        d = (d > UINT32_MAX - step) ? UINT32_MAX : d + step;
+    }
+
+    e->delay_us = crumbs_latency_clamp(lat, d);
+    if (e->samples != 0xFFFFu)
+    {
+        e->samples++;
+    }
+}
+
+uint32_t crumbs_device_query_delay(const crumbs_device_t *dev, uint8_t opcode)
+{
+    if (!dev || !dev->latency)
+    {
+        return CRUMBS_DEFAULT_QUERY_DELAY_US;
+    }
+    return crumbs_latency_estimate(dev->latency, dev->addr, opcode);
+}
+
+void crumbs_device_query_result(const crumbs_device_t *dev, uint8_t opcode,
+                                uint32_t waited_us, int ok)
+{
+    if (!dev || !dev->latency)
+    {
+        return;
+    }
+    crumbs_latency_report(dev->latency, dev->addr, opcode, waited_us, ok);
+}
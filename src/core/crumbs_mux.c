@@ -0,0 +1,356 @@
+/**
+ * @file
+ * @brief I2C multiplexer paths with cached channel selection (see crumbs_mux.h).
+ */
+
+#include "crumbs_mux.h"
+
+#include <string.h> /* memset */
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+static int crumbs_mux_find(const crumbs_mux_t *mux, uint8_t mux_addr)
+{
+    for (uint8_t i = 0; i < mux->count; i++)
+    {
+        if (mux->addr[i] == mux_addr)
+        {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+/** @brief Write @p control to mux @p i unless it already holds it. */
+static int crumbs_mux_set(crumbs_mux_t *mux, uint8_t i, uint8_t control)
+{
+    int rc;
+
+    if (mux->selected[i] == control)
+    {
+        return 0;
+    }
+    rc = mux->inner->send(mux->inner_io, mux->addr[i], &control, 1u);
+    if (rc != 0)
+    {
+        mux->selected[i] = CRUMBS_MUX_UNKNOWN;
+        return rc;
+    }
+    mux->selected[i] = control;
+    mux->switches++;
+    return 0;
+}
+
+static void crumbs_mux_mark(uint8_t *set, const uint8_t *addrs, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        set[(addrs[i] & 0x7Fu) >> 3] |= (uint8_t)(1u << (addrs[i] & 7u));
+    }
+}
+
+static int crumbs_mux_marked(const uint8_t *set, uint8_t addr)
+{
+    return (set[(addr & 0x7Fu) >> 3] >> (addr & 7u)) & 1u;
+}
+
+/* ---- Public API -------------------------------------------------------- */
+
+int crumbs_mux_init(crumbs_mux_t *mux, const crumbs_transport_t *inner, void *inner_io)
+{
+    if (!mux || !inner || !inner->send)
+    {
+        return -1;
+    }
+
+    memset(mux, 0, sizeof(*mux));
+    mux->inner = inner;
+    mux->inner_io = inner_io;
+
+    mux->transport.name = "mux";
+    mux->transport.send = crumbs_mux_write;
+    mux->transport.receive = inner->receive ? crumbs_mux_read : NULL;
+    mux->transport.transact = inner->transact ? crumbs_mux_write_read : NULL;
+    mux->transport.caps = (uint16_t)(inner->caps & ~CRUMBS_TRANSPORT_CAP_BROADCAST);
+    mux->transport.max_frame = inner->max_frame;
+    return 0;
+}
+
+int crumbs_mux_add(crumbs_mux_t *mux, uint8_t mux_addr)
+{
+    uint8_t i;
+
+    if (!mux || mux_addr > 0x7Fu || mux->count >= CRUMBS_MUX_MAX ||
+        crumbs_mux_find(mux, mux_addr) >= 0)
+    {
+        return -1;
+    }
+
+    i = mux->count++;
+    mux->addr[i] = mux_addr;
+    mux->selected[i] = CRUMBS_MUX_UNKNOWN;
+    for (uint8_t ch = 0; ch < CRUMBS_MUX_CHANNELS; ch++)
+    {
+        mux->ports[i][ch].mux = mux;
+        mux->ports[i][ch].index = i;
+        mux->ports[i][ch].channel = ch;
+    }
+    return (int)i;
+}
+
+crumbs_mux_port_t *crumbs_mux_port(crumbs_mux_t *mux, uint8_t mux_addr, uint8_t channel)
+{
+    int i;
+
+    if (!mux || channel >= CRUMBS_MUX_CHANNELS)
+    {
+        return NULL;
+    }
+    i = crumbs_mux_find(mux, mux_addr);
+    return (i < 0) ? NULL : &mux->ports[i][channel];
+}
+
+int crumbs_mux_device_init(crumbs_device_t *dev, crumbs_context_t *ctx, crumbs_mux_t *mux,
+                           uint8_t mux_addr, uint8_t channel, uint8_t addr,
+                           crumbs_delay_fn delay_fn)
+{
+    crumbs_mux_port_t *port = crumbs_mux_port(mux, mux_addr, channel);
+
+    if (!dev || !ctx || !port)
+    {
+        return -1;
+    }
+    memset(dev, 0, sizeof(*dev));
+    dev->ctx = ctx;
+    dev->addr = addr;
+    dev->delay_fn = delay_fn;
+    return crumbs_device_set_transport(dev, &mux->transport, port);
+}
+
+int crumbs_mux_device_path(const crumbs_device_t *dev, uint8_t *mux_addr, uint8_t *channel)
+{
+    const crumbs_mux_port_t *port;
+
+    if (!dev || dev->write_fn != crumbs_mux_write || !dev->io)
+    {
+        return -1;
+    }
+    port = (const crumbs_mux_port_t *)dev->io;
+    if (mux_addr)
+    {
+        *mux_addr = port->mux->addr[port->index];
+    }
+    if (channel)
+    {
+        *channel = port->channel;
+    }
+    return 0;
+}
+
+int crumbs_mux_select(crumbs_mux_port_t *port)
+{
+    crumbs_mux_t *mux;
+    uint8_t want;
+    int rc;
+
+    if (!port || !port->mux)
+    {
+        return -1;
+    }
+    mux = port->mux;
+    want = (uint8_t)(1u << port->channel);
+    if (mux->selected[port->index] == want)
+    {
+        /* Others are closed whenever a channel is opened through a port. */
+        int open = 0;
+        for (uint8_t i = 0; i < mux->count; i++)
+        {
+            if (i != port->index && mux->selected[i] != 0u)
+            {
+                open = 1;
+            }
+        }
+        if (!open)
+        {
+            mux->hits++;
+            return 0;
+        }
+    }
+
+    /* Close the others first: two open paths to one address would collide. */
+    for (uint8_t i = 0; i < mux->count; i++)
+    {
+        if (i != port->index && (rc = crumbs_mux_set(mux, i, 0u)) != 0)
+        {
+            return rc;
+        }
+    }
+    return crumbs_mux_set(mux, port->index, want);
+}
+
+int crumbs_mux_close_all(crumbs_mux_t *mux)
+{
+    int rc;
+
+    if (!mux)
+    {
+        return -1;
+    }
+    for (uint8_t i = 0; i < mux->count; i++)
+    {
+        if ((rc = crumbs_mux_set(mux, i, 0u)) != 0)
+        {
+            return rc;
+        }
+    }
+    return 0;
+}
+
+void crumbs_mux_invalidate(crumbs_mux_t *mux)
+{
+    if (!mux)
+    {
+        return;
+    }
+    for (uint8_t i = 0; i < mux->count; i++)
+    {
+        mux->selected[i] = CRUMBS_MUX_UNKNOWN;
+    }
+}
+
+int crumbs_mux_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    crumbs_mux_port_t *port = (crumbs_mux_port_t *)user_ctx;
+    int rc = crumbs_mux_select(port);
+
+    if (rc != 0)
+    {
+        return rc;
+    }
+    return port->mux->inner->send(port->mux->inner_io, addr, data, len);
+}
+
+int crumbs_mux_read(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len,
+                    uint32_t timeout_us)
+{
+    crumbs_mux_port_t *port = (crumbs_mux_port_t *)user_ctx;
+    int rc = crumbs_mux_select(port);
+
+    if (rc != 0)
+    {
+        return rc;
+    }
+    if (!port->mux->inner->receive)
+    {
+        return -1;
+    }
+    return port->mux->inner->receive(port->mux->inner_io, addr, buffer, len, timeout_us);
+}
+
+int crumbs_mux_write_read(void *user_ctx, uint8_t addr, const uint8_t *tx, size_t tx_len,
+                          uint8_t *rx, size_t rx_len, uint32_t timeout_us,
+                          int require_repeated_start)
+{
+    crumbs_mux_port_t *port = (crumbs_mux_port_t *)user_ctx;
+    int rc;
+
+    if (!port || !port->mux || !port->mux->inner->transact)
+    {
+        return CRUMBS_I2C_DEV_E_NO_REPEATED_START;
+    }
+    rc = crumbs_mux_select(port);
+    if (rc != 0)
+    {
+        return rc;
+    }
+    return port->mux->inner->transact(port->mux->inner_io, addr, tx, tx_len, rx, rx_len,
+                                      timeout_us, require_repeated_start);
+}
+
+int crumbs_mux_scan(crumbs_mux_t *mux, const crumbs_context_t *ctx,
+                    crumbs_i2c_scan_fn scan_fn, uint8_t start_addr, uint8_t end_addr,
+                    int strict, crumbs_mux_found_t *found, size_t max_found,
+                    uint32_t timeout_us)
+{
+    uint8_t upstream[16];
+    uint8_t acks[128];
+    uint8_t cand[128];
+    uint8_t addrs[128];
+    uint8_t types[128];
+    size_t total = 0u;
+    int n;
+    int rc;
+
+    if (!mux || !scan_fn || !found || start_addr > end_addr || end_addr > 0x7Fu)
+    {
+        return -1;
+    }
+
+    rc = crumbs_mux_close_all(mux);
+    if (rc != 0)
+    {
+        return rc;
+    }
+    memset(upstream, 0, sizeof(upstream));
+    n = scan_fn(mux->inner_io, start_addr, end_addr, 0, acks, sizeof(acks));
+    if (n < 0)
+    {
+        return n;
+    }
+    crumbs_mux_mark(upstream, acks, n);
+    crumbs_mux_mark(upstream, mux->addr, mux->count);
+
+    for (uint8_t ch = 0; ch < CRUMBS_MUX_CHANNELS && total < max_found; ch++)
+    {
+        size_t nc = 0u;
+
+        /* Channel ch on every mux at once: one scan covers them all. */
+        for (uint8_t i = 0; i < mux->count; i++)
+        {
+            if ((rc = crumbs_mux_set(mux, i, (uint8_t)(1u << ch))) != 0)
+            {
+                return rc;
+            }
+        }
+        n = scan_fn(mux->inner_io, start_addr, end_addr, 0, acks, sizeof(acks));
+        if (n < 0)
+        {
+            return n;
+        }
+        for (int k = 0; k < n; k++)
+        {
+            if (!crumbs_mux_marked(upstream, acks[k]))
+            {
+                cand[nc++] = acks[k];
+            }
+        }
+        if (nc == 0u)
+        {
+            continue;
+        }
+
+        /* Something answered: locate it mux by mux (one select each). */
+        for (uint8_t i = 0; i < mux->count && total < max_found; i++)
+        {
+            size_t room = max_found - total;
+            int got = crumbs_controller_scan_for_crumbs_candidates(
+                ctx, cand, nc, strict, crumbs_mux_write, crumbs_mux_read, &mux->ports[i][ch],
+                addrs, types, (room < nc) ? room : nc, timeout_us);
+            if (got < 0)
+            {
+                return got;
+            }
+            for (int k = 0; k < got; k++)
+            {
+                found[total].mux_addr = mux->addr[i];
+                found[total].channel = ch;
+                found[total].addr = addrs[k];
+                found[total].type_id = types[k];
+                total++;
+            }
+        }
+    }
+
+    rc = crumbs_mux_close_all(mux);
+    return (rc != 0) ? rc : (int)total;
+}
@@ -0,0 +1,236 @@
+/**
+ * @file
+ * @brief Bus time profiler (see crumbs_profile.h).
+ */
+
+#include "crumbs_profile.h"
+
+#include <string.h> /* memset */
+
+/** @brief Wire-time model, in SCL clocks (same as crumbs_vbus). */
+#define CRUMBS_PROFILE_ADDR_BITS (1u + 9u + 1u) /* START, address byte, STOP */
+#define CRUMBS_PROFILE_BYTE_BITS 9u
+
+static crumbs_profile_t *g_profile_current;
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+/** @brief Bytes of @p buf that form a CRUMBS frame: 4 + its length byte, or all of them. */
+static size_t crumbs_profile_frame_len(const uint8_t *buf, size_t n)
+{
+    if (n >= 4u && buf[2] <= CRUMBS_MAX_PAYLOAD && 4u + (size_t)buf[2] <= n)
+    {
+        return 4u + (size_t)buf[2];
+    }
+    return n;
+}
+
+static void crumbs_profile_count(crumbs_profile_t *prof, unsigned kind, uint32_t t0, int failed,
+                                 size_t requested, size_t moved, size_t used, uint32_t phases)
+{
+    crumbs_profile_stat_t *s = &prof->kinds[kind];
+    uint32_t dt = prof->clock() - t0;
+
+    s->count++;
+    if (failed)
+    {
+        s->errors++;
+    }
+    s->time_us += dt;
+    if (dt > s->max_us)
+    {
+        s->max_us = dt;
+    }
+    s->requested += (uint32_t)requested;
+    s->moved += (uint32_t)moved;
+    s->used += (uint32_t)used;
+    s->phases += phases;
+}
+
+static int crumbs_profile_send(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    crumbs_profile_t *prof = (crumbs_profile_t *)user_ctx;
+    uint32_t t0 = prof->clock();
+    int rc = prof->inner->send(prof->inner_io, addr, data, len);
+    size_t moved = (rc < 0) ? 0u : len;
+
+    crumbs_profile_count(prof, CRUMBS_PROFILE_WRITE, t0, rc < 0, len, moved, moved, 1u);
+    return rc;
+}
+
+static int crumbs_profile_receive(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len,
+                                  uint32_t timeout_us)
+{
+    crumbs_profile_t *prof = (crumbs_profile_t *)user_ctx;
+    uint32_t t0 = prof->clock();
+    int rc = prof->inner->receive(prof->inner_io, addr, buffer, len, timeout_us);
+
+    /* The bus clocks the whole requested length, however short the frame. */
+    size_t used = (rc > 0) ? crumbs_profile_frame_len(buffer, (size_t)rc) : 0u;
+    crumbs_profile_count(prof, CRUMBS_PROFILE_READ, t0, rc <= 0, len, (rc > 0) ? len : 0u,
+                         used, 1u);
+    return rc;
+}
+
+static int crumbs_profile_transact(void *user_ctx, uint8_t addr, const uint8_t *tx, size_t tx_len,
+                                   uint8_t *rx, size_t rx_len, uint32_t timeout_us,
+                                   int require_repeated_start)
+{
+    crumbs_profile_t *prof = (crumbs_profile_t *)user_ctx;
+    uint32_t t0 = prof->clock();
+    int rc = prof->inner->transact(prof->inner_io, addr, tx, tx_len, rx, rx_len, timeout_us,
+                                   require_repeated_start);
+
+    /* A refused combined transfer never reached the bus; the fallback is counted instead. */
+    if (rc == CRUMBS_I2C_DEV_E_NO_REPEATED_START)
+    {
+        return rc;
+    }
+
+    size_t moved = 0u;
+    size_t used = 0u;
+    if (rc >= 0)
+    {
+        moved = tx_len + ((rc > 0) ? rx_len : 0u);
+        used = tx_len + ((rc > 0) ? crumbs_profile_frame_len(rx, (size_t)rc) : 0u);
+    }
+    uint32_t phases = (tx_len > 0u ? 1u : 0u) + (rx_len > 0u ? 1u : 0u);
+    crumbs_profile_count(prof, CRUMBS_PROFILE_TRANSACT, t0, rc < 0 || (rx_len > 0u && rc == 0),
+                         tx_len + rx_len, moved, used, phases);
+    return rc;
+}
+
+/** @brief Wire time of @p bits SCL clocks, in microseconds. */
+static uint32_t crumbs_profile_bits_us(const crumbs_profile_t *prof, uint64_t bits)
+{
+    uint32_t hz = prof->bus_hz ? prof->bus_hz : 100000u;
+    return (uint32_t)((bits * 1000000u + hz / 2u) / hz);
+}
+
+/* ---- Public API -------------------------------------------------------- */
+
+int crumbs_profile_init(crumbs_profile_t *prof,
+                        const crumbs_transport_t *inner, void *inner_io,
+                        crumbs_clock_us_fn clock, uint32_t bus_hz)
+{
+    if (!prof || !inner || !inner->send || !clock)
+    {
+        return -1;
+    }
+
+    memset(prof, 0, sizeof(*prof));
+    prof->inner = inner;
+    prof->inner_io = inner_io;
+    prof->clock = clock;
+    prof->bus_hz = bus_hz;
+    prof->start_us = clock();
+
+    prof->transport.name = "profile";
+    prof->transport.send = crumbs_profile_send;
+    prof->transport.receive = inner->receive ? crumbs_profile_receive : NULL;
+    prof->transport.transact = inner->transact ? crumbs_profile_transact : NULL;
+    prof->transport.caps = inner->caps;
+    prof->transport.max_frame = inner->max_frame;
+    return 0;
+}
+
+int crumbs_profile_attach(crumbs_profile_t *prof, crumbs_context_t *ctx,
+                          crumbs_clock_us_fn clock, uint32_t bus_hz)
+{
+    if (!ctx || !ctx->transport)
+    {
+        return -1;
+    }
+    if (crumbs_profile_init(prof, ctx->transport, ctx->transport_io, clock, bus_hz) != 0)
+    {
+        return -1;
+    }
+    crumbs_set_transport(ctx, &prof->transport, prof);
+    return 0;
+}
+
+void crumbs_profile_reset(crumbs_profile_t *prof)
+{
+    if (!prof || !prof->clock)
+    {
+        return;
+    }
+    memset(prof->kinds, 0, sizeof(prof->kinds));
+    prof->delays = 0u;
+    prof->delay_asked_us = 0u;
+    prof->delay_us = 0u;
+    prof->start_us = prof->clock();
+}
+
+void crumbs_profile_use(crumbs_profile_t *prof)
+{
+    g_profile_current = prof;
+}
+
+void crumbs_profile_delay_us(uint32_t us)
+{
+    crumbs_profile_t *prof = g_profile_current;
+
+    if (!prof || !prof->delay)
+    {
+        return;
+    }
+    uint32_t t0 = prof->clock();
+    prof->delay(us);
+    prof->delays++;
+    prof->delay_asked_us += us;
+    prof->delay_us += prof->clock() - t0;
+}
+
+void crumbs_profile_summary(const crumbs_profile_t *prof, crumbs_profile_summary_t *out)
+{
+    uint32_t phases = 0u;
+
+    if (!out)
+    {
+        return;
+    }
+    memset(out, 0, sizeof(*out));
+    if (!prof || !prof->clock)
+    {
+        return;
+    }
+
+    for (unsigned k = 0u; k < CRUMBS_PROFILE_KINDS; k++)
+    {
+        const crumbs_profile_stat_t *s = &prof->kinds[k];
+        out->transfers += s->count;
+        out->errors += s->errors;
+        out->transfer_us += s->time_us;
+        out->requested += s->requested;
+        out->moved += s->moved;
+        out->used += s->used;
+        phases += s->phases;
+    }
+    out->elapsed_us = prof->clock() - prof->start_us;
+    out->delay_us = prof->delay_us;
+    if (out->transfer_us + out->delay_us < out->elapsed_us)
+    {
+        out->other_us = out->elapsed_us - out->transfer_us - out->delay_us;
+    }
+
+    out->addr_us = crumbs_profile_bits_us(prof, (uint64_t)phases * CRUMBS_PROFILE_ADDR_BITS);
+    out->payload_us = crumbs_profile_bits_us(prof, (uint64_t)out->used * CRUMBS_PROFILE_BYTE_BITS);
+    out->padding_us = crumbs_profile_bits_us(
+        prof, (uint64_t)(out->moved - out->used) * CRUMBS_PROFILE_BYTE_BITS);
+    uint32_t wire_us = out->addr_us + out->payload_us + out->padding_us;
+    out->stall_us = (out->transfer_us > wire_us) ? out->transfer_us - wire_us : 0u;
+
+    if (out->elapsed_us)
+    {
+        out->goodput_bps = (uint32_t)((uint64_t)out->used * 1000000u / out->elapsed_us);
+        uint64_t pct = (uint64_t)out->transfer_us * 100u / out->elapsed_us;
+        out->busy_pct = (uint8_t)(pct > 100u ? 100u : pct);
+    }
+    if (out->transfer_us)
+    {
+        out->bus_bps = (uint32_t)((uint64_t)out->used * 1000000u / out->transfer_us);
+        uint64_t pct = (uint64_t)out->payload_us * 100u / out->transfer_us;
+        out->efficiency_pct = (uint8_t)(pct > 100u ? 100u : pct);
+    }
+}
@@ -0,0 +1,251 @@
+/**
+ * @file
+ * @brief Stuck-bus detection and recovery (see crumbs_recover.h).
+ */
+
+#include "crumbs_recover.h"
+
+#include <string.h> /* memset */
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+static void crumbs_bus_clear_wait(const crumbs_bus_pins_t *pins, uint32_t us)
+{
+    if (pins->delay)
+    {
+        pins->delay(us);
+    }
+}
+
+static uint32_t crumbs_recover_now_us(const crumbs_recover_t *rec)
+{
+    return rec->clock ? rec->clock() : 0u;
+}
+
+/** @brief Run the hook, re-validate the registry and record the outage. */
+static int crumbs_recover_run(crumbs_recover_t *rec)
+{
+    int rc = rec->recover(rec->recover_io);
+    if (rc == 0)
+    {
+        rec->recoveries++;
+    }
+    else
+    {
+        rec->recover_errors++;
+    }
+
+    if (rec->registry)
+    {
+        int v = crumbs_registry_validate(rec->registry, rec->registry_bus, rec->registry_ctx, 0,
+                                         rec->inner->send, rec->inner->receive, rec->inner_io, 0u);
+        rec->last_validate = (int16_t)v;
+    }
+
+    uint32_t end = crumbs_recover_now_us(rec);
+    if (rec->clock && rec->fails > 0u)
+    {
+        rec->last_outage_us = end - rec->streak_start_us;
+        if (rec->last_outage_us > rec->max_outage_us)
+        {
+            rec->max_outage_us = rec->last_outage_us;
+        }
+    }
+    rec->last_recover_us = end;
+    rec->recovered = 1u;
+    rec->fails = 0u;
+    return rc;
+}
+
+/** @brief Count one transfer that started at @p t0; trip and recover when a threshold is met. */
+static void crumbs_recover_observe(crumbs_recover_t *rec, uint32_t t0, int failed)
+{
+    if (!failed)
+    {
+        rec->fails = 0u;
+        return;
+    }
+    if (rec->paused)
+    {
+        return;
+    }
+
+    uint32_t now = crumbs_recover_now_us(rec);
+    if (rec->fails == 0u)
+    {
+        rec->streak_start_us = t0;
+    }
+    if (rec->fails < 0xFFu)
+    {
+        rec->fails++;
+    }
+
+    if (rec->clock && rec->stall_us && now - t0 >= rec->stall_us)
+    {
+        rec->stall_trips++;
+    }
+    else if (rec->fail_limit && rec->fails >= rec->fail_limit)
+    {
+        rec->fail_trips++;
+    }
+    else
+    {
+        return;
+    }
+
+    if (!rec->recover)
+    {
+        rec->fails = 0u;
+        return;
+    }
+    if (rec->clock && rec->recovered && now - rec->last_recover_us < rec->holdoff_us)
+    {
+        rec->held_off++;
+        rec->fails = 0u;
+        return;
+    }
+    (void)crumbs_recover_run(rec);
+}
+
+static int crumbs_recover_send(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    crumbs_recover_t *rec = (crumbs_recover_t *)user_ctx;
+    uint32_t t0 = crumbs_recover_now_us(rec);
+    int rc = rec->inner->send(rec->inner_io, addr, data, len);
+    crumbs_recover_observe(rec, t0, rc < 0);
+    return rc;
+}
+
+static int crumbs_recover_receive(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len,
+                                  uint32_t timeout_us)
+{
+    crumbs_recover_t *rec = (crumbs_recover_t *)user_ctx;
+    uint32_t t0 = crumbs_recover_now_us(rec);
+    int rc = rec->inner->receive(rec->inner_io, addr, buffer, len, timeout_us);
+    /* A held bus reads back nothing rather than an error on some HALs (Wire.requestFrom). */
+    crumbs_recover_observe(rec, t0, rc < 0 || (rc == 0 && len > 0u));
+    return rc;
+}
+
+static int crumbs_recover_transact(void *user_ctx, uint8_t addr, const uint8_t *tx, size_t tx_len,
+                                   uint8_t *rx, size_t rx_len, uint32_t timeout_us,
+                                   int require_repeated_start)
+{
+    crumbs_recover_t *rec = (crumbs_recover_t *)user_ctx;
+    uint32_t t0 = crumbs_recover_now_us(rec);
+    int rc = rec->inner->transact(rec->inner_io, addr, tx, tx_len, rx, rx_len, timeout_us,
+                                  require_repeated_start);
+
+    /* A refused combined transfer says nothing about the bus. */
+    if (rc == CRUMBS_I2C_DEV_E_NO_REPEATED_START)
+    {
+        return rc;
+    }
+    crumbs_recover_observe(rec, t0, rc < 0 || (rc == 0 && rx_len > 0u));
+    return rc;
+}
+
+/* ---- Public API -------------------------------------------------------- */
+
+int crumbs_bus_clear(const crumbs_bus_pins_t *pins)
+{
+    if (!pins || !pins->set_scl || !pins->set_sda || !pins->get_sda)
+    {
+        return -1;
+    }
+
+    uint32_t half = pins->half_period_us ? pins->half_period_us : 5u;
+    int clocks = 0;
+
+    pins->set_sda(pins->user, 1);
+    pins->set_scl(pins->user, 1);
+    crumbs_bus_clear_wait(pins, half);
+
+    /* Each clock lets the slave shift out one more bit of the byte it was sending. */
+    while (clocks < 9 && !pins->get_sda(pins->user))
+    {
+        pins->set_scl(pins->user, 0);
+        crumbs_bus_clear_wait(pins, half);
+        pins->set_scl(pins->user, 1);
+        crumbs_bus_clear_wait(pins, half);
+        clocks++;
+    }
+
+    /* STOP: SDA rises while SCL is high. */
+    pins->set_scl(pins->user, 0);
+    crumbs_bus_clear_wait(pins, half);
+    pins->set_sda(pins->user, 0);
+    crumbs_bus_clear_wait(pins, half);
+    pins->set_scl(pins->user, 1);
+    crumbs_bus_clear_wait(pins, half);
+    pins->set_sda(pins->user, 1);
+    crumbs_bus_clear_wait(pins, half);
+
+    return pins->get_sda(pins->user) ? clocks : CRUMBS_RECOVER_E_STUCK;
+}
+
+int crumbs_recover_init(crumbs_recover_t *rec,
+                        const crumbs_transport_t *inner, void *inner_io,
+                        crumbs_clock_us_fn clock,
+                        crumbs_bus_recover_fn recover, void *recover_io)
+{
+    if (!rec || !inner || !inner->send)
+    {
+        return -1;
+    }
+
+    memset(rec, 0, sizeof(*rec));
+    rec->inner = inner;
+    rec->inner_io = inner_io;
+    rec->clock = clock;
+    rec->recover = recover;
+    rec->recover_io = recover_io;
+    rec->fail_limit = CRUMBS_RECOVER_FAIL_LIMIT;
+    rec->stall_us = CRUMBS_RECOVER_STALL_US;
+    rec->holdoff_us = CRUMBS_RECOVER_HOLDOFF_US;
+
+    rec->transport.name = "recover";
+    rec->transport.send = crumbs_recover_send;
+    rec->transport.receive = inner->receive ? crumbs_recover_receive : NULL;
+    rec->transport.transact = inner->transact ? crumbs_recover_transact : NULL;
+    rec->transport.caps = inner->caps;
+    rec->transport.max_frame = inner->max_frame;
+    return 0;
+}
+
+int crumbs_recover_attach(crumbs_recover_t *rec, crumbs_context_t *ctx,
+                          crumbs_clock_us_fn clock,
+                          crumbs_bus_recover_fn recover, void *recover_io)
+{
+    if (!ctx || !ctx->transport)
+    {
+        return -1;
+    }
+    if (crumbs_recover_init(rec, ctx->transport, ctx->transport_io, clock, recover, recover_io) != 0)
+    {
+        return -1;
+    }
+    crumbs_set_transport(ctx, &rec->transport, rec);
+    return 0;
+}
+
+void crumbs_recover_set_registry(crumbs_recover_t *rec, crumbs_registry_t *reg,
+                                 uint8_t bus, const crumbs_context_t *ctx)
+{
+    if (!rec)
+    {
+        return;
+    }
+    rec->registry = reg;
+    rec->registry_bus = bus;
+    rec->registry_ctx = ctx;
+}
+
+int crumbs_recover_now(crumbs_recover_t *rec)
+{
+    if (!rec || !rec->recover || !rec->inner)
+    {
+        return -1;
+    }
+    return crumbs_recover_run(rec);
+}
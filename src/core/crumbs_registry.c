@@ -0,0 +1,276 @@
+/**
+ * @file
+ * @brief Discovered-device registry and its binary form (see crumbs_registry.h).
+ */
+
+#include "crumbs_registry.h"
+
+#include <string.h> /* memmove */
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+static const uint8_t k_registry_magic[3] = {'C', 'R', 'G'};
+static const uint8_t k_registry_format = 1u;
+static const size_t k_registry_header_len = 5u; /* magic + format + count */
+
+static int crumbs_registry_index(const crumbs_registry_t *reg, uint8_t bus, uint8_t addr)
+{
+    for (uint8_t i = 0; i < reg->count; i++)
+    {
+        if (reg->entries[i].bus == bus && reg->entries[i].addr == addr)
+        {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+static void crumbs_registry_remove_at(crumbs_registry_t *reg, uint8_t i)
+{
+    memmove(&reg->entries[i], &reg->entries[i + 1u],
+            (size_t)(reg->count - i - 1u) * sizeof(reg->entries[0]));
+    reg->count--;
+}
+
+/* ---- Public API --------------------------------------------------------- */
+
+void crumbs_registry_init(crumbs_registry_t *reg)
+{
+    if (!reg)
+    {
+        return;
+    }
+    reg->count = 0u;
+}
+
+int crumbs_registry_put(crumbs_registry_t *reg, const crumbs_registry_entry_t *entry)
+{
+    if (!reg || !entry)
+    {
+        return -1;
+    }
+
+    int i = crumbs_registry_index(reg, entry->bus, entry->addr);
+    if (i < 0)
+    {
+        if (reg->count >= CRUMBS_REGISTRY_MAX)
+        {
+            return -1;
+        }
+        i = reg->count++;
+    }
+    reg->entries[i] = *entry;
+    return 0;
+}
+
+const crumbs_registry_entry_t *crumbs_registry_find(const crumbs_registry_t *reg,
+                                                    uint8_t bus,
+                                                    uint8_t addr)
+{
+    if (!reg)
+    {
+        return NULL;
+    }
+    int i = crumbs_registry_index(reg, bus, addr);
+    return (i < 0) ? NULL : &reg->entries[i];
+}
+
+int crumbs_registry_update_bus(crumbs_registry_t *reg,
+                               uint8_t bus,
+                               const uint8_t *addrs,
+                               const uint8_t *types,
+                               size_t count)
+{
+    if (!reg || (count > 0u && (!addrs || !types)))
+    {
+        return -1;
+    }
+
+    /* Drop entries on this bus that the scan no longer saw. */
+    for (uint8_t i = 0; i < reg->count;)
+    {
+        const crumbs_registry_entry_t *e = &reg->entries[i];
+        int seen = 0;
+        if (e->bus == bus)
+        {
+            for (size_t j = 0; j < count; j++)
+            {
+                if (addrs[j] == e->addr && types[j] == e->type_id)
+                {
+                    seen = 1;
+                    break;
+                }
+            }
+            if (!seen)
+            {
+                crumbs_registry_remove_at(reg, i);
+                continue;
+            }
+        }
+        i++;
+    }
+
+    for (size_t j = 0; j < count; j++)
+    {
+        if (crumbs_registry_index(reg, bus, addrs[j]) >= 0)
+        {
+            continue; /* unchanged; keep its version */
+        }
+        crumbs_registry_entry_t e = {0};
+        e.bus = bus;
+        e.addr = addrs[j];
+        e.type_id = types[j];
+        if (crumbs_registry_put(reg, &e) != 0)
+        {
+            return -1;
+        }
+    }
+    return (int)count;
+}
+
+int crumbs_registry_validate(crumbs_registry_t *reg,
+                             uint8_t bus,
+                             const crumbs_context_t *ctx,
+                             int strict,
+                             crumbs_i2c_write_fn write_fn,
+                             crumbs_i2c_read_fn read_fn,
+                             void *io_ctx,
+                             uint32_t timeout_us)
+{
+    uint8_t cand[CRUMBS_REGISTRY_MAX];
+    uint8_t found[CRUMBS_REGISTRY_MAX];
+    uint8_t types[CRUMBS_REGISTRY_MAX];
+    size_t n = 0u;
+
+    if (!reg || !read_fn)
+    {
+        return -1;
+    }
+
+    for (uint8_t i = 0; i < reg->count; i++)
+    {
+        if (reg->entries[i].bus == bus)
+        {
+            cand[n++] = reg->entries[i].addr;
+        }
+    }
+    if (n == 0u)
+    {
+        return -2;
+    }
+
+    int rc = crumbs_controller_scan_for_crumbs_candidates(ctx, cand, n, strict,
+                                                          write_fn, read_fn, io_ctx,
+                                                          found, types, n, timeout_us);
+    if (rc < 0)
+    {
+        return rc;
+    }
+
+    int stale = 0;
+    for (uint8_t i = 0; i < reg->count;)
+    {
+        const crumbs_registry_entry_t *e = &reg->entries[i];
+        if (e->bus == bus)
+        {
+            int ok = 0;
+            for (int j = 0; j < rc; j++)
+            {
+                if (found[j] == e->addr && types[j] == e->type_id)
+                {
+                    ok = 1;
+                    break;
+                }
+            }
+            if (!ok)
+            {
+                CRUMBS_DBG("registry: 0x%02X on bus %u is stale\n", e->addr, e->bus);
+                crumbs_registry_remove_at(reg, i);
+                stale++;
+                continue;
+            }
+        }
+        i++;
+    }
+    return stale;
+}
+
+size_t crumbs_registry_save(const crumbs_registry_t *reg, uint8_t *buf, size_t len)
+{
+    if (!reg || !buf)
+    {
+        return 0u;
+    }
+
+    size_t need = k_registry_header_len + (size_t)reg->count * CRUMBS_REGISTRY_ENTRY_SIZE + 1u;
+    if (len < need)
+    {
+        return 0u;
+    }
+
+    size_t pos = 0u;
+    buf[pos++] = k_registry_magic[0];
+    buf[pos++] = k_registry_magic[1];
+    buf[pos++] = k_registry_magic[2];
+    buf[pos++] = k_registry_format;
+    buf[pos++] = reg->count;
+    for (uint8_t i = 0; i < reg->count; i++)
+    {
+        const crumbs_registry_entry_t *e = &reg->entries[i];
+        buf[pos++] = e->bus;
+        buf[pos++] = e->addr;
+        buf[pos++] = e->type_id;
+        buf[pos++] = e->mod_major;
+        buf[pos++] = e->mod_minor;
+        buf[pos++] = e->mod_patch;
+        buf[pos++] = (uint8_t)(e->crumbs_version & 0xFFu);
+        buf[pos++] = (uint8_t)(e->crumbs_version >> 8);
+    }
+    buf[pos] = crumbs_crc8(buf, pos);
+    return pos + 1u;
+}
+
+int crumbs_registry_load(crumbs_registry_t *reg, const uint8_t *buf, size_t len)
+{
+    if (!reg)
+    {
+        return -1;
+    }
+    reg->count = 0u;
+    if (!buf || len < k_registry_header_len + 1u)
+    {
+        return -1;
+    }
+
+    if (buf[0] != k_registry_magic[0] || buf[1] != k_registry_magic[1] ||
+        buf[2] != k_registry_magic[2] || buf[3] != k_registry_format)
+    {
+        return -1;
+    }
+
+    uint8_t count = buf[4];
+    if (count > CRUMBS_REGISTRY_MAX ||
+        len != k_registry_header_len + (size_t)count * CRUMBS_REGISTRY_ENTRY_SIZE + 1u)
+    {
+        return -1;
+    }
+    if (crumbs_crc8(buf, len - 1u) != buf[len - 1u])
+    {
+        return -2;
+    }
+
+    const uint8_t *p = buf + k_registry_header_len;
+    for (uint8_t i = 0; i < count; i++, p += CRUMBS_REGISTRY_ENTRY_SIZE)
+    {
+        crumbs_registry_entry_t *e = &reg->entries[i];
+        e->bus = p[0];
+        e->addr = p[1];
+        e->type_id = p[2];
+        e->mod_major = p[3];
+        e->mod_minor = p[4];
+        e->mod_patch = p[5];
+        e->crumbs_version = (uint16_t)(p[6] | ((uint16_t)p[7] << 8));
+    }
+    reg->count = count;
+    return 0;
+}
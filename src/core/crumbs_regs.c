@@ -0,0 +1,178 @@
+/**
+ * @file
+ * @brief Register-file reads and the CRUMBS_CMD_REG_READ extension (0xF5).
+ *
+ * A REG_READ write stores the range and selects REG_READ as the reply in
+ * one go, so the controller skips the separate SET_REPLY. The reply is
+ * copied from the region by crumbs_ext_build_reply(), ahead of the reply
+ * handlers and on_request. The controller helpers are always built.
+ */
+
+#include "crumbs_internal.h"
+
+#include <string.h> /* memcpy */
+
+/* ---- Peripheral side ---------------------------------------------------- */
+
+int crumbs_set_register_file(crumbs_context_t *ctx, const void *base, uint16_t size)
+{
+#if CRUMBS_ENABLE_REGISTERS
+    if (!ctx)
+    {
+        return -1;
+    }
+    ctx->reg_base = (const uint8_t *)base;
+    ctx->reg_size = base ? size : 0u;
+    ctx->reg_offset = 0u;
+    ctx->reg_count = 0u;
+    return 0;
+#else
+    (void)ctx;
+    (void)base;
+    (void)size;
+    return -1;
+#endif
+}
+
+#if CRUMBS_ENABLE_REGISTERS
+int crumbs_regs_receive(crumbs_context_t *ctx, const crumbs_frame_view_t *view)
+{
+    if (!ctx->reg_base)
+    {
+        return 0;
+    }
+    if (view->data_len < 3u)
+    {
+        return 1;
+    }
+
+    uint8_t count = view->data[2];
+    ctx->reg_offset = (uint16_t)(view->data[0] | ((uint16_t)view->data[1] << 8));
+    ctx->reg_count = count > CRUMBS_REG_MAX_READ ? (uint8_t)CRUMBS_REG_MAX_READ : count;
+    ctx->requested_opcode = CRUMBS_CMD_REG_READ;
+    return 1;
+}
+
+int crumbs_regs_reply(const crumbs_context_t *ctx, crumbs_message_t *msg)
+{
+    if (!ctx->reg_base)
+    {
+        return 0;
+    }
+
+    uint8_t n = 0u;
+    if (ctx->reg_offset < ctx->reg_size)
+    {
+        uint16_t left = (uint16_t)(ctx->reg_size - ctx->reg_offset);
+        n = left < ctx->reg_count ? (uint8_t)left : ctx->reg_count;
+    }
+
+    msg->type_id = 0u;
+    msg->opcode = CRUMBS_CMD_REG_READ;
+    msg->data_len = (uint8_t)(2u + n);
+    msg->data[0] = (uint8_t)(ctx->reg_offset & 0xFFu);
+    msg->data[1] = (uint8_t)(ctx->reg_offset >> 8);
+    memcpy(&msg->data[2], ctx->reg_base + ctx->reg_offset, n);
+    return 1;
+}
+#endif
+
+/* ---- Controller side ---------------------------------------------------- */
+
+static void crumbs_regs_request(crumbs_frame_builder_t *fb, uint16_t offset, uint8_t len)
+{
+    crumbs_fb_init(fb, 0u, CRUMBS_CMD_REG_READ);
+    crumbs_fb_add_u16(fb, offset);
+    crumbs_fb_add_u8(fb, len);
+}
+
+/** @brief Copy the payload of a REG_READ reply if it is the range asked for. */
+static int crumbs_regs_accept(const crumbs_message_t *reply, uint16_t offset, uint8_t *out, uint8_t len)
+{
+    if (reply->opcode != CRUMBS_CMD_REG_READ || reply->data_len != 2u + len ||
+        (uint16_t)(reply->data[0] | ((uint16_t)reply->data[1] << 8)) != offset)
+    {
+        return -1;
+    }
+    memcpy(out, &reply->data[2], len);
+    return 0;
+}
+
+int crumbs_controller_read_registers(const crumbs_device_t *dev,
+                                     uint16_t offset,
+                                     uint8_t *out,
+                                     size_t len)
+{
+    if (!dev || !dev->ctx || !dev->write_fn || !dev->read_fn || (!out && len != 0u) ||
+        (size_t)offset + len > 0x10000u)
+    {
+        return -1;
+    }
+
+    while (len != 0u)
+    {
+        uint8_t chunk = len > CRUMBS_REG_MAX_READ ? (uint8_t)CRUMBS_REG_MAX_READ : (uint8_t)len;
+        crumbs_frame_builder_t fb;
+        crumbs_regs_request(&fb, offset, chunk);
+        int rc = crumbs_controller_send_frame(dev->ctx, dev->addr, &fb, dev->write_fn, dev->io);
+        if (rc != 0)
+        {
+            return rc;
+        }
+
+        crumbs_message_t reply;
+        rc = crumbs_controller_read_len(dev->ctx, dev->addr, &reply, dev->read_fn, dev->io,
+                                        (uint8_t)(2u + chunk));
+        if (rc != 0)
+        {
+            return rc;
+        }
+        if (crumbs_regs_accept(&reply, offset, out, chunk) != 0)
+        {
+            return -1;
+        }
+
+        out += chunk;
+        offset = (uint16_t)(offset + chunk);
+        len -= chunk;
+    }
+    return 0;
+}
+
+int crumbs_controller_query_registers(crumbs_context_t *ctx,
+                                      uint8_t target_addr,
+                                      uint16_t offset,
+                                      uint8_t *out,
+                                      uint8_t len,
+                                      crumbs_i2c_write_read_fn write_read_fn,
+                                      void *io)
+{
+    if (!ctx || !write_read_fn || (!out && len != 0u) || len > CRUMBS_REG_MAX_READ ||
+        ctx->role != CRUMBS_ROLE_CONTROLLER)
+    {
+        return -1;
+    }
+
+    crumbs_frame_builder_t fb;
+    crumbs_regs_request(&fb, offset, len);
+    size_t tx_len = crumbs_fb_finish(&fb);
+
+    uint8_t buf[CRUMBS_MESSAGE_MAX_SIZE];
+    int n = write_read_fn(io, target_addr, fb.frame, tx_len, buf, 6u + len, 0u, 1);
+    if (n == CRUMBS_I2C_DEV_E_NO_REPEATED_START)
+    {
+        return n;
+    }
+    if (n < 4)
+    {
+        return -1;
+    }
+
+    crumbs_message_t reply;
+    int rc = crumbs_decode_message(buf, (size_t)n, &reply, ctx);
+    if (rc != 0)
+    {
+        return rc;
+    }
+    return crumbs_regs_accept(&reply, offset, out, len);
+}
@@ -0,0 +1,134 @@
+/**
+ * @file
+ * @brief Command results and the CRUMBS_CMD_RESULT reply (0xF1).
+ *
+ * crumbs_peripheral_dispatch_view() records a result after every command
+ * it hands to on_message and the handlers, and arms it.
+ * crumbs_peripheral_fill_reply() then answers the next read with it
+ * instead of the selected reply. The controller helpers are always built.
+ */
+
+#include "crumbs_internal.h"
+
+/* ---- Peripheral side ---------------------------------------------------- */
+
+int crumbs_set_result(crumbs_context_t *ctx, uint8_t status)
+{
+#if CRUMBS_ENABLE_RESULT
+    if (!ctx)
+    {
+        return -1;
+    }
+    ctx->result_status = status;
+    ctx->result_set = 1u;
+    return 0;
+#else
+    (void)ctx;
+    (void)status;
+    return -1;
+#endif
+}
+
+int crumbs_last_result(const crumbs_context_t *ctx, crumbs_result_t *out)
+{
+#if CRUMBS_ENABLE_RESULT
+    if (!ctx || !out)
+    {
+        return -1;
+    }
+    out->opcode = ctx->result_opcode;
+    out->status = ctx->result_status;
+    out->count = ctx->result_count;
+    return 0;
+#else
+    (void)ctx;
+    (void)out;
+    return -1;
+#endif
+}
+
+#if CRUMBS_ENABLE_RESULT
+void crumbs_result_record(crumbs_context_t *ctx, uint8_t opcode, uint8_t status)
+{
+    ctx->result_opcode = opcode;
+    if (!ctx->result_set)
+    {
+        ctx->result_status = status;
+    }
+    ctx->result_set = 0u;
+    ctx->result_count++;
+    ctx->result_armed = 1u;
+}
+
+int crumbs_result_reply(const crumbs_context_t *ctx, crumbs_message_t *msg)
+{
+    msg->type_id = 0u;
+    msg->opcode = CRUMBS_CMD_RESULT;
+    msg->data_len = 3u;
+    msg->data[0] = ctx->result_opcode;
+    msg->data[1] = ctx->result_status;
+    msg->data[2] = ctx->result_count;
+    return 1;
+}
+#endif
+
+/* ---- Controller side ---------------------------------------------------- */
+
+static int crumbs_result_parse(const crumbs_message_t *reply, crumbs_result_t *out)
+{
+    if (reply->opcode != CRUMBS_CMD_RESULT || reply->data_len < 3u)
+    {
+        return -1;
+    }
+    out->opcode = reply->data[0];
+    out->status = reply->data[1];
+    out->count = reply->data[2];
+    return 0;
+}
+
+int crumbs_controller_send_checked(const crumbs_device_t *dev,
+                                   const crumbs_message_t *msg,
+                                   crumbs_result_t *out)
+{
+    crumbs_message_t reply;
+
+    if (!dev || !dev->ctx || !dev->write_fn || !dev->read_fn || !msg || !out)
+    {
+        return -1;
+    }
+    int rc = crumbs_controller_send(dev->ctx, dev->addr, msg, dev->write_fn, dev->io);
+    if (rc != 0)
+    {
+        return rc;
+    }
+    if (CRUMBS_RESULT_DELAY_US > 0u && dev->delay_fn)
+    {
+        dev->delay_fn(CRUMBS_RESULT_DELAY_US);
+    }
+    rc = crumbs_controller_read(dev->ctx, dev->addr, &reply, dev->read_fn, dev->io);
+    if (rc != 0)
+    {
+        return rc;
+    }
+    if (crumbs_result_parse(&reply, out) != 0)
+    {
+        return -1;
+    }
+    return (out->opcode == msg->opcode) ? 0 : -1;
+}
+
+int crumbs_controller_get_result(const crumbs_device_t *dev, crumbs_result_t *out)
+{
+    crumbs_message_t reply;
+
+    if (!dev || !out)
+    {
+        return -1;
+    }
+    int rc = crumbs_ext_query(dev, CRUMBS_CMD_RESULT, &reply);
+    if (rc != 0)
+    {
+        return rc;
+    }
+    return crumbs_result_parse(&reply, out);
+}
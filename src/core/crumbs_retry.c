@@ -0,0 +1,301 @@
+/**
+ * @file
+ * @brief Controller retry policy and per-address circuit breaker.
+ */
+
+#include "crumbs_retry.h"
+#include "crumbs_latency.h"
+
+#include <string.h> /* memset */
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+static uint32_t crumbs_retry_random(crumbs_retry_t *r)
+{
+    uint32_t x = r->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    r->rng = x;
+    return x;
+}
+
+/** @brief @p wait_us with up to jitter_pct percent taken off at random. */
+static uint32_t crumbs_retry_jitter(crumbs_retry_t *r, uint32_t wait_us)
+{
+    uint32_t cut = (uint32_t)(((uint64_t)wait_us * r->policy.jitter_pct) / 100u);
+    if (cut == 0u)
+    {
+        return wait_us;
+    }
+    return wait_us - crumbs_retry_random(r) % (cut + 1u);
+}
+
+static crumbs_breaker_t *crumbs_breaker_find(const crumbs_retry_t *r, uint8_t addr)
+{
+    for (size_t i = 0; i < CRUMBS_RETRY_BREAKERS; i++)
+    {
+        const crumbs_breaker_t *b = &r->breakers[i];
+        if (b->addr == addr && (b->failures != 0u || b->state != CRUMBS_BREAKER_CLOSED))
+        {
+            return (crumbs_breaker_t *)b;
+        }
+    }
+    return NULL;
+}
+
+static crumbs_breaker_t *crumbs_breaker_claim(crumbs_retry_t *r, uint8_t addr)
+{
+    for (size_t i = 0; i < CRUMBS_RETRY_BREAKERS; i++)
+    {
+        crumbs_breaker_t *b = &r->breakers[i];
+        if (b->failures == 0u && b->state == CRUMBS_BREAKER_CLOSED)
+        {
+            memset(b, 0, sizeof(*b));
+            b->addr = addr;
+            return b;
+        }
+    }
+    return NULL; /* every slot holds a failing device; this one goes untracked */
+}
+
+/**
+ * @brief One send, or one SET_REPLY + wait + read when @p out is set.
+ *
+ * @param[out] cls CRUMBS_FAIL_* of the result.
+ */
+static int crumbs_retry_attempt(const crumbs_device_t *dev, const crumbs_message_t *msg,
+                                uint8_t opcode, crumbs_message_t *out, uint8_t *cls)
+{
+    int rc;
+
+    if (!out)
+    {
+        rc = crumbs_controller_send(dev->ctx, dev->addr, msg, dev->write_fn, dev->io);
+        *cls = crumbs_retry_classify(rc, 0);
+        return rc;
+    }
+
+    crumbs_frame_builder_t fb;
+    crumbs_fb_init(&fb, 0u, CRUMBS_CMD_SET_REPLY);
+    crumbs_fb_add_u8(&fb, opcode);
+    rc = crumbs_controller_send_frame(dev->ctx, dev->addr, &fb, dev->write_fn, dev->io);
+    if (rc != 0)
+    {
+        *cls = crumbs_retry_classify(rc, 0);
+        return rc;
+    }
+
+    uint32_t delay_us = crumbs_device_query_delay(dev, opcode);
+    dev->delay_fn(delay_us);
+    rc = crumbs_controller_read(dev->ctx, dev->addr, out, dev->read_fn, dev->io);
+    if (rc == 0 && out->opcode != opcode)
+    {
+        rc = -1;
+    }
+    crumbs_device_query_result(dev, opcode, delay_us, rc == 0);
+    *cls = crumbs_retry_classify(rc, 1);
+    return rc;
+}
+
+static int crumbs_retry_run(crumbs_retry_t *r, const crumbs_device_t *dev,
+                            const crumbs_message_t *msg, uint8_t opcode, crumbs_message_t *out)
+{
+    if (!crumbs_breaker_allow(r, dev->addr))
+    {
+        r->rejected++;
+        return CRUMBS_RETRY_E_OPEN;
+    }
+
+    int probing = crumbs_breaker_state(r, dev->addr) == CRUMBS_BREAKER_PROBE;
+    uint8_t nacks = 0u;
+    uint8_t crcs = 0u;
+    uint32_t wait_us = r->policy.backoff_us;
+    int rc;
+
+    for (;;)
+    {
+        uint8_t cls;
+        rc = crumbs_retry_attempt(dev, msg, opcode, out, &cls);
+        r->attempts++;
+        if (cls == CRUMBS_FAIL_NONE)
+        {
+            break;
+        }
+
+        if (cls == CRUMBS_FAIL_CRC)
+        {
+            r->crc_failures++;
+            if (probing || ++crcs >= r->policy.crc_attempts)
+            {
+                break;
+            }
+        }
+        else
+        {
+            r->nack_failures++;
+            if (probing || ++nacks >= r->policy.max_attempts)
+            {
+                break;
+            }
+            if (dev->delay_fn && wait_us != 0u)
+            {
+                dev->delay_fn(crumbs_retry_jitter(r, wait_us));
+            }
+            wait_us = (wait_us > r->policy.backoff_max_us / 2u) ? r->policy.backoff_max_us : wait_us * 2u;
+        }
+        r->retries++;
+    }
+
+    crumbs_breaker_report(r, dev->addr, rc == 0);
+    return rc;
+}
+
+/* ---- Policy ------------------------------------------------------------- */
+
+void crumbs_retry_policy_default(crumbs_retry_policy_t *policy)
+{
+    if (!policy)
+    {
+        return;
+    }
+    policy->max_attempts = 3u;
+    policy->crc_attempts = 3u;
+    policy->jitter_pct = 25u;
+    policy->trip_after = 3u;
+    policy->backoff_us = 1000u;
+    policy->backoff_max_us = 20000u;
+    policy->probe_interval_us = 1000000u;
+}
+
+void crumbs_retry_init(crumbs_retry_t *r, const crumbs_retry_policy_t *policy,
+                       crumbs_clock_us_fn clock, uint32_t seed)
+{
+    if (!r)
+    {
+        return;
+    }
+    memset(r, 0, sizeof(*r));
+    if (policy)
+    {
+        r->policy = *policy;
+    }
+    else
+    {
+        crumbs_retry_policy_default(&r->policy);
+    }
+    r->clock = clock;
+    r->rng = seed ? seed : 1u;
+}
+
+uint8_t crumbs_retry_classify(int rc, int read)
+{
+    if (rc == 0)
+    {
+        return CRUMBS_FAIL_NONE;
+    }
+    /* crumbs_controller_read() returns -2 only for a CRC mismatch. */
+    return (read && rc == -2) ? CRUMBS_FAIL_CRC : CRUMBS_FAIL_NACK;
+}
+
+/* ---- Wrapped transfers -------------------------------------------------- */
+
+int crumbs_retry_send(crumbs_retry_t *r, const crumbs_device_t *dev, const crumbs_message_t *msg)
+{
+    if (!r || !dev || !dev->ctx || !dev->write_fn || !msg || msg->data_len > CRUMBS_MAX_PAYLOAD)
+    {
+        return -1;
+    }
+    return crumbs_retry_run(r, dev, msg, 0u, NULL);
+}
+
+int crumbs_retry_get(crumbs_retry_t *r, const crumbs_device_t *dev, uint8_t opcode,
+                     crumbs_message_t *out)
+{
+    if (!r || !dev || !dev->ctx || !dev->write_fn || !dev->read_fn || !dev->delay_fn || !out)
+    {
+        return -1;
+    }
+    return crumbs_retry_run(r, dev, NULL, opcode, out);
+}
+
+/* ---- Circuit breaker ---------------------------------------------------- */
+
+int crumbs_breaker_allow(crumbs_retry_t *r, uint8_t addr)
+{
+    if (!r)
+    {
+        return 1;
+    }
+    crumbs_breaker_t *b = crumbs_breaker_find(r, addr);
+    if (!b || b->state != CRUMBS_BREAKER_OPEN || !r->clock)
+    {
+        return 1;
+    }
+    if ((int32_t)(r->clock() - b->next_probe_us) < 0)
+    {
+        return 0;
+    }
+    b->state = CRUMBS_BREAKER_PROBE;
+    return 1;
+}
+
+void crumbs_breaker_report(crumbs_retry_t *r, uint8_t addr, int ok)
+{
+    if (!r)
+    {
+        return;
+    }
+    crumbs_breaker_t *b = crumbs_breaker_find(r, addr);
+    if (ok)
+    {
+        if (b)
+        {
+            b->state = CRUMBS_BREAKER_CLOSED;
+            b->failures = 0u; /* frees the slot */
+        }
+        return;
+    }
+    if (!r->clock || r->policy.trip_after == 0u)
+    {
+        return;
+    }
+
+    if (!b)
+    {
+        b = crumbs_breaker_claim(r, addr);
+        if (!b)
+        {
+            return;
+        }
+    }
+    if (b->failures != 0xFFu)
+    {
+        b->failures++;
+    }
+
+    if (b->state == CRUMBS_BREAKER_PROBE || b->failures >= r->policy.trip_after)
+    {
+        if (b->state == CRUMBS_BREAKER_CLOSED && b->trips != 0xFFFFu)
+        {
+            b->trips++;
+        }
+        b->state = CRUMBS_BREAKER_OPEN;
+        b->next_probe_us = r->clock() + r->policy.probe_interval_us;
+    }
+}
+
+uint8_t crumbs_breaker_state(const crumbs_retry_t *r, uint8_t addr)
+{
+    const crumbs_breaker_t *b = r ? crumbs_breaker_find(r, addr) : NULL;
+    return b ? b->state : CRUMBS_BREAKER_CLOSED;
+}
+
+void crumbs_breaker_reset(crumbs_retry_t *r, uint8_t addr)
+{
+    crumbs_breaker_t *b = r ? crumbs_breaker_find(r, addr) : NULL;
+    if (b)
+    {
+        memset(b, 0, sizeof(*b));
+    }
+}
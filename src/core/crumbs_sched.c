@@ -0,0 +1,338 @@
+/**
+ * @file
+ * @brief Periodic telemetry scheduler (see crumbs_sched.h).
+ */
+
+#include "crumbs_sched.h"
+
+#include <string.h> /* memset */
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+/* SET_REPLY write: addr + [type][0xFE][1][opcode][crc]; reply read: addr + 4 + len. */
+static const uint32_t k_sched_write_bytes = 6u;
+static const uint32_t k_sched_read_overhead = 5u;
+
+static int crumbs_sched_reached(uint32_t now_us, uint32_t due_us)
+{
+    return (int32_t)(now_us - due_us) >= 0;
+}
+
+/** @brief Bus time of one run: 9 clocks per byte (8 data + ACK). */
+static uint32_t crumbs_sched_cost_us(uint8_t reply_len)
+{
+    uint32_t bits = (k_sched_write_bytes + k_sched_read_overhead + reply_len) * 9u;
+    return (uint32_t)(((uint64_t)bits * 1000000u + CRUMBS_SCHED_BUS_HZ - 1u) / CRUMBS_SCHED_BUS_HZ);
+}
+
+/** @brief Move next_release_us past @p now_us; returns the releases skipped. */
+static uint32_t crumbs_sched_advance(crumbs_sched_task_t *t, uint32_t now_us)
+{
+    t->next_release_us += t->period_us;
+    if (!crumbs_sched_reached(now_us, t->next_release_us))
+    {
+        return 0u;
+    }
+    uint32_t skipped = (now_us - t->next_release_us) / t->period_us + 1u;
+    t->next_release_us += skipped * t->period_us;
+    return skipped;
+}
+
+static void crumbs_sched_on_done(crumbs_request_t *req, int status)
+{
+    crumbs_sched_task_t *t = (crumbs_sched_task_t *)req->user_data;
+    uint32_t latency = t->sched->now_us - t->release_us;
+
+    t->in_flight = 0u;
+    t->runs++;
+    t->last_latency_us = latency;
+    if (latency > t->max_latency_us)
+    {
+        t->max_latency_us = latency;
+    }
+    if (latency > t->deadline_us)
+    {
+        t->misses++;
+    }
+    if (status != 0)
+    {
+        t->errors++;
+    }
+    if (t->on_reply)
+    {
+        t->on_reply(t, status, &req->reply);
+    }
+}
+
+static int crumbs_sched_add_task(crumbs_sched_t *sched,
+                                 const crumbs_device_t *dev,
+                                 uint8_t opcode,
+                                 uint8_t reply_len,
+                                 uint32_t period_us,
+                                 uint32_t deadline_us,
+                                 uint8_t on_attention,
+                                 crumbs_sched_cb on_reply,
+                                 void *user_data)
+{
+    if (!sched || !sched->eng || !dev || !dev->write_fn || !dev->read_fn ||
+        period_us == 0u || deadline_us > period_us || reply_len > CRUMBS_MAX_PAYLOAD ||
+        sched->count >= CRUMBS_SCHED_MAX_TASKS)
+    {
+        return -1;
+    }
+
+    uint32_t cost = crumbs_sched_cost_us(reply_len);
+    uint64_t util = ((uint64_t)cost * 1000u + period_us - 1u) / period_us;
+    if (sched->util_pm + util > CRUMBS_SCHED_MAX_UTIL_PCT * 10u)
+    {
+        CRUMBS_DBG("sched: refusing task (utilization %lu + %lu per mille)\n",
+                   (unsigned long)sched->util_pm, (unsigned long)util);
+        return -2;
+    }
+
+    uint8_t idx = sched->count;
+    crumbs_sched_task_t *t = &sched->tasks[idx];
+    memset(t, 0, sizeof(*t));
+    t->sched = sched;
+    t->on_reply = on_reply;
+    t->user_data = user_data;
+    t->period_us = period_us;
+    t->deadline_us = deadline_us ? deadline_us : period_us;
+    t->cost_us = cost;
+    t->on_attention = on_attention;
+    crumbs_request_init(&t->req, dev, opcode, crumbs_sched_on_done, t);
+    t->req.reply_len = reply_len;
+
+    /* Rate-monotonic order: shorter period first, ties in add order. */
+    uint8_t pos = idx;
+    while (pos > 0u && sched->tasks[sched->order[pos - 1u]].period_us > period_us)
+    {
+        sched->order[pos] = sched->order[pos - 1u];
+        pos--;
+    }
+    sched->order[pos] = idx;
+
+    sched->util_pm += (uint32_t)util;
+    sched->count++;
+    return (int)idx;
+}
+
+/** @brief Release an attention task once its interval allows it. */
+static void crumbs_sched_release_attention(crumbs_sched_t *sched, crumbs_sched_task_t *t, uint32_t now_us)
+{
+    if (!t->attention || t->in_flight || (t->started && !crumbs_sched_reached(now_us, t->next_release_us)))
+    {
+        return;
+    }
+
+    t->started = 1u;
+    t->attention = 0u;
+    t->release_us = t->attention_us;
+    t->next_release_us = now_us + t->period_us;
+
+    uint32_t jitter = now_us - t->release_us;
+    if (jitter > t->max_jitter_us)
+    {
+        t->max_jitter_us = jitter;
+    }
+    if (crumbs_engine_submit(sched->eng, &t->req) == 0)
+    {
+        t->in_flight = 1u;
+    }
+    else
+    {
+        t->errors++;
+    }
+}
+
+/* ---- Public API --------------------------------------------------------- */
+
+void crumbs_sched_init(crumbs_sched_t *sched, crumbs_engine_t *eng)
+{
+    if (!sched)
+    {
+        return;
+    }
+    sched->eng = eng;
+    sched->count = 0u;
+    sched->util_pm = 0u;
+    sched->now_us = 0u;
+}
+
+int crumbs_sched_add(crumbs_sched_t *sched,
+                     const crumbs_device_t *dev,
+                     uint8_t opcode,
+                     uint8_t reply_len,
+                     uint32_t period_us,
+                     uint32_t deadline_us,
+                     crumbs_sched_cb on_reply,
+                     void *user_data)
+{
+    return crumbs_sched_add_task(sched, dev, opcode, reply_len, period_us, deadline_us, 0u,
+                                 on_reply, user_data);
+}
+
+int crumbs_sched_add_on_attention(crumbs_sched_t *sched,
+                                  const crumbs_device_t *dev,
+                                  uint8_t opcode,
+                                  uint8_t reply_len,
+                                  uint32_t min_interval_us,
+                                  uint32_t deadline_us,
+                                  crumbs_sched_cb on_reply,
+                                  void *user_data)
+{
+    return crumbs_sched_add_task(sched, dev, opcode, reply_len, min_interval_us, deadline_us, 1u,
+                                 on_reply, user_data);
+}
+
+int crumbs_sched_attention(crumbs_sched_t *sched, uint8_t addr, uint32_t now_us)
+{
+    if (!sched)
+    {
+        return -1;
+    }
+
+    int marked = 0;
+    for (uint8_t i = 0; i < sched->count; i++)
+    {
+        crumbs_sched_task_t *t = &sched->tasks[i];
+        if (t->on_attention && (addr == CRUMBS_SCHED_ANY_ADDR || t->req.dev->addr == addr))
+        {
+            if (!t->attention)
+            {
+                t->attention = 1u;
+                t->attention_us = now_us;
+            }
+            marked++;
+        }
+    }
+    return marked;
+}
+
+int crumbs_sched_service_alert(crumbs_sched_t *sched, crumbs_i2c_read_fn read_fn, void *io,
+                               uint32_t now_us)
+{
+    if (!sched || !read_fn)
+    {
+        return -1;
+    }
+
+    int found = 0;
+    uint8_t addr;
+    while (found < CRUMBS_SCHED_MAX_TASKS && crumbs_controller_alert_response(read_fn, io, &addr) == 1)
+    {
+        crumbs_sched_attention(sched, addr, now_us);
+        found++;
+    }
+    if (found == 0)
+    {
+        crumbs_sched_attention(sched, CRUMBS_SCHED_ANY_ADDR, now_us);
+    }
+    return found;
+}
+
+int crumbs_sched_poll(crumbs_sched_t *sched, uint32_t now_us)
+{
+    if (!sched || !sched->eng)
+    {
+        return -1;
+    }
+
+    sched->now_us = now_us;
+    for (uint8_t k = 0; k < sched->count; k++)
+    {
+        crumbs_sched_task_t *t = &sched->tasks[sched->order[k]];
+
+        if (t->on_attention)
+        {
+            crumbs_sched_release_attention(sched, t, now_us);
+            continue;
+        }
+        if (!t->started)
+        {
+            t->started = 1u;
+            t->next_release_us = now_us;
+        }
+        if (!crumbs_sched_reached(now_us, t->next_release_us))
+        {
+            continue;
+        }
+
+        if (t->in_flight)
+        {
+            /* Overrun: the previous run still holds the request. */
+            t->misses += crumbs_sched_advance(t, now_us) + 1u;
+            continue;
+        }
+
+        t->release_us = t->next_release_us;
+        t->misses += crumbs_sched_advance(t, now_us);
+
+        uint32_t jitter = now_us - t->release_us;
+        if (jitter > t->max_jitter_us)
+        {
+            t->max_jitter_us = jitter;
+        }
+        if (crumbs_engine_submit(sched->eng, &t->req) == 0)
+        {
+            t->in_flight = 1u;
+        }
+        else
+        {
+            t->errors++;
+        }
+    }
+
+    return crumbs_engine_poll(sched->eng, now_us);
+}
+
+uint32_t crumbs_sched_idle_us(const crumbs_sched_t *sched, uint32_t now_us)
+{
+    if (!sched)
+    {
+        return UINT32_MAX;
+    }
+
+    uint32_t best = crumbs_engine_idle_us(sched->eng, now_us);
+    for (uint8_t i = 0; i < sched->count && best > 0u; i++)
+    {
+        const crumbs_sched_task_t *t = &sched->tasks[i];
+        if (t->on_attention && (!t->attention || t->in_flight))
+        {
+            continue; /* nothing to release until the line or the engine moves */
+        }
+        if (!t->started || crumbs_sched_reached(now_us, t->next_release_us))
+        {
+            return 0u;
+        }
+        uint32_t left = t->next_release_us - now_us;
+        if (left < best)
+        {
+            best = left;
+        }
+    }
+    return best;
+}
+
+uint32_t crumbs_sched_utilization_pct(const crumbs_sched_t *sched)
+{
+    return sched ? (sched->util_pm + 9u) / 10u : 0u;
+}
+
+void crumbs_sched_reset_stats(crumbs_sched_t *sched)
+{
+    if (!sched)
+    {
+        return;
+    }
+    for (uint8_t i = 0; i < sched->count; i++)
+    {
+        crumbs_sched_task_t *t = &sched->tasks[i];
+        t->runs = 0u;
+        t->misses = 0u;
+        t->errors = 0u;
+        t->last_latency_us = 0u;
+        t->max_latency_us = 0u;
+        t->max_jitter_us = 0u;
+    }
+}
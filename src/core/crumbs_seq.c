@@ -0,0 +1,269 @@
+/**
+ * @file
+ * @brief Sequence-numbered commands and the CRUMBS_CMD_SEQUENCED extension (0xF2).
+ *
+ * A SEQUENCED frame reaches crumbs_seq_receive() from
+ * crumbs_peripheral_handle_receive() through the extension dispatch. An
+ * accepted inner command is dispatched again as its own view, so
+ * handlers, staging and the other extensions see it exactly once. The
+ * controller session helpers are always built.
+ */
+
+#include "crumbs_internal.h"
+#include "crumbs_seq.h"
+
+#include <string.h> /* memset */
+
+/** @brief Sequence @p n steps after @p seq in the 1..255 cycle (0 counts as 255). */
+static uint8_t crumbs_seq_after(uint8_t seq, unsigned n)
+{
+    unsigned base = seq ? seq : 255u;
+    return (uint8_t)((base - 1u + n) % 255u + 1u);
+}
+
+/* ---- Peripheral side ---------------------------------------------------- */
+
+int crumbs_seq_last_applied(const crumbs_context_t *ctx)
+{
+#if CRUMBS_ENABLE_SEQUENCED
+    return (ctx && ctx->seq_active) ? ctx->seq_last : -1;
+#else
+    (void)ctx;
+    return -1;
+#endif
+}
+
+int crumbs_seq_get_status(const crumbs_context_t *ctx, crumbs_seq_status_t *out)
+{
+#if CRUMBS_ENABLE_SEQUENCED
+    if (!ctx || !out)
+    {
+        return -1;
+    }
+    out->active = ctx->seq_active;
+    out->last = ctx->seq_last;
+    out->applied = ctx->seq_applied;
+    out->duplicates = ctx->seq_duplicates;
+    out->rejected = ctx->seq_rejected;
+    return 0;
+#else
+    (void)ctx;
+    (void)out;
+    return -1;
+#endif
+}
+
+#if CRUMBS_ENABLE_SEQUENCED
+int crumbs_seq_receive(crumbs_context_t *ctx, const crumbs_frame_view_t *view)
+{
+    if (view->data_len < 1u)
+    {
+        return 1;
+    }
+
+    uint8_t seq = view->data[0];
+    if (seq == 0u)
+    {
+        ctx->seq_active = 1u;
+        ctx->seq_last = 0u;
+        ctx->seq_applied = 0u;
+        ctx->seq_duplicates = 0u;
+        ctx->seq_rejected = 0u;
+        return 1;
+    }
+    if (view->data_len < 2u || view->data[1] == CRUMBS_CMD_SEQUENCED)
+    {
+        CRUMBS_DBG("seq: empty or nested, dropped\n");
+        return 1;
+    }
+    if (!ctx->seq_active)
+    {
+        ctx->seq_rejected++;
+        return 1;
+    }
+
+    /* Distance ahead of the last applied; the back half of the cycle is
+     * the past, so late repeats count as duplicates. */
+    unsigned last = ctx->seq_last ? ctx->seq_last : 255u;
+    unsigned ahead = (seq + 255u - last) % 255u;
+    if (ahead == 0u || ahead > 127u)
+    {
+        ctx->seq_duplicates++;
+        return 1;
+    }
+    if (ahead > 1u)
+    {
+        CRUMBS_DBG("seq: %u after %u, missing one, dropped\n", (unsigned)seq, last);
+        ctx->seq_rejected++;
+        return 1;
+    }
+
+    ctx->seq_last = seq;
+    ctx->seq_applied++;
+
+    crumbs_frame_view_t inner;
+    inner.type_id = view->type_id;
+    inner.opcode = view->data[1];
+    inner.data_len = (uint8_t)(view->data_len - 2u);
+    inner.data = &view->data[2];
+    inner.crc8 = view->crc8;
+    crumbs_peripheral_dispatch_view(ctx, &inner);
+    return 1;
+}
+
+int crumbs_seq_status_reply(const crumbs_context_t *ctx, crumbs_message_t *msg)
+{
+    msg->type_id = 0u;
+    msg->opcode = CRUMBS_CMD_SEQUENCED;
+    msg->data_len = 8u;
+    msg->data[0] = ctx->seq_active;
+    msg->data[1] = ctx->seq_last;
+    msg->data[2] = (uint8_t)(ctx->seq_applied & 0xFFu);
+    msg->data[3] = (uint8_t)(ctx->seq_applied >> 8);
+    msg->data[4] = (uint8_t)(ctx->seq_duplicates & 0xFFu);
+    msg->data[5] = (uint8_t)(ctx->seq_duplicates >> 8);
+    msg->data[6] = (uint8_t)(ctx->seq_rejected & 0xFFu);
+    msg->data[7] = (uint8_t)(ctx->seq_rejected >> 8);
+    return 1;
+}
+#endif
+
+/* ---- Controller side ---------------------------------------------------- */
+
+/** @brief Write one SEQUENCED frame, retrying failed writes with the same @p seq. */
+static int crumbs_seq_write(crumbs_seq_session_t *s, uint8_t seq, const crumbs_message_t *msg)
+{
+    const crumbs_device_t *dev = s->dev;
+    crumbs_frame_builder_t fb;
+    int rc;
+
+    crumbs_fb_init(&fb, msg ? msg->type_id : 0u, CRUMBS_CMD_SEQUENCED);
+    crumbs_fb_add_u8(&fb, seq);
+    if (msg)
+    {
+        crumbs_fb_add_u8(&fb, msg->opcode);
+        crumbs_fb_add_bytes(&fb, msg->data, msg->data_len);
+    }
+
+    for (unsigned attempt = 0u;; attempt++)
+    {
+        s->written++;
+        rc = crumbs_controller_send_frame(dev->ctx, dev->addr, &fb, dev->write_fn, dev->io);
+        if (rc == 0 || attempt >= s->retries)
+        {
+            return rc;
+        }
+    }
+}
+
+int crumbs_seq_begin(crumbs_seq_session_t *s, const crumbs_device_t *dev)
+{
+    if (!s || !dev || !dev->ctx || !dev->write_fn)
+    {
+        return -1;
+    }
+    memset(s, 0, sizeof(*s));
+    s->dev = dev;
+    s->retries = CRUMBS_SEQ_RETRIES;
+    return crumbs_seq_write(s, 0u, NULL);
+}
+
+int crumbs_seq_send(crumbs_seq_session_t *s, const crumbs_message_t *msg)
+{
+    if (!s || !s->dev || !msg || msg->data_len > CRUMBS_SEQ_MAX_PAYLOAD)
+    {
+        return -1;
+    }
+    if (s->pending >= CRUMBS_SEQ_WINDOW)
+    {
+        return -2;
+    }
+
+    uint8_t seq = crumbs_seq_after(s->last, 1u);
+    s->window[(s->first + s->pending) % CRUMBS_SEQ_WINDOW] = *msg;
+    s->pending++;
+    s->last = seq;
+    return crumbs_seq_write(s, seq, msg);
+}
+
+int crumbs_controller_get_seq_status(const crumbs_device_t *dev, crumbs_seq_status_t *out)
+{
+    crumbs_message_t reply;
+
+    if (!dev || !out)
+    {
+        return -1;
+    }
+    int rc = crumbs_ext_query(dev, CRUMBS_CMD_SEQUENCED, &reply);
+    if (rc != 0)
+    {
+        return rc;
+    }
+    if (reply.data_len < 8u)
+    {
+        return -1;
+    }
+    out->active = reply.data[0];
+    out->last = reply.data[1];
+    out->applied = (uint16_t)(reply.data[2] | ((uint16_t)reply.data[3] << 8));
+    out->duplicates = (uint16_t)(reply.data[4] | ((uint16_t)reply.data[5] << 8));
+    out->rejected = (uint16_t)(reply.data[6] | ((uint16_t)reply.data[7] << 8));
+    return 0;
+}
+
+int crumbs_seq_reconcile(crumbs_seq_session_t *s)
+{
+    crumbs_seq_status_t st;
+    unsigned confirmed;
+    int rc;
+
+    if (!s || !s->dev)
+    {
+        return -1;
+    }
+    rc = crumbs_controller_get_seq_status(s->dev, &st);
+    if (rc != 0)
+    {
+        return rc;
+    }
+    if (!st.active)
+    {
+        return -4;
+    }
+
+    /* The window holds acked+1 .. last; find how far the peripheral got. */
+    if (st.last == s->acked)
+    {
+        confirmed = 0u;
+    }
+    else
+    {
+        for (confirmed = 1u; confirmed <= s->pending; confirmed++)
+        {
+            if (crumbs_seq_after(s->acked, confirmed) == st.last)
+            {
+                break;
+            }
+        }
+        if (confirmed > s->pending)
+        {
+            return -4;
+        }
+    }
+
+    s->acked = st.last;
+    s->first = (uint8_t)((s->first + confirmed) % CRUMBS_SEQ_WINDOW);
+    s->pending = (uint8_t)(s->pending - confirmed);
+
+    for (unsigned k = 0u; k < s->pending; k++)
+    {
+        rc = crumbs_seq_write(s, crumbs_seq_after(s->acked, k + 1u),
+                              &s->window[(s->first + k) % CRUMBS_SEQ_WINDOW]);
+        if (rc != 0)
+        {
+            return rc;
+        }
+        s->resent++;
+    }
+    return s->pending;
+}
@@ -0,0 +1,416 @@
+/**
+ * @file
+ * @brief COBS-framed serial transport (see crumbs_serial.h).
+ */
+
+#include "crumbs_serial.h"
+
+#include <string.h> /* memset, memcpy */
+
+#define CRUMBS_SERIAL_RING_MASK ((uint16_t)(CRUMBS_SERIAL_RX_RING - 1u))
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+static uint16_t crumbs_serial_ring_free(const crumbs_serial_port_t *port)
+{
+    return (uint16_t)((port->rx_tail - port->rx_head - 1u) & CRUMBS_SERIAL_RING_MASK);
+}
+
+/** @brief Move bytes from read() into the ring; returns read()'s result. */
+static int crumbs_serial_pump(crumbs_serial_port_t *port, uint32_t timeout_us)
+{
+    uint8_t tmp[CRUMBS_SERIAL_ENCODED_MAX + 1u];
+    size_t room = crumbs_serial_ring_free(port);
+    int n;
+
+    if (room == 0u)
+    {
+        return 1; /* undecoded input is already waiting */
+    }
+    if (room > sizeof(tmp))
+    {
+        room = sizeof(tmp);
+    }
+    n = port->read(port->user, tmp, room, timeout_us);
+    if (n > 0)
+    {
+        crumbs_serial_rx_push(port, tmp, (size_t)n);
+    }
+    return n;
+}
+
+/** @brief Discard input received before a new request. */
+static void crumbs_serial_drain(crumbs_serial_port_t *port)
+{
+    uint8_t addr;
+    uint8_t body[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t len;
+
+    for (;;)
+    {
+        while (crumbs_serial_next_packet(port, &addr, body, &len))
+        {
+        }
+        if (!port->read || crumbs_serial_pump(port, 0u) <= 0)
+        {
+            return;
+        }
+    }
+}
+
+/** @brief Optional write to @p addr, then a read request and its reply. */
+static int crumbs_serial_request(crumbs_serial_port_t *port, uint8_t addr,
+                                 const uint8_t *tx, size_t tx_len,
+                                 uint8_t *rx, size_t rx_len, uint32_t timeout_us)
+{
+    uint8_t want = (uint8_t)(addr | CRUMBS_SERIAL_REPLY_FLAG);
+    uint8_t got;
+    uint8_t body[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t len;
+    uint32_t start;
+
+    if (timeout_us == 0u)
+    {
+        timeout_us = port->timeout_us;
+    }
+
+    crumbs_serial_drain(port);
+    if (tx_len > 0u && crumbs_serial_send_packet(port, addr, tx, tx_len) != 0)
+    {
+        return -1;
+    }
+    if (crumbs_serial_send_packet(port, want, NULL, 0u) != 0)
+    {
+        return -1;
+    }
+
+    start = port->clock ? port->clock() : 0u;
+    for (;;)
+    {
+        while (crumbs_serial_next_packet(port, &got, body, &len))
+        {
+            /* Own request echoed on a half-duplex line has no body. */
+            if (got == want && len > 0u)
+            {
+                if (len > rx_len)
+                {
+                    len = rx_len;
+                }
+                memcpy(rx, body, len);
+                return (int)len;
+            }
+        }
+        if (port->read)
+        {
+            if (crumbs_serial_pump(port, timeout_us) <= 0)
+            {
+                return -1;
+            }
+            continue;
+        }
+        if (!port->clock || (uint32_t)(port->clock() - start) >= timeout_us)
+        {
+            return -1;
+        }
+    }
+}
+
+/* ---- COBS -------------------------------------------------------------- */
+
+size_t crumbs_cobs_encode(const uint8_t *in, size_t len, uint8_t *out, size_t out_cap)
+{
+    size_t code_pos = 0u;
+    size_t o = 1u;
+    uint8_t code = 1u;
+
+    if (!out || out_cap == 0u || (len > 0u && !in))
+    {
+        return 0u;
+    }
+
+    for (size_t i = 0; i < len; i++)
+    {
+        if (in[i] != 0u)
+        {
+            if (o >= out_cap)
+            {
+                return 0u;
+            }
+            out[o++] = in[i];
+            if (++code != 0xFFu)
+            {
+                continue;
+            }
+        }
+        /* A zero, or a full 254-byte run: close the block. */
+        out[code_pos] = code;
+        if (o >= out_cap)
+        {
+            return 0u;
+        }
+        code_pos = o++;
+        code = 1u;
+    }
+    out[code_pos] = code;
+    return o;
+}
+
+int crumbs_cobs_decode(const uint8_t *in, size_t len, uint8_t *out, size_t out_cap)
+{
+    size_t i = 0u;
+    size_t o = 0u;
+
+    if (!in || !out)
+    {
+        return -1;
+    }
+
+    while (i < len)
+    {
+        uint8_t code = in[i++];
+        if (code == 0u)
+        {
+            return -1;
+        }
+        for (uint8_t k = 1u; k < code; k++)
+        {
+            if (i >= len || in[i] == 0u || o >= out_cap)
+            {
+                return -1;
+            }
+            out[o++] = in[i++];
+        }
+        if (code != 0xFFu && i < len)
+        {
+            if (o >= out_cap)
+            {
+                return -1;
+            }
+            out[o++] = 0u;
+        }
+    }
+    return (int)o;
+}
+
+/* ---- Port -------------------------------------------------------------- */
+
+void crumbs_serial_init(crumbs_serial_port_t *port,
+                        crumbs_serial_write_fn write,
+                        crumbs_serial_read_fn read,
+                        void *user)
+{
+    if (!port)
+    {
+        return;
+    }
+    memset(port, 0, sizeof(*port));
+    port->write = write;
+    port->read = read;
+    port->user = user;
+    port->timeout_us = CRUMBS_SERIAL_TIMEOUT_US;
+}
+
+size_t crumbs_serial_rx_push(crumbs_serial_port_t *port, const uint8_t *data, size_t len)
+{
+    uint16_t head;
+    size_t stored = 0u;
+
+    if (!port || !data)
+    {
+        return 0u;
+    }
+
+    head = port->rx_head;
+    while (stored < len)
+    {
+        uint16_t next = (uint16_t)((head + 1u) & CRUMBS_SERIAL_RING_MASK);
+        if (next == port->rx_tail)
+        {
+            break;
+        }
+        port->rx_ring[head] = data[stored++];
+        head = next;
+    }
+    port->rx_head = head;
+    port->rx_overruns += (uint32_t)(len - stored);
+    return stored;
+}
+
+int crumbs_serial_send_packet(crumbs_serial_port_t *port, uint8_t addr,
+                              const uint8_t *body, size_t len)
+{
+    uint8_t raw[CRUMBS_SERIAL_PACKET_MAX];
+    uint8_t wire[CRUMBS_SERIAL_ENCODED_MAX + 2u];
+    size_t n;
+
+    if (!port || !port->write || len > CRUMBS_MESSAGE_MAX_SIZE || (len > 0u && !body))
+    {
+        return -1;
+    }
+
+    raw[0] = addr;
+    if (len > 0u)
+    {
+        memcpy(&raw[1], body, len);
+    }
+
+    /* Leading delimiter ends any garbage the receiver is holding. */
+    wire[0] = 0u;
+    n = crumbs_cobs_encode(raw, len + 1u, &wire[1], CRUMBS_SERIAL_ENCODED_MAX);
+    wire[1u + n] = 0u;
+    return port->write(port->user, wire, n + 2u);
+}
+
+int crumbs_serial_next_packet(crumbs_serial_port_t *port, uint8_t *addr,
+                              uint8_t *body, size_t *body_len)
+{
+    uint8_t raw[CRUMBS_SERIAL_PACKET_MAX];
+
+    if (!port || !addr || !body || !body_len)
+    {
+        return 0;
+    }
+
+    while (port->rx_tail != port->rx_head)
+    {
+        uint16_t tail = port->rx_tail;
+        uint8_t b = port->rx_ring[tail];
+        uint8_t len;
+        int n;
+
+        port->rx_tail = (uint16_t)((tail + 1u) & CRUMBS_SERIAL_RING_MASK);
+        if (b != 0u)
+        {
+            if (port->pkt_len < sizeof(port->pkt))
+            {
+                port->pkt[port->pkt_len++] = b;
+            }
+            else
+            {
+                port->pkt_overflow = 1u;
+            }
+            continue;
+        }
+
+        len = port->pkt_len;
+        port->pkt_len = 0u;
+        if (port->pkt_overflow)
+        {
+            port->pkt_overflow = 0u;
+            port->rx_errors++;
+            continue;
+        }
+        if (len == 0u)
+        {
+            continue; /* idle or leading delimiter */
+        }
+
+        n = crumbs_cobs_decode(port->pkt, len, raw, sizeof(raw));
+        if (n < 1)
+        {
+            port->rx_errors++;
+            continue;
+        }
+        *addr = raw[0];
+        *body_len = (size_t)n - 1u;
+        memcpy(body, &raw[1], *body_len);
+        port->rx_packets++;
+        return 1;
+    }
+    return 0;
+}
+
+/* ---- Transport --------------------------------------------------------- */
+
+int crumbs_serial_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    if (addr & CRUMBS_SERIAL_REPLY_FLAG)
+    {
+        return -1;
+    }
+    return crumbs_serial_send_packet((crumbs_serial_port_t *)user_ctx, addr, data, len);
+}
+
+int crumbs_serial_read(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len,
+                       uint32_t timeout_us)
+{
+    crumbs_serial_port_t *port = (crumbs_serial_port_t *)user_ctx;
+    if (!port || !buffer || (addr & CRUMBS_SERIAL_REPLY_FLAG))
+    {
+        return -1;
+    }
+    return crumbs_serial_request(port, addr, NULL, 0u, buffer, len, timeout_us);
+}
+
+int crumbs_serial_write_read(void *user_ctx, uint8_t addr, const uint8_t *tx, size_t tx_len,
+                             uint8_t *rx, size_t rx_len, uint32_t timeout_us,
+                             int require_repeated_start)
+{
+    crumbs_serial_port_t *port = (crumbs_serial_port_t *)user_ctx;
+    (void)require_repeated_start; /* packets are never interleaved */
+
+    if (!port || (addr & CRUMBS_SERIAL_REPLY_FLAG) || (tx_len > 0u && !tx) ||
+        (rx_len > 0u && !rx))
+    {
+        return -1;
+    }
+    if (rx_len == 0u)
+    {
+        return (tx_len > 0u) ? crumbs_serial_send_packet(port, addr, tx, tx_len) : 0;
+    }
+    return crumbs_serial_request(port, addr, tx, tx_len, rx, rx_len, timeout_us);
+}
+
+const crumbs_transport_t crumbs_serial_transport = {
+    "serial",
+    crumbs_serial_write,
+    crumbs_serial_read,
+    crumbs_serial_write_read,
+    CRUMBS_TRANSPORT_CAP_ADDRESSED | CRUMBS_TRANSPORT_CAP_TRANSACT | CRUMBS_TRANSPORT_CAP_BROADCAST,
+    CRUMBS_MESSAGE_MAX_SIZE,
+};
+
+/* ---- Device side ------------------------------------------------------- */
+
+int crumbs_serial_peripheral_poll(crumbs_context_t *ctx, crumbs_serial_port_t *port)
+{
+    uint8_t addr;
+    uint8_t body[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t len;
+    int handled = 0;
+
+    if (!ctx || !port)
+    {
+        return -1;
+    }
+
+    for (;;)
+    {
+        while (crumbs_serial_next_packet(port, &addr, body, &len))
+        {
+            if (!(addr & CRUMBS_SERIAL_REPLY_FLAG))
+            {
+                if (addr == ctx->address || (addr == 0u && port->general_call))
+                {
+                    crumbs_peripheral_handle_receive(ctx, body, len);
+                    handled++;
+                }
+            }
+            else if (len == 0u && (uint8_t)(addr & 0x7Fu) == ctx->address)
+            {
+                uint8_t reply[CRUMBS_MESSAGE_MAX_SIZE];
+                size_t reply_len = 0u;
+                if (crumbs_peripheral_build_reply(ctx, reply, sizeof(reply), &reply_len) == 0 &&
+                    reply_len > 0u)
+                {
+                    crumbs_serial_send_packet(port, addr, reply, reply_len);
+                }
+                handled++;
+            }
+        }
+        if (!port->read || crumbs_serial_pump(port, 0u) <= 0)
+        {
+            return handled;
+        }
+    }
+}
@@ -0,0 +1,373 @@
+/**
+ * @file
+ * @brief Staged commands and the CRUMBS_CMD_COMMIT extension (0xF6).
+ *
+ * Staging sits in crumbs_peripheral_dispatch_view() after SET_REPLY and
+ * the extensions, so a frame taken here is replayed through the same path
+ * at commit time with in_commit set. The controller transaction helpers
+ * are always built.
+ */
+
+#include "crumbs_internal.h"
+#include "crumbs_stage.h"
+
+#include <string.h> /* memcpy */
+
+/* ---- Peripheral side ---------------------------------------------------- */
+
+int crumbs_set_latched(crumbs_context_t *ctx, uint8_t opcode, int latched)
+{
+#if CRUMBS_ENABLE_STAGING
+    if (!ctx || (opcode >= 0xF0u && opcode != 0xFFu))
+    {
+        return -1;
+    }
+    uint8_t bit = (uint8_t)(1u << (opcode & 7u));
+    if (latched)
+    {
+        ctx->stage_latched[opcode >> 3] |= bit;
+    }
+    else
+    {
+        ctx->stage_latched[opcode >> 3] &= (uint8_t)~bit;
+    }
+    return 0;
+#else
+    (void)ctx;
+    (void)opcode;
+    (void)latched;
+    return -1;
+#endif
+}
+
+int crumbs_set_commit_group(crumbs_context_t *ctx, uint8_t group)
+{
+#if CRUMBS_ENABLE_STAGING
+    if (!ctx)
+    {
+        return -1;
+    }
+    ctx->stage_group = group;
+    return 0;
+#else
+    (void)ctx;
+    (void)group;
+    return -1;
+#endif
+}
+
+int crumbs_stage_pending(const crumbs_context_t *ctx)
+{
+#if CRUMBS_ENABLE_STAGING
+    return ctx ? ctx->stage_count : 0;
+#else
+    (void)ctx;
+    return 0;
+#endif
+}
+
+int crumbs_stage_apply(crumbs_context_t *ctx)
+{
+#if CRUMBS_ENABLE_STAGING
+    if (!ctx)
+    {
+        return -1;
+    }
+    if (ctx->stage_overflow)
+    {
+        CRUMBS_DBG("stage: overflowed, discarding %u frames\n", (unsigned)ctx->stage_count);
+        ctx->stage_count = 0u;
+        ctx->stage_overflow = 0u;
+        return 0;
+    }
+
+    crumbs_frame_view_t view;
+    uint8_t n = ctx->stage_count;
+    ctx->in_commit = 1u;
+    for (uint8_t i = 0; i < n; i++)
+    {
+        const crumbs_message_t *m = &ctx->stage[i];
+        view.type_id = m->type_id;
+        view.opcode = m->opcode;
+        view.data_len = m->data_len;
+        view.data = m->data;
+        view.crc8 = m->crc8;
+        crumbs_peripheral_dispatch_view(ctx, &view);
+    }
+    ctx->in_commit = 0u;
+    ctx->stage_count = 0u;
+    return n;
+#else
+    (void)ctx;
+    return -1;
+#endif
+}
+
+int crumbs_stage_discard(crumbs_context_t *ctx)
+{
+#if CRUMBS_ENABLE_STAGING
+    if (!ctx)
+    {
+        return -1;
+    }
+    ctx->stage_count = 0u;
+    ctx->stage_overflow = 0u;
+    return 0;
+#else
+    (void)ctx;
+    return -1;
+#endif
+}
+
+#if CRUMBS_ENABLE_STAGING
+int crumbs_stage_active(const crumbs_context_t *ctx)
+{
+    for (size_t i = 0; i < sizeof(ctx->stage_latched); i++)
+    {
+        if (ctx->stage_latched[i])
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int crumbs_stage_capture(crumbs_context_t *ctx, const crumbs_frame_view_t *view)
+{
+    if (ctx->in_commit || !(ctx->stage_latched[view->opcode >> 3] & (1u << (view->opcode & 7u))))
+    {
+        return 0;
+    }
+    if (ctx->stage_count >= CRUMBS_STAGE_DEPTH)
+    {
+        CRUMBS_DBG("stage: full, dropping cmd 0x%02X\n", view->opcode);
+        ctx->stage_overflow = 1u;
+        return 1;
+    }
+
+    crumbs_message_t *slot = &ctx->stage[ctx->stage_count++];
+    slot->type_id = view->type_id;
+    slot->opcode = view->opcode;
+    slot->data_len = view->data_len;
+    memcpy(slot->data, view->data, view->data_len);
+    slot->crc8 = view->crc8;
+    return 1;
+}
+
+int crumbs_stage_receive(crumbs_context_t *ctx, const crumbs_frame_view_t *view)
+{
+    if (!crumbs_stage_active(ctx))
+    {
+        return 0;
+    }
+    if (view->data_len == 0u)
+    {
+        return 1;
+    }
+
+    uint8_t group = view->data[0];
+    if (group != 0u && ctx->stage_group != 0u && group != ctx->stage_group)
+    {
+        return 1;
+    }
+
+    if (view->data_len >= 2u && view->data[1] == CRUMBS_COMMIT_DISCARD)
+    {
+        (void)crumbs_stage_discard(ctx);
+    }
+    else
+    {
+        (void)crumbs_stage_apply(ctx);
+    }
+    return 1;
+}
+
+int crumbs_stage_status_reply(const crumbs_context_t *ctx, crumbs_message_t *msg)
+{
+    if (!crumbs_stage_active(ctx))
+    {
+        return 0;
+    }
+    msg->type_id = 0u;
+    msg->opcode = CRUMBS_CMD_COMMIT;
+    msg->data_len = 3u;
+    msg->data[0] = ctx->stage_count;
+    msg->data[1] = ctx->stage_overflow;
+    msg->data[2] = ctx->stage_group;
+    return 1;
+}
+#endif
+
+/* ---- Controller side ---------------------------------------------------- */
+
+int crumbs_controller_commit(const crumbs_device_t *dev, uint8_t group, uint8_t action)
+{
+    if (!dev || !dev->ctx || !dev->write_fn)
+    {
+        return -1;
+    }
+
+    crumbs_frame_builder_t fb;
+    crumbs_fb_init(&fb, 0u, CRUMBS_CMD_COMMIT);
+    crumbs_fb_add_u8(&fb, group);
+    if (action != CRUMBS_COMMIT_APPLY)
+    {
+        crumbs_fb_add_u8(&fb, action);
+    }
+    return crumbs_controller_send_frame(dev->ctx, dev->addr, &fb, dev->write_fn, dev->io);
+}
+
+int crumbs_controller_get_stage_status(const crumbs_device_t *dev, crumbs_stage_status_t *out)
+{
+    crumbs_message_t reply;
+
+    if (!dev || !out)
+    {
+        return -1;
+    }
+    int rc = crumbs_ext_query(dev, CRUMBS_CMD_COMMIT, &reply);
+    if (rc != 0)
+    {
+        return rc;
+    }
+    if (reply.data_len < 3u)
+    {
+        return -1;
+    }
+    out->staged = reply.data[0];
+    out->overflow = reply.data[1];
+    out->group = reply.data[2];
+    return 0;
+}
+
+void crumbs_txn_begin(crumbs_txn_t *txn, uint8_t group)
+{
+    if (!txn)
+    {
+        return;
+    }
+    txn->count = 0u;
+    txn->group = group;
+    txn->error = 0;
+}
+
+int crumbs_txn_stage(crumbs_txn_t *txn, const crumbs_device_t *dev, const crumbs_message_t *msg)
+{
+    if (!txn)
+    {
+        return -1;
+    }
+    if (!dev || !dev->ctx || !dev->write_fn || !msg)
+    {
+        txn->error = txn->error ? txn->error : -1;
+        return -1;
+    }
+
+    uint8_t i = 0;
+    while (i < txn->count && txn->devs[i] != dev)
+    {
+        i++;
+    }
+    if (i == txn->count)
+    {
+        if (txn->count >= CRUMBS_TXN_MAX_DEVICES)
+        {
+            txn->error = txn->error ? txn->error : -1;
+            return -1;
+        }
+        txn->devs[i] = dev;
+        txn->staged[i] = 0u;
+        txn->count++;
+    }
+
+    int rc = crumbs_controller_send(dev->ctx, dev->addr, msg, dev->write_fn, dev->io);
+    if (rc != 0)
+    {
+        txn->error = txn->error ? txn->error : rc;
+        return rc;
+    }
+    txn->staged[i]++;
+    return 0;
+}
+
+int crumbs_txn_verify(crumbs_txn_t *txn)
+{
+    if (!txn)
+    {
+        return -1;
+    }
+
+    int result = 0;
+    for (uint8_t i = 0; i < txn->count; i++)
+    {
+        crumbs_stage_status_t st;
+        int rc = crumbs_controller_get_stage_status(txn->devs[i], &st);
+        if (rc == 0 && (st.overflow || st.staged != txn->staged[i]))
+        {
+            rc = -4;
+        }
+        if (rc != 0 && result == 0)
+        {
+            result = rc;
+        }
+    }
+    if (result != 0 && txn->error == 0)
+    {
+        txn->error = result;
+    }
+    return result;
+}
+
+int crumbs_txn_commit(crumbs_txn_t *txn, int broadcast)
+{
+    if (!txn || txn->count == 0u)
+    {
+        return -1;
+    }
+    if (txn->error != 0)
+    {
+        (void)crumbs_txn_abort(txn);
+        return txn->error;
+    }
+
+    if (broadcast)
+    {
+        const crumbs_device_t *dev = txn->devs[0];
+        crumbs_message_t m;
+        m.type_id = 0u;
+        m.opcode = CRUMBS_CMD_COMMIT;
+        m.data_len = 1u;
+        m.data[0] = txn->group;
+        return crumbs_controller_broadcast(dev->ctx, &m, dev->write_fn, dev->io);
+    }
+
+    int result = 0;
+    for (uint8_t i = 0; i < txn->count; i++)
+    {
+        int rc = crumbs_controller_commit(txn->devs[i], txn->group, CRUMBS_COMMIT_APPLY);
+        if (rc != 0 && result == 0)
+        {
+            result = rc;
+        }
+    }
+    return result;
+}
+
+int crumbs_txn_abort(crumbs_txn_t *txn)
+{
+    if (!txn)
+    {
+        return -1;
+    }
+
+    int result = 0;
+    for (uint8_t i = 0; i < txn->count; i++)
+    {
+        int rc = crumbs_controller_commit(txn->devs[i], txn->group, CRUMBS_COMMIT_DISCARD);
+        if (rc != 0 && result == 0)
+        {
+            result = rc;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,498 @@
+/**
+ * @file
+ * @brief Traffic statistics and the CRUMBS_CMD_STATS extension (0xF9).
+ *
+ * Recording hooks are called by crumbs_core.c only when
+ * CRUMBS_ENABLE_STATS is set. The controller readers are always built:
+ * reading a peripheral's statistics needs no state on the controller.
+ *
+ * STATS reply pages, all little-endian, each starting with the page number:
+ *   0      [rx:u32][tx:u32][short:u16][len:u16][crc:u16][unhandled:u16][opcode_count:u8]
+ *   1      [handler_hist: 8 x u16]
+ *   2      [reply_hist: 8 x u16][reply_max_us:u32][reply_max_opcode:u8]
+ *   3 + k  [n:u8] then n (<= 2) x [opcode:u8][calls:u16][max_us:u32][total_us:u32]
+ *          for per-opcode entries 2k and 2k + 1
+ */
+
+#include "crumbs_internal.h"
+
+#include <string.h> /* memset */
+
+#define CRUMBS_STATS_PAGE_COUNTERS 0u
+#define CRUMBS_STATS_PAGE_HANDLER 1u
+#define CRUMBS_STATS_PAGE_REPLY 2u
+#define CRUMBS_STATS_PAGE_OPCODES 3u
+#define CRUMBS_STATS_PAGE_RESET 0xFFu
+#define CRUMBS_STATS_OPCODES_PER_PAGE 2u
+#define CRUMBS_STATS_OPCODE_ENTRY_LEN 11u
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+static uint16_t crumbs_get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t crumbs_get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+#if CRUMBS_ENABLE_STATS
+static void crumbs_put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v & 0xFFu);
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void crumbs_put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v);
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static void crumbs_stats_bump(uint16_t *counter)
+{
+    if (*counter != UINT16_MAX)
+    {
+        (*counter)++;
+    }
+}
+
+/** @brief Bucket i holds times below base << i; the last one takes the rest. */
+static uint8_t crumbs_stats_bucket(uint32_t us, uint32_t base_us)
+{
+    uint8_t b = 0u;
+    uint32_t edge = base_us;
+    while (b < CRUMBS_STATS_BUCKETS - 1u && us >= edge)
+    {
+        edge <<= 1;
+        b++;
+    }
+    return b;
+}
+
+static crumbs_opcode_stats_t *crumbs_stats_opcode_entry(crumbs_stats_t *st, uint8_t opcode)
+{
+    for (uint8_t i = 0; i < st->opcode_count; i++)
+    {
+        if (st->opcodes[i].opcode == opcode)
+        {
+            return &st->opcodes[i];
+        }
+    }
+    if (st->opcode_count >= CRUMBS_STATS_OPCODES)
+    {
+        return NULL;
+    }
+    crumbs_opcode_stats_t *e = &st->opcodes[st->opcode_count++];
+    e->opcode = opcode;
+    return e;
+}
+
+#if CRUMBS_CONTEXT_ROLE != CRUMBS_CONTEXT_PERIPHERAL
+static crumbs_addr_stats_t *crumbs_stats_addr_entry(crumbs_context_t *ctx, uint8_t addr)
+{
+    crumbs_controller_ctx_t *c = &ctx->ctrl;
+    for (uint8_t i = 0; i < c->addr_stats_count; i++)
+    {
+        if (c->addr_stats[i].addr == addr)
+        {
+            return &c->addr_stats[i];
+        }
+    }
+    if (c->addr_stats_count >= CRUMBS_STATS_ADDRS)
+    {
+        return NULL;
+    }
+    crumbs_addr_stats_t *e = &c->addr_stats[c->addr_stats_count++];
+    e->addr = addr;
+    return e;
+}
+#endif
+
+/* ---- Recording hooks (crumbs_internal.h) -------------------------------- */
+
+uint32_t crumbs_stats_now(const crumbs_context_t *ctx)
+{
+    return ctx->stats_clock ? ctx->stats_clock() : 0u;
+}
+
+void crumbs_stats_decode_error(crumbs_context_t *ctx, uint8_t cause)
+{
+    switch (cause)
+    {
+    case CRUMBS_STATS_ERR_LEN:
+        crumbs_stats_bump(&ctx->stats.err_len);
+        break;
+    case CRUMBS_STATS_ERR_CRC:
+        crumbs_stats_bump(&ctx->stats.err_crc);
+        break;
+    default:
+        crumbs_stats_bump(&ctx->stats.err_short);
+        break;
+    }
+}
+
+void crumbs_stats_frame_rx(crumbs_context_t *ctx)
+{
+    ctx->stats.frames_rx++;
+}
+
+void crumbs_stats_frame_tx(crumbs_context_t *ctx)
+{
+    ctx->stats.frames_tx++;
+}
+
+void crumbs_stats_unhandled(crumbs_context_t *ctx)
+{
+    crumbs_stats_bump(&ctx->stats.unhandled);
+}
+
+void crumbs_stats_handler(crumbs_context_t *ctx, uint8_t opcode, uint32_t start_us)
+{
+    if (!ctx->stats_clock)
+    {
+        return;
+    }
+    uint32_t us = ctx->stats_clock() - start_us;
+    crumbs_stats_bump(&ctx->stats.handler_hist[crumbs_stats_bucket(us, CRUMBS_STATS_HANDLER_BASE_US)]);
+
+    crumbs_opcode_stats_t *e = crumbs_stats_opcode_entry(&ctx->stats, opcode);
+    if (!e)
+    {
+        return;
+    }
+    crumbs_stats_bump(&e->calls);
+    e->total_us = (e->total_us > UINT32_MAX - us) ? UINT32_MAX : e->total_us + us;
+    if (us > e->max_us)
+    {
+        e->max_us = us;
+    }
+}
+
+void crumbs_stats_reply(crumbs_context_t *ctx, uint8_t opcode, uint32_t start_us)
+{
+    if (!ctx->stats_clock)
+    {
+        return;
+    }
+    uint32_t us = ctx->stats_clock() - start_us;
+    crumbs_stats_bump(&ctx->stats.reply_hist[crumbs_stats_bucket(us, CRUMBS_STATS_HANDLER_BASE_US)]);
+    if (us >= ctx->stats.reply_max_us)
+    {
+        ctx->stats.reply_max_us = us;
+        ctx->stats.reply_max_opcode = opcode;
+    }
+}
+
+void crumbs_stats_controller_tx(const crumbs_context_t *ctx, uint8_t addr, uint32_t start_us)
+{
+    /*
+     * The send helpers take a const context because they never change its
+     * configuration; the statistics are bookkeeping in a context that is
+     * never itself defined const.
+     */
+    crumbs_context_t *mctx = (crumbs_context_t *)(uintptr_t)ctx;
+    mctx->stats.frames_tx++;
+#if CRUMBS_CONTEXT_ROLE != CRUMBS_CONTEXT_PERIPHERAL
+    mctx->ctrl.stats_tx_addr = addr;
+    mctx->ctrl.stats_tx_us = start_us;
+    mctx->ctrl.stats_tx_open = 1u;
+#else
+    (void)addr;
+    (void)start_us;
+#endif
+}
+
+void crumbs_stats_controller_rx(crumbs_context_t *ctx, uint8_t addr, const crumbs_message_t *msg)
+{
+    ctx->stats.frames_rx++;
+
+#if CRUMBS_CONTEXT_ROLE != CRUMBS_CONTEXT_PERIPHERAL
+    crumbs_controller_ctx_t *c = &ctx->ctrl;
+
+    /* NOT_READY replies keep the transaction open until the data arrives. */
+    if (!c->stats_tx_open || c->stats_tx_addr != addr || msg->opcode == CRUMBS_CMD_NOT_READY)
+    {
+        return;
+    }
+    c->stats_tx_open = 0u;
+    if (!ctx->stats_clock)
+    {
+        return;
+    }
+
+    crumbs_addr_stats_t *e = crumbs_stats_addr_entry(ctx, addr);
+    if (!e)
+    {
+        return;
+    }
+    uint32_t us = ctx->stats_clock() - c->stats_tx_us;
+    crumbs_stats_bump(&e->hist[crumbs_stats_bucket(us, CRUMBS_STATS_LATENCY_BASE_US)]);
+    if (us > e->max_us)
+    {
+        e->max_us = us;
+    }
+#else
+    (void)addr;
+    (void)msg;
+#endif
+}
+
+/* ---- CRUMBS_CMD_STATS (peripheral side) --------------------------------- */
+
+int crumbs_stats_receive(crumbs_context_t *ctx, const crumbs_frame_view_t *view)
+{
+    uint8_t page = view->data_len ? view->data[0] : CRUMBS_STATS_PAGE_COUNTERS;
+    if (page == CRUMBS_STATS_PAGE_RESET)
+    {
+        (void)crumbs_reset_stats(ctx);
+        page = CRUMBS_STATS_PAGE_COUNTERS;
+    }
+    ctx->stats_page = page;
+    return 1;
+}
+
+int crumbs_stats_page_reply(const crumbs_context_t *ctx, crumbs_message_t *msg)
+{
+    const crumbs_stats_t *st = &ctx->stats;
+    uint8_t page = ctx->stats_page;
+    uint8_t *d = msg->data;
+
+    msg->type_id = 0u;
+    msg->opcode = CRUMBS_CMD_STATS;
+    d[0] = page;
+
+    if (page == CRUMBS_STATS_PAGE_COUNTERS)
+    {
+        crumbs_put_u32(&d[1], st->frames_rx);
+        crumbs_put_u32(&d[5], st->frames_tx);
+        crumbs_put_u16(&d[9], st->err_short);
+        crumbs_put_u16(&d[11], st->err_len);
+        crumbs_put_u16(&d[13], st->err_crc);
+        crumbs_put_u16(&d[15], st->unhandled);
+        d[17] = st->opcode_count;
+        msg->data_len = 18u;
+    }
+    else if (page == CRUMBS_STATS_PAGE_HANDLER || page == CRUMBS_STATS_PAGE_REPLY)
+    {
+        const uint16_t *hist = (page == CRUMBS_STATS_PAGE_HANDLER) ? st->handler_hist : st->reply_hist;
+        for (uint8_t i = 0; i < CRUMBS_STATS_BUCKETS; i++)
+        {
+            crumbs_put_u16(&d[1u + 2u * i], hist[i]);
+        }
+        msg->data_len = 1u + 2u * CRUMBS_STATS_BUCKETS;
+        if (page == CRUMBS_STATS_PAGE_REPLY)
+        {
+            crumbs_put_u32(&d[msg->data_len], st->reply_max_us);
+            d[msg->data_len + 4u] = st->reply_max_opcode;
+            msg->data_len += 5u;
+        }
+    }
+    else
+    {
+        uint16_t first = (uint16_t)((page - CRUMBS_STATS_PAGE_OPCODES) * CRUMBS_STATS_OPCODES_PER_PAGE);
+        uint8_t n = 0u;
+        uint8_t *p = &d[2];
+        while (n < CRUMBS_STATS_OPCODES_PER_PAGE && first + n < st->opcode_count)
+        {
+            const crumbs_opcode_stats_t *e = &st->opcodes[first + n];
+            p[0] = e->opcode;
+            crumbs_put_u16(&p[1], e->calls);
+            crumbs_put_u32(&p[3], e->max_us);
+            crumbs_put_u32(&p[7], e->total_us);
+            p += CRUMBS_STATS_OPCODE_ENTRY_LEN;
+            n++;
+        }
+        d[1] = n;
+        msg->data_len = (uint8_t)(2u + n * CRUMBS_STATS_OPCODE_ENTRY_LEN);
+    }
+    return 1;
+}
+#endif /* CRUMBS_ENABLE_STATS */
+
+/* ---- Public API --------------------------------------------------------- */
+
+int crumbs_set_stats_clock(crumbs_context_t *ctx, crumbs_clock_us_fn now_us)
+{
+#if CRUMBS_ENABLE_STATS
+    if (!ctx)
+    {
+        return -1;
+    }
+    ctx->stats_clock = now_us;
+    return 0;
+#else
+    (void)ctx;
+    (void)now_us;
+    return -1;
+#endif
+}
+
+int crumbs_get_stats(const crumbs_context_t *ctx, crumbs_stats_t *out)
+{
+#if CRUMBS_ENABLE_STATS
+    if (!ctx || !out)
+    {
+        return -1;
+    }
+    *out = ctx->stats;
+    return 0;
+#else
+    (void)ctx;
+    (void)out;
+    return -1;
+#endif
+}
+
+const crumbs_addr_stats_t *crumbs_get_addr_stats(const crumbs_context_t *ctx, uint8_t addr)
+{
+#if CRUMBS_ENABLE_STATS && CRUMBS_CONTEXT_ROLE != CRUMBS_CONTEXT_PERIPHERAL
+    if (!ctx)
+    {
+        return NULL;
+    }
+    for (uint8_t i = 0; i < ctx->ctrl.addr_stats_count; i++)
+    {
+        if (ctx->ctrl.addr_stats[i].addr == addr)
+        {
+            return &ctx->ctrl.addr_stats[i];
+        }
+    }
+#else
+    (void)ctx;
+    (void)addr;
+#endif
+    return NULL;
+}
+
+int crumbs_reset_stats(crumbs_context_t *ctx)
+{
+#if CRUMBS_ENABLE_STATS
+    if (!ctx)
+    {
+        return -1;
+    }
+    memset(&ctx->stats, 0, sizeof(ctx->stats));
+#if CRUMBS_CONTEXT_ROLE != CRUMBS_CONTEXT_PERIPHERAL
+    memset(&ctx->ctrl, 0, sizeof(ctx->ctrl));
+#endif
+    return 0;
+#else
+    (void)ctx;
+    return -1;
+#endif
+}
+
+/* ---- CRUMBS_CMD_STATS (controller side) --------------------------------- */
+
+/** @brief Select @p page (or reset) on the peripheral. */
+static int crumbs_stats_select(const crumbs_device_t *dev, uint8_t page)
+{
+    crumbs_frame_builder_t fb;
+    crumbs_fb_init(&fb, 0u, CRUMBS_CMD_STATS);
+    crumbs_fb_add_u8(&fb, page);
+    return crumbs_controller_send_frame(dev->ctx, dev->addr, &fb, dev->write_fn, dev->io);
+}
+
+/** @brief Select and read one page; checks the echoed page number and minimum length. */
+static int crumbs_stats_fetch(const crumbs_device_t *dev, uint8_t page, uint8_t min_len, crumbs_message_t *reply)
+{
+    int rc = crumbs_stats_select(dev, page);
+    if (rc != 0)
+    {
+        return rc;
+    }
+    rc = crumbs_ext_query(dev, CRUMBS_CMD_STATS, reply);
+    if (rc != 0)
+    {
+        return rc;
+    }
+    return (reply->data_len >= min_len && reply->data[0] == page) ? 0 : -1;
+}
+
+int crumbs_controller_get_stats(const crumbs_device_t *dev, crumbs_stats_t *out)
+{
+    crumbs_message_t reply;
+    const uint8_t *d = reply.data;
+
+    if (!dev || !out)
+    {
+        return -1;
+    }
+    memset(out, 0, sizeof(*out));
+
+    int rc = crumbs_stats_fetch(dev, CRUMBS_STATS_PAGE_COUNTERS, 18u, &reply);
+    if (rc != 0)
+    {
+        return rc;
+    }
+    out->frames_rx = crumbs_get_u32(&d[1]);
+    out->frames_tx = crumbs_get_u32(&d[5]);
+    out->err_short = crumbs_get_u16(&d[9]);
+    out->err_len = crumbs_get_u16(&d[11]);
+    out->err_crc = crumbs_get_u16(&d[13]);
+    out->unhandled = crumbs_get_u16(&d[15]);
+    uint8_t remote_opcodes = d[17];
+
+    rc = crumbs_stats_fetch(dev, CRUMBS_STATS_PAGE_HANDLER, 1u + 2u * CRUMBS_STATS_BUCKETS, &reply);
+    if (rc != 0)
+    {
+        return rc;
+    }
+    for (uint8_t i = 0; i < CRUMBS_STATS_BUCKETS; i++)
+    {
+        out->handler_hist[i] = crumbs_get_u16(&d[1u + 2u * i]);
+    }
+
+    rc = crumbs_stats_fetch(dev, CRUMBS_STATS_PAGE_REPLY, 6u + 2u * CRUMBS_STATS_BUCKETS, &reply);
+    if (rc != 0)
+    {
+        return rc;
+    }
+    for (uint8_t i = 0; i < CRUMBS_STATS_BUCKETS; i++)
+    {
+        out->reply_hist[i] = crumbs_get_u16(&d[1u + 2u * i]);
+    }
+    out->reply_max_us = crumbs_get_u32(&d[1u + 2u * CRUMBS_STATS_BUCKETS]);
+    out->reply_max_opcode = d[5u + 2u * CRUMBS_STATS_BUCKETS];
+
+    uint8_t page = CRUMBS_STATS_PAGE_OPCODES;
+    while (out->opcode_count < remote_opcodes && out->opcode_count < CRUMBS_STATS_OPCODES &&
+           page != CRUMBS_STATS_PAGE_RESET)
+    {
+        rc = crumbs_stats_fetch(dev, page, 2u, &reply);
+        if (rc != 0)
+        {
+            return rc;
+        }
+        uint8_t n = d[1];
+        if (n == 0u || reply.data_len < 2u + n * CRUMBS_STATS_OPCODE_ENTRY_LEN)
+        {
+            break;
+        }
+        for (uint8_t i = 0; i < n && out->opcode_count < CRUMBS_STATS_OPCODES; i++)
+        {
+            const uint8_t *p = &d[2u + i * CRUMBS_STATS_OPCODE_ENTRY_LEN];
+            crumbs_opcode_stats_t *e = &out->opcodes[out->opcode_count++];
+            e->opcode = p[0];
+            e->calls = crumbs_get_u16(&p[1]);
+            e->max_us = crumbs_get_u32(&p[3]);
+            e->total_us = crumbs_get_u32(&p[7]);
+        }
+        page++;
+    }
+    return 0;
+}
+
+int crumbs_controller_reset_stats(const crumbs_device_t *dev)
+{
+    if (!dev || !dev->ctx || !dev->write_fn)
+    {
+        return -1;
+    }
+    return crumbs_stats_select(dev, CRUMBS_STATS_PAGE_RESET);
+}
@@ -0,0 +1,321 @@
+/**
+ * @file
+ * @brief Hot-path timing recorder and the CRUMBS_CMD_TIMING extension (0xF0).
+ *
+ * Like the trace ring, the recorder is a crumbs_trace_fn and a context
+ * "has timing" when that function is its trace hook. The controller
+ * readers are always built.
+ */
+
+#include "crumbs_internal.h"
+#include "crumbs_timing.h"
+
+#include <string.h> /* memset */
+
+#define CRUMBS_TIMING_OPEN_RX 0x01u
+#define CRUMBS_TIMING_OPEN_DISPATCH 0x02u
+#define CRUMBS_TIMING_OPEN_REQUEST 0x04u
+
+/** @brief Empty intervals timed by attach; the shortest is the overhead. */
+#define CRUMBS_TIMING_CALIBRATE_RUNS 8
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+static uint32_t crumbs_timing_get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void crumbs_timing_sample(crumbs_timing_t *t, uint8_t phase, uint32_t ticks, uint8_t opcode)
+{
+    if (opcode == CRUMBS_CMD_TIMING || (t->filter != CRUMBS_TIMING_ANY && opcode != t->filter))
+    {
+        return;
+    }
+
+    crumbs_timing_stat_t *s = &t->phases[phase];
+    if (s->count == 0u || ticks < s->min)
+    {
+        s->min = ticks;
+    }
+    if (ticks > s->max)
+    {
+        s->max = ticks;
+    }
+    s->total = (s->total + ticks < s->total) ? 0xFFFFFFFFu : s->total + ticks;
+    s->count++;
+}
+
+/* ---- Recorder ----------------------------------------------------------- */
+
+void crumbs_timing_record(uint8_t event, uint8_t opcode, uint8_t len,
+                          uint32_t timestamp, void *user_data)
+{
+    crumbs_timing_t *t = (crumbs_timing_t *)user_data;
+    (void)len;
+    if (!t)
+    {
+        return;
+    }
+
+    switch (event)
+    {
+    case CRUMBS_TRACE_RX_START:
+        t->rx_start = timestamp;
+        t->open |= CRUMBS_TIMING_OPEN_RX;
+        break;
+
+    case CRUMBS_TRACE_DECODE_DONE:
+        if (t->open & CRUMBS_TIMING_OPEN_RX)
+        {
+            crumbs_timing_sample(t, CRUMBS_TIMING_DECODE, timestamp - t->rx_start, opcode);
+        }
+        break;
+
+    case CRUMBS_TRACE_RX_DONE:
+        if (t->open & CRUMBS_TIMING_OPEN_RX)
+        {
+            t->open &= (uint8_t)~CRUMBS_TIMING_OPEN_RX;
+            crumbs_timing_sample(t, CRUMBS_TIMING_RX_ISR, timestamp - t->rx_start, opcode);
+        }
+        break;
+
+    case CRUMBS_TRACE_DISPATCH_ENTER:
+        t->dispatch_start = timestamp;
+        t->open |= CRUMBS_TIMING_OPEN_DISPATCH;
+        break;
+
+    case CRUMBS_TRACE_DISPATCH_EXIT:
+        if (t->open & CRUMBS_TIMING_OPEN_DISPATCH)
+        {
+            uint32_t ticks = timestamp - t->dispatch_start;
+            t->open &= (uint8_t)~CRUMBS_TIMING_OPEN_DISPATCH;
+            if (t->calibrating)
+            {
+                if (ticks < t->overhead)
+                {
+                    t->overhead = (uint16_t)ticks;
+                }
+                break;
+            }
+            crumbs_timing_sample(t, CRUMBS_TIMING_DISPATCH, ticks, opcode);
+        }
+        break;
+
+    case CRUMBS_TRACE_REQUEST_START:
+        t->request_start = timestamp;
+        t->open |= CRUMBS_TIMING_OPEN_REQUEST;
+        break;
+
+    case CRUMBS_TRACE_REPLY_BUILT:
+        if (t->open & CRUMBS_TIMING_OPEN_REQUEST)
+        {
+            crumbs_timing_sample(t, CRUMBS_TIMING_REPLY, timestamp - t->request_start, opcode);
+        }
+        break;
+
+    case CRUMBS_TRACE_TX_DONE:
+        if (t->open & CRUMBS_TIMING_OPEN_REQUEST)
+        {
+            t->open &= (uint8_t)~CRUMBS_TIMING_OPEN_REQUEST;
+            crumbs_timing_sample(t, CRUMBS_TIMING_TX_ISR, timestamp - t->request_start, opcode);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+void crumbs_timing_clear(crumbs_timing_t *timing, uint16_t opcode)
+{
+    if (!timing)
+    {
+        return;
+    }
+    memset(timing->phases, 0, sizeof(timing->phases));
+    timing->open = 0u;
+    timing->filter = (opcode > 0xFFu) ? CRUMBS_TIMING_ANY : opcode;
+}
+
+int crumbs_timing_attach(crumbs_context_t *ctx, crumbs_timing_t *timing,
+                         crumbs_clock_us_fn clock, uint32_t clock_hz)
+{
+#if CRUMBS_ENABLE_TRACE
+    if (!ctx || !timing || !clock)
+    {
+        return -1;
+    }
+    memset(timing, 0, sizeof(*timing));
+    timing->filter = CRUMBS_TIMING_ANY;
+    timing->clock_hz = clock_hz;
+    if (crumbs_set_trace_hook(ctx, crumbs_timing_record, clock, timing) != 0)
+    {
+        return -1;
+    }
+
+    /* Bracket nothing through the real hook path: what is left is its cost. */
+    timing->overhead = 0xFFFFu;
+    timing->calibrating = 1u;
+    for (int i = 0; i < CRUMBS_TIMING_CALIBRATE_RUNS; i++)
+    {
+        CRUMBS_TRACE(ctx, CRUMBS_TRACE_DISPATCH_ENTER, CRUMBS_CMD_TIMING, 0u);
+        CRUMBS_TRACE(ctx, CRUMBS_TRACE_DISPATCH_EXIT, CRUMBS_CMD_TIMING, 0u);
+    }
+    timing->calibrating = 0u;
+    return 0;
+#else
+    (void)ctx;
+    (void)timing;
+    (void)clock;
+    (void)clock_hz;
+    return -1;
+#endif
+}
+
+const char *crumbs_timing_phase_name(uint8_t phase)
+{
+    switch (phase)
+    {
+    case CRUMBS_TIMING_RX_ISR:
+        return "rx-isr";
+    case CRUMBS_TIMING_DECODE:
+        return "decode";
+    case CRUMBS_TIMING_DISPATCH:
+        return "dispatch";
+    case CRUMBS_TIMING_REPLY:
+        return "reply";
+    case CRUMBS_TIMING_TX_ISR:
+        return "tx-isr";
+    default:
+        return "?";
+    }
+}
+
+/* ---- Peripheral extension ----------------------------------------------- */
+
+#if CRUMBS_ENABLE_TRACE
+static void crumbs_timing_put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v);
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static crumbs_timing_t *crumbs_timing_of(const crumbs_context_t *ctx)
+{
+    return (ctx->trace_fn == crumbs_timing_record) ? (crumbs_timing_t *)ctx->trace_user : NULL;
+}
+
+int crumbs_timing_attached(const crumbs_context_t *ctx)
+{
+    return crumbs_timing_of(ctx) != NULL;
+}
+
+int crumbs_timing_receive(crumbs_context_t *ctx, const crumbs_frame_view_t *view)
+{
+    crumbs_timing_t *t = crumbs_timing_of(ctx);
+    if (!t)
+    {
+        return 0;
+    }
+    if (view->data_len == 0u)
+    {
+        return 1;
+    }
+
+    if (view->data[0] == CRUMBS_TIMING_CMD_RESET)
+    {
+        crumbs_timing_clear(t, view->data_len >= 2u ? view->data[1] : CRUMBS_TIMING_ANY);
+    }
+    else if (view->data[0] < CRUMBS_TIMING_PHASES)
+    {
+        t->page = view->data[0];
+    }
+    return 1;
+}
+
+int crumbs_timing_page_reply(crumbs_context_t *ctx, crumbs_message_t *msg)
+{
+    crumbs_timing_t *t = crumbs_timing_of(ctx);
+    if (!t)
+    {
+        return 0;
+    }
+
+    const crumbs_timing_stat_t *s = &t->phases[t->page];
+    uint8_t *d = msg->data;
+    msg->type_id = 0u;
+    msg->opcode = CRUMBS_CMD_TIMING;
+    d[0] = t->page;
+    crumbs_timing_put_u32(&d[1], s->count);
+    crumbs_timing_put_u32(&d[5], s->min);
+    crumbs_timing_put_u32(&d[9], s->max);
+    crumbs_timing_put_u32(&d[13], s->total);
+    d[17] = (uint8_t)(t->overhead & 0xFFu);
+    d[18] = (uint8_t)(t->overhead >> 8);
+    crumbs_timing_put_u32(&d[19], t->clock_hz);
+    msg->data_len = CRUMBS_TIMING_REPLY_LEN;
+    return 1;
+}
+#endif
+
+/* ---- Controller side ---------------------------------------------------- */
+
+static int crumbs_timing_command(const crumbs_device_t *dev, const uint8_t *cmd, uint8_t len)
+{
+    crumbs_frame_builder_t fb;
+    crumbs_fb_init(&fb, 0u, CRUMBS_CMD_TIMING);
+    for (uint8_t i = 0; i < len; i++)
+    {
+        crumbs_fb_add_u8(&fb, cmd[i]);
+    }
+    return crumbs_controller_send_frame(dev->ctx, dev->addr, &fb, dev->write_fn, dev->io);
+}
+
+int crumbs_controller_reset_timing(const crumbs_device_t *dev, uint16_t opcode)
+{
+    uint8_t cmd[2] = {CRUMBS_TIMING_CMD_RESET, (uint8_t)opcode};
+
+    if (!dev || !dev->ctx || !dev->write_fn)
+    {
+        return -1;
+    }
+    return crumbs_timing_command(dev, cmd, (opcode > 0xFFu) ? 1u : 2u);
+}
+
+int crumbs_controller_read_timing(const crumbs_device_t *dev, uint8_t phase,
+                                  crumbs_timing_report_t *out)
+{
+    crumbs_message_t reply;
+
+    if (!dev || !dev->ctx || !dev->write_fn || !out || phase >= CRUMBS_TIMING_PHASES)
+    {
+        return -1;
+    }
+
+    int rc = crumbs_timing_command(dev, &phase, 1u);
+    if (rc != 0)
+    {
+        return rc;
+    }
+    rc = crumbs_ext_query(dev, CRUMBS_CMD_TIMING, &reply);
+    if (rc != 0)
+    {
+        return rc;
+    }
+    if (reply.data_len < CRUMBS_TIMING_REPLY_LEN || reply.data[0] != phase)
+    {
+        return -1;
+    }
+
+    out->phase = phase;
+    out->stat.count = crumbs_timing_get_u32(&reply.data[1]);
+    out->stat.min = crumbs_timing_get_u32(&reply.data[5]);
+    out->stat.max = crumbs_timing_get_u32(&reply.data[9]);
+    out->stat.total = crumbs_timing_get_u32(&reply.data[13]);
+    out->overhead = (uint16_t)(reply.data[17] | (reply.data[18] << 8));
+    out->clock_hz = crumbs_timing_get_u32(&reply.data[19]);
+    return 0;
+}
@@ -0,0 +1,296 @@
+/**
+ * @file
+ * @brief Trace ring recorder and the CRUMBS_CMD_TRACE extension (0xF8).
+ *
+ * The recorder is a crumbs_trace_fn; a context "has a ring" when that
+ * function is its trace hook, so the extension needs no context field of
+ * its own. The controller readers and the decoder are always built.
+ */
+
+#include "crumbs_internal.h"
+#include "crumbs_trace.h"
+
+#include <string.h> /* memset */
+
+#define CRUMBS_TRACE_RING_MASK ((uint16_t)(CRUMBS_TRACE_RING_DEPTH - 1))
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+static uint64_t crumbs_trace_pack(uint32_t delta, uint8_t event, uint8_t opcode, uint8_t len, uint16_t index)
+{
+    return (uint64_t)delta |
+           ((uint64_t)event << 32) |
+           ((uint64_t)opcode << 40) |
+           ((uint64_t)len << 48) |
+           ((uint64_t)(index & 0xFFu) << 56);
+}
+
+static void crumbs_trace_decode_word(uint64_t word, uint16_t index, crumbs_trace_event_t *out)
+{
+    out->index = index;
+    out->delta = (uint32_t)word;
+    out->event = (uint8_t)(word >> 32);
+    out->opcode = (uint8_t)(word >> 40);
+    out->len = (uint8_t)(word >> 48);
+}
+
+static uint16_t crumbs_trace_oldest(const crumbs_trace_ring_t *ring)
+{
+    return (uint16_t)(ring->head - ring->count);
+}
+
+/* ---- Recorder ----------------------------------------------------------- */
+
+void crumbs_trace_ring_record(uint8_t event, uint8_t opcode, uint8_t len,
+                              uint32_t timestamp, void *user_data)
+{
+    crumbs_trace_ring_t *ring = (crumbs_trace_ring_t *)user_data;
+    if (!ring || ring->paused)
+    {
+        return;
+    }
+
+    uint16_t head = ring->head;
+    ring->events[head & CRUMBS_TRACE_RING_MASK] =
+        crumbs_trace_pack(timestamp - ring->last_ts, event, opcode, len, head);
+    ring->last_ts = timestamp;
+    if (ring->count < CRUMBS_TRACE_RING_DEPTH)
+    {
+        ring->count++;
+    }
+    ring->head = (uint16_t)(head + 1u);
+}
+
+int crumbs_trace_ring_attach(crumbs_context_t *ctx, crumbs_trace_ring_t *ring,
+                             crumbs_clock_us_fn clock)
+{
+#if CRUMBS_ENABLE_TRACE
+    if (!ctx || !ring)
+    {
+        return -1;
+    }
+    memset(ring, 0, sizeof(*ring));
+    ring->last_ts = clock ? clock() : 0u;
+    return crumbs_set_trace_hook(ctx, crumbs_trace_ring_record, clock, ring);
+#else
+    (void)ctx;
+    (void)ring;
+    (void)clock;
+    return -1;
+#endif
+}
+
+int crumbs_trace_ring_snapshot(const crumbs_trace_ring_t *ring,
+                               crumbs_trace_event_t *out, size_t max)
+{
+    if (!ring || (!out && max > 0u))
+    {
+        return -1;
+    }
+
+    uint16_t index = crumbs_trace_oldest(ring);
+    size_t n = 0;
+    while (n < max && n < ring->count)
+    {
+        crumbs_trace_decode_word(ring->events[index & CRUMBS_TRACE_RING_MASK], index, &out[n]);
+        index++;
+        n++;
+    }
+    return (int)n;
+}
+
+/* ---- Peripheral extension ----------------------------------------------- */
+
+#if CRUMBS_ENABLE_TRACE
+/** @brief Whether @p index is still held by @p ring (or is the end of it). */
+static int crumbs_trace_held(const crumbs_trace_ring_t *ring, uint16_t index)
+{
+    return (uint16_t)(index - crumbs_trace_oldest(ring)) <= ring->count;
+}
+
+static crumbs_trace_ring_t *crumbs_trace_ring_of(const crumbs_context_t *ctx)
+{
+    return (ctx->trace_fn == crumbs_trace_ring_record) ? (crumbs_trace_ring_t *)ctx->trace_user : NULL;
+}
+
+int crumbs_trace_ring_attached(const crumbs_context_t *ctx)
+{
+    return crumbs_trace_ring_of(ctx) != NULL;
+}
+
+int crumbs_trace_receive(crumbs_context_t *ctx, const crumbs_frame_view_t *view)
+{
+    crumbs_trace_ring_t *ring = crumbs_trace_ring_of(ctx);
+    if (!ring)
+    {
+        return 0;
+    }
+    if (view->data_len == 0u)
+    {
+        return 1;
+    }
+
+    switch (view->data[0])
+    {
+    case CRUMBS_TRACE_CMD_DUMP:
+        ring->paused = 1u;
+        ring->cursor = crumbs_trace_oldest(ring);
+        if (view->data_len >= 3u)
+        {
+            uint16_t from = (uint16_t)(view->data[1] | (view->data[2] << 8));
+            if (crumbs_trace_held(ring, from))
+            {
+                ring->cursor = from;
+            }
+        }
+        break;
+
+    case CRUMBS_TRACE_CMD_CLEAR:
+        ring->count = 0u;
+        ring->cursor = ring->head;
+        ring->paused = 0u;
+        break;
+
+    case CRUMBS_TRACE_CMD_RESUME:
+    default:
+        ring->paused = 0u;
+        break;
+    }
+    return 1;
+}
+
+int crumbs_trace_page_reply(crumbs_context_t *ctx, crumbs_message_t *msg)
+{
+    crumbs_trace_ring_t *ring = crumbs_trace_ring_of(ctx);
+    if (!ring)
+    {
+        return 0;
+    }
+
+    /* Recording may have overwritten the cursor if no dump was started. */
+    if (!crumbs_trace_held(ring, ring->cursor))
+    {
+        ring->cursor = crumbs_trace_oldest(ring);
+    }
+
+    uint16_t index = ring->cursor;
+    uint16_t left = (uint16_t)(ring->head - index);
+    uint8_t n = (left < CRUMBS_TRACE_EVENTS_PER_PAGE) ? (uint8_t)left : CRUMBS_TRACE_EVENTS_PER_PAGE;
+
+    msg->type_id = 0u;
+    msg->opcode = CRUMBS_CMD_TRACE;
+    msg->data[0] = (uint8_t)(index & 0xFFu);
+    msg->data[1] = (uint8_t)(index >> 8);
+    uint8_t *p = &msg->data[2];
+    for (uint8_t i = 0; i < n; i++)
+    {
+        uint64_t word = ring->events[(uint16_t)(index + i) & CRUMBS_TRACE_RING_MASK];
+        for (uint8_t b = 0; b < CRUMBS_TRACE_EVENT_SIZE; b++)
+        {
+            *p++ = (uint8_t)(word >> (8u * b));
+        }
+    }
+    msg->data_len = (uint8_t)(2u + n * CRUMBS_TRACE_EVENT_SIZE);
+    ring->cursor = (uint16_t)(index + n);
+    return 1;
+}
+#endif
+
+/* ---- Controller side ---------------------------------------------------- */
+
+void crumbs_trace_unpack(const uint8_t *raw, uint16_t index, crumbs_trace_event_t *out)
+{
+    uint64_t word = 0u;
+    if (!raw || !out)
+    {
+        return;
+    }
+    for (uint8_t b = 0; b < CRUMBS_TRACE_EVENT_SIZE; b++)
+    {
+        word |= (uint64_t)raw[b] << (8u * b);
+    }
+    crumbs_trace_decode_word(word, index, out);
+}
+
+const char *crumbs_trace_event_name(uint8_t event)
+{
+    switch (event)
+    {
+    case CRUMBS_TRACE_RX_START:
+        return "rx";
+    case CRUMBS_TRACE_DECODE_DONE:
+        return "decode";
+    case CRUMBS_TRACE_DISPATCH_ENTER:
+        return "dispatch";
+    case CRUMBS_TRACE_DISPATCH_EXIT:
+        return "dispatch-done";
+    case CRUMBS_TRACE_REPLY_BUILT:
+        return "reply";
+    case CRUMBS_TRACE_TX_START:
+        return "tx";
+    case CRUMBS_TRACE_TX_DONE:
+        return "tx-done";
+    case CRUMBS_TRACE_REQUEST_START:
+        return "request";
+    case CRUMBS_TRACE_RX_DONE:
+        return "rx-done";
+    default:
+        return "?";
+    }
+}
+
+/** @brief Send a one-byte TRACE command (CRUMBS_TRACE_CMD_*). */
+static int crumbs_trace_command(const crumbs_device_t *dev, uint8_t cmd)
+{
+    crumbs_frame_builder_t fb;
+    crumbs_fb_init(&fb, 0u, CRUMBS_CMD_TRACE);
+    crumbs_fb_add_u8(&fb, cmd);
+    return crumbs_controller_send_frame(dev->ctx, dev->addr, &fb, dev->write_fn, dev->io);
+}
+
+int crumbs_controller_read_trace(const crumbs_device_t *dev,
+                                 crumbs_trace_event_t *out, size_t max)
+{
+    crumbs_message_t reply;
+    size_t n = 0;
+
+    if (!dev || !dev->ctx || !dev->write_fn || (!out && max > 0u))
+    {
+        return -1;
+    }
+
+    int rc = crumbs_trace_command(dev, CRUMBS_TRACE_CMD_DUMP);
+    while (rc == 0 && n < max)
+    {
+        rc = crumbs_ext_query(dev, CRUMBS_CMD_TRACE, &reply);
+        if (rc != 0)
+        {
+            break;
+        }
+        if (reply.data_len < 2u || (reply.data_len - 2u) % CRUMBS_TRACE_EVENT_SIZE != 0u)
+        {
+            rc = -1;
+            break;
+        }
+        uint16_t index = (uint16_t)(reply.data[0] | (reply.data[1] << 8));
+        uint8_t events = (uint8_t)((reply.data_len - 2u) / CRUMBS_TRACE_EVENT_SIZE);
+        if (events == 0u)
+        {
+            break;
+        }
+        for (uint8_t i = 0; i < events && n < max; i++)
+        {
+            crumbs_trace_unpack(&reply.data[2u + i * CRUMBS_TRACE_EVENT_SIZE],
+                                (uint16_t)(index + i), &out[n]);
+            n++;
+        }
+    }
+
+    /* Resume even after a failed page so the ring keeps recording. */
+    int resume_rc = crumbs_trace_command(dev, CRUMBS_TRACE_CMD_RESUME);
+    if (rc != 0)
+    {
+        return rc;
+    }
+    return (resume_rc != 0) ? resume_rc : (int)n;
+}
@@ -0,0 +1,148 @@
+/**
+ * @file
+ * @brief Transport vtable plumbing for contexts and device handles (see crumbs_transport.h).
+ */
+
+#include <string.h>
+
+#include "crumbs_transport.h"
+#include "crumbs_latency.h"
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+static uint8_t crumbs_transport_frame_limit(const crumbs_transport_t *t)
+{
+    if (!t || t->max_frame == 0u || t->max_frame > CRUMBS_MESSAGE_MAX_SIZE)
+    {
+        return CRUMBS_MESSAGE_MAX_SIZE;
+    }
+    return t->max_frame;
+}
+
+/* ---- Public API -------------------------------------------------------- */
+
+int crumbs_set_transport(crumbs_context_t *ctx, const crumbs_transport_t *t, void *io)
+{
+    if (!ctx || (t && !t->send))
+    {
+        return -1;
+    }
+    ctx->transport = t;
+    ctx->transport_io = t ? io : NULL;
+    return 0;
+}
+
+int crumbs_device_set_transport(crumbs_device_t *dev, const crumbs_transport_t *t, void *io)
+{
+    if (!dev || (t && !t->send))
+    {
+        return -1;
+    }
+    dev->transport = t;
+    dev->write_fn = t ? t->send : NULL;
+    dev->read_fn = t ? t->receive : NULL;
+    dev->io = io;
+    return 0;
+}
+
+int crumbs_device_init(crumbs_device_t *dev,
+                       crumbs_context_t *ctx,
+                       uint8_t addr,
+                       crumbs_delay_fn delay_fn)
+{
+    if (!dev || !ctx || !ctx->transport)
+    {
+        return -1;
+    }
+    memset(dev, 0, sizeof(*dev));
+    dev->ctx = ctx;
+    dev->addr = addr;
+    dev->delay_fn = delay_fn;
+    return crumbs_device_set_transport(dev, ctx->transport, ctx->transport_io);
+}
+
+uint8_t crumbs_transport_max_payload(const crumbs_transport_t *t)
+{
+    uint8_t frame = crumbs_transport_frame_limit(t);
+    return (frame < 4u) ? 0u : (uint8_t)(frame - 4u);
+}
+
+int crumbs_transport_send(crumbs_context_t *ctx, uint8_t addr, const crumbs_message_t *msg)
+{
+    if (!ctx || !ctx->transport || !msg)
+    {
+        return -1;
+    }
+    if (msg->data_len > crumbs_transport_max_payload(ctx->transport))
+    {
+        return -1;
+    }
+    return crumbs_controller_send(ctx, addr, msg, ctx->transport->send, ctx->transport_io);
+}
+
+int crumbs_transport_read(crumbs_context_t *ctx, uint8_t addr, crumbs_message_t *out)
+{
+    if (!ctx || !ctx->transport || !ctx->transport->receive)
+    {
+        return -1;
+    }
+    return crumbs_controller_read_len(ctx, addr, out, ctx->transport->receive,
+                                      ctx->transport_io,
+                                      crumbs_transport_max_payload(ctx->transport));
+}
+
+int crumbs_device_query(const crumbs_device_t *dev,
+                        uint8_t opcode,
+                        crumbs_message_t *out,
+                        uint8_t max_payload)
+{
+    const crumbs_transport_t *t;
+    crumbs_message_t req;
+    uint32_t wait;
+    int rc;
+
+    if (!dev || !out)
+    {
+        return -1;
+    }
+    t = dev->transport;
+
+    if (t && t->transact && (t->caps & CRUMBS_TRANSPORT_CAP_TRANSACT))
+    {
+        rc = crumbs_controller_query(dev->ctx, dev->addr, opcode, out, t->transact, dev->io);
+        if (rc != CRUMBS_I2C_DEV_E_NO_REPEATED_START)
+        {
+            return (rc == 0 && out->opcode != opcode) ? -1 : rc;
+        }
+        /* Adapter refused the combined transfer; fall back to two transfers. */
+    }
+
+    if (!dev->write_fn || !dev->read_fn || !dev->delay_fn)
+    {
+        return -1;
+    }
+
+    memset(&req, 0, sizeof(req));
+    req.opcode = CRUMBS_CMD_SET_REPLY;
+    req.data_len = 1u;
+    req.data[0] = opcode;
+    rc = crumbs_controller_send(dev->ctx, dev->addr, &req, dev->write_fn, dev->io);
+    if (rc != 0)
+    {
+        return rc;
+    }
+
+    if (t && max_payload > crumbs_transport_max_payload(t))
+    {
+        max_payload = crumbs_transport_max_payload(t);
+    }
+    wait = crumbs_device_query_delay(dev, opcode);
+    dev->delay_fn(wait);
+    rc = crumbs_controller_read_len(dev->ctx, dev->addr, out, dev->read_fn, dev->io, max_payload);
+    crumbs_device_query_result(dev, opcode, wait, rc == 0 && out->opcode == opcode);
+    if (rc != 0)
+    {
+        return rc;
+    }
+    return (out->opcode == opcode) ? 0 : -1;
+}
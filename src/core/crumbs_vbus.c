@@ -0,0 +1,466 @@
+/**
+ * @file
+ * @brief Timing-accurate virtual I2C bus (see crumbs_vbus.h).
+ */
+
+#include "crumbs_vbus.h"
+
+#include <string.h> /* memset, memcpy */
+
+#define CRUMBS_VBUS_NO_DEVICE 0xFFu
+#define CRUMBS_VBUS_DEFAULT_HZ 100000u
+#define CRUMBS_VBUS_DEFAULT_SEED 0x2545F491u
+
+static crumbs_vbus_t *g_vbus_current;
+
+const crumbs_transport_t crumbs_vbus_transport = {
+    "vbus",
+    crumbs_vbus_write,
+    crumbs_vbus_read,
+    crumbs_vbus_write_read,
+    CRUMBS_TRANSPORT_CAP_ADDRESSED | CRUMBS_TRANSPORT_CAP_TRANSACT | CRUMBS_TRANSPORT_CAP_BROADCAST,
+    CRUMBS_MESSAGE_MAX_SIZE,
+};
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+/** @brief Wire time of @p bits SCL clocks. */
+static uint64_t crumbs_vbus_bits_ns(const crumbs_vbus_t *bus, uint32_t bits)
+{
+    return ((uint64_t)bits * 1000000000u + bus->bus_hz - 1u) / bus->bus_hz;
+}
+
+/** @brief Occupy the bus for @p ns. */
+static void crumbs_vbus_spend(crumbs_vbus_t *bus, uint64_t ns)
+{
+    bus->now_ns += ns;
+    bus->busy_ns += ns;
+}
+
+/** @brief START + address byte; the STOP is charged by crumbs_vbus_stop(). */
+static void crumbs_vbus_start(crumbs_vbus_t *bus)
+{
+    bus->transfers++;
+    crumbs_vbus_spend(bus, crumbs_vbus_bits_ns(bus, 1u + 9u));
+}
+
+static void crumbs_vbus_bytes(crumbs_vbus_t *bus, size_t n)
+{
+    crumbs_vbus_spend(bus, crumbs_vbus_bits_ns(bus, (uint32_t)(9u * n)));
+}
+
+static void crumbs_vbus_stop(crumbs_vbus_t *bus)
+{
+    crumbs_vbus_spend(bus, crumbs_vbus_bits_ns(bus, 1u));
+}
+
+/** @brief xorshift32; returns 16 fresh bits. */
+static uint16_t crumbs_vbus_random(crumbs_vbus_t *bus)
+{
+    uint32_t x = bus->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    bus->rng = x;
+    return (uint16_t)(x >> 16);
+}
+
+static int crumbs_vbus_roll(crumbs_vbus_t *bus, uint16_t rate)
+{
+    return rate != 0u && crumbs_vbus_random(bus) < rate;
+}
+
+/** @brief Flip one random bit of @p buf if the corruption roll hits. */
+static void crumbs_vbus_maybe_corrupt(crumbs_vbus_t *bus, uint8_t *buf, size_t len)
+{
+    if (len == 0u || !crumbs_vbus_roll(bus, bus->corrupt_rate))
+    {
+        return;
+    }
+    uint16_t r = crumbs_vbus_random(bus);
+    buf[(size_t)(r >> 3) % len] ^= (uint8_t)(1u << (r & 7u));
+    bus->corrupted++;
+}
+
+/**
+ * @brief Address phase: returns the device if it ACKs, NULL (after a
+ *        STOP) otherwise. A busy device stretches the clock first.
+ */
+static crumbs_vbus_device_t *crumbs_vbus_address(crumbs_vbus_t *bus, uint8_t addr)
+{
+    crumbs_vbus_device_t *d = crumbs_vbus_device(bus, addr);
+
+    crumbs_vbus_start(bus);
+    if (!d || !d->online || crumbs_vbus_roll(bus, bus->nack_rate))
+    {
+        if (d)
+        {
+            d->nacks++;
+        }
+        bus->nacks++;
+        crumbs_vbus_stop(bus);
+        return NULL;
+    }
+
+    if (bus->now_ns < d->busy_until_ns)
+    {
+        uint64_t wait = d->busy_until_ns - bus->now_ns;
+        d->stretch_us += (uint32_t)(wait / 1000u);
+        crumbs_vbus_spend(bus, wait);
+    }
+    return d;
+}
+
+/** @brief Deliver a write payload. */
+static void crumbs_vbus_deliver(crumbs_vbus_t *bus, crumbs_vbus_device_t *d, const uint8_t *data, size_t len)
+{
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+
+    if (len == 0u)
+    {
+        return;
+    }
+    if (len > sizeof(frame))
+    {
+        len = sizeof(frame); /* a real peripheral's receive buffer truncates too */
+    }
+    memcpy(frame, data, len);
+    crumbs_vbus_maybe_corrupt(bus, frame, len);
+    (void)crumbs_peripheral_handle_receive(d->ctx, frame, len);
+    d->writes++;
+}
+
+/** @brief Write to the general-call address: one transfer, every listener gets it. */
+static int crumbs_vbus_general_call(crumbs_vbus_t *bus, const uint8_t *data, size_t len)
+{
+    uint64_t busy_until = 0u;
+    int listeners = 0;
+
+    crumbs_vbus_start(bus);
+    for (uint8_t i = 0; i < bus->count; i++)
+    {
+        const crumbs_vbus_device_t *d = &bus->devices[i];
+        if (d->online && d->general_call)
+        {
+            listeners++;
+            if (d->busy_until_ns > busy_until)
+            {
+                busy_until = d->busy_until_ns;
+            }
+        }
+    }
+    if (listeners == 0 || crumbs_vbus_roll(bus, bus->nack_rate))
+    {
+        bus->nacks++;
+        crumbs_vbus_stop(bus);
+        return -1;
+    }
+
+    if (bus->now_ns < busy_until)
+    {
+        crumbs_vbus_spend(bus, busy_until - bus->now_ns);
+    }
+    crumbs_vbus_bytes(bus, len);
+    crumbs_vbus_stop(bus);
+
+    for (uint8_t i = 0; i < bus->count; i++)
+    {
+        crumbs_vbus_device_t *d = &bus->devices[i];
+        if (d->online && d->general_call)
+        {
+            crumbs_vbus_deliver(bus, d, data, len);
+            if (len > 0u)
+            {
+                d->busy_until_ns = bus->now_ns + (uint64_t)d->handler_us * 1000u;
+            }
+        }
+    }
+    return 0;
+}
+
+/** @brief Read of the alert response address: the lowest asserting address wins. */
+static int crumbs_vbus_alert_response(crumbs_vbus_t *bus, uint8_t *rx, size_t rx_len)
+{
+    crumbs_vbus_device_t *winner = NULL;
+
+    crumbs_vbus_start(bus);
+    for (uint8_t i = 0; i < bus->count; i++)
+    {
+        crumbs_vbus_device_t *d = &bus->devices[i];
+        if (d->online && d->alert_response && crumbs_attention_pending(d->ctx) &&
+            (!winner || d->ctx->address < winner->ctx->address))
+        {
+            winner = d;
+        }
+    }
+    if (!winner || crumbs_vbus_roll(bus, bus->nack_rate))
+    {
+        bus->nacks++;
+        crumbs_vbus_stop(bus);
+        return -1;
+    }
+
+    crumbs_vbus_bytes(bus, rx_len);
+    crumbs_vbus_stop(bus);
+    if (rx_len == 0u)
+    {
+        return 0;
+    }
+    memset(rx, 0xFF, rx_len);
+    (void)crumbs_peripheral_alert_response(winner->ctx, &rx[0]);
+    winner->reads++;
+    return (int)rx_len;
+}
+
+/** @brief Build and clock out a reply; returns the bytes stored in @p rx. */
+static int crumbs_vbus_answer(crumbs_vbus_t *bus, crumbs_vbus_device_t *d, uint8_t *rx, size_t rx_len)
+{
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t n = 0;
+
+    /* onRequest runs while the controller waits on the first byte. */
+    crumbs_vbus_spend(bus, (uint64_t)d->reply_us * 1000u);
+    d->stretch_us += d->reply_us;
+
+    if (crumbs_peripheral_build_reply(d->ctx, frame, sizeof(frame), &n) != 0)
+    {
+        n = 0;
+    }
+    if (n > rx_len)
+    {
+        n = rx_len;
+    }
+    crumbs_vbus_maybe_corrupt(bus, frame, n);
+    if (n > 0u)
+    {
+        memcpy(rx, frame, n);
+    }
+    crumbs_vbus_bytes(bus, rx_len);
+    d->reads++;
+    return (int)n;
+}
+
+/* ---- Public API --------------------------------------------------------- */
+
+void crumbs_vbus_init(crumbs_vbus_t *bus, uint32_t bus_hz)
+{
+    if (!bus)
+    {
+        return;
+    }
+    memset(bus, 0, sizeof(*bus));
+    memset(bus->index, CRUMBS_VBUS_NO_DEVICE, sizeof(bus->index));
+    bus->bus_hz = bus_hz ? bus_hz : CRUMBS_VBUS_DEFAULT_HZ;
+    bus->rng = CRUMBS_VBUS_DEFAULT_SEED;
+}
+
+crumbs_vbus_device_t *crumbs_vbus_attach(crumbs_vbus_t *bus, crumbs_context_t *ctx,
+                                         uint32_t handler_us, uint32_t reply_us)
+{
+    if (!bus || !ctx || ctx->role != CRUMBS_ROLE_PERIPHERAL || ctx->address > 0x7Fu ||
+        bus->index[ctx->address] != CRUMBS_VBUS_NO_DEVICE || bus->count >= CRUMBS_VBUS_MAX_DEVICES)
+    {
+        return NULL;
+    }
+
+    crumbs_vbus_device_t *d = &bus->devices[bus->count];
+    memset(d, 0, sizeof(*d));
+    d->ctx = ctx;
+    d->handler_us = handler_us;
+    d->reply_us = reply_us;
+    d->online = 1u;
+    d->alert_response = 1u;
+    bus->index[ctx->address] = bus->count;
+    bus->count++;
+    return d;
+}
+
+crumbs_vbus_device_t *crumbs_vbus_device(crumbs_vbus_t *bus, uint8_t addr)
+{
+    if (!bus || addr > 0x7Fu || bus->index[addr] == CRUMBS_VBUS_NO_DEVICE)
+    {
+        return NULL;
+    }
+    return &bus->devices[bus->index[addr]];
+}
+
+void crumbs_vbus_set_errors(crumbs_vbus_t *bus, uint16_t nack_rate, uint16_t corrupt_rate,
+                            uint32_t seed)
+{
+    if (!bus)
+    {
+        return;
+    }
+    bus->nack_rate = nack_rate;
+    bus->corrupt_rate = corrupt_rate;
+    bus->rng = seed ? seed : CRUMBS_VBUS_DEFAULT_SEED;
+}
+
+uint32_t crumbs_vbus_now_us(const crumbs_vbus_t *bus)
+{
+    return bus ? (uint32_t)(bus->now_ns / 1000u) : 0u;
+}
+
+void crumbs_vbus_advance_us(crumbs_vbus_t *bus, uint32_t us)
+{
+    if (bus)
+    {
+        bus->now_ns += (uint64_t)us * 1000u;
+    }
+}
+
+uint32_t crumbs_vbus_utilization_pct(const crumbs_vbus_t *bus)
+{
+    if (!bus || bus->now_ns == 0u)
+    {
+        return 0u;
+    }
+    return (uint32_t)((bus->busy_ns * 100u) / bus->now_ns);
+}
+
+int crumbs_vbus_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    crumbs_vbus_t *bus = (crumbs_vbus_t *)user_ctx;
+    if (!bus || (!data && len > 0u))
+    {
+        return -1;
+    }
+    if (addr == CRUMBS_BROADCAST_ADDR)
+    {
+        return crumbs_vbus_general_call(bus, data, len);
+    }
+
+    crumbs_vbus_device_t *d = crumbs_vbus_address(bus, addr);
+    if (!d)
+    {
+        return -1;
+    }
+    crumbs_vbus_bytes(bus, len);
+    crumbs_vbus_stop(bus);
+    crumbs_vbus_deliver(bus, d, data, len);
+    if (len > 0u)
+    {
+        d->busy_until_ns = bus->now_ns + (uint64_t)d->handler_us * 1000u;
+    }
+    return 0;
+}
+
+int crumbs_vbus_read(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len, uint32_t timeout_us)
+{
+    crumbs_vbus_t *bus = (crumbs_vbus_t *)user_ctx;
+    (void)timeout_us;
+    if (!bus || (!buffer && len > 0u))
+    {
+        return -1;
+    }
+    if (addr == CRUMBS_ALERT_RESPONSE_ADDR && bus->index[addr] == CRUMBS_VBUS_NO_DEVICE)
+    {
+        return crumbs_vbus_alert_response(bus, buffer, len);
+    }
+
+    crumbs_vbus_device_t *d = crumbs_vbus_address(bus, addr);
+    if (!d)
+    {
+        return -1;
+    }
+    int n = crumbs_vbus_answer(bus, d, buffer, len);
+    crumbs_vbus_stop(bus);
+    return n;
+}
+
+int crumbs_vbus_write_read(void *user_ctx, uint8_t addr, const uint8_t *tx, size_t tx_len,
+                           uint8_t *rx, size_t rx_len, uint32_t timeout_us,
+                           int require_repeated_start)
+{
+    crumbs_vbus_t *bus = (crumbs_vbus_t *)user_ctx;
+    (void)timeout_us;
+    (void)require_repeated_start; /* the virtual bus always has repeated START */
+    if (!bus || (!tx && tx_len > 0u) || (!rx && rx_len > 0u))
+    {
+        return -1;
+    }
+
+    crumbs_vbus_device_t *d = crumbs_vbus_address(bus, addr);
+    if (!d)
+    {
+        return -1;
+    }
+    crumbs_vbus_bytes(bus, tx_len);
+    crumbs_vbus_deliver(bus, d, tx, tx_len);
+
+    /* Repeated START + address(r). */
+    crumbs_vbus_spend(bus, crumbs_vbus_bits_ns(bus, 1u + 9u));
+    int n = crumbs_vbus_answer(bus, d, rx, rx_len);
+    crumbs_vbus_stop(bus);
+    return n;
+}
+
+int crumbs_vbus_alert(const crumbs_vbus_t *bus)
+{
+    if (!bus)
+    {
+        return 0;
+    }
+    for (uint8_t i = 0; i < bus->count; i++)
+    {
+        const crumbs_vbus_device_t *d = &bus->devices[i];
+        if (d->online && crumbs_attention_pending(d->ctx))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int crumbs_vbus_scan(void *user_ctx, uint8_t start_addr, uint8_t end_addr, int strict,
+                     uint8_t *found, size_t max_found)
+{
+    crumbs_vbus_t *bus = (crumbs_vbus_t *)user_ctx;
+    size_t n = 0;
+    (void)strict; /* simulated devices ACK data bytes whenever they ACK the address */
+    if (!bus || !found || start_addr > end_addr || end_addr > 0x7Fu)
+    {
+        return -1;
+    }
+
+    for (uint16_t a = start_addr; a <= end_addr && n < max_found; a++)
+    {
+        if (crumbs_vbus_address(bus, (uint8_t)a))
+        {
+            crumbs_vbus_stop(bus);
+            found[n++] = (uint8_t)a;
+        }
+    }
+    return (int)n;
+}
+
+void crumbs_vbus_use(crumbs_vbus_t *bus)
+{
+    g_vbus_current = bus;
+}
+
+void crumbs_vbus_delay_us(uint32_t us)
+{
+    crumbs_vbus_advance_us(g_vbus_current, us);
+}
+
+uint32_t crumbs_vbus_clock_us(void)
+{
+    return crumbs_vbus_now_us(g_vbus_current);
+}
+
+void crumbs_vbus_bind(crumbs_vbus_t *bus, crumbs_device_t *dev, crumbs_context_t *ctx, uint8_t addr)
+{
+    if (!dev)
+    {
+        return;
+    }
+    memset(dev, 0, sizeof(*dev));
+    dev->ctx = ctx;
+    dev->addr = addr;
+    dev->write_fn = crumbs_vbus_write;
+    dev->read_fn = crumbs_vbus_read;
+    dev->delay_fn = crumbs_vbus_delay_us;
+    dev->io = bus;
+    dev->transport = &crumbs_vbus_transport;
+}
@@ -1,13 +1,88 @@
 /**
  * @file
- * @brief Small wrapper around the generated CRC implementation.
+ * @brief Small wrapper around the selected CRC-8 back end.
+ *
+ * CRUMBS_CRC_BACKEND (see crumbs_crc.h) picks the implementation; all of
+ * them compute the same CRC-8 (poly 0x07, init 0, no reflection, no final
+ * XOR), so the running value is the CRC register itself.
  */
 
 #include "crumbs_crc.h"
+#include "crumbs_crc_backends.h"
+
+#if CRUMBS_CRC_BACKEND == CRUMBS_CRC_BACKEND_NIBBLE
+
 #include "crc8_nibble.h"
 
+static crumbs_crc8_t crumbs_crc8_run(crumbs_crc8_t crc, const uint8_t *data, size_t len)
+{
+    return (crumbs_crc8_t)crc_update((crc_t)crc, data, len);
+}
+
+#elif CRUMBS_CRC_BACKEND == CRUMBS_CRC_BACKEND_BYTE
+
+static crumbs_crc8_t crumbs_crc8_run(crumbs_crc8_t crc, const uint8_t *data, size_t len)
+{
+    while (len--)
+    {
+        crc = CRUMBS_CRC8_TABLE_READ(0, crc ^ *data++);
+    }
+    return crc;
+}
+
+#elif (CRUMBS_CRC_BACKEND == CRUMBS_CRC_BACKEND_SLICE4) || \
+    (CRUMBS_CRC_BACKEND == CRUMBS_CRC_BACKEND_SLICE8)
+
+/*
+ * Slice-by-N: the first byte of each block is folded with the running CRC
+ * and shifted through the remaining N-1 bytes by table N-1; every other
+ * byte k is shifted by table N-1-k. The N lookups are independent, so a
+ * superscalar core overlaps them instead of chaining one per byte.
+ */
+static crumbs_crc8_t crumbs_crc8_run(crumbs_crc8_t crc, const uint8_t *data, size_t len)
+{
+#if CRUMBS_CRC_BACKEND == CRUMBS_CRC_BACKEND_SLICE8
+    while (len >= 8u)
+    {
+        crc = (crumbs_crc8_t)(CRUMBS_CRC8_TABLE_READ(7, crc ^ data[0]) ^
+                              CRUMBS_CRC8_TABLE_READ(6, data[1]) ^
+                              CRUMBS_CRC8_TABLE_READ(5, data[2]) ^
+                              CRUMBS_CRC8_TABLE_READ(4, data[3]) ^
+                              CRUMBS_CRC8_TABLE_READ(3, data[4]) ^
+                              CRUMBS_CRC8_TABLE_READ(2, data[5]) ^
+                              CRUMBS_CRC8_TABLE_READ(1, data[6]) ^
+                              CRUMBS_CRC8_TABLE_READ(0, data[7]));
+        data += 8;
+        len -= 8u;
+    }
+#endif
+    while (len >= 4u)
+    {
+        crc = (crumbs_crc8_t)(CRUMBS_CRC8_TABLE_READ(3, crc ^ data[0]) ^
+                              CRUMBS_CRC8_TABLE_READ(2, data[1]) ^
+                              CRUMBS_CRC8_TABLE_READ(1, data[2]) ^
+                              CRUMBS_CRC8_TABLE_READ(0, data[3]));
+        data += 4;
+        len -= 4u;
+    }
+    while (len--)
+    {
+        crc = CRUMBS_CRC8_TABLE_READ(0, crc ^ *data++);
+    }
+    return crc;
+}
+
+#else /* CRUMBS_CRC_BACKEND_HW */
+
+static crumbs_crc8_t crumbs_crc8_run(crumbs_crc8_t crc, const uint8_t *data, size_t len)
+{
+    return crumbs_crc8_hw_update(crc, data, len);
+}
+
+#endif
+
 /**
- * @brief Compute CRC-8 value using the generated table-driven implementation.
+ * @brief Compute CRC-8 value using the selected back end.
  *
  * @param data Input buffer (may be NULL only when len == 0).
  * @param len Length of buffer in bytes.
@@ -20,9 +95,37 @@ crumbs_crc8_t crumbs_crc8(const uint8_t *data, size_t len)
         return 0u;
     }
 
-    crc_t crc = crc_init();
-    crc = crc_update(crc, data, len);
-    crc = crc_finalize(crc);
+    return crumbs_crc8_run(0u, data, len);
+}
+
+/**
+ * @brief Initial running value for incremental CRC-8.
+ */
+crumbs_crc8_t crumbs_crc8_init(void)
+{
+    return 0u;
+}
 
-    return (crumbs_crc8_t)crc;
+/**
+ * @brief Continue a CRC-8 computation from a previous running value.
+ *
+ * CRUMBS uses CRC-8 with init 0, no reflection and no final XOR, so the
+ * running value is the register itself and needs no finalization.
+ */
+crumbs_crc8_t crumbs_crc8_update(crumbs_crc8_t crc, const uint8_t *data, size_t len)
+{
+    if (data == NULL || len == 0)
+    {
+        return crc;
+    }
+
+    return crumbs_crc8_run(crc, data, len);
+}
+
+/**
+ * @brief Finalize incremental CRC-8 (identity: CRUMBS has no final XOR).
+ */
+crumbs_crc8_t crumbs_crc8_final(crumbs_crc8_t crc)
+{
+    return crc;
 }
@@ -0,0 +1,41 @@
+/**
+ * @file
+ * @brief Internal table declarations for the table-based CRC back ends.
+ *
+ * Not installed; only the sources under src/crc include this.
+ */
+
+#ifndef CRUMBS_CRC_BACKENDS_H
+#define CRUMBS_CRC_BACKENDS_H
+
+#include <stdint.h>
+
+#include "crumbs_crc.h"
+
+/** @brief Number of 256-entry tables needed by the selected back end. */
+#if CRUMBS_CRC_BACKEND == CRUMBS_CRC_BACKEND_BYTE
+#define CRUMBS_CRC8_TABLE_COUNT 1
+#elif CRUMBS_CRC_BACKEND == CRUMBS_CRC_BACKEND_SLICE4
+#define CRUMBS_CRC8_TABLE_COUNT 4
+#elif CRUMBS_CRC_BACKEND == CRUMBS_CRC_BACKEND_SLICE8
+#define CRUMBS_CRC8_TABLE_COUNT 8
+#else
+#define CRUMBS_CRC8_TABLE_COUNT 0
+#endif
+
+/* Keep tables in flash on AVR; everywhere else const data already is. */
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#define CRUMBS_CRC8_TABLE_ATTR PROGMEM
+#define CRUMBS_CRC8_TABLE_READ(k, i) pgm_read_byte(&crumbs_crc8_tables[(k)][(i)])
+#else
+#define CRUMBS_CRC8_TABLE_ATTR
+#define CRUMBS_CRC8_TABLE_READ(k, i) (crumbs_crc8_tables[(k)][(i)])
+#endif
+
+#if CRUMBS_CRC8_TABLE_COUNT > 0
+/** @brief crumbs_crc8_tables[k][x] = CRC of byte x followed by k zero bytes. */
+extern const uint8_t crumbs_crc8_tables[CRUMBS_CRC8_TABLE_COUNT][256] CRUMBS_CRC8_TABLE_ATTR;
+#endif
+
+#endif /* CRUMBS_CRC_BACKENDS_H */
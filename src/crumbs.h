@@ -7,8 +7,17 @@
 #include "crumbs_version.h"
 #include "crumbs_message.h"
 #include "crumbs_crc.h"
+#include "crumbs_frame_builder.h"
 #include "crumbs_i2c.h"
 
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+/** @brief Places static handler tables in flash on AVR (no-op elsewhere). */
+#define CRUMBS_PROGMEM PROGMEM
+#else
+#define CRUMBS_PROGMEM
+#endif
+
 /* ============================================================================
  * Debug Configuration
  * ============================================================================ */
@@ -63,7 +72,7 @@ extern "C"
      * - 8 handlers: ~36 bytes on AVR, ~68 bytes on 32-bit
      * - 32 handlers: ~132 bytes on AVR, ~260 bytes on 32-bit
      *
-     * Dispatch always uses O(n) linear search for portability.
+     * Lookup cost depends on CRUMBS_DISPATCH (linear search by default).
      * Set to 0 to disable handler dispatch entirely.
      *
      * IMPORTANT: For Arduino/PlatformIO, you must add this to your
@@ -77,6 +86,126 @@ extern "C"
 #define CRUMBS_MAX_HANDLERS 16
 #endif
 
+    /** @name Handler Dispatch Strategies
+     *  Values accepted by CRUMBS_DISPATCH.
+     *  @{ */
+#define CRUMBS_DISPATCH_LINEAR 0 /**< O(n) scan, swap-with-last removal (default). */
+#define CRUMBS_DISPATCH_SORTED 1 /**< Tables kept sorted by opcode, O(log n) binary search. */
+#define CRUMBS_DISPATCH_DIRECT 2 /**< 256-entry opcode-to-slot index, O(1) lookup. */
+    /** @} */
+
+    /**
+     * @brief Handler lookup strategy used by the peripheral dispatch path.
+     *
+     * Lookup runs inside the I2C receive/request ISR on most MCUs, so the
+     * strategy bounds worst-case ISR time:
+     *
+     * - CRUMBS_DISPATCH_LINEAR: no extra RAM; cost grows with handler count.
+     * - CRUMBS_DISPATCH_SORTED: no extra RAM; O(log n) lookup, registration
+     *   shifts entries to keep each table sorted.
+     * - CRUMBS_DISPATCH_DIRECT: adds two 256-byte index tables (512 bytes)
+     *   to the context for constant-time lookup. Best suited to parts with
+     *   RAM to spare (ESP32, RP2040, Linux); too large for most AVR boards.
+     *
+     * Like CRUMBS_MAX_HANDLERS this changes the context layout, so on
+     * Arduino/PlatformIO it must be set through build_flags:
+     *   build_flags = -DCRUMBS_DISPATCH=1
+     */
+#ifndef CRUMBS_DISPATCH
+#define CRUMBS_DISPATCH CRUMBS_DISPATCH_LINEAR
+#endif
+
+#if (CRUMBS_DISPATCH != CRUMBS_DISPATCH_LINEAR) && \
+    (CRUMBS_DISPATCH != CRUMBS_DISPATCH_SORTED) && \
+    (CRUMBS_DISPATCH != CRUMBS_DISPATCH_DIRECT)
+#error "CRUMBS_DISPATCH must be CRUMBS_DISPATCH_LINEAR, _SORTED or _DIRECT"
+#endif
+
+#if CRUMBS_MAX_HANDLERS > 255
+#error "CRUMBS_MAX_HANDLERS must not exceed 255"
+#endif
+
+    /** @name Context Roles
+     *  Values accepted by CRUMBS_CONTEXT_ROLE.
+     *  @{ */
+#define CRUMBS_CONTEXT_BOTH 0       /**< Controller and peripheral sections (default). */
+#define CRUMBS_CONTEXT_CONTROLLER 1 /**< Controller section only: no handler tables. */
+#define CRUMBS_CONTEXT_PERIPHERAL 2 /**< Peripheral section only: no controller statistics. */
+    /** @} */
+
+    /**
+     * @brief Which role sections crumbs_context_t carries.
+     *
+     * The context is a common header plus a crumbs_peripheral_ctx_t
+     * (handler tables, static tables, direct index) and, with
+     * CRUMBS_ENABLE_STATS, a crumbs_controller_ctx_t (per-address latency).
+     * A firmware that only ever runs one role can leave the other section
+     * out. A controller-only build saves the whole handler table
+     * (~168 bytes on AVR with 16 handlers); registering a handler then
+     * returns -1. Peripheral-only features (CRUMBS_ENABLE_REPLY_CACHE,
+     * CRUMBS_ENABLE_RX_QUEUE, CRUMBS_ENABLE_BROADCAST, CRUMBS_ENABLE_STAGING,
+     * CRUMBS_ENABLE_REGISTERS, CRUMBS_ENABLE_BULK, CRUMBS_ENABLE_REPLY_CURSOR,
+     * CRUMBS_ENABLE_CHANGE_SEQ, CRUMBS_ENABLE_ATTENTION,
+     * CRUMBS_ENABLE_SEQUENCED, CRUMBS_ENABLE_RESULT) are rejected in a
+     * controller-only build.
+     *
+     * crumbs_context_saved_bytes() reports what a configuration saves.
+     * Changes the context layout, so on Arduino/PlatformIO set it through
+     * build_flags:
+     *   build_flags = -DCRUMBS_CONTEXT_ROLE=1
+     */
+#ifndef CRUMBS_CONTEXT_ROLE
+#define CRUMBS_CONTEXT_ROLE CRUMBS_CONTEXT_BOTH
+#endif
+
+#if (CRUMBS_CONTEXT_ROLE != CRUMBS_CONTEXT_BOTH) && \
+    (CRUMBS_CONTEXT_ROLE != CRUMBS_CONTEXT_CONTROLLER) && \
+    (CRUMBS_CONTEXT_ROLE != CRUMBS_CONTEXT_PERIPHERAL)
+#error "CRUMBS_CONTEXT_ROLE must be CRUMBS_CONTEXT_BOTH, _CONTROLLER or _PERIPHERAL"
+#endif
+
+    /**
+     * @brief Keep a user_data pointer per runtime handler slot.
+     *
+     * Set to 0 to drop both user_data arrays from the handler tables
+     * (2 * CRUMBS_MAX_HANDLERS pointers: 64 bytes on AVR with 16 handlers).
+     * Handlers then receive NULL and registering one with a non-NULL
+     * user_data returns -1. Static tables keep their user_data, which
+     * lives in flash. Changes the context layout, so on Arduino/PlatformIO
+     * set it through build_flags:
+     *   build_flags = -DCRUMBS_HANDLER_USERDATA=0
+     */
+#ifndef CRUMBS_HANDLER_USERDATA
+#define CRUMBS_HANDLER_USERDATA 1
+#endif
+
+/** @brief Non-zero when the context carries the runtime handler tables. */
+#define CRUMBS_HAS_HANDLER_TABLES \
+    (CRUMBS_MAX_HANDLERS > 0 && CRUMBS_CONTEXT_ROLE != CRUMBS_CONTEXT_CONTROLLER)
+
+    /**
+     * @brief Opcode ranges each handler table can hold (0 to drop them).
+     *
+     * A range entry sends every opcode from lo to hi to one handler, for
+     * paged families such as history entries or channel banks. Ranges are
+     * looked up after the exact and static entries and work with
+     * CRUMBS_MAX_HANDLERS=0. Memory: 2 * N * (2 + 2 * sizeof(void*)) bytes
+     * plus 3 (27 bytes on AVR with the default 2). Changes the context
+     * layout, so on Arduino/PlatformIO set it through build_flags:
+     *   build_flags = -DCRUMBS_MAX_HANDLER_RANGES=4
+     */
+#ifndef CRUMBS_MAX_HANDLER_RANGES
+#define CRUMBS_MAX_HANDLER_RANGES 2
+#endif
+
+#if CRUMBS_MAX_HANDLER_RANGES > 255
+#error "CRUMBS_MAX_HANDLER_RANGES must not exceed 255"
+#endif
+
+/** @brief Non-zero when the context carries the range tables. */
+#define CRUMBS_HAS_HANDLER_RANGES \
+    (CRUMBS_MAX_HANDLER_RANGES > 0 && CRUMBS_CONTEXT_ROLE != CRUMBS_CONTEXT_CONTROLLER)
+
     /**
      * @brief Reserved opcode for SET_REPLY command.
      *
@@ -88,6 +217,365 @@ extern "C"
      */
 #define CRUMBS_CMD_SET_REPLY 0xFE
 
+    /** @name Protocol Extension Opcodes
+     *  Opcodes 0xF0-0xFD are reserved for protocol extensions handled by the
+     *  core (see docs/protocol.md). The core only intercepts an extension
+     *  opcode while the matching feature is active on the context, so
+     *  firmwares that already use these values keep working as long as they
+     *  leave the feature off. CAPABILITIES is the exception: it is always
+     *  answered. User reply handlers registered for an extension opcode
+     *  take precedence over the core.
+     *  @{ */
+#define CRUMBS_CMD_CAPABILITIES 0xFD /**< GET: capability bitmap + feature limits. */
+#define CRUMBS_CMD_FRAGMENT 0xFC     /**< SET: one fragment of a >27-byte transfer; GET: reassembly status. */
+#define CRUMBS_CMD_BATCH 0xFB        /**< SET: several [opcode][len][data] records in one frame. */
+#define CRUMBS_CMD_NOT_READY 0xFA    /**< Reply marker: requested data is still being prepared. */
+#define CRUMBS_CMD_STATS 0xF9        /**< SET: select a page or reset; GET: one page of counters. */
+#define CRUMBS_CMD_TRACE 0xF8        /**< SET: start/stop a trace dump; GET: next trace events. */
+#define CRUMBS_CMD_BROADCAST 0xF7    /**< SET: [opcode][data...] sent to the general-call address. */
+#define CRUMBS_CMD_COMMIT 0xF6       /**< SET: apply or discard staged commands; GET: staging status. */
+#define CRUMBS_CMD_REG_READ 0xF5     /**< SET: select [offset:u16][count] of the register file; GET: those bytes. */
+#define CRUMBS_CMD_BULK_GET 0xF4     /**< GET only: replies of several opcodes packed into one stream. */
+#define CRUMBS_CMD_IF_CHANGED 0xF3   /**< SET: select [opcode][seen:u16]; GET: reply only if the state changed. */
+#define CRUMBS_CMD_SEQUENCED 0xF2    /**< SET: [seq][opcode][data...] applied at most once; GET: session status. */
+#define CRUMBS_CMD_RESULT 0xF1       /**< GET: [opcode][status][count] of the last command; also read unasked. */
+#define CRUMBS_CMD_TIMING 0xF0       /**< SET: select a phase or reset; GET: cycle statistics of that phase. */
+    /** @} */
+
+    /** @name Capability Bits
+     *  Bits of the 32-bit bitmap returned for CRUMBS_CMD_CAPABILITIES.
+     *  Bits 24-31 are left for application use.
+     *  @{ */
+#define CRUMBS_CAP_FRAGMENTS 0x00000001u /**< Reassembles CRUMBS_CMD_FRAGMENT transfers. */
+#define CRUMBS_CAP_BATCH 0x00000002u     /**< Unpacks CRUMBS_CMD_BATCH frames. */
+#define CRUMBS_CAP_STATS 0x00000004u     /**< Answers CRUMBS_CMD_STATS. */
+#define CRUMBS_CAP_TRACE 0x00000008u     /**< Answers CRUMBS_CMD_TRACE (trace ring attached). */
+#define CRUMBS_CAP_BROADCAST 0x00000010u /**< Accepts CRUMBS_CMD_BROADCAST frames. */
+#define CRUMBS_CAP_STAGING 0x00000020u   /**< Stages latched opcodes for CRUMBS_CMD_COMMIT. */
+#define CRUMBS_CAP_REGISTERS 0x00000040u /**< Serves CRUMBS_CMD_REG_READ from a register file. */
+#define CRUMBS_CAP_BULK 0x00000080u      /**< Answers CRUMBS_CMD_BULK_GET. */
+#define CRUMBS_CAP_CHANGES 0x00000100u   /**< Answers CRUMBS_CMD_IF_CHANGED. */
+#define CRUMBS_CAP_SEQUENCED 0x00000200u /**< Suppresses duplicate CRUMBS_CMD_SEQUENCED commands. */
+#define CRUMBS_CAP_RESULT 0x00000400u    /**< Answers the read after a command with CRUMBS_CMD_RESULT. */
+#define CRUMBS_CAP_TIMING 0x00000800u    /**< Answers CRUMBS_CMD_TIMING (timing recorder attached). */
+    /** @} */
+
+    /** @name Bus Clock Rates
+     *  Standard I2C clock rates in kHz, as advertised in the CAPABILITIES
+     *  reply and used by the controller clock negotiation (crumbs_clock.h).
+     *  @{ */
+#define CRUMBS_BUS_KHZ_STANDARD 100u   /**< Standard mode. */
+#define CRUMBS_BUS_KHZ_FAST 400u       /**< Fast mode. */
+#define CRUMBS_BUS_KHZ_FAST_PLUS 1000u /**< Fast-mode Plus. */
+    /** @} */
+
+    /**
+     * @brief Enable peripheral-side reassembly of fragmented transfers.
+     *
+     * Adds the reassembly state (about 12 bytes on AVR, 24 on 64-bit) to the
+     * context. Controllers can send fragmented transfers without it; only
+     * peripherals that receive them need it. Changes the context layout, so
+     * on Arduino/PlatformIO set it through build_flags:
+     *   build_flags = -DCRUMBS_ENABLE_FRAGMENTS=1
+     */
+#ifndef CRUMBS_ENABLE_FRAGMENTS
+#define CRUMBS_ENABLE_FRAGMENTS 0
+#endif
+
+    /**
+     * @brief Unpack CRUMBS_CMD_BATCH frames on peripherals (default on).
+     *
+     * Does not change the context layout. Set to 0 if a firmware already
+     * uses opcode 0xFB for its own command.
+     */
+#ifndef CRUMBS_ENABLE_BATCH
+#define CRUMBS_ENABLE_BATCH 1
+#endif
+
+    /**
+     * @brief Accept CRUMBS_CMD_BROADCAST frames sent to the general-call
+     *        address.
+     *
+     * Adds three bytes to the context. Reception is switched on at run
+     * time with crumbs_peripheral_set_broadcast(), together with the HAL's
+     * general-call enable (crumbs_arduino_set_general_call()). Controllers
+     * can broadcast without it. Changes the context layout, so on
+     * Arduino/PlatformIO set it through build_flags:
+     *   build_flags = -DCRUMBS_ENABLE_BROADCAST=1
+     */
+#ifndef CRUMBS_ENABLE_BROADCAST
+#define CRUMBS_ENABLE_BROADCAST 0
+#endif
+
+    /**
+     * @brief Hold latched opcodes until a CRUMBS_CMD_COMMIT applies them
+     *        all at once.
+     *
+     * Adds CRUMBS_STAGE_DEPTH messages (31 bytes each) and a 32-byte opcode
+     * bitmap to the context. Opcodes are marked with crumbs_set_latched()
+     * (crumbs_stage.h). Changes the context layout, so on
+     * Arduino/PlatformIO set it through build_flags:
+     *   build_flags = -DCRUMBS_ENABLE_STAGING=1
+     */
+#ifndef CRUMBS_ENABLE_STAGING
+#define CRUMBS_ENABLE_STAGING 0
+#endif
+
+    /** @brief Commands a peripheral can hold between commits (1..255). */
+#ifndef CRUMBS_STAGE_DEPTH
+#define CRUMBS_STAGE_DEPTH 4
+#endif
+#if CRUMBS_ENABLE_STAGING && (CRUMBS_STAGE_DEPTH < 1 || CRUMBS_STAGE_DEPTH > 255)
+#error "CRUMBS_STAGE_DEPTH must be between 1 and 255"
+#endif
+
+    /**
+     * @brief Serve CRUMBS_CMD_REG_READ straight from a memory region.
+     *
+     * Adds a pointer and three small fields to the context. The region is
+     * installed with crumbs_set_register_file(). Changes the context
+     * layout, so on Arduino/PlatformIO set it through build_flags:
+     *   build_flags = -DCRUMBS_ENABLE_REGISTERS=1
+     */
+#ifndef CRUMBS_ENABLE_REGISTERS
+#define CRUMBS_ENABLE_REGISTERS 0
+#endif
+
+    /**
+     * @brief Answer CRUMBS_CMD_BULK_GET: one SET_REPLY for several opcodes.
+     *
+     * Adds CRUMBS_BULK_MAX_OPS + 2 bytes to the context. Changes the
+     * context layout, so on Arduino/PlatformIO set it through build_flags:
+     *   build_flags = -DCRUMBS_ENABLE_BULK=1
+     */
+#ifndef CRUMBS_ENABLE_BULK
+#define CRUMBS_ENABLE_BULK 0
+#endif
+
+    /**
+     * @brief Opcodes a peripheral keeps from one bulk SET_REPLY (1-26).
+     *
+     * Changes the context layout when CRUMBS_ENABLE_BULK is set.
+     */
+#ifndef CRUMBS_BULK_MAX_OPS
+#define CRUMBS_BULK_MAX_OPS 16
+#endif
+
+#if CRUMBS_ENABLE_BULK && (CRUMBS_BULK_MAX_OPS < 1 || CRUMBS_BULK_MAX_OPS > 26)
+#error "CRUMBS_BULK_MAX_OPS must be between 1 and 26"
+#endif
+
+    /**
+     * @brief Let SET_REPLY start a cursor that advances after every reply.
+     *
+     * Adds four bytes to the context. Changes the context layout, so on
+     * Arduino/PlatformIO set it through build_flags:
+     *   build_flags = -DCRUMBS_ENABLE_REPLY_CURSOR=1
+     */
+#ifndef CRUMBS_ENABLE_REPLY_CURSOR
+#define CRUMBS_ENABLE_REPLY_CURSOR 0
+#endif
+
+    /**
+     * @brief Keep a change sequence and answer conditional GETs.
+     *
+     * Adds six bytes to the context. Changes the context layout, so on
+     * Arduino/PlatformIO set it through build_flags:
+     *   build_flags = -DCRUMBS_ENABLE_CHANGE_SEQ=1
+     */
+#ifndef CRUMBS_ENABLE_CHANGE_SEQ
+#define CRUMBS_ENABLE_CHANGE_SEQ 0
+#endif
+
+    /**
+     * @brief Apply CRUMBS_CMD_SEQUENCED commands at most once, in order.
+     *
+     * Adds eight bytes to the context (crumbs_seq.h). Changes the context
+     * layout, so on Arduino/PlatformIO set it through build_flags:
+     *   build_flags = -DCRUMBS_ENABLE_SEQUENCED=1
+     */
+#ifndef CRUMBS_ENABLE_SEQUENCED
+#define CRUMBS_ENABLE_SEQUENCED 0
+#endif
+
+    /**
+     * @brief Record each command's result and serve it on the next read.
+     *
+     * Adds five bytes to the context. Changes the context layout, so on
+     * Arduino/PlatformIO set it through build_flags:
+     *   build_flags = -DCRUMBS_ENABLE_RESULT=1
+     */
+#ifndef CRUMBS_ENABLE_RESULT
+#define CRUMBS_ENABLE_RESULT 0
+#endif
+
+    /**
+     * @brief Drive an open-drain attention (SMBus ALERT#) line.
+     *
+     * Adds a pin callback, its user pointer and a flag to the context.
+     * Changes the context layout, so on Arduino/PlatformIO set it through
+     * build_flags:
+     *   build_flags = -DCRUMBS_ENABLE_ATTENTION=1
+     */
+#ifndef CRUMBS_ENABLE_ATTENTION
+#define CRUMBS_ENABLE_ATTENTION 0
+#endif
+
+    /**
+     * @brief Serve replies from a double buffer of pre-encoded frames.
+     *
+     * Adds two encoded frames (about 70 bytes) to the context. Peripheral
+     * code encodes replies in loop() with crumbs_peripheral_refresh_reply()
+     * or crumbs_peripheral_publish_reply(), so the I2C request handler only
+     * copies a ready frame. Changes the context layout, so on
+     * Arduino/PlatformIO set it through build_flags:
+     *   build_flags = -DCRUMBS_ENABLE_REPLY_CACHE=1
+     */
+#ifndef CRUMBS_ENABLE_REPLY_CACHE
+#define CRUMBS_ENABLE_REPLY_CACHE 0
+#endif
+
+    /**
+     * @brief Queue received frames for crumbs_peripheral_process() instead of
+     *        dispatching them in the receive interrupt.
+     *
+     * Adds a ring of CRUMBS_RX_QUEUE_DEPTH messages (31 bytes each) to the
+     * context. Deferral is switched on at run time with
+     * crumbs_set_deferred_dispatch(). Changes the context layout, so on
+     * Arduino/PlatformIO set it through build_flags:
+     *   build_flags = -DCRUMBS_ENABLE_RX_QUEUE=1
+     */
+#ifndef CRUMBS_ENABLE_RX_QUEUE
+#define CRUMBS_ENABLE_RX_QUEUE 0
+#endif
+
+    /** @brief Slots in the receive ring (power of two, at most 128). */
+#ifndef CRUMBS_RX_QUEUE_DEPTH
+#define CRUMBS_RX_QUEUE_DEPTH 4
+#endif
+#if CRUMBS_ENABLE_RX_QUEUE && \
+    (CRUMBS_RX_QUEUE_DEPTH < 1 || CRUMBS_RX_QUEUE_DEPTH > 128 || \
+     (CRUMBS_RX_QUEUE_DEPTH & (CRUMBS_RX_QUEUE_DEPTH - 1)) != 0)
+#error "CRUMBS_RX_QUEUE_DEPTH must be a power of two between 1 and 128"
+#endif
+
+#if CRUMBS_CONTEXT_ROLE == CRUMBS_CONTEXT_CONTROLLER && \
+    (CRUMBS_ENABLE_REPLY_CACHE || CRUMBS_ENABLE_RX_QUEUE || CRUMBS_ENABLE_BROADCAST || \
+     CRUMBS_ENABLE_STAGING || CRUMBS_ENABLE_REGISTERS || CRUMBS_ENABLE_BULK ||         \
+     CRUMBS_ENABLE_REPLY_CURSOR || CRUMBS_ENABLE_CHANGE_SEQ || CRUMBS_ENABLE_ATTENTION ||  \
+     CRUMBS_ENABLE_SEQUENCED || CRUMBS_ENABLE_RESULT)
+#error "CRUMBS_ENABLE_REPLY_CACHE, _RX_QUEUE, _BROADCAST, _STAGING, _REGISTERS, _BULK, _REPLY_CURSOR, _CHANGE_SEQ, _ATTENTION, _SEQUENCED and _RESULT need a peripheral context"
+#endif
+
+    /**
+     * @brief Keep traffic counters and timing histograms in the context.
+     *
+     * Adds a crumbs_stats_t block (frames, decode errors by cause,
+     * unhandled opcodes, handler and reply-build times, per-opcode
+     * entries) plus per-address transaction latencies for controllers,
+     * about 250 bytes with the defaults. Peripherals also answer
+     * CRUMBS_CMD_STATS, so the numbers can be read over the bus. Timings
+     * need a clock set with crumbs_set_stats_clock(). Changes the context
+     * layout, so on Arduino/PlatformIO set it through build_flags:
+     *   build_flags = -DCRUMBS_ENABLE_STATS=1
+     */
+#ifndef CRUMBS_ENABLE_STATS
+#define CRUMBS_ENABLE_STATS 0
+#endif
+
+    /** @brief Opcodes with their own handler timing entry (first come, first kept). */
+#ifndef CRUMBS_STATS_OPCODES
+#define CRUMBS_STATS_OPCODES 8
+#endif
+
+    /** @brief Controller target addresses with their own latency histogram. */
+#ifndef CRUMBS_STATS_ADDRS
+#define CRUMBS_STATS_ADDRS 8
+#endif
+
+    /** @brief Upper edge of the first handler/reply-time bucket; each next bucket doubles it. */
+#ifndef CRUMBS_STATS_HANDLER_BASE_US
+#define CRUMBS_STATS_HANDLER_BASE_US 16u
+#endif
+
+    /** @brief Upper edge of the first transaction-latency bucket; each next bucket doubles it. */
+#ifndef CRUMBS_STATS_LATENCY_BASE_US
+#define CRUMBS_STATS_LATENCY_BASE_US 256u
+#endif
+
+    /** @brief Histogram buckets (fixed by the STATS reply format). */
+#define CRUMBS_STATS_BUCKETS 8
+
+    /**
+     * @brief Compile in the trace hook points (default off).
+     *
+     * With 1, the receive, dispatch, reply and transmit paths call the
+     * hook installed with crumbs_set_trace_hook() at each CRUMBS_TRACE_*
+     * point. With 0 every hook point compiles to nothing. Adds three
+     * pointers to the context, so on Arduino/PlatformIO set it through
+     * build_flags:
+     *   build_flags = -DCRUMBS_ENABLE_TRACE=1
+     */
+#ifndef CRUMBS_ENABLE_TRACE
+#define CRUMBS_ENABLE_TRACE 0
+#endif
+
+    /**
+     * @brief Update context statistics atomically (default off).
+     *
+     * With 1, crc_error_count and last_crc_ok are written with atomic
+     * operations, so one controller context can be shared by devices used
+     * from several threads without a lock around encode/decode. Read them
+     * through crumbs_get_crc_error_count() / crumbs_last_crc_ok(). Does not
+     * change the context layout. Needs the GCC/Clang __atomic builtins.
+     * Peripheral contexts are still single-threaded.
+     */
+#ifndef CRUMBS_THREAD_SAFE
+#define CRUMBS_THREAD_SAFE 0
+#endif
+
+    /** @brief Per-record overhead in a CRUMBS_CMD_BATCH payload (opcode + len). */
+#define CRUMBS_BATCH_RECORD_HEADER 2u
+
+    /** @name Ready Polling
+     *  Defaults for crumbs_controller_read_ready() as used by the ops
+     *  helpers and the request engine.
+     *  @{ */
+#ifndef CRUMBS_READY_POLL_INTERVAL_US
+#define CRUMBS_READY_POLL_INTERVAL_US 500u /**< Wait between reads while a peripheral reports NOT_READY. */
+#endif
+#ifndef CRUMBS_READY_POLL_TIMEOUT_US
+#define CRUMBS_READY_POLL_TIMEOUT_US 50000u /**< Give up after this much NOT_READY polling. */
+#endif
+    /** @} */
+
+    /** @name Fragment Framing
+     *  FRAGMENT payload: [target_opcode][index][count][chunk...]. Every
+     *  fragment except the last carries exactly CRUMBS_FRAGMENT_CHUNK bytes,
+     *  so a fragment's offset is index * CRUMBS_FRAGMENT_CHUNK.
+     *  @{ */
+#define CRUMBS_FRAGMENT_HEADER 3u                                        /**< target_opcode + index + count. */
+#define CRUMBS_FRAGMENT_CHUNK (CRUMBS_MAX_PAYLOAD - CRUMBS_FRAGMENT_HEADER) /**< Data bytes per full fragment (24). */
+#define CRUMBS_FRAGMENT_MAX_TRANSFER (255u * CRUMBS_FRAGMENT_CHUNK)      /**< Largest transfer (6120 bytes). */
+    /** @} */
+
+    /**
+     * @brief Resume/restart attempts crumbs_controller_send_fragmented() makes
+     *        before giving up on a verified transfer.
+     */
+#ifndef CRUMBS_FRAGMENT_MAX_RETRIES
+#define CRUMBS_FRAGMENT_MAX_RETRIES 3
+#endif
+
+    /** @name Fragment Reassembly State
+     *  First byte of the CRUMBS_CMD_FRAGMENT status reply.
+     *  @{ */
+#define CRUMBS_FRAG_IDLE 0      /**< No transfer seen since the buffer was set. */
+#define CRUMBS_FRAG_RECEIVING 1 /**< Transfer in progress. */
+#define CRUMBS_FRAG_COMPLETE 2  /**< Last transfer completed and was delivered. */
+#define CRUMBS_FRAG_ERROR 3     /**< Last transfer aborted (gap, overflow, bad chunk). */
+    /** @} */
+
     /**
      * @brief Role of a CRUMBS endpoint on the I2C bus.
      */
@@ -163,83 +651,565 @@ extern "C"
         void *user_data);
 
     /**
-     * @brief State and configuration for a CRUMBS endpoint.
+     * @brief Called when a fragmented transfer has been reassembled.
      *
-     * This structure is plain-old-data so it is safe to allocate on the
-     * stack or in static storage across supported platforms.
+     * @param ctx Pointer to the active CRUMBS context.
+     * @param opcode Target opcode carried by the fragments.
+     * @param data Reassembled bytes (the buffer given to crumbs_set_fragment_buffer()).
+     * @param len Number of bytes (0 to the buffer capacity).
+     * @param user_data Opaque pointer given to crumbs_set_fragment_buffer().
      */
-    struct crumbs_context_s
+    typedef void (*crumbs_fragment_fn)(
+        struct crumbs_context_s *ctx,
+        uint8_t opcode,
+        const uint8_t *data,
+        size_t len,
+        void *user_data);
+
+    /**
+     * @brief Drive the attention line (see crumbs_set_attention_pin()).
+     *
+     * @param user_data Opaque pointer given to crumbs_set_attention_pin().
+     * @param asserted  Non-zero to pull the line low, 0 to release it.
+     */
+    typedef void (*crumbs_attention_fn)(void *user_data, int asserted);
+
+    /** @name Static (ROM-resident) Handler Tables
+     *  Compile-time handler tables for firmwares whose handler set never
+     *  changes. Tables live in flash (PROGMEM on AVR) and must be sorted by
+     *  ascending opcode; the core binary-searches them after the runtime
+     *  tables. They work with CRUMBS_MAX_HANDLERS=0, which removes the RAM
+     *  handler tables from the context entirely.
+     *  @{ */
+
+    /**
+     * @brief One entry of a static command handler table.
+     */
+    typedef struct
     {
-        uint8_t address;    /**< I2C address for peripheral role; 0 for controller. */
-        crumbs_role_t role; /**< Controller or peripheral. */
+        uint8_t opcode;       /**< Opcode handled by this entry. */
+        crumbs_handler_fn fn; /**< Handler function. */
+        void *user_data;      /**< Opaque pointer passed to @p fn. */
+    } crumbs_handler_entry_t;
 
-        uint32_t crc_error_count; /**< Number of CRC failures seen during decode. */
-        uint8_t last_crc_ok;      /**< Non-zero if the last decode had a valid CRC. */
+    /**
+     * @brief One entry of a static reply handler table.
+     */
+    typedef struct
+    {
+        uint8_t opcode;     /**< GET opcode answered by this entry. */
+        crumbs_reply_fn fn; /**< Reply builder function. */
+        void *user_data;    /**< Opaque pointer passed to @p fn. */
+    } crumbs_reply_entry_t;
 
-        crumbs_message_cb_t on_message; /**< Called when a message is received (peripheral). */
-        crumbs_request_cb_t on_request; /**< Called when the bus master requests a reply. */
-        void *user_data;                /**< Opaque pointer for user code (forwarded to callbacks). */
+/**
+ * @brief Declare a const command handler table in flash.
+ *
+ * Entries are brace-initialized crumbs_handler_entry_t values listed in
+ * ascending opcode order:
+ * @code
+ * CRUMBS_STATIC_HANDLERS(g_cmds,
+ *     { CALC_OP_ADD, handler_add, NULL },
+ *     { CALC_OP_SUB, handler_sub, NULL });
+ * crumbs_set_static_handlers(&ctx, g_cmds, CRUMBS_STATIC_TABLE_LEN(g_cmds));
+ * @endcode
+ */
+#define CRUMBS_STATIC_HANDLERS(name, ...) \
+    static const crumbs_handler_entry_t name[] CRUMBS_PROGMEM = {__VA_ARGS__}
 
-        /**
-         * @brief Target opcode set by SET_REPLY command (0xFE).
-         *
-         * When a controller sends SET_REPLY with a target opcode, the library
-         * stores it here. The user's on_request callback should switch on this
-         * value to determine which data to return.
-         *
-         * Initialized to 0. By convention, opcode 0 means "default reply"
-         * (recommended: return device/version info).
-         */
-        uint8_t requested_opcode;
+/**
+ * @brief Declare a const reply handler table in flash (see CRUMBS_STATIC_HANDLERS).
+ */
+#define CRUMBS_STATIC_REPLY_HANDLERS(name, ...) \
+    static const crumbs_reply_entry_t name[] CRUMBS_PROGMEM = {__VA_ARGS__}
 
-#if CRUMBS_MAX_HANDLERS > 0
-        /** @name Command Handler Dispatch Table
-         *  Per-opcode handler functions and associated user data.
-         *  Size controlled by CRUMBS_MAX_HANDLERS (default 16).
-         *  Uses linear search for dispatch (O(n) but portable/safe).
-         *  @{ */
-        uint8_t handler_count;                           /**< Number of registered handlers. */
-        uint8_t handler_opcode[CRUMBS_MAX_HANDLERS];     /**< Opcode for each handler slot. */
-        crumbs_handler_fn handlers[CRUMBS_MAX_HANDLERS]; /**< Handler functions. */
-        void *handler_userdata[CRUMBS_MAX_HANDLERS];     /**< User data for each handler. */
-                                                         /** @} */
+/** @brief Number of entries in a table declared with CRUMBS_STATIC_*HANDLERS. */
+#define CRUMBS_STATIC_TABLE_LEN(name) (sizeof(name) / sizeof((name)[0]))
+    /** @} */
 
-        /** @name Reply Handler Dispatch Table
-         *  Per-opcode reply-builder functions for peripheral GET ops.
-         *  Dispatched by crumbs_peripheral_build_reply() when ctx->requested_opcode
-         *  matches; on_request is called as fallback when no match is found.
-         *  Size controlled by CRUMBS_MAX_HANDLERS.
-         *  @{ */
-        uint8_t reply_handler_count;                              /**< Number of registered reply handlers. */
-        uint8_t reply_handler_opcode[CRUMBS_MAX_HANDLERS];        /**< Opcode for each reply handler slot. */
-        crumbs_reply_fn reply_handlers[CRUMBS_MAX_HANDLERS];      /**< Reply handler functions. */
-        void *reply_handler_userdata[CRUMBS_MAX_HANDLERS];        /**< User data for each reply handler. */
-                                                                  /** @} */
-#endif                                                   /* CRUMBS_MAX_HANDLERS > 0 */
-    };
+    /** @name Statistics
+     *  Filled when CRUMBS_ENABLE_STATS is set; the types always exist so a
+     *  controller can read a peripheral's statistics without enabling them
+     *  itself. Counters saturate instead of wrapping, except the 32-bit
+     *  frame counts. Histogram bucket i counts times below
+     *  base << i microseconds; the last bucket also takes everything slower.
+     *  @{ */
+
+    /** @brief Monotonic microsecond clock used for timings (e.g. micros()). */
+    typedef uint32_t (*crumbs_clock_us_fn)(void);
 
     /**
-     * @brief Bound device handle — groups all transport fields for a single
-     *        CRUMBS device on the bus.
-     *
-     * Pass a pointer to this struct to ops-header functions instead of the
-     * individual ctx / addr / write_fn / read_fn / delay_fn / io arguments.
-     * Populate once at startup (or after scan) and reuse for every call to
-     * that device.
-     *
-     * @note  read_fn and delay_fn are only required by GET operations (_get_*).
-     *        SET-only devices may leave them NULL.
+     * @brief Handler timing for one opcode.
      */
     typedef struct
     {
-        crumbs_context_t   *ctx;      /**< Shared controller context. */
-        uint8_t             addr;     /**< 7-bit I2C address of this device. */
-        crumbs_i2c_write_fn write_fn; /**< I2C write callback. */
-        crumbs_i2c_read_fn  read_fn;  /**< I2C read callback (NULL if no GET ops). */
+        uint8_t opcode;    /**< Command opcode. */
+        uint16_t calls;    /**< Handler runs. */
+        uint32_t max_us;   /**< Slowest run. */
+        uint32_t total_us; /**< Sum of run times (saturating), for the mean. */
+    } crumbs_opcode_stats_t;
+
+    /**
+     * @brief Traffic and timing counters of one context.
+     */
+    typedef struct
+    {
+        uint32_t frames_rx;                            /**< Valid frames received. */
+        uint32_t frames_tx;                            /**< Frames sent (controller) or replies built (peripheral). */
+        uint16_t err_short;                            /**< Frames shorter than a header or their data_len. */
+        uint16_t err_len;                              /**< Frames with data_len above CRUMBS_MAX_PAYLOAD. */
+        uint16_t err_crc;                              /**< Frames with a bad CRC. */
+        uint16_t unhandled;                            /**< Commands with no handler and no on_message. */
+        uint16_t handler_hist[CRUMBS_STATS_BUCKETS];   /**< Handler run times (base CRUMBS_STATS_HANDLER_BASE_US). */
+        uint16_t reply_hist[CRUMBS_STATS_BUCKETS];     /**< Reply build times (same buckets). */
+        uint32_t reply_max_us;                         /**< Slowest reply build. */
+        uint8_t reply_max_opcode;                      /**< Opcode of the slowest reply build. */
+        uint8_t opcode_count;                          /**< Entries in use in opcodes. */
+        crumbs_opcode_stats_t opcodes[CRUMBS_STATS_OPCODES]; /**< Per-opcode handler timings. */
+    } crumbs_stats_t;
+
+    /**
+     * @brief Controller transaction latency for one target address.
+     *
+     * A transaction runs from the start of a frame write to the address
+     * to the next valid, ready reply read from it.
+     */
+    typedef struct
+    {
+        uint8_t addr;                        /**< Target address. */
+        uint16_t hist[CRUMBS_STATS_BUCKETS]; /**< Latencies (base CRUMBS_STATS_LATENCY_BASE_US). */
+        uint32_t max_us;                     /**< Slowest transaction. */
+    } crumbs_addr_stats_t;
+    /** @} */
+
+    /** @name Trace Events
+     *  Hook points reported to the crumbs_trace_fn when CRUMBS_ENABLE_TRACE
+     *  is set. opcode and len are those of the frame at that point.
+     *  @{ */
+#define CRUMBS_TRACE_RX_START 1u       /**< Receive path entered (len = bytes received, 0 for a controller read). */
+#define CRUMBS_TRACE_DECODE_DONE 2u    /**< Frame validated (len = data_len). */
+#define CRUMBS_TRACE_DISPATCH_ENTER 3u /**< About to run on_message / the command handler. */
+#define CRUMBS_TRACE_DISPATCH_EXIT 4u  /**< on_message / the command handler returned. */
+#define CRUMBS_TRACE_REPLY_BUILT 5u    /**< Reply frame ready (len = frame bytes). */
+#define CRUMBS_TRACE_TX_START 6u       /**< Frame handed to the bus (len = frame bytes). */
+#define CRUMBS_TRACE_TX_DONE 7u        /**< Bus write returned. */
+#define CRUMBS_TRACE_REQUEST_START 8u  /**< HAL request callback entered (opcode = requested opcode). */
+#define CRUMBS_TRACE_RX_DONE 9u        /**< HAL receive callback returning (len = bytes received). */
+
+    /**
+     * @brief Trace hook, called inline on the hot path: keep it to a GPIO
+     *        toggle, a cycle-counter read or a ring store.
+     *
+     * @param event     CRUMBS_TRACE_* point.
+     * @param opcode    Frame opcode (0 when not known yet).
+     * @param len       Event-specific length (see the event list).
+     * @param timestamp Reading of the trace clock, 0 without one.
+     * @param user_data Pointer given to crumbs_set_trace_hook().
+     */
+    typedef void (*crumbs_trace_fn)(uint8_t event, uint8_t opcode, uint8_t len,
+                                    uint32_t timestamp, void *user_data);
+    /** @} */
+
+    /**
+     * @brief Command handler for the opcodes lo..hi (see crumbs_register_handler_range()).
+     */
+    typedef struct
+    {
+        uint8_t lo;           /**< First opcode. */
+        uint8_t hi;           /**< Last opcode (inclusive). */
+        crumbs_handler_fn fn; /**< Handler function. */
+        void *user_data;      /**< Opaque pointer passed to @p fn. */
+    } crumbs_handler_range_t;
+
+    /**
+     * @brief Reply handler for the opcodes lo..hi (see crumbs_register_reply_handler_range()).
+     */
+    typedef struct
+    {
+        uint8_t lo;         /**< First opcode. */
+        uint8_t hi;         /**< Last opcode (inclusive). */
+        crumbs_reply_fn fn; /**< Reply builder function. */
+        void *user_data;    /**< Opaque pointer passed to @p fn. */
+    } crumbs_reply_range_t;
+
+    /**
+     * @brief Peripheral section of crumbs_context_t: handler dispatch.
+     *
+     * Left out of the context when CRUMBS_CONTEXT_ROLE is
+     * CRUMBS_CONTEXT_CONTROLLER. Managed by the registration functions;
+     * not meant to be written directly.
+     */
+    typedef struct
+    {
+        /** @name Static Handler Tables
+         *  Flash-resident tables installed by crumbs_set_static_handlers()
+         *  and crumbs_set_static_reply_handlers(). Present regardless of
+         *  CRUMBS_MAX_HANDLERS.
+         *  @{ */
+        const crumbs_handler_entry_t *static_handlers;     /**< Sorted command table or NULL. */
+        const crumbs_reply_entry_t *static_reply_handlers; /**< Sorted reply table or NULL. */
+        uint8_t static_handler_count;                      /**< Entries in static_handlers. */
+        uint8_t static_reply_handler_count;                /**< Entries in static_reply_handlers. */
+                                                           /** @} */
+
+#if CRUMBS_MAX_HANDLER_RANGES > 0
+        /** @name Opcode Range Tables
+         *  Kept sorted by lo; ranges in one table never overlap. Present
+         *  regardless of CRUMBS_MAX_HANDLERS.
+         *  @{ */
+        uint8_t range_count;                                          /**< Entries in ranges. */
+        uint8_t reply_range_count;                                    /**< Entries in reply_ranges. */
+        uint8_t range_offset;                                         /**< opcode - lo of the handler running now. */
+        crumbs_handler_range_t ranges[CRUMBS_MAX_HANDLER_RANGES];     /**< Command ranges. */
+        crumbs_reply_range_t reply_ranges[CRUMBS_MAX_HANDLER_RANGES]; /**< Reply ranges. */
+                                                                      /** @} */
+#endif
+
+#if CRUMBS_MAX_HANDLERS > 0
+        /** @name Command Handler Dispatch Table
+         *  Per-opcode handler functions and associated user data.
+         *  Size controlled by CRUMBS_MAX_HANDLERS (default 16).
+         *  Lookup strategy selected by CRUMBS_DISPATCH.
+         *  @{ */
+        uint8_t handler_count;                           /**< Number of registered handlers. */
+        uint8_t handler_opcode[CRUMBS_MAX_HANDLERS];     /**< Opcode for each handler slot. */
+        crumbs_handler_fn handlers[CRUMBS_MAX_HANDLERS]; /**< Handler functions. */
+#if CRUMBS_HANDLER_USERDATA
+        void *handler_userdata[CRUMBS_MAX_HANDLERS];     /**< User data for each handler. */
+#endif
+                                                         /** @} */
+
+        /** @name Reply Handler Dispatch Table
+         *  Per-opcode reply-builder functions for peripheral GET ops.
+         *  Dispatched by crumbs_peripheral_build_reply() when ctx->requested_opcode
+         *  matches; on_request is called as fallback when no match is found.
+         *  Size controlled by CRUMBS_MAX_HANDLERS.
+         *  @{ */
+        uint8_t reply_handler_count;                              /**< Number of registered reply handlers. */
+        uint8_t reply_handler_opcode[CRUMBS_MAX_HANDLERS];        /**< Opcode for each reply handler slot. */
+        crumbs_reply_fn reply_handlers[CRUMBS_MAX_HANDLERS];      /**< Reply handler functions. */
+#if CRUMBS_HANDLER_USERDATA
+        void *reply_handler_userdata[CRUMBS_MAX_HANDLERS];        /**< User data for each reply handler. */
+#endif
+                                                                  /** @} */
+
+#if CRUMBS_DISPATCH == CRUMBS_DISPATCH_DIRECT
+        /** @name Direct Dispatch Index
+         *  Opcode-to-slot maps storing slot + 1 (0 = unused). Entries are
+         *  validated against the opcode arrays on lookup, so they need no
+         *  clearing in crumbs_init().
+         *  @{ */
+        uint8_t handler_index[256];       /**< Command handler slot + 1 per opcode. */
+        uint8_t reply_handler_index[256]; /**< Reply handler slot + 1 per opcode. */
+                                          /** @} */
+#endif
+#endif                                                   /* CRUMBS_MAX_HANDLERS > 0 */
+    } crumbs_peripheral_ctx_t;
+
+#if CRUMBS_ENABLE_STATS
+    /**
+     * @brief Controller section of crumbs_context_t: transaction latencies.
+     *
+     * Only exists with CRUMBS_ENABLE_STATS, and is left out of the context
+     * when CRUMBS_CONTEXT_ROLE is CRUMBS_CONTEXT_PERIPHERAL.
+     */
+    typedef struct
+    {
+        crumbs_addr_stats_t addr_stats[CRUMBS_STATS_ADDRS]; /**< Latency per address. */
+        uint32_t stats_tx_us;                               /**< Time of the last write. */
+        uint8_t stats_tx_addr;                              /**< Address of the last write. */
+        uint8_t stats_tx_open;                              /**< A write is waiting for its reply. */
+        uint8_t addr_stats_count;                           /**< Entries in use in addr_stats. */
+    } crumbs_controller_ctx_t;
+#endif
+
+    /**
+     * @brief State and configuration for a CRUMBS endpoint.
+     *
+     * This structure is plain-old-data so it is safe to allocate on the
+     * stack or in static storage across supported platforms. It is a
+     * common header followed by the role sections selected with
+     * CRUMBS_CONTEXT_ROLE.
+     */
+    struct crumbs_context_s
+    {
+        uint8_t address;    /**< I2C address for peripheral role; 0 for controller. */
+        crumbs_role_t role; /**< Controller or peripheral. */
+
+        uint32_t crc_error_count; /**< Number of CRC failures seen during decode. */
+        uint8_t last_crc_ok;      /**< Non-zero if the last decode had a valid CRC. */
+
+        crumbs_message_cb_t on_message; /**< Called when a message is received (peripheral). */
+        crumbs_request_cb_t on_request; /**< Called when the bus master requests a reply. */
+        void *user_data;                /**< Opaque pointer for user code (forwarded to callbacks). */
+
+        /**
+         * @brief Target opcode set by SET_REPLY command (0xFE).
+         *
+         * When a controller sends SET_REPLY with a target opcode, the library
+         * stores it here. The user's on_request callback should switch on this
+         * value to determine which data to return.
+         *
+         * Initialized to 0. By convention, opcode 0 means "default reply"
+         * (recommended: return device/version info).
+         */
+        uint8_t requested_opcode;
+
+        /** @brief Fastest bus clock this peripheral tolerates, in kHz (0 = not advertised). */
+        uint16_t max_bus_khz;
+
+        /** @name Transport
+         *  Set by crumbs_set_transport() or a HAL controller init; NULL
+         *  means callers pass the bus primitives themselves.
+         *  @{ */
+        const struct crumbs_transport_s *transport; /**< Link vtable (crumbs_transport.h). */
+        void *transport_io;                         /**< user_ctx for its primitives. */
+                                                    /** @} */
+
+#if CRUMBS_ENABLE_FRAGMENTS
+        /** @name Fragment Reassembly
+         *  Installed by crumbs_set_fragment_buffer(); frag_buf == NULL means
+         *  FRAGMENT frames are dispatched like any other opcode.
+         *  @{ */
+        uint8_t *frag_buf;               /**< Caller-provided reassembly buffer. */
+        crumbs_fragment_fn on_fragment;  /**< Completion callback. */
+        void *fragment_user_data;        /**< Passed to on_fragment. */
+        uint16_t frag_capacity;          /**< Size of frag_buf (clamped to CRUMBS_FRAGMENT_MAX_TRANSFER). */
+        uint16_t frag_len;               /**< Bytes reassembled so far. */
+        uint8_t frag_opcode;             /**< Target opcode of the current transfer. */
+        uint8_t frag_next;               /**< Next expected fragment index. */
+        uint8_t frag_count;              /**< Fragment count of the current transfer. */
+        uint8_t frag_state;              /**< CRUMBS_FRAG_* state. */
+        uint8_t frag_errors;             /**< Aborted transfers (saturating). */
+                                         /** @} */
+#endif
+
+#if CRUMBS_ENABLE_REPLY_CACHE
+        /** @name Pre-Built Reply Frames
+         *  Written by crumbs_peripheral_refresh_reply() and
+         *  crumbs_peripheral_publish_reply() into the back slot, then made
+         *  current by a single write of reply_front.
+         *  @{ */
+        uint8_t reply_frame[2][CRUMBS_MESSAGE_MAX_SIZE]; /**< Encoded frames. */
+        uint8_t reply_frame_len[2];                      /**< Bytes in each frame. */
+        uint8_t reply_frame_opcode[2];                   /**< requested_opcode each frame answers. */
+        volatile uint8_t reply_front;                    /**< Slot served to the bus, or CRUMBS_REPLY_NONE. */
+        volatile uint8_t reply_stale;                    /**< Set by crumbs_peripheral_invalidate_reply(). */
+                                                         /** @} */
+#endif
+
+#if CRUMBS_ENABLE_RX_QUEUE
+        /** @name Deferred Receive Ring
+         *  Single producer (the receive path) and single consumer
+         *  (crumbs_peripheral_process()). head and tail are free-running;
+         *  each is written by one side only.
+         *  @{ */
+        crumbs_message_t rxq[CRUMBS_RX_QUEUE_DEPTH]; /**< Validated frames waiting for dispatch. */
+        volatile uint8_t rxq_head;                   /**< Next slot to fill (receive path). */
+        volatile uint8_t rxq_tail;                   /**< Next slot to dispatch (process). */
+        uint8_t rxq_enabled;                         /**< Deferral switched on. */
+        uint8_t rxq_high_water;                      /**< Most frames ever queued at once. */
+        volatile uint16_t rxq_overflows;             /**< Frames dropped because the ring was full. */
+                                                     /** @} */
+#endif
+
+#if CRUMBS_ENABLE_STATS
+        /** @name Statistics
+         *  Updated by the core; read with crumbs_get_stats() and
+         *  crumbs_get_addr_stats(). Plain (non-atomic) updates.
+         *  @{ */
+        crumbs_stats_t stats;                               /**< Counters and histograms. */
+        crumbs_clock_us_fn stats_clock;                     /**< Timing source, NULL = counters only. */
+        uint8_t stats_page;                                 /**< Page selected for CRUMBS_CMD_STATS. */
+                                                            /** @} */
+#endif
+
+#if CRUMBS_ENABLE_TRACE
+        /** @name Trace Hook
+         *  Installed by crumbs_set_trace_hook(); trace_fn == NULL skips
+         *  every hook point with one branch.
+         *  @{ */
+        crumbs_trace_fn trace_fn;        /**< Hook, or NULL. */
+        crumbs_clock_us_fn trace_clock;  /**< Timestamp source, or NULL. */
+        void *trace_user;                /**< Passed to trace_fn. */
+                                         /** @} */
+#endif
+
+#if CRUMBS_ENABLE_BROADCAST
+        /** @name Broadcast Reception
+         *  Set by crumbs_peripheral_set_broadcast().
+         *  @{ */
+        uint8_t broadcast_rx;     /**< CRUMBS_CMD_BROADCAST frames are unwrapped. */
+        uint8_t broadcast_type;   /**< Accepted broadcast type_id, 0 = any. */
+        uint8_t in_broadcast;     /**< Set while a broadcast is being dispatched. */
+                                  /** @} */
+#endif
+
+#if CRUMBS_ENABLE_STAGING
+        /** @name Staged Commands
+         *  Frames for latched opcodes wait here until CRUMBS_CMD_COMMIT.
+         *  Managed by crumbs_stage.c.
+         *  @{ */
+        crumbs_message_t stage[CRUMBS_STAGE_DEPTH]; /**< Staged frames, in arrival order. */
+        uint8_t stage_latched[32];                  /**< Bitmap of latched opcodes. */
+        uint8_t stage_count;                        /**< Frames in stage[]. */
+        uint8_t stage_group;                        /**< Commit group of this device, 0 = any. */
+        uint8_t stage_overflow;                     /**< A frame was dropped since the last commit. */
+        uint8_t in_commit;                          /**< Set while staged frames are applied. */
+                                                    /** @} */
+#endif
+
+#if CRUMBS_ENABLE_REGISTERS
+        /** @name Register File
+         *  Installed by crumbs_set_register_file(); reg_base == NULL means
+         *  REG_READ frames are dispatched like any other opcode.
+         *  @{ */
+        const uint8_t *reg_base; /**< Exposed region, owned by the caller. */
+        uint16_t reg_size;       /**< Bytes in the region. */
+        uint16_t reg_offset;     /**< Start selected by the last REG_READ. */
+        uint8_t reg_count;       /**< Length selected by the last REG_READ. */
+                                 /** @} */
+#endif
+
+#if CRUMBS_ENABLE_BULK
+        /** @name Bulk Query
+         *  Set by a SET_REPLY whose first byte is CRUMBS_CMD_BULK_GET.
+         *  @{ */
+        uint8_t bulk_ops[CRUMBS_BULK_MAX_OPS]; /**< Opcodes to answer, in order. */
+        uint8_t bulk_count;                    /**< Entries in bulk_ops. */
+        uint8_t bulk_next;                     /**< First entry of the next reply frame. */
+                                               /** @} */
+#endif
+
+#if CRUMBS_ENABLE_REPLY_CURSOR
+        /** @name Reply Cursor
+         *  Set by SET_REPLY [opcode][mode][count]; cursor_mode 0 = off.
+         *  @{ */
+        uint8_t cursor_mode;  /**< CRUMBS_CURSOR_* of the current cursor. */
+        uint8_t cursor_first; /**< Opcode given with SET_REPLY. */
+        uint8_t cursor_count; /**< Steps before wrapping (0 = 256). */
+        uint8_t cursor_index; /**< Replies delivered since SET_REPLY, modulo count. */
+                              /** @} */
+#endif
+
+#if CRUMBS_ENABLE_CHANGE_SEQ
+        /** @name Change Sequence
+         *  change_seq is bumped by crumbs_mark_changed(); the rest is set by
+         *  CRUMBS_CMD_IF_CHANGED and cleared by SET_REPLY.
+         *  @{ */
+        uint16_t change_seq; /**< Current state sequence, never 0. */
+        uint16_t cond_seen;  /**< Sequence the controller already has. */
+        uint8_t cond_opcode; /**< Opcode selected by IF_CHANGED. */
+        uint8_t cond_active; /**< Non-zero while that selection is in force. */
+                             /** @} */
+#endif
+
+#if CRUMBS_ENABLE_SEQUENCED
+        /** @name Sequenced Commands
+         *  Session state of CRUMBS_CMD_SEQUENCED (crumbs_seq.h).
+         *  @{ */
+        uint8_t seq_active;      /**< A session was started (seq 0 seen). */
+        uint8_t seq_last;        /**< Last applied sequence (1-255). */
+        uint16_t seq_applied;    /**< Commands applied this session. */
+        uint16_t seq_duplicates; /**< Repeats dropped. */
+        uint16_t seq_rejected;   /**< Dropped after a missed sequence, or outside a session. */
+                                 /** @} */
+#endif
+
+#if CRUMBS_ENABLE_RESULT
+        /** @name Command Result
+         *  Written after each dispatched command; result_armed is cleared by
+         *  the read request that delivers it (however few bytes the
+         *  controller clocks out) and by SET_REPLY.
+         *  @{ */
+        uint8_t result_opcode; /**< Opcode of the last command. */
+        uint8_t result_status; /**< Its status (CRUMBS_RESULT_*). */
+        uint8_t result_count;  /**< Commands recorded, wrapping. */
+        uint8_t result_armed;  /**< The next read returns the result. */
+        uint8_t result_set;    /**< The handler called crumbs_set_result(). */
+                               /** @} */
+#endif
+
+#if CRUMBS_ENABLE_ATTENTION
+        /** @name Attention Line
+         *  Set by crumbs_raise_attention(); cleared by the alert response,
+         *  the next delivered reply or crumbs_clear_attention().
+         *  @{ */
+        crumbs_attention_fn attention_fn; /**< Line driver (NULL = none). */
+        void *attention_user;             /**< Passed to attention_fn. */
+        uint8_t attention_pending;        /**< Line is asserted. */
+                                          /** @} */
+#endif
+
+#if CRUMBS_CONTEXT_ROLE != CRUMBS_CONTEXT_CONTROLLER
+        crumbs_peripheral_ctx_t periph; /**< Handler dispatch (peripheral role). */
+#endif
+#if CRUMBS_ENABLE_STATS && CRUMBS_CONTEXT_ROLE != CRUMBS_CONTEXT_PERIPHERAL
+        crumbs_controller_ctx_t ctrl; /**< Transaction latencies (controller role). */
+#endif
+    };
+
+    /**
+     * @brief Report a trace event on @p ctx (nothing without CRUMBS_ENABLE_TRACE).
+     *
+     * Used by the core and the HALs at the CRUMBS_TRACE_* points.
+     */
+#if CRUMBS_ENABLE_TRACE
+#define CRUMBS_TRACE(ctx, event, opcode, len)                                               \
+    do                                                                                      \
+    {                                                                                       \
+        if ((ctx)->trace_fn)                                                                \
+        {                                                                                   \
+            (ctx)->trace_fn((uint8_t)(event), (uint8_t)(opcode), (uint8_t)(len),            \
+                            (ctx)->trace_clock ? (ctx)->trace_clock() : 0u, (ctx)->trace_user); \
+        }                                                                                   \
+    } while (0)
+#else
+#define CRUMBS_TRACE(ctx, event, opcode, len) ((void)0)
+#endif
+
+    /**
+     * @brief Bound device handle — groups all transport fields for a single
+     *        CRUMBS device on the bus.
+     *
+     * Pass a pointer to this struct to ops-header functions instead of the
+     * individual ctx / addr / write_fn / read_fn / delay_fn / io arguments.
+     * Populate once at startup (or after scan) and reuse for every call to
+     * that device.
+     *
+     * @note  read_fn and delay_fn are only required by GET operations (_get_*).
+     *        SET-only devices may leave them NULL.
+     * @note  latency and transport are optional; NULL means a fixed
+     *        CRUMBS_DEFAULT_QUERY_DELAY_US and no combined transfers. Fill
+     *        handles with crumbs_device_bind() (or designated
+     *        initializers) so fields added later start zeroed: positional
+     *        initializers that stop at io warn under -Wextra.
+     */
+    typedef struct
+    {
+        crumbs_context_t   *ctx;      /**< Shared controller context. */
+        uint8_t             addr;     /**< 7-bit I2C address of this device. */
+        crumbs_i2c_write_fn write_fn; /**< I2C write callback. */
+        crumbs_i2c_read_fn  read_fn;  /**< I2C read callback (NULL if no GET ops). */
         crumbs_delay_fn     delay_fn; /**< Microsecond delay callback (NULL if no GET ops). */
         void               *io;       /**< Platform I/O context (Wire*, linux handle, etc.). */
+        struct crumbs_latency_s *latency; /**< Reply-delay estimator (crumbs_latency.h), or NULL. */
+        const struct crumbs_transport_s *transport; /**< Link write_fn/read_fn came from (crumbs_transport.h), or NULL. */
     } crumbs_device_t;
 
+    /**
+     * @brief Fill @p dev with the given transport fields and zero the rest.
+     *
+     * @return 0 on success, -1 if @p dev or @p ctx is NULL.
+     */
+    int crumbs_device_bind(crumbs_device_t *dev,
+                           crumbs_context_t *ctx,
+                           uint8_t addr,
+                           crumbs_i2c_write_fn write_fn,
+                           crumbs_i2c_read_fn read_fn,
+                           crumbs_delay_fn delay_fn,
+                           void *io);
+
     /**
      * @brief Initialize a CRUMBS context.
      *
@@ -281,6 +1251,19 @@ extern "C"
      */
     size_t crumbs_context_size(void);
 
+    /**
+     * @brief Bytes the configured role sections and options leave out.
+     *
+     * Counts what CRUMBS_CONTEXT_ROLE and CRUMBS_HANDLER_USERDATA=0 remove
+     * compared with a CRUMBS_CONTEXT_BOTH context with per-handler user
+     * data and the same other options (struct padding not counted), so
+     * crumbs_context_size() + crumbs_context_saved_bytes() is about the
+     * size of the full context.
+     *
+     * @return Saved bytes, 0 for the default configuration.
+     */
+    size_t crumbs_context_saved_bytes(void);
+
     /** @name Command Handler Registration
      *  Register/unregister per-command handlers for dispatch-based processing.
      *  Maximum handlers controlled by CRUMBS_MAX_HANDLERS (default 16).
@@ -338,8 +1321,122 @@ extern "C"
                                       crumbs_reply_fn fn,
                                       void *user_data);
 
+    /**
+     * @brief Install a static (flash-resident) command handler table.
+     *
+     * The table must be sorted by strictly ascending opcode. Runtime
+     * handlers registered with crumbs_register_handler() take precedence
+     * for the same opcode. Pass NULL / 0 to remove the table.
+     *
+     * @param ctx   Context to install the table on.
+     * @param table Table declared with CRUMBS_STATIC_HANDLERS().
+     * @param count Number of entries (CRUMBS_STATIC_TABLE_LEN()).
+     * @return 0 on success, -1 if ctx is NULL, the table is unsorted or has
+     *         more than 255 entries.
+     */
+    int crumbs_set_static_handlers(crumbs_context_t *ctx,
+                                   const crumbs_handler_entry_t *table,
+                                   size_t count);
+
+    /**
+     * @brief Install a static (flash-resident) reply handler table.
+     *
+     * Same rules as crumbs_set_static_handlers(). Runtime reply handlers take
+     * precedence; on_request remains the fallback when neither matches.
+     *
+     * @return 0 on success, -1 if ctx is NULL, the table is unsorted or has
+     *         more than 255 entries.
+     */
+    int crumbs_set_static_reply_handlers(crumbs_context_t *ctx,
+                                         const crumbs_reply_entry_t *table,
+                                         size_t count);
+
+    /**
+     * @brief Register one command handler for every opcode from @p lo to @p hi.
+     *
+     * Used when no exact runtime or static entry matches, so single
+     * opcodes inside the range can still get their own handler. The
+     * handler gets the full opcode; crumbs_handler_offset() returns
+     * opcode - lo. Registering the same lo..hi again replaces the entry,
+     * fn = NULL removes it. 0..255 is a wildcard. Command ranges never see
+     * SET_REPLY or the active protocol extensions, which the core takes
+     * first. The range keeps user_data even with CRUMBS_HANDLER_USERDATA=0.
+     *
+     * @return 0 on success, -1 if ctx is NULL, lo > hi, the range overlaps
+     *         another one, the table is full or ranges are compiled out.
+     */
+    int crumbs_register_handler_range(crumbs_context_t *ctx,
+                                      uint8_t lo,
+                                      uint8_t hi,
+                                      crumbs_handler_fn fn,
+                                      void *user_data);
+
+    /**
+     * @brief Register one reply handler for every GET opcode from @p lo to @p hi.
+     *
+     * Same rules as crumbs_register_handler_range(). Tried after the exact
+     * reply handlers and the extension replies, before on_request. The
+     * handler reads ctx->requested_opcode or crumbs_handler_offset().
+     *
+     * @return 0 on success, -1 as for crumbs_register_handler_range().
+     */
+    int crumbs_register_reply_handler_range(crumbs_context_t *ctx,
+                                            uint8_t lo,
+                                            uint8_t hi,
+                                            crumbs_reply_fn fn,
+                                            void *user_data);
+
+    /**
+     * @brief Position of the current opcode in its range (opcode - lo).
+     *
+     * Valid inside a handler; 0 for handlers registered for one opcode.
+     */
+    uint8_t crumbs_handler_offset(const crumbs_context_t *ctx);
+
+    /** @} */
+
+    /**
+     * @brief Validated, non-owning view of a CRUMBS frame.
+     *
+     * Produced by crumbs_decode_view(). @p data points into the buffer that
+     * was decoded, so the view is only valid while that buffer is.
+     */
+    typedef struct
+    {
+        uint8_t type_id;     /**< Device type identifier. */
+        uint8_t opcode;      /**< Command / reply opcode. */
+        uint8_t data_len;    /**< Payload length (0-27). */
+        uint8_t crc8;        /**< Received CRC-8 (already verified). */
+        const uint8_t *data; /**< Payload bytes inside the source buffer. */
+    } crumbs_frame_view_t;
+
+    /** @name Streaming Receive Status
+     *  Values returned by crumbs_rx_feed_byte() and held in crumbs_rx_t::status.
+     *  @{ */
+#define CRUMBS_RX_PENDING 0   /**< Frame incomplete; keep feeding bytes. */
+#define CRUMBS_RX_COMPLETE 1  /**< Full frame received and CRC verified. */
+#define CRUMBS_RX_E_FRAME -1  /**< data_len > CRUMBS_MAX_PAYLOAD. */
+#define CRUMBS_RX_E_CRC -2    /**< CRC byte did not match. */
     /** @} */
 
+    /**
+     * @brief Streaming frame decoder for HALs that receive byte by byte.
+     *
+     * The CRC is folded in as each byte is fed, so the frame is accepted or
+     * rejected the moment its last byte arrives and nothing walks the buffer
+     * again. Bytes after a complete frame are ignored, like trailing bytes
+     * passed to crumbs_decode_message(). Errors are sticky until
+     * crumbs_rx_reset().
+     */
+    typedef struct
+    {
+        uint8_t buf[CRUMBS_MESSAGE_MAX_SIZE]; /**< Bytes received so far. */
+        uint8_t len;                          /**< Number of bytes in buf. */
+        uint8_t expected;                     /**< Full frame length once data_len is known, else 0. */
+        crumbs_crc8_t crc;                    /**< Running CRC over header + payload. */
+        int8_t status;                        /**< CRUMBS_RX_* status. */
+    } crumbs_rx_t;
+
     /**
      * @brief Encode a message into the CRUMBS wire frame.
      *
@@ -354,6 +1451,24 @@ extern "C"
                                  uint8_t *buffer,
                                  size_t buffer_len);
 
+    /**
+     * @brief Encode several messages into fixed-stride frame slots.
+     *
+     * Fills frames[i] and frame_lens[i] for each message, ready to hand to
+     * a bulk transfer such as crumbs_linux_transfer_batch(). Each slot is
+     * an independent frame; this does not build a CRUMBS_CMD_BATCH frame.
+     *
+     * @param msgs       Messages to encode.
+     * @param count      Number of messages.
+     * @param frames     One CRUMBS_MESSAGE_MAX_SIZE slot per message.
+     * @param frame_lens Receives each frame's length (4 + data_len).
+     * @return Number of messages encoded; stops at the first invalid one.
+     */
+    size_t crumbs_encode_frames(const crumbs_message_t *msgs,
+                                size_t count,
+                                uint8_t (*frames)[CRUMBS_MESSAGE_MAX_SIZE],
+                                size_t *frame_lens);
+
     /**
      * @brief Decode a CRUMBS frame into a message object.
      *
@@ -370,6 +1485,48 @@ extern "C"
                               crumbs_message_t *msg,
                               crumbs_context_t *ctx);
 
+    /**
+     * @brief Validate a CRUMBS frame in place without copying the payload.
+     *
+     * Same checks and CRC statistics as crumbs_decode_message(), but the
+     * payload is referenced rather than copied.
+     *
+     * @param buffer Input buffer containing a serialized frame.
+     * @param buffer_len Length in bytes of @p buffer (must be >= 4 + data_len).
+     * @param view Output view (must not be NULL); view->data aliases @p buffer.
+     * @param ctx Optional context updated with CRC stats (may be NULL).
+     * @return 0 on success, -1 if buffer too small or invalid, -2 on CRC mismatch.
+     */
+    int crumbs_decode_view(const uint8_t *buffer,
+                           size_t buffer_len,
+                           crumbs_frame_view_t *view,
+                           crumbs_context_t *ctx);
+
+    /**
+     * @brief Reset a streaming decoder for the next frame.
+     *
+     * @param rx Decoder state (must not be NULL).
+     */
+    void crumbs_rx_reset(crumbs_rx_t *rx);
+
+    /**
+     * @brief Feed one received byte into a streaming decoder.
+     *
+     * @param rx Decoder state, reset with crumbs_rx_reset() before each frame.
+     * @param byte Next byte from the bus.
+     * @return CRUMBS_RX_PENDING, CRUMBS_RX_COMPLETE, CRUMBS_RX_E_FRAME or CRUMBS_RX_E_CRC.
+     */
+    int crumbs_rx_feed_byte(crumbs_rx_t *rx, uint8_t byte);
+
+    /**
+     * @brief Describe a completed streaming frame without copying.
+     *
+     * @param rx Decoder state.
+     * @param view Output view; view->data aliases rx->buf.
+     * @return 0 if the frame is complete, -1 if incomplete or bad, -2 on CRC mismatch.
+     */
+    int crumbs_rx_view(const crumbs_rx_t *rx, crumbs_frame_view_t *view);
+
     /**
      * @brief Send a CRUMBS message to a 7-bit I2C target (controller helper).
      *
@@ -387,10 +1544,29 @@ extern "C"
                                void *write_ctx);
 
     /**
-     * @brief Read and decode a CRUMBS reply frame from a peripheral (controller helper).
+     * @brief Finish a frame builder and send it without re-encoding.
      *
-     * Symmetric counterpart to crumbs_controller_send(). Reads raw bytes via
-     * @p read_fn, then decodes them with crumbs_decode_message(). Passes
+     * Equivalent to crumbs_controller_send() for a message holding the same
+     * bytes, but the builder's buffer is handed to @p write_fn directly.
+     *
+     * @param ctx Initialized CRUMBS context in controller mode.
+     * @param target_addr 7-bit I2C address of the peripheral.
+     * @param fb Frame builder (finished by this call).
+     * @param write_fn I2C write function (crumbs_i2c_write_fn).
+     * @param write_ctx Opaque pointer passed to @p write_fn.
+     * @return 0 on success, -1 on bad args, -2 if not controller, else write_fn error.
+     */
+    int crumbs_controller_send_frame(const crumbs_context_t *ctx,
+                                     uint8_t target_addr,
+                                     crumbs_frame_builder_t *fb,
+                                     crumbs_i2c_write_fn write_fn,
+                                     void *write_ctx);
+
+    /**
+     * @brief Read and decode a CRUMBS reply frame from a peripheral (controller helper).
+     *
+     * Symmetric counterpart to crumbs_controller_send(). Reads raw bytes via
+     * @p read_fn, then decodes them with crumbs_decode_message(). Passes
      * timeout_us=0 to @p read_fn so the HAL uses its own default; call
      * delay_fn() before this to give the peripheral time to stage its reply
      * after a SET_REPLY write.
@@ -408,6 +1584,103 @@ extern "C"
                                crumbs_i2c_read_fn read_fn,
                                void *read_ctx);
 
+    /**
+     * @brief crumbs_controller_read() that only clocks in 4 + @p max_payload bytes.
+     *
+     * For replies whose payload size is known, e.g. a 1-byte status reply is
+     * a 5-byte read instead of 31. A reply longer than @p max_payload is
+     * truncated and rejected (-1).
+     *
+     * @param max_payload Largest payload expected (clamped to CRUMBS_MAX_PAYLOAD).
+     * @return As crumbs_controller_read().
+     */
+    int crumbs_controller_read_len(crumbs_context_t *ctx,
+                                   uint8_t target_addr,
+                                   crumbs_message_t *out_msg,
+                                   crumbs_i2c_read_fn read_fn,
+                                   void *read_ctx,
+                                   uint8_t max_payload);
+
+    /**
+     * @brief Read a reply of unknown length in two short reads.
+     *
+     * Reads the 3-byte header, then re-reads exactly 4 + data_len bytes.
+     * Peripherals rebuild the reply for every read request, so the second
+     * read starts at the frame's first byte again. Cheaper than a full
+     * 31-byte read whenever the payload is shorter than about 24 bytes.
+     *
+     * @warning Not for stateful replies. The header read counts as a read
+     *          request, so a reply cursor moves on and an unasked
+     *          CRUMBS_CMD_RESULT is used up before the second read. A
+     *          frame whose header differs from the peeked one is rejected;
+     *          index-cursor pages of equal length cannot be told apart.
+     *          Use crumbs_controller_read() with cursors and
+     *          crumbs_controller_get_result() for a lost result.
+     *
+     * @return As crumbs_controller_read(); -1 also if the reply changed
+     *         between the two reads.
+     */
+    int crumbs_controller_read_two_phase(crumbs_context_t *ctx,
+                                         uint8_t target_addr,
+                                         crumbs_message_t *out_msg,
+                                         crumbs_i2c_read_fn read_fn,
+                                         void *read_ctx);
+
+    /**
+     * @brief Read a reply, re-reading while the peripheral answers NOT_READY.
+     *
+     * For peripherals whose reply handlers call crumbs_reply_not_ready()
+     * until their data is staged: instead of sleeping a worst-case delay
+     * after SET_REPLY, read right away and retry every @p interval_us.
+     * Any other reply or error is returned as crumbs_controller_read()
+     * would.
+     *
+     * @param ctx         Initialized CRUMBS context in controller mode.
+     * @param target_addr 7-bit I2C address of the peripheral.
+     * @param out_msg     Output message struct (must not be NULL).
+     * @param read_fn     I2C read function.
+     * @param read_ctx    Opaque pointer passed to @p read_fn.
+     * @param delay_fn    Delay between NOT_READY reads (must not be NULL).
+     * @param interval_us Delay between reads (0 = CRUMBS_READY_POLL_INTERVAL_US).
+     * @param timeout_us  Total NOT_READY polling allowed before giving up.
+     * @return 0 on success, -3 if still NOT_READY at @p timeout_us, else as
+     *         crumbs_controller_read().
+     */
+    int crumbs_controller_read_ready(crumbs_context_t *ctx,
+                                     uint8_t target_addr,
+                                     crumbs_message_t *out_msg,
+                                     crumbs_i2c_read_fn read_fn,
+                                     void *read_ctx,
+                                     crumbs_delay_fn delay_fn,
+                                     uint32_t interval_us,
+                                     uint32_t timeout_us);
+
+    /**
+     * @brief SET_REPLY and read the reply in one repeated-START transaction.
+     *
+     * Writes SET_REPLY(@p opcode) and reads the reply frame through
+     * @p write_read_fn with require_repeated_start set, so the GET costs a
+     * single bus transaction (one I2C_RDWR ioctl on Linux) and no delay.
+     * Only suitable for peripherals that have the reply ready as soon as
+     * the SET_REPLY write lands (static or double-buffered replies).
+     *
+     * @param ctx           Initialized CRUMBS context in controller mode.
+     * @param target_addr   7-bit I2C address of the peripheral.
+     * @param opcode        Opcode to request with SET_REPLY.
+     * @param out_msg       Output message struct (must not be NULL).
+     * @param write_read_fn Combined transfer primitive (e.g. crumbs_linux_write_then_read).
+     * @param io            Opaque pointer passed to @p write_read_fn.
+     * @return 0 on success, -1 on bad args or a failed/short transfer,
+     *         -2 on CRC mismatch, CRUMBS_I2C_DEV_E_NO_REPEATED_START if the
+     *         transport cannot combine the phases.
+     */
+    int crumbs_controller_query(crumbs_context_t *ctx,
+                                uint8_t target_addr,
+                                uint8_t opcode,
+                                crumbs_message_t *out_msg,
+                                crumbs_i2c_write_read_fn write_read_fn,
+                                void *io);
+
     /**
      * @brief Probe an I2C address range for CRUMBS-capable devices.
      *
@@ -508,6 +1781,46 @@ extern "C"
                                                      size_t max_found,
                                                      uint32_t timeout_us);
 
+    /**
+     * @brief Fast CRUMBS scan: address-ACK prefilter, then probe only ACKing addresses.
+     *
+     * Runs @p scan_fn in its address-only mode (strict = 0) over the range,
+     * which costs one address byte per empty address instead of a timed-out
+     * 31-byte read. Only addresses that ACK are probed for a CRUMBS frame:
+     * with @p write_read_fn, by SET_REPLY(0x00) and read in one
+     * repeated-START transaction; otherwise (or if that fails) exactly as
+     * crumbs_controller_scan_for_crumbs_with_types() would.
+     *
+     * @param ctx           Controller context (required for non-strict probe writes).
+     * @param start_addr    Address range start (inclusive).
+     * @param end_addr      Address range end (inclusive).
+     * @param strict        Passed to the fallback probe (see _with_types).
+     * @param scan_fn       Address-ACK scanner (e.g. crumbs_linux_scan, crumbs_arduino_scan).
+     * @param write_fn      Write function for fallback probe writes (may be NULL).
+     * @param read_fn       Read function for the fallback probe (may be NULL
+     *                      when @p write_read_fn is given).
+     * @param write_read_fn Combined transfer for the single-transaction probe (may be NULL).
+     * @param io_ctx        Opaque I/O context forwarded to all callbacks.
+     * @param found         Output buffer to receive discovered addresses.
+     * @param types         Output buffer for type_id values (parallel to @p found), may be NULL.
+     * @param max_found     Capacity of @p found (and @p types when provided).
+     * @param timeout_us    Read timeout hint in microseconds.
+     * @return Number of discovered devices (>=0) or negative on error.
+     */
+    int crumbs_controller_scan_for_crumbs_fast(const crumbs_context_t *ctx,
+                                               uint8_t start_addr,
+                                               uint8_t end_addr,
+                                               int strict,
+                                               crumbs_i2c_scan_fn scan_fn,
+                                               crumbs_i2c_write_fn write_fn,
+                                               crumbs_i2c_read_fn read_fn,
+                                               crumbs_i2c_write_read_fn write_read_fn,
+                                               void *io_ctx,
+                                               uint8_t *found,
+                                               uint8_t *types,
+                                               size_t max_found,
+                                               uint32_t timeout_us);
+
     /** @name Raw I2C helper error codes
      *  Return codes used by crumbs_i2c_dev_* helpers.
      *  @{ */
@@ -628,21 +1941,80 @@ extern "C"
      * @param ctx Active CRUMBS context (peripheral role).
      * @param buffer Raw bytes received.
      * @param len Number of bytes in @p buffer.
-     * @return 0 on success, negative on decode error.
+     * @return 0 on success, -3 if deferred dispatch is on and the receive
+     *         ring is full (frame dropped), other negative values on decode error.
      */
     int crumbs_peripheral_handle_receive(crumbs_context_t *ctx,
                                          const uint8_t *buffer,
                                          size_t len);
 
+    /**
+     * @brief Dispatch a frame collected by a streaming decoder.
+     *
+     * Counterpart to crumbs_peripheral_handle_receive() for HALs that feed
+     * bytes through crumbs_rx_feed_byte(). The CRC was already checked while
+     * bytes arrived; this only updates the CRC statistics and dispatches.
+     *
+     * @param ctx Active CRUMBS context (peripheral role).
+     * @param rx Decoder that has received a whole frame.
+     * @return 0 on success, -1 on bad args or incomplete/invalid frame, -2 on
+     *         CRC mismatch, -3 if the receive ring is full (frame dropped).
+     */
+    int crumbs_peripheral_handle_rx(crumbs_context_t *ctx, const crumbs_rx_t *rx);
+
+    /** @name Deferred Dispatch
+     *  Require CRUMBS_ENABLE_RX_QUEUE. While enabled, the receive path only
+     *  validates a frame and copies it into a lock-free ring; handlers and
+     *  on_message run later from crumbs_peripheral_process(). SET_REPLY is
+     *  still applied immediately so the next read gets the right reply.
+     *  @{ */
+
+    /**
+     * @brief Receive ring counters.
+     */
+    typedef struct
+    {
+        uint8_t pending;     /**< Frames waiting for crumbs_peripheral_process(). */
+        uint8_t high_water;  /**< Most frames ever queued at once. */
+        uint16_t overflows;  /**< Frames dropped because the ring was full. */
+    } crumbs_rx_queue_stats_t;
+
+    /**
+     * @brief Switch deferred dispatch on or off.
+     *
+     * Frames already queued stay queued until the next crumbs_peripheral_process().
+     *
+     * @return 0 on success, -1 on bad args or when compiled out.
+     */
+    int crumbs_set_deferred_dispatch(crumbs_context_t *ctx, int enable);
+
+    /**
+     * @brief Dispatch every queued frame. Call from loop().
+     *
+     * @return Number of frames dispatched, or -1 on bad args or when compiled out.
+     */
+    int crumbs_peripheral_process(crumbs_context_t *ctx);
+
+    /**
+     * @brief Read the receive ring counters.
+     *
+     * @return 0 on success, -1 on bad args or when compiled out.
+     */
+    int crumbs_get_rx_queue_stats(const crumbs_context_t *ctx, crumbs_rx_queue_stats_t *out);
+    /** @} */
+
     /**
      * @brief Build an encoded reply frame for use inside an I2C request handler.
      *
      * Dispatches in order:
-     * 1. Per-opcode reply handler table (crumbs_register_reply_handler) for
-     *    ctx->requested_opcode — preferred for family peripherals.
-     * 2. on_request callback — called when no matching reply handler is found
+     * 1. Per-opcode reply handler tables for ctx->requested_opcode — runtime
+     *    (crumbs_register_reply_handler), then static
+     *    (crumbs_set_static_reply_handlers). Preferred for family peripherals.
+     * 2. Extension opcodes the core answers itself (CRUMBS_CMD_CAPABILITIES,
+     *    and CRUMBS_CMD_FRAGMENT status while a fragment buffer is set).
+     * 3. on_request callback — called when no matching reply handler is found
      *    (backward-compatible with existing code).
-     * 3. No reply configured — returns success with *out_len set to 0.
+     * 4. No reply configured — returns success with *out_len set to 0.
      *
      * @param ctx Active CRUMBS context (peripheral role).
      * @param out_buf Buffer to receive encoded frame.
@@ -655,6 +2027,682 @@ extern "C"
                                       size_t out_buf_len,
                                       size_t *out_len);
 
+    /** @name Pre-Built Replies
+     *  Require CRUMBS_ENABLE_REPLY_CACHE. While a frame for the current
+     *  ctx->requested_opcode is ready, crumbs_peripheral_build_reply() copies
+     *  it instead of running handlers and encoding; otherwise it builds the
+     *  reply as usual.
+     *  @{ */
+
+    /** @brief reply_front value while no frame is ready. */
+#define CRUMBS_REPLY_NONE 0xFFu
+
+    /**
+     * @brief Rebuild the ready frame if it is missing, stale or answers another opcode.
+     *
+     * Call from loop(). Runs the same dispatch as crumbs_peripheral_build_reply()
+     * outside the request handler and swaps the result in. NOT_READY replies
+     * and opcodes with no reply are not cached.
+     *
+     * @return 1 if a frame was rebuilt, 0 if already current (or nothing to
+     *         cache), -1 on bad args or when compiled out, -2 if encoding failed.
+     */
+    int crumbs_peripheral_refresh_reply(crumbs_context_t *ctx);
+
+    /**
+     * @brief Encode @p msg and make it the ready frame for opcode msg->opcode.
+     *
+     * For peripherals that push fresh data themselves (for example after
+     * each sensor sample) instead of answering from handlers.
+     *
+     * @return 0 on success, -1 on bad args or when compiled out, -2 if encoding failed.
+     */
+    int crumbs_peripheral_publish_reply(crumbs_context_t *ctx, const crumbs_message_t *msg);
+
+    /**
+     * @brief Mark the ready frame out of date; the next refresh rebuilds it.
+     *
+     * Until then the request handler builds replies live.
+     */
+    void crumbs_peripheral_invalidate_reply(crumbs_context_t *ctx);
+
+    /**
+     * @brief Ready frame for the current requested_opcode, for zero-copy request handlers.
+     *
+     * @param ctx   Peripheral context.
+     * @param frame Set to the encoded frame (valid until the next refresh/publish).
+     * @param len   Set to its length.
+     * @return 1 if a frame is ready, 0 otherwise (build the reply instead).
+     */
+    int crumbs_peripheral_ready_reply(const crumbs_context_t *ctx, const uint8_t **frame, size_t *len);
+    /** @} */
+
+    /**
+     * @brief Turn @p reply into a NOT_READY marker (4-byte frame, no payload).
+     *
+     * Call from a reply handler or on_request while the requested data is
+     * still being prepared (conversion in flight, history being computed).
+     * Controllers using crumbs_controller_read_ready() then retry shortly
+     * instead of sleeping a worst-case delay, and never mistake the empty
+     * reply for data. requested_opcode is unchanged, so the next read asks
+     * the handler again.
+     *
+     * @param reply Message passed to the reply handler.
+     */
+    void crumbs_reply_not_ready(crumbs_message_t *reply);
+
+    /** @name Capabilities
+     *  Feature discovery through CRUMBS_CMD_CAPABILITIES. The core answers
+     *  it itself unless a reply handler is registered for 0xFD. Reply
+     *  payload: [caps:u32][frag_capacity:u16][max_bus_khz:u16], little-endian;
+     *  newer library versions may append fields, readers must ignore extra bytes.
+     *  @{ */
+
+    /**
+     * @brief Parsed CRUMBS_CMD_CAPABILITIES reply.
+     */
+    typedef struct
+    {
+        uint32_t flags;         /**< CRUMBS_CAP_* bits. */
+        uint16_t frag_capacity; /**< Reassembly buffer size (0 if no fragments). */
+        uint16_t max_bus_khz;   /**< Fastest tolerated clock in kHz (0 = not advertised). */
+    } crumbs_capabilities_t;
+
+    /**
+     * @brief Capability bitmap a peripheral currently advertises.
+     *
+     * @param ctx Peripheral context (may be NULL).
+     * @return CRUMBS_CAP_* bits for features active on @p ctx.
+     */
+    uint32_t crumbs_peripheral_capabilities(const crumbs_context_t *ctx);
+
+    /**
+     * @brief Set the bus clock a peripheral advertises in its CAPABILITIES reply.
+     *
+     * Controllers use it to pick the fastest clock every device on the
+     * segment tolerates. Peripherals that never call this advertise 0,
+     * which controllers treat as standard mode (100 kHz).
+     *
+     * @param ctx Peripheral context.
+     * @param khz Fastest tolerated clock in kHz, e.g. CRUMBS_BUS_KHZ_FAST.
+     * @return 0 on success, -1 if ctx is NULL.
+     */
+    int crumbs_set_max_bus_clock(crumbs_context_t *ctx, uint16_t khz);
+
+    /**
+     * @brief Query a peripheral's capabilities (SET_REPLY, delay, read).
+     *
+     * @param dev Bound device (write_fn, read_fn and delay_fn required).
+     * @param out Parsed capabilities.
+     * @return 0 on success, -1 on bad args or malformed reply, else send/read error.
+     */
+    int crumbs_controller_get_capabilities(const crumbs_device_t *dev,
+                                           crumbs_capabilities_t *out);
+    /** @} */
+
+    /** @name Fragmented Transfers
+     *  Transfers larger than CRUMBS_MAX_PAYLOAD, split into
+     *  CRUMBS_CMD_FRAGMENT frames and reassembled by the peripheral.
+     *  @{ */
+
+    /**
+     * @brief Install the peripheral reassembly buffer and completion callback.
+     *
+     * Requires CRUMBS_ENABLE_FRAGMENTS. Pass buf == NULL to stop
+     * intercepting FRAGMENT frames. Capacity above
+     * CRUMBS_FRAGMENT_MAX_TRANSFER is clamped.
+     *
+     * @param ctx Peripheral context.
+     * @param buf Buffer owned by the caller for the lifetime of the context.
+     * @param capacity Size of @p buf in bytes.
+     * @param on_complete Called from the receive path when a transfer completes (may be NULL).
+     * @param user_data Passed to @p on_complete.
+     * @return 0 on success, -1 if ctx is NULL or fragments are compiled out.
+     */
+    int crumbs_set_fragment_buffer(crumbs_context_t *ctx,
+                                   uint8_t *buf,
+                                   size_t capacity,
+                                   crumbs_fragment_fn on_complete,
+                                   void *user_data);
+
+    /**
+     * @brief Parsed CRUMBS_CMD_FRAGMENT status reply.
+     */
+    typedef struct
+    {
+        uint8_t state;       /**< CRUMBS_FRAG_* state. */
+        uint8_t opcode;      /**< Target opcode of the current/last transfer. */
+        uint8_t next_index;  /**< Next fragment index the peripheral expects. */
+        uint8_t errors;      /**< Aborted transfers (saturating). */
+        uint16_t received;   /**< Bytes reassembled so far. */
+    } crumbs_fragment_status_t;
+
+    /**
+     * @brief Read a peripheral's reassembly status (SET_REPLY, delay, read).
+     *
+     * @param dev Bound device (write_fn, read_fn and delay_fn required).
+     * @param out Parsed status.
+     * @return 0 on success, -1 on bad args or malformed reply, else send/read error.
+     */
+    int crumbs_controller_get_fragment_status(const crumbs_device_t *dev,
+                                              crumbs_fragment_status_t *out);
+
+    /**
+     * @brief Send up to CRUMBS_FRAGMENT_MAX_TRANSFER bytes as back-to-back fragments.
+     *
+     * Fragments are written without a read in between. With @p window > 0
+     * the status is checked after every @p window fragments and at the end;
+     * if the peripheral fell behind or aborted, sending resumes from the
+     * fragment it expects (or restarts), up to CRUMBS_FRAGMENT_MAX_RETRIES
+     * times. @p window == 0 sends blind.
+     *
+     * @param dev Bound device (read_fn and delay_fn required when window > 0).
+     * @param type_id Type ID placed in each fragment frame.
+     * @param opcode Target opcode delivered with the reassembled data.
+     * @param data Bytes to send (may be NULL when len == 0).
+     * @param len Number of bytes.
+     * @param window Fragments per status check (0 = no checks).
+     * @return 0 on success, -1 on bad args or oversize, -4 if verification
+     *         still failed after the retries, else send/read error.
+     */
+    int crumbs_controller_send_fragmented(const crumbs_device_t *dev,
+                                          uint8_t type_id,
+                                          uint8_t opcode,
+                                          const uint8_t *data,
+                                          size_t len,
+                                          uint8_t window);
+    /** @} */
+
+    /** @name Broadcast
+     *  One write to the I2C general-call address (0x00) reaches every
+     *  peripheral that enabled general-call reception. The frame is
+     *  [type_id][CRUMBS_CMD_BROADCAST][len][opcode][data...][crc8]; the
+     *  peripheral unwraps it and dispatches opcode with data through the
+     *  normal handler table, with crumbs_is_broadcast() true. Nobody ACKs
+     *  on behalf of a particular device and there is no reply.
+     *  @{ */
+
+    /** @brief I2C general-call address. */
+#define CRUMBS_BROADCAST_ADDR 0x00u
+
+    /** @brief Largest payload of a broadcast message (one byte carries the opcode). */
+#define CRUMBS_BROADCAST_MAX_PAYLOAD (CRUMBS_MAX_PAYLOAD - 1u)
+
+    /**
+     * @brief Send @p msg to every listening peripheral in one transaction.
+     *
+     * msg->type_id selects the device type that acts on it; 0 means every
+     * type. Devices of other types that also listen ignore the frame.
+     * Avoid type_id 0x04 and 0x06: they are the I2C spec's own
+     * general-call commands, so other chips on a mixed bus may act on them
+     * (0x06 is "software reset").
+     *
+     * @param ctx Controller context.
+     * @param msg Message; data_len at most CRUMBS_BROADCAST_MAX_PAYLOAD.
+     * @param write_fn I2C write callback.
+     * @param write_ctx Passed to @p write_fn.
+     * @return 0 on success, -1 on bad args or oversize, else as
+     *         crumbs_controller_send_frame().
+     */
+    int crumbs_controller_broadcast(const crumbs_context_t *ctx,
+                                    const crumbs_message_t *msg,
+                                    crumbs_i2c_write_fn write_fn,
+                                    void *write_ctx);
+
+    /**
+     * @brief Switch broadcast reception on or off (CRUMBS_ENABLE_BROADCAST).
+     *
+     * Only the frame handling: the HAL must also be told to ACK the
+     * general-call address.
+     *
+     * @param ctx Peripheral context.
+     * @param enable Non-zero to unwrap CRUMBS_CMD_BROADCAST frames.
+     * @param type_id This device's type; broadcasts for other non-zero
+     *        types are dropped. 0 accepts every broadcast.
+     * @return 0 on success, -1 if ctx is NULL or broadcasts are compiled out.
+     */
+    int crumbs_peripheral_set_broadcast(crumbs_context_t *ctx, int enable, uint8_t type_id);
+
+    /**
+     * @brief Whether the frame being dispatched arrived as a broadcast.
+     *
+     * For handlers and on_message; e.g. to skip per-device side effects.
+     *
+     * @return 1 inside a broadcast dispatch, 0 otherwise or when compiled out.
+     */
+    int crumbs_is_broadcast(const crumbs_context_t *ctx);
+    /** @} */
+
+    /** @name Register File
+     *  A peripheral exposes a memory region (servo positions, LED state,
+     *  a sensor snapshot) that the controller reads at any offset with one
+     *  write and one read. The write [0x00][CRUMBS_CMD_REG_READ][3]
+     *  [offset:u16][count][crc8] selects the range and the reply at the
+     *  same time; the read returns [0x00][CRUMBS_CMD_REG_READ][len]
+     *  [offset:u16][bytes...][crc8], copied from the region inside the
+     *  request handler without calling any reply handler. Multi-byte
+     *  values are whatever the peripheral's memory holds (little-endian
+     *  on AVR, ARM and x86).
+     *  @{ */
+
+    /** @brief Largest range one REG_READ returns. */
+#define CRUMBS_REG_MAX_READ (CRUMBS_MAX_PAYLOAD - 2u)
+
+    /**
+     * @brief Expose @p size bytes at @p base to REG_READ (CRUMBS_ENABLE_REGISTERS).
+     *
+     * The controller may read the region at any time, including half-way
+     * through an update; keep multi-byte fields that must not tear behind
+     * a flag or update them with interrupts off. Ranges past the end are
+     * cut short. Pass base == NULL to stop answering REG_READ.
+     *
+     * @param ctx Peripheral context.
+     * @param base Region owned by the caller for the lifetime of the context.
+     * @param size Bytes in the region.
+     * @return 0 on success, -1 if ctx is NULL or registers are compiled out.
+     */
+    int crumbs_set_register_file(crumbs_context_t *ctx, const void *base, uint16_t size);
+
+    /**
+     * @brief Read @p len bytes at @p offset of a peripheral's register file.
+     *
+     * One REG_READ write and one read per CRUMBS_REG_MAX_READ bytes. There
+     * is no delay in between, since the reply is a copy.
+     *
+     * @param dev Bound device (write_fn and read_fn required).
+     * @param offset First byte.
+     * @param out Destination for @p len bytes.
+     * @param len Bytes to read (any length; split as needed).
+     * @return 0 on success, -1 on bad args or a reply for another range
+     *         (e.g. past the end of the region), else send/read error.
+     */
+    int crumbs_controller_read_registers(const crumbs_device_t *dev,
+                                         uint16_t offset,
+                                         uint8_t *out,
+                                         size_t len);
+
+    /**
+     * @brief REG_READ and its reply in one repeated-START transaction.
+     *
+     * @param ctx Controller context.
+     * @param target_addr 7-bit I2C address of the peripheral.
+     * @param offset First byte.
+     * @param out Destination for @p len bytes.
+     * @param len At most CRUMBS_REG_MAX_READ.
+     * @param write_read_fn Combined transfer (e.g. crumbs_linux_write_then_read).
+     * @param io Passed to @p write_read_fn.
+     * @return As crumbs_controller_read_registers(), or
+     *         CRUMBS_I2C_DEV_E_NO_REPEATED_START.
+     */
+    int crumbs_controller_query_registers(crumbs_context_t *ctx,
+                                          uint8_t target_addr,
+                                          uint16_t offset,
+                                          uint8_t *out,
+                                          uint8_t len,
+                                          crumbs_i2c_write_read_fn write_read_fn,
+                                          void *io);
+    /** @} */
+
+    /** @name Bulk Query
+     *  Replies of several opcodes from one SET_REPLY. The controller sends
+     *  SET_REPLY with payload [CRUMBS_CMD_BULK_GET][op1][op2]...; each read
+     *  then returns [type_id][CRUMBS_CMD_BULK_GET][len][hdr]
+     *  [op][n][data × n]...[crc8], where hdr is the index of the first
+     *  entry in the frame, plus CRUMBS_BULK_MORE while later frames hold
+     *  the rest. Entries are whole replies and are never split; one whose
+     *  reply does not fit a frame on its own has n = CRUMBS_BULK_TOO_LARGE
+     *  and no data. type_id is that of the first reply in the frame. After
+     *  the last frame the stream starts again from the first opcode.
+     *
+     *  The entry that does not fit a frame is built again for the next
+     *  one, so its reply handler runs twice; keep GET handlers free of
+     *  side effects.
+     *  @{ */
+
+#define CRUMBS_BULK_MORE 0x80u      /**< hdr flag: the stream continues in the next read. */
+#define CRUMBS_BULK_TOO_LARGE 0xFFu /**< Entry length of a reply that needs a query of its own. */
+
+    /** @brief Most opcodes one bulk SET_REPLY can name. */
+#define CRUMBS_BULK_MAX_QUERY (CRUMBS_MAX_PAYLOAD - 1u)
+
+    /**
+     * @brief Step through the entries of one bulk reply frame.
+     *
+     * Start with *pos = 0. Each entry is copied to @p entry with the
+     * frame's type_id.
+     *
+     * @param frame Decoded CRUMBS_CMD_BULK_GET reply.
+     * @param pos Byte position in frame->data, advanced past the entry.
+     * @param entry Output message.
+     * @return 1 for an entry, 2 for a CRUMBS_BULK_TOO_LARGE entry (data_len 0),
+     *         0 after the last one, -1 on a malformed frame.
+     */
+    int crumbs_bulk_next(const crumbs_message_t *frame, uint8_t *pos, crumbs_message_t *entry);
+
+    /**
+     * @brief Replies of @p count opcodes with one SET_REPLY.
+     *
+     * Sends the bulk SET_REPLY, waits crumbs_device_query_delay() once and
+     * reads frames back to back until the stream ends. Entries marked
+     * CRUMBS_BULK_TOO_LARGE are fetched afterwards with a plain query each.
+     * A peripheral keeps at most CRUMBS_BULK_MAX_OPS opcodes, so longer
+     * lists fail on it.
+     *
+     * @param dev Bound device (write_fn, read_fn and delay_fn required).
+     * @param opcodes Opcodes to query, at most CRUMBS_BULK_MAX_QUERY.
+     * @param count Entries in @p opcodes.
+     * @param out @p count messages, filled in the order of @p opcodes.
+     * @return 0 on success, -1 on bad args or a stream that does not match
+     *         the request (lost frame, peripheral without bulk support),
+     *         else send/read error.
+     */
+    int crumbs_controller_get_bulk(const crumbs_device_t *dev,
+                                   const uint8_t *opcodes,
+                                   uint8_t count,
+                                   crumbs_message_t *out);
+    /** @} */
+
+    /** @name Reply Cursor
+     *  Paged reads without a write per page. SET_REPLY normally carries one
+     *  byte and requested_opcode stays put until the next one. A SET_REPLY
+     *  of [opcode][mode][count] (CRUMBS_ENABLE_REPLY_CURSOR) also starts a
+     *  cursor that moves on after each reply the peripheral delivers, so
+     *  the controller just keeps reading:
+     *
+     *  - CRUMBS_CURSOR_OPCODE: requested_opcode steps through opcode,
+     *    opcode + 1, ... opcode + count - 1 and wraps (history entries
+     *    with one opcode each).
+     *  - CRUMBS_CURSOR_INDEX: requested_opcode stays; crumbs_reply_cursor()
+     *    counts 0 ... count - 1 and wraps, for handlers that page within
+     *    one opcode (log pages, bitmap rows).
+     *
+     *  count 0 means 256. A CRUMBS_CMD_NOT_READY reply does not advance, so
+     *  the controller re-reads the same page. Any other SET_REPLY, or a
+     *  REG_READ or bulk query that takes over requested_opcode, ends the
+     *  cursor.
+     *  @{ */
+
+#define CRUMBS_CURSOR_OFF 0u    /**< Plain SET_REPLY. */
+#define CRUMBS_CURSOR_OPCODE 1u /**< Advance requested_opcode. */
+#define CRUMBS_CURSOR_INDEX 2u  /**< Advance the index read by crumbs_reply_cursor(). */
+
+    /**
+     * @brief Position of the cursor for the reply being built.
+     *
+     * For reply handlers and on_request. In CRUMBS_CURSOR_OPCODE mode this
+     * is requested_opcode minus the first opcode.
+     *
+     * @return 0 ... count - 1, or 0 without a cursor or when compiled out.
+     */
+    uint8_t crumbs_reply_cursor(const crumbs_context_t *ctx);
+
+    /**
+     * @brief Send SET_REPLY(@p opcode) with a cursor.
+     *
+     * @param dev Bound device (write_fn required).
+     * @param opcode First opcode.
+     * @param mode CRUMBS_CURSOR_*.
+     * @param count Steps before wrapping (0 = 256).
+     * @return 0 on success, -1 on bad args, else send error.
+     */
+    int crumbs_controller_set_cursor(const crumbs_device_t *dev,
+                                     uint8_t opcode,
+                                     uint8_t mode,
+                                     uint8_t count);
+
+    /**
+     * @brief Read @p count pages with one SET_REPLY and back-to-back reads.
+     *
+     * Starts a cursor of @p count steps, waits crumbs_device_query_delay()
+     * once, then reads @p count replies into @p out. A NOT_READY page is
+     * polled with crumbs_controller_read_ready() and the CRUMBS_READY_POLL_*
+     * defaults; the cursor holds meanwhile. In CRUMBS_CURSOR_OPCODE mode
+     * each reply must carry the opcode expected at its step.
+     *
+     * @param dev Bound device (write_fn, read_fn and delay_fn required).
+     * @param opcode First opcode.
+     * @param mode CRUMBS_CURSOR_OPCODE or CRUMBS_CURSOR_INDEX.
+     * @param count Pages to read (1-255).
+     * @param out @p count messages.
+     * @return 0 on success, -1 on bad args or an unexpected opcode, -3 if
+     *         a page stayed NOT_READY, else send/read error.
+     */
+    int crumbs_controller_read_sequence(const crumbs_device_t *dev,
+                                        uint8_t opcode,
+                                        uint8_t mode,
+                                        uint8_t count,
+                                        crumbs_message_t *out);
+    /** @} */
+
+    /** @name Change Sequence
+     *  Conditional GETs for telemetry that rarely changes. The peripheral
+     *  keeps one sequence number per context and bumps it with
+     *  crumbs_mark_changed() whenever the state behind its replies moves.
+     *  The controller writes [0x00][CRUMBS_CMD_IF_CHANGED][3][opcode]
+     *  [seen:u16][crc8] in place of SET_REPLY; each read then returns
+     *
+     *  - [0x00][CRUMBS_CMD_IF_CHANGED][0][crc8] while the sequence still
+     *    equals seen (4 bytes; no reply handler runs), or
+     *  - [type_id][CRUMBS_CMD_IF_CHANGED][2+n][seq:u16][reply data...][crc8],
+     *    the normal reply for opcode with the current sequence in front.
+     *
+     *  Replies longer than CRUMBS_CHANGED_MAX_PAYLOAD, NOT_READY and
+     *  pre-built replies are sent as they are and count as changed with no
+     *  known sequence. seen = 0 never matches.
+     *  @{ */
+
+    /** @brief Largest reply that fits behind the sequence. */
+#define CRUMBS_CHANGED_MAX_PAYLOAD (CRUMBS_MAX_PAYLOAD - 2u)
+
+    /**
+     * @brief Record that the state behind this peripheral's replies changed.
+     *
+     * Call it from the code that updates the state. If that code runs
+     * outside the I2C interrupt on an 8-bit MCU, call it with interrupts
+     * off (the sequence is 16 bits).
+     */
+    void crumbs_mark_changed(crumbs_context_t *ctx);
+
+    /** @brief Current change sequence (1-65535), or 0 when compiled out. */
+    uint16_t crumbs_change_seq(const crumbs_context_t *ctx);
+
+    /**
+     * @brief Set the sequence, e.g. from a boot counter or random seed.
+     *
+     * The sequence restarts at 1 after a reset. A controller that outlives
+     * the peripheral may then hold a matching stale sequence, so seed it
+     * when that matters. 0 is replaced by 1.
+     *
+     * @return 0 on success, -1 if ctx is NULL or compiled out.
+     */
+    int crumbs_set_change_seq(crumbs_context_t *ctx, uint16_t seq);
+
+    /**
+     * @brief Last full reply of one opcode, as seen by the controller.
+     */
+    typedef struct
+    {
+        crumbs_message_t reply; /**< Last full reply (opcode = the queried one). */
+        uint16_t seq;           /**< Its sequence, 0 = unknown or nothing cached. */
+        uint8_t opcode;         /**< Opcode this cache follows. */
+        uint8_t valid;          /**< reply holds data. */
+        uint32_t hits;          /**< Polls answered "unchanged". */
+        uint32_t misses;        /**< Polls that returned a full reply. */
+    } crumbs_change_cache_t;
+
+    /** @brief Empty cache for @p opcode. */
+    void crumbs_change_cache_init(crumbs_change_cache_t *cache, uint8_t opcode);
+
+    /**
+     * @brief Conditional GET of cache->opcode.
+     *
+     * Sends IF_CHANGED with the cached sequence, waits
+     * crumbs_device_query_delay(), then reads the 4-byte minimum. While
+     * nothing changed that is the whole transfer and @p out gets the cached
+     * reply. Otherwise the full frame is read with a second, exact-length
+     * read and cached.
+     *
+     * @param dev Bound device (write_fn, read_fn and delay_fn required).
+     * @param cache Cache of the opcode.
+     * @param out Current reply (may be &cache->reply).
+     * @return 1 for a new reply, 0 if served from the cache, -1 on bad args
+     *         or an unexpected frame, else send/read error.
+     */
+    int crumbs_controller_get_if_changed(const crumbs_device_t *dev,
+                                         crumbs_change_cache_t *cache,
+                                         crumbs_message_t *out);
+    /** @} */
+
+    /** @name Command Results
+     *  Acknowledged writes in two transactions. With CRUMBS_ENABLE_RESULT
+     *  the peripheral records [opcode][status][count] after each command
+     *  it dispatches, and the next read returns
+     *  [0x00][CRUMBS_CMD_RESULT][3][opcode][status][count][crc8] instead of
+     *  the reply that SET_REPLY selected. That read, or any SET_REPLY,
+     *  disarms it, so later reads get the selected reply again.
+     *
+     *  crumbs_handler_fn returns void, so a handler reports a failure by
+     *  calling crumbs_set_result() before it returns. A handler that does
+     *  not gets CRUMBS_RESULT_OK; a command with no handler and no
+     *  on_message gets CRUMBS_RESULT_UNHANDLED, one taken by the stage
+     *  CRUMBS_RESULT_STAGED. With deferred dispatch the result is recorded
+     *  when crumbs_peripheral_process() runs the command.
+     *  @{ */
+
+#define CRUMBS_RESULT_OK 0x00u        /**< Handler ran and reported nothing else. */
+#define CRUMBS_RESULT_STAGED 0xFEu    /**< Latched: waits for CRUMBS_CMD_COMMIT. */
+#define CRUMBS_RESULT_UNHANDLED 0xFFu /**< No handler or on_message for the opcode. */
+
+    /** @brief Delay between the write and the result read (0 = read at once). */
+#ifndef CRUMBS_RESULT_DELAY_US
+#define CRUMBS_RESULT_DELAY_US 0u
+#endif
+
+    /**
+     * @brief Last recorded command result.
+     */
+    typedef struct
+    {
+        uint8_t opcode; /**< Command it belongs to. */
+        uint8_t status; /**< CRUMBS_RESULT_* or an application code (0x01-0xFD). */
+        uint8_t count;  /**< Commands recorded so far, wrapping. */
+    } crumbs_result_t;
+
+    /**
+     * @brief Report the status of the command being handled.
+     *
+     * Call from a command handler or on_message; it overrides
+     * CRUMBS_RESULT_OK for this command only.
+     *
+     * @return 0 on success, -1 if ctx is NULL or compiled out.
+     */
+    int crumbs_set_result(crumbs_context_t *ctx, uint8_t status);
+
+    /**
+     * @brief Copy the last recorded result.
+     *
+     * @return 0 on success, -1 on NULL arguments or when compiled out.
+     */
+    int crumbs_last_result(const crumbs_context_t *ctx, crumbs_result_t *out);
+
+    /**
+     * @brief Send @p msg and read its result back (one write, one read).
+     *
+     * Waits CRUMBS_RESULT_DELAY_US between the two when delay_fn is set.
+     *
+     * @param dev Bound device (write_fn and read_fn required).
+     * @param out Result read back.
+     * @return 0 if the result belongs to msg->opcode (check out->status),
+     *         -1 on bad args, a peripheral without CRUMBS_ENABLE_RESULT or
+     *         a result for another opcode, else send/read error.
+     */
+    int crumbs_controller_send_checked(const crumbs_device_t *dev,
+                                       const crumbs_message_t *msg,
+                                       crumbs_result_t *out);
+
+    /**
+     * @brief Read the result slot with a SET_REPLY (needs delay_fn too).
+     *
+     * @return 0 on success, -1 on bad args or a malformed reply, else
+     *         send/read error.
+     */
+    int crumbs_controller_get_result(const crumbs_device_t *dev, crumbs_result_t *out);
+    /** @} */
+
+    /** @name Attention Line
+     *  I2C peripherals cannot start a transfer, so a peripheral with news
+     *  pulls a shared open-drain line low (SMBus ALERT# style) and the
+     *  controller only polls once it sees the line asserted. The controller
+     *  then reads one byte from CRUMBS_ALERT_RESPONSE_ADDR; every asserting
+     *  peripheral answers with its address in bits 7..1 and the lowest
+     *  address wins arbitration. The winner releases the line. The line
+     *  stays low while others still assert it, so repeat until it is high
+     *  or nobody answers.
+     *
+     *  Answering the alert response address needs a second peripheral
+     *  address, which most I2C slave drivers (including Arduino Wire) do
+     *  not offer. The line is therefore also released by the next reply
+     *  the peripheral delivers: a controller that gets no alert response
+     *  polls its attention tasks (crumbs_sched_attention() with
+     *  CRUMBS_SCHED_ANY_ADDR) and clears the line that way.
+     *  @{ */
+
+    /** @brief SMBus Alert Response Address. */
+#define CRUMBS_ALERT_RESPONSE_ADDR 0x0Cu
+
+    /**
+     * @brief Install the attention line driver.
+     *
+     * @param ctx Peripheral context.
+     * @param fn Line driver (e.g. crumbs_arduino_attention_pin()); NULL
+     *        releases the line and detaches it.
+     * @param user_data Passed to @p fn.
+     * @return 0 on success, -1 if ctx is NULL or compiled out.
+     */
+    int crumbs_set_attention_pin(crumbs_context_t *ctx, crumbs_attention_fn fn, void *user_data);
+
+    /**
+     * @brief Assert the attention line until the controller has been told.
+     *
+     * Safe to call from an interrupt or when already asserted.
+     *
+     * @return 0 on success, -1 if ctx is NULL or compiled out.
+     */
+    int crumbs_raise_attention(crumbs_context_t *ctx);
+
+    /** @brief Release the attention line without waiting for the controller. */
+    void crumbs_clear_attention(crumbs_context_t *ctx);
+
+    /** @brief Non-zero while this peripheral asserts the line. */
+    int crumbs_attention_pending(const crumbs_context_t *ctx);
+
+    /**
+     * @brief Answer a read of CRUMBS_ALERT_RESPONSE_ADDR (for HAL code).
+     *
+     * A HAL whose slave driver can ACK a second address calls this when
+     * that read arrives. If the peripheral asserts the line, @p out gets
+     * its address << 1 and the line is released.
+     *
+     * @return 1 if @p out should be sent, 0 if the read is not for this
+     *         peripheral (NACK, or send 0xFF), -1 on bad args.
+     */
+    int crumbs_peripheral_alert_response(crumbs_context_t *ctx, uint8_t *out);
+
+    /**
+     * @brief Ask which peripheral asserts the attention line.
+     *
+     * One 1-byte read from CRUMBS_ALERT_RESPONSE_ADDR.
+     *
+     * @param read_fn Bus read.
+     * @param io Bus handle.
+     * @param addr Out: 7-bit address of the peripheral that answered.
+     * @return 1 if one answered, 0 if the read was NACKed or empty (no
+     *         peripheral with alert response support asserts the line), -1
+     *         on bad args.
+     */
+    int crumbs_controller_alert_response(crumbs_i2c_read_fn read_fn, void *io, uint8_t *addr);
+    /** @} */
+
     /** @name CRC statistics helpers
      *  Convenience helpers to access / reset CRC statistics stored in a context.
      *  @{ */
@@ -682,6 +2730,77 @@ extern "C"
     void crumbs_reset_crc_stats(crumbs_context_t *ctx);
     /** @} */
 
+    /** @name Traffic Statistics
+     *  Require CRUMBS_ENABLE_STATS on the context that records them. The
+     *  controller read helpers work against any peripheral that advertises
+     *  CRUMBS_CAP_STATS.
+     *  @{ */
+
+    /**
+     * @brief Set the clock used for handler, reply and transaction timings.
+     *
+     * @param ctx    Context to time.
+     * @param now_us Microsecond clock, or NULL to keep counters only.
+     * @return 0 on success, -1 if ctx is NULL or stats are compiled out.
+     */
+    int crumbs_set_stats_clock(crumbs_context_t *ctx, crumbs_clock_us_fn now_us);
+
+    /**
+     * @brief Copy the counters of @p ctx.
+     *
+     * @return 0 on success, -1 on bad args or when compiled out.
+     */
+    int crumbs_get_stats(const crumbs_context_t *ctx, crumbs_stats_t *out);
+
+    /**
+     * @brief Controller latency histogram for @p addr.
+     *
+     * @return Pointer into the context, or NULL if @p addr has no entry
+     *         (or stats are compiled out).
+     */
+    const crumbs_addr_stats_t *crumbs_get_addr_stats(const crumbs_context_t *ctx, uint8_t addr);
+
+    /**
+     * @brief Clear every counter, histogram and per-address entry.
+     *
+     * @return 0 on success, -1 if ctx is NULL or stats are compiled out.
+     */
+    int crumbs_reset_stats(crumbs_context_t *ctx);
+
+    /**
+     * @brief Read a peripheral's statistics over CRUMBS_CMD_STATS.
+     *
+     * Reads every page (one STATS select plus one GET each). Per-opcode
+     * entries beyond CRUMBS_STATS_OPCODES of this build are dropped.
+     *
+     * @param dev Bound device (write_fn, read_fn and delay_fn required).
+     * @param out Filled with the peripheral's counters.
+     * @return 0 on success, -1 on bad args or malformed reply, else send/read error.
+     */
+    int crumbs_controller_get_stats(const crumbs_device_t *dev, crumbs_stats_t *out);
+
+    /**
+     * @brief Clear a peripheral's statistics over CRUMBS_CMD_STATS.
+     *
+     * @return 0 on success, -1 on bad args, else the send error.
+     */
+    int crumbs_controller_reset_stats(const crumbs_device_t *dev);
+    /** @} */
+
+    /**
+     * @brief Install the trace hook (requires CRUMBS_ENABLE_TRACE).
+     *
+     * @param ctx       Context to trace.
+     * @param fn        Hook, or NULL to stop tracing.
+     * @param clock     Timestamp source (e.g. micros or a cycle counter), or NULL.
+     * @param user_data Passed to @p fn.
+     * @return 0 on success, -1 if ctx is NULL or tracing is compiled out.
+     */
+    int crumbs_set_trace_hook(crumbs_context_t *ctx,
+                              crumbs_trace_fn fn,
+                              crumbs_clock_us_fn clock,
+                              void *user_data);
+
 #ifdef __cplusplus
 }
 #endif
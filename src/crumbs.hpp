@@ -0,0 +1,487 @@
+#ifndef CRUMBS_HPP
+#define CRUMBS_HPP
+
+/**
+ * @file
+ * @brief Optional header-only C++11 layer over the C core.
+ *
+ * Ops are described by constexpr descriptors (crumbs::Command,
+ * crumbs::Query) instead of CRUMBS_DEFINE_*_OP macros, and their payloads
+ * by fixed-size views whose offsets are template arguments, so an access
+ * past the payload is a compile error rather than a runtime check:
+ *
+ * @code
+ * struct Servo
+ * {
+ *     static constexpr uint8_t type_id = 0x02;
+ *     typedef crumbs::Command<type_id, 0x01, 2> SetPos; // [idx:u8][pos:u8]
+ *     typedef crumbs::Query<type_id, 0x80, 2> GetPos;   // reply [pos:u8[2]]
+ * };
+ *
+ * // Controller
+ * crumbs::Device<Servo> servo(dev);        // dev: bound crumbs_device_t
+ * crumbs::Frame<Servo::SetPos> f;
+ * f.put_u8<0>(1);
+ * f.put_u8<1>(90);
+ * servo.send(f);
+ *
+ * crumbs::Reply<Servo::GetPos> r;
+ * if (servo.get(r) == 0)
+ *     use(r.view().u8<0>(), r.view().u8<1>());
+ *
+ * // Peripheral: one struct per opcode
+ * struct OnSetPos
+ * {
+ *     typedef Servo::SetPos op;
+ *     static void handle(crumbs_context_t &ctx, crumbs::View<op::len> v);
+ * };
+ * struct OnGetPos
+ * {
+ *     typedef Servo::GetPos op;
+ *     static void reply(crumbs_context_t &ctx, crumbs::Writer<op::reply_len> w);
+ * };
+ * crumbs::Peripheral<OnSetPos, OnGetPos>::attach(ctx);
+ * @endcode
+ *
+ * Peripheral dispatch is an opcode comparison chain fixed at compile time
+ * (no handler table, no function pointers per opcode), installed through
+ * the on_message / on_request callbacks, so registered handler tables and
+ * core extensions keep working alongside it. Device and Peripheral hold
+ * references, so the wrappers themselves make no null or role checks; the
+ * C functions they call keep theirs. Nothing here allocates, and only
+ * <stdint.h> / <string.h> are needed, so the header builds with avr-gcc.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "crumbs.h"
+#include "crumbs_latency.h"
+
+namespace crumbs
+{
+
+    namespace detail
+    {
+        static inline void store_u16(uint8_t *p, uint16_t v)
+        {
+            p[0] = (uint8_t)(v & 0xFFu);
+            p[1] = (uint8_t)(v >> 8);
+        }
+
+        static inline void store_u32(uint8_t *p, uint32_t v)
+        {
+            p[0] = (uint8_t)(v & 0xFFu);
+            p[1] = (uint8_t)(v >> 8);
+            p[2] = (uint8_t)(v >> 16);
+            p[3] = (uint8_t)(v >> 24);
+        }
+
+        static inline uint16_t load_u16(const uint8_t *p)
+        {
+            return (uint16_t)(p[0] | ((uint16_t)p[1] << 8));
+        }
+
+        static inline uint32_t load_u32(const uint8_t *p)
+        {
+            return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+                   ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+        }
+
+        /** Stores at compile-time offsets into Derived::bytes(). */
+        template <class Derived, uint8_t N>
+        class Stores
+        {
+        public:
+            template <uint8_t Off>
+            void put_u8(uint8_t v)
+            {
+                static_assert(Off + 1u <= N, "write past the end of the payload");
+                self()[Off] = v;
+            }
+            template <uint8_t Off>
+            void put_i8(int8_t v) { put_u8<Off>((uint8_t)v); }
+            template <uint8_t Off>
+            void put_u16(uint16_t v)
+            {
+                static_assert(Off + 2u <= N, "write past the end of the payload");
+                store_u16(&self()[Off], v);
+            }
+            template <uint8_t Off>
+            void put_i16(int16_t v) { put_u16<Off>((uint16_t)v); }
+            template <uint8_t Off>
+            void put_u32(uint32_t v)
+            {
+                static_assert(Off + 4u <= N, "write past the end of the payload");
+                store_u32(&self()[Off], v);
+            }
+            template <uint8_t Off>
+            void put_i32(int32_t v) { put_u32<Off>((uint32_t)v); }
+            template <uint8_t Off>
+            void put_f32(float v)
+            {
+                static_assert(Off + sizeof(float) <= N, "write past the end of the payload");
+                memcpy(&self()[Off], &v, sizeof(float)); /* native order, as crumbs_msg_add_float() */
+            }
+
+        private:
+            uint8_t *self() { return static_cast<Derived *>(this)->bytes(); }
+        };
+
+        /** Compile-time check that no two handlers share an opcode. */
+        template <class... Hs>
+        struct Unique;
+        template <>
+        struct Unique<>
+        {
+            static constexpr bool contains(uint8_t, bool) { return false; }
+            static constexpr bool value = true;
+        };
+        template <class H, class... Rest>
+        struct Unique<H, Rest...>
+        {
+            static constexpr bool contains(uint8_t opcode, bool query)
+            {
+                return (H::op::opcode == opcode && H::op::is_query == query) ||
+                       Unique<Rest...>::contains(opcode, query);
+            }
+            static constexpr bool value =
+                !Unique<Rest...>::contains(H::op::opcode, H::op::is_query) && Unique<Rest...>::value;
+        };
+    } // namespace detail
+
+    /**
+     * @brief Read-only view of an N-byte payload.
+     *
+     * Built only after the payload length was checked once, so each
+     * accessor is a plain load at a constant offset.
+     */
+    template <uint8_t N>
+    class View
+    {
+    public:
+        explicit View(const uint8_t *data) : p_(data) {}
+
+        static constexpr uint8_t size() { return N; }
+        const uint8_t *data() const { return p_; }
+
+        template <uint8_t Off>
+        uint8_t u8() const
+        {
+            static_assert(Off + 1u <= N, "read past the end of the payload");
+            return p_[Off];
+        }
+        template <uint8_t Off>
+        int8_t i8() const { return (int8_t)u8<Off>(); }
+        template <uint8_t Off>
+        uint16_t u16() const
+        {
+            static_assert(Off + 2u <= N, "read past the end of the payload");
+            return detail::load_u16(&p_[Off]);
+        }
+        template <uint8_t Off>
+        int16_t i16() const { return (int16_t)u16<Off>(); }
+        template <uint8_t Off>
+        uint32_t u32() const
+        {
+            static_assert(Off + 4u <= N, "read past the end of the payload");
+            return detail::load_u32(&p_[Off]);
+        }
+        template <uint8_t Off>
+        int32_t i32() const { return (int32_t)u32<Off>(); }
+        template <uint8_t Off>
+        float f32() const
+        {
+            static_assert(Off + sizeof(float) <= N, "read past the end of the payload");
+            float v;
+            memcpy(&v, &p_[Off], sizeof(float));
+            return v;
+        }
+
+    private:
+        const uint8_t *p_;
+    };
+
+    /**
+     * @brief Write access to an N-byte payload (e.g. a reply being built).
+     */
+    template <uint8_t N>
+    class Writer : public detail::Stores<Writer<N>, N>
+    {
+    public:
+        explicit Writer(uint8_t *data) : p_(data) {}
+        static constexpr uint8_t size() { return N; }
+        uint8_t *bytes() { return p_; }
+
+    private:
+        uint8_t *p_;
+    };
+
+    /**
+     * @brief Descriptor of a SET opcode with a fixed Len-byte payload.
+     */
+    template <uint8_t TypeId, uint8_t Opcode, uint8_t Len = 0>
+    struct Command
+    {
+        static_assert(Len <= CRUMBS_MAX_PAYLOAD, "payload larger than CRUMBS_MAX_PAYLOAD");
+        static_assert(Opcode < 0xF0u, "0xF0-0xFF are reserved for the core");
+        static constexpr uint8_t type_id = TypeId;
+        static constexpr uint8_t opcode = Opcode;
+        static constexpr uint8_t len = Len;
+        static constexpr bool is_query = false;
+    };
+
+    /**
+     * @brief Descriptor of a GET opcode whose reply carries ReplyLen bytes.
+     *
+     * Replies are read with crumbs_controller_read_len(), so a GET clocks
+     * in 4 + ReplyLen bytes instead of a full frame.
+     */
+    template <uint8_t TypeId, uint8_t Opcode, uint8_t ReplyLen>
+    struct Query
+    {
+        static_assert(ReplyLen <= CRUMBS_MAX_PAYLOAD, "reply larger than CRUMBS_MAX_PAYLOAD");
+        static_assert(Opcode < 0xF0u, "0xF0-0xFF are reserved for the core");
+        static constexpr uint8_t type_id = TypeId;
+        static constexpr uint8_t opcode = Opcode;
+        static constexpr uint8_t reply_len = ReplyLen;
+        static constexpr bool is_query = true;
+    };
+
+    /**
+     * @brief Command message with its header and data_len fixed by @p Op.
+     *
+     * The put_*() stores land at constant offsets; encoding and CRC are
+     * left to crumbs_controller_send(), which keeps each send call site as
+     * small as the C ops helpers. A Frame may be sent again after changing
+     * fields.
+     */
+    template <class Op>
+    class Frame : public detail::Stores<Frame<Op>, Op::len>
+    {
+        static_assert(!Op::is_query, "Frame is for Command descriptors");
+
+    public:
+        Frame()
+        {
+            msg.type_id = Op::type_id;
+            msg.opcode = Op::opcode;
+            msg.data_len = Op::len;
+        }
+        uint8_t *bytes() { return msg.data; }
+
+        crumbs_message_t msg; /**< The message as it will be sent. */
+    };
+
+    /**
+     * @brief Decoded reply to a Query, valid once Device::get() returned 0.
+     */
+    template <class Op>
+    class Reply
+    {
+        static_assert(Op::is_query, "Reply is for Query descriptors");
+
+    public:
+        View<Op::reply_len> view() const { return View<Op::reply_len>(msg.data); }
+        crumbs_message_t msg; /**< The frame as received. */
+    };
+
+    /**
+     * @brief Controller-side handle for one device of a family.
+     *
+     * @p Family names the device kind and provides `type_id`; sending an op
+     * of another family does not compile.
+     */
+    template <class Family>
+    class Device
+    {
+    public:
+        explicit Device(const crumbs_device_t &dev) : dev_(dev) {}
+
+        const crumbs_device_t &raw() const { return dev_; }
+
+        /** @brief Send a command; returns as crumbs_controller_send(). */
+        template <class Op>
+        int send(const Frame<Op> &frame) const
+        {
+            static_assert(Op::type_id == Family::type_id, "op belongs to another family");
+            return crumbs_controller_send(dev_.ctx, dev_.addr, &frame.msg, dev_.write_fn, dev_.io);
+        }
+
+        /** @brief Send a command with no payload. */
+        template <class Op>
+        int send() const
+        {
+            static_assert(Op::len == 0u, "this op carries a payload; build a Frame");
+            Frame<Op> frame;
+            return send(frame);
+        }
+
+        /**
+         * @brief SET_REPLY, wait the device's query delay, read and check.
+         *
+         * @return 0 on success, -1 if the reply is for another type/opcode
+         *         or shorter than Op::reply_len, else a transport error.
+         */
+        template <class Op>
+        int get(Reply<Op> &out) const
+        {
+            static_assert(Op::type_id == Family::type_id, "op belongs to another family");
+            int rc = query(Op::opcode);
+            if (rc != 0)
+                return rc;
+            uint32_t wait = crumbs_device_query_delay(&dev_, Op::opcode);
+            dev_.delay_fn(wait);
+            rc = crumbs_controller_read_len(dev_.ctx, dev_.addr, &out.msg, dev_.read_fn, dev_.io, Op::reply_len);
+            crumbs_device_query_result(&dev_, Op::opcode, wait, rc == 0 && out.msg.opcode == Op::opcode);
+            return rc != 0 ? rc : check(out);
+        }
+
+        /** @brief get() without a fixed wait, re-reading while NOT_READY. */
+        template <class Op>
+        int get_ready(Reply<Op> &out) const
+        {
+            static_assert(Op::type_id == Family::type_id, "op belongs to another family");
+            int rc = query(Op::opcode);
+            if (rc != 0)
+                return rc;
+            rc = crumbs_controller_read_ready(dev_.ctx, dev_.addr, &out.msg, dev_.read_fn, dev_.io,
+                                              dev_.delay_fn, CRUMBS_READY_POLL_INTERVAL_US,
+                                              CRUMBS_READY_POLL_TIMEOUT_US);
+            return rc != 0 ? rc : check(out);
+        }
+
+    private:
+        int query(uint8_t opcode) const
+        {
+            crumbs_frame_builder_t fb;
+            crumbs_fb_init(&fb, 0u, CRUMBS_CMD_SET_REPLY);
+            crumbs_fb_add_u8(&fb, opcode);
+            return crumbs_controller_send_frame(dev_.ctx, dev_.addr, &fb, dev_.write_fn, dev_.io);
+        }
+
+        template <class Op>
+        static int check(const Reply<Op> &out)
+        {
+            return (out.msg.type_id == Op::type_id && out.msg.opcode == Op::opcode &&
+                    out.msg.data_len >= Op::reply_len)
+                       ? 0
+                       : -1;
+        }
+
+        const crumbs_device_t &dev_;
+    };
+
+    /**
+     * @brief Peripheral dispatch over a fixed set of handler structs.
+     *
+     * Each handler has `typedef <Command|Query> op;` and either
+     * `static void handle(crumbs_context_t &, View<op::len>)` or
+     * `static void reply(crumbs_context_t &, Writer<op::reply_len>)`.
+     * Commands shorter than op::len are dropped before handle() runs;
+     * reply() gets a Writer over a reply whose header and data_len are
+     * already set. Handlers that need crumbs_reply_not_ready() stay plain
+     * reply handlers (crumbs_register_reply_handler()); those run first.
+     */
+    template <class... Handlers>
+    class Peripheral
+    {
+        static_assert(detail::Unique<Handlers...>::value, "two handlers for the same opcode");
+
+    public:
+        /**
+         * @brief Install the dispatchers as on_message / on_request.
+         *
+         * Keeps ctx.user_data. Replaces any earlier on_message/on_request.
+         */
+        static void attach(crumbs_context_t &ctx)
+        {
+            crumbs_set_callbacks(&ctx, &on_message, &on_request, ctx.user_data);
+        }
+
+        /** @brief Run the command handler for @p opcode; returns 1 if one matched. */
+        static int dispatch(crumbs_context_t &ctx, uint8_t opcode, const uint8_t *data, uint8_t len)
+        {
+            return Chain<Handlers...>::command(ctx, opcode, data, len);
+        }
+
+        /** @brief Build the reply for ctx.requested_opcode; returns 1 if one matched. */
+        static int reply_message(crumbs_context_t &ctx, crumbs_message_t &msg)
+        {
+            return Chain<Handlers...>::reply(ctx, ctx.requested_opcode, msg);
+        }
+
+        static void on_message(crumbs_context_t *ctx, const crumbs_message_t *msg)
+        {
+            dispatch(*ctx, msg->opcode, msg->data, msg->data_len);
+        }
+
+        static void on_request(crumbs_context_t *ctx, crumbs_message_t *msg)
+        {
+            reply_message(*ctx, *msg);
+        }
+
+    private:
+        template <class... Hs>
+        struct Chain;
+
+        template <class H, class... Rest>
+        struct Chain<H, Rest...>
+        {
+            static int command(crumbs_context_t &ctx, uint8_t opcode, const uint8_t *data, uint8_t len)
+            {
+                return command_one(ctx, opcode, data, len, Tag<H::op::is_query>());
+            }
+            static int reply(crumbs_context_t &ctx, uint8_t opcode, crumbs_message_t &msg)
+            {
+                return reply_one(ctx, opcode, msg, Tag<H::op::is_query>());
+            }
+
+        private:
+            template <bool Q>
+            struct Tag
+            {
+            };
+
+            static int command_one(crumbs_context_t &ctx, uint8_t opcode, const uint8_t *data, uint8_t len,
+                                   Tag<false>)
+            {
+                if (opcode != H::op::opcode)
+                    return Chain<Rest...>::command(ctx, opcode, data, len);
+                if (len >= H::op::len)
+                    H::handle(ctx, View<H::op::len>(data));
+                return 1;
+            }
+            static int command_one(crumbs_context_t &ctx, uint8_t opcode, const uint8_t *data, uint8_t len,
+                                   Tag<true>)
+            {
+                return Chain<Rest...>::command(ctx, opcode, data, len);
+            }
+
+            static int reply_one(crumbs_context_t &ctx, uint8_t opcode, crumbs_message_t &msg, Tag<true>)
+            {
+                if (opcode != H::op::opcode)
+                    return Chain<Rest...>::reply(ctx, opcode, msg);
+                msg.type_id = H::op::type_id;
+                msg.opcode = H::op::opcode;
+                msg.data_len = H::op::reply_len;
+                H::reply(ctx, Writer<H::op::reply_len>(msg.data));
+                return 1;
+            }
+            static int reply_one(crumbs_context_t &ctx, uint8_t opcode, crumbs_message_t &msg, Tag<false>)
+            {
+                return Chain<Rest...>::reply(ctx, opcode, msg);
+            }
+        };
+
+        template <class... Hs>
+        struct Chain
+        {
+            static int command(crumbs_context_t &, uint8_t, const uint8_t *, uint8_t) { return 0; }
+            static int reply(crumbs_context_t &, uint8_t, crumbs_message_t &) { return 0; }
+        };
+    };
+
+} // namespace crumbs
+
+#endif /* CRUMBS_HPP */
@@ -5,6 +5,8 @@
 #include <stddef.h>
 
 #include "crumbs.h"
+#include "crumbs_transport.h"
+#include "crumbs_serial.h"
 
 /**
  * @file
@@ -14,6 +16,16 @@
 #ifdef __cplusplus
 extern "C"
 {
+#endif
+
+    /**
+     * @brief Number of TwoWire instances that can serve a peripheral context at once (1-4).
+     *
+     * Each bound bus uses one slot and one pair of Wire callbacks. Override
+     * through build_flags on boards with more hardware I2C ports.
+     */
+#ifndef CRUMBS_ARDUINO_MAX_BUSES
+#define CRUMBS_ARDUINO_MAX_BUSES 2
 #endif
 
     /**
@@ -27,6 +39,18 @@ extern "C"
      */
     void crumbs_arduino_init_controller(crumbs_context_t *ctx);
 
+    /**
+     * @brief Initialize a controller context on a specific TwoWire instance.
+     *
+     * Same as crumbs_arduino_init_controller() but calls begin() on @p wire.
+     * Pass the same TwoWire as the io argument of the controller calls.
+     * The context's transport is crumbs_arduino_transport with @p wire as io.
+     *
+     * @param ctx  Pointer to the CRUMBS context to initialize.
+     * @param wire Pointer to TwoWire instance or NULL to use &Wire.
+     */
+    void crumbs_arduino_init_controller_on(crumbs_context_t *ctx, void *wire);
+
     /**
      * @brief Initialize a CRUMBS context for use as an I2C peripheral on Arduino.
      *
@@ -44,6 +68,89 @@ extern "C"
      */
     void crumbs_arduino_init_peripheral(crumbs_context_t *ctx, uint8_t address);
 
+    /**
+     * @brief Initialize a peripheral context on a specific TwoWire instance.
+     *
+     * Binds @p ctx to @p wire in one of CRUMBS_ARDUINO_MAX_BUSES slots and
+     * registers that slot's onReceive/onRequest trampolines, so a board
+     * with several I2C ports (Wire, Wire1, ...) can answer as a different
+     * peripheral on each one. Calling it again for the same TwoWire
+     * rebinds the slot to the new context and address.
+     * crumbs_arduino_init_peripheral() is this call with &Wire.
+     *
+     * @param ctx     Pointer to the CRUMBS context to initialize.
+     * @param address I2C peripheral address (7-bit).
+     * @param wire    Pointer to TwoWire instance or NULL to use &Wire.
+     * @return Slot index (>= 0), or -1 if @p ctx is NULL or every slot is
+     *         bound to another TwoWire.
+     */
+    int crumbs_arduino_init_peripheral_on(crumbs_context_t *ctx, uint8_t address, void *wire);
+
+    /**
+     * @brief ACK the general-call address (0x00) as well as the own address.
+     *
+     * Needed to receive crumbs_controller_broadcast(); pair it with
+     * crumbs_peripheral_set_broadcast(). Call it after
+     * crumbs_arduino_init_peripheral(), since Wire.begin() rewrites the
+     * address register. Implemented on AVR (TWGCE in TWAR) for &Wire; other
+     * cores do not expose general-call reception through Wire.
+     *
+     * @param wire   TwoWire instance, or NULL for &Wire.
+     * @param enable Non-zero to ACK general calls.
+     * @return 0 on success, -1 when the platform cannot do it.
+     */
+    int crumbs_arduino_set_general_call(void *wire, int enable);
+
+    /**
+     * @brief Drive an open-drain attention pin (conforms to crumbs_attention_fn).
+     *
+     * Pulls the pin low while asserted and leaves it as an input
+     * otherwise, so several boards can share one ALERT# line with a
+     * pull-up on the controller side. Pass the pin number as user data:
+     *   crumbs_set_attention_pin(&ctx, crumbs_arduino_attention_pin, CRUMBS_ARDUINO_PIN(7));
+     *
+     * @param user_data Pin number wrapped with CRUMBS_ARDUINO_PIN().
+     * @param asserted  Non-zero to pull the line low.
+     */
+    void crumbs_arduino_attention_pin(void *user_data, int asserted);
+
+    /** @brief Wrap a pin number as crumbs_arduino_attention_pin() user data. */
+#define CRUMBS_ARDUINO_PIN(pin) ((void *)(uintptr_t)(pin))
+
+    /**
+     * @brief Set the TwoWire clock (conforms to crumbs_set_clock_fn).
+     *
+     * Pass it to crumbs_bus_clock_init() so negotiation can raise the bus
+     * to fast mode or fast-mode plus where the board supports it.
+     *
+     * @param user_ctx Pointer to TwoWire instance or NULL to use &Wire.
+     * @param hz       Clock in Hz.
+     * @return 0 on success, -1 if the core has no setClock().
+     */
+    int crumbs_arduino_set_clock(void *user_ctx, uint32_t hz);
+
+    /**
+     * @brief Free a stuck bus and restart Wire (conforms to crumbs_bus_recover_fn).
+     *
+     * For &Wire, ends the peripheral and runs crumbs_bus_clear() on the
+     * board's SDA/SCL pins (9 clocks and a STOP). Then it calls begin()
+     * again. Other TwoWire instances are only restarted, because their
+     * pins are not known. begin() restores the core's default clock, so
+     * call crumbs_arduino_set_clock() again if the bus ran faster.
+     *
+     * @param user_ctx Pointer to TwoWire instance or NULL to use &Wire.
+     * @return 0 on success, CRUMBS_RECOVER_E_STUCK if SDA stayed low.
+     */
+    int crumbs_arduino_bus_recover(void *user_ctx);
+
+    /**
+     * @brief Wire transport: crumbs_arduino_wire_write, crumbs_arduino_read
+     *        and crumbs_arduino_write_then_read, io = TwoWire* (NULL = &Wire).
+     *
+     * max_frame is the Wire buffer (BUFFER_LENGTH), capped at one CRUMBS frame.
+     */
+    extern const crumbs_transport_t crumbs_arduino_transport;
+
     /**
      * @brief Arduino implementation of crumbs_i2c_write_fn using Wire.
      *
@@ -120,6 +227,35 @@ extern "C"
                                        uint32_t timeout_us,
                                        int require_repeated_start);
 
+    /**
+     * @brief Serial stream for crumbs_serial_port_t (HardwareSerial or any Stream).
+     *
+     * The core's serial driver already buffers receive in its interrupt, so
+     * the port reads from the Stream; no ISR hook is needed.
+     */
+    typedef struct
+    {
+        void *stream; /**< Stream* (e.g. &Serial1). */
+        int de_pin;   /**< RS-485 driver-enable pin, or -1 for full duplex. */
+    } crumbs_arduino_serial_t;
+
+    /** @brief crumbs_serial_write_fn: raises de_pin, writes, flush(), lowers it. */
+    int crumbs_arduino_serial_write(void *user, const uint8_t *data, size_t len);
+
+    /** @brief crumbs_serial_read_fn: available bytes, waiting up to @p timeout_us for the first. */
+    int crumbs_arduino_serial_read(void *user, uint8_t *buf, size_t len, uint32_t timeout_us);
+
+    /**
+     * @brief Fill @p s and set up @p port on @p stream.
+     *
+     * The Stream must already be started (Serial1.begin(2000000)). The
+     * port's clock is micros().
+     */
+    void crumbs_arduino_serial_port(crumbs_serial_port_t *port,
+                                    crumbs_arduino_serial_t *s,
+                                    void *stream,
+                                    int de_pin);
+
     /**
      * @brief Arduino platform millisecond timer.
      * @return Milliseconds since boot.
@@ -0,0 +1,178 @@
+/**
+ * @file crumbs_bus_group.h
+ * @brief Parallel controller over several I2C adapters, one worker thread per bus.
+ *
+ * A crumbs_engine_t overlaps the reply delays of many devices, but all of
+ * its transfers still share one adapter. A bus group runs one engine per
+ * adapter, each on its own POSIX thread, so transfers on different buses
+ * happen at the same time.
+ *
+ * Requests are ordinary crumbs_request_t objects (see crumbs_engine.h).
+ * A request is routed to the bus whose io handle equals req->dev->io.
+ * Submitting is lock-free: the request is pushed onto that bus's inbox,
+ * and the worker takes the whole inbox at once. The bus mutex is used
+ * only to put an idle worker to sleep and to wake it.
+ *
+ * Completion callbacks run on the bus's worker thread. A callback may
+ * resubmit its request with crumbs_bus_group_submit().
+ *
+ * @code
+ * static crumbs_linux_i2c_t lw[3];  // /dev/i2c-1, -3, -4
+ * static crumbs_context_t ctx[3];   // one per bus, see below
+ * static crumbs_bus_group_t group;
+ *
+ * crumbs_bus_group_init(&group);
+ * for (i = 0; i < 3; i++)
+ *     crumbs_bus_group_add_bus(&group, &lw[i]);
+ * crumbs_bus_group_start(&group);
+ *
+ * crumbs_bus_group_submit_many(&group, reqs, n);  // devs[k].io = &lw[bus of k]
+ * crumbs_bus_group_wait(&group, 0);
+ * crumbs_bus_group_stop(&group);
+ * @endcode
+ *
+ * Devices on different buses may only share a crumbs_context_t if the
+ * library is built with CRUMBS_THREAD_SAFE=1, because decoding updates the
+ * context's CRC statistics. The same applies to latency tables, which are
+ * never locked: give each bus its own.
+ *
+ * Only available on Linux builds (requires pthreads).
+ */
+
+#ifndef CRUMBS_BUS_GROUP_H
+#define CRUMBS_BUS_GROUP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crumbs_engine.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /** @brief Maximum adapters per group. */
+#ifndef CRUMBS_BUS_GROUP_MAX
+#define CRUMBS_BUS_GROUP_MAX 4
+#endif
+
+#if defined(__linux__)
+
+    struct crumbs_bus_group_s;
+
+    /**
+     * @brief One adapter and its worker. All fields are managed by the group.
+     *
+     * inbox, pending and completed are shared with the worker and are only
+     * accessed with atomic operations.
+     */
+    typedef struct
+    {
+        void *io;                         /**< Bus handle matched against dev->io. */
+        struct crumbs_bus_group_s *group; /**< Owning group. */
+        crumbs_request_t *inbox;          /**< Lock-free submit stack (newest first). */
+        uint32_t pending;                 /**< Submitted, not yet completed. */
+        uint32_t completed;               /**< Requests completed since start. */
+        crumbs_engine_t eng;              /**< Worker-owned engine. */
+        pthread_t thread;                 /**< Worker thread. */
+        pthread_mutex_t lock;             /**< Guards sleeping only. */
+        pthread_cond_t wake;              /**< Signalled on submit-to-empty and stop. */
+    } crumbs_bus_t;
+
+    /**
+     * @brief A set of adapters driven in parallel.
+     */
+    typedef struct crumbs_bus_group_s
+    {
+        crumbs_bus_t buses[CRUMBS_BUS_GROUP_MAX]; /**< Registered buses. */
+        uint8_t count;                            /**< Buses in use. */
+        uint8_t running;                          /**< Workers started (atomic). */
+        uint8_t stopping;                         /**< Stop requested (atomic). */
+        uint32_t outstanding;                     /**< Requests in flight, all buses (atomic). */
+        pthread_mutex_t idle_lock;                /**< Guards idle_cond. */
+        pthread_cond_t idle_cond;                 /**< Broadcast when outstanding reaches 0. */
+    } crumbs_bus_group_t;
+
+    /**
+     * @brief Initialize an empty, stopped group.
+     *
+     * @return 0 on success, -1 on bad args or if a mutex could not be created.
+     */
+    int crumbs_bus_group_init(crumbs_bus_group_t *group);
+
+    /**
+     * @brief Register an adapter. Only allowed before crumbs_bus_group_start().
+     *
+     * @param io Bus handle (for example a crumbs_linux_i2c_t *); devices on
+     *           this bus must use the same pointer as their io.
+     * @return Bus index (>= 0), or -1 on bad args, a duplicate handle, a
+     *         full group, or a running group.
+     */
+    int crumbs_bus_group_add_bus(crumbs_bus_group_t *group, void *io);
+
+    /**
+     * @brief Start one worker thread per registered bus.
+     *
+     * @return 0 on success, -1 on bad args, no buses, already running, or
+     *         thread creation failure (no workers are left running).
+     */
+    int crumbs_bus_group_start(crumbs_bus_group_t *group);
+
+    /**
+     * @brief Queue a request on the bus that owns req->dev->io.
+     *
+     * Safe to call from any thread, including completion callbacks.
+     *
+     * @return 0 on success, -1 on bad args or if @p req is already queued,
+     *         -2 if no bus matches req->dev->io, -3 if the group is not running.
+     */
+    int crumbs_bus_group_submit(crumbs_bus_group_t *group, crumbs_request_t *req);
+
+    /**
+     * @brief Queue many requests, spread over their buses in one pass.
+     *
+     * Requests are grouped per bus and each bus's batch is published with a
+     * single atomic push and at most one wake-up. Each bus then works through
+     * its share while the other buses do the same. Order is kept within a bus.
+     *
+     * @return Number of requests queued. Requests that fail the checks of
+     *         crumbs_bus_group_submit() are skipped. Returns -3 if the group
+     *         is not running and -1 on bad args.
+     */
+    int crumbs_bus_group_submit_many(crumbs_bus_group_t *group, crumbs_request_t *reqs, size_t count);
+
+    /**
+     * @brief Block until every submitted request has completed.
+     *
+     * @param timeout_us Maximum wait; 0 waits forever.
+     * @return 0 when idle, -1 on bad args, -3 on timeout.
+     */
+    int crumbs_bus_group_wait(crumbs_bus_group_t *group, uint32_t timeout_us);
+
+    /**
+     * @brief Requests queued or in flight on one bus.
+     *
+     * @return The count, or 0 for an unknown bus.
+     */
+    uint32_t crumbs_bus_group_pending(const crumbs_bus_group_t *group, uint8_t bus);
+
+    /**
+     * @brief Let the workers finish their queues, then join them.
+     *
+     * New submissions are refused as soon as this is called. The group can
+     * be started again afterwards.
+     */
+    void crumbs_bus_group_stop(crumbs_bus_group_t *group);
+
+#endif /* defined(__linux__) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRUMBS_BUS_GROUP_H */
@@ -0,0 +1,188 @@
+/**
+ * @file crumbs_capture.h
+ * @brief Bus traffic capture into fixed-size binary records, and replay.
+ *
+ * A crumbs_capture_t sits between a controller context and its transport
+ * and records every transfer: one record per direction, with a timestamp,
+ * the address, the raw bytes, the primitive's result and whether the bytes
+ * decode as a CRUMBS frame. Records go to a sink callback (a file, a RAM
+ * buffer, a socket), so the same capture runs on the Linux HAL, the
+ * virtual bus or a microcontroller.
+ *
+ * On disk a capture is a 16-byte header followed by 48-byte records, all
+ * little-endian and appended in order. The file can be mmap()ed and
+ * indexed directly (crumbs_linux_capture.h):
+ *
+ *     header: "CRUMBCAP" [version:u16 = 1] [record_size:u16 = 48] [reserved:u32]
+ *     record: [t_us:u32] [seq:u32] [addr] [dir] [len] [decode:i8] [rc:i16] [reserved:u16] [data:32]
+ *
+ * Transfers longer than 32 bytes keep their full length in len and the
+ * first 32 bytes in data.
+ *
+ * A replay feeds captured writes back either directly into a peripheral
+ * context (crumbs_peripheral_handle_receive()) or onto a transport such as
+ * crumbs_vbus_transport, and compares captured replies with the new ones.
+ * With a delay function it keeps the captured spacing, without one it runs
+ * at full speed.
+ *
+ * @code
+ * static crumbs_capture_t cap;
+ * crumbs_linux_init_controller(&ctx, &lw, "/dev/i2c-1", 10000);
+ * crumbs_linux_capture_open(&file, "bus.cap");
+ * crumbs_capture_attach(&cap, &ctx, crumbs_linux_capture_sink, &file, crumbs_linux_loop_now_us);
+ * crumbs_device_init(&led, &ctx, 0x08, crumbs_linux_delay_us);   // captured from here on
+ * @endcode
+ */
+
+#ifndef CRUMBS_CAPTURE_H
+#define CRUMBS_CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_transport.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /** @brief File header size. */
+#define CRUMBS_CAPTURE_HEADER_SIZE 16u
+    /** @brief Encoded record size. */
+#define CRUMBS_CAPTURE_RECORD_SIZE 48u
+    /** @brief Raw bytes kept per record. */
+#define CRUMBS_CAPTURE_DATA_MAX 32u
+    /** @brief Format version written to the header. */
+#define CRUMBS_CAPTURE_VERSION 1u
+
+    /** @name Record Directions
+     *  @{ */
+#define CRUMBS_CAPTURE_TX 0x01u /**< Controller write. */
+#define CRUMBS_CAPTURE_RX 0x02u /**< Controller read (data = bytes received). */
+    /** @} */
+
+    /**
+     * @brief One captured transfer, decoded.
+     */
+    typedef struct
+    {
+        uint32_t t_us;                         /**< Capture clock at completion. */
+        uint32_t seq;                          /**< Record number since attach (gaps = dropped records). */
+        uint8_t addr;                          /**< 7-bit target. */
+        uint8_t dir;                           /**< CRUMBS_CAPTURE_TX / _RX. */
+        uint8_t len;                           /**< Bytes transferred (may exceed DATA_MAX). */
+        int8_t decode;                         /**< crumbs_decode_message() of data: 0 = valid frame. */
+        int16_t rc;                            /**< What the primitive returned. */
+        uint8_t data[CRUMBS_CAPTURE_DATA_MAX]; /**< First bytes. */
+    } crumbs_capture_record_t;
+
+    /**
+     * @brief Receives one encoded record (CRUMBS_CAPTURE_RECORD_SIZE bytes).
+     *
+     * @return 0 if stored; non-zero counts the record as dropped.
+     */
+    typedef int (*crumbs_capture_sink_fn)(void *user, const uint8_t *record);
+
+    /**
+     * @brief Capturing transport wrapped around another one.
+     */
+    typedef struct
+    {
+        crumbs_transport_t transport;  /**< What the context uses; caps mirror inner. */
+        const crumbs_transport_t *inner; /**< Wrapped transport. */
+        void *inner_io;                /**< Its io. */
+        crumbs_capture_sink_fn sink;   /**< Record destination. */
+        void *sink_user;               /**< Passed to sink. */
+        crumbs_clock_us_fn clock;      /**< Timestamps; NULL records 0. */
+        uint8_t paused;                /**< Non-zero: transfers pass through unrecorded. */
+        uint32_t seq;                  /**< Next record number. */
+        uint32_t dropped;              /**< Records the sink refused. */
+    } crumbs_capture_t;
+
+    /** @brief Encode the file header into @p out (CRUMBS_CAPTURE_HEADER_SIZE bytes). */
+    void crumbs_capture_header(uint8_t *out);
+
+    /**
+     * @brief Check a file header.
+     *
+     * @return 0 if @p buf starts with a version-1 header, -1 otherwise.
+     */
+    int crumbs_capture_check_header(const uint8_t *buf, size_t len);
+
+    /** @brief Encode @p rec into @p out (CRUMBS_CAPTURE_RECORD_SIZE bytes). */
+    void crumbs_capture_encode(const crumbs_capture_record_t *rec, uint8_t *out);
+
+    /** @brief Decode one record from @p in (CRUMBS_CAPTURE_RECORD_SIZE bytes). */
+    void crumbs_capture_decode(const uint8_t *in, crumbs_capture_record_t *rec);
+
+    /**
+     * @brief Wrap @p inner so its transfers are recorded.
+     *
+     * Set cap->transport on a context or device with @p cap as io.
+     *
+     * @return 0 on success, -1 on NULL arguments or an inner transport without send().
+     */
+    int crumbs_capture_init(crumbs_capture_t *cap,
+                            const crumbs_transport_t *inner, void *inner_io,
+                            crumbs_capture_sink_fn sink, void *sink_user,
+                            crumbs_clock_us_fn clock);
+
+    /**
+     * @brief Wrap the transport currently set on @p ctx and put the capture in its place.
+     *
+     * Devices initialized from @p ctx afterwards are captured too.
+     *
+     * @return 0 on success, -1 on NULL arguments or if @p ctx has no transport.
+     */
+    int crumbs_capture_attach(crumbs_capture_t *cap, crumbs_context_t *ctx,
+                              crumbs_capture_sink_fn sink, void *sink_user,
+                              crumbs_clock_us_fn clock);
+
+    /**
+     * @brief Replay target and results.
+     *
+     * Set exactly one of @c peripheral or @c bus.
+     */
+    typedef struct
+    {
+        crumbs_context_t *peripheral;  /**< Feed writes to this context (its address only). */
+        const crumbs_transport_t *bus; /**< Or re-issue every record on this transport. */
+        void *bus_io;                  /**< io for bus. */
+        crumbs_delay_fn delay;         /**< Non-NULL: wait out the captured spacing. */
+        uint32_t last_us;              /**< t_us of the previous record. */
+        uint8_t started;               /**< last_us is valid. */
+        uint32_t replayed;             /**< Records fed to the target. */
+        uint32_t skipped;              /**< Other addresses (peripheral mode) or failed captures. */
+        uint32_t errors;               /**< Replay transfers that failed. */
+        uint32_t mismatches;           /**< Replies that differ from the captured ones. */
+    } crumbs_capture_replay_t;
+
+    /** @brief Zero @p r; then set its target. */
+    void crumbs_capture_replay_init(crumbs_capture_replay_t *r);
+
+    /**
+     * @brief Replay one record.
+     *
+     * Records are used as captured: a transfer that failed then, or
+     * a write that was not a valid frame (peripheral mode), is skipped.
+     * Reads fetch the captured length and compare the bytes.
+     *
+     * @return 0 if replayed or skipped, 1 on a reply mismatch, negative if the
+     *         replay transfer failed or @p r has no target.
+     */
+    int crumbs_capture_replay_record(crumbs_capture_replay_t *r, const crumbs_capture_record_t *rec);
+
+    /**
+     * @brief Replay @p count encoded records stored back to back in @p records.
+     *
+     * @return Number of records that mismatched or failed, or -1 on bad args.
+     */
+    int crumbs_capture_replay(crumbs_capture_replay_t *r, const uint8_t *records, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRUMBS_CAPTURE_H */
@@ -0,0 +1,116 @@
+/**
+ * @file crumbs_clock.h
+ * @brief Bus clock negotiation and CRC-driven fallback for controllers.
+ *
+ * Peripherals advertise the fastest clock they tolerate in their
+ * CAPABILITIES reply (crumbs_set_max_bus_clock()). A crumbs_bus_clock_t
+ * queries every device on a segment at standard mode, then raises the bus
+ * to the fastest standard rate (100 kHz, 400 kHz or 1 MHz) that all of
+ * them and the host accept. Devices that do not answer, or that predate
+ * the field, count as 100 kHz.
+ *
+ * A faster clock is only worth it while frames arrive intact. Call
+ * crumbs_bus_clock_check() periodically: when the controller context has
+ * seen CRUMBS_BUS_CLOCK_CRC_LIMIT or more CRC errors since the previous
+ * check, the bus drops one rate and stays there until the next
+ * negotiation.
+ *
+ * The clock itself is changed through a crumbs_set_clock_fn supplied by
+ * the platform (crumbs_arduino_set_clock() on Arduino). Linux i2c-dev has
+ * no runtime clock control; pass NULL there and apply the negotiated rate
+ * through the device tree.
+ *
+ * @code
+ * static crumbs_bus_clock_t clk;
+ * crumbs_bus_clock_init(&clk, &ctx, crumbs_arduino_set_clock, &Wire, 0u);
+ * crumbs_bus_clock_negotiate(&clk, devices, device_count);
+ *
+ * // once a second from loop():
+ * crumbs_bus_clock_check(&clk);
+ * @endcode
+ */
+
+#ifndef CRUMBS_CLOCK_H
+#define CRUMBS_CLOCK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /** @brief CRC errors between two checks that trigger a step down. */
+#ifndef CRUMBS_BUS_CLOCK_CRC_LIMIT
+#define CRUMBS_BUS_CLOCK_CRC_LIMIT 3u
+#endif
+
+    /**
+     * @brief Platform hook that sets the bus clock.
+     *
+     * @param io Bus handle (e.g. TwoWire*).
+     * @param hz Clock in Hz.
+     * @return 0 on success, non-zero if the rate could not be applied.
+     */
+    typedef int (*crumbs_set_clock_fn)(void *io, uint32_t hz);
+
+    /**
+     * @brief Negotiated clock state for one bus segment.
+     */
+    typedef struct
+    {
+        crumbs_context_t *ctx;         /**< Controller context whose CRC errors are watched. */
+        crumbs_set_clock_fn set_clock; /**< Clock hook (NULL = compute only). */
+        void *io;                      /**< Passed to set_clock. */
+        uint32_t host_max_hz;          /**< Fastest clock the host supports. */
+        uint32_t ceiling_hz;           /**< Fastest clock allowed until the next negotiation. */
+        uint32_t current_hz;           /**< Clock in effect. */
+        uint32_t crc_mark;             /**< ctx CRC error count at the last check. */
+        uint16_t fallbacks;            /**< Step-downs since init. */
+    } crumbs_bus_clock_t;
+
+    /**
+     * @brief Initialize at standard mode without touching the bus.
+     *
+     * @param clk         State to initialize.
+     * @param ctx         Controller context used for the bus.
+     * @param set_clock   Clock hook (may be NULL).
+     * @param io          Passed to @p set_clock.
+     * @param host_max_hz Fastest clock the host supports (0 = 1 MHz).
+     */
+    void crumbs_bus_clock_init(crumbs_bus_clock_t *clk,
+                               crumbs_context_t *ctx,
+                               crumbs_set_clock_fn set_clock,
+                               void *io,
+                               uint32_t host_max_hz);
+
+    /**
+     * @brief Query every device and raise the bus to the common fastest rate.
+     *
+     * The queries run at 100 kHz. The result is the fastest standard rate
+     * not above the host limit or any device's advertised clock.
+     *
+     * @param devs  Devices on the segment (write_fn, read_fn and delay_fn required).
+     * @param count Number of devices.
+     * @return Chosen clock in Hz (> 0), -1 on bad args, or the set_clock error.
+     */
+    int32_t crumbs_bus_clock_negotiate(crumbs_bus_clock_t *clk,
+                                       const crumbs_device_t *devs,
+                                       size_t count);
+
+    /**
+     * @brief Step the bus down one rate if CRC errors climbed since the last check.
+     *
+     * @return 1 if the clock was lowered, 0 if unchanged, -1 on bad args,
+     *         or the set_clock error.
+     */
+    int crumbs_bus_clock_check(crumbs_bus_clock_t *clk);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRUMBS_CLOCK_H */
@@ -19,6 +19,43 @@ extern "C"
      */
     typedef uint8_t crumbs_crc8_t;
 
+    /** @name CRC-8 Back Ends
+     *  Values accepted by CRUMBS_CRC_BACKEND.
+     *  @{ */
+#define CRUMBS_CRC_BACKEND_NIBBLE 0 /**< pycrc 16-entry table, two lookups per byte (default). */
+#define CRUMBS_CRC_BACKEND_BYTE 1   /**< 256-byte table, one lookup per byte. */
+#define CRUMBS_CRC_BACKEND_SLICE4 2 /**< Slice-by-4, 1 KiB of tables. */
+#define CRUMBS_CRC_BACKEND_SLICE8 3 /**< Slice-by-8, 2 KiB of tables. */
+#define CRUMBS_CRC_BACKEND_HW 4     /**< Application-supplied crumbs_crc8_hw_update(). */
+    /** @} */
+
+    /**
+     * @brief Select the CRC-8 implementation used by crumbs_crc8().
+     *
+     * All back ends produce identical results; they trade table size for
+     * speed:
+     *
+     * - CRUMBS_CRC_BACKEND_NIBBLE: 16-byte table. Smallest; right for AVR.
+     * - CRUMBS_CRC_BACKEND_BYTE: 256-byte table (PROGMEM on AVR).
+     * - CRUMBS_CRC_BACKEND_SLICE4 / _SLICE8: 4 or 8 independent lookups per
+     *   step, for 32/64-bit hosts (Linux, ESP32) with cache to spare.
+     * - CRUMBS_CRC_BACKEND_HW: calls crumbs_crc8_hw_update(), which the
+     *   application implements, e.g. on an STM32 CRC peripheral configured
+     *   for 8-bit polynomial 0x07 with the initial value set to @p crc.
+     *
+     * Only affects src/crc/crumbs_crc.c, but on Arduino/PlatformIO it still
+     * has to reach that file, so set it through build_flags:
+     *   build_flags = -DCRUMBS_CRC_BACKEND=1
+     */
+#ifndef CRUMBS_CRC_BACKEND
+#define CRUMBS_CRC_BACKEND CRUMBS_CRC_BACKEND_NIBBLE
+#endif
+
+#if (CRUMBS_CRC_BACKEND < CRUMBS_CRC_BACKEND_NIBBLE) || \
+    (CRUMBS_CRC_BACKEND > CRUMBS_CRC_BACKEND_HW)
+#error "CRUMBS_CRC_BACKEND must be CRUMBS_CRC_BACKEND_NIBBLE, _BYTE, _SLICE4, _SLICE8 or _HW"
+#endif
+
     /**
      * @brief Compute CRC-8 over a contiguous buffer.
      *
@@ -31,6 +68,54 @@ extern "C"
      */
     crumbs_crc8_t crumbs_crc8(const uint8_t *data, size_t len);
 
+    /**
+     * @brief Start an incremental CRC-8 computation.
+     *
+     * Pair with crumbs_crc8_update() and crumbs_crc8_final() to CRC data as it
+     * arrives (e.g. byte by byte in an I2C receive loop).
+     *
+     * @return Initial running CRC value.
+     */
+    crumbs_crc8_t crumbs_crc8_init(void);
+
+    /**
+     * @brief Continue a CRC-8 computation over another chunk of bytes.
+     *
+     * Start from crumbs_crc8_init() (the CRUMBS init value is 0). Feeding a
+     * buffer in several chunks yields the same result as one crumbs_crc8()
+     * call.
+     *
+     * @param crc Running CRC from crumbs_crc8_init() or a previous update.
+     * @param data Pointer to input bytes (may be NULL only when len == 0).
+     * @param len Number of bytes to process.
+     * @return Updated CRC-8 value.
+     */
+    crumbs_crc8_t crumbs_crc8_update(crumbs_crc8_t crc, const uint8_t *data, size_t len);
+
+    /**
+     * @brief Finish an incremental CRC-8 computation.
+     *
+     * @param crc Running CRC from crumbs_crc8_update().
+     * @return Final CRC-8 value, comparable with the frame's CRC byte.
+     */
+    crumbs_crc8_t crumbs_crc8_final(crumbs_crc8_t crc);
+
+#if CRUMBS_CRC_BACKEND == CRUMBS_CRC_BACKEND_HW
+    /**
+     * @brief Hardware CRC hook (provided by the application).
+     *
+     * Required when CRUMBS_CRC_BACKEND == CRUMBS_CRC_BACKEND_HW. Must
+     * continue a CRC-8 (poly 0x07, no reflection, no final XOR) from @p crc
+     * over @p len bytes. May be called from the I2C receive ISR.
+     *
+     * @param crc Running CRC (0 at the start of a frame).
+     * @param data Input bytes (never NULL; len > 0).
+     * @param len Number of bytes to process.
+     * @return Updated CRC-8 value.
+     */
+    crumbs_crc8_t crumbs_crc8_hw_update(crumbs_crc8_t crc, const uint8_t *data, size_t len);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
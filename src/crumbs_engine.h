@@ -0,0 +1,241 @@
+/**
+ * @file crumbs_engine.h
+ * @brief Non-blocking controller request engine for GET operations.
+ *
+ * A blocking GET (SET_REPLY write, CRUMBS_DEFAULT_QUERY_DELAY_US sleep,
+ * read) spends almost all of its time sleeping, one device after another.
+ * The engine keeps a queue of caller-owned requests and is advanced by
+ * crumbs_engine_poll(): every poll writes SET_REPLY to each device still
+ * waiting for one and reads each device whose delay has elapsed, so the
+ * delays of many devices overlap instead of adding up.
+ *
+ * No allocation: requests are intrusive list nodes owned by the caller and
+ * must stay alive until their completion callback has run. Requests to the
+ * same device (same bus handle and address) are serialized; the second
+ * SET_REPLY is only written after the first reply was read.
+ *
+ * Requests run in one of two lanes. CRUMBS_LANE_CONTROL requests (the
+ * default for commands queued with crumbs_request_init_send()) are queued
+ * ahead of every CRUMBS_LANE_TELEMETRY request, so they go out at the next
+ * transfer instead of after a whole sweep. If a telemetry GET to the same
+ * device is already past its SET_REPLY, it is postponed: the control
+ * request goes first and the GET writes SET_REPLY again afterwards.
+ *
+ * @code
+ * static crumbs_engine_t eng;
+ * static crumbs_request_t reqs[12];
+ *
+ * crumbs_engine_init(&eng);
+ * for (i = 0; i < 12; i++)
+ * {
+ *     crumbs_request_init(&reqs[i], &devs[i], THERM_OP_GET_TEMP, on_temp, NULL);
+ *     crumbs_engine_submit(&eng, &reqs[i]);
+ * }
+ * while (crumbs_engine_poll(&eng, micros()) > 0)
+ * {
+ *     do_other_work();
+ * }
+ * @endcode
+ */
+
+#ifndef CRUMBS_ENGINE_H
+#define CRUMBS_ENGINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_latency.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    struct crumbs_request_s;
+
+    /**
+     * @brief Completion callback for an engine request.
+     *
+     * Called from crumbs_engine_poll() after the request has left the
+     * queue, so the callback may resubmit it (periodic polling).
+     *
+     * @param req    The finished request; req->reply holds the reply on success.
+     * @param status 0 on success, -1 on a malformed or mismatched reply,
+     *               -3 if the peripheral stayed NOT_READY too long,
+     *               CRUMBS_REQ_CANCELLED if it was cancelled,
+     *               otherwise the write/read error code.
+     */
+    typedef void (*crumbs_request_cb)(struct crumbs_request_s *req, int status);
+
+    /** @name Request State
+     *  @{ */
+#define CRUMBS_REQ_IDLE 0    /**< Not queued. */
+#define CRUMBS_REQ_QUEUED 1  /**< Waiting to write SET_REPLY. */
+#define CRUMBS_REQ_WAITING 2 /**< SET_REPLY written; waiting for the reply delay. */
+#define CRUMBS_REQ_POLLING 3 /**< Peripheral answered NOT_READY; re-reading shortly. */
+#define CRUMBS_REQ_HANDOFF 4 /**< Handed to a bus group, not yet in its engine. */
+    /** @} */
+
+    /** @brief Completion status of a request removed by crumbs_engine_cancel(). */
+#define CRUMBS_REQ_CANCELLED (-4)
+
+    /** @name Priority Lanes
+     *  @{ */
+#define CRUMBS_LANE_TELEMETRY 0 /**< Bulk polling (default for GETs). */
+#define CRUMBS_LANE_CONTROL 1   /**< Urgent commands; queued ahead of telemetry. */
+#define CRUMBS_ENGINE_LANES 2   /**< Number of lanes. */
+    /** @} */
+
+    /**
+     * @brief One asynchronous GET: SET_REPLY(opcode), delay, read.
+     *
+     * Fill it with crumbs_request_init(); delay_us, reply_len (default
+     * CRUMBS_MAX_PAYLOAD) and lane may be set before submitting. Left at 0, each attempt waits the device's learned delay
+     * (dev->latency, see crumbs_latency.h) or CRUMBS_DEFAULT_QUERY_DELAY_US,
+     * and the outcome of the first read is reported back to the estimator.
+     * A CRUMBS_CMD_NOT_READY reply is re-read every
+     * CRUMBS_READY_POLL_INTERVAL_US for up to CRUMBS_READY_POLL_TIMEOUT_US,
+     * after which the request completes with -3. The remaining fields are
+     * managed by the engine.
+     *
+     * A request filled with crumbs_request_init_send() carries a command
+     * instead: it writes @c cmd once and completes, with no reply.
+     */
+    typedef struct crumbs_request_s
+    {
+        const crumbs_device_t *dev; /**< Target device (write_fn and read_fn required). */
+        crumbs_request_cb on_done;  /**< Completion callback (may be NULL). */
+        void *user_data;            /**< Opaque pointer for the callback. */
+        uint32_t delay_us;          /**< SET_REPLY-to-read delay; 0 = crumbs_device_query_delay(). */
+        uint8_t opcode;             /**< Opcode requested with SET_REPLY. */
+        uint8_t state;              /**< CRUMBS_REQ_* (engine-managed). */
+        uint8_t reply_len;          /**< Largest expected payload; reads 4 + reply_len bytes. */
+        uint8_t lane;               /**< CRUMBS_LANE_* priority class. */
+        uint8_t stamped;            /**< start_us is set (engine-managed). */
+        const crumbs_message_t *cmd; /**< Command to write (send requests), else NULL. */
+        uint32_t start_us;          /**< First poll that saw the request (engine-managed). */
+        uint32_t wait_us;           /**< Delay applied to the current attempt (engine-managed). */
+        uint32_t due_us;            /**< Time the read becomes due (engine-managed). */
+        uint32_t poll_us;           /**< NOT_READY polling so far (engine-managed). */
+        struct crumbs_request_s *next; /**< Queue link (engine-managed). */
+        crumbs_message_t reply;     /**< Decoded reply, valid when status == 0. */
+    } crumbs_request_t;
+
+    /**
+     * @brief Per-lane counters. Latency runs from the first poll that saw a
+     *        request to its completion.
+     */
+    typedef struct
+    {
+        uint32_t completed;       /**< Requests completed (any status). */
+        uint32_t postponed;       /**< GETs sent back to SET_REPLY for a control request. */
+        uint32_t cancelled;       /**< Requests removed by crumbs_engine_cancel(). */
+        uint32_t last_latency_us; /**< Latency of the last completion. */
+        uint32_t max_latency_us;  /**< Worst latency. */
+    } crumbs_lane_stats_t;
+
+    /**
+     * @brief Queue of in-flight requests: control lane first, FIFO within a lane.
+     *
+     * With group_io set, a new request is queued right after the last one
+     * of its lane on the same dev->io instead of at the end of the lane.
+     * A poll round then visits each io once, which saves the select write
+     * between channels behind an I2C mux (crumbs_mux.h).
+     */
+    typedef struct
+    {
+        crumbs_request_t *head; /**< First request (oldest control, else oldest telemetry). */
+        crumbs_request_t *tail; /**< Newest request. */
+        crumbs_lane_stats_t lanes[CRUMBS_ENGINE_LANES]; /**< Counters per CRUMBS_LANE_*. */
+        uint8_t group_io;       /**< Non-zero: group each lane by dev->io (0 after init). */
+    } crumbs_engine_t;
+
+    /**
+     * @brief Initialize an empty engine.
+     */
+    void crumbs_engine_init(crumbs_engine_t *eng);
+
+    /**
+     * @brief Prepare a request (does not queue it).
+     *
+     * @param req     Request to fill.
+     * @param dev     Target device.
+     * @param opcode  Opcode to request with SET_REPLY.
+     * @param on_done Completion callback (may be NULL).
+     * @param user_data Stored in req->user_data.
+     */
+    void crumbs_request_init(crumbs_request_t *req,
+                             const crumbs_device_t *dev,
+                             uint8_t opcode,
+                             crumbs_request_cb on_done,
+                             void *user_data);
+
+    /**
+     * @brief Prepare a command request in the control lane (does not queue it).
+     *
+     * @param req     Request to fill.
+     * @param dev     Target device.
+     * @param cmd     Message to write; must stay valid until completion.
+     * @param on_done Completion callback (may be NULL); status 0 once written.
+     * @param user_data Stored in req->user_data.
+     */
+    void crumbs_request_init_send(crumbs_request_t *req,
+                                  const crumbs_device_t *dev,
+                                  const crumbs_message_t *cmd,
+                                  crumbs_request_cb on_done,
+                                  void *user_data);
+
+    /**
+     * @brief Queue a request at the end of its lane. Nothing is sent until the next poll.
+     *
+     * @return 0 on success, -1 on bad args, missing write_fn/read_fn (read_fn
+     *         is not needed for send requests), an unknown lane, or if
+     *         @p req is already queued.
+     */
+    int crumbs_engine_submit(crumbs_engine_t *eng, crumbs_request_t *req);
+
+    /**
+     * @brief Remove a queued request; its callback runs with CRUMBS_REQ_CANCELLED.
+     *
+     * Not for use from a completion callback (the poll is walking the queue).
+     *
+     * @return 0 on success, -1 if @p req is not queued on @p eng.
+     */
+    int crumbs_engine_cancel(crumbs_engine_t *eng, crumbs_request_t *req);
+
+    /**
+     * @brief Cancel every request queued in @p lane (for example all telemetry).
+     *
+     * Callbacks run after the lane has been emptied, so they may resubmit.
+     * Like crumbs_engine_cancel(), not for use from a completion callback.
+     *
+     * @return Number of requests cancelled, or -1 on bad args.
+     */
+    int crumbs_engine_cancel_lane(crumbs_engine_t *eng, uint8_t lane);
+
+    /**
+     * @brief Advance all requests: write pending SET_REPLYs, read due replies.
+     *
+     * Never blocks beyond the I2C transfers themselves. Call it from the main
+     * loop with a free-running microsecond clock (wraparound is handled).
+     *
+     * @param eng    Engine.
+     * @param now_us Current time in microseconds.
+     * @return Number of requests still queued (0 when idle), or -1 if @p eng is NULL.
+     */
+    int crumbs_engine_poll(crumbs_engine_t *eng, uint32_t now_us);
+
+    /**
+     * @brief Microseconds until the next poll can make progress.
+     *
+     * @return 0 if a poll would do work now, UINT32_MAX if the queue is
+     *         empty, otherwise the time until the earliest read is due.
+     */
+    uint32_t crumbs_engine_idle_us(const crumbs_engine_t *eng, uint32_t now_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRUMBS_ENGINE_H */
@@ -0,0 +1,227 @@
+/**
+ * @file crumbs_esp_idf.h
+ * @brief Native ESP-IDF HAL: i2c_master controller, i2c_slave peripheral, FreeRTOS tasks.
+ *
+ * Replaces the Arduino Wire shim on ESP32 builds that use ESP-IDF
+ * directly (v5.2 or later). The controller side keeps one i2c_master
+ * device handle per address and provides the crumbs_i2c_*_fn primitives
+ * and crumbs_esp_transport; waits are FreeRTOS blocking calls with a
+ * timeout rather than spin loops.
+ *
+ * crumbs_esp_engine_start() runs a crumbs_engine_t in a task pinned to
+ * one core. Other tasks hand it requests through a queue and return at
+ * once; the task sleeps until the engine's next read is due, and
+ * completion callbacks run in it.
+ *
+ * crumbs_esp_init_peripheral() serves a peripheral context from the
+ * i2c_slave driver: its receive and request callbacks post events to a
+ * queue, and a task pinned to the given core dispatches the frames and
+ * writes the replies, so handlers run in task context, not in the ISR.
+ * It needs the version 2 slave driver
+ * (CONFIG_I2C_ENABLE_SLAVE_DRIVER_VERSION_2, ESP-IDF 5.4+).
+ *
+ * @code
+ * static crumbs_esp_i2c_t i2c;
+ * static crumbs_esp_engine_task_t engine;
+ *
+ * crumbs_esp_init_controller(&ctx, &i2c, I2C_NUM_0, 21, 22, 400000u);
+ * crumbs_device_init(&therm, &ctx, 0x20, crumbs_esp_delay_us);
+ * crumbs_esp_engine_start(&engine, 1, 5);
+ * crumbs_request_init(&req, &therm, THERM_OP_GET_TEMP, on_temp, NULL);
+ * crumbs_esp_engine_submit(&engine, &req);   // from any task
+ * @endcode
+ *
+ * Only compiled for ESP-IDF builds (ESP_PLATFORM without ARDUINO);
+ * Arduino-ESP32 sketches keep using crumbs_arduino.h.
+ */
+
+#ifndef CRUMBS_ESP_IDF_H
+#define CRUMBS_ESP_IDF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_engine.h"
+#include "crumbs_transport.h"
+
+#if defined(ESP_PLATFORM) && !defined(ARDUINO)
+
+#include "driver/i2c_master.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+#if CONFIG_I2C_ENABLE_SLAVE_DRIVER_VERSION_2
+#include "driver/i2c_slave.h"
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /** @brief Device handles kept per controller bus. */
+#ifndef CRUMBS_ESP_IDF_MAX_DEVICES
+#define CRUMBS_ESP_IDF_MAX_DEVICES 16
+#endif
+
+    /** @brief Transfer timeout when the caller passes 0, in milliseconds. */
+#ifndef CRUMBS_ESP_IDF_TIMEOUT_MS
+#define CRUMBS_ESP_IDF_TIMEOUT_MS 20
+#endif
+
+    /** @brief Requests the engine task's queue holds. */
+#ifndef CRUMBS_ESP_IDF_SUBMIT_DEPTH
+#define CRUMBS_ESP_IDF_SUBMIT_DEPTH 16
+#endif
+
+    /** @brief Slave events (frames and read requests) queued for the peripheral task. */
+#ifndef CRUMBS_ESP_IDF_EVENT_DEPTH
+#define CRUMBS_ESP_IDF_EVENT_DEPTH 8
+#endif
+
+    /** @brief Stack of the engine and peripheral tasks, in bytes. */
+#ifndef CRUMBS_ESP_IDF_TASK_STACK
+#define CRUMBS_ESP_IDF_TASK_STACK 4096
+#endif
+
+    /**
+     * @brief Controller bus and its per-address device handles.
+     */
+    typedef struct
+    {
+        i2c_master_bus_handle_t bus; /**< Created by init_controller or supplied by the caller. */
+        uint32_t scl_hz;             /**< Clock of every device handle. */
+        uint8_t owns_bus;            /**< crumbs_esp_close() deletes the bus. */
+        uint8_t dev_count;           /**< Used entries of devs. */
+        struct
+        {
+            uint8_t addr;                   /**< 7-bit address. */
+            i2c_master_dev_handle_t handle; /**< Driver handle. */
+        } devs[CRUMBS_ESP_IDF_MAX_DEVICES]; /**< Added lazily on first transfer. */
+    } crumbs_esp_i2c_t;
+
+    /**
+     * @brief Create an I2C master bus and make @p ctx a controller on it.
+     *
+     * crumbs_init() as controller, i2c_new_master_bus() with the internal
+     * pull-ups enabled, then the context's transport is crumbs_esp_transport
+     * with @p i2c as io.
+     *
+     * @return 0 on success, -1 on bad args, -2 if the driver refuses the bus.
+     */
+    int crumbs_esp_init_controller(crumbs_context_t *ctx, crumbs_esp_i2c_t *i2c,
+                                   i2c_port_num_t port, int sda, int scl, uint32_t scl_hz);
+
+    /**
+     * @brief Make @p ctx a controller on a bus created elsewhere (shared with other drivers).
+     *
+     * @return 0 on success, -1 on bad args.
+     */
+    int crumbs_esp_attach_controller(crumbs_context_t *ctx, crumbs_esp_i2c_t *i2c,
+                                     i2c_master_bus_handle_t bus, uint32_t scl_hz);
+
+    /** @brief Remove the device handles and, if created by init_controller, the bus. */
+    void crumbs_esp_close(crumbs_esp_i2c_t *i2c);
+
+    /**
+     * @brief crumbs_i2c_write_fn; @p user_ctx is the crumbs_esp_i2c_t.
+     *
+     * @return 0 on success, -1 on bad args, -2 if no device handle is
+     *         available, -3 on NACK, timeout or bus error.
+     */
+    int crumbs_esp_i2c_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len);
+
+    /** @brief crumbs_i2c_read_fn; returns @p len or a crumbs_esp_i2c_write() error. */
+    int crumbs_esp_i2c_read(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len,
+                            uint32_t timeout_us);
+
+    /** @brief crumbs_i2c_write_read_fn with a repeated START (i2c_master_transmit_receive()). */
+    int crumbs_esp_i2c_write_read(void *user_ctx, uint8_t addr, const uint8_t *tx, size_t tx_len,
+                                  uint8_t *rx, size_t rx_len, uint32_t timeout_us,
+                                  int require_repeated_start);
+
+    /** @brief crumbs_i2c_scan_fn using i2c_master_probe() (address-only, so @p strict is ignored). */
+    int crumbs_esp_scan(void *user_ctx, uint8_t start_addr, uint8_t end_addr, int strict,
+                        uint8_t *found, size_t max_found);
+
+    /** @brief i2c_master transport for crumbs_set_transport(); io = crumbs_esp_i2c_t. */
+    extern const crumbs_transport_t crumbs_esp_transport;
+
+    /** @brief Microseconds from esp_timer (conforms to crumbs_clock_us_fn). */
+    uint32_t crumbs_esp_now_us(void);
+
+    /**
+     * @brief Delay (conforms to crumbs_delay_fn).
+     *
+     * Yields with vTaskDelay() for whole ticks and busy-waits only the
+     * remainder, so other tasks run during SET_REPLY delays.
+     */
+    void crumbs_esp_delay_us(uint32_t us);
+
+    /**
+     * @brief Engine driven by a pinned FreeRTOS task.
+     */
+    typedef struct
+    {
+        crumbs_engine_t eng;   /**< Touched only by the task once started. */
+        QueueHandle_t submit;  /**< crumbs_request_t * from other tasks. */
+        TaskHandle_t task;     /**< NULL until started. */
+        uint32_t polls;        /**< crumbs_engine_poll() calls. */
+        uint32_t rejected;     /**< Requests the engine refused (completed with -1). */
+    } crumbs_esp_engine_task_t;
+
+    /**
+     * @brief Initialize the engine and start its task on @p core.
+     *
+     * @param core     Core to pin the task to (0 or 1; tskNO_AFFINITY for either).
+     * @param priority FreeRTOS priority.
+     * @return 0 on success, -1 on bad args, -2 if the queue or task cannot be created.
+     */
+    int crumbs_esp_engine_start(crumbs_esp_engine_task_t *t, int core, UBaseType_t priority);
+
+    /**
+     * @brief Queue @p req for the engine task; returns without waiting for the bus.
+     *
+     * Completion callbacks run in the engine task and may call
+     * crumbs_engine_submit() on t->eng directly to resubmit.
+     *
+     * @return 0 if queued, -1 on bad args or a full queue.
+     */
+    int crumbs_esp_engine_submit(crumbs_esp_engine_task_t *t, crumbs_request_t *req);
+
+    /**
+     * @brief Slave device serving one peripheral context.
+     */
+    typedef struct
+    {
+        crumbs_context_t *ctx; /**< Served context. */
+        void *dev;             /**< i2c_slave_dev_handle_t. */
+        QueueHandle_t events;  /**< ISR-to-task events. */
+        TaskHandle_t task;     /**< Dispatch task. */
+        uint32_t frames;       /**< Frames passed to crumbs_peripheral_handle_receive(). */
+        uint32_t replies;      /**< Replies written for read requests. */
+        uint32_t overruns;     /**< Events lost because the queue was full. */
+    } crumbs_esp_peripheral_t;
+
+    /**
+     * @brief crumbs_init() @p ctx as a peripheral at @p address and serve it from the slave driver.
+     *
+     * @param core     Core to pin the dispatch task to.
+     * @param priority FreeRTOS priority of the dispatch task.
+     * @return 0 on success, -1 on bad args or without the version 2 slave
+     *         driver, -2 if the driver, queue or task cannot be created.
+     */
+    int crumbs_esp_init_peripheral(crumbs_esp_peripheral_t *p, crumbs_context_t *ctx,
+                                   uint8_t address, i2c_port_num_t port, int sda, int scl,
+                                   int core, UBaseType_t priority);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* defined(ESP_PLATFORM) && !defined(ARDUINO) */
+
+#endif /* CRUMBS_ESP_IDF_H */
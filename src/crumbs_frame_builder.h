@@ -0,0 +1,231 @@
+/**
+ * @file crumbs_frame_builder.h
+ * @brief In-place frame builder that encodes straight into the wire buffer.
+ *
+ * crumbs_message_helpers.h builds a crumbs_message_t, which
+ * crumbs_controller_send() then copies into a stack frame and CRCs in a
+ * second pass. The frame builder skips the intermediate message: each
+ * append stores its bytes at their final wire offset and folds them into a
+ * running CRC, so a send touches every payload byte exactly once.
+ *
+ * The surface mirrors crumbs_msg_add_*(): same value encodings
+ * (little-endian integers, native-order float), same 0 / -1 returns.
+ *
+ * @code
+ * crumbs_frame_builder_t fb;
+ * crumbs_fb_init(&fb, MY_TYPE_ID, MY_CMD);
+ * crumbs_fb_add_u8(&fb, index);
+ * crumbs_fb_add_u16(&fb, value);
+ * crumbs_controller_send_frame(&ctx, addr, &fb, write_fn, io);
+ * @endcode
+ */
+
+#ifndef CRUMBS_FRAME_BUILDER_H
+#define CRUMBS_FRAME_BUILDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "crumbs_crc.h"
+#include "crumbs_message.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Frame under construction, laid out exactly as it goes on the wire.
+     *
+     * frame[2] (data_len) and the trailing CRC byte are only valid after
+     * crumbs_fb_finish(). Treat the fields as read-only outside this header.
+     */
+    typedef struct crumbs_frame_builder_s
+    {
+        uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE]; /**< Wire bytes: header, payload, CRC. */
+        uint8_t data_len;                       /**< Payload bytes appended so far. */
+        crumbs_crc8_t crc;                      /**< Running CRC with data_len taken as 0. */
+    } crumbs_frame_builder_t;
+
+    /**
+     * @brief Finalize the frame: patch data_len and append the CRC.
+     *
+     * The running CRC is computed with a zero data_len byte because the final
+     * length is unknown until the last append. CRUMBS' CRC-8 is linear
+     * (init 0, no final XOR), so the real CRC is the running value XOR a
+     * constant that depends only on data_len; finishing is O(1).
+     *
+     * May be called more than once; appending after finish is allowed and a
+     * later finish produces the updated frame.
+     *
+     * @param fb Builder initialized with crumbs_fb_init().
+     * @return Frame length in bytes (4 + data_len), or 0 if @p fb is NULL.
+     */
+    size_t crumbs_fb_finish(crumbs_frame_builder_t *fb);
+
+    /**
+     * @brief Start a new frame with the given header.
+     *
+     * @param fb      Builder to initialize.
+     * @param type_id Device/module type identifier.
+     * @param opcode  Command opcode.
+     */
+    static inline void crumbs_fb_init(crumbs_frame_builder_t *fb,
+                                      uint8_t type_id,
+                                      uint8_t opcode)
+    {
+        fb->frame[0] = type_id;
+        fb->frame[1] = opcode;
+        fb->frame[2] = 0u;
+        fb->data_len = 0u;
+        fb->crc = crumbs_crc8(fb->frame, 3u);
+    }
+
+    /**
+     * @brief Append raw bytes to the payload.
+     *
+     * @param fb   Builder.
+     * @param data Pointer to bytes to append.
+     * @param len  Number of bytes to append.
+     * @return 0 on success, -1 if payload would overflow.
+     */
+    static inline int crumbs_fb_add_bytes(crumbs_frame_builder_t *fb,
+                                          const void *data, uint8_t len)
+    {
+        if ((size_t)fb->data_len + len > CRUMBS_MAX_PAYLOAD)
+            return -1;
+        uint8_t *dst = &fb->frame[3u + fb->data_len];
+        memcpy(dst, data, len);
+        fb->crc = crumbs_crc8_update(fb->crc, dst, len);
+        fb->data_len += len;
+        return 0;
+    }
+
+    /**
+     * @brief Append a uint8_t to the payload.
+     *
+     * @param fb  Builder.
+     * @param val Value to append.
+     * @return 0 on success, -1 if payload would overflow.
+     */
+    static inline int crumbs_fb_add_u8(crumbs_frame_builder_t *fb, uint8_t val)
+    {
+        return crumbs_fb_add_bytes(fb, &val, 1u);
+    }
+
+    /**
+     * @brief Append a uint16_t (little-endian) to the payload.
+     *
+     * @param fb  Builder.
+     * @param val Value to append.
+     * @return 0 on success, -1 if payload would overflow.
+     */
+    static inline int crumbs_fb_add_u16(crumbs_frame_builder_t *fb, uint16_t val)
+    {
+        uint8_t b[2];
+        b[0] = (uint8_t)(val & 0xFF);
+        b[1] = (uint8_t)(val >> 8);
+        return crumbs_fb_add_bytes(fb, b, 2u);
+    }
+
+    /**
+     * @brief Append a uint32_t (little-endian) to the payload.
+     *
+     * @param fb  Builder.
+     * @param val Value to append.
+     * @return 0 on success, -1 if payload would overflow.
+     */
+    static inline int crumbs_fb_add_u32(crumbs_frame_builder_t *fb, uint32_t val)
+    {
+        uint8_t b[4];
+        b[0] = (uint8_t)(val);
+        b[1] = (uint8_t)(val >> 8);
+        b[2] = (uint8_t)(val >> 16);
+        b[3] = (uint8_t)(val >> 24);
+        return crumbs_fb_add_bytes(fb, b, 4u);
+    }
+
+    /**
+     * @brief Append an int8_t to the payload.
+     *
+     * @param fb  Builder.
+     * @param val Value to append.
+     * @return 0 on success, -1 if payload would overflow.
+     */
+    static inline int crumbs_fb_add_i8(crumbs_frame_builder_t *fb, int8_t val)
+    {
+        return crumbs_fb_add_u8(fb, (uint8_t)val);
+    }
+
+    /**
+     * @brief Append an int16_t (little-endian) to the payload.
+     *
+     * @param fb  Builder.
+     * @param val Value to append.
+     * @return 0 on success, -1 if payload would overflow.
+     */
+    static inline int crumbs_fb_add_i16(crumbs_frame_builder_t *fb, int16_t val)
+    {
+        return crumbs_fb_add_u16(fb, (uint16_t)val);
+    }
+
+    /**
+     * @brief Append an int32_t (little-endian) to the payload.
+     *
+     * @param fb  Builder.
+     * @param val Value to append.
+     * @return 0 on success, -1 if payload would overflow.
+     */
+    static inline int crumbs_fb_add_i32(crumbs_frame_builder_t *fb, int32_t val)
+    {
+        return crumbs_fb_add_u32(fb, (uint32_t)val);
+    }
+
+    /**
+     * @brief Append a float (native byte order) to the payload.
+     *
+     * @warning Same portability caveat as crumbs_msg_add_float().
+     *
+     * @param fb  Builder.
+     * @param val Value to append.
+     * @return 0 on success, -1 if payload would overflow.
+     */
+    static inline int crumbs_fb_add_float(crumbs_frame_builder_t *fb, float val)
+    {
+        return crumbs_fb_add_bytes(fb, &val, (uint8_t)sizeof(float));
+    }
+
+    /**
+     * @brief Append one [opcode][len][data] record to a CRUMBS_CMD_BATCH frame.
+     *
+     * Start the frame with crumbs_fb_init(&fb, type_id, CRUMBS_CMD_BATCH).
+     * The record is appended whole or not at all, so the caller can keep
+     * adding until -1 and then send what fits.
+     *
+     * @param fb     Builder holding a batch frame.
+     * @param opcode Opcode the peripheral dispatches the record to.
+     * @param data   Record payload (may be NULL when len == 0).
+     * @param len    Record payload length.
+     * @return 0 on success, -1 if the record does not fit.
+     */
+    static inline int crumbs_fb_add_record(crumbs_frame_builder_t *fb,
+                                           uint8_t opcode,
+                                           const void *data, uint8_t len)
+    {
+        if ((size_t)fb->data_len + 2u + len > CRUMBS_MAX_PAYLOAD)
+            return -1;
+        uint8_t hdr[2];
+        hdr[0] = opcode;
+        hdr[1] = len;
+        crumbs_fb_add_bytes(fb, hdr, 2u);
+        if (len > 0u)
+            crumbs_fb_add_bytes(fb, data, len);
+        return 0;
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRUMBS_FRAME_BUILDER_H */
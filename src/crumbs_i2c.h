@@ -178,6 +178,17 @@ extern "C"
      */
 #define CRUMBS_DEFAULT_QUERY_DELAY_US 10000u
 
+    /**
+     * @brief SET_REPLY-to-read delay for extension opcodes (0xF0-0xFD).
+     *
+     * The core builds those replies in the request callback without
+     * running a handler, so the controller only has to leave the
+     * peripheral time to take the SET_REPLY in.
+     */
+#ifndef CRUMBS_EXT_QUERY_DELAY_US
+#define CRUMBS_EXT_QUERY_DELAY_US 500u
+#endif
+
 #ifdef __cplusplus
 }
 #endif
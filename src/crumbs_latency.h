@@ -0,0 +1,131 @@
+/**
+ * @file crumbs_latency.h
+ * @brief Per-(address, opcode) reply-delay estimator for controllers.
+ *
+ * CRUMBS_DEFAULT_QUERY_DELAY_US is a worst case for every device and
+ * opcode. A crumbs_latency_t learns, for each (address, opcode) it sees,
+ * the shortest wait after SET_REPLY that still yields a valid reply most
+ * of the time, and GET helpers use that instead.
+ *
+ * The estimator only sees whether a read after waiting d microseconds
+ * succeeded. It tracks the CRUMBS_LATENCY_PERCENTILE quantile of the reply
+ * latency with a stochastic quantile step: a success shrinks d by
+ * (100 - P)% of the gain, a failure grows it by P% of the gain, so d
+ * settles where P% of reads succeed. The gain is d >> CRUMBS_LATENCY_GAIN_SHIFT
+ * (multiplicative, so fast and slow devices adapt at the same relative rate),
+ * and d stays within [floor_us, ceiling_us].
+ *
+ * One table can serve every device on a bus: set dev->latency on each
+ * crumbs_device_t. CRUMBS_DEFINE_GET_OP helpers and the request engine
+ * pick it up automatically.
+ *
+ * @code
+ * static crumbs_latency_t bus_latency;
+ * crumbs_latency_init(&bus_latency, 0u, 0u);   // defaults
+ * led_dev.latency = &bus_latency;
+ * calc_dev.latency = &bus_latency;
+ * @endcode
+ */
+
+#ifndef CRUMBS_LATENCY_H
+#define CRUMBS_LATENCY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /** @brief (address, opcode) pairs tracked per table; oldest is replaced when full. */
+#ifndef CRUMBS_LATENCY_ENTRIES
+#define CRUMBS_LATENCY_ENTRIES 16
+#endif
+
+    /** @brief Target success rate in percent (1-99). */
+#ifndef CRUMBS_LATENCY_PERCENTILE
+#define CRUMBS_LATENCY_PERCENTILE 90
+#endif
+
+    /** @brief Gain is delay >> shift; larger adapts more slowly but jitters less. */
+#ifndef CRUMBS_LATENCY_GAIN_SHIFT
+#define CRUMBS_LATENCY_GAIN_SHIFT 2
+#endif
+
+    /** @brief Default floor when crumbs_latency_init() is given 0. */
+#ifndef CRUMBS_LATENCY_FLOOR_US
+#define CRUMBS_LATENCY_FLOOR_US 200u
+#endif
+
+#if (CRUMBS_LATENCY_PERCENTILE < 1) || (CRUMBS_LATENCY_PERCENTILE > 99)
+#error "CRUMBS_LATENCY_PERCENTILE must be between 1 and 99"
+#endif
+
+    /**
+     * @brief Learned delay for one (address, opcode).
+     */
+    typedef struct
+    {
+        uint32_t delay_us; /**< Current estimate. */
+        uint16_t samples;  /**< Reports folded in (saturating). */
+        uint8_t addr;      /**< Device address. */
+        uint8_t opcode;    /**< Requested opcode. */
+    } crumbs_latency_entry_t;
+
+    /**
+     * @brief Estimator table shared by the devices of one bus.
+     */
+    typedef struct crumbs_latency_s
+    {
+        crumbs_latency_entry_t entries[CRUMBS_LATENCY_ENTRIES]; /**< Learned delays. */
+        uint32_t floor_us;   /**< Lower bound for any estimate. */
+        uint32_t ceiling_us; /**< Upper bound, and the starting point for new pairs. */
+        uint8_t count;       /**< Entries in use. */
+        uint8_t next_evict;  /**< Round-robin replacement slot once full. */
+    } crumbs_latency_t;
+
+    /**
+     * @brief Reset a table.
+     *
+     * @param lat        Table to initialize.
+     * @param floor_us   Shortest delay ever used (0 = CRUMBS_LATENCY_FLOOR_US).
+     * @param ceiling_us Longest delay and initial estimate
+     *                   (0 = CRUMBS_DEFAULT_QUERY_DELAY_US).
+     */
+    void crumbs_latency_init(crumbs_latency_t *lat, uint32_t floor_us, uint32_t ceiling_us);
+
+    /**
+     * @brief Current estimate for (addr, opcode), or the ceiling if unknown.
+     */
+    uint32_t crumbs_latency_estimate(const crumbs_latency_t *lat, uint8_t addr, uint8_t opcode);
+
+    /**
+     * @brief Fold in the outcome of a read made @p waited_us after SET_REPLY.
+     *
+     * @param ok Non-zero if the read returned a valid reply for @p opcode.
+     */
+    void crumbs_latency_report(crumbs_latency_t *lat, uint8_t addr, uint8_t opcode,
+                               uint32_t waited_us, int ok);
+
+    /**
+     * @brief Delay to use before reading @p opcode from @p dev.
+     *
+     * dev->latency's estimate, or CRUMBS_DEFAULT_QUERY_DELAY_US when the
+     * device has no estimator.
+     */
+    uint32_t crumbs_device_query_delay(const crumbs_device_t *dev, uint8_t opcode);
+
+    /**
+     * @brief Report a GET outcome to dev->latency (no-op without one).
+     */
+    void crumbs_device_query_result(const crumbs_device_t *dev, uint8_t opcode,
+                                    uint32_t waited_us, int ok);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRUMBS_LATENCY_H */
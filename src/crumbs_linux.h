@@ -11,6 +11,8 @@ extern "C"
 
 #include "crumbs.h"     /* crumbs_context_t, crumbs_message_t */
 #include "crumbs_i2c.h" /* crumbs_i2c_write_fn */
+#include "crumbs_transport.h"
+#include "crumbs_registry.h"
 
     /** @file
      * @brief Linux-native I2C helpers (linux-wire) used by CRUMBS.
@@ -19,7 +21,9 @@ extern "C"
     /**
      * @brief Linux I2C handle for CRUMBS.
      *
-     * @details On native Linux builds this contains a linux-wire lw_i2c_bus. On other
+     * @details On native Linux builds this contains a linux-wire lw_i2c_bus plus
+     * the slave address and timeout last programmed into it, so back-to-back
+     * traffic to one device skips redundant ioctls. On other
      * platforms we provide a small placeholder so the type can be stack
      * allocated in examples while remaining harmless for Arduino builds.
      */
@@ -28,6 +32,11 @@ extern "C"
     typedef struct crumbs_linux_i2c_s
     {
         lw_i2c_bus bus;
+        int slave_addr;           /**< Address last selected with I2C_SLAVE, -1 if unknown. */
+        uint32_t timeout_us;      /**< Timeout last applied to the bus (0 = never set). */
+        uint32_t slave_skipped;   /**< I2C_SLAVE ioctls skipped because the address was current. */
+        uint32_t timeout_skipped; /**< Timeout updates skipped because the value was current. */
+        char device_path[64];     /**< Path passed to init, for crumbs_linux_recover() ("" if too long). */
     } crumbs_linux_i2c_t;
 #else
 typedef struct crumbs_linux_i2c_s
@@ -44,6 +53,9 @@ typedef struct crumbs_linux_i2c_s
      * @param device_path  Path to I2C device, e.g. "/dev/i2c-1".
      * @param timeout_us   Optional timeout hint in microseconds (0 = no timeout).
      *
+     * The context's transport is set to crumbs_linux_transport with @p i2c
+     * as io, so crumbs_device_init() can fill device handles from it.
+     *
      * @return 0 on success.
      *        -1 if arguments are invalid.
      *        -2 if opening the bus failed.
@@ -53,6 +65,12 @@ typedef struct crumbs_linux_i2c_s
                                      const char *device_path,
                                      uint32_t timeout_us);
 
+    /**
+     * @brief Linux I2C transport: crumbs_linux_i2c_write, crumbs_linux_read
+     *        and crumbs_linux_write_then_read (I2C_RDWR), io = crumbs_linux_i2c_t.
+     */
+    extern const crumbs_transport_t crumbs_linux_transport;
+
     /**
      * @brief Close the underlying Linux I2C bus and clear the handle.
      *
@@ -62,6 +80,20 @@ typedef struct crumbs_linux_i2c_s
      */
     void crumbs_linux_close(crumbs_linux_i2c_t *i2c);
 
+    /**
+     * @brief Reopen the adapter after a stuck bus (conforms to crumbs_bus_recover_fn).
+     *
+     * Closes and reopens the device passed to crumbs_linux_init_controller(),
+     * forgets the selected address and applies the timeout again. i2c-dev
+     * has no bus-recovery ioctl; adapter drivers with recovery support
+     * clock SCL themselves after a timeout. Where the pins can be switched
+     * to GPIO, call crumbs_bus_clear() on them first.
+     *
+     * @param user_ctx Must be a (crumbs_linux_i2c_t*).
+     * @return 0 on success, -1 on bad args or no stored path, -2 if the reopen failed.
+     */
+    int crumbs_linux_recover(void *user_ctx);
+
     /**
      * @brief I2C write adapter for CRUMBS on Linux; compatible with crumbs_i2c_write_fn.
      *
@@ -158,6 +190,46 @@ typedef struct crumbs_linux_i2c_s
                                      uint32_t timeout_us,
                                      int require_repeated_start);
 
+    /**
+     * @brief One operation in a crumbs_linux_transfer_batch() call.
+     *
+     * A write phase (tx), a read phase (rx), or both (write, repeated
+     * START, read). Fill tx frames with crumbs_encode_frames().
+     */
+    typedef struct
+    {
+        uint8_t addr;      /**< 7-bit target address. */
+        const uint8_t *tx; /**< Bytes to write (NULL if tx_len == 0). */
+        size_t tx_len;     /**< Write length (0 = read only). */
+        uint8_t *rx;       /**< Read buffer (NULL if rx_len == 0). */
+        size_t rx_len;     /**< Read length (0 = write only). */
+        int result;        /**< Out: bytes read (0 for write-only), or negative. */
+    } crumbs_linux_xfer_t;
+
+    /**
+     * @brief Run many operations, across any number of devices, as few
+     *        I2C_RDWR ioctls as possible.
+     *
+     * Operations are packed in order into ioctls of at most
+     * I2C_RDWR_IOCTL_MAX_MSGS messages (one per phase), so e.g. SET_REPLY
+     * to a dozen devices is one syscall instead of two per device. Within
+     * one ioctl the kernel joins messages with repeated STARTs, so the bus
+     * is held until the last one; an operation is never split across two
+     * ioctls.
+     *
+     * If an ioctl fails, its operations get result -3, later operations
+     * get -1 and are not attempted.
+     *
+     * @param i2c   Linux I2C handle.
+     * @param ops   Operations; each result field is written.
+     * @param count Number of operations.
+     * @return 0 if every operation succeeded, -1 on bad args, -3 if an
+     *         ioctl failed.
+     */
+    int crumbs_linux_transfer_batch(crumbs_linux_i2c_t *i2c,
+                                    crumbs_linux_xfer_t *ops,
+                                    size_t count);
+
     /**
      * @brief Scan for I2C devices on the bus for addresses in [start_addr, end_addr].
      *
@@ -237,8 +309,50 @@ typedef struct crumbs_linux_i2c_s
                                      size_t max_found,
                                      uint32_t timeout_us);
 
+    /**
+     * @brief Fast CRUMBS scan with address-ACK prefilter and combined probes.
+     *
+     * Wraps crumbs_controller_scan_for_crumbs_fast() with crumbs_linux_scan
+     * as the prefilter and crumbs_linux_write_then_read for the
+     * single-transaction probe, with expected I/O error messages
+     * suppressed like crumbs_linux_scan_for_crumbs_with_types().
+     *
+     * @return Number of devices found (>=0), or negative on error.
+     */
+    int crumbs_linux_scan_for_crumbs_fast(crumbs_context_t *ctx,
+                                          crumbs_linux_i2c_t *i2c,
+                                          uint8_t start_addr,
+                                          uint8_t end_addr,
+                                          int strict,
+                                          uint8_t *found,
+                                          uint8_t *types,
+                                          size_t max_found,
+                                          uint32_t timeout_us);
+
+    /**
+     * @brief Write a registry blob (crumbs_registry_save()) to @p path.
+     *
+     * The blob is written to "<path>.tmp" and renamed over @p path, so a
+     * crash never leaves a half-written cache behind.
+     *
+     * @return 0 on success, -1 on bad args or I/O error.
+     */
+    int crumbs_linux_registry_save_file(const crumbs_registry_t *reg, const char *path);
+
+    /**
+     * @brief Load a registry blob from @p path (crumbs_registry_load()).
+     *
+     * @return 0 on success, -1 if the file is missing, unreadable or
+     *         malformed, -2 on CRC mismatch. @p reg is empty on error.
+     */
+    int crumbs_linux_registry_load_file(crumbs_registry_t *reg, const char *path);
+
     /**
      * @brief Linux platform millisecond timer.
+     *
+     * Millisecond resolution; crumbs_linux_rt_now_us() and
+     * crumbs_linux_loop_now_us() give microseconds.
+     *
      * @return Milliseconds since boot.
      */
     uint32_t crumbs_linux_millis(void);
@@ -246,7 +360,9 @@ typedef struct crumbs_linux_i2c_s
     /**
      * @brief Linux platform microsecond delay (conforms to crumbs_delay_fn).
      *
-     * Wraps POSIX usleep(). On non-Linux builds this is a no-op stub.
+     * Sleeps to an absolute CLOCK_MONOTONIC deadline, so signals do not
+     * lengthen it. For fixed-rate loops use crumbs_linux_rt.h, which keeps
+     * a deadline grid across cycles. On non-Linux builds this is a no-op stub.
      *
      * @param us Microseconds to delay.
      */
@@ -0,0 +1,103 @@
+/**
+ * @file crumbs_linux_alert.h
+ * @brief Watch the shared attention (ALERT#) line through the GPIO chardev.
+ *
+ * Peripherals built with CRUMBS_ENABLE_ATTENTION pull an open-drain line
+ * low when they have news. This helper requests that line from
+ * /dev/gpiochipN (GPIO uAPI v2) as an active-low input with edge events,
+ * so a controller can sleep in poll()/epoll until a peripheral asserts it
+ * instead of polling every module on a timer. Then find the sender with
+ * crumbs_controller_alert_response() or let crumbs_sched_service_alert()
+ * do it.
+ *
+ * @code
+ * crumbs_linux_alert_open(&alert, "/dev/gpiochip0", 17);
+ * for (;;)
+ * {
+ *     uint32_t idle = crumbs_sched_idle_us(&sched, crumbs_linux_loop_now_us());
+ *     if (crumbs_linux_alert_wait(&alert, idle) == 1)
+ *         crumbs_sched_service_alert(&sched, crumbs_linux_read, &i2c, crumbs_linux_loop_now_us());
+ *     crumbs_sched_poll(&sched, crumbs_linux_loop_now_us());
+ * }
+ * @endcode
+ *
+ * The line is level-checked after every wake-up: it stays low while any
+ * peripheral still asserts it, so wait() keeps returning 1 until all of
+ * them have been serviced.
+ *
+ * Only available on Linux builds. Does not need linux-wire.
+ */
+
+#ifndef CRUMBS_LINUX_ALERT_H
+#define CRUMBS_LINUX_ALERT_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if defined(__linux__)
+
+    /**
+     * @brief Requested attention line.
+     */
+    typedef struct
+    {
+        int fd;                 /**< Line request fd (non-blocking); -1 when closed. */
+        uint32_t events;        /**< Assert edges seen. */
+        uint32_t last_event_us; /**< CLOCK_MONOTONIC time of the last edge (wraps). */
+    } crumbs_linux_alert_t;
+
+    /**
+     * @brief Request @p line of @p chip_path as the attention input.
+     *
+     * Asks for the internal pull-up and falls back to none when the chip
+     * cannot bias the line (an external pull-up is then required).
+     *
+     * @return 0 on success, -1 on bad args or if the chip or line cannot
+     *         be opened.
+     */
+    int crumbs_linux_alert_open(crumbs_linux_alert_t *alert, const char *chip_path, unsigned line);
+
+    /**
+     * @brief File descriptor to watch for readability (EPOLLIN / POLLIN).
+     *
+     * Readable on each assert edge; call crumbs_linux_alert_wait() with
+     * timeout 0 to consume the events.
+     *
+     * @return The line fd, or -1.
+     */
+    int crumbs_linux_alert_fd(const crumbs_linux_alert_t *alert);
+
+    /**
+     * @brief Current line level.
+     *
+     * @return 1 if some peripheral pulls the line low, 0 if released, -1 on error.
+     */
+    int crumbs_linux_alert_asserted(const crumbs_linux_alert_t *alert);
+
+    /**
+     * @brief Wait until the line is asserted.
+     *
+     * Returns at once if it already is. Otherwise sleeps in poll() for up
+     * to @p timeout_us (UINT32_MAX = forever), consumes pending edge
+     * events and reports the level.
+     *
+     * @return 1 if asserted, 0 on timeout (or a glitch), -1 on error.
+     */
+    int crumbs_linux_alert_wait(crumbs_linux_alert_t *alert, uint32_t timeout_us);
+
+    /**
+     * @brief Release the line.
+     */
+    void crumbs_linux_alert_close(crumbs_linux_alert_t *alert);
+
+#endif /* defined(__linux__) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRUMBS_LINUX_ALERT_H */
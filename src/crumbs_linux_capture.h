@@ -0,0 +1,87 @@
+/**
+ * @file crumbs_linux_capture.h
+ * @brief Capture files on Linux: append records, mmap() them back.
+ *
+ * crumbs_linux_capture_sink() is a crumbs_capture_sink_fn that appends
+ * each record with one write() to a file opened O_APPEND, so a crash
+ * loses at most the record in flight and several runs can add to the same file.
+ * crumbs_linux_capture_map() maps a file read-only for replay or analysis
+ * without copying it.
+ *
+ * @code
+ * crumbs_linux_capture_map_t map;
+ * crumbs_linux_capture_map(&map, "bus.cap");
+ * crumbs_capture_replay(&replay, map.records, map.count);
+ * crumbs_linux_capture_unmap(&map);
+ * @endcode
+ *
+ * Only available on Linux builds. Does not need linux-wire.
+ */
+
+#ifndef CRUMBS_LINUX_CAPTURE_H
+#define CRUMBS_LINUX_CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crumbs_capture.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if defined(__linux__)
+
+    /**
+     * @brief Capture file open for appending.
+     */
+    typedef struct
+    {
+        int fd;            /**< -1 when closed. */
+        uint32_t written;  /**< Records appended through this handle. */
+    } crumbs_linux_capture_t;
+
+    /**
+     * @brief Open @p path for appending, writing the header if the file is new or empty.
+     *
+     * @return 0 on success, -1 on bad args, -2 if the file cannot be opened or
+     *         written, -3 if it exists but is not a capture file.
+     */
+    int crumbs_linux_capture_open(crumbs_linux_capture_t *f, const char *path);
+
+    /** @brief crumbs_capture_sink_fn; @p user is the crumbs_linux_capture_t. */
+    int crumbs_linux_capture_sink(void *user, const uint8_t *record);
+
+    /** @brief Close the file. Safe to call twice. */
+    void crumbs_linux_capture_close(crumbs_linux_capture_t *f);
+
+    /**
+     * @brief Read-only mapping of a capture file.
+     */
+    typedef struct
+    {
+        void *base;             /**< Mapping; NULL when unmapped. */
+        size_t size;            /**< Mapped bytes. */
+        const uint8_t *records; /**< First record. */
+        size_t count;           /**< Whole records (a torn last record is ignored). */
+    } crumbs_linux_capture_map_t;
+
+    /**
+     * @brief Map @p path and locate its records.
+     *
+     * @return 0 on success, -1 on bad args, -2 if the file cannot be opened or
+     *         mapped, -3 if it is not a capture file.
+     */
+    int crumbs_linux_capture_map(crumbs_linux_capture_map_t *m, const char *path);
+
+    /** @brief Unmap. Safe to call twice. */
+    void crumbs_linux_capture_unmap(crumbs_linux_capture_map_t *m);
+
+#endif /* defined(__linux__) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRUMBS_LINUX_CAPTURE_H */
@@ -0,0 +1,240 @@
+/**
+ * @file crumbs_linux_daemon.h
+ * @brief Bus-sharing daemon (crumbsd) and its client for multi-process hosts.
+ *
+ * Processes that open the same /dev/i2c-N each keep their own slave
+ * address and timing state, and one process's SET_REPLY can land between
+ * another's write and read. crumbsd owns the bus instead; clients talk to
+ * it over a Unix SOCK_SEQPACKET socket, one request and one response per
+ * transfer:
+ *
+ *     request:  [op][addr][flags][rx_len][timeout_us:u32 LE][tx bytes...]
+ *     response: [status:i32 LE][rx bytes...]
+ *
+ * status is what the bus primitive returned (bytes read for reads).
+ *
+ * The daemon keeps GETs intact and shares them:
+ * - A SET_REPLY selects a reply on a device for the client that sent it.
+ *   Another client's different SET_REPLY to that device waits until the
+ *   first client has read (or select_timeout_us passes), so each read
+ *   returns the reply its own client asked for.
+ * - Identical concurrent GETs share one transaction: a second client
+ *   sending the same SET_REPLY joins the first, and every reply read is
+ *   cached for cache_ttl_us, so joined clients and GETs arriving within
+ *   the TTL are answered without touching the bus.
+ * - Requests that arrive together in one poll round are served in
+ *   arrival order back to back; those blocked by a selection are retried
+ *   every round.
+ *
+ * The client side provides the crumbs_i2c_*_fn callbacks and a transport,
+ * so existing controller code only changes how it connects:
+ *
+ * @code
+ * crumbs_daemon_client_t bus;
+ * crumbs_daemon_init_controller(&ctx, &bus, CRUMBS_DAEMON_SOCKET);
+ * crumbs_device_init(&led, &ctx, 0x08, crumbs_linux_delay_us);
+ * led_get_state(&led, &state);    // unchanged ops header
+ * @endcode
+ *
+ * Only available on Linux builds. Does not need linux-wire; the daemon
+ * serves whatever crumbs_transport_t it is given.
+ */
+
+#ifndef CRUMBS_LINUX_DAEMON_H
+#define CRUMBS_LINUX_DAEMON_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_transport.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if defined(__linux__)
+
+    /** @brief Default socket path. */
+#ifndef CRUMBS_DAEMON_SOCKET
+#define CRUMBS_DAEMON_SOCKET "/run/crumbsd.sock"
+#endif
+
+    /** @brief Simultaneous clients (1-32). */
+#ifndef CRUMBS_DAEMON_MAX_CLIENTS
+#define CRUMBS_DAEMON_MAX_CLIENTS 16
+#endif
+
+    /** @brief Default lifetime of a cached reply, in microseconds. */
+#ifndef CRUMBS_DAEMON_CACHE_TTL_US
+#define CRUMBS_DAEMON_CACHE_TTL_US 5000u
+#endif
+
+    /** @brief Default time a selection may hold off other clients' SET_REPLY, in microseconds. */
+#ifndef CRUMBS_DAEMON_SELECT_TIMEOUT_US
+#define CRUMBS_DAEMON_SELECT_TIMEOUT_US 100000u
+#endif
+
+    /** @brief How long a client waits for the daemon's response, in milliseconds. */
+#ifndef CRUMBS_DAEMON_CLIENT_TIMEOUT_MS
+#define CRUMBS_DAEMON_CLIENT_TIMEOUT_MS 1000
+#endif
+
+#if (CRUMBS_DAEMON_MAX_CLIENTS < 1) || (CRUMBS_DAEMON_MAX_CLIENTS > 32)
+#error "CRUMBS_DAEMON_MAX_CLIENTS must be between 1 and 32"
+#endif
+
+    /** @name Request Opcodes
+     *  @{ */
+#define CRUMBS_DAEMON_OP_WRITE 0x01u      /**< tx to addr. */
+#define CRUMBS_DAEMON_OP_READ 0x02u       /**< rx_len bytes from addr. */
+#define CRUMBS_DAEMON_OP_WRITE_READ 0x03u /**< tx, then rx_len bytes (flags bit 0: repeated START required). */
+#define CRUMBS_DAEMON_OP_STATS 0x04u      /**< Response carries crumbs_daemon_stats_t as u32 LE words. */
+    /** @} */
+
+    /** @brief Request header size; tx bytes follow. */
+#define CRUMBS_DAEMON_HEADER_LEN 8u
+
+    /** @brief Largest tx or rx of one request. */
+#define CRUMBS_DAEMON_MAX_XFER 255u
+
+    /**
+     * @brief Daemon counters (all wrap).
+     */
+    typedef struct
+    {
+        uint32_t requests;   /**< Requests answered. */
+        uint32_t transfers;  /**< Bus transfers performed. */
+        uint32_t coalesced;  /**< SET_REPLYs joined to an identical selection. */
+        uint32_t cache_hits; /**< Reads answered from the reply cache. */
+        uint32_t waits;      /**< Requests held back by another client's selection. */
+        uint32_t expired;    /**< Selections dropped after select_timeout_us. */
+        uint32_t clients;    /**< Clients currently connected. */
+    } crumbs_daemon_stats_t;
+
+    /**
+     * @brief Reply selection and cache for one 7-bit address.
+     */
+    typedef struct
+    {
+        uint8_t key[CRUMBS_MESSAGE_MAX_SIZE];   /**< Last SET_REPLY frame written. */
+        uint8_t cache[CRUMBS_MESSAGE_MAX_SIZE]; /**< Last reply read for key. */
+        uint8_t key_len;                        /**< 0 = no selection known. */
+        uint8_t cache_len;                      /**< 0 = nothing cached. */
+        uint8_t cache_req;                      /**< rx_len of the read that filled cache. */
+        uint32_t holders;                       /**< Clients whose read is still due. */
+        uint32_t selected_us;                   /**< When holders last changed. */
+        uint32_t cached_us;                     /**< When cache was read. */
+    } crumbs_daemon_slot_t;
+
+    /**
+     * @brief One connected client.
+     */
+    typedef struct
+    {
+        int fd;                                                   /**< -1 = free. */
+        uint8_t pending;                                          /**< req holds an unanswered request. */
+        uint8_t waited;                                           /**< req was held back at least once. */
+        uint16_t req_len;                                         /**< Bytes in req. */
+        uint32_t seq;                                             /**< Arrival order of req. */
+        uint8_t req[CRUMBS_DAEMON_HEADER_LEN + CRUMBS_DAEMON_MAX_XFER]; /**< Request. */
+    } crumbs_daemon_conn_t;
+
+    /**
+     * @brief crumbsd state.
+     */
+    typedef struct
+    {
+        int listen_fd;                                       /**< -1 when closed. */
+        const crumbs_transport_t *bus;                       /**< Owned bus. */
+        void *bus_io;                                        /**< io for its primitives. */
+        crumbs_clock_us_fn clock;                            /**< Defaults to crumbs_linux_loop_now_us(). */
+        uint32_t cache_ttl_us;                               /**< CRUMBS_DAEMON_CACHE_TTL_US; 0 disables the cache. */
+        uint32_t select_timeout_us;                          /**< CRUMBS_DAEMON_SELECT_TIMEOUT_US. */
+        uint32_t next_seq;                                   /**< Arrival counter. */
+        crumbs_daemon_stats_t stats;                         /**< Counters. */
+        crumbs_daemon_conn_t conns[CRUMBS_DAEMON_MAX_CLIENTS]; /**< Clients. */
+        crumbs_daemon_slot_t slots[128];                     /**< Per-address state. */
+        char path[108];                                      /**< Socket path, unlinked on close. */
+    } crumbs_daemon_t;
+
+    /**
+     * @brief Bind and listen on @p socket_path, serving @p bus.
+     *
+     * A stale socket file at the path is removed first.
+     *
+     * @return 0 on success, -1 on bad args or a path too long, -2 if the
+     *         socket cannot be created or bound.
+     */
+    int crumbs_daemon_init(crumbs_daemon_t *d, const char *socket_path,
+                           const crumbs_transport_t *bus, void *bus_io);
+
+    /**
+     * @brief Wait up to @p timeout_ms for activity, then accept clients and serve requests.
+     *
+     * Waits at most 1 ms while a request is held back, so selections
+     * expire on time.
+     *
+     * @return Requests answered, or -1 on bad args.
+     */
+    int crumbs_daemon_poll(crumbs_daemon_t *d, int timeout_ms);
+
+    /** @brief Disconnect all clients, close and unlink the socket. */
+    void crumbs_daemon_close(crumbs_daemon_t *d);
+
+    /**
+     * @brief Connection to crumbsd.
+     */
+    typedef struct
+    {
+        int fd; /**< -1 when closed. */
+    } crumbs_daemon_client_t;
+
+    /**
+     * @brief Connect to the daemon at @p socket_path.
+     *
+     * @return 0 on success, -1 on bad args, -2 if the daemon is not reachable.
+     */
+    int crumbs_daemon_connect(crumbs_daemon_client_t *c, const char *socket_path);
+
+    /** @brief Close the connection. Safe to call twice. */
+    void crumbs_daemon_disconnect(crumbs_daemon_client_t *c);
+
+    /** @brief crumbs_i2c_write_fn; @p user_ctx is the crumbs_daemon_client_t. */
+    int crumbs_daemon_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len);
+
+    /** @brief crumbs_i2c_read_fn; @p user_ctx is the crumbs_daemon_client_t. */
+    int crumbs_daemon_read(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len,
+                           uint32_t timeout_us);
+
+    /** @brief crumbs_i2c_write_read_fn; @p user_ctx is the crumbs_daemon_client_t. */
+    int crumbs_daemon_write_read(void *user_ctx, uint8_t addr, const uint8_t *tx, size_t tx_len,
+                                 uint8_t *rx, size_t rx_len, uint32_t timeout_us,
+                                 int require_repeated_start);
+
+    /** @brief Daemon transport for crumbs_set_transport(); io = crumbs_daemon_client_t. */
+    extern const crumbs_transport_t crumbs_daemon_transport;
+
+    /**
+     * @brief crumbs_init() as controller, connect, and set crumbs_daemon_transport.
+     *
+     * @return As crumbs_daemon_connect().
+     */
+    int crumbs_daemon_init_controller(crumbs_context_t *ctx, crumbs_daemon_client_t *c,
+                                      const char *socket_path);
+
+    /**
+     * @brief Fetch the daemon's counters.
+     *
+     * @return 0 on success, negative if the daemon does not answer.
+     */
+    int crumbs_daemon_get_stats(crumbs_daemon_client_t *c, crumbs_daemon_stats_t *out);
+
+#endif /* defined(__linux__) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRUMBS_LINUX_DAEMON_H */
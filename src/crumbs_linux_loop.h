@@ -0,0 +1,109 @@
+/**
+ * @file crumbs_linux_loop.h
+ * @brief Drive the request engine from an epoll/poll/libuv event loop.
+ *
+ * crumbs_engine_poll() never sleeps, but something still has to call it
+ * when the next reply is due. This adapter keeps a timerfd armed for
+ * exactly that moment. Register crumbs_linux_loop_fd() for readability
+ * with your loop, and call crumbs_linux_loop_dispatch() when it fires. Bus
+ * work then proceeds without a dedicated thread and without sleeping.
+ *
+ * @code
+ * crumbs_linux_loop_init(&loop, &eng);
+ * ev.events = EPOLLIN;
+ * ev.data.ptr = &loop;
+ * epoll_ctl(epfd, EPOLL_CTL_ADD, crumbs_linux_loop_fd(&loop), &ev);
+ *
+ * crumbs_linux_loop_submit(&loop, &req);   // instead of crumbs_engine_submit()
+ *
+ * // in the epoll loop:
+ * if (events[i].data.ptr == &loop)
+ *     crumbs_linux_loop_dispatch(&loop);
+ * @endcode
+ *
+ * The timer is re-armed after every dispatch and submit. A request queued
+ * with plain crumbs_engine_submit() (for example from a callback outside
+ * dispatch) is picked up once crumbs_linux_loop_rearm() is called.
+ *
+ * Only available on Linux builds. Does not need linux-wire.
+ */
+
+#ifndef CRUMBS_LINUX_LOOP_H
+#define CRUMBS_LINUX_LOOP_H
+
+#include <stdint.h>
+
+#include "crumbs_engine.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if defined(__linux__)
+
+    /**
+     * @brief Engine plus the timerfd that says when to poll it.
+     */
+    typedef struct
+    {
+        crumbs_engine_t *eng; /**< Engine driven by this loop. */
+        int fd;               /**< timerfd (non-blocking, close-on-exec); -1 when closed. */
+        uint32_t dispatches;  /**< crumbs_linux_loop_dispatch() calls that polled the engine. */
+    } crumbs_linux_loop_t;
+
+    /**
+     * @brief Create the timerfd for @p eng. The engine must be initialized.
+     *
+     * @return 0 on success, -1 on bad args or if the timerfd could not be
+     *         created.
+     */
+    int crumbs_linux_loop_init(crumbs_linux_loop_t *loop, crumbs_engine_t *eng);
+
+    /**
+     * @brief File descriptor to watch for readability (EPOLLIN / POLLIN).
+     *
+     * @return The timerfd, or -1.
+     */
+    int crumbs_linux_loop_fd(const crumbs_linux_loop_t *loop);
+
+    /**
+     * @brief crumbs_engine_submit() and arm the timer to fire immediately.
+     *
+     * @return crumbs_engine_submit() result, or -1 if @p loop is NULL/closed.
+     */
+    int crumbs_linux_loop_submit(crumbs_linux_loop_t *loop, crumbs_request_t *req);
+
+    /**
+     * @brief Clear the timer, poll the engine once, re-arm for the next due read.
+     *
+     * Safe to call on a spurious wake-up. Completion callbacks run from here.
+     *
+     * @return Requests still queued (0 = idle, timer disarmed), or -1 on bad args.
+     */
+    int crumbs_linux_loop_dispatch(crumbs_linux_loop_t *loop);
+
+    /**
+     * @brief Re-arm the timer from the engine's current state.
+     *
+     * @return 0 on success, -1 on bad args or timerfd failure.
+     */
+    int crumbs_linux_loop_rearm(crumbs_linux_loop_t *loop);
+
+    /**
+     * @brief Close the timerfd. Queued requests stay in the engine.
+     */
+    void crumbs_linux_loop_close(crumbs_linux_loop_t *loop);
+
+    /**
+     * @brief CLOCK_MONOTONIC in microseconds (wraps), the clock the loop polls with.
+     */
+    uint32_t crumbs_linux_loop_now_us(void);
+
+#endif /* defined(__linux__) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRUMBS_LINUX_LOOP_H */
@@ -0,0 +1,220 @@
+/**
+ * @file crumbs_linux_metrics.h
+ * @brief Live bus metrics in shared memory, with a reader and a Prometheus formatter.
+ *
+ * A crumbs_linux_metrics_t sits between a controller context and its
+ * transport, like crumbs_capture_t, and counts every transfer into a
+ * fixed-layout region created with shm_open() (or memfd_create() when no
+ * name is given): transfers, errors by return code and a latency
+ * histogram per address, time spent on the bus, and queue depths the
+ * application publishes (crumbs_linux_metrics_engine() fills in the
+ * engine lanes). Any process can map the region read-only and take
+ * consistent snapshots, so monitoring needs no code in the application:
+ *
+ * @code
+ * static crumbs_linux_metrics_t met;
+ * crumbs_linux_init_controller(&ctx, &lw, "/dev/i2c-1", 10000);
+ * crumbs_linux_metrics_open(&met, CRUMBS_METRICS_NAME);
+ * crumbs_linux_metrics_attach(&met, &ctx);   // devices initialized after this are counted
+ * ...
+ * crumbs_engine_poll(&eng, now);
+ * crumbs_linux_metrics_engine(&met, &eng);
+ * @endcode
+ *
+ * and then `crumbs_top` (or `crumbs_top --prom` for a Prometheus textfile
+ * collector) in another shell.
+ *
+ * The writer is single-threaded: one context, or one bus-owning process
+ * such as crumbsd. Updates are bracketed by a sequence counter (odd while
+ * a write is in progress); the writer only does relaxed stores plus two
+ * clock reads per transfer, and readers retry a copy that raced with a write.
+ * All counters are u32 and wrap.
+ *
+ * Only available on Linux builds. Does not need linux-wire.
+ */
+
+#ifndef CRUMBS_LINUX_METRICS_H
+#define CRUMBS_LINUX_METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_transport.h"
+#include "crumbs_engine.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if defined(__linux__)
+
+    /** @brief Default shm_open() name used by crumbs_top. */
+#ifndef CRUMBS_METRICS_NAME
+#define CRUMBS_METRICS_NAME "/crumbs-metrics"
+#endif
+
+    /** @brief Region layout version. */
+#define CRUMBS_METRICS_VERSION 1u
+
+    /** @brief Addresses tracked (the whole 7-bit space). */
+#define CRUMBS_METRICS_ADDRS 128u
+
+    /**
+     * @brief Error kinds: index -rc for rc -1..-7, 0 for a read that returned
+     *        no bytes, 7 for anything from -7 down.
+     *
+     * With the Linux HAL: 1 = bad args or closed bus, 2 = address select
+     * failed, 3 = transfer failed (NACK, timeout), 4 = short write,
+     * 5 = no repeated START (CRUMBS_I2C_DEV_E_NO_REPEATED_START).
+     */
+#define CRUMBS_METRICS_ERR_KINDS 8u
+
+    /** @brief Latency buckets: bucket b counts transfers under 16 << b us, the last one the rest. */
+#define CRUMBS_METRICS_BUCKETS 16u
+
+    /** @brief Queue depth slots; CRUMBS_ENGINE_LANES of them are the engine lanes. */
+#define CRUMBS_METRICS_QUEUES 4u
+
+    /**
+     * @brief Counters for one 7-bit address.
+     */
+    typedef struct
+    {
+        uint32_t transfers;                         /**< Writes, reads and combined transfers. */
+        uint32_t errors;                            /**< Transfers that returned < 0 or no bytes. */
+        uint32_t err_kind[CRUMBS_METRICS_ERR_KINDS]; /**< errors by kind (see CRUMBS_METRICS_ERR_KINDS). */
+        uint32_t hist[CRUMBS_METRICS_BUCKETS];      /**< Latency histogram. */
+        uint32_t sum_us;                            /**< Sum of latencies. */
+        uint32_t last_us;                           /**< Latency of the latest transfer. */
+        uint32_t max_us;                            /**< Worst latency. */
+    } crumbs_metrics_addr_t;
+
+    /**
+     * @brief The shared region. Only 32-bit words, so a reader copies it
+     *        word by word.
+     */
+    typedef struct
+    {
+        char magic[8];            /**< "CRUMBMET". */
+        uint32_t version;         /**< CRUMBS_METRICS_VERSION. */
+        uint32_t size;            /**< sizeof(crumbs_metrics_region_t). */
+        uint32_t seq;             /**< Odd while the writer updates the region. */
+        uint32_t pid;             /**< Writer process. */
+        uint32_t start_s;         /**< CLOCK_REALTIME seconds when the writer opened the region. */
+        uint32_t uptime_us;       /**< Monotonic time since open at the latest update. */
+        uint32_t busy_us;         /**< Time spent inside transfers. */
+        uint32_t transfers;       /**< All transfers. */
+        uint32_t errors;          /**< All errors. */
+        uint32_t queue_depth[CRUMBS_METRICS_QUEUES]; /**< Latest published depths. */
+        uint32_t queue_high[CRUMBS_METRICS_QUEUES];  /**< Highest published depths. */
+        crumbs_metrics_addr_t addr[CRUMBS_METRICS_ADDRS]; /**< Per-address counters. */
+    } crumbs_metrics_region_t;
+
+    /**
+     * @brief Writer: counting transport wrapped around another one.
+     */
+    typedef struct
+    {
+        crumbs_transport_t transport;    /**< What the context uses; caps mirror inner. */
+        const crumbs_transport_t *inner; /**< Wrapped transport. */
+        void *inner_io;                  /**< Its io. */
+        crumbs_metrics_region_t *region; /**< Shared mapping; NULL when closed. */
+        int fd;                          /**< Region descriptor (a memfd can be passed on). */
+        uint64_t start_ns;               /**< CLOCK_MONOTONIC at open. */
+        char name[64];                   /**< shm name to unlink on close; empty for a memfd. */
+    } crumbs_linux_metrics_t;
+
+    /**
+     * @brief Create and map a zeroed region.
+     *
+     * @param name shm_open() name ("/crumbs-metrics"), or NULL for an
+     *             anonymous memfd (readable through /proc/PID/fd/N).
+     * @return 0 on success, -1 on bad args, -2 if the region cannot be
+     *         created or mapped.
+     */
+    int crumbs_linux_metrics_open(crumbs_linux_metrics_t *m, const char *name);
+
+    /**
+     * @brief Count transfers on @p inner from now on; set m->transport with @p m as io.
+     *
+     * @return 0 on success, -1 on NULL arguments, a closed @p m or an inner
+     *         transport without send().
+     */
+    int crumbs_linux_metrics_wrap(crumbs_linux_metrics_t *m,
+                                  const crumbs_transport_t *inner, void *inner_io);
+
+    /**
+     * @brief Wrap the transport currently set on @p ctx and put @p m in its place.
+     *
+     * @return 0 on success, -1 on NULL arguments or if @p ctx has no transport.
+     */
+    int crumbs_linux_metrics_attach(crumbs_linux_metrics_t *m, crumbs_context_t *ctx);
+
+    /** @brief Publish queue slot @p q (0..CRUMBS_METRICS_QUEUES-1); others are ignored. */
+    void crumbs_linux_metrics_set_queue(crumbs_linux_metrics_t *m, unsigned q, uint32_t depth);
+
+    /**
+     * @brief Publish the engine's queued requests per lane into slots
+     *        CRUMBS_LANE_TELEMETRY and CRUMBS_LANE_CONTROL.
+     *
+     * Walks the queue; call it once per crumbs_engine_poll().
+     */
+    void crumbs_linux_metrics_engine(crumbs_linux_metrics_t *m, const crumbs_engine_t *eng);
+
+    /** @brief Unmap, close and unlink the name. Safe to call twice; mapped readers keep their view. */
+    void crumbs_linux_metrics_close(crumbs_linux_metrics_t *m);
+
+    /**
+     * @brief Reader: read-only mapping of a region.
+     */
+    typedef struct
+    {
+        const crumbs_metrics_region_t *region; /**< Mapping; NULL when unmapped. */
+    } crumbs_linux_metrics_reader_t;
+
+    /**
+     * @brief Map a region read-only.
+     *
+     * @param name An shm name ("/crumbs-metrics") or, if it has a second
+     *             '/', a file path such as /proc/PID/fd/N.
+     * @return 0 on success, -1 on bad args, -2 if it cannot be opened or
+     *         mapped, -3 if it is not a version-1 region.
+     */
+    int crumbs_linux_metrics_map(crumbs_linux_metrics_reader_t *r, const char *name);
+
+    /**
+     * @brief Copy a consistent snapshot of the region.
+     *
+     * @return 0 on success, -1 on bad args, -2 if every attempt raced with
+     *         a write (or the writer died mid-update).
+     */
+    int crumbs_linux_metrics_snapshot(const crumbs_linux_metrics_reader_t *r,
+                                      crumbs_metrics_region_t *out);
+
+    /** @brief Unmap. Safe to call twice. */
+    void crumbs_linux_metrics_unmap(crumbs_linux_metrics_reader_t *r);
+
+    /** @brief Short label of error kind @p kind ("transfer", "select", ...), "?" if out of range. */
+    const char *crumbs_linux_metrics_kind_name(unsigned kind);
+
+    /**
+     * @brief Format a snapshot in the Prometheus text exposition format.
+     *
+     * Emits crumbs_transfers_total, crumbs_errors_total{kind},
+     * crumbs_latency_us histograms per active address, crumbs_busy_us_total,
+     * crumbs_uptime_us and crumbs_queue_depth{queue}.
+     *
+     * @return Characters written (without the NUL), or -1 on bad args or if
+     *         @p cap is too small.
+     */
+    int crumbs_linux_metrics_format_prom(const crumbs_metrics_region_t *snap, char *buf, size_t cap);
+
+#endif /* defined(__linux__) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRUMBS_LINUX_METRICS_H */
@@ -0,0 +1,179 @@
+/**
+ * @file crumbs_linux_rt.h
+ * @brief Fixed-period cycle executive for Linux controllers.
+ *
+ * crumbs_linux_delay_us() and crumbs_linux_millis() are fine for scripts,
+ * but a loop built on relative sleeps drifts by the time each cycle takes
+ * and wakes whole scheduler ticks late under load. This runner sleeps to
+ * absolute deadlines (clock_nanosleep(TIMER_ABSTIME) on CLOCK_MONOTONIC),
+ * so cycle N starts at start + N * period regardless of how long cycle
+ * N - 1 ran, and measures every wake-up against its deadline.
+ *
+ * crumbs_linux_rt_setup() optionally switches the thread to SCHED_FIFO,
+ * pins it to one CPU and locks memory, the usual recipe for 1 kHz loops
+ * on a Raspberry Pi (best with an isolated core, isolcpus=3). Requests
+ * come from a fixed arena inside crumbs_linux_rt_t, so the cycle path
+ * neither allocates nor faults.
+ *
+ * @code
+ * static crumbs_linux_rt_t rt;
+ * crumbs_linux_rt_config_t cfg = {80, 3, 1};   // FIFO 80, CPU 3, mlockall
+ *
+ * crumbs_linux_rt_setup(&cfg);
+ * crumbs_linux_rt_init(&rt, 1000u);            // 1 kHz
+ * for (;;)
+ * {
+ *     crumbs_linux_rt_wait(&rt);
+ *     crumbs_request_t *req = crumbs_linux_rt_request(&rt, &servo, SERVO_OP_GET_POS, on_pos, NULL);
+ *     if (req)
+ *         crumbs_engine_submit(&eng, req);
+ *     crumbs_engine_poll(&eng, crumbs_linux_loop_now_us());
+ * }
+ * @endcode
+ *
+ * Only available on Linux builds. Does not need linux-wire.
+ */
+
+#ifndef CRUMBS_LINUX_RT_H
+#define CRUMBS_LINUX_RT_H
+
+#include <stdint.h>
+
+#include "crumbs_engine.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if defined(__linux__)
+
+    /** @brief Requests in a runner's arena. */
+#ifndef CRUMBS_LINUX_RT_ARENA
+#define CRUMBS_LINUX_RT_ARENA 32
+#endif
+
+    /**
+     * @brief Thread set-up applied by crumbs_linux_rt_setup().
+     */
+    typedef struct
+    {
+        int fifo_priority; /**< SCHED_FIFO priority (1-99), 0 = keep the current policy. */
+        int cpu;           /**< CPU to pin the thread to, -1 = no pinning. */
+        int lock_memory;   /**< Non-zero: mlockall() and pre-fault the stack. */
+    } crumbs_linux_rt_config_t;
+
+    /**
+     * @brief Per-cycle timing, all in microseconds.
+     *
+     * Jitter is how late a cycle started against its deadline; execution
+     * is the time from that start to the next crumbs_linux_rt_wait().
+     */
+    typedef struct
+    {
+        uint64_t cycles;         /**< Cycles started. */
+        uint32_t overruns;       /**< Cycles still running at the next deadline. */
+        uint32_t skipped;        /**< Whole periods dropped to catch up after an overrun. */
+        uint32_t last_jitter_us; /**< Jitter of the latest cycle. */
+        uint32_t max_jitter_us;  /**< Worst jitter. */
+        uint32_t mean_jitter_us; /**< Mean jitter. */
+        uint32_t last_exec_us;   /**< Execution time of the previous cycle. */
+        uint32_t max_exec_us;    /**< Worst execution time. */
+    } crumbs_linux_rt_stats_t;
+
+    /** @brief Arena entry: the request and the callback it completes to. */
+    typedef struct
+    {
+        crumbs_request_t req;     /**< First member: the engine sees only this. */
+        crumbs_request_cb on_done; /**< Caller's callback. */
+        struct crumbs_linux_rt_s *owner; /**< Runner the entry returns to. */
+    } crumbs_linux_rt_slot_t;
+
+    /**
+     * @brief Cycle executive state.
+     */
+    typedef struct crumbs_linux_rt_s
+    {
+        uint32_t period_us;      /**< Cycle period. */
+        uint64_t next_ns;        /**< Absolute deadline of the next cycle (CLOCK_MONOTONIC). */
+        uint64_t started_ns;     /**< Start of the current cycle, 0 before the first. */
+        uint64_t jitter_sum_us;  /**< For mean_jitter_us. */
+        crumbs_linux_rt_stats_t stats; /**< Timing counters. */
+        crumbs_linux_rt_slot_t slots[CRUMBS_LINUX_RT_ARENA]; /**< Request arena. */
+        uint8_t free_list[CRUMBS_LINUX_RT_ARENA]; /**< Indices of free slots. */
+        uint8_t free_count;      /**< Entries in free_list. */
+        uint32_t arena_misses;   /**< crumbs_linux_rt_request() calls on an empty arena. */
+    } crumbs_linux_rt_t;
+
+    /**
+     * @brief Switch the calling thread to real-time operation.
+     *
+     * @return 0 on success, -1 on bad args, -2 if SCHED_FIFO was refused
+     *         (needs CAP_SYS_NICE or an RLIMIT_RTPRIO), -3 if pinning
+     *         failed, -4 if mlockall() failed (RLIMIT_MEMLOCK). Steps
+     *         before the failing one stay applied.
+     */
+    int crumbs_linux_rt_setup(const crumbs_linux_rt_config_t *cfg);
+
+    /**
+     * @brief Initialize @p rt for cycles of @p period_us; the first deadline is one period from now.
+     *
+     * @return 0 on success, -1 on bad args.
+     */
+    int crumbs_linux_rt_init(crumbs_linux_rt_t *rt, uint32_t period_us);
+
+    /**
+     * @brief End the current cycle and sleep until the next deadline.
+     *
+     * If the cycle ran past that deadline it counts as an overrun and the
+     * next one starts at once; periods that passed entirely are skipped
+     * (counted in stats.skipped) so the runner re-locks to its grid instead
+     * of running a burst of late cycles.
+     *
+     * @return 0 if the new cycle started on time, 1 after an overrun, -1 on bad args.
+     */
+    int crumbs_linux_rt_wait(crumbs_linux_rt_t *rt);
+
+    /** @brief Copy the timing counters. */
+    void crumbs_linux_rt_get_stats(const crumbs_linux_rt_t *rt, crumbs_linux_rt_stats_t *out);
+
+    /** @brief Clear the timing counters; the deadline grid is kept. */
+    void crumbs_linux_rt_reset_stats(crumbs_linux_rt_t *rt);
+
+    /**
+     * @brief Take a request from the arena, filled as by crumbs_request_init().
+     *
+     * The entry returns to the arena after @p on_done runs, unless the
+     * callback resubmitted it. user_data is the caller's, as usual.
+     *
+     * @return The request, or NULL if the arena is empty (counted in arena_misses).
+     */
+    crumbs_request_t *crumbs_linux_rt_request(crumbs_linux_rt_t *rt, const crumbs_device_t *dev,
+                                              uint8_t opcode, crumbs_request_cb on_done,
+                                              void *user_data);
+
+    /**
+     * @brief Return a request that was never submitted (or was refused).
+     *
+     * @return 0 on success, -1 if @p req is not an idle entry of @p rt's arena.
+     */
+    int crumbs_linux_rt_release(crumbs_linux_rt_t *rt, crumbs_request_t *req);
+
+    /** @brief CLOCK_MONOTONIC in nanoseconds (does not wrap). */
+    uint64_t crumbs_linux_rt_now_ns(void);
+
+    /** @brief CLOCK_MONOTONIC in microseconds (does not wrap). */
+    uint64_t crumbs_linux_rt_now_us(void);
+
+    /**
+     * @brief Sleep until @p deadline_ns on CLOCK_MONOTONIC, resuming after signals.
+     */
+    void crumbs_linux_rt_sleep_until(uint64_t deadline_ns);
+
+#endif /* defined(__linux__) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRUMBS_LINUX_RT_H */
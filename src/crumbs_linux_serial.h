@@ -0,0 +1,97 @@
+/**
+ * @file crumbs_linux_serial.h
+ * @brief termios UART / RS-485 port for the CRUMBS serial transport.
+ *
+ * Opens a tty (/dev/ttyS*, /dev/ttyUSB*, /dev/ttyAMA*, USB CDC/ACM) in
+ * raw 8N1 mode at up to 4 Mbaud and provides the crumbs_serial_port_t
+ * primitives. With rs485 set, the kernel drives the transceiver's
+ * driver-enable line (TIOCSRS485, RTS on send), so no user-space
+ * direction switching is needed.
+ *
+ * A Raspberry Pi can be either end of the link: as controller through
+ * crumbs_linux_serial_init_controller(), as peripheral with
+ * crumbs_serial_peripheral_poll() on a port from crumbs_linux_serial_port().
+ *
+ * @code
+ * crumbs_linux_serial_t tty;
+ * crumbs_serial_port_t port;
+ * crumbs_linux_serial_init_controller(&ctx, &port, &tty, "/dev/ttyUSB0", 3000000u, 1);
+ * crumbs_device_init(&led, &ctx, 0x08, crumbs_linux_delay_us);
+ * led_send_set_all(&led, 0x0F);      // same ops header as on I2C
+ * @endcode
+ *
+ * Only available on Linux builds. Does not need linux-wire.
+ */
+
+#ifndef CRUMBS_LINUX_SERIAL_H
+#define CRUMBS_LINUX_SERIAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_serial.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if defined(__linux__)
+
+    /**
+     * @brief Open tty.
+     */
+    typedef struct
+    {
+        int fd;        /**< tty fd; -1 when closed. */
+        uint32_t baud; /**< Applied baud rate. */
+    } crumbs_linux_serial_t;
+
+    /**
+     * @brief Open @p path raw 8N1 at @p baud.
+     *
+     * Supported rates are the termios ones from 9600 to 4000000.
+     *
+     * @param rs485 Non-zero enables kernel RS-485 mode (RTS drives DE).
+     * @return 0 on success, -1 on bad args or an unsupported rate, -2 if the
+     *         tty cannot be opened or configured, -3 if RS-485 mode is refused.
+     */
+    int crumbs_linux_serial_open(crumbs_linux_serial_t *tty, const char *path,
+                                 uint32_t baud, int rs485);
+
+    /** @brief Close the tty. Safe to call twice. */
+    void crumbs_linux_serial_close(crumbs_linux_serial_t *tty);
+
+    /** @brief crumbs_serial_write_fn; @p user is the crumbs_linux_serial_t. Waits for tcdrain(). */
+    int crumbs_linux_serial_write(void *user, const uint8_t *data, size_t len);
+
+    /** @brief crumbs_serial_read_fn; @p user is the crumbs_linux_serial_t. Uses poll(). */
+    int crumbs_linux_serial_read(void *user, uint8_t *buf, size_t len, uint32_t timeout_us);
+
+    /** @brief crumbs_serial_init() with the termios primitives and @p tty as user. */
+    void crumbs_linux_serial_port(crumbs_serial_port_t *port, crumbs_linux_serial_t *tty);
+
+    /**
+     * @brief Open @p path and make @p ctx a controller on it.
+     *
+     * crumbs_init() as controller, crumbs_linux_serial_open(),
+     * crumbs_linux_serial_port(), then the context's transport is
+     * crumbs_serial_transport with @p port as io.
+     *
+     * @return As crumbs_linux_serial_open().
+     */
+    int crumbs_linux_serial_init_controller(crumbs_context_t *ctx,
+                                            crumbs_serial_port_t *port,
+                                            crumbs_linux_serial_t *tty,
+                                            const char *path,
+                                            uint32_t baud,
+                                            int rs485);
+
+#endif /* defined(__linux__) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRUMBS_LINUX_SERIAL_H */
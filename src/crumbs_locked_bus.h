@@ -0,0 +1,115 @@
+/**
+ * @file crumbs_locked_bus.h
+ * @brief Mutex-guarded bus adapter for controllers used from several threads.
+ *
+ * Wraps a HAL's write/read/write_read functions so that each physical
+ * transfer runs under a per-bus mutex. The lock is held only for the
+ * transfer itself; framing, CRC and decoding happen outside it.
+ * Threads that talk to different devices on one adapter therefore only
+ * wait for each other while the bus is actually busy.
+ *
+ * Point the devices at the adapter instead of the raw handle:
+ *
+ * @code
+ * static crumbs_locked_bus_t bus;
+ * crumbs_locked_bus_init(&bus, &lw, crumbs_linux_i2c_write, crumbs_linux_read,
+ *                        crumbs_linux_write_then_read);
+ *
+ * dev.ctx      = &shared_ctx;            // library built with CRUMBS_THREAD_SAFE=1
+ * dev.io       = &bus;
+ * dev.write_fn = crumbs_locked_bus_write;
+ * dev.read_fn  = crumbs_locked_bus_read;
+ * @endcode
+ *
+ * Each device must still be driven by one thread at a time: a SET_REPLY
+ * from another thread between a GET's write and read would change the
+ * reply. crumbs_controller_query() with crumbs_locked_bus_write_read()
+ * does both in one locked transaction. Latency tables (dev->latency) are
+ * not locked; give each thread its own.
+ *
+ * Only available on Linux builds (requires pthreads).
+ */
+
+#ifndef CRUMBS_LOCKED_BUS_H
+#define CRUMBS_LOCKED_BUS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crumbs_i2c.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if defined(__linux__)
+
+    /**
+     * @brief A bus handle and the lock that serializes its transfers.
+     */
+    typedef struct
+    {
+        pthread_mutex_t lock;                   /**< Held for one transfer at a time. */
+        void *io;                               /**< Underlying HAL handle. */
+        crumbs_i2c_write_fn write_fn;           /**< Underlying write (may be NULL). */
+        crumbs_i2c_read_fn read_fn;             /**< Underlying read (may be NULL). */
+        crumbs_i2c_write_read_fn write_read_fn; /**< Underlying combined transfer (may be NULL). */
+        uint32_t transfers;                     /**< Transfers performed (updated under the lock). */
+    } crumbs_locked_bus_t;
+
+    /**
+     * @brief Wrap a HAL handle.
+     *
+     * @return 0 on success, -1 on bad args (NULL bus) or mutex failure.
+     */
+    int crumbs_locked_bus_init(crumbs_locked_bus_t *bus,
+                               void *io,
+                               crumbs_i2c_write_fn write_fn,
+                               crumbs_i2c_read_fn read_fn,
+                               crumbs_i2c_write_read_fn write_read_fn);
+
+    /**
+     * @brief Release the mutex. No transfer may be in progress.
+     */
+    void crumbs_locked_bus_destroy(crumbs_locked_bus_t *bus);
+
+    /**
+     * @brief crumbs_i2c_write_fn; @p user_ctx is the crumbs_locked_bus_t.
+     *
+     * @return The underlying result, or -1 if no write function was given.
+     */
+    int crumbs_locked_bus_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len);
+
+    /**
+     * @brief crumbs_i2c_read_fn; @p user_ctx is the crumbs_locked_bus_t.
+     *
+     * @return The underlying result, or -1 if no read function was given.
+     */
+    int crumbs_locked_bus_read(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len, uint32_t timeout_us);
+
+    /**
+     * @brief crumbs_i2c_write_read_fn; @p user_ctx is the crumbs_locked_bus_t.
+     *
+     * @return The underlying result, or -1 if no combined function was given.
+     */
+    int crumbs_locked_bus_write_read(void *user_ctx,
+                                     uint8_t addr,
+                                     const uint8_t *tx,
+                                     size_t tx_len,
+                                     uint8_t *rx,
+                                     size_t rx_len,
+                                     uint32_t timeout_us,
+                                     int require_repeated_start);
+
+#endif /* defined(__linux__) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRUMBS_LOCKED_BUS_H */
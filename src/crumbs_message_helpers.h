@@ -9,6 +9,10 @@
  * All functions are static inline for zero overhead.
  * No static/global state - pure functions only.
  *
+ * The *_array variants move a run of same-typed values with one bounds
+ * check; on little-endian targets (CRUMBS_LITTLE_ENDIAN) they are a single
+ * memcpy and produce the same bytes as the scalar helpers in a loop.
+ *
  * @code
  * // Building a message (controller side)
  * crumbs_message_t msg;
@@ -37,6 +41,23 @@
 #include "crumbs_version.h"
 #include <string.h>
 
+/**
+ * @brief 1 when the target stores integers little-endian, as on the wire.
+ *
+ * Detected from __BYTE_ORDER__ (GCC, Clang, avr-gcc) or MSVC; other
+ * compilers get 0 and the array helpers fall back to per-element shifts.
+ * May be set through build flags.
+ */
+#ifndef CRUMBS_LITTLE_ENDIAN
+#if (defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__) && \
+     __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) ||                  \
+    defined(_MSC_VER)
+#define CRUMBS_LITTLE_ENDIAN 1
+#else
+#define CRUMBS_LITTLE_ENDIAN 0
+#endif
+#endif
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -187,6 +208,102 @@ extern "C"
         return 0;
     }
 
+    /* ============================================================================
+     * Array Building
+     * ============================================================================ */
+
+    /**
+     * @brief Append @p count uint16_t values (little-endian) with one bounds check.
+     *
+     * @param msg   Pointer to message.
+     * @param vals  Values to append.
+     * @param count Number of values.
+     * @return 0 on success, -1 if the payload would overflow (nothing appended).
+     */
+    static inline int crumbs_msg_add_u16_array(crumbs_message_t *msg,
+                                               const uint16_t *vals, uint8_t count)
+    {
+        if ((size_t)msg->data_len + (size_t)count * 2u > CRUMBS_MAX_PAYLOAD)
+            return -1;
+        uint8_t *dst = &msg->data[msg->data_len];
+#if CRUMBS_LITTLE_ENDIAN
+        memcpy(dst, vals, (size_t)count * 2u);
+#else
+        for (uint8_t i = 0; i < count; i++)
+        {
+            dst[2u * i] = (uint8_t)(vals[i] & 0xFF);
+            dst[2u * i + 1u] = (uint8_t)(vals[i] >> 8);
+        }
+#endif
+        msg->data_len = (uint8_t)(msg->data_len + count * 2u);
+        return 0;
+    }
+
+    /**
+     * @brief Append @p count uint32_t values (little-endian) with one bounds check.
+     *
+     * @param msg   Pointer to message.
+     * @param vals  Values to append.
+     * @param count Number of values.
+     * @return 0 on success, -1 if the payload would overflow (nothing appended).
+     */
+    static inline int crumbs_msg_add_u32_array(crumbs_message_t *msg,
+                                               const uint32_t *vals, uint8_t count)
+    {
+        if ((size_t)msg->data_len + (size_t)count * 4u > CRUMBS_MAX_PAYLOAD)
+            return -1;
+        uint8_t *dst = &msg->data[msg->data_len];
+#if CRUMBS_LITTLE_ENDIAN
+        memcpy(dst, vals, (size_t)count * 4u);
+#else
+        for (uint8_t i = 0; i < count; i++)
+        {
+            dst[4u * i] = (uint8_t)(vals[i]);
+            dst[4u * i + 1u] = (uint8_t)(vals[i] >> 8);
+            dst[4u * i + 2u] = (uint8_t)(vals[i] >> 16);
+            dst[4u * i + 3u] = (uint8_t)(vals[i] >> 24);
+        }
+#endif
+        msg->data_len = (uint8_t)(msg->data_len + count * 4u);
+        return 0;
+    }
+
+    /**
+     * @brief Append @p count int16_t values (little-endian) with one bounds check.
+     * @return 0 on success, -1 if the payload would overflow.
+     */
+    static inline int crumbs_msg_add_i16_array(crumbs_message_t *msg,
+                                               const int16_t *vals, uint8_t count)
+    {
+        return crumbs_msg_add_u16_array(msg, (const uint16_t *)vals, count);
+    }
+
+    /**
+     * @brief Append @p count int32_t values (little-endian) with one bounds check.
+     * @return 0 on success, -1 if the payload would overflow.
+     */
+    static inline int crumbs_msg_add_i32_array(crumbs_message_t *msg,
+                                               const int32_t *vals, uint8_t count)
+    {
+        return crumbs_msg_add_u32_array(msg, (const uint32_t *)vals, count);
+    }
+
+    /**
+     * @brief Append @p count floats (native order) with one bounds check.
+     *
+     * @warning Native byte order, as crumbs_msg_add_float().
+     * @return 0 on success, -1 if the payload would overflow.
+     */
+    static inline int crumbs_msg_add_float_array(crumbs_message_t *msg,
+                                                 const float *vals, uint8_t count)
+    {
+        if ((size_t)msg->data_len + (size_t)count * sizeof(float) > CRUMBS_MAX_PAYLOAD)
+            return -1;
+        memcpy(&msg->data[msg->data_len], vals, (size_t)count * sizeof(float));
+        msg->data_len = (uint8_t)(msg->data_len + count * sizeof(float));
+        return 0;
+    }
+
     /* ============================================================================
      * Payload Reading
      * ============================================================================ */
@@ -344,6 +461,100 @@ extern "C"
         return 0;
     }
 
+    /* ============================================================================
+     * Array Reading
+     * ============================================================================ */
+
+    /**
+     * @brief Read @p count uint16_t values (little-endian) with one bounds check.
+     *
+     * @param data   Pointer to payload bytes.
+     * @param len    Length of payload.
+     * @param offset Byte offset of the first value.
+     * @param out    Array to store @p count values.
+     * @param count  Number of values.
+     * @return 0 on success, -1 if offset + 2 * count is out of bounds.
+     */
+    static inline int crumbs_msg_read_u16_array(const uint8_t *data, uint8_t len,
+                                                uint8_t offset, uint16_t *out, uint8_t count)
+    {
+        if ((size_t)offset + (size_t)count * 2u > (size_t)len)
+            return -1;
+        const uint8_t *src = &data[offset];
+#if CRUMBS_LITTLE_ENDIAN
+        memcpy(out, src, (size_t)count * 2u);
+#else
+        for (uint8_t i = 0; i < count; i++)
+        {
+            out[i] = (uint16_t)(src[2u * i] | ((uint16_t)src[2u * i + 1u] << 8));
+        }
+#endif
+        return 0;
+    }
+
+    /**
+     * @brief Read @p count uint32_t values (little-endian) with one bounds check.
+     *
+     * @param data   Pointer to payload bytes.
+     * @param len    Length of payload.
+     * @param offset Byte offset of the first value.
+     * @param out    Array to store @p count values.
+     * @param count  Number of values.
+     * @return 0 on success, -1 if offset + 4 * count is out of bounds.
+     */
+    static inline int crumbs_msg_read_u32_array(const uint8_t *data, uint8_t len,
+                                                uint8_t offset, uint32_t *out, uint8_t count)
+    {
+        if ((size_t)offset + (size_t)count * 4u > (size_t)len)
+            return -1;
+        const uint8_t *src = &data[offset];
+#if CRUMBS_LITTLE_ENDIAN
+        memcpy(out, src, (size_t)count * 4u);
+#else
+        for (uint8_t i = 0; i < count; i++)
+        {
+            out[i] = (uint32_t)src[4u * i] |
+                     ((uint32_t)src[4u * i + 1u] << 8) |
+                     ((uint32_t)src[4u * i + 2u] << 16) |
+                     ((uint32_t)src[4u * i + 3u] << 24);
+        }
+#endif
+        return 0;
+    }
+
+    /**
+     * @brief Read @p count int16_t values (little-endian) with one bounds check.
+     * @return 0 on success, -1 if out of bounds.
+     */
+    static inline int crumbs_msg_read_i16_array(const uint8_t *data, uint8_t len,
+                                                uint8_t offset, int16_t *out, uint8_t count)
+    {
+        return crumbs_msg_read_u16_array(data, len, offset, (uint16_t *)out, count);
+    }
+
+    /**
+     * @brief Read @p count int32_t values (little-endian) with one bounds check.
+     * @return 0 on success, -1 if out of bounds.
+     */
+    static inline int crumbs_msg_read_i32_array(const uint8_t *data, uint8_t len,
+                                                uint8_t offset, int32_t *out, uint8_t count)
+    {
+        return crumbs_msg_read_u32_array(data, len, offset, (uint32_t *)out, count);
+    }
+
+    /**
+     * @brief Read @p count floats (native order) with one bounds check.
+     * @return 0 on success, -1 if out of bounds.
+     */
+    static inline int crumbs_msg_read_float_array(const uint8_t *data, uint8_t len,
+                                                  uint8_t offset, float *out, uint8_t count)
+    {
+        if ((size_t)offset + (size_t)count * sizeof(float) > (size_t)len)
+            return -1;
+        memcpy(out, &data[offset], (size_t)count * sizeof(float));
+        return 0;
+    }
+
     /* ============================================================================
      * Protocol Helpers
      * ============================================================================ */
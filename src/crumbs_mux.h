@@ -0,0 +1,208 @@
+/**
+ * @file crumbs_mux.h
+ * @brief Devices behind TCA9548A-style I2C multiplexers.
+ *
+ * A mux at 0x70-0x77 connects its upstream bus to any of 8 channels, set
+ * by writing one control byte (bit n = channel n). Behind muxes one bus
+ * can reach more than 112 devices, and the same address can be reused on
+ * different channels. The cost is a select write before a transfer
+ * whenever the channel changes.
+ *
+ * A crumbs_mux_t wraps the upstream transport and remembers the control
+ * byte it last wrote to each mux. A device behind a mux is addressed by
+ * the path (mux address, channel, device address). Its io is the
+ * channel's crumbs_mux_port_t, so every transfer first makes that path
+ * the only open one, and skips the select writes when it already is.
+ * Family ops headers, the engine and the scheduler work unchanged.
+ *
+ * Switching is kept low in two places. With eng->group_io set, the
+ * request engine queues a GET next to the other requests on the same
+ * port, so a poll round visits each channel once. crumbs_mux_scan()
+ * opens the same channel on every mux at once and ACK-scans once per
+ * channel, not once per mux and channel. It then probes only the
+ * addresses that answered.
+ *
+ * @code
+ * static crumbs_mux_t mux;
+ * crumbs_linux_init_controller(&ctx, &lw, "/dev/i2c-1", 10000);
+ * crumbs_mux_init(&mux, ctx.transport, ctx.transport_io);
+ * crumbs_mux_add(&mux, 0x70);
+ * crumbs_mux_add(&mux, 0x71);
+ * crumbs_mux_device_init(&servo[0], &ctx, &mux, 0x70, 3, 0x20, crumbs_linux_delay_us);
+ * crumbs_mux_device_init(&servo[1], &ctx, &mux, 0x71, 3, 0x20, crumbs_linux_delay_us);
+ * @endcode
+ *
+ * Devices on the upstream bus itself keep using the upstream transport.
+ * If something else writes a mux's control register, call
+ * crumbs_mux_invalidate().
+ */
+
+#ifndef CRUMBS_MUX_H
+#define CRUMBS_MUX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_transport.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /** @brief Muxes on one upstream bus. */
+#ifndef CRUMBS_MUX_MAX
+#define CRUMBS_MUX_MAX 4
+#endif
+
+    /** @brief Channels per mux (TCA9548A / PCA9548A). */
+#define CRUMBS_MUX_CHANNELS 8u
+
+    /** @brief selected[] value while a mux's control byte is not known. */
+#define CRUMBS_MUX_UNKNOWN 0xFFu
+
+    struct crumbs_mux_s;
+
+    /**
+     * @brief One mux channel: the io of every device behind it.
+     */
+    typedef struct
+    {
+        struct crumbs_mux_s *mux; /**< Owning mux set. */
+        uint8_t index;            /**< Mux index in mux->addr. */
+        uint8_t channel;          /**< Channel 0-7. */
+    } crumbs_mux_port_t;
+
+    /**
+     * @brief Muxes on one upstream bus and their cached selections.
+     */
+    typedef struct crumbs_mux_s
+    {
+        crumbs_transport_t transport;    /**< Given to devices behind the muxes; caps mirror inner. */
+        const crumbs_transport_t *inner; /**< Upstream transport. */
+        void *inner_io;                  /**< Its io. */
+        uint8_t addr[CRUMBS_MUX_MAX];    /**< Mux addresses, in add order. */
+        uint8_t selected[CRUMBS_MUX_MAX]; /**< Control byte last written, or CRUMBS_MUX_UNKNOWN. */
+        uint8_t count;                   /**< Muxes added. */
+        crumbs_mux_port_t ports[CRUMBS_MUX_MAX][CRUMBS_MUX_CHANNELS]; /**< Per-channel io. */
+        uint32_t switches;               /**< Control bytes written. */
+        uint32_t hits;                   /**< Transfers whose path was already open. */
+    } crumbs_mux_t;
+
+    /**
+     * @brief One device found by crumbs_mux_scan().
+     */
+    typedef struct
+    {
+        uint8_t mux_addr; /**< Mux the device is behind. */
+        uint8_t channel;  /**< Its channel. */
+        uint8_t addr;     /**< Device address. */
+        uint8_t type_id;  /**< type_id of its probe reply. */
+    } crumbs_mux_found_t;
+
+    /**
+     * @brief Wrap the upstream transport; no muxes yet.
+     *
+     * transact is offered if @p inner has one. Broadcast is not, since a
+     * general call reaches only the open channels.
+     *
+     * @return 0 on success, -1 on NULL arguments or an @p inner without send().
+     */
+    int crumbs_mux_init(crumbs_mux_t *mux, const crumbs_transport_t *inner, void *inner_io);
+
+    /**
+     * @brief Register the mux at @p mux_addr; its selection starts unknown.
+     *
+     * @return Its index, or -1 on bad args, a duplicate, or a full table.
+     */
+    int crumbs_mux_add(crumbs_mux_t *mux, uint8_t mux_addr);
+
+    /**
+     * @brief The port of @p channel on the mux at @p mux_addr.
+     *
+     * @return The port, or NULL if the mux is not registered or @p channel > 7.
+     */
+    crumbs_mux_port_t *crumbs_mux_port(crumbs_mux_t *mux, uint8_t mux_addr, uint8_t channel);
+
+    /**
+     * @brief Fill @p dev for the path (@p mux_addr, @p channel, @p addr).
+     *
+     * Like crumbs_device_init(), with the mux transport and the port as io.
+     *
+     * @return 0 on success, -1 on NULL arguments or an unknown path.
+     */
+    int crumbs_mux_device_init(crumbs_device_t *dev, crumbs_context_t *ctx, crumbs_mux_t *mux,
+                               uint8_t mux_addr, uint8_t channel, uint8_t addr,
+                               crumbs_delay_fn delay_fn);
+
+    /**
+     * @brief Path of @p dev, if it is behind a mux.
+     *
+     * @return 0 and the mux address and channel, or -1 if @p dev is not behind one.
+     */
+    int crumbs_mux_device_path(const crumbs_device_t *dev, uint8_t *mux_addr, uint8_t *channel);
+
+    /**
+     * @brief Make @p port the only open channel, writing only muxes that differ.
+     *
+     * The other muxes are closed so equal addresses on them cannot answer.
+     *
+     * @return 0 on success, or the upstream send() error (that mux's
+     *         selection becomes unknown).
+     */
+    int crumbs_mux_select(crumbs_mux_port_t *port);
+
+    /**
+     * @brief Close every channel of every mux.
+     *
+     * @return 0 on success, or the first upstream send() error.
+     */
+    int crumbs_mux_close_all(crumbs_mux_t *mux);
+
+    /** @brief Forget the cached selections; the next transfer rewrites them. */
+    void crumbs_mux_invalidate(crumbs_mux_t *mux);
+
+    /** @brief Select, then write (crumbs_i2c_write_fn; user_ctx is a crumbs_mux_port_t). */
+    int crumbs_mux_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len);
+
+    /** @brief Select, then read (crumbs_i2c_read_fn; user_ctx is a crumbs_mux_port_t). */
+    int crumbs_mux_read(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len,
+                        uint32_t timeout_us);
+
+    /**
+     * @brief Select, then run the upstream transact (crumbs_i2c_write_read_fn).
+     *
+     * @return As the upstream transact; CRUMBS_I2C_DEV_E_NO_REPEATED_START
+     *         if it has none.
+     */
+    int crumbs_mux_write_read(void *user_ctx, uint8_t addr, const uint8_t *tx, size_t tx_len,
+                              uint8_t *rx, size_t rx_len, uint32_t timeout_us,
+                              int require_repeated_start);
+
+    /**
+     * @brief Find CRUMBS devices behind every mux, grouped by channel.
+     *
+     * With all muxes closed, one ACK-scan of the range records the
+     * upstream devices. Then, for each channel, that channel is opened on
+     * every mux at once and the range is ACK-scanned again. Addresses
+     * that answer, apart from upstream devices and the muxes themselves,
+     * are probed on each mux as crumbs_controller_scan_for_crumbs_candidates()
+     * would. A bus with N muxes thus costs 9 range scans instead of
+     * 1 + 8N, plus one select per mux on channels where something
+     * answered. All muxes are closed afterwards.
+     *
+     * @param scan_fn Address-ACK scanner on the upstream io (e.g. crumbs_linux_scan).
+     * @param strict  Passed to the probe.
+     * @return Devices found (>= 0), or negative on a scan or select error.
+     */
+    int crumbs_mux_scan(crumbs_mux_t *mux, const crumbs_context_t *ctx,
+                        crumbs_i2c_scan_fn scan_fn, uint8_t start_addr, uint8_t end_addr,
+                        int strict, crumbs_mux_found_t *found, size_t max_found,
+                        uint32_t timeout_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRUMBS_MUX_H */
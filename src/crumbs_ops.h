@@ -17,27 +17,32 @@
  *                        THERM_TYPE_ID, THERM_OP_GET_TEMP,
  *                        therm_temp_result_t, therm_parse_temperature)
  *
- *   CRUMBS_DEFINE_SEND_OP(therm, set_interval,
- *                         THERM_TYPE_ID, THERM_OP_SET_INTERVAL,
- *                         uint16_t interval_ms,
- *                         crumbs_msg_add_u16(&_m, interval_ms))
+ *   CRUMBS_DEFINE_SEND_OP_FB(therm, set_interval,
+ *                            THERM_TYPE_ID, THERM_OP_SET_INTERVAL,
+ *                            uint16_t interval_ms,
+ *                            crumbs_fb_add_u16(&_fb, interval_ms))
  *
  *   CRUMBS_DEFINE_SEND_OP_0(therm, reset, THERM_TYPE_ID, THERM_OP_RESET)
  * @endcode
  *
  * Macro limitations:
- *   - CRUMBS_DEFINE_SEND_OP supports only single-parameter SETs cleanly.
+ *   - CRUMBS_DEFINE_SEND_OP[_FB] supports only single-parameter SETs cleanly.
  *     Operations with 2+ parameters should be written as normal inline
  *     functions (see any lhwit_family ops header for reference).
  *   - CRUMBS_DEFINE_GET_OP covers the standard 1:1 opcode->result fetch only.
  *     Parameterized queries (e.g. "get history entry N") require a custom
  *     _query_* that packs the index into the message payload.
  *
- * Requires: crumbs.h (includes crumbs_i2c.h for crumbs_device_t),
- *           crumbs_message_helpers.h (for crumbs_msg_init, crumbs_msg_add_*)
+ * Requires: crumbs.h (includes crumbs_i2c.h for crumbs_device_t and
+ *           crumbs_frame_builder.h for crumbs_fb_*),
+ *           crumbs_message_helpers.h (for crumbs_msg_init, crumbs_msg_add_*),
+ *           crumbs_engine.h (for the async family_request_* form),
+ *           crumbs_latency.h (for learned reply delays)
  */
 
 #include "crumbs.h"
+#include "crumbs_engine.h"
+#include "crumbs_latency.h"
 #include "crumbs_message_helpers.h"
 
 /* -----------------------------------------------------------------------
@@ -45,41 +50,123 @@
  *
  * Generates:
  *   family_query_name(dev)           — @internal, sends SET_REPLY probe
- *   family_get_name(dev, result_t*)  — public, full query+delay+read+parse
+ *   family_parse_name_reply(msg, result_t*) — checks type/opcode, parses
+ *   family_get_name(dev, result_t*)  — public, full query+delay+read+parse;
+ *                                      waits dev->latency's learned delay
+ *                                      when set (crumbs_latency.h)
+ *   family_get_name_ready(dev, result_t*)
+ *                                    — query, then read at once and re-read
+ *                                      while the peripheral answers NOT_READY
+ *                                      (crumbs_reply_not_ready()); no fixed wait
+ *   family_get_name_combined(dev, write_read_fn, result_t*)
+ *                                    — SET_REPLY and read in one repeated-START
+ *                                      transaction (crumbs_controller_query());
+ *                                      for peripherals that answer immediately
+ *   family_request_name(eng, req, dev, on_done, user_data)
+ *                                    — queues the GET on a crumbs_engine_t;
+ *                                      on_done parses req->reply with
+ *                                      family_parse_name_reply()
  *
  * Parameters:
  *   family    Token prefix, e.g. therm
  *   name      Operation name token, e.g. temperature
- *   type_id   Peripheral type ID constant
- *   opcode    Op constant for this GET, e.g. THERM_OP_GET_TEMP
- *   result_t  Typedef name of the result struct, e.g. therm_temp_result_t
- *   parse_fn  int parse_fn(const uint8_t *data, size_t len, result_t *out)
+ *   op_type_id  Peripheral type ID constant
+ *   op_opcode   Op constant for this GET, e.g. THERM_OP_GET_TEMP
+ *   result_t    Typedef name of the result struct, e.g. therm_temp_result_t
+ *   parse_fn    int parse_fn(const uint8_t *data, size_t len, result_t *out)
+ *
+ * The type/opcode parameters are not named type_id/opcode because the body
+ * reads _r.type_id and _r.opcode, which the preprocessor would rewrite.
+ * ----------------------------------------------------------------------- */
+#define CRUMBS_DEFINE_GET_OP(family, name, op_type_id, op_opcode, result_t, parse_fn)  \
+    CRUMBS_DEFINE_GET_OP_LEN(family, name, op_type_id, op_opcode, result_t, parse_fn,  \
+                             CRUMBS_MAX_PAYLOAD)
+
+/* -----------------------------------------------------------------------
+ * CRUMBS_DEFINE_GET_OP_LEN
+ *
+ * CRUMBS_DEFINE_GET_OP for a reply whose payload is at most max_len
+ * bytes. family_get_name() and family_request_name() then read only
+ * 4 + max_len bytes (crumbs_controller_read_len()) instead of the full
+ * 31-byte frame; at 100 kHz a 1-byte reply saves about 2.3 ms per GET.
+ * A reply longer than max_len is truncated and rejected.
+ *
+ *   CRUMBS_DEFINE_GET_OP_LEN(therm, status, THERM_TYPE_ID, THERM_OP_GET_STATUS,
+ *                            uint8_t, therm_parse_status, 1)
  * ----------------------------------------------------------------------- */
-#define CRUMBS_DEFINE_GET_OP(family, name, type_id, opcode, result_t, parse_fn)        \
+#define CRUMBS_DEFINE_GET_OP_LEN(family, name, op_type_id, op_opcode, result_t,        \
+                                 parse_fn, max_len)                                     \
     /** @internal Used by family##_get_##name(); prefer that for              */        \
     /** combined query+read.                                                  */        \
     static inline int family##_query_##name(const crumbs_device_t *dev)                \
     {                                                                                   \
-        crumbs_message_t _m;                                                            \
-        crumbs_msg_init(&_m, 0, CRUMBS_CMD_SET_REPLY);                                 \
-        crumbs_msg_add_u8(&_m, (uint8_t)(opcode));                                     \
-        return crumbs_controller_send(dev->ctx, dev->addr, &_m,                        \
-                                      dev->write_fn, dev->io);                         \
+        crumbs_frame_builder_t _fb;                                                     \
+        crumbs_fb_init(&_fb, 0, CRUMBS_CMD_SET_REPLY);                                 \
+        crumbs_fb_add_u8(&_fb, (uint8_t)(op_opcode));                                  \
+        return crumbs_controller_send_frame(dev->ctx, dev->addr, &_fb,                 \
+                                            dev->write_fn, dev->io);                   \
+    }                                                                                   \
+    static inline int family##_parse_##name##_reply(const crumbs_message_t *r,         \
+                                                    result_t *out)                     \
+    {                                                                                   \
+        if (!r || !out) return -1;                                                      \
+        if (r->type_id != (uint8_t)(op_type_id) ||                                     \
+            r->opcode  != (uint8_t)(op_opcode))  return -1;                            \
+        return parse_fn(r->data, r->data_len, out);                                    \
     }                                                                                   \
     static inline int family##_get_##name(const crumbs_device_t *dev, result_t *out)   \
     {                                                                                   \
         crumbs_message_t _r;                                                            \
+        uint32_t _wait;                                                                 \
         int _rc;                                                                        \
         if (!out) return -1;                                                            \
         _rc = family##_query_##name(dev);                                               \
         if (_rc != 0) return _rc;                                                       \
-        dev->delay_fn(CRUMBS_DEFAULT_QUERY_DELAY_US);                                   \
-        _rc = crumbs_controller_read(dev->ctx, dev->addr, &_r,                         \
-                                     dev->read_fn, dev->io);                           \
+        _wait = crumbs_device_query_delay(dev, (uint8_t)(op_opcode));                  \
+        dev->delay_fn(_wait);                                                           \
+        _rc = crumbs_controller_read_len(dev->ctx, dev->addr, &_r,                     \
+                                         dev->read_fn, dev->io, (uint8_t)(max_len));    \
+        crumbs_device_query_result(dev, (uint8_t)(op_opcode), _wait,                   \
+                                   _rc == 0 && _r.opcode == (uint8_t)(op_opcode));     \
         if (_rc != 0) return _rc;                                                       \
-        if (_r.type_id != (uint8_t)(type_id) ||                                        \
-            _r.opcode  != (uint8_t)(opcode))  return -1;                               \
-        return parse_fn(_r.data, _r.data_len, out);                                    \
+        return family##_parse_##name##_reply(&_r, out);                                \
+    }                                                                                   \
+    static inline int family##_get_##name##_ready(const crumbs_device_t *dev,          \
+                                                  result_t *out)                       \
+    {                                                                                   \
+        crumbs_message_t _r;                                                            \
+        int _rc;                                                                        \
+        if (!out) return -1;                                                            \
+        _rc = family##_query_##name(dev);                                               \
+        if (_rc != 0) return _rc;                                                       \
+        _rc = crumbs_controller_read_ready(dev->ctx, dev->addr, &_r,                   \
+                                           dev->read_fn, dev->io, dev->delay_fn,       \
+                                           CRUMBS_READY_POLL_INTERVAL_US,              \
+                                           CRUMBS_READY_POLL_TIMEOUT_US);              \
+        if (_rc != 0) return _rc;                                                       \
+        return family##_parse_##name##_reply(&_r, out);                                \
+    }                                                                                   \
+    static inline int family##_get_##name##_combined(const crumbs_device_t *dev,       \
+                                                     crumbs_i2c_write_read_fn wr_fn,   \
+                                                     result_t *out)                    \
+    {                                                                                   \
+        crumbs_message_t _r;                                                            \
+        int _rc;                                                                        \
+        if (!out) return -1;                                                            \
+        _rc = crumbs_controller_query(dev->ctx, dev->addr, (uint8_t)(op_opcode), &_r,  \
+                                      wr_fn, dev->io);                                 \
+        if (_rc != 0) return _rc;                                                       \
+        return family##_parse_##name##_reply(&_r, out);                                \
+    }                                                                                   \
+    static inline int family##_request_##name(crumbs_engine_t *eng,                    \
+                                              crumbs_request_t *req,                   \
+                                              const crumbs_device_t *dev,              \
+                                              crumbs_request_cb on_done,               \
+                                              void *user_data)                         \
+    {                                                                                   \
+        crumbs_request_init(req, dev, (uint8_t)(op_opcode), on_done, user_data);       \
+        if (req) req->reply_len = (uint8_t)(max_len);                                   \
+        return crumbs_engine_submit(eng, req);                                          \
     }
 
 /* -----------------------------------------------------------------------
@@ -115,6 +202,31 @@
                                       dev->write_fn, dev->io);                        \
     }
 
+/* -----------------------------------------------------------------------
+ * CRUMBS_DEFINE_SEND_OP_FB
+ *
+ * Generates:
+ *   family_send_name(dev, param)  — public, single-parameter SET
+ *
+ * Same as CRUMBS_DEFINE_SEND_OP, but pack_stmt appends to the local
+ * crumbs_frame_builder_t _fb, so the payload is written straight into the
+ * wire buffer instead of being copied out of a crumbs_message_t, e.g.:
+ *   crumbs_fb_add_u8(&_fb, mask)
+ *   crumbs_fb_add_u16(&_fb, interval_ms)
+ *
+ * Prefer this form for new ops headers; CRUMBS_DEFINE_SEND_OP remains for
+ * existing pack statements written against _m.
+ * ----------------------------------------------------------------------- */
+#define CRUMBS_DEFINE_SEND_OP_FB(family, name, type_id, opcode, param_decl, pack_stmt) \
+    static inline int family##_send_##name(const crumbs_device_t *dev, param_decl)    \
+    {                                                                                  \
+        crumbs_frame_builder_t _fb;                                                    \
+        crumbs_fb_init(&_fb, (uint8_t)(type_id), (uint8_t)(opcode));                  \
+        pack_stmt;                                                                     \
+        return crumbs_controller_send_frame(dev->ctx, dev->addr, &_fb,                \
+                                            dev->write_fn, dev->io);                  \
+    }
+
 /* -----------------------------------------------------------------------
  * CRUMBS_DEFINE_SEND_OP_0
  *
@@ -126,10 +238,28 @@
 #define CRUMBS_DEFINE_SEND_OP_0(family, name, type_id, opcode)                        \
     static inline int family##_send_##name(const crumbs_device_t *dev)                \
     {                                                                                  \
-        crumbs_message_t _m;                                                           \
-        crumbs_msg_init(&_m, (uint8_t)(type_id), (uint8_t)(opcode));                  \
-        return crumbs_controller_send(dev->ctx, dev->addr, &_m,                       \
-                                      dev->write_fn, dev->io);                        \
+        crumbs_frame_builder_t _fb;                                                    \
+        crumbs_fb_init(&_fb, (uint8_t)(type_id), (uint8_t)(opcode));                  \
+        return crumbs_controller_send_frame(dev->ctx, dev->addr, &_fb,                \
+                                            dev->write_fn, dev->io);                  \
     }
 
+/* -----------------------------------------------------------------------
+ * CRUMBS_STATIC_ASSERT
+ *
+ * Compile-time check usable at file scope in C and C++ ops headers; tag
+ * is a unique identifier naming the check. Headers from
+ * scripts/generate_family.py use it to fail the build when a payload
+ * layout no longer fits CRUMBS_MAX_PAYLOAD:
+ *
+ *   CRUMBS_STATIC_ASSERT(SERVO_OP_SWEEP_LEN <= CRUMBS_MAX_PAYLOAD, servo_sweep_fits);
+ * ----------------------------------------------------------------------- */
+#if defined(__cplusplus) && __cplusplus >= 201103L
+#define CRUMBS_STATIC_ASSERT(cond, tag) static_assert(cond, #tag)
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define CRUMBS_STATIC_ASSERT(cond, tag) _Static_assert(cond, #tag)
+#else
+#define CRUMBS_STATIC_ASSERT(cond, tag) typedef char crumbs_static_assert_##tag[(cond) ? 1 : -1]
+#endif
+
 #endif /* CRUMBS_OPS_H */
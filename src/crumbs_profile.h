@@ -0,0 +1,168 @@
+/**
+ * @file crumbs_profile.h
+ * @brief Bus time profiler: where a controller's I2C budget goes.
+ *
+ * A crumbs_profile_t sits between a controller context and its transport,
+ * like crumbs_capture_t, and times every write, read and combined transfer
+ * of the HAL underneath (crumbs_linux_transport, crumbs_arduino_transport,
+ * crumbs_vbus_transport, ...). Per kind of transfer it counts the bytes
+ * asked for, the bytes that crossed the bus, and the bytes that belonged
+ * to a CRUMBS frame. A 31-byte read that carries a 5-byte frame has 26
+ * bytes of padding. Waits between SET_REPLY and the read are timed too
+ * when devices use crumbs_profile_delay_us() as their delay_fn.
+ *
+ * crumbs_profile_summary() turns the counters into goodput (frame bytes
+ * per second) and splits the measured transfer time by an estimate of its
+ * wire time at the bus clock:
+ *   - addressing: START, address byte and STOP of every phase
+ *   - payload:    the bytes of each frame
+ *   - padding:    read bytes past the end of the reply frame
+ *   - stall:      measured minus estimated (clock stretching, driver and
+ *                 kernel overhead)
+ * Wire time uses the same model as the virtual bus: 10 clocks for START
+ * and the address byte, 9 per data byte, and 1 for STOP.
+ *
+ * @code
+ * static crumbs_profile_t prof;
+ * crumbs_linux_init_controller(&ctx, &lw, "/dev/i2c-1", 10000);
+ * crumbs_profile_attach(&prof, &ctx, crumbs_linux_loop_now_us, 100000u);
+ * prof.delay = crumbs_linux_delay_us;
+ * crumbs_profile_use(&prof);
+ * crumbs_device_init(&led, &ctx, 0x08, crumbs_profile_delay_us);   // profiled from here on
+ * ...
+ * crumbs_profile_summary_t s;
+ * crumbs_profile_summary(&prof, &s);
+ * @endcode
+ *
+ * Profiling is opt-in: nothing is measured until a transport is wrapped,
+ * and crumbs_profile_reset() starts a new window. Counters are u32 and
+ * wrap; the microsecond clock wraps after about 71 minutes, so keep
+ * windows shorter than that.
+ */
+
+#ifndef CRUMBS_PROFILE_H
+#define CRUMBS_PROFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_transport.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /** @name Transfer Kinds
+     *  @{ */
+#define CRUMBS_PROFILE_WRITE 0u    /**< send(). */
+#define CRUMBS_PROFILE_READ 1u     /**< receive(). */
+#define CRUMBS_PROFILE_TRANSACT 2u /**< transact() (write, then read). */
+#define CRUMBS_PROFILE_KINDS 3u
+    /** @} */
+
+    /**
+     * @brief Counters for one kind of transfer.
+     */
+    typedef struct
+    {
+        uint32_t count;        /**< Transfers. */
+        uint32_t errors;       /**< Transfers that returned < 0 (or a read of no bytes). */
+        uint32_t time_us;      /**< Measured time inside the HAL. */
+        uint32_t max_us;       /**< Slowest transfer. */
+        uint32_t requested;    /**< Bytes written plus read lengths asked for. */
+        uint32_t moved;        /**< Bytes clocked on the bus. */
+        uint32_t used;         /**< Bytes that were part of a CRUMBS frame (or all written bytes). */
+        uint32_t phases;       /**< Address phases (a combined transfer has two). */
+    } crumbs_profile_stat_t;
+
+    /**
+     * @brief Profiling transport wrapped around another one.
+     */
+    typedef struct
+    {
+        crumbs_transport_t transport;    /**< What the context uses; caps mirror inner. */
+        const crumbs_transport_t *inner; /**< Wrapped transport. */
+        void *inner_io;                  /**< Its io. */
+        crumbs_clock_us_fn clock;        /**< Microsecond clock. */
+        crumbs_delay_fn delay;           /**< Real delay behind crumbs_profile_delay_us(); NULL = none. */
+        uint32_t bus_hz;                 /**< SCL clock for wire-time estimates (0 = 100 kHz). */
+        uint32_t start_us;               /**< clock() at init or the latest reset. */
+        crumbs_profile_stat_t kinds[CRUMBS_PROFILE_KINDS]; /**< Per CRUMBS_PROFILE_*. */
+        uint32_t delays;                 /**< crumbs_profile_delay_us() calls. */
+        uint32_t delay_asked_us;         /**< Microseconds asked for. */
+        uint32_t delay_us;               /**< Microseconds measured. */
+    } crumbs_profile_t;
+
+    /**
+     * @brief Where the time of a profiling window went.
+     *
+     * The *_us estimates add up to transfer_us (stall_us absorbs the
+     * difference and is 0 when the estimate exceeds the measurement).
+     */
+    typedef struct
+    {
+        uint32_t elapsed_us;    /**< Window length. */
+        uint32_t transfer_us;   /**< Inside transfers. */
+        uint32_t delay_us;      /**< Inside crumbs_profile_delay_us(). */
+        uint32_t other_us;      /**< Neither (application code, idle). */
+        uint32_t addr_us;       /**< Estimated: START, address and STOP. */
+        uint32_t payload_us;    /**< Estimated: frame bytes. */
+        uint32_t padding_us;    /**< Estimated: read bytes past the frame. */
+        uint32_t stall_us;      /**< Measured minus estimated. */
+        uint32_t transfers;     /**< All transfers. */
+        uint32_t errors;        /**< All errors. */
+        uint32_t requested;     /**< Bytes asked for. */
+        uint32_t moved;         /**< Bytes clocked. */
+        uint32_t used;          /**< Frame bytes. */
+        uint32_t goodput_bps;   /**< Frame bytes per second of the window. */
+        uint32_t bus_bps;       /**< Frame bytes per second spent in transfers. */
+        uint8_t busy_pct;       /**< transfer_us share of the window. */
+        uint8_t efficiency_pct; /**< payload_us share of transfer_us. */
+    } crumbs_profile_summary_t;
+
+    /**
+     * @brief Wrap @p inner so its transfers are profiled.
+     *
+     * Set prof->transport on a context or device with @p prof as io.
+     *
+     * @param clock  Microsecond clock (crumbs_linux_loop_now_us, micros, ...).
+     * @param bus_hz SCL clock for the wire-time estimate (0 = 100 kHz).
+     * @return 0 on success, -1 on NULL arguments or an inner transport without send().
+     */
+    int crumbs_profile_init(crumbs_profile_t *prof,
+                            const crumbs_transport_t *inner, void *inner_io,
+                            crumbs_clock_us_fn clock, uint32_t bus_hz);
+
+    /**
+     * @brief Wrap the transport currently set on @p ctx and put the profiler in its place.
+     *
+     * Devices initialized from @p ctx afterwards are profiled too.
+     *
+     * @return 0 on success, -1 on NULL arguments or if @p ctx has no transport.
+     */
+    int crumbs_profile_attach(crumbs_profile_t *prof, crumbs_context_t *ctx,
+                              crumbs_clock_us_fn clock, uint32_t bus_hz);
+
+    /** @brief Zero the counters and start a new window. */
+    void crumbs_profile_reset(crumbs_profile_t *prof);
+
+    /** @brief Select the profiler timed by crumbs_profile_delay_us() (NULL = none). */
+    void crumbs_profile_use(crumbs_profile_t *prof);
+
+    /**
+     * @brief crumbs_delay_fn that runs the selected profiler's delay and times it.
+     *
+     * Does nothing when no profiler is selected or it has no delay.
+     */
+    void crumbs_profile_delay_us(uint32_t us);
+
+    /** @brief Fill @p out from the counters so far. */
+    void crumbs_profile_summary(const crumbs_profile_t *prof, crumbs_profile_summary_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRUMBS_PROFILE_H */
@@ -0,0 +1,186 @@
+/**
+ * @file crumbs_recover.h
+ * @brief Stuck-bus detection and recovery for controllers.
+ *
+ * A peripheral that resets in the middle of a read can be left driving
+ * SDA low. Every later transfer then fails, usually after the adapter's
+ * full timeout, until the slave is clocked through the rest of its byte.
+ * A crumbs_recover_t sits between a controller context and its transport,
+ * like crumbs_capture_t, and watches every transfer on the bus:
+ *
+ * - fail_limit failures in a row, on any addresses, trip it. A single
+ *   dead device is better handled by crumbs_retry_t's breaker, which stops
+ *   calling it; successes to other devices reset the count.
+ * - A failure that took stall_us or longer trips it at once. A held bus
+ *   shows up as timeouts, not as quick NACKs.
+ *
+ * On a trip it calls the platform's recover hook, which should free the
+ * bus and re-initialize the adapter: crumbs_arduino_bus_recover(),
+ * crumbs_linux_recover(), or an application function that calls
+ * crumbs_bus_clear() on GPIOs first. Then it re-validates the registry
+ * entries of this bus, if one is set, so devices that did not come back
+ * drop out. The transfer that tripped still returns its error. Recoveries
+ * closer together than holdoff_us are skipped and counted.
+ *
+ * crumbs_bus_clear() is the standard recovery sequence: release SDA, clock
+ * SCL up to 9 times until the slave lets SDA go, then send a STOP.
+ *
+ * @code
+ * static crumbs_recover_t rec;
+ * crumbs_arduino_init_controller(&ctx);
+ * crumbs_recover_attach(&rec, &ctx, micros, crumbs_arduino_bus_recover, &Wire);
+ * crumbs_recover_set_registry(&rec, &reg, 0u, &ctx);
+ * crumbs_device_init(&led, &ctx, 0x08, crumbs_arduino_delay_us);   // guarded from here on
+ * @endcode
+ */
+
+#ifndef CRUMBS_RECOVER_H
+#define CRUMBS_RECOVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_registry.h"
+#include "crumbs_transport.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /** @brief Default consecutive failures that trip recovery. */
+#ifndef CRUMBS_RECOVER_FAIL_LIMIT
+#define CRUMBS_RECOVER_FAIL_LIMIT 3u
+#endif
+
+    /** @brief Default duration after which a failed transfer trips at once. */
+#ifndef CRUMBS_RECOVER_STALL_US
+#define CRUMBS_RECOVER_STALL_US 20000u
+#endif
+
+    /** @brief Default minimum spacing of two recoveries. */
+#ifndef CRUMBS_RECOVER_HOLDOFF_US
+#define CRUMBS_RECOVER_HOLDOFF_US 100000u
+#endif
+
+    /** @brief Returned by crumbs_bus_clear() when SDA stays low after 9 clocks and a STOP. */
+#define CRUMBS_RECOVER_E_STUCK -2
+
+    /**
+     * @brief Platform hook that frees the bus and re-initializes the adapter.
+     *
+     * @return 0 on success, negative if the bus could not be recovered.
+     */
+    typedef int (*crumbs_bus_recover_fn)(void *io);
+
+    /**
+     * @brief Open-drain pin access for crumbs_bus_clear().
+     *
+     * Level 1 releases the line (input, pulled up), level 0 drives it low.
+     */
+    typedef struct
+    {
+        void (*set_scl)(void *user, int level); /**< Drive or release SCL. */
+        void (*set_sda)(void *user, int level); /**< Drive or release SDA. */
+        int (*get_sda)(void *user);             /**< Non-zero while SDA is high. */
+        crumbs_delay_fn delay;                  /**< Microsecond delay (may be NULL). */
+        void *user;                             /**< Passed to the pin functions. */
+        uint32_t half_period_us;                /**< Half an SCL clock (0 = 5 us, 100 kHz). */
+    } crumbs_bus_pins_t;
+
+    /**
+     * @brief Free a bus held low by a slave.
+     *
+     * Releases SDA, clocks SCL while SDA reads low (at most 9 times), then
+     * sends a STOP. Call it with the I2C peripheral detached from the pins.
+     *
+     * @return Clocks sent (0-9), -1 on bad args, or CRUMBS_RECOVER_E_STUCK
+     *         if SDA is still low afterwards.
+     */
+    int crumbs_bus_clear(const crumbs_bus_pins_t *pins);
+
+    /**
+     * @brief Bus guard wrapped around another transport.
+     *
+     * Set the thresholds after init; the counters are read-only.
+     */
+    typedef struct
+    {
+        crumbs_transport_t transport;    /**< What the context uses; caps mirror inner. */
+        const crumbs_transport_t *inner; /**< Wrapped transport. */
+        void *inner_io;                  /**< Its io. */
+        crumbs_clock_us_fn clock;        /**< Microsecond clock; NULL disables stall_us, holdoff_us and timings. */
+        crumbs_bus_recover_fn recover;   /**< Platform hook (NULL = detect and count only). */
+        void *recover_io;                /**< Passed to recover. */
+
+        uint8_t fail_limit;              /**< Consecutive failures that trip (0 = never on count). */
+        uint8_t paused;                  /**< Non-zero: failures are not counted (e.g. during a scan). */
+        uint32_t stall_us;               /**< A failure at least this slow trips at once (0 = off). */
+        uint32_t holdoff_us;             /**< Minimum time between recoveries. */
+
+        crumbs_registry_t *registry;     /**< Re-validated after recovery, or NULL. */
+        const crumbs_context_t *registry_ctx; /**< Controller context for the validation scan. */
+        uint8_t registry_bus;            /**< Bus index of this transport in the registry. */
+
+        uint8_t fails;                   /**< Current run of failures. */
+        uint8_t recovered;               /**< last_recover_us is valid. */
+        uint32_t streak_start_us;        /**< Start of the first failure of the run. */
+        uint32_t last_recover_us;        /**< End of the latest recovery. */
+
+        /** @name Counters
+         *  @{ */
+        uint32_t fail_trips;             /**< Trips on fail_limit. */
+        uint32_t stall_trips;            /**< Trips on stall_us. */
+        uint32_t recoveries;             /**< Recover hook calls that succeeded. */
+        uint32_t recover_errors;         /**< Recover hook calls that failed. */
+        uint32_t held_off;               /**< Trips inside holdoff_us (no recovery). */
+        uint32_t last_outage_us;         /**< First failure of the run to end of the latest recovery. */
+        uint32_t max_outage_us;          /**< Worst outage. */
+        int16_t last_validate;           /**< crumbs_registry_validate() result after the latest recovery. */
+        /** @} */
+    } crumbs_recover_t;
+
+    /**
+     * @brief Guard @p inner with the default thresholds.
+     *
+     * Set rec->transport on a context or device with @p rec as io.
+     *
+     * @return 0 on success, -1 on NULL arguments or an inner transport without send().
+     */
+    int crumbs_recover_init(crumbs_recover_t *rec,
+                            const crumbs_transport_t *inner, void *inner_io,
+                            crumbs_clock_us_fn clock,
+                            crumbs_bus_recover_fn recover, void *recover_io);
+
+    /**
+     * @brief Guard the transport currently set on @p ctx and put @p rec in its place.
+     *
+     * Devices initialized from @p ctx afterwards are guarded too.
+     *
+     * @return 0 on success, -1 on NULL arguments or if @p ctx has no transport.
+     */
+    int crumbs_recover_attach(crumbs_recover_t *rec, crumbs_context_t *ctx,
+                              crumbs_clock_us_fn clock,
+                              crumbs_bus_recover_fn recover, void *recover_io);
+
+    /**
+     * @brief Re-validate the @p bus entries of @p reg after each recovery.
+     *
+     * The scan runs on the inner transport. Pass NULL @p reg to stop.
+     */
+    void crumbs_recover_set_registry(crumbs_recover_t *rec, crumbs_registry_t *reg,
+                                     uint8_t bus, const crumbs_context_t *ctx);
+
+    /**
+     * @brief Recover now, regardless of the failure count and holdoff.
+     *
+     * @return The recover hook's result, or -1 on bad args or without a hook.
+     */
+    int crumbs_recover_now(crumbs_recover_t *rec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRUMBS_RECOVER_H */
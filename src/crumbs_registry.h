@@ -0,0 +1,162 @@
+/**
+ * @file crumbs_registry.h
+ * @brief Discovered-device registry with a compact binary form for fast restarts.
+ *
+ * A full range scan is the slowest part of controller startup. The registry
+ * remembers what the last scan found: (bus, address, type_id, version) per
+ * device. It serializes to a small CRC-protected blob that the application
+ * stores wherever it likes (a file on Linux, EEPROM on a microcontroller).
+ *
+ * On the next start, load the blob, then call crumbs_registry_validate()
+ * once per bus. That probes only the cached addresses. If every entry still
+ * answers with its cached type_id, the scan is skipped. Otherwise run the
+ * full scan and record the result with crumbs_registry_update_bus().
+ *
+ * @code
+ * static crumbs_registry_t reg;
+ * uint8_t blob[CRUMBS_REGISTRY_BLOB_MAX];
+ * size_t n = read_blob_from_storage(blob, sizeof(blob));
+ *
+ * if (crumbs_registry_load(&reg, blob, n) != 0 ||
+ *     crumbs_registry_validate(&reg, 0, &ctx, 0, write_fn, read_fn, io, 10000) != 0)
+ * {
+ *     int found_n = crumbs_controller_scan_for_crumbs_with_types(...);
+ *     crumbs_registry_update_bus(&reg, 0, addrs, types, (size_t)found_n);
+ *     write_blob_to_storage(blob, crumbs_registry_save(&reg, blob, sizeof(blob)));
+ * }
+ * @endcode
+ *
+ * Blob layout (little-endian):
+ *   [magic 'C' 'R' 'G'][format = 1][count]
+ *   count x [bus][addr][type_id][major][minor][patch][crumbs_version: u16]
+ *   [crc8 over everything before it]
+ */
+
+#ifndef CRUMBS_REGISTRY_H
+#define CRUMBS_REGISTRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /** @brief Maximum devices tracked by one registry. */
+#ifndef CRUMBS_REGISTRY_MAX
+#define CRUMBS_REGISTRY_MAX 32
+#endif
+
+    /** @brief Serialized bytes per entry. */
+#define CRUMBS_REGISTRY_ENTRY_SIZE 8u
+
+    /** @brief Largest blob crumbs_registry_save() can produce. */
+#define CRUMBS_REGISTRY_BLOB_MAX (5u + CRUMBS_REGISTRY_MAX * CRUMBS_REGISTRY_ENTRY_SIZE + 1u)
+
+    /**
+     * @brief One discovered device.
+     *
+     * The version fields follow the opcode-0x00 convention
+     * (crumbs_build_version_reply()); leave them 0 when unknown.
+     */
+    typedef struct
+    {
+        uint8_t bus;             /**< Application-defined bus index. */
+        uint8_t addr;            /**< 7-bit I2C address. */
+        uint8_t type_id;         /**< Peripheral type_id seen during discovery. */
+        uint8_t mod_major;       /**< Module major version. */
+        uint8_t mod_minor;       /**< Module minor version. */
+        uint8_t mod_patch;       /**< Module patch version. */
+        uint16_t crumbs_version; /**< CRUMBS_VERSION the peripheral was built with. */
+    } crumbs_registry_entry_t;
+
+    /**
+     * @brief Device registry.
+     */
+    typedef struct
+    {
+        crumbs_registry_entry_t entries[CRUMBS_REGISTRY_MAX]; /**< Known devices. */
+        uint8_t count;                                        /**< Entries in use. */
+    } crumbs_registry_t;
+
+    /**
+     * @brief Empty a registry.
+     */
+    void crumbs_registry_init(crumbs_registry_t *reg);
+
+    /**
+     * @brief Insert or replace the entry for (entry->bus, entry->addr).
+     *
+     * @return 0 on success, -1 on bad args or if the registry is full.
+     */
+    int crumbs_registry_put(crumbs_registry_t *reg, const crumbs_registry_entry_t *entry);
+
+    /**
+     * @brief Look up a device.
+     *
+     * @return The entry, or NULL if (bus, addr) is unknown.
+     */
+    const crumbs_registry_entry_t *crumbs_registry_find(const crumbs_registry_t *reg,
+                                                        uint8_t bus,
+                                                        uint8_t addr);
+
+    /**
+     * @brief Replace a bus's entries with the result of a full scan.
+     *
+     * Entries on @p bus that are not in @p addrs are dropped. Devices whose
+     * type_id is unchanged keep their version fields; new or changed ones
+     * get zeroed versions for the caller to fill in.
+     *
+     * @param types Type IDs parallel to @p addrs (must not be NULL).
+     * @return Number of entries recorded, or -1 on bad args or overflow.
+     */
+    int crumbs_registry_update_bus(crumbs_registry_t *reg,
+                                   uint8_t bus,
+                                   const uint8_t *addrs,
+                                   const uint8_t *types,
+                                   size_t count);
+
+    /**
+     * @brief Re-probe the cached devices of one bus.
+     *
+     * Probes only the cached addresses, with one call to
+     * crumbs_controller_scan_for_crumbs_candidates(). Entries that no longer
+     * answer, or that answer with a different type_id, are removed.
+     *
+     * @return Number of stale entries removed (0 = cache confirmed), -2 if
+     *         the registry has no entries for @p bus, or a negative scan
+     *         error.
+     */
+    int crumbs_registry_validate(crumbs_registry_t *reg,
+                                 uint8_t bus,
+                                 const crumbs_context_t *ctx,
+                                 int strict,
+                                 crumbs_i2c_write_fn write_fn,
+                                 crumbs_i2c_read_fn read_fn,
+                                 void *io_ctx,
+                                 uint32_t timeout_us);
+
+    /**
+     * @brief Serialize the registry.
+     *
+     * @return Bytes written, or 0 if @p buf is too small (see CRUMBS_REGISTRY_BLOB_MAX).
+     */
+    size_t crumbs_registry_save(const crumbs_registry_t *reg, uint8_t *buf, size_t len);
+
+    /**
+     * @brief Replace the registry contents with a serialized blob.
+     *
+     * The registry is left empty on any error.
+     *
+     * @return 0 on success, -1 on a malformed blob, -2 on CRC mismatch.
+     */
+    int crumbs_registry_load(crumbs_registry_t *reg, const uint8_t *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRUMBS_REGISTRY_H */
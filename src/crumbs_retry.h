@@ -0,0 +1,183 @@
+/**
+ * @file crumbs_retry.h
+ * @brief Controller retry policy and per-address circuit breaker.
+ *
+ * crumbs_controller_send() and crumbs_controller_read() return the first
+ * error they see. A crumbs_retry_t wraps them with a policy:
+ *
+ * - NACK-class failures (address or data NACK, bus timeout, empty or
+ *   short read) mean the device did not answer. They are retried up to
+ *   max_attempts times with exponential backoff (backoff_us, doubling up
+ *   to backoff_max_us), with up to jitter_pct percent taken off each wait
+ *   at random so devices that failed together do not retry in lockstep.
+ * - CRC failures mean the device answered but the reply was corrupted.
+ *   They have their own budget (crc_attempts) and retry at once.
+ *
+ * Every address that fails trip_after operations in a row (each after its
+ * retries) is quarantined: its breaker opens and calls return
+ * CRUMBS_RETRY_E_OPEN without touching the bus, so a dead node no longer
+ * costs a timeout on every poll. Once per probe_interval_us one call is
+ * let through as a probe, with no retries; success closes the breaker.
+ *
+ * Healthy devices take no breaker slot; one is claimed on the first
+ * failure and freed by the next success. Breaker timing needs the clock
+ * passed to crumbs_retry_init(); without one, breakers never open.
+ *
+ * @code
+ * static crumbs_retry_t retry;
+ * crumbs_retry_init(&retry, NULL, micros_fn, 1u);   // default policy
+ * rc = crumbs_retry_send(&retry, &led_dev, &msg);
+ * rc = crumbs_retry_get(&retry, &therm_dev, THERM_OP_GET_TEMP, &reply);
+ * @endcode
+ */
+
+#ifndef CRUMBS_RETRY_H
+#define CRUMBS_RETRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /** @brief Addresses whose breakers are tracked at once. */
+#ifndef CRUMBS_RETRY_BREAKERS
+#define CRUMBS_RETRY_BREAKERS 8
+#endif
+
+    /** @brief Returned while an address is quarantined; the bus is not touched. */
+#define CRUMBS_RETRY_E_OPEN -7
+
+    /** @name Failure classes
+     *  Returned by crumbs_retry_classify().
+     *  @{ */
+#define CRUMBS_FAIL_NONE 0u /**< Success. */
+#define CRUMBS_FAIL_NACK 1u /**< No answer: NACK, timeout, empty or short read. */
+#define CRUMBS_FAIL_CRC 2u  /**< An answer arrived but failed its CRC. */
+    /** @} */
+
+    /** @name Breaker states
+     *  @{ */
+#define CRUMBS_BREAKER_CLOSED 0u /**< Calls go through. */
+#define CRUMBS_BREAKER_OPEN 1u   /**< Quarantined until the next probe. */
+#define CRUMBS_BREAKER_PROBE 2u  /**< One probe call is in flight. */
+    /** @} */
+
+    /**
+     * @brief Retry and breaker settings; crumbs_retry_policy_default() fills
+     *        the defaults given in brackets.
+     */
+    typedef struct
+    {
+        uint8_t max_attempts;       /**< Tries for NACK-class failures, first one included [3]. */
+        uint8_t crc_attempts;       /**< Tries for CRC failures, without backoff [3]. */
+        uint8_t jitter_pct;         /**< Largest share taken off a backoff wait, 0-100 [25]. */
+        uint8_t trip_after;         /**< Failed operations in a row that open the breaker, 0 = never [3]. */
+        uint32_t backoff_us;        /**< Wait before the first retry [1000]. */
+        uint32_t backoff_max_us;    /**< Longest wait [20000]. */
+        uint32_t probe_interval_us; /**< Time between probes of an open breaker [1000000]. */
+    } crumbs_retry_policy_t;
+
+    /** @brief Breaker of one address. */
+    typedef struct
+    {
+        uint32_t next_probe_us; /**< Clock reading at which an open breaker lets a probe through. */
+        uint16_t trips;         /**< Times the breaker opened (saturating). */
+        uint8_t addr;           /**< Device address. */
+        uint8_t state;          /**< CRUMBS_BREAKER_*. */
+        uint8_t failures;       /**< Failed operations in a row; 0 frees the slot. */
+    } crumbs_breaker_t;
+
+    /**
+     * @brief Policy, breakers and counters shared by the devices of a bus.
+     */
+    typedef struct
+    {
+        crumbs_retry_policy_t policy;                   /**< Copied by crumbs_retry_init(). */
+        crumbs_breaker_t breakers[CRUMBS_RETRY_BREAKERS]; /**< Failing addresses. */
+        crumbs_clock_us_fn clock;                       /**< Breaker timing, NULL = no breakers. */
+        uint32_t rng;                                   /**< Jitter generator state. */
+        uint32_t attempts;                              /**< Transfers tried. */
+        uint32_t retries;                               /**< Of those, retries. */
+        uint32_t nack_failures;                         /**< Attempts that failed with a NACK-class error. */
+        uint32_t crc_failures;                          /**< Attempts that failed their CRC. */
+        uint32_t rejected;                              /**< Calls refused by an open breaker. */
+    } crumbs_retry_t;
+
+    /** @brief Fill @p policy with the defaults. */
+    void crumbs_retry_policy_default(crumbs_retry_policy_t *policy);
+
+    /**
+     * @brief Set up @p r.
+     *
+     * @param r      State to initialize.
+     * @param policy Settings to copy, or NULL for the defaults.
+     * @param clock  Microsecond clock for breaker timing, or NULL.
+     * @param seed   Jitter seed (0 is replaced by 1).
+     */
+    void crumbs_retry_init(crumbs_retry_t *r, const crumbs_retry_policy_t *policy,
+                           crumbs_clock_us_fn clock, uint32_t seed);
+
+    /**
+     * @brief Class of a non-zero return code.
+     *
+     * @param rc     Code from a write callback / crumbs_controller_send()
+     *               (@p read == 0) or from crumbs_controller_read() (@p read != 0).
+     * @param read   Which call returned it. Write callbacks use their own
+     *               codes (Linux returns -2 for a failed write), so the
+     *               phase decides, not the value alone.
+     * @return CRUMBS_FAIL_*.
+     */
+    uint8_t crumbs_retry_classify(int rc, int read);
+
+    /**
+     * @brief crumbs_controller_send() to @p dev under the policy.
+     *
+     * @return 0 on success, -1 on bad args, CRUMBS_RETRY_E_OPEN if the
+     *         address is quarantined, else the last send error.
+     */
+    int crumbs_retry_send(crumbs_retry_t *r, const crumbs_device_t *dev, const crumbs_message_t *msg);
+
+    /**
+     * @brief SET_REPLY(@p opcode), wait, read under the policy.
+     *
+     * The wait is crumbs_device_query_delay() and the outcome is reported
+     * to dev->latency. A reply for another opcode counts as a NACK-class
+     * failure. Each retry starts over with SET_REPLY.
+     *
+     * @return 0 on success, -1 on bad args, CRUMBS_RETRY_E_OPEN if the
+     *         address is quarantined, else the last send or read error.
+     */
+    int crumbs_retry_get(crumbs_retry_t *r, const crumbs_device_t *dev, uint8_t opcode,
+                         crumbs_message_t *out);
+
+    /**
+     * @brief Whether a call to @p addr may go on the bus now.
+     *
+     * For code that runs its own transfers (the request engine, custom
+     * ops). An open breaker whose probe is due moves to
+     * CRUMBS_BREAKER_PROBE and returns 1 once; report the result with
+     * crumbs_breaker_report().
+     *
+     * @return 1 to go ahead, 0 while quarantined.
+     */
+    int crumbs_breaker_allow(crumbs_retry_t *r, uint8_t addr);
+
+    /** @brief Record the outcome of an operation on @p addr (after its retries). */
+    void crumbs_breaker_report(crumbs_retry_t *r, uint8_t addr, int ok);
+
+    /** @brief CRUMBS_BREAKER_* of @p addr (CLOSED if untracked). */
+    uint8_t crumbs_breaker_state(const crumbs_retry_t *r, uint8_t addr);
+
+    /** @brief Close and free the breaker of @p addr, e.g. after a hot-plug. */
+    void crumbs_breaker_reset(crumbs_retry_t *r, uint8_t addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRUMBS_RETRY_H */
@@ -0,0 +1,87 @@
+/**
+ * @file crumbs_rp2040.h
+ * @brief RP2040 (pico-sdk) peripheral on the hardware I2C block with DMA.
+ *
+ * A DMA channel stays armed on the I2C receive FIFO and fills one of two
+ * frame buffers. At STOP, or at the read request of a combined
+ * SET_REPLY + read, the other buffer is armed and the finished frame goes
+ * to crumbs_peripheral_handle_receive() once. A read request encodes the
+ * reply (a copy of the pre-built frame with CRUMBS_ENABLE_REPLY_CACHE)
+ * and a second channel streams it into the transmit FIFO. The interrupt
+ * fires on STOP, read request and transmit abort only, never per byte,
+ * so the peripheral keeps up with a 1 MHz Fm+ controller.
+ *
+ * @code
+ * static crumbs_context_t ctx;
+ * static crumbs_rp2040_peripheral_t periph;
+ *
+ * crumbs_rp2040_init_peripheral(&periph, &ctx, i2c0, 0x08, 4, 5, 1000000u);
+ * crumbs_register_handler(&ctx, MY_OP_SET_LED, on_set_led, NULL);
+ * for (;;)
+ *     crumbs_peripheral_refresh_reply(&ctx);   // keep the reply pre-built
+ * @endcode
+ *
+ * Compiled when the target links hardware_i2c and hardware_dma
+ * (pico-sdk defines LIB_HARDWARE_I2C / LIB_HARDWARE_DMA), without ARDUINO.
+ * Handlers run in the I2C interrupt, as with the Wire HAL.
+ */
+
+#ifndef CRUMBS_RP2040_H
+#define CRUMBS_RP2040_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+
+#if defined(LIB_HARDWARE_I2C) && defined(LIB_HARDWARE_DMA) && !defined(ARDUINO)
+
+#include "hardware/i2c.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief One I2C block serving one context.
+     */
+    typedef struct
+    {
+        uint8_t rx[2][CRUMBS_MESSAGE_MAX_SIZE]; /**< Ping-pong receive buffers. */
+        uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE]; /**< Encoded reply. */
+        uint16_t tx[CRUMBS_MESSAGE_MAX_SIZE];   /**< Reply as IC_DATA_CMD words, zero padded. */
+        crumbs_context_t *ctx;                  /**< Served context. */
+        i2c_inst_t *i2c;                        /**< i2c0 or i2c1. */
+        int rx_chan;                            /**< DMA channel on the receive FIFO. */
+        int tx_chan;                            /**< DMA channel on the transmit FIFO. */
+        uint8_t rx_active;                      /**< Buffer rx_chan is filling. */
+        uint32_t frames;                        /**< Frames dispatched. */
+        uint32_t replies;                       /**< Replies started. */
+        uint32_t overruns;                      /**< Writes longer than a frame (tail dropped). */
+    } crumbs_rp2040_peripheral_t;
+
+    /**
+     * @brief crumbs_init() @p ctx as a peripheral at @p address and serve it on @p i2c.
+     *
+     * Sets up the I2C block in slave mode at @p baud, routes @p sda / @p scl
+     * with pull-ups, claims two DMA channels and installs the I2C interrupt
+     * handler (exclusive).
+     *
+     * @return 0 on success, -1 on bad args or if @p i2c is already served,
+     *         -2 if no DMA channel is free.
+     */
+    int crumbs_rp2040_init_peripheral(crumbs_rp2040_peripheral_t *p, crumbs_context_t *ctx,
+                                      i2c_inst_t *i2c, uint8_t address, unsigned sda, unsigned scl,
+                                      uint32_t baud);
+
+    /** @brief Disable the interrupt, release the DMA channels and leave slave mode. */
+    void crumbs_rp2040_close(crumbs_rp2040_peripheral_t *p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIB_HARDWARE_I2C && LIB_HARDWARE_DMA && !ARDUINO */
+
+#endif /* CRUMBS_RP2040_H */
@@ -0,0 +1,234 @@
+/**
+ * @file crumbs_sched.h
+ * @brief Periodic telemetry scheduler on top of the request engine.
+ *
+ * Register (device, opcode, period, deadline, callback) tasks once, then
+ * call crumbs_sched_poll() from the main loop instead of hand-writing
+ * "every N ms send a GET" logic. The scheduler releases each task once
+ * per period into a crumbs_engine_t, in rate-monotonic order: when
+ * several tasks are due together, the one with the shorter period is
+ * queued first.
+ *
+ * Admission control keeps the bus schedulable. Each task costs an
+ * estimated bus time per run (SET_REPLY write plus a reply read of
+ * 4 + reply_len bytes at CRUMBS_SCHED_BUS_HZ). A task is refused if the
+ * total utilization would exceed CRUMBS_SCHED_MAX_UTIL_PCT, which leaves
+ * the rest of the bus for ad-hoc commands submitted to the same engine.
+ *
+ * Per task it records runs, deadline misses, errors, release jitter (how
+ * late the GET was queued) and response latency.
+ *
+ * Attention tasks (crumbs_sched_add_on_attention()) have no period: they
+ * run once per crumbs_sched_attention() for their device, at most once
+ * per min_interval_us, which is also what admission charges them for.
+ * Devices that raise the attention line then cost no bus time while idle.
+ *
+ * @code
+ * static crumbs_engine_t eng;
+ * static crumbs_sched_t sched;
+ *
+ * crumbs_engine_init(&eng);
+ * crumbs_sched_init(&sched, &eng);
+ * for (i = 0; i < 20; i++)
+ *     crumbs_sched_add(&sched, &servo[i], SERVO_OP_GET_POS, 4, 20000, 0, on_pos, &state[i]);
+ * crumbs_sched_add(&sched, &led, LED_OP_GET_STATE, 1, 500000, 0, on_led, NULL);
+ *
+ * for (;;)
+ *     crumbs_sched_poll(&sched, micros());
+ * @endcode
+ */
+
+#ifndef CRUMBS_SCHED_H
+#define CRUMBS_SCHED_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crumbs_engine.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /** @brief Maximum periodic tasks per scheduler. */
+#ifndef CRUMBS_SCHED_MAX_TASKS
+#define CRUMBS_SCHED_MAX_TASKS 24
+#endif
+
+    /** @brief Utilization cap for admission, in percent of bus time. */
+#ifndef CRUMBS_SCHED_MAX_UTIL_PCT
+#define CRUMBS_SCHED_MAX_UTIL_PCT 60u
+#endif
+
+    /** @brief Bus clock assumed by the per-task cost estimate. */
+#ifndef CRUMBS_SCHED_BUS_HZ
+#define CRUMBS_SCHED_BUS_HZ 100000u
+#endif
+
+    /** @brief crumbs_sched_attention() address matching every attention task. */
+#define CRUMBS_SCHED_ANY_ADDR 0xFFu
+
+    struct crumbs_sched_s;
+    struct crumbs_sched_task_s;
+
+    /**
+     * @brief Called when a task's GET completes.
+     *
+     * @param task   The task (statistics already updated).
+     * @param status 0 on success (reply valid), otherwise the engine status.
+     * @param reply  Decoded reply.
+     */
+    typedef void (*crumbs_sched_cb)(struct crumbs_sched_task_s *task, int status,
+                                    const crumbs_message_t *reply);
+
+    /**
+     * @brief One periodic GET and its statistics.
+     *
+     * The embedded request (req) is initialized by crumbs_sched_add(); its
+     * delay_us may be changed afterwards. Everything else is managed by
+     * the scheduler.
+     */
+    typedef struct crumbs_sched_task_s
+    {
+        struct crumbs_sched_s *sched; /**< Owning scheduler. */
+        crumbs_sched_cb on_reply;     /**< Completion callback (may be NULL). */
+        void *user_data;              /**< Opaque pointer for the callback. */
+        uint32_t period_us;           /**< Release period (minimum interval for attention tasks). */
+        uint32_t deadline_us;         /**< Relative deadline (<= period). */
+        uint32_t cost_us;             /**< Estimated bus time per run. */
+        uint32_t release_us;          /**< Release time of the current run. */
+        uint32_t next_release_us;     /**< Next release time. */
+        uint32_t runs;                /**< Completed runs. */
+        uint32_t misses;              /**< Late completions plus overrun (skipped) releases. */
+        uint32_t errors;              /**< Runs that completed with a non-zero status. */
+        uint32_t last_latency_us;     /**< Release-to-completion time of the last run. */
+        uint32_t max_latency_us;      /**< Worst release-to-completion time. */
+        uint32_t max_jitter_us;       /**< Worst release-to-queue delay. */
+        uint32_t attention_us;        /**< Time of the pending attention. */
+        uint8_t started;              /**< First release done. */
+        uint8_t in_flight;            /**< Current run not finished yet. */
+        uint8_t on_attention;         /**< Released by crumbs_sched_attention(), not by time. */
+        uint8_t attention;            /**< Attention seen, run not released yet. */
+        crumbs_request_t req;         /**< Engine request reused for every run. */
+    } crumbs_sched_task_t;
+
+    /**
+     * @brief Scheduler state.
+     */
+    typedef struct crumbs_sched_s
+    {
+        crumbs_engine_t *eng;                               /**< Engine the GETs go to. */
+        crumbs_sched_task_t tasks[CRUMBS_SCHED_MAX_TASKS];  /**< Tasks in add order. */
+        uint8_t order[CRUMBS_SCHED_MAX_TASKS];              /**< Task indices by period (rate-monotonic). */
+        uint8_t count;                                      /**< Tasks in use. */
+        uint32_t util_pm;                                   /**< Admitted utilization, per mille. */
+        uint32_t now_us;                                    /**< Time of the current poll. */
+    } crumbs_sched_t;
+
+    /**
+     * @brief Initialize an empty scheduler feeding @p eng.
+     */
+    void crumbs_sched_init(crumbs_sched_t *sched, crumbs_engine_t *eng);
+
+    /**
+     * @brief Register a periodic GET.
+     *
+     * @param dev         Target device (write_fn and read_fn required).
+     * @param opcode      Opcode requested with SET_REPLY.
+     * @param reply_len   Largest expected payload (sizes the read and the cost).
+     * @param period_us   Release period (> 0).
+     * @param deadline_us Completion deadline after release; 0 = period_us.
+     * @param on_reply    Completion callback (may be NULL).
+     * @param user_data   Stored in task->user_data.
+     * @return Task index (>= 0), -1 on bad args or a full table, -2 if the
+     *         task would push utilization past CRUMBS_SCHED_MAX_UTIL_PCT.
+     *         The first release is at the next poll.
+     */
+    int crumbs_sched_add(crumbs_sched_t *sched,
+                         const crumbs_device_t *dev,
+                         uint8_t opcode,
+                         uint8_t reply_len,
+                         uint32_t period_us,
+                         uint32_t deadline_us,
+                         crumbs_sched_cb on_reply,
+                         void *user_data);
+
+    /**
+     * @brief Register a GET that runs when its device raises attention.
+     *
+     * Same arguments as crumbs_sched_add(), with @p min_interval_us in
+     * place of the period: it spaces releases and is used for admission.
+     * No run happens until crumbs_sched_attention().
+     *
+     * @return Task index (>= 0), -1 on bad args or a full table, -2 if the
+     *         task would push utilization past CRUMBS_SCHED_MAX_UTIL_PCT.
+     */
+    int crumbs_sched_add_on_attention(crumbs_sched_t *sched,
+                                      const crumbs_device_t *dev,
+                                      uint8_t opcode,
+                                      uint8_t reply_len,
+                                      uint32_t min_interval_us,
+                                      uint32_t deadline_us,
+                                      crumbs_sched_cb on_reply,
+                                      void *user_data);
+
+    /**
+     * @brief Note that @p addr raised the attention line.
+     *
+     * Marks the attention tasks of that device; each one is released at
+     * the next poll at least min_interval_us after its previous release.
+     * Attentions arriving before then are merged into one run. Latency and
+     * misses are measured from @p now_us.
+     *
+     * @param addr Device address from crumbs_controller_alert_response(),
+     *        or CRUMBS_SCHED_ANY_ADDR when the sender is unknown.
+     * @return Tasks marked, or -1 on bad args.
+     */
+    int crumbs_sched_attention(crumbs_sched_t *sched, uint8_t addr, uint32_t now_us);
+
+    /**
+     * @brief The attention line is asserted: find who raised it.
+     *
+     * Reads CRUMBS_ALERT_RESPONSE_ADDR until nobody answers (at most
+     * CRUMBS_SCHED_MAX_TASKS times) and calls crumbs_sched_attention() for
+     * each address. If the first read gets no answer the senders cannot
+     * respond to it, so every attention task is marked instead; their
+     * replies release the line.
+     *
+     * @return Devices that answered (0 = unknown sender), or -1 on bad args.
+     */
+    int crumbs_sched_service_alert(crumbs_sched_t *sched, crumbs_i2c_read_fn read_fn, void *io,
+                                   uint32_t now_us);
+
+    /**
+     * @brief Release due tasks, then poll the engine.
+     *
+     * Use this instead of crumbs_engine_poll() for the scheduler's engine:
+     * completion times (and therefore misses) are taken from @p now_us.
+     * Ad-hoc requests may be submitted to the same engine at any time.
+     *
+     * @return crumbs_engine_poll() result (requests still queued), or -1.
+     */
+    int crumbs_sched_poll(crumbs_sched_t *sched, uint32_t now_us);
+
+    /**
+     * @brief Microseconds until the next release or engine step.
+     */
+    uint32_t crumbs_sched_idle_us(const crumbs_sched_t *sched, uint32_t now_us);
+
+    /**
+     * @brief Admitted utilization in percent (rounded up).
+     */
+    uint32_t crumbs_sched_utilization_pct(const crumbs_sched_t *sched);
+
+    /**
+     * @brief Clear the statistics of every task.
+     */
+    void crumbs_sched_reset_stats(crumbs_sched_t *sched);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRUMBS_SCHED_H */
@@ -0,0 +1,156 @@
+/**
+ * @file crumbs_seq.h
+ * @brief Sequence-numbered commands that a peripheral applies at most once.
+ *
+ * A plain command frame has no identity, so a controller that retries a
+ * write it believes failed may apply it twice (a second SWEEP, a second
+ * ADD). A SEQUENCED frame carries a sequence byte per device session:
+ *
+ *     [type_id][0xF2][2+n][seq][opcode][data × n][crc8]
+ *
+ * A peripheral built with CRUMBS_ENABLE_SEQUENCED applies the inner
+ * command only if seq is the one after the last it applied. A repeat of
+ * an applied sequence is dropped as a duplicate. A command after a missed
+ * one is dropped too (go-back-N), so commands are never applied out of
+ * order. seq runs 1..255 and then wraps to 1. seq 0 with no opcode starts
+ * a session. Until one is started the peripheral drops every sequenced
+ * command, so it can tell a controller that it rebooted.
+ *
+ * The controller side (crumbs_seq_session_t, always built) keeps the
+ * unconfirmed commands in a window. Commands are written back to back
+ * without waiting for any reply, and a failed write is retried with the
+ * same sequence. crumbs_seq_reconcile() then reads the status once,
+ * confirms what was applied and resends the rest.
+ *
+ * Status reply (GET CRUMBS_CMD_SEQUENCED):
+ *   [active][last][applied:u16][duplicates:u16][rejected:u16]
+ *
+ * @code
+ * crumbs_seq_session_t s;
+ * crumbs_seq_begin(&s, &servo);
+ * for (i = 0; i < 8; i++)
+ *     crumbs_seq_send(&s, &sweep[i]);        // no round trip per command
+ * while (crumbs_seq_reconcile(&s) > 0)        // resent something: check again
+ *     ;
+ * @endcode
+ */
+
+#ifndef CRUMBS_SEQ_H
+#define CRUMBS_SEQ_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /** @brief Largest inner payload (the sequence and the opcode take two bytes). */
+#define CRUMBS_SEQ_MAX_PAYLOAD (CRUMBS_MAX_PAYLOAD - 2u)
+
+    /** @brief Unconfirmed commands a controller session keeps for resending (1-127). */
+#ifndef CRUMBS_SEQ_WINDOW
+#define CRUMBS_SEQ_WINDOW 8
+#endif
+#if CRUMBS_SEQ_WINDOW < 1 || CRUMBS_SEQ_WINDOW > 127
+#error "CRUMBS_SEQ_WINDOW must be between 1 and 127"
+#endif
+
+    /** @brief Default extra write attempts per command after a failed write. */
+#ifndef CRUMBS_SEQ_RETRIES
+#define CRUMBS_SEQ_RETRIES 2u
+#endif
+
+    /** @brief Session status, from the peripheral context or its status reply. */
+    typedef struct
+    {
+        uint8_t active;      /**< A session was started. */
+        uint8_t last;        /**< Last applied sequence (0 = none since the start). */
+        uint16_t applied;    /**< Commands applied this session. */
+        uint16_t duplicates; /**< Repeats dropped. */
+        uint16_t rejected;   /**< Commands dropped after a missed one, or outside a session. */
+    } crumbs_seq_status_t;
+
+    /* ---- Peripheral side ------------------------------------------------ */
+
+    /**
+     * @brief Last applied sequence of the current session.
+     *
+     * @return 0-255, or -1 without a session, for NULL or when compiled out.
+     */
+    int crumbs_seq_last_applied(const crumbs_context_t *ctx);
+
+    /**
+     * @brief Copy the session counters.
+     *
+     * @return 0 on success, -1 on NULL arguments or when compiled out.
+     */
+    int crumbs_seq_get_status(const crumbs_context_t *ctx, crumbs_seq_status_t *out);
+
+    /* ---- Controller side ------------------------------------------------ */
+
+    /**
+     * @brief One controller's session with one device.
+     *
+     * Fill with crumbs_seq_begin(); retries may be changed afterwards.
+     */
+    typedef struct
+    {
+        const crumbs_device_t *dev;                 /**< Target device. */
+        crumbs_message_t window[CRUMBS_SEQ_WINDOW]; /**< Unconfirmed commands, oldest at first. */
+        uint8_t first;                              /**< Ring index of the oldest. */
+        uint8_t pending;                            /**< Unconfirmed commands. */
+        uint8_t acked;                              /**< Last sequence the peripheral confirmed. */
+        uint8_t last;                               /**< Last sequence sent. */
+        uint8_t retries;                            /**< Extra write attempts (CRUMBS_SEQ_RETRIES). */
+        uint32_t written;                           /**< Frames written, retries included. */
+        uint32_t resent;                            /**< Commands resent by crumbs_seq_reconcile(). */
+    } crumbs_seq_session_t;
+
+    /**
+     * @brief Start a session on @p dev (writes seq 0, with retries).
+     *
+     * The peripheral forgets its previous session and counters.
+     *
+     * @return 0 on success, -1 on bad args, else the write error.
+     */
+    int crumbs_seq_begin(crumbs_seq_session_t *s, const crumbs_device_t *dev);
+
+    /**
+     * @brief Send @p msg with the next sequence, without waiting for a reply.
+     *
+     * The command is kept until a reconcile confirms it, and stays kept
+     * even if every write attempt failed.
+     *
+     * @return 0 on success, -1 on bad args or a payload above
+     *         CRUMBS_SEQ_MAX_PAYLOAD, -2 if the window is full (reconcile
+     *         first), else the write error of the last attempt.
+     */
+    int crumbs_seq_send(crumbs_seq_session_t *s, const crumbs_message_t *msg);
+
+    /**
+     * @brief Read a device's session status (needs read_fn and delay_fn).
+     *
+     * @return 0 on success, -1 on bad args or a malformed reply, else the
+     *         send/read error.
+     */
+    int crumbs_controller_get_seq_status(const crumbs_device_t *dev, crumbs_seq_status_t *out);
+
+    /**
+     * @brief Confirm applied commands with one status read and resend the rest.
+     *
+     * @return Commands resent (0 = everything was applied), -4 if the
+     *         peripheral lost the session (rebooted, or another session
+     *         began; call crumbs_seq_begin() again), else the read or
+     *         resend error.
+     */
+    int crumbs_seq_reconcile(crumbs_seq_session_t *s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRUMBS_SEQ_H */
@@ -0,0 +1,222 @@
+/**
+ * @file crumbs_serial.h
+ * @brief CRUMBS frames over UART / RS-485: COBS packets with an address byte.
+ *
+ * Each packet is one CRUMBS frame behind a 1-byte address, COBS-encoded
+ * and terminated by 0x00, so a receiver resynchronizes at the next zero
+ * after noise or a partial packet:
+ *
+ *     COBS( [addr][type_id][opcode][data_len][data...][crc8] ) 0x00
+ *
+ * | addr byte          | body        | meaning                           |
+ * | ------------------ | ----------- | --------------------------------- |
+ * | 0x01-0x7F          | frame       | controller write to that device   |
+ * | 0x00               | frame       | broadcast write (general_call)    |
+ * | 0x80 \| addr       | empty       | read request (the I2C read phase) |
+ * | 0x80 \| addr       | frame       | reply from that device            |
+ *
+ * A serial link has no bus master clocking the reply out, so the
+ * controller's read is a request packet answered by the addressed device;
+ * the frame bytes, CRC and handler dispatch are exactly those of I2C. On a
+ * multidrop RS-485 segment every device sees every packet and ignores the
+ * ones not addressed to it.
+ *
+ * Bytes enter a crumbs_serial_port_t in one of two ways:
+ * - from an ISR or DMA half/full-transfer callback through
+ *   crumbs_serial_rx_push() (single producer, lock-free ring), or
+ * - from the port's read() primitive (termios, Arduino Stream), pulled
+ *   whenever the port needs more input.
+ *
+ * @code
+ * static crumbs_serial_port_t port;
+ * crumbs_serial_init(&port, uart_write, NULL, NULL);
+ * port.clock = micros32;                    // needed for timeouts in ISR mode
+ * crumbs_set_transport(&ctx, &crumbs_serial_transport, &port);
+ *
+ * void USART1_IRQHandler(void) { uint8_t b = USART1->DR; crumbs_serial_rx_push(&port, &b, 1); }
+ * @endcode
+ */
+
+#ifndef CRUMBS_SERIAL_H
+#define CRUMBS_SERIAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_transport.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /** @brief Receive ring size in bytes; must be a power of two. */
+#ifndef CRUMBS_SERIAL_RX_RING
+#define CRUMBS_SERIAL_RX_RING 128u
+#endif
+
+    /** @brief Default reply timeout (longest silence while waiting), in microseconds. */
+#ifndef CRUMBS_SERIAL_TIMEOUT_US
+#define CRUMBS_SERIAL_TIMEOUT_US 20000u
+#endif
+
+#if (CRUMBS_SERIAL_RX_RING < 64u) || (CRUMBS_SERIAL_RX_RING > 32768u) || \
+    ((CRUMBS_SERIAL_RX_RING & (CRUMBS_SERIAL_RX_RING - 1u)) != 0u)
+#error "CRUMBS_SERIAL_RX_RING must be a power of two between 64 and 32768"
+#endif
+
+    /** @brief Address-byte flag for read requests and replies. */
+#define CRUMBS_SERIAL_REPLY_FLAG 0x80u
+
+    /** @brief Largest packet before COBS: address byte + one frame. */
+#define CRUMBS_SERIAL_PACKET_MAX (1u + CRUMBS_MESSAGE_MAX_SIZE)
+
+    /** @brief Largest COBS-encoded packet, delimiter excluded. */
+#define CRUMBS_SERIAL_ENCODED_MAX (CRUMBS_SERIAL_PACKET_MAX + 1u)
+
+    /**
+     * @brief Write raw bytes to the UART. Blocks until they are queued.
+     *
+     * On half-duplex RS-485 the primitive also drives the driver-enable
+     * line and returns once the last byte has left the shift register.
+     *
+     * @return 0 on success, negative on error.
+     */
+    typedef int (*crumbs_serial_write_fn)(void *user, const uint8_t *data, size_t len);
+
+    /**
+     * @brief Read up to @p len raw bytes, waiting at most @p timeout_us for the first.
+     *
+     * @return Bytes read, 0 on timeout, negative on error.
+     */
+    typedef int (*crumbs_serial_read_fn)(void *user, uint8_t *buf, size_t len, uint32_t timeout_us);
+
+    /**
+     * @brief One UART endpoint (controller or device side).
+     *
+     * Initialize with crumbs_serial_init(). A port is the io of
+     * crumbs_serial_transport.
+     */
+    typedef struct crumbs_serial_port_s
+    {
+        crumbs_serial_write_fn write; /**< Required. */
+        crumbs_serial_read_fn read;   /**< NULL when an ISR/DMA feeds crumbs_serial_rx_push(). */
+        crumbs_clock_us_fn clock;     /**< Timeout source in ISR mode, or NULL (no waiting). */
+        void *user;                   /**< Passed to write() and read(). */
+        uint32_t timeout_us;          /**< Reply timeout (CRUMBS_SERIAL_TIMEOUT_US). */
+        uint8_t general_call;         /**< Device side: accept address 0x00 writes. */
+
+        /** @name Receive Ring
+         *  rx_head is only written by the producer, rx_tail by the consumer.
+         *  @{ */
+        volatile uint16_t rx_head;                /**< Next slot to fill. */
+        volatile uint16_t rx_tail;                /**< Next byte to decode. */
+        uint8_t rx_ring[CRUMBS_SERIAL_RX_RING];   /**< Raw bytes, delimiters included. */
+                                                  /** @} */
+
+        uint8_t pkt[CRUMBS_SERIAL_ENCODED_MAX];   /**< Encoded bytes since the last delimiter. */
+        uint8_t pkt_len;                          /**< Bytes in pkt. */
+        uint8_t pkt_overflow;                     /**< Current packet too long; skip to delimiter. */
+
+        uint32_t rx_packets; /**< Packets decoded. */
+        uint32_t rx_errors;  /**< Packets dropped: bad COBS, too long or empty. */
+        uint32_t rx_overruns;/**< Bytes lost because the ring was full. */
+    } crumbs_serial_port_t;
+
+    /**
+     * @brief COBS-encode @p len bytes (no trailing delimiter).
+     *
+     * @return Encoded length, or 0 if @p out_cap is too small.
+     */
+    size_t crumbs_cobs_encode(const uint8_t *in, size_t len, uint8_t *out, size_t out_cap);
+
+    /**
+     * @brief Decode one COBS block (delimiter excluded).
+     *
+     * @return Decoded length, or -1 on malformed input or @p out_cap too small.
+     */
+    int crumbs_cobs_decode(const uint8_t *in, size_t len, uint8_t *out, size_t out_cap);
+
+    /**
+     * @brief Reset @p port and set its primitives.
+     *
+     * clock is NULL, timeout_us is CRUMBS_SERIAL_TIMEOUT_US and general_call is off.
+     */
+    void crumbs_serial_init(crumbs_serial_port_t *port,
+                            crumbs_serial_write_fn write,
+                            crumbs_serial_read_fn read,
+                            void *user);
+
+    /**
+     * @brief Queue received bytes. Safe from one ISR or DMA callback.
+     *
+     * @return Bytes stored; the rest are counted in rx_overruns.
+     */
+    size_t crumbs_serial_rx_push(crumbs_serial_port_t *port, const uint8_t *data, size_t len);
+
+    /**
+     * @brief Encode and write one packet.
+     *
+     * @return 0 on success, -1 on bad args or a body over CRUMBS_MESSAGE_MAX_SIZE,
+     *         or the write() error.
+     */
+    int crumbs_serial_send_packet(crumbs_serial_port_t *port, uint8_t addr,
+                                  const uint8_t *body, size_t len);
+
+    /**
+     * @brief Decode the next complete packet from the ring, without waiting.
+     *
+     * @param addr     Address byte of the packet.
+     * @param body     At least CRUMBS_MESSAGE_MAX_SIZE bytes.
+     * @param body_len Body length (0 for a read request).
+     * @return 1 if a packet was decoded, 0 if none is complete yet.
+     */
+    int crumbs_serial_next_packet(crumbs_serial_port_t *port, uint8_t *addr,
+                                  uint8_t *body, size_t *body_len);
+
+    /** @brief crumbs_i2c_write_fn; @p user_ctx is the crumbs_serial_port_t. */
+    int crumbs_serial_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len);
+
+    /**
+     * @brief crumbs_i2c_read_fn: send a read request and wait for the reply.
+     *
+     * Stale replies already received are discarded first. @p timeout_us 0
+     * uses port->timeout_us.
+     *
+     * @return Bytes copied to @p buffer, -1 on timeout or error.
+     */
+    int crumbs_serial_read(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len,
+                           uint32_t timeout_us);
+
+    /**
+     * @brief crumbs_i2c_write_read_fn: write packet and read request back to back.
+     *
+     * The device handles packets in order, so a SET_REPLY write is applied
+     * before the request it precedes.
+     */
+    int crumbs_serial_write_read(void *user_ctx, uint8_t addr, const uint8_t *tx, size_t tx_len,
+                                 uint8_t *rx, size_t rx_len, uint32_t timeout_us,
+                                 int require_repeated_start);
+
+    /** @brief Serial transport for crumbs_set_transport(); io = crumbs_serial_port_t. */
+    extern const crumbs_transport_t crumbs_serial_transport;
+
+    /**
+     * @brief Device side: handle every complete packet. Call from loop().
+     *
+     * Writes for ctx->address (or 0x00 with general_call) go to
+     * crumbs_peripheral_handle_receive(); read requests for ctx->address
+     * are answered with crumbs_peripheral_build_reply(). Other packets,
+     * including other devices' replies, are ignored. Pulls from read()
+     * without waiting when the port has one.
+     *
+     * @return Packets handled for this device, or -1 on bad args.
+     */
+    int crumbs_serial_peripheral_poll(crumbs_context_t *ctx, crumbs_serial_port_t *port);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRUMBS_SERIAL_H */
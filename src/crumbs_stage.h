@@ -0,0 +1,188 @@
+/**
+ * @file crumbs_stage.h
+ * @brief Staged commands applied together by CRUMBS_CMD_COMMIT.
+ *
+ * A peripheral built with CRUMBS_ENABLE_STAGING can mark opcodes as
+ * latched. A frame for a latched opcode is not dispatched when it arrives;
+ * it is kept in the context until a COMMIT for the device's group runs
+ * every staged frame through the normal dispatch path (on_message and
+ * handlers) back to back. Sending the COMMIT as a broadcast
+ * (crumbs_controller_broadcast()) makes a whole rig act within the same
+ * few microseconds instead of spreading the effect over the write loop.
+ *
+ * COMMIT commands (SET, payload):
+ *   [group]           apply the staged frames (action 0x00)
+ *   [group][0x01]     discard them
+ * A device acts on a COMMIT when either group is 0 or both are equal. If
+ * a frame was dropped because the stage was full, an apply discards
+ * everything instead, so a device never applies half an update.
+ * COMMIT reply (GET):
+ *   [staged][overflow][group]
+ *
+ * The peripheral answers COMMIT and advertises CRUMBS_CAP_STAGING while
+ * at least one opcode is latched. The controller side (crumbs_txn_t) is
+ * always built.
+ *
+ * @code
+ * crumbs_register_handler(&ctx, SERVO_OP_SET_POS, on_set_pos, NULL);
+ * crumbs_set_latched(&ctx, SERVO_OP_SET_POS, 1);
+ * crumbs_set_commit_group(&ctx, 1);
+ * @endcode
+ */
+
+#ifndef CRUMBS_STAGE_H
+#define CRUMBS_STAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /** @name COMMIT actions
+     *  @{ */
+#define CRUMBS_COMMIT_APPLY 0x00u   /**< Run the staged frames. */
+#define CRUMBS_COMMIT_DISCARD 0x01u /**< Drop the staged frames. */
+    /** @} */
+
+    /** @brief Devices one transaction can stage to. */
+#ifndef CRUMBS_TXN_MAX_DEVICES
+#define CRUMBS_TXN_MAX_DEVICES 16
+#endif
+
+    /* ---- Peripheral side ------------------------------------------------ */
+
+    /**
+     * @brief Mark @p opcode as latched (staged until COMMIT) or immediate.
+     *
+     * Extension opcodes (0xF0-0xFE) are answered before staging and cannot
+     * be latched.
+     *
+     * @return 0 on success, -1 if ctx is NULL, the opcode is reserved or
+     *         CRUMBS_ENABLE_STAGING is off.
+     */
+    int crumbs_set_latched(crumbs_context_t *ctx, uint8_t opcode, int latched);
+
+    /**
+     * @brief Set the commit group this device answers to (0 = every COMMIT).
+     *
+     * @return 0 on success, -1 if ctx is NULL or staging is compiled out.
+     */
+    int crumbs_set_commit_group(crumbs_context_t *ctx, uint8_t group);
+
+    /**
+     * @brief Number of frames waiting for a COMMIT (0 when compiled out).
+     */
+    int crumbs_stage_pending(const crumbs_context_t *ctx);
+
+    /**
+     * @brief Apply the staged frames now, as a COMMIT would.
+     *
+     * For a local trigger such as a shared sync line.
+     *
+     * @return Frames applied, 0 if the stage had overflowed (it is
+     *         discarded), -1 if ctx is NULL or staging is compiled out.
+     */
+    int crumbs_stage_apply(crumbs_context_t *ctx);
+
+    /**
+     * @brief Drop the staged frames without applying them.
+     *
+     * @return 0 on success, -1 if ctx is NULL or staging is compiled out.
+     */
+    int crumbs_stage_discard(crumbs_context_t *ctx);
+
+    /* ---- Controller side ------------------------------------------------ */
+
+    /** @brief Parsed CRUMBS_CMD_COMMIT status reply. */
+    typedef struct
+    {
+        uint8_t staged;   /**< Frames waiting for a COMMIT. */
+        uint8_t overflow; /**< Non-zero if a frame was dropped. */
+        uint8_t group;    /**< The device's commit group. */
+    } crumbs_stage_status_t;
+
+    /**
+     * @brief Send a COMMIT with @p action to one device.
+     *
+     * @return 0 on success, -1 on bad args, else as crumbs_controller_send_frame().
+     */
+    int crumbs_controller_commit(const crumbs_device_t *dev, uint8_t group, uint8_t action);
+
+    /**
+     * @brief Read a device's staging status (needs read_fn and delay_fn).
+     *
+     * @return 0 on success, -1 on bad args or a malformed reply, else the
+     *         send/read error.
+     */
+    int crumbs_controller_get_stage_status(const crumbs_device_t *dev, crumbs_stage_status_t *out);
+
+    /**
+     * @brief A staged update across several devices, committed once.
+     *
+     * Fill with crumbs_txn_begin(); the fields are read-only after that.
+     */
+    typedef struct
+    {
+        const crumbs_device_t *devs[CRUMBS_TXN_MAX_DEVICES]; /**< Devices staged to, first use order. */
+        uint8_t staged[CRUMBS_TXN_MAX_DEVICES];              /**< Frames sent to each device. */
+        uint8_t count;                                       /**< Entries in devs[]. */
+        uint8_t group;                                       /**< Group sent with the COMMIT. */
+        int error;                                           /**< First staging error, 0 if none. */
+    } crumbs_txn_t;
+
+    /** @brief Start an empty transaction for commit group @p group. */
+    void crumbs_txn_begin(crumbs_txn_t *txn, uint8_t group);
+
+    /**
+     * @brief Send @p msg (a latched opcode) to @p dev as part of @p txn.
+     *
+     * A failure is remembered in txn->error and makes crumbs_txn_commit()
+     * abort instead.
+     *
+     * @return 0 on success, -1 on bad args or more than
+     *         CRUMBS_TXN_MAX_DEVICES devices, else the send error.
+     */
+    int crumbs_txn_stage(crumbs_txn_t *txn, const crumbs_device_t *dev, const crumbs_message_t *msg);
+
+    /**
+     * @brief Check that every device holds exactly what was staged to it.
+     *
+     * Optional; needs the read path on every device. Catches lost writes,
+     * full stages and frames left over from an earlier transaction.
+     *
+     * @return 0 if all match, -4 on a mismatch (remembered in txn->error),
+     *         else the first read error.
+     */
+    int crumbs_txn_verify(crumbs_txn_t *txn);
+
+    /**
+     * @brief Apply the transaction on every device.
+     *
+     * With @p broadcast non-zero a single COMMIT goes to the general-call
+     * address through the first device's bus (every device needs
+     * CRUMBS_ENABLE_BROADCAST and general-call reception); otherwise one
+     * COMMIT per device is written back to back. If staging failed the
+     * transaction is aborted instead and the staging error returned.
+     *
+     * @return 0 on success, -1 on bad args or an empty transaction, else
+     *         the first error.
+     */
+    int crumbs_txn_commit(crumbs_txn_t *txn, int broadcast);
+
+    /**
+     * @brief Discard the staged frames on every device of @p txn.
+     *
+     * @return 0 on success, else the first send error.
+     */
+    int crumbs_txn_abort(crumbs_txn_t *txn);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRUMBS_STAGE_H */
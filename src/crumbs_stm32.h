@@ -0,0 +1,132 @@
+/**
+ * @file crumbs_stm32.h
+ * @brief STM32Cube HAL peripheral with DMA receive and transmit.
+ *
+ * The Wire-style path takes one interrupt per byte. Here a write from
+ * the controller lands by DMA in one of two receive buffers, and the
+ * frame is dispatched once, at STOP (or at the repeated START of a
+ * combined SET_REPLY + read), with crumbs_peripheral_handle_receive().
+ * The next frame is already armed into the other buffer by then.
+ * Replies go out by DMA from an encoded frame: with
+ * CRUMBS_ENABLE_REPLY_CACHE and crumbs_peripheral_refresh_reply() in the
+ * main loop, answering a read is a copy of the pre-built frame, with no
+ * handler running in the interrupt. Per transfer that leaves the address
+ * interrupt and the STOP interrupt, which is what lets a peripheral keep
+ * up with a 1 MHz Fm+ controller.
+ *
+ * The I2C handle must be initialized by CubeMX code with both DMA
+ * channels linked (hdmarx, hdmatx) and the event/error interrupts
+ * enabled. HAL callbacks are global, so forward them:
+ *
+ * @code
+ * static crumbs_context_t ctx;
+ * static crumbs_stm32_peripheral_t periph;
+ *
+ * crumbs_stm32_init_peripheral(&periph, &ctx, &hi2c1, 0x08);
+ *
+ * void HAL_I2C_AddrCallback(I2C_HandleTypeDef *h, uint8_t dir, uint16_t code)
+ * {
+ *     (void)code;
+ *     crumbs_stm32_addr_callback(h, dir);
+ * }
+ * void HAL_I2C_ListenCpltCallback(I2C_HandleTypeDef *h) { crumbs_stm32_listen_callback(h); }
+ * void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *h) { crumbs_stm32_error_callback(h); }
+ * @endcode
+ *
+ * or build with CRUMBS_STM32_DEFINE_HAL_CALLBACKS to let this HAL define
+ * those three itself.
+ *
+ * Compiled for STM32Cube projects (USE_HAL_DRIVER without ARDUINO) with
+ * the I2C and DMA HAL modules enabled. The family HAL comes in through
+ * CRUMBS_STM32_HAL_HEADER (default "main.h", which CubeMX generates).
+ * Written against the I2C HAL of the F0/F3/F7/G0/G4/H7/L4/U5 families.
+ */
+
+#ifndef CRUMBS_STM32_H
+#define CRUMBS_STM32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+
+#if defined(USE_HAL_DRIVER) && !defined(ARDUINO)
+
+#ifndef CRUMBS_STM32_HAL_HEADER
+#define CRUMBS_STM32_HAL_HEADER "main.h"
+#endif
+#include CRUMBS_STM32_HAL_HEADER
+
+#if defined(HAL_I2C_MODULE_ENABLED) && defined(HAL_DMA_MODULE_ENABLED)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /** @brief I2C peripherals that can serve a context at once (1-4). */
+#ifndef CRUMBS_STM32_MAX_PERIPHERALS
+#define CRUMBS_STM32_MAX_PERIPHERALS 2
+#endif
+
+    /**
+     * @brief DMA buffer size: CRUMBS_MESSAGE_MAX_SIZE rounded up to a cache line.
+     *
+     * On cores with a data cache (F7, H7) the buffers are cleaned and
+     * invalidated by address, which needs whole 32-byte lines.
+     */
+#define CRUMBS_STM32_DMA_BUF 32u
+
+    /**
+     * @brief One I2C peripheral serving one context.
+     */
+    typedef struct
+    {
+        uint8_t rx[2][CRUMBS_STM32_DMA_BUF] __attribute__((aligned(32))); /**< Ping-pong receive buffers. */
+        uint8_t tx[CRUMBS_STM32_DMA_BUF] __attribute__((aligned(32)));    /**< Reply being transmitted. */
+        crumbs_context_t *ctx;       /**< Served context. */
+        I2C_HandleTypeDef *hi2c;     /**< CubeMX handle. */
+        volatile uint8_t rx_active;  /**< Buffer the DMA is filling. */
+        volatile uint8_t rx_pending; /**< A receive is armed and not yet dispatched. */
+        uint32_t frames;             /**< Frames dispatched. */
+        uint32_t replies;            /**< Replies started. */
+        uint32_t errors;             /**< Bus errors other than the controller's final NACK. */
+    } crumbs_stm32_peripheral_t;
+
+    /**
+     * @brief crumbs_init() @p ctx as a peripheral at @p address and start listening on @p hi2c.
+     *
+     * The own address in the HAL handle is set to @p address and the handle
+     * re-initialized.
+     *
+     * @return 0 on success, -1 on bad args or when every slot is taken,
+     *         -2 if the HAL refuses the configuration.
+     */
+    int crumbs_stm32_init_peripheral(crumbs_stm32_peripheral_t *p, crumbs_context_t *ctx,
+                                     I2C_HandleTypeDef *hi2c, uint8_t address);
+
+    /** @brief Stop listening and free the slot. */
+    void crumbs_stm32_close(crumbs_stm32_peripheral_t *p);
+
+    /**
+     * @brief Forward HAL_I2C_AddrCallback().
+     *
+     * @return 1 if @p hi2c serves a CRUMBS context, 0 otherwise (chain to other drivers).
+     */
+    int crumbs_stm32_addr_callback(I2C_HandleTypeDef *hi2c, uint8_t direction);
+
+    /** @brief Forward HAL_I2C_ListenCpltCallback() (STOP); same return as addr_callback. */
+    int crumbs_stm32_listen_callback(I2C_HandleTypeDef *hi2c);
+
+    /** @brief Forward HAL_I2C_ErrorCallback(); same return as addr_callback. */
+    int crumbs_stm32_error_callback(I2C_HandleTypeDef *hi2c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HAL_I2C_MODULE_ENABLED && HAL_DMA_MODULE_ENABLED */
+
+#endif /* defined(USE_HAL_DRIVER) && !defined(ARDUINO) */
+
+#endif /* CRUMBS_STM32_H */
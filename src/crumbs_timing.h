@@ -0,0 +1,165 @@
+/**
+ * @file crumbs_timing.h
+ * @brief Peripheral hot-path timing, read over the bus with CRUMBS_CMD_TIMING.
+ *
+ * A crumbs_timing_t is a trace hook (see crumbs_set_trace_hook()) that
+ * turns pairs of trace points into per-phase cycle statistics instead of
+ * storing events. Give it a cycle counter as the clock (DWT->CYCCNT on
+ * Cortex-M, a free-running timer on AVR) and it reports, for each phase,
+ * the sample count, minimum, maximum and total in counter ticks:
+ *
+ *   phase      from                       to
+ *   rx-isr     RX_START                   RX_DONE      (receive callback)
+ *   decode     RX_START                   DECODE_DONE
+ *   dispatch   DISPATCH_ENTER             DISPATCH_EXIT (lookup + handler)
+ *   reply      REQUEST_START              REPLY_BUILT
+ *   tx-isr     REQUEST_START              TX_DONE      (request callback)
+ *
+ * RX_DONE and REQUEST_START come from the HAL's I2C callbacks (the Arduino
+ * HAL reports them); without them only decode and dispatch are measured.
+ * A sample is counted under the opcode of its end point. TIMING frames
+ * themselves are never counted, so reading the results does not disturb
+ * them, and a reset can restrict counting to one opcode.
+ *
+ * The hook costs a clock read and a few stores per point, all of it made
+ * outside the bracketed code except one clock read. attach measures that
+ * cost as the shortest empty interval and reports it as @c overhead so the
+ * controller can subtract it.
+ *
+ * TIMING commands (SET, payload):
+ *   [phase]             select the phase returned by the next GET
+ *   [0xFF]              clear every phase, count all opcodes
+ *   [0xFF][opcode]      clear every phase, count only @c opcode
+ * TIMING reply (GET):
+ *   [phase][count:u32][min:u32][max:u32][total:u32][overhead:u16][clock_hz:u32]
+ *
+ * Requires CRUMBS_ENABLE_TRACE on the peripheral and replaces any other
+ * trace hook (a trace ring included). The controller side is always built.
+ *
+ * @code
+ * static crumbs_timing_t timing;
+ * crumbs_timing_attach(&ctx, &timing, dwt_cycles, F_CPU);
+ * @endcode
+ */
+
+#ifndef CRUMBS_TIMING_H
+#define CRUMBS_TIMING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /** @name Timing phases
+     *  @{ */
+#define CRUMBS_TIMING_RX_ISR 0u   /**< Receive callback, entry to exit. */
+#define CRUMBS_TIMING_DECODE 1u   /**< Receive entry to validated frame. */
+#define CRUMBS_TIMING_DISPATCH 2u /**< Handler lookup and handler. */
+#define CRUMBS_TIMING_REPLY 3u    /**< Request callback entry to encoded reply. */
+#define CRUMBS_TIMING_TX_ISR 4u   /**< Request callback, entry to bus write done. */
+#define CRUMBS_TIMING_PHASES 5u   /**< Number of phases. */
+    /** @} */
+
+#define CRUMBS_TIMING_CMD_RESET 0xFFu  /**< SET: clear all phases. */
+#define CRUMBS_TIMING_ANY 0x100u       /**< Opcode filter that counts everything. */
+#define CRUMBS_TIMING_REPLY_LEN 23u    /**< Payload bytes of a TIMING reply. */
+
+    /**
+     * @brief Statistics of one phase, in clock ticks.
+     *
+     * total saturates at 0xFFFFFFFF; clear between runs.
+     */
+    typedef struct
+    {
+        uint32_t count; /**< Samples. */
+        uint32_t min;   /**< Shortest (0 without samples). */
+        uint32_t max;   /**< Longest. */
+        uint32_t total; /**< Sum of all samples. */
+    } crumbs_timing_stat_t;
+
+    /**
+     * @brief Recorder state; allocate statically and attach to one context.
+     *
+     * Written from the trace hook only, which runs in the I2C callbacks.
+     */
+    typedef struct
+    {
+        crumbs_timing_stat_t phases[CRUMBS_TIMING_PHASES]; /**< Per-phase statistics. */
+        uint32_t rx_start;       /**< Timestamp of the open receive. */
+        uint32_t dispatch_start; /**< Timestamp of the open dispatch. */
+        uint32_t request_start;  /**< Timestamp of the open request. */
+        uint32_t clock_hz;       /**< Clock rate reported to the controller (0 = unknown). */
+        uint16_t filter;         /**< Counted opcode, or CRUMBS_TIMING_ANY. */
+        uint16_t overhead;       /**< Shortest empty interval in ticks. */
+        uint8_t open;            /**< Intervals started and not yet closed. */
+        uint8_t page;            /**< Phase returned by the next GET. */
+        uint8_t calibrating;     /**< attach is measuring overhead. */
+    } crumbs_timing_t;
+
+    /**
+     * @brief One phase as read by the controller.
+     */
+    typedef struct
+    {
+        uint8_t phase;              /**< CRUMBS_TIMING_* phase. */
+        crumbs_timing_stat_t stat;  /**< Its statistics. */
+        uint16_t overhead;          /**< Hook cost included in every sample. */
+        uint32_t clock_hz;          /**< Ticks per second (0 = unknown). */
+    } crumbs_timing_report_t;
+
+    /**
+     * @brief Clear @p timing, install it as the trace hook of @p ctx and
+     *        measure its overhead.
+     *
+     * @param clock    Cycle counter or other timestamp source (required).
+     * @param clock_hz Rate of @p clock, passed on to the controller.
+     * @return 0 on success, -1 on bad args or without CRUMBS_ENABLE_TRACE.
+     */
+    int crumbs_timing_attach(crumbs_context_t *ctx, crumbs_timing_t *timing,
+                             crumbs_clock_us_fn clock, uint32_t clock_hz);
+
+    /**
+     * @brief The recording hook itself (user_data is the recorder).
+     */
+    void crumbs_timing_record(uint8_t event, uint8_t opcode, uint8_t len,
+                              uint32_t timestamp, void *user_data);
+
+    /**
+     * @brief Clear every phase and count only @p opcode (or CRUMBS_TIMING_ANY).
+     */
+    void crumbs_timing_clear(crumbs_timing_t *timing, uint16_t opcode);
+
+    /**
+     * @brief Short name of a phase ("rx-isr", "decode", ...).
+     *
+     * @return A static string; "?" for unknown phases.
+     */
+    const char *crumbs_timing_phase_name(uint8_t phase);
+
+    /**
+     * @brief Clear a peripheral's timing and select what it counts.
+     *
+     * @param opcode Opcode to count, or CRUMBS_TIMING_ANY.
+     * @return 0 on success, -1 on bad args, else the send error.
+     */
+    int crumbs_controller_reset_timing(const crumbs_device_t *dev, uint16_t opcode);
+
+    /**
+     * @brief Read one phase of a peripheral's timing (one SET, one GET).
+     *
+     * @return 0 on success, -1 on bad args or a malformed reply, else the
+     *         send/read error.
+     */
+    int crumbs_controller_read_timing(const crumbs_device_t *dev, uint8_t phase,
+                                      crumbs_timing_report_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRUMBS_TIMING_H */
@@ -0,0 +1,158 @@
+/**
+ * @file crumbs_trace.h
+ * @brief Binary in-memory trace ring, dumped over the bus with CRUMBS_CMD_TRACE.
+ *
+ * A crumbs_trace_ring_t is a trace hook (see crumbs_set_trace_hook()) that
+ * keeps the last CRUMBS_TRACE_RING_DEPTH events in RAM instead of printing
+ * them. Each event is one 8-byte word written with a single store, so
+ * recording from the I2C interrupt costs a handful of cycles and never
+ * touches a UART:
+ *
+ *   [delta:u32][event:u8][opcode:u8][len:u8][seq:u8]   (little-endian)
+ *
+ * delta is the clock difference to the previous event (0 without a
+ * clock); seq is the low byte of the event's index and lets a decoder
+ * spot gaps in a raw memory dump.
+ *
+ * A peripheral with an attached ring answers CRUMBS_CMD_TRACE and
+ * advertises CRUMBS_CAP_TRACE. The controller starts a dump (which
+ * pauses recording), reads it out three events per GET, then resumes
+ * recording; crumbs_controller_read_trace() does all three steps.
+ *
+ * TRACE commands (SET, payload):
+ *   [0x00] or [0x00][from:u16]   pause and start a dump at the oldest
+ *                                event, or at index @c from if still held
+ *   [0x01]                       resume recording
+ *   [0x02]                       drop all events and resume
+ * TRACE reply (GET):
+ *   [index:u16] then up to 3 events; only the index means the dump is done.
+ *
+ * Requires CRUMBS_ENABLE_TRACE on the peripheral. The controller side
+ * (reading and decoding) is always built.
+ *
+ * @code
+ * static crumbs_trace_ring_t ring;
+ * crumbs_trace_ring_attach(&ctx, &ring, micros);
+ * @endcode
+ */
+
+#ifndef CRUMBS_TRACE_H
+#define CRUMBS_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /** @brief Events held by a trace ring (power of two, 2..1024). */
+#ifndef CRUMBS_TRACE_RING_DEPTH
+#define CRUMBS_TRACE_RING_DEPTH 32
+#endif
+
+#if (CRUMBS_TRACE_RING_DEPTH < 2) || (CRUMBS_TRACE_RING_DEPTH > 1024) || \
+    ((CRUMBS_TRACE_RING_DEPTH & (CRUMBS_TRACE_RING_DEPTH - 1)) != 0)
+#error "CRUMBS_TRACE_RING_DEPTH must be a power of two between 2 and 1024"
+#endif
+
+#define CRUMBS_TRACE_EVENT_SIZE 8u     /**< Bytes per packed event. */
+#define CRUMBS_TRACE_EVENTS_PER_PAGE 3 /**< Events per TRACE reply. */
+
+    /** @name TRACE command bytes
+     *  @{ */
+#define CRUMBS_TRACE_CMD_DUMP 0x00u   /**< Pause and rewind the dump cursor. */
+#define CRUMBS_TRACE_CMD_RESUME 0x01u /**< Resume recording. */
+#define CRUMBS_TRACE_CMD_CLEAR 0x02u  /**< Drop all events and resume. */
+    /** @} */
+
+    /**
+     * @brief Recorder state; allocate statically and attach to one context.
+     *
+     * Written from the trace hook only. Indices are free-running and wrap
+     * at 65536, which the depth always divides.
+     */
+    typedef struct
+    {
+        uint64_t events[CRUMBS_TRACE_RING_DEPTH]; /**< Packed events, index & (DEPTH - 1). */
+        uint32_t last_ts;                         /**< Timestamp of the newest event. */
+        volatile uint16_t head;                   /**< Index of the next event. */
+        volatile uint16_t count;                  /**< Events held (<= DEPTH). */
+        uint16_t cursor;                          /**< Next index sent by a dump. */
+        volatile uint8_t paused;                  /**< A dump is in progress. */
+    } crumbs_trace_ring_t;
+
+    /**
+     * @brief One decoded trace event.
+     */
+    typedef struct
+    {
+        uint16_t index;  /**< Position in the peripheral's event stream. */
+        uint32_t delta;  /**< Clock ticks since the previous event. */
+        uint8_t event;   /**< CRUMBS_TRACE_* point. */
+        uint8_t opcode;  /**< Opcode at that point. */
+        uint8_t len;     /**< Length at that point. */
+    } crumbs_trace_event_t;
+
+    /**
+     * @brief Clear @p ring and install it as the trace hook of @p ctx.
+     *
+     * @param clock Timestamp source (micros, a cycle counter), or NULL.
+     * @return 0 on success, -1 on bad args or without CRUMBS_ENABLE_TRACE.
+     */
+    int crumbs_trace_ring_attach(crumbs_context_t *ctx, crumbs_trace_ring_t *ring,
+                                 crumbs_clock_us_fn clock);
+
+    /**
+     * @brief The recording hook itself (user_data is the ring).
+     *
+     * Exposed so a ring can be fed from another hook that also does
+     * something else; crumbs_trace_ring_attach() is the usual entry point.
+     */
+    void crumbs_trace_ring_record(uint8_t event, uint8_t opcode, uint8_t len,
+                                  uint32_t timestamp, void *user_data);
+
+    /**
+     * @brief Copy the held events, oldest first, without going over the bus.
+     *
+     * @return Events written to @p out (<= max), or -1 on bad args.
+     */
+    int crumbs_trace_ring_snapshot(const crumbs_trace_ring_t *ring,
+                                   crumbs_trace_event_t *out, size_t max);
+
+    /**
+     * @brief Decode one 8-byte wire event.
+     *
+     * @param index Index of the event (from the reply header); only its
+     *              low byte is in the event itself.
+     */
+    void crumbs_trace_unpack(const uint8_t *raw, uint16_t index, crumbs_trace_event_t *out);
+
+    /**
+     * @brief Short name of a CRUMBS_TRACE_* point ("rx", "decode", ...).
+     *
+     * @return A static string; "?" for unknown ids.
+     */
+    const char *crumbs_trace_event_name(uint8_t event);
+
+    /**
+     * @brief Read a peripheral's trace ring over CRUMBS_CMD_TRACE.
+     *
+     * Pauses recording, reads events oldest first until the ring is
+     * drained or @p max are stored, then resumes recording. Each page costs
+     * one SET_REPLY plus one read.
+     *
+     * @return Events stored (>= 0), -1 on bad args or a malformed reply,
+     *         else the send/read error.
+     */
+    int crumbs_controller_read_trace(const crumbs_device_t *dev,
+                                     crumbs_trace_event_t *out, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRUMBS_TRACE_H */
@@ -0,0 +1,135 @@
+/**
+ * @file crumbs_transport.h
+ * @brief Transport vtable: the link a controller sends CRUMBS frames over.
+ *
+ * Framing, CRC and dispatch do not depend on I2C; only the three bus
+ * primitives do. A crumbs_transport_t names those primitives together with
+ * what the link can do, so a context or device handle can be pointed at a
+ * different link (I2C, the virtual bus, a UART or SPI bridge) without the
+ * application or the family ops headers changing.
+ *
+ * The primitive signatures are the crumbs_i2c_*_fn ones, so every existing
+ * HAL function is already a valid entry. Addresses stay 7-bit; a
+ * point-to-point link simply ignores them.
+ *
+ * @code
+ * crumbs_linux_init_controller(&ctx, &lw, "/dev/i2c-1", 10000);  // sets the transport
+ * crumbs_device_t led;
+ * crumbs_device_init(&led, &ctx, 0x08, crumbs_linux_delay_us);
+ * led_send_set_all(&led, 0x0F);
+ * @endcode
+ */
+
+#ifndef CRUMBS_TRANSPORT_H
+#define CRUMBS_TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_i2c.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /** @brief Frames carry a target address (I2C, multi-drop links). */
+#define CRUMBS_TRANSPORT_CAP_ADDRESSED 0x0001u
+    /** @brief transact() does write + read without releasing the link (repeated START). */
+#define CRUMBS_TRANSPORT_CAP_TRANSACT 0x0002u
+    /** @brief Address 0x00 reaches every device (I2C general call). */
+#define CRUMBS_TRANSPORT_CAP_BROADCAST 0x0004u
+
+    /** @brief Write one encoded frame to @p addr (crumbs_i2c_write_fn). */
+    typedef crumbs_i2c_write_fn crumbs_transport_send_fn;
+
+    /** @brief Read up to @p len bytes from @p addr (crumbs_i2c_read_fn). */
+    typedef crumbs_i2c_read_fn crumbs_transport_receive_fn;
+
+    /** @brief Write then read as one transaction (crumbs_i2c_write_read_fn). */
+    typedef crumbs_i2c_write_read_fn crumbs_transport_transact_fn;
+
+    /**
+     * @brief Link primitives and limits, normally a const object in the HAL.
+     */
+    typedef struct crumbs_transport_s
+    {
+        const char *name;                     /**< Short label for logs ("i2c", "vbus"). */
+        crumbs_transport_send_fn send;        /**< Required. */
+        crumbs_transport_receive_fn receive;  /**< Required for GET operations. */
+        crumbs_transport_transact_fn transact; /**< NULL if the link has no combined transfer. */
+        uint16_t caps;                        /**< CRUMBS_TRANSPORT_CAP_* bits. */
+        uint8_t max_frame;                    /**< Largest frame in one transfer, 0 = CRUMBS_MESSAGE_MAX_SIZE. */
+    } crumbs_transport_t;
+
+    /**
+     * @brief Set the transport used by @p ctx and devices initialized from it.
+     *
+     * @param t  Transport (must outlive @p ctx), or NULL to clear.
+     * @param io Passed as user_ctx to every primitive (Wire*, linux handle, bus).
+     * @return 0 on success, -1 if @p ctx is NULL or @p t has no send().
+     */
+    int crumbs_set_transport(crumbs_context_t *ctx, const crumbs_transport_t *t, void *io);
+
+    /**
+     * @brief Fill @p dev from the transport set on @p ctx.
+     *
+     * write_fn, read_fn and io come from the transport; latency starts NULL.
+     *
+     * @return 0 on success, -1 on NULL arguments or if @p ctx has no transport.
+     */
+    int crumbs_device_init(crumbs_device_t *dev,
+                           crumbs_context_t *ctx,
+                           uint8_t addr,
+                           crumbs_delay_fn delay_fn);
+
+    /**
+     * @brief Point @p dev at another transport without touching ctx or addr.
+     *
+     * @return 0 on success, -1 on NULL @p dev or a transport without send().
+     */
+    int crumbs_device_set_transport(crumbs_device_t *dev, const crumbs_transport_t *t, void *io);
+
+    /**
+     * @brief Largest payload one frame on @p t can carry.
+     *
+     * max_frame - 4, capped at CRUMBS_MAX_PAYLOAD (CRUMBS_MAX_PAYLOAD for NULL).
+     */
+    uint8_t crumbs_transport_max_payload(const crumbs_transport_t *t);
+
+    /**
+     * @brief Send @p msg to @p addr over the transport set on @p ctx.
+     *
+     * @return As crumbs_controller_send(); -1 without a transport or if the
+     *         frame exceeds max_frame.
+     */
+    int crumbs_transport_send(crumbs_context_t *ctx, uint8_t addr, const crumbs_message_t *msg);
+
+    /**
+     * @brief Read one reply from @p addr over the transport set on @p ctx.
+     *
+     * @return As crumbs_controller_read(); -1 without a receive primitive.
+     */
+    int crumbs_transport_read(crumbs_context_t *ctx, uint8_t addr, crumbs_message_t *out);
+
+    /**
+     * @brief Ask @p dev for @p opcode and read the reply by the best route.
+     *
+     * With CRUMBS_TRANSPORT_CAP_TRANSACT the SET_REPLY and the read are one
+     * transaction (crumbs_controller_query()). Otherwise SET_REPLY is sent,
+     * crumbs_device_query_delay() is waited and 4 + @p max_payload bytes are
+     * read, and the outcome is reported to dev->latency.
+     *
+     * @return 0 on success (reply opcode is checked), negative on error.
+     */
+    int crumbs_device_query(const crumbs_device_t *dev,
+                            uint8_t opcode,
+                            crumbs_message_t *out,
+                            uint8_t max_payload);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRUMBS_TRANSPORT_H */
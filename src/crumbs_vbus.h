@@ -0,0 +1,200 @@
+/**
+ * @file crumbs_vbus.h
+ * @brief Timing-accurate virtual I2C bus hosting simulated peripherals.
+ *
+ * A crumbs_vbus_t stands in for a real bus in host tests, benchmarks and
+ * fleet-scale experiments. Any number of CRUMBS peripheral contexts (up to
+ * CRUMBS_VBUS_MAX_DEVICES) are attached at their addresses; controller
+ * code talks to them through crumbs_vbus_write(), crumbs_vbus_read(),
+ * crumbs_vbus_write_read() and crumbs_vbus_scan(), which match the
+ * crumbs_i2c_* callback types with the bus as the io pointer.
+ *
+ * Every transfer advances a virtual clock by its wire time at the bus
+ * clock: START, 9 clocks per byte (address byte included), STOP. Reads
+ * cost the requested length even when the reply frame is shorter, as on
+ * real hardware. Each device can model its firmware:
+ *   - handler_us: after a write the device is busy for this long; a
+ *     transfer to it during that time is clock-stretched until it is done
+ *   - reply_us:   time spent building the reply at the start of a read
+ * Nothing runs in real time, so a 100-device bus simulates in
+ * microseconds of host time and every result is reproducible.
+ *
+ * Errors are injected per transfer with a seeded generator: NACKs (the
+ * transfer fails after the address byte) and single-bit corruption of the
+ * data in either direction, which the receiver sees as a CRC error. A
+ * device can also be taken offline.
+ *
+ * A write to CRUMBS_BROADCAST_ADDR is one transfer delivered to every
+ * online device with general_call set; it is ACKed if any of them is
+ * listening and stretched until the busiest of them is free.
+ *
+ * The bus also models a shared attention line: crumbs_vbus_alert() is
+ * low while any online device asserts it (CRUMBS_ENABLE_ATTENTION), and
+ * a read of CRUMBS_ALERT_RESPONSE_ADDR is answered by the lowest such
+ * address whose alert_response flag is set.
+ *
+ * crumbs_delay_fn and crumbs_clock_us_fn take no context, so
+ * crumbs_vbus_delay_us() and crumbs_vbus_clock_us() act on the bus
+ * selected with crumbs_vbus_use(). The bus is single-threaded.
+ *
+ * @code
+ * static crumbs_vbus_t bus;
+ * static crumbs_context_t periph[100];
+ * crumbs_vbus_init(&bus, 400000u);
+ * for (i = 0; i < 100; i++)
+ * {
+ *     crumbs_init(&periph[i], CRUMBS_ROLE_PERIPHERAL, 0x10 + i);
+ *     crumbs_vbus_attach(&bus, &periph[i], 50u, 20u);
+ * }
+ * crumbs_vbus_use(&bus);
+ * crumbs_vbus_bind(&bus, &dev, &controller_ctx, 0x10);
+ * // ... run controller code against dev; read crumbs_vbus_now_us(&bus)
+ * @endcode
+ */
+
+#ifndef CRUMBS_VBUS_H
+#define CRUMBS_VBUS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_transport.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /** @brief Devices per virtual bus (the 7-bit space holds 112 usable addresses). */
+#ifndef CRUMBS_VBUS_MAX_DEVICES
+#define CRUMBS_VBUS_MAX_DEVICES 112
+#endif
+
+    /**
+     * @brief One simulated peripheral and its counters.
+     */
+    typedef struct
+    {
+        crumbs_context_t *ctx;  /**< Peripheral context (its address is the bus address). */
+        uint32_t handler_us;    /**< Busy time after each write. */
+        uint32_t reply_us;      /**< Reply build time at the start of each read. */
+        uint64_t busy_until_ns; /**< End of the current busy period. */
+        uint8_t online;         /**< 0 = does not ACK. */
+        uint8_t general_call;   /**< Also receives writes to CRUMBS_BROADCAST_ADDR. */
+        uint8_t alert_response; /**< Answers CRUMBS_ALERT_RESPONSE_ADDR (default 1). */
+        uint32_t writes;        /**< Writes delivered to the context. */
+        uint32_t reads;         /**< Reads answered. */
+        uint32_t nacks;         /**< Transfers NACKed (injected or offline). */
+        uint32_t stretch_us;    /**< Total clock stretching caused by this device. */
+    } crumbs_vbus_device_t;
+
+    /**
+     * @brief Virtual bus state. Initialize with crumbs_vbus_init().
+     */
+    typedef struct
+    {
+        uint64_t now_ns;       /**< Virtual clock. */
+        uint64_t busy_ns;      /**< Time the bus carried traffic (stretching included). */
+        uint32_t bus_hz;       /**< SCL clock used for byte timing. */
+        uint32_t transfers;    /**< Transfers started (ACKed or not). */
+        uint32_t nacks;        /**< Transfers NACKed. */
+        uint32_t corrupted;    /**< Transfers with an injected bit error. */
+        uint16_t nack_rate;    /**< Injected NACK probability, per 65536 transfers. */
+        uint16_t corrupt_rate; /**< Injected corruption probability, per 65536 transfers. */
+        uint32_t rng;          /**< Error-injection generator state. */
+        uint8_t count;         /**< Devices attached. */
+        uint8_t index[128];    /**< Address -> device slot, 0xFF = none. */
+        crumbs_vbus_device_t devices[CRUMBS_VBUS_MAX_DEVICES]; /**< Attached devices. */
+    } crumbs_vbus_t;
+
+    /**
+     * @brief Empty bus at @p bus_hz (0 = 100 kHz), clock at 0, no errors.
+     */
+    void crumbs_vbus_init(crumbs_vbus_t *bus, uint32_t bus_hz);
+
+    /**
+     * @brief Attach a peripheral context at its own address.
+     *
+     * @param ctx        Initialized CRUMBS_ROLE_PERIPHERAL context.
+     * @param handler_us Busy time after each write.
+     * @param reply_us   Reply build time per read.
+     * @return The device slot, or NULL on bad args, a taken address or a full bus.
+     */
+    crumbs_vbus_device_t *crumbs_vbus_attach(crumbs_vbus_t *bus, crumbs_context_t *ctx,
+                                             uint32_t handler_us, uint32_t reply_us);
+
+    /**
+     * @brief Device at @p addr, or NULL.
+     */
+    crumbs_vbus_device_t *crumbs_vbus_device(crumbs_vbus_t *bus, uint8_t addr);
+
+    /**
+     * @brief Configure error injection.
+     *
+     * @param nack_rate    NACK probability per 65536 transfers (65535 = almost always).
+     * @param corrupt_rate Bit-error probability per 65536 transfers.
+     * @param seed         Generator seed (0 is replaced by a fixed value).
+     */
+    void crumbs_vbus_set_errors(crumbs_vbus_t *bus, uint16_t nack_rate, uint16_t corrupt_rate,
+                                uint32_t seed);
+
+    /** @brief Virtual time in microseconds (wraps like micros()). */
+    uint32_t crumbs_vbus_now_us(const crumbs_vbus_t *bus);
+
+    /** @brief Advance the virtual clock, e.g. for controller-side processing. */
+    void crumbs_vbus_advance_us(crumbs_vbus_t *bus, uint32_t us);
+
+    /** @brief Share of elapsed virtual time the bus was busy, in percent. */
+    uint32_t crumbs_vbus_utilization_pct(const crumbs_vbus_t *bus);
+
+    /** @brief crumbs_i2c_write_fn; @p user_ctx is the crumbs_vbus_t. Address 0 is a general call. */
+    int crumbs_vbus_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len);
+
+    /** @brief crumbs_i2c_read_fn; @p user_ctx is the crumbs_vbus_t. */
+    int crumbs_vbus_read(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len, uint32_t timeout_us);
+
+    /**
+     * @brief crumbs_i2c_write_read_fn: write, repeated START, read.
+     *
+     * Saves a STOP/START pair over a separate write and read. The device's
+     * handler_us is not stretched in between: the reply is built at the
+     * read as with reply_us.
+     */
+    int crumbs_vbus_write_read(void *user_ctx, uint8_t addr, const uint8_t *tx, size_t tx_len,
+                               uint8_t *rx, size_t rx_len, uint32_t timeout_us,
+                               int require_repeated_start);
+
+    /** @brief Non-zero while any online device asserts the attention line. */
+    int crumbs_vbus_alert(const crumbs_vbus_t *bus);
+
+    /** @brief crumbs_i2c_scan_fn: one address byte per probed address. */
+    int crumbs_vbus_scan(void *user_ctx, uint8_t start_addr, uint8_t end_addr, int strict,
+                         uint8_t *found, size_t max_found);
+
+    /** @brief Select the bus driven by crumbs_vbus_delay_us() and crumbs_vbus_clock_us(). */
+    void crumbs_vbus_use(crumbs_vbus_t *bus);
+
+    /** @brief crumbs_delay_fn: advance the selected bus's clock. */
+    void crumbs_vbus_delay_us(uint32_t us);
+
+    /** @brief crumbs_clock_us_fn: the selected bus's clock (0 if none). */
+    uint32_t crumbs_vbus_clock_us(void);
+
+    /** @brief Transport for crumbs_set_transport(): write, read and write_read, io = the bus. */
+    extern const crumbs_transport_t crumbs_vbus_transport;
+
+    /**
+     * @brief Fill @p dev to reach @p addr on @p bus from controller @p ctx.
+     *
+     * The delay is crumbs_vbus_delay_us(), so select the bus with
+     * crumbs_vbus_use() before running GETs. dev->transport is
+     * crumbs_vbus_transport.
+     */
+    void crumbs_vbus_bind(crumbs_vbus_t *bus, crumbs_device_t *dev, crumbs_context_t *ctx, uint8_t addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRUMBS_VBUS_H */
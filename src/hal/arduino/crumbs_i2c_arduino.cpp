@@ -8,6 +8,7 @@
 
 #include "crumbs_arduino.h"
 #include "crumbs_message.h"
+#include "crumbs_recover.h"
 
 /** @brief Default Two-Wire (I2C) bus frequency used by Arduino HAL (100 kHz). */
 #ifndef CRUMBS_DEFAULT_TWI_FREQ
@@ -22,8 +23,19 @@
 #endif
 #endif
 
-// Single global CRUMBS context pointer used by the Wire callbacks (single-bus pattern).
-static crumbs_context_t *g_crumbs_ctx = nullptr;
+#if CRUMBS_ARDUINO_MAX_BUSES < 1 || CRUMBS_ARDUINO_MAX_BUSES > 4
+#error "CRUMBS_ARDUINO_MAX_BUSES must be between 1 and 4"
+#endif
+
+// Peripheral bindings: one slot per TwoWire that serves a CRUMBS context.
+// Wire callbacks carry no user pointer, so each slot gets its own trampoline.
+struct crumbs_arduino_slot_t
+{
+    TwoWire *wire;
+    crumbs_context_t *ctx;
+};
+
+static crumbs_arduino_slot_t g_crumbs_slots[CRUMBS_ARDUINO_MAX_BUSES];
 
 /* ------------------------------------------------------------------------- */
 /* Debug helpers (Arduino-specific)                                          */
@@ -64,41 +76,44 @@ static void crumbs_arduino_dbg_hex(const char *prefix, const uint8_t *data, size
 /* Internal helpers                                                          */
 /* ------------------------------------------------------------------------- */
 
-static void crumbs_arduino_on_receive(int numBytes)
+static void crumbs_arduino_receive(TwoWire *wire, crumbs_context_t *ctx, int numBytes)
 {
-    if (g_crumbs_ctx == nullptr || numBytes <= 0)
+    if (wire == nullptr)
+    {
+        return;
+    }
+    if (ctx == nullptr || numBytes <= 0)
     {
 #if CRUMBS_ARDUINO_DBG_ENABLED
         crumbs_arduino_dbg("on_receive: no ctx or 0 bytes");
 #endif
         // Drain pending bytes to avoid leaving the Wire buffer full.
-        while (Wire.available() > 0)
+        while (wire->available() > 0)
         {
-            (void)Wire.read();
+            (void)wire->read();
         }
         return;
     }
 
-    uint8_t buffer[CRUMBS_MESSAGE_MAX_SIZE];
-    size_t index = 0;
+    CRUMBS_TRACE(ctx, CRUMBS_TRACE_RX_START, 0u, numBytes);
 
-    while (Wire.available() > 0 && index < sizeof(buffer))
-    {
-        buffer[index++] = static_cast<uint8_t>(Wire.read());
-    }
+    // Fold the CRC into the read loop; the frame is accepted or rejected as
+    // soon as its last byte lands, with no second pass over the buffer.
+    crumbs_rx_t rx;
+    crumbs_rx_reset(&rx);
 
-    // Drain any remaining bytes that do not fit in @buffer.
-    while (Wire.available() > 0)
+    while (wire->available() > 0)
     {
-        (void)Wire.read();
+        (void)crumbs_rx_feed_byte(&rx, static_cast<uint8_t>(wire->read()));
     }
 
 #if CRUMBS_ARDUINO_DBG_ENABLED
-    crumbs_arduino_dbg_hex("on_receive: ", buffer, index);
+    crumbs_arduino_dbg_hex("on_receive: ", rx.buf, rx.len);
 #endif
 
-    // Pass bytes to the core decoder which will call on_message() when valid.
-    int rc = crumbs_peripheral_handle_receive(g_crumbs_ctx, buffer, index);
+    // Dispatch the validated frame; the core calls on_message()/handlers.
+    int rc = crumbs_peripheral_handle_rx(ctx, &rx);
+    CRUMBS_TRACE(ctx, CRUMBS_TRACE_RX_DONE, rx.len > 1u ? rx.buf[1] : 0u, numBytes);
 #if CRUMBS_ARDUINO_DBG_ENABLED
     if (rc != 0)
     {
@@ -110,9 +125,9 @@ static void crumbs_arduino_on_receive(int numBytes)
 #endif
 }
 
-static void crumbs_arduino_on_request()
+static void crumbs_arduino_request(TwoWire *wire, crumbs_context_t *ctx)
 {
-    if (g_crumbs_ctx == nullptr)
+    if (wire == nullptr || ctx == nullptr)
     {
 #if CRUMBS_ARDUINO_DBG_ENABLED
         crumbs_arduino_dbg("on_request: no ctx");
@@ -120,6 +135,21 @@ static void crumbs_arduino_on_request()
         return;
     }
 
+    CRUMBS_TRACE(ctx, CRUMBS_TRACE_REQUEST_START, ctx->requested_opcode, 0u);
+
+#if CRUMBS_ENABLE_REPLY_CACHE
+    // Pre-built frame from loop(): hand it to the bus without copying it first.
+    const uint8_t *ready = nullptr;
+    size_t ready_len = 0;
+    if (crumbs_peripheral_ready_reply(ctx, &ready, &ready_len))
+    {
+        CRUMBS_TRACE(ctx, CRUMBS_TRACE_TX_START, ready[1], ready_len);
+        wire->write(ready, ready_len);
+        CRUMBS_TRACE(ctx, CRUMBS_TRACE_TX_DONE, ready[1], ready_len);
+        return;
+    }
+#endif
+
 #if CRUMBS_ARDUINO_DBG_ENABLED
     crumbs_arduino_dbg("on_request: building reply");
 #endif
@@ -127,7 +157,7 @@ static void crumbs_arduino_on_request()
     uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
     size_t frame_len = 0;
 
-    int rc = crumbs_peripheral_build_reply(g_crumbs_ctx,
+    int rc = crumbs_peripheral_build_reply(ctx,
                                            frame,
                                            sizeof(frame),
                                            &frame_len);
@@ -136,7 +166,9 @@ static void crumbs_arduino_on_request()
 #if CRUMBS_ARDUINO_DBG_ENABLED
         crumbs_arduino_dbg_hex("on_request: tx ", frame, frame_len);
 #endif
-        Wire.write(frame, frame_len);
+        CRUMBS_TRACE(ctx, CRUMBS_TRACE_TX_START, frame[1], frame_len);
+        wire->write(frame, frame_len);
+        CRUMBS_TRACE(ctx, CRUMBS_TRACE_TX_DONE, frame[1], frame_len);
     }
     else
     {
@@ -150,30 +182,92 @@ static void crumbs_arduino_on_request()
     }
 }
 
+template <uint8_t N>
+static void crumbs_arduino_on_receive_slot(int numBytes)
+{
+    crumbs_arduino_receive(g_crumbs_slots[N].wire, g_crumbs_slots[N].ctx, numBytes);
+}
+
+template <uint8_t N>
+static void crumbs_arduino_on_request_slot()
+{
+    crumbs_arduino_request(g_crumbs_slots[N].wire, g_crumbs_slots[N].ctx);
+}
+
+static void (*const k_crumbs_on_receive[CRUMBS_ARDUINO_MAX_BUSES])(int) = {
+    crumbs_arduino_on_receive_slot<0>,
+#if CRUMBS_ARDUINO_MAX_BUSES > 1
+    crumbs_arduino_on_receive_slot<1>,
+#endif
+#if CRUMBS_ARDUINO_MAX_BUSES > 2
+    crumbs_arduino_on_receive_slot<2>,
+#endif
+#if CRUMBS_ARDUINO_MAX_BUSES > 3
+    crumbs_arduino_on_receive_slot<3>,
+#endif
+};
+
+static void (*const k_crumbs_on_request[CRUMBS_ARDUINO_MAX_BUSES])() = {
+    crumbs_arduino_on_request_slot<0>,
+#if CRUMBS_ARDUINO_MAX_BUSES > 1
+    crumbs_arduino_on_request_slot<1>,
+#endif
+#if CRUMBS_ARDUINO_MAX_BUSES > 2
+    crumbs_arduino_on_request_slot<2>,
+#endif
+#if CRUMBS_ARDUINO_MAX_BUSES > 3
+    crumbs_arduino_on_request_slot<3>,
+#endif
+};
+
+/** @brief Slot already bound to @p wire, else the first free one, else -1. */
+static int crumbs_arduino_slot_for(TwoWire *wire)
+{
+    int free_slot = -1;
+    for (int i = 0; i < CRUMBS_ARDUINO_MAX_BUSES; i++)
+    {
+        if (g_crumbs_slots[i].wire == wire)
+        {
+            return i;
+        }
+        if (g_crumbs_slots[i].wire == nullptr && free_slot < 0)
+        {
+            free_slot = i;
+        }
+    }
+    return free_slot;
+}
+
 /* ------------------------------------------------------------------------- */
 /* Public API                                                                */
 /* ------------------------------------------------------------------------- */
 
 extern "C" void crumbs_arduino_init_controller(crumbs_context_t *ctx)
+{
+    crumbs_arduino_init_controller_on(ctx, &Wire);
+}
+
+extern "C" void crumbs_arduino_init_controller_on(crumbs_context_t *ctx, void *wire)
 {
     if (ctx == nullptr)
     {
         return;
     }
+    TwoWire *bus = (wire != nullptr) ? static_cast<TwoWire *>(wire) : &Wire;
 
     // Initialize CRUMBS context as controller.
     crumbs_init(ctx, CRUMBS_ROLE_CONTROLLER, 0);
+    crumbs_set_transport(ctx, &crumbs_arduino_transport, bus);
 
-    // Use the default Wire bus.
-    Wire.begin();
+    bus->begin();
 #if defined(TWI_FREQ) || defined(TWBR)
     // If the platform supports setClock(), use a standard frequency.
-    Wire.setClock(CRUMBS_DEFAULT_TWI_FREQ);
+    bus->setClock(CRUMBS_DEFAULT_TWI_FREQ);
 #endif
 
-    // Controller mode keeps Wire configured but does not register callbacks.
-    // Users should call crumbs_controller_send() paired with crumbs_arduino_wire_write().
-    g_crumbs_ctx = ctx;
+    // Controller mode keeps the bus configured but does not register callbacks.
+    // Users should call crumbs_controller_send() paired with crumbs_arduino_wire_write()
+    // and the same TwoWire as io, or fill devices with crumbs_device_init().
 
 #if CRUMBS_ARDUINO_DBG_ENABLED
     crumbs_arduino_dbg("init_controller: ready");
@@ -181,31 +275,162 @@ extern "C" void crumbs_arduino_init_controller(crumbs_context_t *ctx)
 }
 
 extern "C" void crumbs_arduino_init_peripheral(crumbs_context_t *ctx, uint8_t address)
+{
+    (void)crumbs_arduino_init_peripheral_on(ctx, address, &Wire);
+}
+
+extern "C" int crumbs_arduino_init_peripheral_on(crumbs_context_t *ctx, uint8_t address, void *wire)
 {
     if (ctx == nullptr)
     {
-        return;
+        return -1;
+    }
+    TwoWire *bus = (wire != nullptr) ? static_cast<TwoWire *>(wire) : &Wire;
+
+    int slot = crumbs_arduino_slot_for(bus);
+    if (slot < 0)
+    {
+#if CRUMBS_ARDUINO_DBG_ENABLED
+        crumbs_arduino_dbg("init_peripheral: no free bus slot");
+#endif
+        return -1;
     }
 
     // Initialize CRUMBS context as peripheral.
     crumbs_init(ctx, CRUMBS_ROLE_PERIPHERAL, address);
 
-    // Configure TwoWire as an I2C slave at the given address.
-    Wire.begin(address);
+    // Bind before the bus can raise callbacks.
+    g_crumbs_slots[slot].ctx = ctx;
+    g_crumbs_slots[slot].wire = bus;
+
+    // Configure the TwoWire as an I2C slave at the given address.
+    bus->begin(address);
 #if defined(TWI_FREQ) || defined(TWBR)
-    Wire.setClock(CRUMBS_DEFAULT_TWI_FREQ);
+    bus->setClock(CRUMBS_DEFAULT_TWI_FREQ);
 #endif
 
-    g_crumbs_ctx = ctx;
-
-    // Register Wire callbacks that route into the CRUMBS core.
-    Wire.onReceive(crumbs_arduino_on_receive);
-    Wire.onRequest(crumbs_arduino_on_request);
+    // Register this slot's callbacks that route into the CRUMBS core.
+    bus->onReceive(k_crumbs_on_receive[slot]);
+    bus->onRequest(k_crumbs_on_request[slot]);
 
 #if CRUMBS_ARDUINO_DBG_ENABLED
     Serial.print(F("[CRUMBS] init_peripheral: addr=0x"));
-    Serial.println(address, HEX);
+    Serial.print(address, HEX);
+    Serial.print(F(" slot="));
+    Serial.println(slot);
 #endif
+    return slot;
+}
+
+extern "C" int crumbs_arduino_set_general_call(void *wire, int enable)
+{
+    TwoWire *bus = (wire != nullptr) ? static_cast<TwoWire *>(wire) : &Wire;
+#if defined(TWAR) && defined(TWGCE)
+    if (bus != &Wire)
+    {
+        return -1;
+    }
+    if (enable)
+    {
+        TWAR |= _BV(TWGCE);
+    }
+    else
+    {
+        TWAR &= (uint8_t)~_BV(TWGCE);
+    }
+    return 0;
+#else
+    (void)bus;
+    (void)enable;
+    return -1;
+#endif
+}
+
+extern "C" void crumbs_arduino_attention_pin(void *user_data, int asserted)
+{
+    uint8_t pin = (uint8_t)(uintptr_t)user_data;
+    if (asserted)
+    {
+        digitalWrite(pin, LOW); /* output latch low before driving: no high glitch */
+        pinMode(pin, OUTPUT);
+    }
+    else
+    {
+        pinMode(pin, INPUT); /* released; the shared pull-up raises the line */
+    }
+}
+
+extern "C" int crumbs_arduino_set_clock(void *user_ctx, uint32_t hz)
+{
+    TwoWire *wire = (user_ctx != nullptr) ? static_cast<TwoWire *>(user_ctx) : &Wire;
+#if defined(TWI_FREQ) || defined(TWBR)
+    wire->setClock(hz);
+#if CRUMBS_ARDUINO_DBG_ENABLED
+    Serial.print(F("[CRUMBS] set_clock: "));
+    Serial.println(hz);
+#endif
+    return 0;
+#else
+    (void)wire;
+    (void)hz;
+    return -1;
+#endif
+}
+
+#if defined(SDA) && defined(SCL)
+/* Open-drain emulation for crumbs_bus_clear(): release = input, the bus pull-ups raise the line. */
+static void crumbs_arduino_line(uint8_t pin, int level)
+{
+    if (level)
+    {
+        pinMode(pin, INPUT);
+    }
+    else
+    {
+        digitalWrite(pin, LOW);
+        pinMode(pin, OUTPUT);
+    }
+}
+
+static void crumbs_arduino_set_scl(void *user, int level)
+{
+    (void)user;
+    crumbs_arduino_line(SCL, level);
+}
+
+static void crumbs_arduino_set_sda(void *user, int level)
+{
+    (void)user;
+    crumbs_arduino_line(SDA, level);
+}
+
+static int crumbs_arduino_get_sda(void *user)
+{
+    (void)user;
+    return digitalRead(SDA) == HIGH;
+}
+#endif
+
+extern "C" int crumbs_arduino_bus_recover(void *user_ctx)
+{
+    TwoWire *wire = (user_ctx != nullptr) ? static_cast<TwoWire *>(user_ctx) : &Wire;
+    int rc = 0;
+
+#if defined(SDA) && defined(SCL)
+    if (wire == &Wire)
+    {
+        crumbs_bus_pins_t pins = {crumbs_arduino_set_scl, crumbs_arduino_set_sda,
+                                  crumbs_arduino_get_sda, crumbs_arduino_delay_us, nullptr, 5u};
+        wire->end();
+        rc = crumbs_bus_clear(&pins);
+    }
+#endif
+    wire->begin();
+#if CRUMBS_ARDUINO_DBG_ENABLED
+    Serial.print(F("[CRUMBS] bus_recover: "));
+    Serial.println(rc);
+#endif
+    return (rc < 0) ? rc : 0;
 }
 
 extern "C" int crumbs_arduino_wire_write(void *user_ctx,
@@ -402,3 +627,13 @@ uint32_t crumbs_arduino_millis(void)
 {
     return millis();
 }
+
+extern "C" const crumbs_transport_t crumbs_arduino_transport = {
+    "wire",
+    crumbs_arduino_wire_write,
+    crumbs_arduino_read,
+    crumbs_arduino_write_then_read,
+    CRUMBS_TRANSPORT_CAP_ADDRESSED | CRUMBS_TRANSPORT_CAP_TRANSACT | CRUMBS_TRANSPORT_CAP_BROADCAST,
+    (uint8_t)((CRUMBS_ARDUINO_WIRE_BUFFER_LEN < CRUMBS_MESSAGE_MAX_SIZE) ? CRUMBS_ARDUINO_WIRE_BUFFER_LEN
+                                                                         : CRUMBS_MESSAGE_MAX_SIZE),
+};
@@ -0,0 +1,73 @@
+/**
+ * @file
+ * @brief Arduino Stream port for the serial transport (see crumbs_serial.h).
+ */
+
+#include <Arduino.h>
+
+#include "crumbs_arduino.h"
+
+static uint32_t crumbs_arduino_serial_micros(void)
+{
+    return (uint32_t)micros();
+}
+
+extern "C" int crumbs_arduino_serial_write(void *user, const uint8_t *data, size_t len)
+{
+    crumbs_arduino_serial_t *s = static_cast<crumbs_arduino_serial_t *>(user);
+    if (s == nullptr || s->stream == nullptr || (len > 0u && data == nullptr))
+        return -1;
+
+    Stream *stream = static_cast<Stream *>(s->stream);
+    if (s->de_pin >= 0)
+        digitalWrite(s->de_pin, HIGH);
+    size_t written = stream->write(data, len);
+    stream->flush(); // returns once the last byte has been shifted out
+    if (s->de_pin >= 0)
+        digitalWrite(s->de_pin, LOW);
+    return (written == len) ? 0 : -1;
+}
+
+extern "C" int crumbs_arduino_serial_read(void *user, uint8_t *buf, size_t len, uint32_t timeout_us)
+{
+    crumbs_arduino_serial_t *s = static_cast<crumbs_arduino_serial_t *>(user);
+    if (s == nullptr || s->stream == nullptr || buf == nullptr)
+        return -1;
+
+    Stream *stream = static_cast<Stream *>(s->stream);
+    uint32_t start = (uint32_t)micros();
+    while (stream->available() <= 0)
+    {
+        if ((uint32_t)((uint32_t)micros() - start) >= timeout_us)
+            return 0;
+    }
+
+    size_t n = 0;
+    while (n < len && stream->available() > 0)
+    {
+        int c = stream->read();
+        if (c < 0)
+            break;
+        buf[n++] = (uint8_t)c;
+    }
+    return (int)n;
+}
+
+extern "C" void crumbs_arduino_serial_port(crumbs_serial_port_t *port,
+                                           crumbs_arduino_serial_t *s,
+                                           void *stream,
+                                           int de_pin)
+{
+    if (port == nullptr || s == nullptr)
+        return;
+
+    s->stream = stream;
+    s->de_pin = de_pin;
+    if (de_pin >= 0)
+    {
+        pinMode(de_pin, OUTPUT);
+        digitalWrite(de_pin, LOW);
+    }
+    crumbs_serial_init(port, crumbs_arduino_serial_write, crumbs_arduino_serial_read, s);
+    port->clock = crumbs_arduino_serial_micros;
+}
@@ -0,0 +1,484 @@
+/**
+ * @file
+ * @brief Native ESP-IDF HAL: i2c_master controller, i2c_slave peripheral and
+ *        FreeRTOS tasks (see crumbs_esp_idf.h).
+ */
+
+#include "crumbs_esp_idf.h"
+
+#if defined(ESP_PLATFORM) && !defined(ARDUINO)
+
+#include <string.h> /* memset, memcpy */
+
+#include "esp_attr.h"    /* IRAM_ATTR */
+#include "esp_rom_sys.h" /* esp_rom_delay_us */
+#include "esp_timer.h"   /* esp_timer_get_time */
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+/** @brief Driver timeout for a crumbs timeout hint (0 = default). */
+static int crumbs_esp_timeout_ms(uint32_t timeout_us)
+{
+    if (timeout_us == 0u)
+    {
+        return CRUMBS_ESP_IDF_TIMEOUT_MS;
+    }
+    return (int)((timeout_us + 999u) / 1000u);
+}
+
+/** @brief Ticks to block for @p us, rounded up so a due read is never early. */
+static TickType_t crumbs_esp_ticks(uint32_t us)
+{
+    const uint32_t tick_us = 1000u * portTICK_PERIOD_MS;
+
+    if (us == UINT32_MAX)
+    {
+        return portMAX_DELAY;
+    }
+    return (TickType_t)((us + tick_us - 1u) / tick_us);
+}
+
+/** @brief Device handle for @p addr, added to the bus on first use. */
+static i2c_master_dev_handle_t crumbs_esp_dev(crumbs_esp_i2c_t *i2c, uint8_t addr)
+{
+    i2c_device_config_t cfg;
+
+    for (uint8_t i = 0; i < i2c->dev_count; i++)
+    {
+        if (i2c->devs[i].addr == addr)
+        {
+            return i2c->devs[i].handle;
+        }
+    }
+    if (i2c->dev_count >= CRUMBS_ESP_IDF_MAX_DEVICES)
+    {
+        return NULL;
+    }
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.dev_addr_length = I2C_ADDR_BIT_LEN_7;
+    cfg.device_address = addr;
+    cfg.scl_speed_hz = i2c->scl_hz;
+    if (i2c_master_bus_add_device(i2c->bus, &cfg, &i2c->devs[i2c->dev_count].handle) != ESP_OK)
+    {
+        return NULL;
+    }
+    i2c->devs[i2c->dev_count].addr = addr;
+    return i2c->devs[i2c->dev_count++].handle;
+}
+
+/** @brief Hand one submitted request to the engine; refusals complete at once. */
+static void crumbs_esp_engine_accept(crumbs_esp_engine_task_t *t, crumbs_request_t *req)
+{
+    if (crumbs_engine_submit(&t->eng, req) != 0)
+    {
+        t->rejected++;
+        if (req && req->on_done)
+        {
+            req->on_done(req, -1);
+        }
+    }
+}
+
+static void crumbs_esp_engine_run(void *arg)
+{
+    crumbs_esp_engine_task_t *t = (crumbs_esp_engine_task_t *)arg;
+    crumbs_request_t *req;
+
+    for (;;)
+    {
+        /* Sleep until a submit arrives or the earliest read is due. */
+        uint32_t idle = crumbs_engine_idle_us(&t->eng, crumbs_esp_now_us());
+        if (xQueueReceive(t->submit, &req, crumbs_esp_ticks(idle)) == pdTRUE)
+        {
+            do
+            {
+                crumbs_esp_engine_accept(t, req);
+            } while (xQueueReceive(t->submit, &req, 0) == pdTRUE);
+        }
+        if (t->eng.head)
+        {
+            (void)crumbs_engine_poll(&t->eng, crumbs_esp_now_us());
+            t->polls++;
+        }
+    }
+}
+
+#if CONFIG_I2C_ENABLE_SLAVE_DRIVER_VERSION_2
+
+#define CRUMBS_ESP_EVT_RECEIVE 1u
+#define CRUMBS_ESP_EVT_REQUEST 2u
+
+/** @brief ISR-to-task message; a receive carries a copy of the frame. */
+typedef struct
+{
+    uint8_t kind;
+    uint8_t len;
+    uint8_t data[CRUMBS_MESSAGE_MAX_SIZE];
+} crumbs_esp_event_t;
+
+static bool crumbs_esp_post(crumbs_esp_peripheral_t *p, const crumbs_esp_event_t *ev)
+{
+    BaseType_t woken = pdFALSE;
+
+    if (xQueueSendFromISR(p->events, ev, &woken) != pdTRUE)
+    {
+        p->overruns++;
+    }
+    return woken == pdTRUE;
+}
+
+static IRAM_ATTR bool crumbs_esp_on_receive(i2c_slave_dev_handle_t dev,
+                                            const i2c_slave_rx_done_event_data_t *evt,
+                                            void *arg)
+{
+    crumbs_esp_event_t ev;
+    (void)dev;
+
+    ev.kind = CRUMBS_ESP_EVT_RECEIVE;
+    ev.len = (uint8_t)((evt->length < sizeof(ev.data)) ? evt->length : sizeof(ev.data));
+    memcpy(ev.data, evt->buffer, ev.len);
+    return crumbs_esp_post((crumbs_esp_peripheral_t *)arg, &ev);
+}
+
+static IRAM_ATTR bool crumbs_esp_on_request(i2c_slave_dev_handle_t dev,
+                                            const i2c_slave_request_event_data_t *evt,
+                                            void *arg)
+{
+    crumbs_esp_event_t ev;
+    (void)dev;
+    (void)evt;
+
+    ev.kind = CRUMBS_ESP_EVT_REQUEST;
+    ev.len = 0u;
+    return crumbs_esp_post((crumbs_esp_peripheral_t *)arg, &ev);
+}
+
+static void crumbs_esp_peripheral_run(void *arg)
+{
+    crumbs_esp_peripheral_t *p = (crumbs_esp_peripheral_t *)arg;
+    crumbs_esp_event_t ev;
+    uint8_t reply[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t len;
+    uint32_t written;
+
+    for (;;)
+    {
+        if (xQueueReceive(p->events, &ev, portMAX_DELAY) != pdTRUE)
+        {
+            continue;
+        }
+        if (ev.kind == CRUMBS_ESP_EVT_RECEIVE)
+        {
+            (void)crumbs_peripheral_handle_receive(p->ctx, ev.data, ev.len);
+            p->frames++;
+            continue;
+        }
+
+        /* The controller is clock-stretched until the reply is written. */
+        len = 0u;
+        if (crumbs_peripheral_build_reply(p->ctx, reply, sizeof(reply), &len) != 0 || len == 0u)
+        {
+            continue;
+        }
+        if (i2c_slave_write((i2c_slave_dev_handle_t)p->dev, reply, (uint32_t)len, &written,
+                            CRUMBS_ESP_IDF_TIMEOUT_MS) == ESP_OK)
+        {
+            p->replies++;
+        }
+    }
+}
+
+#endif /* CONFIG_I2C_ENABLE_SLAVE_DRIVER_VERSION_2 */
+
+/* ---- Public API -------------------------------------------------------- */
+
+int crumbs_esp_attach_controller(crumbs_context_t *ctx, crumbs_esp_i2c_t *i2c,
+                                 i2c_master_bus_handle_t bus, uint32_t scl_hz)
+{
+    if (!ctx || !i2c || !bus || scl_hz == 0u)
+    {
+        return -1;
+    }
+
+    memset(i2c, 0, sizeof(*i2c));
+    i2c->bus = bus;
+    i2c->scl_hz = scl_hz;
+
+    crumbs_init(ctx, CRUMBS_ROLE_CONTROLLER, 0u);
+    crumbs_set_transport(ctx, &crumbs_esp_transport, i2c);
+    return 0;
+}
+
+int crumbs_esp_init_controller(crumbs_context_t *ctx, crumbs_esp_i2c_t *i2c,
+                               i2c_port_num_t port, int sda, int scl, uint32_t scl_hz)
+{
+    i2c_master_bus_config_t cfg;
+    i2c_master_bus_handle_t bus;
+
+    if (!ctx || !i2c || sda < 0 || scl < 0 || scl_hz == 0u)
+    {
+        return -1;
+    }
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.i2c_port = port;
+    cfg.sda_io_num = (gpio_num_t)sda;
+    cfg.scl_io_num = (gpio_num_t)scl;
+    cfg.clk_source = I2C_CLK_SRC_DEFAULT;
+    cfg.glitch_ignore_cnt = 7;
+    cfg.trans_queue_depth = 0; /* synchronous; the engine task does the queueing */
+    cfg.flags.enable_internal_pullup = 1;
+    if (i2c_new_master_bus(&cfg, &bus) != ESP_OK)
+    {
+        return -2;
+    }
+
+    (void)crumbs_esp_attach_controller(ctx, i2c, bus, scl_hz);
+    i2c->owns_bus = 1u;
+    return 0;
+}
+
+void crumbs_esp_close(crumbs_esp_i2c_t *i2c)
+{
+    if (!i2c || !i2c->bus)
+    {
+        return;
+    }
+    for (uint8_t i = 0; i < i2c->dev_count; i++)
+    {
+        (void)i2c_master_bus_rm_device(i2c->devs[i].handle);
+    }
+    i2c->dev_count = 0u;
+    if (i2c->owns_bus)
+    {
+        (void)i2c_del_master_bus(i2c->bus);
+    }
+    i2c->bus = NULL;
+}
+
+int crumbs_esp_i2c_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    crumbs_esp_i2c_t *i2c = (crumbs_esp_i2c_t *)user_ctx;
+    i2c_master_dev_handle_t dev;
+
+    if (!i2c || !i2c->bus || (!data && len > 0u))
+    {
+        return -1;
+    }
+    dev = crumbs_esp_dev(i2c, addr);
+    if (!dev)
+    {
+        return -2;
+    }
+    if (i2c_master_transmit(dev, data, len, CRUMBS_ESP_IDF_TIMEOUT_MS) != ESP_OK)
+    {
+        return -3;
+    }
+    return 0;
+}
+
+int crumbs_esp_i2c_read(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len,
+                        uint32_t timeout_us)
+{
+    crumbs_esp_i2c_t *i2c = (crumbs_esp_i2c_t *)user_ctx;
+    i2c_master_dev_handle_t dev;
+
+    if (!i2c || !i2c->bus || !buffer || len == 0u)
+    {
+        return -1;
+    }
+    dev = crumbs_esp_dev(i2c, addr);
+    if (!dev)
+    {
+        return -2;
+    }
+    if (i2c_master_receive(dev, buffer, len, crumbs_esp_timeout_ms(timeout_us)) != ESP_OK)
+    {
+        return -3;
+    }
+    return (int)len;
+}
+
+int crumbs_esp_i2c_write_read(void *user_ctx, uint8_t addr, const uint8_t *tx, size_t tx_len,
+                              uint8_t *rx, size_t rx_len, uint32_t timeout_us,
+                              int require_repeated_start)
+{
+    crumbs_esp_i2c_t *i2c = (crumbs_esp_i2c_t *)user_ctx;
+    i2c_master_dev_handle_t dev;
+
+    /* i2c_master_transmit_receive() always uses a repeated START. */
+    (void)require_repeated_start;
+
+    if (!i2c || !i2c->bus || !tx || tx_len == 0u || !rx || rx_len == 0u)
+    {
+        return -1;
+    }
+    dev = crumbs_esp_dev(i2c, addr);
+    if (!dev)
+    {
+        return -2;
+    }
+    if (i2c_master_transmit_receive(dev, tx, tx_len, rx, rx_len,
+                                    crumbs_esp_timeout_ms(timeout_us)) != ESP_OK)
+    {
+        return -3;
+    }
+    return (int)rx_len;
+}
+
+int crumbs_esp_scan(void *user_ctx, uint8_t start_addr, uint8_t end_addr, int strict,
+                    uint8_t *found, size_t max_found)
+{
+    crumbs_esp_i2c_t *i2c = (crumbs_esp_i2c_t *)user_ctx;
+    size_t count = 0u;
+    (void)strict;
+
+    if (!i2c || !i2c->bus || !found || max_found == 0u || start_addr > end_addr)
+    {
+        return -1;
+    }
+    for (uint16_t a = start_addr; a <= end_addr && count < max_found; a++)
+    {
+        if (i2c_master_probe(i2c->bus, (uint16_t)a, CRUMBS_ESP_IDF_TIMEOUT_MS) == ESP_OK)
+        {
+            found[count++] = (uint8_t)a;
+        }
+    }
+    return (int)count;
+}
+
+const crumbs_transport_t crumbs_esp_transport = {
+    "esp-idf-i2c",
+    crumbs_esp_i2c_write,
+    crumbs_esp_i2c_read,
+    crumbs_esp_i2c_write_read,
+    CRUMBS_TRANSPORT_CAP_ADDRESSED | CRUMBS_TRANSPORT_CAP_TRANSACT | CRUMBS_TRANSPORT_CAP_BROADCAST,
+    CRUMBS_MESSAGE_MAX_SIZE,
+};
+
+uint32_t crumbs_esp_now_us(void)
+{
+    return (uint32_t)esp_timer_get_time();
+}
+
+void crumbs_esp_delay_us(uint32_t us)
+{
+    const uint32_t tick_us = 1000u * portTICK_PERIOD_MS;
+
+    if (us >= tick_us)
+    {
+        vTaskDelay((TickType_t)(us / tick_us));
+        us %= tick_us;
+    }
+    if (us > 0u)
+    {
+        esp_rom_delay_us(us);
+    }
+}
+
+int crumbs_esp_engine_start(crumbs_esp_engine_task_t *t, int core, UBaseType_t priority)
+{
+    if (!t)
+    {
+        return -1;
+    }
+
+    memset(t, 0, sizeof(*t));
+    crumbs_engine_init(&t->eng);
+    t->submit = xQueueCreate(CRUMBS_ESP_IDF_SUBMIT_DEPTH, sizeof(crumbs_request_t *));
+    if (!t->submit)
+    {
+        return -2;
+    }
+    if (xTaskCreatePinnedToCore(crumbs_esp_engine_run, "crumbs_eng", CRUMBS_ESP_IDF_TASK_STACK,
+                                t, priority, &t->task, (BaseType_t)core) != pdPASS)
+    {
+        vQueueDelete(t->submit);
+        t->submit = NULL;
+        t->task = NULL;
+        return -2;
+    }
+    return 0;
+}
+
+int crumbs_esp_engine_submit(crumbs_esp_engine_task_t *t, crumbs_request_t *req)
+{
+    if (!t || !t->submit || !req)
+    {
+        return -1;
+    }
+    return (xQueueSend(t->submit, &req, 0) == pdTRUE) ? 0 : -1;
+}
+
+int crumbs_esp_init_peripheral(crumbs_esp_peripheral_t *p, crumbs_context_t *ctx,
+                               uint8_t address, i2c_port_num_t port, int sda, int scl,
+                               int core, UBaseType_t priority)
+{
+#if CONFIG_I2C_ENABLE_SLAVE_DRIVER_VERSION_2
+    i2c_slave_config_t cfg;
+    i2c_slave_event_callbacks_t cbs;
+    i2c_slave_dev_handle_t dev;
+
+    if (!p || !ctx || sda < 0 || scl < 0 || address < 0x08u || address > 0x77u)
+    {
+        return -1;
+    }
+
+    memset(p, 0, sizeof(*p));
+    crumbs_init(ctx, CRUMBS_ROLE_PERIPHERAL, address);
+    p->ctx = ctx;
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.i2c_port = port;
+    cfg.sda_io_num = (gpio_num_t)sda;
+    cfg.scl_io_num = (gpio_num_t)scl;
+    cfg.clk_source = I2C_CLK_SRC_DEFAULT;
+    cfg.send_buf_depth = CRUMBS_MESSAGE_MAX_SIZE * 2u;
+    cfg.receive_buf_depth = CRUMBS_MESSAGE_MAX_SIZE * 2u;
+    cfg.slave_addr = address;
+    cfg.addr_bit_len = I2C_ADDR_BIT_LEN_7;
+    cfg.flags.enable_internal_pullup = 1;
+
+    p->events = xQueueCreate(CRUMBS_ESP_IDF_EVENT_DEPTH, sizeof(crumbs_esp_event_t));
+    if (!p->events)
+    {
+        return -2;
+    }
+    if (i2c_new_slave_device(&cfg, &dev) != ESP_OK)
+    {
+        vQueueDelete(p->events);
+        p->events = NULL;
+        return -2;
+    }
+    p->dev = dev;
+
+    memset(&cbs, 0, sizeof(cbs));
+    cbs.on_receive = crumbs_esp_on_receive;
+    cbs.on_request = crumbs_esp_on_request;
+    if (i2c_slave_register_event_callbacks(dev, &cbs, p) != ESP_OK ||
+        xTaskCreatePinnedToCore(crumbs_esp_peripheral_run, "crumbs_periph",
+                                CRUMBS_ESP_IDF_TASK_STACK, p, priority, &p->task,
+                                (BaseType_t)core) != pdPASS)
+    {
+        (void)i2c_del_slave_device(dev);
+        vQueueDelete(p->events);
+        p->events = NULL;
+        p->dev = NULL;
+        return -2;
+    }
+    return 0;
+#else
+    (void)p;
+    (void)ctx;
+    (void)address;
+    (void)port;
+    (void)sda;
+    (void)scl;
+    (void)core;
+    (void)priority;
+    return -1;
+#endif
+}
+
+#endif /* defined(ESP_PLATFORM) && !defined(ARDUINO) */
@@ -0,0 +1,447 @@
+/**
+ * @file
+ * @brief Parallel multi-bus controller (see crumbs_bus_group.h).
+ *
+ * Shared fields are accessed with the GCC/Clang __atomic builtins so the
+ * public header stays plain C (and C++) without <stdatomic.h>.
+ */
+
+/* Ensure POSIX prototypes (clock_gettime, pthread_condattr_setclock). */
+#if !defined(_POSIX_C_SOURCE) || _POSIX_C_SOURCE < 200809L
+#undef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "crumbs_bus_group.h"
+
+#if defined(__linux__)
+
+#include <string.h> /* memset */
+#include <time.h>   /* clock_gettime, CLOCK_MONOTONIC */
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+static uint32_t crumbs_bus_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u);
+}
+
+/** @brief Absolute CLOCK_MONOTONIC deadline @p us from now. */
+static struct timespec crumbs_bus_deadline(uint32_t us)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += (time_t)(us / 1000000u);
+    ts.tv_nsec += (long)(us % 1000000u) * 1000L;
+    if (ts.tv_nsec >= 1000000000L)
+    {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+static int crumbs_bus_cond_init(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+    if (pthread_condattr_init(&attr) != 0)
+    {
+        return -1;
+    }
+    int rc = pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    if (rc == 0)
+    {
+        rc = pthread_cond_init(cond, &attr);
+    }
+    pthread_condattr_destroy(&attr);
+    return rc == 0 ? 0 : -1;
+}
+
+static void crumbs_bus_wake(crumbs_bus_t *bus)
+{
+    pthread_mutex_lock(&bus->lock);
+    pthread_cond_signal(&bus->wake);
+    pthread_mutex_unlock(&bus->lock);
+}
+
+/** @brief Account for @p n requests leaving @p bus (completed or backed out). */
+static void crumbs_bus_retire(crumbs_bus_t *bus, uint32_t n)
+{
+    crumbs_bus_group_t *group = bus->group;
+
+    __atomic_sub_fetch(&bus->pending, n, __ATOMIC_SEQ_CST);
+    if (__atomic_sub_fetch(&group->outstanding, n, __ATOMIC_SEQ_CST) == 0u)
+    {
+        pthread_mutex_lock(&group->idle_lock);
+        pthread_cond_broadcast(&group->idle_cond);
+        pthread_mutex_unlock(&group->idle_lock);
+    }
+}
+
+/** @brief Move everything in the inbox into the engine, oldest first. */
+static int crumbs_bus_drain(crumbs_bus_t *bus)
+{
+    crumbs_request_t *list = __atomic_exchange_n(&bus->inbox, NULL, __ATOMIC_ACQUIRE);
+    crumbs_request_t *fifo = NULL;
+    int n = 0;
+
+    while (list)
+    {
+        crumbs_request_t *next = list->next;
+        list->next = fifo;
+        fifo = list;
+        list = next;
+    }
+    while (fifo)
+    {
+        crumbs_request_t *next = fifo->next;
+        fifo->state = CRUMBS_REQ_IDLE;
+        (void)crumbs_engine_submit(&bus->eng, fifo); /* checked in claim */
+        fifo = next;
+        n++;
+    }
+    return n;
+}
+
+static void *crumbs_bus_worker(void *arg)
+{
+    crumbs_bus_t *bus = (crumbs_bus_t *)arg;
+    crumbs_bus_group_t *group = bus->group;
+    int in_engine = 0;
+
+    for (;;)
+    {
+        in_engine += crumbs_bus_drain(bus);
+
+        if (in_engine > 0)
+        {
+            int left = crumbs_engine_poll(&bus->eng, crumbs_bus_now_us());
+            if (left < in_engine)
+            {
+                uint32_t done = (uint32_t)(in_engine - left);
+                __atomic_add_fetch(&bus->completed, done, __ATOMIC_RELAXED);
+                crumbs_bus_retire(bus, done);
+            }
+            in_engine = left;
+        }
+
+        uint32_t idle = crumbs_engine_idle_us(&bus->eng, crumbs_bus_now_us());
+        if (idle == 0u)
+        {
+            continue;
+        }
+
+        pthread_mutex_lock(&bus->lock);
+        if (__atomic_load_n(&bus->inbox, __ATOMIC_ACQUIRE) == NULL)
+        {
+            if (__atomic_load_n(&group->stopping, __ATOMIC_SEQ_CST) &&
+                __atomic_load_n(&bus->pending, __ATOMIC_SEQ_CST) == 0u)
+            {
+                pthread_mutex_unlock(&bus->lock);
+                break;
+            }
+            if (idle == UINT32_MAX)
+            {
+                pthread_cond_wait(&bus->wake, &bus->lock);
+            }
+            else
+            {
+                struct timespec ts = crumbs_bus_deadline(idle);
+                (void)pthread_cond_timedwait(&bus->wake, &bus->lock, &ts);
+            }
+        }
+        pthread_mutex_unlock(&bus->lock);
+    }
+    return NULL;
+}
+
+/** @brief Validate @p req, mark it handed off and return its bus index. */
+static int crumbs_bus_group_claim(crumbs_bus_group_t *group, crumbs_request_t *req)
+{
+    /* The same checks as crumbs_engine_submit(): the worker cannot report a refusal. */
+    if (!req || !req->dev || !req->dev->ctx || !req->dev->write_fn ||
+        (!req->cmd && !req->dev->read_fn) || req->lane >= CRUMBS_ENGINE_LANES)
+    {
+        return -1;
+    }
+
+    int idx = -2;
+    for (uint8_t i = 0; i < group->count; i++)
+    {
+        if (group->buses[i].io == req->dev->io)
+        {
+            idx = (int)i;
+            break;
+        }
+    }
+    if (idx < 0)
+    {
+        return idx;
+    }
+
+    uint8_t expected = CRUMBS_REQ_IDLE;
+    if (!__atomic_compare_exchange_n(&req->state, &expected, (uint8_t)CRUMBS_REQ_HANDOFF,
+                                     0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+    {
+        return -1; /* already queued */
+    }
+    return idx;
+}
+
+/**
+ * @brief Publish a newest-first chain of @p n claimed requests on @p bus.
+ *
+ * The counters are raised before the stop flag is checked and the worker
+ * checks them after seeing the flag, so either the submit backs out or the
+ * worker waits for it.
+ */
+static int crumbs_bus_publish(crumbs_bus_t *bus, crumbs_request_t *first,
+                              crumbs_request_t *last, uint32_t n)
+{
+    crumbs_bus_group_t *group = bus->group;
+
+    __atomic_add_fetch(&group->outstanding, n, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&bus->pending, n, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&group->stopping, __ATOMIC_SEQ_CST))
+    {
+        for (crumbs_request_t *r = first; r; r = (r == last) ? NULL : r->next)
+        {
+            __atomic_store_n(&r->state, (uint8_t)CRUMBS_REQ_IDLE, __ATOMIC_RELEASE);
+        }
+        crumbs_bus_retire(bus, n);
+        crumbs_bus_wake(bus);
+        return -3;
+    }
+
+    crumbs_request_t *old = __atomic_load_n(&bus->inbox, __ATOMIC_RELAXED);
+    do
+    {
+        last->next = old;
+    } while (!__atomic_compare_exchange_n(&bus->inbox, &old, first, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    if (old == NULL)
+    {
+        crumbs_bus_wake(bus); /* the worker may be asleep on an empty inbox */
+    }
+    return 0;
+}
+
+static int crumbs_bus_group_accepting(const crumbs_bus_group_t *group)
+{
+    return __atomic_load_n(&group->running, __ATOMIC_ACQUIRE) &&
+           !__atomic_load_n(&group->stopping, __ATOMIC_SEQ_CST);
+}
+
+/* ---- Public API --------------------------------------------------------- */
+
+int crumbs_bus_group_init(crumbs_bus_group_t *group)
+{
+    if (!group)
+    {
+        return -1;
+    }
+
+    memset(group, 0, sizeof(*group));
+    if (pthread_mutex_init(&group->idle_lock, NULL) != 0)
+    {
+        return -1;
+    }
+    if (crumbs_bus_cond_init(&group->idle_cond) != 0)
+    {
+        pthread_mutex_destroy(&group->idle_lock);
+        return -1;
+    }
+    return 0;
+}
+
+int crumbs_bus_group_add_bus(crumbs_bus_group_t *group, void *io)
+{
+    if (!group || group->count >= CRUMBS_BUS_GROUP_MAX || __atomic_load_n(&group->running, __ATOMIC_ACQUIRE))
+    {
+        return -1;
+    }
+    for (uint8_t i = 0; i < group->count; i++)
+    {
+        if (group->buses[i].io == io)
+        {
+            return -1;
+        }
+    }
+
+    crumbs_bus_t *bus = &group->buses[group->count];
+    if (pthread_mutex_init(&bus->lock, NULL) != 0)
+    {
+        return -1;
+    }
+    if (crumbs_bus_cond_init(&bus->wake) != 0)
+    {
+        pthread_mutex_destroy(&bus->lock);
+        return -1;
+    }
+    bus->io = io;
+    bus->group = group;
+    return (int)group->count++;
+}
+
+int crumbs_bus_group_start(crumbs_bus_group_t *group)
+{
+    if (!group || group->count == 0u || __atomic_load_n(&group->running, __ATOMIC_ACQUIRE))
+    {
+        return -1;
+    }
+
+    __atomic_store_n(&group->stopping, 0u, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&group->outstanding, 0u, __ATOMIC_SEQ_CST);
+    for (uint8_t i = 0; i < group->count; i++)
+    {
+        crumbs_bus_t *bus = &group->buses[i];
+        crumbs_engine_init(&bus->eng);
+        bus->inbox = NULL;
+        bus->pending = 0u;
+        bus->completed = 0u;
+    }
+
+    for (uint8_t i = 0; i < group->count; i++)
+    {
+        if (pthread_create(&group->buses[i].thread, NULL, crumbs_bus_worker, &group->buses[i]) != 0)
+        {
+            CRUMBS_DBG("bus group: worker %u failed to start\n", i);
+            __atomic_store_n(&group->stopping, 1u, __ATOMIC_SEQ_CST);
+            for (uint8_t j = 0; j < i; j++)
+            {
+                crumbs_bus_wake(&group->buses[j]);
+                pthread_join(group->buses[j].thread, NULL);
+            }
+            __atomic_store_n(&group->stopping, 0u, __ATOMIC_SEQ_CST);
+            return -1;
+        }
+    }
+
+    __atomic_store_n(&group->running, 1u, __ATOMIC_RELEASE);
+    return 0;
+}
+
+int crumbs_bus_group_submit(crumbs_bus_group_t *group, crumbs_request_t *req)
+{
+    if (!group)
+    {
+        return -1;
+    }
+    if (!crumbs_bus_group_accepting(group))
+    {
+        return -3;
+    }
+
+    int idx = crumbs_bus_group_claim(group, req);
+    if (idx < 0)
+    {
+        return idx;
+    }
+    return crumbs_bus_publish(&group->buses[idx], req, req, 1u);
+}
+
+int crumbs_bus_group_submit_many(crumbs_bus_group_t *group, crumbs_request_t *reqs, size_t count)
+{
+    crumbs_request_t *first[CRUMBS_BUS_GROUP_MAX] = {NULL};
+    crumbs_request_t *last[CRUMBS_BUS_GROUP_MAX] = {NULL};
+    uint32_t n[CRUMBS_BUS_GROUP_MAX] = {0};
+
+    if (!group || (!reqs && count > 0u))
+    {
+        return -1;
+    }
+    if (!crumbs_bus_group_accepting(group))
+    {
+        return -3;
+    }
+
+    /* Build one newest-first chain per bus; the worker restores the order. */
+    for (size_t k = 0; k < count; k++)
+    {
+        crumbs_request_t *req = &reqs[k];
+        int idx = crumbs_bus_group_claim(group, req);
+        if (idx < 0)
+        {
+            continue;
+        }
+        req->next = first[idx];
+        first[idx] = req;
+        if (!last[idx])
+        {
+            last[idx] = req;
+        }
+        n[idx]++;
+    }
+
+    int queued = 0;
+    for (uint8_t i = 0; i < group->count; i++)
+    {
+        if (n[i] > 0u && crumbs_bus_publish(&group->buses[i], first[i], last[i], n[i]) == 0)
+        {
+            queued += (int)n[i];
+        }
+    }
+    return queued;
+}
+
+int crumbs_bus_group_wait(crumbs_bus_group_t *group, uint32_t timeout_us)
+{
+    if (!group)
+    {
+        return -1;
+    }
+
+    struct timespec ts = crumbs_bus_deadline(timeout_us);
+    int rc = 0;
+
+    pthread_mutex_lock(&group->idle_lock);
+    while (__atomic_load_n(&group->outstanding, __ATOMIC_SEQ_CST) != 0u)
+    {
+        if (timeout_us == 0u)
+        {
+            pthread_cond_wait(&group->idle_cond, &group->idle_lock);
+        }
+        else if (pthread_cond_timedwait(&group->idle_cond, &group->idle_lock, &ts) != 0 &&
+                 __atomic_load_n(&group->outstanding, __ATOMIC_SEQ_CST) != 0u)
+        {
+            rc = -3;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&group->idle_lock);
+    return rc;
+}
+
+uint32_t crumbs_bus_group_pending(const crumbs_bus_group_t *group, uint8_t bus)
+{
+    if (!group || bus >= group->count)
+    {
+        return 0u;
+    }
+    return __atomic_load_n(&group->buses[bus].pending, __ATOMIC_RELAXED);
+}
+
+void crumbs_bus_group_stop(crumbs_bus_group_t *group)
+{
+    if (!group || !__atomic_load_n(&group->running, __ATOMIC_ACQUIRE))
+    {
+        return;
+    }
+
+    __atomic_store_n(&group->stopping, 1u, __ATOMIC_SEQ_CST);
+    for (uint8_t i = 0; i < group->count; i++)
+    {
+        crumbs_bus_wake(&group->buses[i]);
+    }
+    for (uint8_t i = 0; i < group->count; i++)
+    {
+        pthread_join(group->buses[i].thread, NULL);
+    }
+    __atomic_store_n(&group->running, 0u, __ATOMIC_RELEASE);
+    __atomic_store_n(&group->stopping, 0u, __ATOMIC_SEQ_CST);
+}
+
+#endif /* defined(__linux__) */
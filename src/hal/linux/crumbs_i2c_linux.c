@@ -7,24 +7,67 @@
  * included in non-Linux builds.
  */
 
-/* Enable POSIX functions like clock_gettime on older glibc */
-#if !defined(_POSIX_C_SOURCE) || _POSIX_C_SOURCE < 199309L
+/* Enable POSIX functions like clock_gettime / clock_nanosleep on older glibc */
+#if !defined(_POSIX_C_SOURCE) || _POSIX_C_SOURCE < 200112L
 #undef _POSIX_C_SOURCE
-#define _POSIX_C_SOURCE 199309L
+#define _POSIX_C_SOURCE 200112L
 #endif
 
 #include "crumbs_linux.h"
 
 #include <string.h> /* memset */
 #include <errno.h>
-#include <time.h> /* clock_gettime, CLOCK_MONOTONIC */
+#include <time.h> /* clock_gettime, clock_nanosleep, CLOCK_MONOTONIC */
 
 #include "crumbs_crc.h" /* for CRUMBS_MESSAGE_MAX_SIZE, etc., via crumbs.h tree */
 
 #if defined(__linux__)
 
-#include <linux_wire.h> /* linux-wire C API */
-#include <unistd.h>     /* usleep */
+#include <linux_wire.h>    /* linux-wire C API */
+#include <stdio.h>         /* fopen, rename */
+#include <unistd.h>        /* usleep */
+#include <sys/ioctl.h>     /* ioctl */
+#include <linux/i2c.h>     /* struct i2c_msg, I2C_M_RD */
+#include <linux/i2c-dev.h> /* I2C_RDWR, I2C_RDWR_IOCTL_MAX_MSGS */
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+/** @brief Select @p addr with I2C_SLAVE unless it is already selected. */
+static int crumbs_linux_select(crumbs_linux_i2c_t *i2c, uint8_t addr)
+{
+    if (i2c->slave_addr == (int)addr)
+    {
+        i2c->slave_skipped++;
+        return 0;
+    }
+
+    if (lw_set_slave(&i2c->bus, addr) != 0)
+    {
+        i2c->slave_addr = -1;
+        return -1;
+    }
+
+    i2c->slave_addr = (int)addr;
+    return 0;
+}
+
+/** @brief Apply a non-zero timeout hint unless it is already in effect. */
+static void crumbs_linux_apply_timeout(crumbs_linux_i2c_t *i2c, uint32_t timeout_us)
+{
+    if (timeout_us == 0u)
+    {
+        return;
+    }
+
+    if (i2c->timeout_us == timeout_us)
+    {
+        i2c->timeout_skipped++;
+        return;
+    }
+
+    lw_set_timeout(&i2c->bus, timeout_us);
+    i2c->timeout_us = timeout_us;
+}
 
 /* ---- Public API -------------------------------------------------------- */
 
@@ -39,9 +82,15 @@ int crumbs_linux_init_controller(crumbs_context_t *ctx,
     }
 
     memset(i2c, 0, sizeof(*i2c));
+    i2c->slave_addr = -1;
+    if (strlen(device_path) < sizeof(i2c->device_path))
+    {
+        memcpy(i2c->device_path, device_path, strlen(device_path) + 1u);
+    }
 
     /* Initialize CRUMBS context as controller. Address unused in this role. */
     crumbs_init(ctx, CRUMBS_ROLE_CONTROLLER, 0u);
+    crumbs_set_transport(ctx, &crumbs_linux_transport, i2c);
 
     /* Open the Linux I2C bus. */
     if (lw_open_bus(&i2c->bus, device_path) != 0)
@@ -51,10 +100,7 @@ int crumbs_linux_init_controller(crumbs_context_t *ctx,
     }
 
     /* Optional timeout hint (informational in linux-wire). */
-    if (timeout_us > 0u)
-    {
-        lw_set_timeout(&i2c->bus, timeout_us);
-    }
+    crumbs_linux_apply_timeout(i2c, timeout_us);
 
     return 0;
 }
@@ -70,6 +116,27 @@ void crumbs_linux_close(crumbs_linux_i2c_t *i2c)
     memset(i2c, 0, sizeof(*i2c));
 }
 
+int crumbs_linux_recover(void *user_ctx)
+{
+    crumbs_linux_i2c_t *i2c = (crumbs_linux_i2c_t *)user_ctx;
+    if (!i2c || i2c->device_path[0] == '\0')
+    {
+        return -1;
+    }
+
+    uint32_t timeout_us = i2c->timeout_us;
+    lw_close_bus(&i2c->bus);
+    i2c->slave_addr = -1;
+    i2c->timeout_us = 0u;
+
+    if (lw_open_bus(&i2c->bus, i2c->device_path) != 0)
+    {
+        return -2;
+    }
+    crumbs_linux_apply_timeout(i2c, timeout_us);
+    return 0;
+}
+
 int crumbs_linux_i2c_write(void *user_ctx,
                            uint8_t target_addr,
                            const uint8_t *data,
@@ -89,7 +156,7 @@ int crumbs_linux_i2c_write(void *user_ctx,
     }
 
     /* Select the slave. */
-    if (lw_set_slave(bus, target_addr) != 0)
+    if (crumbs_linux_select(i2c, target_addr) != 0)
     {
         return -2;
     }
@@ -125,7 +192,7 @@ int crumbs_linux_read_message(crumbs_linux_i2c_t *i2c,
         return -1;
     }
 
-    if (lw_set_slave(bus, target_addr) != 0)
+    if (crumbs_linux_select(i2c, target_addr) != 0)
     {
         return -2;
     }
@@ -186,7 +253,7 @@ int crumbs_linux_scan(void *user_ctx,
     for (int addr = start_addr; addr <= end_addr; ++addr)
     {
         /* Select the slave address; skip if selection fails. */
-        if (lw_set_slave(bus, (uint8_t)addr) != 0)
+        if (crumbs_linux_select(i2c, (uint8_t)addr) != 0)
             continue;
 
         if (strict)
@@ -234,10 +301,9 @@ int crumbs_linux_read(void *user_ctx,
     if (bus->fd < 0)
         return -1;
 
-    if (timeout_us > 0u)
-        lw_set_timeout(bus, timeout_us);
+    crumbs_linux_apply_timeout(i2c, timeout_us);
 
-    if (lw_set_slave(bus, addr) != 0)
+    if (crumbs_linux_select(i2c, addr) != 0)
         return -2;
 
     size_t total = 0u;
@@ -271,8 +337,7 @@ int crumbs_linux_write_then_read(void *user_ctx,
     if (bus->fd < 0)
         return -1;
 
-    if (timeout_us > 0u)
-        lw_set_timeout(bus, timeout_us);
+    crumbs_linux_apply_timeout(i2c, timeout_us);
 
     /* Write-only path (no read phase requested). */
     if (rx_len == 0u)
@@ -280,7 +345,7 @@ int crumbs_linux_write_then_read(void *user_ctx,
         if (tx_len == 0u)
             return 0;
 
-        if (lw_set_slave(bus, addr) != 0)
+        if (crumbs_linux_select(i2c, addr) != 0)
             return -2;
 
         ssize_t w = lw_write(bus, tx, tx_len, 1);
@@ -301,7 +366,7 @@ int crumbs_linux_write_then_read(void *user_ctx,
 
     if (tx_len > 0u)
     {
-        if (lw_set_slave(bus, addr) != 0)
+        if (crumbs_linux_select(i2c, addr) != 0)
             return -2;
 
         ssize_t w = lw_write(bus, tx, tx_len, 1);
@@ -311,7 +376,7 @@ int crumbs_linux_write_then_read(void *user_ctx,
             return -4;
     }
 
-    if (lw_set_slave(bus, addr) != 0)
+    if (crumbs_linux_select(i2c, addr) != 0)
         return -2;
 
     size_t total = 0u;
@@ -328,6 +393,78 @@ int crumbs_linux_write_then_read(void *user_ctx,
     return (int)total;
 }
 
+/** @brief Messages one operation needs (one per non-empty phase). */
+static size_t crumbs_linux_xfer_msgs(const crumbs_linux_xfer_t *op)
+{
+    return (op->tx_len > 0u ? 1u : 0u) + (op->rx_len > 0u ? 1u : 0u);
+}
+
+int crumbs_linux_transfer_batch(crumbs_linux_i2c_t *i2c,
+                                crumbs_linux_xfer_t *ops,
+                                size_t count)
+{
+    if (!i2c || (!ops && count > 0u) || i2c->bus.fd < 0)
+        return -1;
+
+    for (size_t i = 0u; i < count; i++)
+    {
+        const crumbs_linux_xfer_t *op = &ops[i];
+        if ((op->tx_len > 0u && !op->tx) || (op->rx_len > 0u && !op->rx) ||
+            op->tx_len > 0xFFFFu || op->rx_len > 0xFFFFu)
+            return -1;
+    }
+
+    struct i2c_msg msgs[I2C_RDWR_IOCTL_MAX_MSGS];
+    size_t first = 0u;
+    while (first < count)
+    {
+        /* Pack whole operations until the next one would not fit. */
+        size_t nmsgs = 0u;
+        size_t end = first;
+        while (end < count &&
+               nmsgs + crumbs_linux_xfer_msgs(&ops[end]) <= I2C_RDWR_IOCTL_MAX_MSGS)
+        {
+            crumbs_linux_xfer_t *op = &ops[end];
+            if (op->tx_len > 0u)
+            {
+                msgs[nmsgs].addr = op->addr;
+                msgs[nmsgs].flags = 0;
+                msgs[nmsgs].len = (__u16)op->tx_len;
+                msgs[nmsgs].buf = (__u8 *)(uintptr_t)op->tx;
+                nmsgs++;
+            }
+            if (op->rx_len > 0u)
+            {
+                msgs[nmsgs].addr = op->addr;
+                msgs[nmsgs].flags = I2C_M_RD;
+                msgs[nmsgs].len = (__u16)op->rx_len;
+                msgs[nmsgs].buf = op->rx;
+                nmsgs++;
+            }
+            op->result = (int)op->rx_len;
+            end++;
+        }
+
+        if (nmsgs > 0u)
+        {
+            struct i2c_rdwr_ioctl_data data;
+            data.msgs = msgs;
+            data.nmsgs = (__u32)nmsgs;
+            if (ioctl(i2c->bus.fd, I2C_RDWR, &data) < 0)
+            {
+                for (size_t i = first; i < end; i++)
+                    ops[i].result = -3;
+                for (size_t i = end; i < count; i++)
+                    ops[i].result = -1;
+                return -3;
+            }
+        }
+        first = end;
+    }
+
+    return 0;
+}
+
 uint32_t crumbs_linux_millis(void)
 {
     struct timespec ts;
@@ -343,9 +480,20 @@ void crumbs_linux_delay_us(uint32_t us)
     struct timespec ts;
     if (us == 0)
         return;
-    ts.tv_sec  = (time_t)(us / 1000000U);
-    ts.tv_nsec = (long)((us % 1000000U) * 1000U);
-    nanosleep(&ts, NULL);
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+        return;
+
+    /* Absolute deadline: a signal restarts the sleep without stretching it. */
+    ts.tv_sec += (time_t)(us / 1000000U);
+    ts.tv_nsec += (long)((us % 1000000U) * 1000U);
+    if (ts.tv_nsec >= 1000000000L)
+    {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+    {
+    }
 }
 
 int crumbs_linux_scan_for_crumbs_with_types(crumbs_context_t *ctx,
@@ -393,6 +541,89 @@ int crumbs_linux_scan_for_crumbs(crumbs_context_t *ctx,
         found, NULL, max_found, timeout_us);
 }
 
+int crumbs_linux_scan_for_crumbs_fast(crumbs_context_t *ctx,
+                                      crumbs_linux_i2c_t *i2c,
+                                      uint8_t start_addr,
+                                      uint8_t end_addr,
+                                      int strict,
+                                      uint8_t *found,
+                                      uint8_t *types,
+                                      size_t max_found,
+                                      uint32_t timeout_us)
+{
+    if (!ctx || !i2c || !found)
+    {
+        return -1;
+    }
+
+    /* Same error-log suppression as the full scan. */
+    lw_set_error_logging(&i2c->bus, 0);
+
+    int count = crumbs_controller_scan_for_crumbs_fast(
+        ctx, start_addr, end_addr, strict,
+        crumbs_linux_scan, crumbs_linux_i2c_write, crumbs_linux_read,
+        crumbs_linux_write_then_read, (void *)i2c,
+        found, types, max_found, timeout_us);
+
+    lw_set_error_logging(&i2c->bus, 1);
+
+    return count;
+}
+
+/* ---- Registry cache files ---------------------------------------------- */
+
+int crumbs_linux_registry_save_file(const crumbs_registry_t *reg, const char *path)
+{
+    uint8_t blob[CRUMBS_REGISTRY_BLOB_MAX];
+    char tmp[256];
+
+    if (!reg || !path)
+        return -1;
+
+    size_t n = crumbs_registry_save(reg, blob, sizeof(blob));
+    if (n == 0u)
+        return -1;
+
+    int w = snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    if (w < 0 || (size_t)w >= sizeof(tmp))
+        return -1;
+
+    FILE *f = fopen(tmp, "wb");
+    if (!f)
+        return -1;
+    size_t put = fwrite(blob, 1u, n, f);
+    if (fclose(f) != 0 || put != n)
+    {
+        (void)remove(tmp);
+        return -1;
+    }
+    if (rename(tmp, path) != 0)
+    {
+        (void)remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+int crumbs_linux_registry_load_file(crumbs_registry_t *reg, const char *path)
+{
+    uint8_t blob[CRUMBS_REGISTRY_BLOB_MAX + 1u];
+
+    if (!reg)
+        return -1;
+    crumbs_registry_init(reg);
+    if (!path)
+        return -1;
+
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return -1;
+    /* Read one byte past the maximum so oversized files are rejected. */
+    size_t n = fread(blob, 1u, sizeof(blob), f);
+    (void)fclose(f);
+    return crumbs_registry_load(reg, blob, n);
+}
+
 #else /* non-Linux builds */
 
 /* Stubs for non-Linux builds (Arduino/embedded). They return errors so
@@ -418,6 +649,12 @@ void crumbs_linux_close(crumbs_linux_i2c_t *i2c)
     (void)i2c;
 }
 
+int crumbs_linux_recover(void *user_ctx)
+{
+    (void)user_ctx;
+    return -1; /* not supported on this platform */
+}
+
 int crumbs_linux_i2c_write(void *user_ctx,
                            uint8_t target_addr,
                            const uint8_t *data,
@@ -492,6 +729,16 @@ int crumbs_linux_write_then_read(void *user_ctx,
     return -1;
 }
 
+int crumbs_linux_transfer_batch(crumbs_linux_i2c_t *i2c,
+                                crumbs_linux_xfer_t *ops,
+                                size_t count)
+{
+    (void)i2c;
+    (void)ops;
+    (void)count;
+    return -1;
+}
+
 uint32_t crumbs_linux_millis(void)
 {
     /* No-op stub for non-Linux platforms */
@@ -546,4 +793,50 @@ int crumbs_linux_scan_for_crumbs(crumbs_context_t *ctx,
     return -1; /* not supported on this platform */
 }
 
+int crumbs_linux_scan_for_crumbs_fast(crumbs_context_t *ctx,
+                                      crumbs_linux_i2c_t *i2c,
+                                      uint8_t start_addr,
+                                      uint8_t end_addr,
+                                      int strict,
+                                      uint8_t *found,
+                                      uint8_t *types,
+                                      size_t max_found,
+                                      uint32_t timeout_us)
+{
+    (void)ctx;
+    (void)i2c;
+    (void)start_addr;
+    (void)end_addr;
+    (void)strict;
+    (void)found;
+    (void)types;
+    (void)max_found;
+    (void)timeout_us;
+    return -1; /* not supported on this platform */
+}
+
+int crumbs_linux_registry_save_file(const crumbs_registry_t *reg, const char *path)
+{
+    (void)reg;
+    (void)path;
+    return -1; /* not supported on this platform */
+}
+
+int crumbs_linux_registry_load_file(crumbs_registry_t *reg, const char *path)
+{
+    crumbs_registry_init(reg);
+    (void)path;
+    return -1; /* not supported on this platform */
+}
+
 #endif /* defined(__linux__) */
+
+/* Defined on every platform; the stubs above fail cleanly off Linux. */
+const crumbs_transport_t crumbs_linux_transport = {
+    "linux-i2c",
+    crumbs_linux_i2c_write,
+    crumbs_linux_read,
+    crumbs_linux_write_then_read,
+    CRUMBS_TRANSPORT_CAP_ADDRESSED | CRUMBS_TRANSPORT_CAP_TRANSACT | CRUMBS_TRANSPORT_CAP_BROADCAST,
+    CRUMBS_MESSAGE_MAX_SIZE,
+};
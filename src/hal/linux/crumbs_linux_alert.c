@@ -0,0 +1,166 @@
+/**
+ * @file
+ * @brief GPIO chardev attention line watcher (see crumbs_linux_alert.h).
+ */
+
+/* Ensure POSIX prototypes (O_CLOEXEC). */
+#if !defined(_POSIX_C_SOURCE) || _POSIX_C_SOURCE < 200809L
+#undef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "crumbs_linux_alert.h"
+
+#if defined(__linux__)
+
+#include "crumbs.h" /* CRUMBS_DBG */
+
+#include <errno.h>
+#include <fcntl.h>       /* open, fcntl */
+#include <linux/gpio.h>  /* GPIO uAPI v2 */
+#include <poll.h>        /* poll */
+#include <string.h>      /* memset, strncpy */
+#include <sys/ioctl.h>   /* ioctl */
+#include <unistd.h>      /* read, close */
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+static int crumbs_linux_alert_request(int chip_fd, unsigned line, uint64_t flags)
+{
+    struct gpio_v2_line_request req;
+
+    memset(&req, 0, sizeof(req));
+    req.offsets[0] = line;
+    req.num_lines = 1u;
+    strncpy(req.consumer, "crumbs-alert", sizeof(req.consumer) - 1u);
+    req.config.flags = flags;
+    if (ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &req) < 0)
+    {
+        return -1;
+    }
+    return req.fd;
+}
+
+/** @brief Read every queued edge event. */
+static void crumbs_linux_alert_drain(crumbs_linux_alert_t *alert)
+{
+    struct gpio_v2_line_event ev[8];
+
+    for (;;)
+    {
+        ssize_t n = read(alert->fd, ev, sizeof(ev));
+        if (n < (ssize_t)sizeof(ev[0]))
+        {
+            return; /* EAGAIN once the queue is empty */
+        }
+        size_t count = (size_t)n / sizeof(ev[0]);
+        alert->events += (uint32_t)count;
+        alert->last_event_us = (uint32_t)(ev[count - 1u].timestamp_ns / 1000u);
+    }
+}
+
+/* ---- Public API --------------------------------------------------------- */
+
+int crumbs_linux_alert_open(crumbs_linux_alert_t *alert, const char *chip_path, unsigned line)
+{
+    if (!alert || !chip_path)
+    {
+        return -1;
+    }
+
+    alert->fd = -1;
+    alert->events = 0u;
+    alert->last_event_us = 0u;
+
+    int chip_fd = open(chip_path, O_RDONLY | O_CLOEXEC);
+    if (chip_fd < 0)
+    {
+        CRUMBS_DBG("alert: cannot open %s (errno %d)\n", chip_path, errno);
+        return -1;
+    }
+
+    /* ALERT# is active low; "rising" is the logical assert edge. */
+    const uint64_t flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_ACTIVE_LOW |
+                           GPIO_V2_LINE_FLAG_EDGE_RISING;
+    int fd = crumbs_linux_alert_request(chip_fd, line, flags | GPIO_V2_LINE_FLAG_BIAS_PULL_UP);
+    if (fd < 0)
+    {
+        fd = crumbs_linux_alert_request(chip_fd, line, flags);
+    }
+    close(chip_fd);
+    if (fd < 0)
+    {
+        CRUMBS_DBG("alert: cannot request line %u (errno %d)\n", line, errno);
+        return -1;
+    }
+
+    int fl = fcntl(fd, F_GETFL);
+    if (fl < 0 || fcntl(fd, F_SETFL, fl | O_NONBLOCK) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    alert->fd = fd;
+    return 0;
+}
+
+int crumbs_linux_alert_fd(const crumbs_linux_alert_t *alert)
+{
+    return alert ? alert->fd : -1;
+}
+
+int crumbs_linux_alert_asserted(const crumbs_linux_alert_t *alert)
+{
+    struct gpio_v2_line_values values;
+
+    if (!alert || alert->fd < 0)
+    {
+        return -1;
+    }
+    memset(&values, 0, sizeof(values));
+    values.mask = 1u;
+    if (ioctl(alert->fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &values) < 0)
+    {
+        return -1;
+    }
+    return (values.bits & 1u) ? 1 : 0;
+}
+
+int crumbs_linux_alert_wait(crumbs_linux_alert_t *alert, uint32_t timeout_us)
+{
+    int level = crumbs_linux_alert_asserted(alert);
+    if (level != 0)
+    {
+        if (level > 0)
+        {
+            crumbs_linux_alert_drain(alert);
+        }
+        return level;
+    }
+
+    struct pollfd pfd = {alert->fd, POLLIN, 0};
+    int timeout_ms = timeout_us == UINT32_MAX ? -1 : (int)((timeout_us + 999u) / 1000u);
+    int rc = poll(&pfd, 1, timeout_ms);
+    if (rc < 0)
+    {
+        return errno == EINTR ? 0 : -1;
+    }
+    if (rc == 0)
+    {
+        return 0;
+    }
+
+    crumbs_linux_alert_drain(alert);
+    return crumbs_linux_alert_asserted(alert);
+}
+
+void crumbs_linux_alert_close(crumbs_linux_alert_t *alert)
+{
+    if (alert && alert->fd >= 0)
+    {
+        close(alert->fd);
+        alert->fd = -1;
+    }
+}
+
+#endif /* defined(__linux__) */
@@ -0,0 +1,173 @@
+/**
+ * @file
+ * @brief Capture file sink and mapping (see crumbs_linux_capture.h).
+ */
+
+/* O_CLOEXEC. */
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+#include "crumbs_linux_capture.h"
+
+#if defined(__linux__)
+
+#include <errno.h>
+#include <fcntl.h>    /* open */
+#include <string.h>   /* memset */
+#include <sys/mman.h> /* mmap, munmap */
+#include <sys/stat.h> /* fstat */
+#include <unistd.h>   /* read, write, close */
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+static int crumbs_linux_capture_write_all(int fd, const uint8_t *buf, size_t len)
+{
+    /* O_APPEND puts a single write() at the end in one piece. */
+    for (;;)
+    {
+        ssize_t n = write(fd, buf, len);
+        if (n == (ssize_t)len)
+        {
+            return 0;
+        }
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        return -1;
+    }
+}
+
+/* ---- Public API -------------------------------------------------------- */
+
+int crumbs_linux_capture_open(crumbs_linux_capture_t *f, const char *path)
+{
+    uint8_t hdr[CRUMBS_CAPTURE_HEADER_SIZE];
+    struct stat st;
+
+    if (!f)
+    {
+        return -1;
+    }
+    f->fd = -1;
+    f->written = 0u;
+    if (!path || path[0] == '\0')
+    {
+        return -1;
+    }
+
+    int fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        CRUMBS_DBG("capture: open %s failed (errno %d)\n", path, errno);
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return -2;
+    }
+
+    if (st.st_size == 0)
+    {
+        crumbs_capture_header(hdr);
+        if (crumbs_linux_capture_write_all(fd, hdr, sizeof(hdr)) != 0)
+        {
+            close(fd);
+            return -2;
+        }
+    }
+    else if (pread(fd, hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr) ||
+             crumbs_capture_check_header(hdr, sizeof(hdr)) != 0)
+    {
+        close(fd);
+        return -3;
+    }
+
+    f->fd = fd;
+    return 0;
+}
+
+int crumbs_linux_capture_sink(void *user, const uint8_t *record)
+{
+    crumbs_linux_capture_t *f = (crumbs_linux_capture_t *)user;
+
+    if (!f || f->fd < 0 || !record ||
+        crumbs_linux_capture_write_all(f->fd, record, CRUMBS_CAPTURE_RECORD_SIZE) != 0)
+    {
+        return -1;
+    }
+    f->written++;
+    return 0;
+}
+
+void crumbs_linux_capture_close(crumbs_linux_capture_t *f)
+{
+    if (!f || f->fd < 0)
+    {
+        return;
+    }
+    close(f->fd);
+    f->fd = -1;
+}
+
+int crumbs_linux_capture_map(crumbs_linux_capture_map_t *m, const char *path)
+{
+    struct stat st;
+    void *base;
+
+    if (!m)
+    {
+        return -1;
+    }
+    memset(m, 0, sizeof(*m));
+    if (!path || path[0] == '\0')
+    {
+        return -1;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return -2;
+    }
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return -2;
+    }
+    if ((size_t)st.st_size < CRUMBS_CAPTURE_HEADER_SIZE)
+    {
+        close(fd);
+        return -3;
+    }
+    base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        return -2;
+    }
+    if (crumbs_capture_check_header((const uint8_t *)base, (size_t)st.st_size) != 0)
+    {
+        munmap(base, (size_t)st.st_size);
+        return -3;
+    }
+
+    m->base = base;
+    m->size = (size_t)st.st_size;
+    m->records = (const uint8_t *)base + CRUMBS_CAPTURE_HEADER_SIZE;
+    m->count = (m->size - CRUMBS_CAPTURE_HEADER_SIZE) / CRUMBS_CAPTURE_RECORD_SIZE;
+    return 0;
+}
+
+void crumbs_linux_capture_unmap(crumbs_linux_capture_map_t *m)
+{
+    if (!m || !m->base)
+    {
+        return;
+    }
+    munmap(m->base, m->size);
+    memset(m, 0, sizeof(*m));
+}
+
+#endif /* defined(__linux__) */
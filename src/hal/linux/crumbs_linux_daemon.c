@@ -0,0 +1,509 @@
+/**
+ * @file
+ * @brief crumbsd server: bus ownership, GET coalescing, reply cache (see crumbs_linux_daemon.h).
+ */
+
+/* accept4(), SOCK_CLOEXEC. */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "crumbs_linux_daemon.h"
+
+#if defined(__linux__)
+
+#include <errno.h>
+#include <poll.h>       /* poll */
+#include <string.h>     /* memset, memcpy, memcmp, strlen */
+#include <sys/socket.h> /* socket, bind, listen, accept4, recv, send */
+#include <sys/un.h>     /* struct sockaddr_un */
+#include <unistd.h>     /* close, unlink */
+
+#include "crumbs_linux_loop.h" /* crumbs_linux_loop_now_us */
+
+#define CRUMBS_DAEMON_STATS_WORDS (sizeof(crumbs_daemon_stats_t) / sizeof(uint32_t))
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+static uint32_t crumbs_daemon_now(const crumbs_daemon_t *d)
+{
+    return d->clock ? d->clock() : crumbs_linux_loop_now_us();
+}
+
+static void crumbs_daemon_put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t crumbs_daemon_get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+/** @brief [type][0xFE][1][opcode][crc]: the frame that selects a reply. */
+static int crumbs_daemon_is_set_reply(const uint8_t *tx, size_t len)
+{
+    return len == 5u && tx[1] == CRUMBS_CMD_SET_REPLY && tx[2] == 1u;
+}
+
+static int crumbs_daemon_same_key(const crumbs_daemon_slot_t *s, const uint8_t *tx, size_t len)
+{
+    return s->key_len == len && memcmp(s->key, tx, len) == 0;
+}
+
+static int crumbs_daemon_cache_fresh(const crumbs_daemon_t *d, const crumbs_daemon_slot_t *s,
+                                     uint32_t now)
+{
+    return d->cache_ttl_us != 0u && s->cache_len > 0u &&
+           (uint32_t)(now - s->cached_us) < d->cache_ttl_us;
+}
+
+/** @brief Another client's read is still due on @p s; drops the selection once it has expired. */
+static int crumbs_daemon_held_by_others(crumbs_daemon_t *d, crumbs_daemon_slot_t *s,
+                                        uint32_t bit, uint32_t now)
+{
+    if ((s->holders & ~bit) == 0u)
+    {
+        return 0;
+    }
+    if ((uint32_t)(now - s->selected_us) >= d->select_timeout_us)
+    {
+        s->holders = 0u;
+        d->stats.expired++;
+        return 0;
+    }
+    return 1;
+}
+
+static void crumbs_daemon_store(crumbs_daemon_slot_t *s, const uint8_t *rx, int n,
+                                size_t asked, uint32_t now)
+{
+    if (s->key_len == 0u || n <= 0 || (size_t)n > sizeof(s->cache))
+    {
+        s->cache_len = 0u;
+        return;
+    }
+    memcpy(s->cache, rx, (size_t)n);
+    s->cache_len = (uint8_t)n;
+    s->cache_req = (uint8_t)asked;
+    s->cached_us = now;
+}
+
+/** @brief Copy a cached reply for a read of @p asked bytes; -1 if the cache cannot answer it. */
+static int crumbs_daemon_from_cache(crumbs_daemon_t *d, const crumbs_daemon_slot_t *s,
+                                    uint8_t *rx, size_t asked, uint32_t now)
+{
+    size_t n;
+
+    if (!crumbs_daemon_cache_fresh(d, s, now) || asked > s->cache_req)
+    {
+        return -1;
+    }
+    n = (asked < s->cache_len) ? asked : s->cache_len;
+    memcpy(rx, s->cache, n);
+    d->stats.cache_hits++;
+    return (int)n;
+}
+
+static void crumbs_daemon_respond(int fd, int32_t status, const uint8_t *data, size_t len)
+{
+    uint8_t out[4u + CRUMBS_DAEMON_MAX_XFER];
+
+    crumbs_daemon_put_u32(out, (uint32_t)status);
+    if (len > 0u)
+    {
+        memcpy(&out[4], data, len);
+    }
+    (void)send(fd, out, 4u + len, MSG_NOSIGNAL);
+}
+
+static void crumbs_daemon_drop(crumbs_daemon_t *d, int i)
+{
+    uint32_t bit = 1u << i;
+
+    close(d->conns[i].fd);
+    d->conns[i].fd = -1;
+    d->conns[i].pending = 0u;
+    for (size_t a = 0; a < sizeof(d->slots) / sizeof(d->slots[0]); a++)
+    {
+        d->slots[a].holders &= ~bit;
+    }
+    d->stats.clients--;
+}
+
+/** @brief Answer client @p i's request; returns 1 (nothing sent) if it must wait. */
+static int crumbs_daemon_serve(crumbs_daemon_t *d, int i)
+{
+    crumbs_daemon_conn_t *c = &d->conns[i];
+    const crumbs_transport_t *bus = d->bus;
+    uint8_t op = c->req[0];
+    uint8_t addr = (uint8_t)(c->req[1] & 0x7Fu);
+    uint8_t flags = c->req[2];
+    size_t rx_len = c->req[3];
+    uint32_t timeout_us = crumbs_daemon_get_u32(&c->req[4]);
+    const uint8_t *tx = &c->req[CRUMBS_DAEMON_HEADER_LEN];
+    size_t tx_len = (size_t)c->req_len - CRUMBS_DAEMON_HEADER_LEN;
+    crumbs_daemon_slot_t *s = &d->slots[addr];
+    uint32_t bit = 1u << i;
+    uint32_t now = crumbs_daemon_now(d);
+    uint8_t rx[CRUMBS_DAEMON_MAX_XFER];
+    int rc = -1;
+
+    switch (op)
+    {
+    case CRUMBS_DAEMON_OP_WRITE:
+        if (!crumbs_daemon_is_set_reply(tx, tx_len))
+        {
+            /* A command can change what the device would report. */
+            rc = bus->send(d->bus_io, addr, tx, tx_len);
+            d->stats.transfers++;
+            s->cache_len = 0u;
+            break;
+        }
+        if (crumbs_daemon_same_key(s, tx, tx_len) &&
+            (s->holders != 0u || crumbs_daemon_cache_fresh(d, s, now)))
+        {
+            /* Already selected on the device: share the pending read. */
+            if (!(s->holders & bit))
+            {
+                d->stats.coalesced++;
+            }
+            s->holders |= bit;
+            rc = 0;
+            break;
+        }
+        if (crumbs_daemon_held_by_others(d, s, bit, now))
+        {
+            return 1;
+        }
+        rc = bus->send(d->bus_io, addr, tx, tx_len);
+        d->stats.transfers++;
+        s->cache_len = 0u;
+        s->key_len = 0u;
+        s->holders = 0u;
+        if (rc == 0)
+        {
+            memcpy(s->key, tx, tx_len);
+            s->key_len = (uint8_t)tx_len;
+            s->holders = bit;
+            s->selected_us = now;
+        }
+        break;
+
+    case CRUMBS_DAEMON_OP_READ:
+        if (!bus->receive)
+        {
+            break;
+        }
+        if (s->holders & bit)
+        {
+            s->holders &= ~bit;
+            rc = crumbs_daemon_from_cache(d, s, rx, rx_len, now);
+            if (rc < 0)
+            {
+                rc = bus->receive(d->bus_io, addr, rx, rx_len, timeout_us);
+                d->stats.transfers++;
+                crumbs_daemon_store(s, rx, rc, rx_len, now);
+            }
+            break;
+        }
+        rc = bus->receive(d->bus_io, addr, rx, rx_len, timeout_us);
+        d->stats.transfers++;
+        break;
+
+    case CRUMBS_DAEMON_OP_WRITE_READ:
+        if (!bus->transact)
+        {
+            rc = CRUMBS_I2C_DEV_E_NO_REPEATED_START;
+            break;
+        }
+        if (!crumbs_daemon_is_set_reply(tx, tx_len))
+        {
+            rc = bus->transact(d->bus_io, addr, tx, tx_len, rx, rx_len, timeout_us, flags & 1u);
+            d->stats.transfers++;
+            s->cache_len = 0u;
+            break;
+        }
+        if (crumbs_daemon_same_key(s, tx, tx_len))
+        {
+            rc = crumbs_daemon_from_cache(d, s, rx, rx_len, now);
+            if (rc >= 0)
+            {
+                break;
+            }
+        }
+        else if (crumbs_daemon_held_by_others(d, s, bit, now))
+        {
+            return 1;
+        }
+        rc = bus->transact(d->bus_io, addr, tx, tx_len, rx, rx_len, timeout_us, flags & 1u);
+        d->stats.transfers++;
+        if (!crumbs_daemon_same_key(s, tx, tx_len))
+        {
+            memcpy(s->key, tx, tx_len);
+            s->key_len = (uint8_t)tx_len;
+            s->holders = 0u;
+        }
+        /* Clients that joined this selection read the fresh reply. */
+        crumbs_daemon_store(s, rx, rc, rx_len, now);
+        break;
+
+    case CRUMBS_DAEMON_OP_STATS:
+        for (size_t w = 0; w < CRUMBS_DAEMON_STATS_WORDS; w++)
+        {
+            crumbs_daemon_put_u32(&rx[w * 4u], ((const uint32_t *)&d->stats)[w]);
+        }
+        rc = (int)(CRUMBS_DAEMON_STATS_WORDS * 4u);
+        break;
+
+    default:
+        break;
+    }
+
+    d->stats.requests++;
+    c->pending = 0u;
+    if (op == CRUMBS_DAEMON_OP_WRITE || rc <= 0)
+    {
+        crumbs_daemon_respond(c->fd, rc, NULL, 0u);
+    }
+    else
+    {
+        crumbs_daemon_respond(c->fd, rc, rx, ((size_t)rc < sizeof(rx)) ? (size_t)rc : sizeof(rx));
+    }
+    return 0;
+}
+
+/** @brief Serve pending requests oldest first until only held-back ones remain. */
+static int crumbs_daemon_run(crumbs_daemon_t *d)
+{
+    uint8_t tried[CRUMBS_DAEMON_MAX_CLIENTS];
+    int served = 0;
+
+    memset(tried, 0, sizeof(tried));
+    for (;;)
+    {
+        int best = -1;
+        for (int i = 0; i < CRUMBS_DAEMON_MAX_CLIENTS; i++)
+        {
+            const crumbs_daemon_conn_t *c = &d->conns[i];
+            if (c->fd >= 0 && c->pending && !tried[i] &&
+                (best < 0 || (int32_t)(c->seq - d->conns[best].seq) < 0))
+            {
+                best = i;
+            }
+        }
+        if (best < 0)
+        {
+            return served;
+        }
+        if (crumbs_daemon_serve(d, best) == 0)
+        {
+            /* A read may have released a selection others are waiting on. */
+            served++;
+            memset(tried, 0, sizeof(tried));
+        }
+        else
+        {
+            if (!d->conns[best].waited)
+            {
+                d->conns[best].waited = 1u;
+                d->stats.waits++;
+            }
+            tried[best] = 1u;
+        }
+    }
+}
+
+static void crumbs_daemon_accept(crumbs_daemon_t *d)
+{
+    for (;;)
+    {
+        int fd = accept4(d->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        int i;
+
+        if (fd < 0)
+        {
+            return;
+        }
+        for (i = 0; i < CRUMBS_DAEMON_MAX_CLIENTS; i++)
+        {
+            if (d->conns[i].fd < 0)
+            {
+                break;
+            }
+        }
+        if (i == CRUMBS_DAEMON_MAX_CLIENTS)
+        {
+            CRUMBS_DBG("crumbsd: client limit reached\n");
+            close(fd);
+            continue;
+        }
+        memset(&d->conns[i], 0, sizeof(d->conns[i]));
+        d->conns[i].fd = fd;
+        d->stats.clients++;
+    }
+}
+
+static void crumbs_daemon_receive(crumbs_daemon_t *d, int i)
+{
+    crumbs_daemon_conn_t *c = &d->conns[i];
+    ssize_t n = recv(c->fd, c->req, sizeof(c->req), MSG_DONTWAIT);
+
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+    {
+        crumbs_daemon_drop(d, i);
+        return;
+    }
+    if (n < 0)
+    {
+        return;
+    }
+    if ((size_t)n < CRUMBS_DAEMON_HEADER_LEN)
+    {
+        crumbs_daemon_respond(c->fd, -1, NULL, 0u);
+        return;
+    }
+    c->req_len = (uint16_t)n;
+    c->pending = 1u;
+    c->waited = 0u;
+    c->seq = d->next_seq++;
+}
+
+/* ---- Public API -------------------------------------------------------- */
+
+int crumbs_daemon_init(crumbs_daemon_t *d, const char *socket_path,
+                       const crumbs_transport_t *bus, void *bus_io)
+{
+    struct sockaddr_un sa;
+    size_t len;
+
+    if (!d)
+    {
+        return -1;
+    }
+    memset(d, 0, sizeof(*d));
+    d->listen_fd = -1;
+    for (int i = 0; i < CRUMBS_DAEMON_MAX_CLIENTS; i++)
+    {
+        d->conns[i].fd = -1;
+    }
+    if (!socket_path || !bus || !bus->send)
+    {
+        return -1;
+    }
+    len = strlen(socket_path);
+    if (len == 0u || len >= sizeof(sa.sun_path) || len >= sizeof(d->path))
+    {
+        return -1;
+    }
+
+    d->bus = bus;
+    d->bus_io = bus_io;
+    d->cache_ttl_us = CRUMBS_DAEMON_CACHE_TTL_US;
+    d->select_timeout_us = CRUMBS_DAEMON_SELECT_TIMEOUT_US;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    memcpy(sa.sun_path, socket_path, len);
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0)
+    {
+        return -2;
+    }
+    (void)unlink(socket_path);
+    if (bind(fd, (const struct sockaddr *)&sa, sizeof(sa)) != 0 ||
+        listen(fd, CRUMBS_DAEMON_MAX_CLIENTS) != 0)
+    {
+        CRUMBS_DBG("crumbsd: cannot listen on %s (errno %d)\n", socket_path, errno);
+        close(fd);
+        return -2;
+    }
+
+    memcpy(d->path, socket_path, len + 1u);
+    d->listen_fd = fd;
+    return 0;
+}
+
+int crumbs_daemon_poll(crumbs_daemon_t *d, int timeout_ms)
+{
+    struct pollfd pfd[1 + CRUMBS_DAEMON_MAX_CLIENTS];
+    int who[1 + CRUMBS_DAEMON_MAX_CLIENTS];
+    nfds_t nfds = 1u;
+    int held = 0;
+
+    if (!d || d->listen_fd < 0)
+    {
+        return -1;
+    }
+
+    pfd[0].fd = d->listen_fd;
+    pfd[0].events = POLLIN;
+    pfd[0].revents = 0;
+    for (int i = 0; i < CRUMBS_DAEMON_MAX_CLIENTS; i++)
+    {
+        if (d->conns[i].fd < 0)
+        {
+            continue;
+        }
+        /* One request in flight per client; still watch for hang-ups. */
+        pfd[nfds].fd = d->conns[i].fd;
+        pfd[nfds].events = d->conns[i].pending ? 0 : POLLIN;
+        pfd[nfds].revents = 0;
+        who[nfds] = i;
+        nfds++;
+        held |= d->conns[i].pending;
+    }
+    if (held && (timeout_ms < 0 || timeout_ms > 1))
+    {
+        timeout_ms = 1;
+    }
+
+    if (poll(pfd, nfds, timeout_ms) > 0)
+    {
+        if (pfd[0].revents & POLLIN)
+        {
+            crumbs_daemon_accept(d);
+        }
+        for (nfds_t k = 1u; k < nfds; k++)
+        {
+            if (pfd[k].revents & POLLIN)
+            {
+                crumbs_daemon_receive(d, who[k]);
+            }
+            else if (pfd[k].revents & (POLLHUP | POLLERR))
+            {
+                crumbs_daemon_drop(d, who[k]);
+            }
+        }
+    }
+
+    return crumbs_daemon_run(d);
+}
+
+void crumbs_daemon_close(crumbs_daemon_t *d)
+{
+    if (!d)
+    {
+        return;
+    }
+    for (int i = 0; i < CRUMBS_DAEMON_MAX_CLIENTS; i++)
+    {
+        if (d->conns[i].fd >= 0)
+        {
+            crumbs_daemon_drop(d, i);
+        }
+    }
+    if (d->listen_fd >= 0)
+    {
+        close(d->listen_fd);
+        d->listen_fd = -1;
+        (void)unlink(d->path);
+    }
+}
+
+#endif /* defined(__linux__) */
@@ -0,0 +1,213 @@
+/**
+ * @file
+ * @brief crumbsd client: crumbs_i2c_*_fn callbacks over the daemon socket (see crumbs_linux_daemon.h).
+ */
+
+/* SOCK_CLOEXEC. */
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+#include "crumbs_linux_daemon.h"
+
+#if defined(__linux__)
+
+#include <errno.h>
+#include <poll.h>       /* poll */
+#include <string.h>     /* memset, memcpy, strlen */
+#include <sys/socket.h> /* socket, connect, send, recv */
+#include <sys/un.h>     /* struct sockaddr_un */
+#include <unistd.h>     /* close */
+
+#define CRUMBS_DAEMON_STATS_WORDS (sizeof(crumbs_daemon_stats_t) / sizeof(uint32_t))
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+/** @brief One request and its response; returns the daemon's status. */
+static int crumbs_daemon_call(crumbs_daemon_client_t *c, uint8_t op, uint8_t addr,
+                              uint8_t flags, const uint8_t *tx, size_t tx_len,
+                              uint8_t *rx, size_t rx_len, uint32_t timeout_us)
+{
+    uint8_t req[CRUMBS_DAEMON_HEADER_LEN + CRUMBS_DAEMON_MAX_XFER];
+    uint8_t resp[4u + CRUMBS_DAEMON_MAX_XFER];
+    struct pollfd pfd;
+    ssize_t n;
+    int rc;
+
+    if (!c || c->fd < 0 || tx_len > CRUMBS_DAEMON_MAX_XFER || rx_len > CRUMBS_DAEMON_MAX_XFER ||
+        (tx_len > 0u && !tx) || (rx_len > 0u && !rx))
+    {
+        return -1;
+    }
+
+    req[0] = op;
+    req[1] = addr;
+    req[2] = flags;
+    req[3] = (uint8_t)rx_len;
+    req[4] = (uint8_t)timeout_us;
+    req[5] = (uint8_t)(timeout_us >> 8);
+    req[6] = (uint8_t)(timeout_us >> 16);
+    req[7] = (uint8_t)(timeout_us >> 24);
+    if (tx_len > 0u)
+    {
+        memcpy(&req[CRUMBS_DAEMON_HEADER_LEN], tx, tx_len);
+    }
+    if (send(c->fd, req, CRUMBS_DAEMON_HEADER_LEN + tx_len, MSG_NOSIGNAL) < 0)
+    {
+        return -1;
+    }
+
+    pfd.fd = c->fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    do
+    {
+        rc = poll(&pfd, 1, CRUMBS_DAEMON_CLIENT_TIMEOUT_MS);
+    } while (rc < 0 && errno == EINTR);
+    n = (rc > 0) ? recv(c->fd, resp, sizeof(resp), 0) : -1;
+    if (n < 4)
+    {
+        /* A late response would be taken for the next one; start over. */
+        CRUMBS_DBG("crumbsd client: no response (op %u)\n", (unsigned)op);
+        crumbs_daemon_disconnect(c);
+        return -1;
+    }
+
+    rc = (int)(int32_t)((uint32_t)resp[0] | ((uint32_t)resp[1] << 8) |
+                        ((uint32_t)resp[2] << 16) | ((uint32_t)resp[3] << 24));
+    n -= 4;
+    if ((size_t)n > rx_len)
+    {
+        n = (ssize_t)rx_len;
+    }
+    if (n > 0)
+    {
+        memcpy(rx, &resp[4], (size_t)n);
+    }
+    return rc;
+}
+
+/* ---- Public API -------------------------------------------------------- */
+
+int crumbs_daemon_connect(crumbs_daemon_client_t *c, const char *socket_path)
+{
+    struct sockaddr_un sa;
+    size_t len;
+
+    if (!c)
+    {
+        return -1;
+    }
+    c->fd = -1;
+    if (!socket_path)
+    {
+        return -1;
+    }
+    len = strlen(socket_path);
+    if (len == 0u || len >= sizeof(sa.sun_path))
+    {
+        return -1;
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    memcpy(sa.sun_path, socket_path, len);
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return -2;
+    }
+    if (connect(fd, (const struct sockaddr *)&sa, sizeof(sa)) != 0)
+    {
+        CRUMBS_DBG("crumbsd client: connect %s failed (errno %d)\n", socket_path, errno);
+        close(fd);
+        return -2;
+    }
+    c->fd = fd;
+    return 0;
+}
+
+void crumbs_daemon_disconnect(crumbs_daemon_client_t *c)
+{
+    if (!c || c->fd < 0)
+    {
+        return;
+    }
+    close(c->fd);
+    c->fd = -1;
+}
+
+int crumbs_daemon_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    return crumbs_daemon_call((crumbs_daemon_client_t *)user_ctx, CRUMBS_DAEMON_OP_WRITE, addr,
+                              0u, data, len, NULL, 0u, 0u);
+}
+
+int crumbs_daemon_read(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len,
+                       uint32_t timeout_us)
+{
+    return crumbs_daemon_call((crumbs_daemon_client_t *)user_ctx, CRUMBS_DAEMON_OP_READ, addr,
+                              0u, NULL, 0u, buffer, len, timeout_us);
+}
+
+int crumbs_daemon_write_read(void *user_ctx, uint8_t addr, const uint8_t *tx, size_t tx_len,
+                             uint8_t *rx, size_t rx_len, uint32_t timeout_us,
+                             int require_repeated_start)
+{
+    return crumbs_daemon_call((crumbs_daemon_client_t *)user_ctx, CRUMBS_DAEMON_OP_WRITE_READ,
+                              addr, require_repeated_start ? 1u : 0u, tx, tx_len, rx, rx_len,
+                              timeout_us);
+}
+
+const crumbs_transport_t crumbs_daemon_transport = {
+    "crumbsd",
+    crumbs_daemon_write,
+    crumbs_daemon_read,
+    crumbs_daemon_write_read,
+    CRUMBS_TRANSPORT_CAP_ADDRESSED | CRUMBS_TRANSPORT_CAP_TRANSACT | CRUMBS_TRANSPORT_CAP_BROADCAST,
+    CRUMBS_MESSAGE_MAX_SIZE,
+};
+
+int crumbs_daemon_init_controller(crumbs_context_t *ctx, crumbs_daemon_client_t *c,
+                                  const char *socket_path)
+{
+    if (!ctx || !c)
+    {
+        return -1;
+    }
+
+    crumbs_init(ctx, CRUMBS_ROLE_CONTROLLER, 0u);
+    int rc = crumbs_daemon_connect(c, socket_path);
+    if (rc != 0)
+    {
+        return rc;
+    }
+    crumbs_set_transport(ctx, &crumbs_daemon_transport, c);
+    return 0;
+}
+
+int crumbs_daemon_get_stats(crumbs_daemon_client_t *c, crumbs_daemon_stats_t *out)
+{
+    uint8_t raw[CRUMBS_DAEMON_STATS_WORDS * 4u];
+    uint32_t *words = (uint32_t *)out;
+
+    if (!out)
+    {
+        return -1;
+    }
+    int rc = crumbs_daemon_call(c, CRUMBS_DAEMON_OP_STATS, 0u, 0u, NULL, 0u, raw, sizeof(raw), 0u);
+    if (rc != (int)sizeof(raw))
+    {
+        return (rc < 0) ? rc : -1;
+    }
+    for (size_t w = 0; w < CRUMBS_DAEMON_STATS_WORDS; w++)
+    {
+        const uint8_t *p = &raw[w * 4u];
+        words[w] = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+                   ((uint32_t)p[3] << 24);
+    }
+    return 0;
+}
+
+#endif /* defined(__linux__) */
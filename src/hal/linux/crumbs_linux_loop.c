@@ -0,0 +1,126 @@
+/**
+ * @file
+ * @brief timerfd adapter for the request engine (see crumbs_linux_loop.h).
+ */
+
+/* Ensure POSIX prototypes (clock_gettime). */
+#if !defined(_POSIX_C_SOURCE) || _POSIX_C_SOURCE < 200809L
+#undef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "crumbs_linux_loop.h"
+
+#if defined(__linux__)
+
+#include <errno.h>
+#include <sys/timerfd.h> /* timerfd_create, timerfd_settime */
+#include <time.h>        /* clock_gettime, CLOCK_MONOTONIC */
+#include <unistd.h>      /* read, close */
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+/** @brief Arm for @p us from now; 0 fires at once, UINT32_MAX disarms. */
+static int crumbs_linux_loop_arm(crumbs_linux_loop_t *loop, uint32_t us)
+{
+    struct itimerspec its = {{0, 0}, {0, 0}};
+
+    if (us != UINT32_MAX)
+    {
+        its.it_value.tv_sec = (time_t)(us / 1000000u);
+        its.it_value.tv_nsec = (long)(us % 1000000u) * 1000L;
+        if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0)
+        {
+            its.it_value.tv_nsec = 1; /* all-zero would disarm */
+        }
+    }
+    return timerfd_settime(loop->fd, 0, &its, NULL) == 0 ? 0 : -1;
+}
+
+/* ---- Public API --------------------------------------------------------- */
+
+uint32_t crumbs_linux_loop_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u);
+}
+
+int crumbs_linux_loop_init(crumbs_linux_loop_t *loop, crumbs_engine_t *eng)
+{
+    if (!loop || !eng)
+    {
+        return -1;
+    }
+
+    loop->eng = eng;
+    loop->dispatches = 0u;
+    loop->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (loop->fd < 0)
+    {
+        CRUMBS_DBG("loop: timerfd_create failed (errno %d)\n", errno);
+        return -1;
+    }
+    return crumbs_linux_loop_rearm(loop);
+}
+
+int crumbs_linux_loop_fd(const crumbs_linux_loop_t *loop)
+{
+    return loop ? loop->fd : -1;
+}
+
+int crumbs_linux_loop_submit(crumbs_linux_loop_t *loop, crumbs_request_t *req)
+{
+    if (!loop || loop->fd < 0)
+    {
+        return -1;
+    }
+
+    int rc = crumbs_engine_submit(loop->eng, req);
+    if (rc == 0)
+    {
+        (void)crumbs_linux_loop_arm(loop, 0u);
+    }
+    return rc;
+}
+
+int crumbs_linux_loop_dispatch(crumbs_linux_loop_t *loop)
+{
+    if (!loop || loop->fd < 0)
+    {
+        return -1;
+    }
+
+    /* Clear readability; EAGAIN just means a spurious wake-up. */
+    uint64_t expirations;
+    if (read(loop->fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN)
+    {
+        CRUMBS_DBG("loop: timerfd read failed (errno %d)\n", errno);
+    }
+
+    int left = crumbs_engine_poll(loop->eng, crumbs_linux_loop_now_us());
+    loop->dispatches++;
+    (void)crumbs_linux_loop_rearm(loop);
+    return left;
+}
+
+int crumbs_linux_loop_rearm(crumbs_linux_loop_t *loop)
+{
+    if (!loop || loop->fd < 0)
+    {
+        return -1;
+    }
+    return crumbs_linux_loop_arm(loop, crumbs_engine_idle_us(loop->eng, crumbs_linux_loop_now_us()));
+}
+
+void crumbs_linux_loop_close(crumbs_linux_loop_t *loop)
+{
+    if (!loop || loop->fd < 0)
+    {
+        return;
+    }
+    close(loop->fd);
+    loop->fd = -1;
+}
+
+#endif /* defined(__linux__) */
@@ -0,0 +1,502 @@
+/**
+ * @file
+ * @brief Shared-memory bus metrics (see crumbs_linux_metrics.h).
+ */
+
+/* memfd_create is a GNU extension. */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "crumbs_linux_metrics.h"
+
+#if defined(__linux__)
+
+#include <fcntl.h>    /* O_* */
+#include <sched.h>    /* sched_yield */
+#include <stdarg.h>
+#include <stdio.h>    /* vsnprintf */
+#include <string.h>   /* memset, memcpy, strchr */
+#include <sys/mman.h> /* shm_open, memfd_create, mmap */
+#include <sys/stat.h> /* fstat */
+#include <time.h>     /* clock_gettime */
+#include <unistd.h>   /* ftruncate, close, getpid */
+
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
+_Static_assert(sizeof(crumbs_metrics_region_t) % 4u == 0u, "region is copied as 32-bit words");
+#endif
+
+static const char crumbs_metrics_magic[8] = {'C', 'R', 'U', 'M', 'B', 'M', 'E', 'T'};
+
+static const char *const crumbs_metrics_kinds[CRUMBS_METRICS_ERR_KINDS] = {
+    "empty", "args", "select", "transfer", "short", "no_rstart", "e6", "other"};
+
+/** @brief Attempts before a snapshot gives up on a busy (or dead) writer. */
+#define CRUMBS_METRICS_SNAPSHOT_TRIES 64
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+static uint64_t crumbs_metrics_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* Single writer: a plain read of our own word, then a relaxed store. */
+static void crumbs_metrics_add(uint32_t *p, uint32_t v)
+{
+    __atomic_store_n(p, *p + v, __ATOMIC_RELAXED);
+}
+
+static void crumbs_metrics_put(uint32_t *p, uint32_t v)
+{
+    __atomic_store_n(p, v, __ATOMIC_RELAXED);
+}
+
+static void crumbs_metrics_begin(crumbs_metrics_region_t *g)
+{
+    __atomic_store_n(&g->seq, g->seq + 1u, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void crumbs_metrics_end(crumbs_metrics_region_t *g)
+{
+    __atomic_store_n(&g->seq, g->seq + 1u, __ATOMIC_RELEASE);
+}
+
+static unsigned crumbs_metrics_bucket(uint32_t us)
+{
+    unsigned b = 0u;
+    while (b < CRUMBS_METRICS_BUCKETS - 1u && us >= (16u << b))
+    {
+        b++;
+    }
+    return b;
+}
+
+/** @brief Count one transfer that started at @p t0 and returned @p rc. */
+static void crumbs_metrics_count(crumbs_linux_metrics_t *m, uint8_t addr, uint64_t t0, int rc,
+                                 int reads)
+{
+    crumbs_metrics_region_t *g = m->region;
+    crumbs_metrics_addr_t *a = &g->addr[addr & 0x7Fu];
+    uint64_t t1 = crumbs_metrics_now_ns();
+    uint32_t us = (uint32_t)((t1 - t0) / 1000u);
+
+    crumbs_metrics_begin(g);
+    crumbs_metrics_put(&g->uptime_us, (uint32_t)((t1 - m->start_ns) / 1000u));
+    crumbs_metrics_add(&g->busy_us, us);
+    crumbs_metrics_add(&g->transfers, 1u);
+    crumbs_metrics_add(&a->transfers, 1u);
+    crumbs_metrics_add(&a->hist[crumbs_metrics_bucket(us)], 1u);
+    crumbs_metrics_add(&a->sum_us, us);
+    crumbs_metrics_put(&a->last_us, us);
+    if (us > a->max_us)
+    {
+        crumbs_metrics_put(&a->max_us, us);
+    }
+    if (rc < 0 || (reads && rc == 0))
+    {
+        unsigned kind = (rc >= 0) ? 0u : (rc <= -7) ? 7u : (unsigned)-rc;
+        crumbs_metrics_add(&g->errors, 1u);
+        crumbs_metrics_add(&a->errors, 1u);
+        crumbs_metrics_add(&a->err_kind[kind], 1u);
+    }
+    crumbs_metrics_end(g);
+}
+
+static int crumbs_metrics_send(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    crumbs_linux_metrics_t *m = (crumbs_linux_metrics_t *)user_ctx;
+    uint64_t t0 = crumbs_metrics_now_ns();
+    int rc = m->inner->send(m->inner_io, addr, data, len);
+    crumbs_metrics_count(m, addr, t0, rc, 0);
+    return rc;
+}
+
+static int crumbs_metrics_receive(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len,
+                                  uint32_t timeout_us)
+{
+    crumbs_linux_metrics_t *m = (crumbs_linux_metrics_t *)user_ctx;
+    uint64_t t0 = crumbs_metrics_now_ns();
+    int rc = m->inner->receive(m->inner_io, addr, buffer, len, timeout_us);
+    crumbs_metrics_count(m, addr, t0, rc, 1);
+    return rc;
+}
+
+static int crumbs_metrics_transact(void *user_ctx, uint8_t addr, const uint8_t *tx, size_t tx_len,
+                                   uint8_t *rx, size_t rx_len, uint32_t timeout_us,
+                                   int require_repeated_start)
+{
+    crumbs_linux_metrics_t *m = (crumbs_linux_metrics_t *)user_ctx;
+    uint64_t t0 = crumbs_metrics_now_ns();
+    int rc = m->inner->transact(m->inner_io, addr, tx, tx_len, rx, rx_len, timeout_us,
+                                require_repeated_start);
+    crumbs_metrics_count(m, addr, t0, rc, rx_len > 0u);
+    return rc;
+}
+
+/* ---- Writer ------------------------------------------------------------ */
+
+int crumbs_linux_metrics_open(crumbs_linux_metrics_t *m, const char *name)
+{
+    struct timespec real;
+
+    if (!m)
+    {
+        return -1;
+    }
+    memset(m, 0, sizeof(*m));
+    m->fd = -1;
+    if (name && (name[0] != '/' || strlen(name) >= sizeof(m->name) || strchr(name + 1, '/')))
+    {
+        return -1;
+    }
+
+    /* A fresh object rather than truncating the old one, which would
+     * fault readers that still map it; they keep the old view instead. */
+    if (name)
+    {
+        shm_unlink(name);
+    }
+    int fd = name ? shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644)
+                  : memfd_create("crumbs-metrics", MFD_CLOEXEC);
+    if (fd < 0)
+    {
+        return -2;
+    }
+    void *base = MAP_FAILED;
+    if (ftruncate(fd, (off_t)sizeof(crumbs_metrics_region_t)) == 0)
+    {
+        base = mmap(NULL, sizeof(crumbs_metrics_region_t), PROT_READ | PROT_WRITE, MAP_SHARED,
+                    fd, 0);
+    }
+    if (base == MAP_FAILED)
+    {
+        close(fd);
+        if (name)
+        {
+            shm_unlink(name);
+        }
+        return -2;
+    }
+
+    /* ftruncate() zero-filled the region; the header goes in last. */
+    m->region = (crumbs_metrics_region_t *)base;
+    m->fd = fd;
+    m->start_ns = crumbs_metrics_now_ns();
+    if (name)
+    {
+        memcpy(m->name, name, strlen(name) + 1u);
+    }
+    clock_gettime(CLOCK_REALTIME, &real);
+    m->region->version = CRUMBS_METRICS_VERSION;
+    m->region->size = (uint32_t)sizeof(crumbs_metrics_region_t);
+    m->region->pid = (uint32_t)getpid();
+    m->region->start_s = (uint32_t)real.tv_sec;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(m->region->magic, crumbs_metrics_magic, sizeof(crumbs_metrics_magic));
+    return 0;
+}
+
+int crumbs_linux_metrics_wrap(crumbs_linux_metrics_t *m,
+                              const crumbs_transport_t *inner, void *inner_io)
+{
+    if (!m || !m->region || !inner || !inner->send)
+    {
+        return -1;
+    }
+
+    m->inner = inner;
+    m->inner_io = inner_io;
+    m->transport.name = "metrics";
+    m->transport.send = crumbs_metrics_send;
+    m->transport.receive = inner->receive ? crumbs_metrics_receive : NULL;
+    m->transport.transact = inner->transact ? crumbs_metrics_transact : NULL;
+    m->transport.caps = inner->caps;
+    m->transport.max_frame = inner->max_frame;
+    return 0;
+}
+
+int crumbs_linux_metrics_attach(crumbs_linux_metrics_t *m, crumbs_context_t *ctx)
+{
+    if (!ctx || !ctx->transport)
+    {
+        return -1;
+    }
+    if (crumbs_linux_metrics_wrap(m, ctx->transport, ctx->transport_io) != 0)
+    {
+        return -1;
+    }
+    return crumbs_set_transport(ctx, &m->transport, m);
+}
+
+void crumbs_linux_metrics_set_queue(crumbs_linux_metrics_t *m, unsigned q, uint32_t depth)
+{
+    if (!m || !m->region || q >= CRUMBS_METRICS_QUEUES)
+    {
+        return;
+    }
+    crumbs_metrics_region_t *g = m->region;
+    crumbs_metrics_begin(g);
+    crumbs_metrics_put(&g->queue_depth[q], depth);
+    if (depth > g->queue_high[q])
+    {
+        crumbs_metrics_put(&g->queue_high[q], depth);
+    }
+    crumbs_metrics_end(g);
+}
+
+void crumbs_linux_metrics_engine(crumbs_linux_metrics_t *m, const crumbs_engine_t *eng)
+{
+    uint32_t depth[CRUMBS_ENGINE_LANES] = {0u};
+
+    if (!eng)
+    {
+        return;
+    }
+    for (const crumbs_request_t *r = eng->head; r; r = r->next)
+    {
+        if (r->lane < CRUMBS_ENGINE_LANES)
+        {
+            depth[r->lane]++;
+        }
+    }
+    for (unsigned lane = 0u; lane < CRUMBS_ENGINE_LANES; lane++)
+    {
+        crumbs_linux_metrics_set_queue(m, lane, depth[lane]);
+    }
+}
+
+void crumbs_linux_metrics_close(crumbs_linux_metrics_t *m)
+{
+    if (!m)
+    {
+        return;
+    }
+    if (m->region)
+    {
+        munmap(m->region, sizeof(crumbs_metrics_region_t));
+        m->region = NULL;
+    }
+    if (m->fd >= 0)
+    {
+        close(m->fd);
+        m->fd = -1;
+    }
+    if (m->name[0] != '\0')
+    {
+        shm_unlink(m->name);
+        m->name[0] = '\0';
+    }
+}
+
+/* ---- Reader ------------------------------------------------------------ */
+
+int crumbs_linux_metrics_map(crumbs_linux_metrics_reader_t *r, const char *name)
+{
+    struct stat st;
+
+    if (!r)
+    {
+        return -1;
+    }
+    r->region = NULL;
+    if (!name || name[0] == '\0')
+    {
+        return -1;
+    }
+
+    int shm = (name[0] == '/' && !strchr(name + 1, '/'));
+    int fd = shm ? shm_open(name, O_RDONLY | O_CLOEXEC, 0) : open(name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return -2;
+    }
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return -2;
+    }
+    if ((size_t)st.st_size < sizeof(crumbs_metrics_region_t))
+    {
+        close(fd);
+        return -3;
+    }
+    void *base = mmap(NULL, sizeof(crumbs_metrics_region_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        return -2;
+    }
+
+    const crumbs_metrics_region_t *g = (const crumbs_metrics_region_t *)base;
+    if (memcmp(g->magic, crumbs_metrics_magic, sizeof(crumbs_metrics_magic)) != 0 ||
+        g->version != CRUMBS_METRICS_VERSION || g->size != sizeof(crumbs_metrics_region_t))
+    {
+        munmap(base, sizeof(crumbs_metrics_region_t));
+        return -3;
+    }
+    r->region = g;
+    return 0;
+}
+
+int crumbs_linux_metrics_snapshot(const crumbs_linux_metrics_reader_t *r,
+                                  crumbs_metrics_region_t *out)
+{
+    if (!r || !r->region || !out)
+    {
+        return -1;
+    }
+
+    const crumbs_metrics_region_t *g = r->region;
+    const uint32_t *src = &g->version;
+    uint32_t *dst = &out->version;
+    size_t words = (sizeof(*g) - offsetof(crumbs_metrics_region_t, version)) / 4u;
+
+    memcpy(out->magic, g->magic, sizeof(out->magic));
+    for (int attempt = 0; attempt < CRUMBS_METRICS_SNAPSHOT_TRIES; attempt++)
+    {
+        uint32_t before = __atomic_load_n(&g->seq, __ATOMIC_ACQUIRE);
+        if (before & 1u)
+        {
+            sched_yield();
+            continue;
+        }
+        for (size_t i = 0; i < words; i++)
+        {
+            dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&g->seq, __ATOMIC_RELAXED) == before)
+        {
+            return 0;
+        }
+    }
+    return -2;
+}
+
+void crumbs_linux_metrics_unmap(crumbs_linux_metrics_reader_t *r)
+{
+    if (r && r->region)
+    {
+        munmap((void *)r->region, sizeof(crumbs_metrics_region_t));
+        r->region = NULL;
+    }
+}
+
+/* ---- Prometheus text format -------------------------------------------- */
+
+const char *crumbs_linux_metrics_kind_name(unsigned kind)
+{
+    return (kind < CRUMBS_METRICS_ERR_KINDS) ? crumbs_metrics_kinds[kind] : "?";
+}
+
+/** @brief Append to @p buf; sets *len past @p cap on overflow. */
+static void crumbs_prom_put(char *buf, size_t cap, size_t *len, const char *fmt, ...)
+{
+    va_list ap;
+
+    if (*len >= cap)
+    {
+        return;
+    }
+    va_start(ap, fmt);
+    int n = vsnprintf(buf + *len, cap - *len, fmt, ap);
+    va_end(ap);
+    *len = (n < 0) ? cap : *len + (size_t)n;
+}
+
+int crumbs_linux_metrics_format_prom(const crumbs_metrics_region_t *snap, char *buf, size_t cap)
+{
+    size_t len = 0u;
+
+    if (!snap || !buf || cap == 0u)
+    {
+        return -1;
+    }
+
+    crumbs_prom_put(buf, cap, &len,
+                    "# HELP crumbs_uptime_us Writer time since the region was opened.\n"
+                    "# TYPE crumbs_uptime_us gauge\n"
+                    "crumbs_uptime_us %lu\n"
+                    "# HELP crumbs_busy_us_total Time spent inside bus transfers.\n"
+                    "# TYPE crumbs_busy_us_total counter\n"
+                    "crumbs_busy_us_total %lu\n",
+                    (unsigned long)snap->uptime_us, (unsigned long)snap->busy_us);
+
+    crumbs_prom_put(buf, cap, &len,
+                    "# HELP crumbs_queue_depth Queued requests (0 telemetry, 1 control lane).\n"
+                    "# TYPE crumbs_queue_depth gauge\n");
+    for (unsigned q = 0u; q < CRUMBS_METRICS_QUEUES; q++)
+    {
+        crumbs_prom_put(buf, cap, &len, "crumbs_queue_depth{queue=\"%u\"} %lu\n", q,
+                        (unsigned long)snap->queue_depth[q]);
+    }
+
+    crumbs_prom_put(buf, cap, &len,
+                    "# HELP crumbs_transfers_total Bus transfers per target address.\n"
+                    "# TYPE crumbs_transfers_total counter\n");
+    for (unsigned i = 0u; i < CRUMBS_METRICS_ADDRS; i++)
+    {
+        if (snap->addr[i].transfers)
+        {
+            crumbs_prom_put(buf, cap, &len, "crumbs_transfers_total{addr=\"0x%02X\"} %lu\n", i,
+                            (unsigned long)snap->addr[i].transfers);
+        }
+    }
+
+    crumbs_prom_put(buf, cap, &len,
+                    "# HELP crumbs_errors_total Failed transfers per address and kind.\n"
+                    "# TYPE crumbs_errors_total counter\n");
+    for (unsigned i = 0u; i < CRUMBS_METRICS_ADDRS; i++)
+    {
+        for (unsigned k = 0u; k < CRUMBS_METRICS_ERR_KINDS; k++)
+        {
+            if (snap->addr[i].err_kind[k])
+            {
+                crumbs_prom_put(buf, cap, &len,
+                                "crumbs_errors_total{addr=\"0x%02X\",kind=\"%s\"} %lu\n", i,
+                                crumbs_metrics_kinds[k], (unsigned long)snap->addr[i].err_kind[k]);
+            }
+        }
+    }
+
+    crumbs_prom_put(buf, cap, &len,
+                    "# HELP crumbs_latency_us Transfer latency per address.\n"
+                    "# TYPE crumbs_latency_us histogram\n");
+    for (unsigned i = 0u; i < CRUMBS_METRICS_ADDRS; i++)
+    {
+        const crumbs_metrics_addr_t *a = &snap->addr[i];
+        unsigned long total = 0u;
+
+        if (!a->transfers)
+        {
+            continue;
+        }
+        for (unsigned b = 0u; b < CRUMBS_METRICS_BUCKETS; b++)
+        {
+            total += a->hist[b];
+            if (b < CRUMBS_METRICS_BUCKETS - 1u)
+            {
+                crumbs_prom_put(buf, cap, &len,
+                                "crumbs_latency_us_bucket{addr=\"0x%02X\",le=\"%lu\"} %lu\n", i,
+                                (unsigned long)(16u << b), total);
+            }
+        }
+        crumbs_prom_put(buf, cap, &len,
+                        "crumbs_latency_us_bucket{addr=\"0x%02X\",le=\"+Inf\"} %lu\n"
+                        "crumbs_latency_us_sum{addr=\"0x%02X\"} %lu\n"
+                        "crumbs_latency_us_count{addr=\"0x%02X\"} %lu\n",
+                        i, total, i, (unsigned long)a->sum_us, i, total);
+    }
+
+    if (len >= cap)
+    {
+        return -1;
+    }
+    return (int)len;
+}
+
+#endif /* defined(__linux__) */
@@ -0,0 +1,270 @@
+/**
+ * @file
+ * @brief Fixed-period cycle executive for Linux controllers (see crumbs_linux_rt.h).
+ */
+
+/* sched_setaffinity and CPU_SET are GNU extensions. */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "crumbs_linux_rt.h"
+
+#if defined(__linux__)
+
+#include <errno.h>
+#include <sched.h>    /* sched_setscheduler, sched_setaffinity */
+#include <string.h>   /* memset */
+#include <sys/mman.h> /* mlockall */
+#include <time.h>     /* clock_gettime, clock_nanosleep */
+
+#if CRUMBS_LINUX_RT_ARENA < 1 || CRUMBS_LINUX_RT_ARENA > 255
+#error "CRUMBS_LINUX_RT_ARENA must be between 1 and 255"
+#endif
+
+/** @brief Stack touched by crumbs_linux_rt_setup() so later growth does not fault. */
+#define CRUMBS_LINUX_RT_PREFAULT (64u * 1024u)
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+static uint32_t crumbs_linux_rt_clamp_us(uint64_t ns)
+{
+    uint64_t us = ns / 1000u;
+    return (us > UINT32_MAX) ? UINT32_MAX : (uint32_t)us;
+}
+
+static void crumbs_linux_rt_prefault(void)
+{
+    volatile uint8_t stack[CRUMBS_LINUX_RT_PREFAULT];
+
+    for (size_t i = 0; i < sizeof(stack); i += 4096u)
+    {
+        stack[i] = 0u;
+    }
+}
+
+static void crumbs_linux_rt_free(crumbs_linux_rt_t *rt, crumbs_linux_rt_slot_t *slot)
+{
+    rt->free_list[rt->free_count++] = (uint8_t)(slot - rt->slots);
+}
+
+/** @brief Completion trampoline: run the caller's callback, then recycle the entry. */
+static void crumbs_linux_rt_done(crumbs_request_t *req, int status)
+{
+    crumbs_linux_rt_slot_t *slot = (crumbs_linux_rt_slot_t *)req;
+
+    if (slot->on_done)
+    {
+        slot->on_done(req, status);
+    }
+    if (req->state == CRUMBS_REQ_IDLE)
+    {
+        crumbs_linux_rt_free(slot->owner, slot);
+    }
+}
+
+/* ---- Public API -------------------------------------------------------- */
+
+uint64_t crumbs_linux_rt_now_ns(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+    {
+        return 0u;
+    }
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t crumbs_linux_rt_now_us(void)
+{
+    return crumbs_linux_rt_now_ns() / 1000u;
+}
+
+void crumbs_linux_rt_sleep_until(uint64_t deadline_ns)
+{
+    struct timespec ts;
+
+    ts.tv_sec = (time_t)(deadline_ns / 1000000000u);
+    ts.tv_nsec = (long)(deadline_ns % 1000000000u);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+    {
+        /* absolute deadline: just sleep again */
+    }
+}
+
+int crumbs_linux_rt_setup(const crumbs_linux_rt_config_t *cfg)
+{
+    if (!cfg || cfg->fifo_priority < 0 || cfg->fifo_priority > 99 || cfg->cpu < -1 ||
+        cfg->cpu >= CPU_SETSIZE)
+    {
+        return -1;
+    }
+
+    if (cfg->fifo_priority > 0)
+    {
+        struct sched_param sp;
+        memset(&sp, 0, sizeof(sp));
+        sp.sched_priority = cfg->fifo_priority;
+        if (sched_setscheduler(0, SCHED_FIFO, &sp) != 0)
+        {
+            return -2;
+        }
+    }
+
+    if (cfg->cpu >= 0)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cfg->cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) != 0)
+        {
+            return -3;
+        }
+    }
+
+    if (cfg->lock_memory)
+    {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+        {
+            return -4;
+        }
+        crumbs_linux_rt_prefault();
+    }
+    return 0;
+}
+
+int crumbs_linux_rt_init(crumbs_linux_rt_t *rt, uint32_t period_us)
+{
+    if (!rt || period_us == 0u)
+    {
+        return -1;
+    }
+
+    memset(rt, 0, sizeof(*rt));
+    rt->period_us = period_us;
+    rt->next_ns = crumbs_linux_rt_now_ns() + (uint64_t)period_us * 1000u;
+    for (int i = CRUMBS_LINUX_RT_ARENA - 1; i >= 0; i--)
+    {
+        rt->slots[i].owner = rt;
+        rt->free_list[rt->free_count++] = (uint8_t)i;
+    }
+    return 0;
+}
+
+int crumbs_linux_rt_wait(crumbs_linux_rt_t *rt)
+{
+    uint64_t period_ns;
+    uint64_t now;
+    uint64_t jitter;
+    int late = 0;
+
+    if (!rt || rt->period_us == 0u)
+    {
+        return -1;
+    }
+
+    period_ns = (uint64_t)rt->period_us * 1000u;
+    now = crumbs_linux_rt_now_ns();
+    if (rt->started_ns != 0u)
+    {
+        rt->stats.last_exec_us = crumbs_linux_rt_clamp_us(now - rt->started_ns);
+        if (rt->stats.last_exec_us > rt->stats.max_exec_us)
+        {
+            rt->stats.max_exec_us = rt->stats.last_exec_us;
+        }
+    }
+
+    if (now >= rt->next_ns)
+    {
+        /* Overrun: start now, and drop the periods that already passed. */
+        uint64_t behind = (now - rt->next_ns) / period_ns;
+        late = 1;
+        rt->stats.overruns++;
+        rt->stats.skipped += (uint32_t)behind;
+        rt->next_ns += behind * period_ns;
+    }
+    else
+    {
+        crumbs_linux_rt_sleep_until(rt->next_ns);
+        now = crumbs_linux_rt_now_ns();
+    }
+
+    jitter = (now > rt->next_ns) ? now - rt->next_ns : 0u;
+    rt->started_ns = now;
+    rt->next_ns += period_ns;
+
+    rt->stats.cycles++;
+    rt->stats.last_jitter_us = crumbs_linux_rt_clamp_us(jitter);
+    if (rt->stats.last_jitter_us > rt->stats.max_jitter_us)
+    {
+        rt->stats.max_jitter_us = rt->stats.last_jitter_us;
+    }
+    rt->jitter_sum_us += rt->stats.last_jitter_us;
+    rt->stats.mean_jitter_us = (uint32_t)(rt->jitter_sum_us / rt->stats.cycles);
+    return late;
+}
+
+void crumbs_linux_rt_get_stats(const crumbs_linux_rt_t *rt, crumbs_linux_rt_stats_t *out)
+{
+    if (!rt || !out)
+    {
+        return;
+    }
+    *out = rt->stats;
+}
+
+void crumbs_linux_rt_reset_stats(crumbs_linux_rt_t *rt)
+{
+    if (!rt)
+    {
+        return;
+    }
+    memset(&rt->stats, 0, sizeof(rt->stats));
+    rt->jitter_sum_us = 0u;
+    rt->arena_misses = 0u;
+}
+
+crumbs_request_t *crumbs_linux_rt_request(crumbs_linux_rt_t *rt, const crumbs_device_t *dev,
+                                          uint8_t opcode, crumbs_request_cb on_done,
+                                          void *user_data)
+{
+    crumbs_linux_rt_slot_t *slot;
+
+    if (!rt || !dev)
+    {
+        return NULL;
+    }
+    if (rt->free_count == 0u)
+    {
+        rt->arena_misses++;
+        return NULL;
+    }
+
+    slot = &rt->slots[rt->free_list[--rt->free_count]];
+    crumbs_request_init(&slot->req, dev, opcode, crumbs_linux_rt_done, user_data);
+    slot->on_done = on_done;
+    return &slot->req;
+}
+
+int crumbs_linux_rt_release(crumbs_linux_rt_t *rt, crumbs_request_t *req)
+{
+    crumbs_linux_rt_slot_t *slot = (crumbs_linux_rt_slot_t *)req;
+
+    if (!rt || !req || slot < rt->slots || slot >= rt->slots + CRUMBS_LINUX_RT_ARENA ||
+        req->state != CRUMBS_REQ_IDLE)
+    {
+        return -1;
+    }
+    for (uint8_t i = 0; i < rt->free_count; i++)
+    {
+        if (&rt->slots[rt->free_list[i]] == slot)
+        {
+            return -1; /* already free */
+        }
+    }
+    crumbs_linux_rt_free(rt, slot);
+    return 0;
+}
+
+#endif /* defined(__linux__) */
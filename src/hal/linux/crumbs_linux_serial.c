@@ -0,0 +1,218 @@
+/**
+ * @file
+ * @brief termios port for the serial transport (see crumbs_linux_serial.h).
+ */
+
+/* B1000000 and up, cfmakeraw(), O_CLOEXEC. */
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+#include "crumbs_linux_serial.h"
+
+#if defined(__linux__)
+
+#include <errno.h>
+#include <fcntl.h>        /* open */
+#include <linux/serial.h> /* struct serial_rs485 */
+#include <poll.h>         /* poll */
+#include <string.h>       /* memset */
+#include <sys/ioctl.h>    /* ioctl, TIOCSRS485 */
+#include <termios.h>
+#include <unistd.h>       /* read, write, close */
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+static speed_t crumbs_linux_serial_speed(uint32_t baud)
+{
+    static const struct
+    {
+        uint32_t baud;
+        speed_t speed;
+    } rates[] = {
+        {9600u, B9600},
+        {19200u, B19200},
+        {38400u, B38400},
+        {57600u, B57600},
+        {115200u, B115200},
+        {230400u, B230400},
+        {460800u, B460800},
+        {500000u, B500000},
+        {921600u, B921600},
+        {1000000u, B1000000},
+        {1500000u, B1500000},
+        {2000000u, B2000000},
+        {2500000u, B2500000},
+        {3000000u, B3000000},
+        {3500000u, B3500000},
+        {4000000u, B4000000},
+    };
+
+    for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++)
+    {
+        if (rates[i].baud == baud)
+        {
+            return rates[i].speed;
+        }
+    }
+    return B0;
+}
+
+/* ---- Public API -------------------------------------------------------- */
+
+int crumbs_linux_serial_open(crumbs_linux_serial_t *tty, const char *path,
+                             uint32_t baud, int rs485)
+{
+    struct termios tio;
+    speed_t speed = crumbs_linux_serial_speed(baud);
+
+    if (!tty || !path || path[0] == '\0' || speed == B0)
+    {
+        return -1;
+    }
+    tty->fd = -1;
+    tty->baud = 0u;
+
+    int fd = open(path, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        CRUMBS_DBG("serial: open %s failed (errno %d)\n", path, errno);
+        return -2;
+    }
+
+    if (tcgetattr(fd, &tio) != 0)
+    {
+        close(fd);
+        return -2;
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~(tcflag_t)(CSTOPB | CRTSCTS);
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    if (cfsetispeed(&tio, speed) != 0 || cfsetospeed(&tio, speed) != 0 ||
+        tcsetattr(fd, TCSANOW, &tio) != 0)
+    {
+        close(fd);
+        return -2;
+    }
+
+    if (rs485)
+    {
+        struct serial_rs485 cfg;
+        memset(&cfg, 0, sizeof(cfg));
+        cfg.flags = SER_RS485_ENABLED | SER_RS485_RTS_ON_SEND;
+        if (ioctl(fd, TIOCSRS485, &cfg) < 0)
+        {
+            CRUMBS_DBG("serial: RS-485 mode refused (errno %d)\n", errno);
+            close(fd);
+            return -3;
+        }
+    }
+
+    tcflush(fd, TCIOFLUSH);
+    tty->fd = fd;
+    tty->baud = baud;
+    return 0;
+}
+
+void crumbs_linux_serial_close(crumbs_linux_serial_t *tty)
+{
+    if (!tty || tty->fd < 0)
+    {
+        return;
+    }
+    close(tty->fd);
+    tty->fd = -1;
+}
+
+int crumbs_linux_serial_write(void *user, const uint8_t *data, size_t len)
+{
+    crumbs_linux_serial_t *tty = (crumbs_linux_serial_t *)user;
+    size_t off = 0u;
+
+    if (!tty || tty->fd < 0 || (len > 0u && !data))
+    {
+        return -1;
+    }
+    while (off < len)
+    {
+        ssize_t n = write(tty->fd, data + off, len - off);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        off += (size_t)n;
+    }
+    /* The reply must not start while the request is still in the FIFO. */
+    return (tcdrain(tty->fd) == 0) ? 0 : -1;
+}
+
+int crumbs_linux_serial_read(void *user, uint8_t *buf, size_t len, uint32_t timeout_us)
+{
+    crumbs_linux_serial_t *tty = (crumbs_linux_serial_t *)user;
+    struct pollfd pfd;
+    int rc;
+
+    if (!tty || tty->fd < 0 || !buf)
+    {
+        return -1;
+    }
+    if (len == 0u)
+    {
+        return 0;
+    }
+
+    pfd.fd = tty->fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    do
+    {
+        rc = poll(&pfd, 1, (int)((timeout_us + 999u) / 1000u));
+    } while (rc < 0 && errno == EINTR);
+    if (rc <= 0)
+    {
+        return rc; /* 0 = timeout */
+    }
+
+    ssize_t n = read(tty->fd, buf, len);
+    if (n < 0)
+    {
+        return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+    }
+    return (int)n;
+}
+
+void crumbs_linux_serial_port(crumbs_serial_port_t *port, crumbs_linux_serial_t *tty)
+{
+    crumbs_serial_init(port, crumbs_linux_serial_write, crumbs_linux_serial_read, tty);
+}
+
+int crumbs_linux_serial_init_controller(crumbs_context_t *ctx,
+                                        crumbs_serial_port_t *port,
+                                        crumbs_linux_serial_t *tty,
+                                        const char *path,
+                                        uint32_t baud,
+                                        int rs485)
+{
+    if (!ctx || !port || !tty)
+    {
+        return -1;
+    }
+
+    crumbs_init(ctx, CRUMBS_ROLE_CONTROLLER, 0u);
+    int rc = crumbs_linux_serial_open(tty, path, baud, rs485);
+    if (rc != 0)
+    {
+        return rc;
+    }
+    crumbs_linux_serial_port(port, tty);
+    crumbs_set_transport(ctx, &crumbs_serial_transport, port);
+    return 0;
+}
+
+#endif /* defined(__linux__) */
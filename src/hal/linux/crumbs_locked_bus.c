@@ -0,0 +1,94 @@
+/**
+ * @file
+ * @brief Mutex-guarded bus adapter (see crumbs_locked_bus.h).
+ */
+
+#include "crumbs_locked_bus.h"
+
+#if defined(__linux__)
+
+int crumbs_locked_bus_init(crumbs_locked_bus_t *bus,
+                           void *io,
+                           crumbs_i2c_write_fn write_fn,
+                           crumbs_i2c_read_fn read_fn,
+                           crumbs_i2c_write_read_fn write_read_fn)
+{
+    if (!bus)
+    {
+        return -1;
+    }
+    if (pthread_mutex_init(&bus->lock, NULL) != 0)
+    {
+        return -1;
+    }
+    bus->io = io;
+    bus->write_fn = write_fn;
+    bus->read_fn = read_fn;
+    bus->write_read_fn = write_read_fn;
+    bus->transfers = 0u;
+    return 0;
+}
+
+void crumbs_locked_bus_destroy(crumbs_locked_bus_t *bus)
+{
+    if (!bus)
+    {
+        return;
+    }
+    pthread_mutex_destroy(&bus->lock);
+}
+
+int crumbs_locked_bus_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    crumbs_locked_bus_t *bus = (crumbs_locked_bus_t *)user_ctx;
+    if (!bus || !bus->write_fn)
+    {
+        return -1;
+    }
+
+    pthread_mutex_lock(&bus->lock);
+    int rc = bus->write_fn(bus->io, addr, data, len);
+    bus->transfers++;
+    pthread_mutex_unlock(&bus->lock);
+    return rc;
+}
+
+int crumbs_locked_bus_read(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len, uint32_t timeout_us)
+{
+    crumbs_locked_bus_t *bus = (crumbs_locked_bus_t *)user_ctx;
+    if (!bus || !bus->read_fn)
+    {
+        return -1;
+    }
+
+    pthread_mutex_lock(&bus->lock);
+    int rc = bus->read_fn(bus->io, addr, buffer, len, timeout_us);
+    bus->transfers++;
+    pthread_mutex_unlock(&bus->lock);
+    return rc;
+}
+
+int crumbs_locked_bus_write_read(void *user_ctx,
+                                 uint8_t addr,
+                                 const uint8_t *tx,
+                                 size_t tx_len,
+                                 uint8_t *rx,
+                                 size_t rx_len,
+                                 uint32_t timeout_us,
+                                 int require_repeated_start)
+{
+    crumbs_locked_bus_t *bus = (crumbs_locked_bus_t *)user_ctx;
+    if (!bus || !bus->write_read_fn)
+    {
+        return -1;
+    }
+
+    pthread_mutex_lock(&bus->lock);
+    int rc = bus->write_read_fn(bus->io, addr, tx, tx_len, rx, rx_len,
+                                timeout_us, require_repeated_start);
+    bus->transfers++;
+    pthread_mutex_unlock(&bus->lock);
+    return rc;
+}
+
+#endif /* defined(__linux__) */
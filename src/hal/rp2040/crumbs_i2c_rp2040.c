@@ -0,0 +1,238 @@
+/**
+ * @file
+ * @brief RP2040 hardware I2C peripheral with DMA (see crumbs_rp2040.h).
+ */
+
+#include "crumbs_rp2040.h"
+
+#if defined(LIB_HARDWARE_I2C) && defined(LIB_HARDWARE_DMA) && !defined(ARDUINO)
+
+#include <string.h> /* memset */
+
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+
+/* One peripheral per I2C block; the interrupt handlers take no argument. */
+static crumbs_rp2040_peripheral_t *g_crumbs_rp2040[2];
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+/** @brief Point rx_chan at the active buffer and start it. */
+static void crumbs_rp2040_arm_rx(crumbs_rp2040_peripheral_t *p)
+{
+    dma_channel_config c = dma_channel_get_default_config((uint)p->rx_chan);
+
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_dreq(&c, i2c_get_dreq(p->i2c, false));
+    dma_channel_configure((uint)p->rx_chan, &c, p->rx[p->rx_active],
+                          &i2c_get_hw(p->i2c)->data_cmd, CRUMBS_MESSAGE_MAX_SIZE, true);
+}
+
+/**
+ * @brief End the current write and dispatch it.
+ *
+ * Waits for the DMA to drain the FIFO, reads how much arrived, arms the
+ * other buffer, then hands the finished one to the core.
+ */
+static void crumbs_rp2040_take_rx(crumbs_rp2040_peripheral_t *p)
+{
+    i2c_hw_t *hw = i2c_get_hw(p->i2c);
+    uint8_t done;
+    size_t len;
+
+    while (hw->rxflr > 0u && dma_channel_is_busy((uint)p->rx_chan))
+    {
+        tight_loop_contents();
+    }
+    len = CRUMBS_MESSAGE_MAX_SIZE - (size_t)dma_channel_hw_addr((uint)p->rx_chan)->transfer_count;
+    if (len == 0u)
+    {
+        return; /* nothing written since the last frame (address-only probe, read) */
+    }
+
+    dma_channel_abort((uint)p->rx_chan);
+    if (hw->rxflr > 0u)
+    {
+        p->overruns++;
+        while (hw->rxflr > 0u)
+        {
+            (void)hw->data_cmd;
+        }
+    }
+    done = p->rx_active;
+    p->rx_active ^= 1u;
+    crumbs_rp2040_arm_rx(p);
+
+    (void)crumbs_peripheral_handle_receive(p->ctx, p->rx[done], len);
+    p->frames++;
+}
+
+/** @brief Encode the reply and stream it, zero padded, into the transmit FIFO. */
+static void crumbs_rp2040_start_tx(crumbs_rp2040_peripheral_t *p)
+{
+    dma_channel_config c = dma_channel_get_default_config((uint)p->tx_chan);
+    size_t len = 0u;
+
+    if (crumbs_peripheral_build_reply(p->ctx, p->frame, sizeof(p->frame), &len) != 0)
+    {
+        len = 0u;
+    }
+    /* 16-bit words keep IC_DATA_CMD.CMD clear (byte writes are replicated
+     * across the bus and would set it). The padding lets a controller read
+     * the full CRUMBS_MESSAGE_MAX_SIZE without being stretched. */
+    for (size_t i = 0; i < CRUMBS_MESSAGE_MAX_SIZE; i++)
+    {
+        p->tx[i] = (i < len) ? p->frame[i] : 0u;
+    }
+
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, i2c_get_dreq(p->i2c, true));
+    dma_channel_configure((uint)p->tx_chan, &c, &i2c_get_hw(p->i2c)->data_cmd, p->tx,
+                          CRUMBS_MESSAGE_MAX_SIZE, true);
+    if (len > 0u)
+    {
+        p->replies++;
+    }
+}
+
+static void crumbs_rp2040_irq(crumbs_rp2040_peripheral_t *p)
+{
+    i2c_hw_t *hw;
+    uint32_t stat;
+
+    if (!p)
+    {
+        return;
+    }
+    hw = i2c_get_hw(p->i2c);
+    stat = hw->intr_stat;
+
+    /* A read request with old bytes in the FIFO flushes them; the FIFO
+     * stays flushed until the abort is cleared. */
+    if (stat & I2C_IC_INTR_STAT_R_TX_ABRT_BITS)
+    {
+        (void)hw->clr_tx_abrt;
+    }
+    /* STOP first: with both pending, the STOP ended an earlier transfer. */
+    if (stat & I2C_IC_INTR_STAT_R_STOP_DET_BITS)
+    {
+        (void)hw->clr_stop_det;
+        dma_channel_abort((uint)p->tx_chan); /* unread padding */
+        crumbs_rp2040_take_rx(p);
+    }
+    if (stat & I2C_IC_INTR_STAT_R_RD_REQ_BITS)
+    {
+        /* A write before a repeated START (usually SET_REPLY) has not
+         * seen a STOP, so dispatch it before building the reply. */
+        crumbs_rp2040_take_rx(p);
+        crumbs_rp2040_start_tx(p);
+        (void)hw->clr_rd_req;
+    }
+}
+
+static void crumbs_rp2040_irq0(void)
+{
+    crumbs_rp2040_irq(g_crumbs_rp2040[0]);
+}
+
+static void crumbs_rp2040_irq1(void)
+{
+    crumbs_rp2040_irq(g_crumbs_rp2040[1]);
+}
+
+/* ---- Public API -------------------------------------------------------- */
+
+int crumbs_rp2040_init_peripheral(crumbs_rp2040_peripheral_t *p, crumbs_context_t *ctx,
+                                  i2c_inst_t *i2c, uint8_t address, unsigned sda, unsigned scl,
+                                  uint32_t baud)
+{
+    i2c_hw_t *hw;
+    uint idx;
+
+    if (!p || !ctx || !i2c || address < 0x08u || address > 0x77u || baud == 0u)
+    {
+        return -1;
+    }
+    idx = i2c_hw_index(i2c);
+    if (g_crumbs_rp2040[idx] && g_crumbs_rp2040[idx] != p)
+    {
+        return -1;
+    }
+
+    memset(p, 0, sizeof(*p));
+    p->ctx = ctx;
+    p->i2c = i2c;
+    p->rx_chan = dma_claim_unused_channel(false);
+    p->tx_chan = dma_claim_unused_channel(false);
+    if (p->rx_chan < 0 || p->tx_chan < 0)
+    {
+        if (p->rx_chan >= 0)
+        {
+            dma_channel_unclaim((uint)p->rx_chan);
+        }
+        if (p->tx_chan >= 0)
+        {
+            dma_channel_unclaim((uint)p->tx_chan);
+        }
+        return -2;
+    }
+    crumbs_init(ctx, CRUMBS_ROLE_PERIPHERAL, address);
+
+    i2c_init(i2c, baud);
+    gpio_set_function(sda, GPIO_FUNC_I2C);
+    gpio_set_function(scl, GPIO_FUNC_I2C);
+    gpio_pull_up(sda);
+    gpio_pull_up(scl);
+    i2c_set_slave_mode(i2c, true, address);
+
+    /* STOP only for our transfers; a full RX FIFO stretches instead of
+     * dropping bytes; DMA on both FIFOs. */
+    hw = i2c_get_hw(i2c);
+    hw->enable = 0;
+    hw_set_bits(&hw->con, I2C_IC_CON_STOP_DET_IFADDRESSED_BITS |
+                              I2C_IC_CON_RX_FIFO_FULL_HLD_CTRL_BITS);
+    hw->dma_rdlr = 0;
+    hw->dma_tdlr = 8;
+    hw->dma_cr = I2C_IC_DMA_CR_RDMAE_BITS | I2C_IC_DMA_CR_TDMAE_BITS;
+    hw->enable = 1;
+
+    crumbs_rp2040_arm_rx(p);
+
+    g_crumbs_rp2040[idx] = p;
+    hw->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_RD_REQ_BITS |
+                    I2C_IC_INTR_MASK_M_TX_ABRT_BITS;
+    irq_set_exclusive_handler(I2C0_IRQ + idx, idx ? crumbs_rp2040_irq1 : crumbs_rp2040_irq0);
+    irq_set_enabled(I2C0_IRQ + idx, true);
+    return 0;
+}
+
+void crumbs_rp2040_close(crumbs_rp2040_peripheral_t *p)
+{
+    uint idx;
+
+    if (!p || !p->i2c)
+    {
+        return;
+    }
+    idx = i2c_hw_index(p->i2c);
+    irq_set_enabled(I2C0_IRQ + idx, false);
+    irq_remove_handler(I2C0_IRQ + idx, idx ? crumbs_rp2040_irq1 : crumbs_rp2040_irq0);
+    i2c_get_hw(p->i2c)->intr_mask = 0;
+    dma_channel_abort((uint)p->rx_chan);
+    dma_channel_abort((uint)p->tx_chan);
+    dma_channel_unclaim((uint)p->rx_chan);
+    dma_channel_unclaim((uint)p->tx_chan);
+    i2c_deinit(p->i2c);
+    if (g_crumbs_rp2040[idx] == p)
+    {
+        g_crumbs_rp2040[idx] = NULL;
+    }
+    p->i2c = NULL;
+}
+
+#endif /* LIB_HARDWARE_I2C && LIB_HARDWARE_DMA && !ARDUINO */
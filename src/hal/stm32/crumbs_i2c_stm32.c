@@ -0,0 +1,259 @@
+/**
+ * @file
+ * @brief STM32Cube HAL peripheral with DMA receive and transmit (see crumbs_stm32.h).
+ */
+
+#include "crumbs_stm32.h"
+
+#if defined(USE_HAL_DRIVER) && !defined(ARDUINO)
+#if defined(HAL_I2C_MODULE_ENABLED) && defined(HAL_DMA_MODULE_ENABLED)
+
+#include <string.h> /* memset */
+
+#if CRUMBS_STM32_MAX_PERIPHERALS < 1 || CRUMBS_STM32_MAX_PERIPHERALS > 4
+#error "CRUMBS_STM32_MAX_PERIPHERALS must be between 1 and 4"
+#endif
+
+#if CRUMBS_STM32_DMA_BUF < CRUMBS_MESSAGE_MAX_SIZE
+#error "CRUMBS_STM32_DMA_BUF must hold CRUMBS_MESSAGE_MAX_SIZE bytes"
+#endif
+
+#if defined(__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+#define CRUMBS_STM32_CACHE_CLEAN(buf) \
+    SCB_CleanDCache_by_Addr((uint32_t *)(void *)(buf), (int32_t)CRUMBS_STM32_DMA_BUF)
+#define CRUMBS_STM32_CACHE_INVALIDATE(buf) \
+    SCB_InvalidateDCache_by_Addr((uint32_t *)(void *)(buf), (int32_t)CRUMBS_STM32_DMA_BUF)
+#else
+#define CRUMBS_STM32_CACHE_CLEAN(buf) ((void)0)
+#define CRUMBS_STM32_CACHE_INVALIDATE(buf) ((void)0)
+#endif
+
+/* HAL callbacks carry only the handle, so bound peripherals are looked up by it. */
+static crumbs_stm32_peripheral_t *g_crumbs_stm32[CRUMBS_STM32_MAX_PERIPHERALS];
+
+/* ---- Helpers (file-local) ---------------------------------------------- */
+
+static crumbs_stm32_peripheral_t *crumbs_stm32_find(const I2C_HandleTypeDef *hi2c)
+{
+    for (int i = 0; i < CRUMBS_STM32_MAX_PERIPHERALS; i++)
+    {
+        if (g_crumbs_stm32[i] && g_crumbs_stm32[i]->hi2c == hi2c)
+        {
+            return g_crumbs_stm32[i];
+        }
+    }
+    return NULL;
+}
+
+/** @brief Start receiving the controller's write into the active buffer. */
+static void crumbs_stm32_arm_rx(crumbs_stm32_peripheral_t *p)
+{
+    p->rx_pending = 1u;
+    if (HAL_I2C_Slave_Seq_Receive_DMA(p->hi2c, p->rx[p->rx_active],
+                                      (uint16_t)CRUMBS_MESSAGE_MAX_SIZE, I2C_FIRST_FRAME) != HAL_OK)
+    {
+        p->rx_pending = 0u;
+        p->errors++;
+    }
+}
+
+/**
+ * @brief End the armed receive and dispatch what arrived.
+ *
+ * The DMA counter says how much of the buffer was filled. The other buffer
+ * becomes active first, so the frame stays intact while it is handled.
+ */
+static void crumbs_stm32_take_rx(crumbs_stm32_peripheral_t *p)
+{
+    uint8_t done;
+    size_t len;
+
+    if (!p->rx_pending)
+    {
+        return;
+    }
+    len = CRUMBS_MESSAGE_MAX_SIZE - (size_t)__HAL_DMA_GET_COUNTER(p->hi2c->hdmarx);
+    done = p->rx_active;
+    p->rx_active ^= 1u;
+    p->rx_pending = 0u;
+
+    if (len == 0u || len > CRUMBS_MESSAGE_MAX_SIZE)
+    {
+        return; /* address-only probe */
+    }
+    CRUMBS_STM32_CACHE_INVALIDATE(p->rx[done]);
+    (void)crumbs_peripheral_handle_receive(p->ctx, p->rx[done], len);
+    p->frames++;
+}
+
+/** @brief Encode the reply and start sending it; the tail is zero padding. */
+static void crumbs_stm32_start_tx(crumbs_stm32_peripheral_t *p)
+{
+    size_t len = 0u;
+
+    if (crumbs_peripheral_build_reply(p->ctx, p->tx, sizeof(p->tx), &len) != 0)
+    {
+        len = 0u;
+    }
+    memset(&p->tx[len], 0, sizeof(p->tx) - len);
+    CRUMBS_STM32_CACHE_CLEAN(p->tx);
+
+    /* Always CRUMBS_MESSAGE_MAX_SIZE bytes: a controller reading past the
+     * frame would otherwise be clock-stretched forever. Its final NACK
+     * ends the transfer early (HAL_I2C_ERROR_AF). */
+    if (HAL_I2C_Slave_Seq_Transmit_DMA(p->hi2c, p->tx, (uint16_t)CRUMBS_MESSAGE_MAX_SIZE,
+                                       I2C_LAST_FRAME) != HAL_OK)
+    {
+        p->errors++;
+        return;
+    }
+    if (len > 0u)
+    {
+        p->replies++;
+    }
+}
+
+/* ---- Public API -------------------------------------------------------- */
+
+int crumbs_stm32_init_peripheral(crumbs_stm32_peripheral_t *p, crumbs_context_t *ctx,
+                                 I2C_HandleTypeDef *hi2c, uint8_t address)
+{
+    int slot = -1;
+
+    if (!p || !ctx || !hi2c || !hi2c->hdmarx || !hi2c->hdmatx)
+    {
+        return -1;
+    }
+    /* Rebind the slot of this peripheral or handle, else take a free one. */
+    for (int i = 0; i < CRUMBS_STM32_MAX_PERIPHERALS; i++)
+    {
+        if (g_crumbs_stm32[i] == p || (g_crumbs_stm32[i] && g_crumbs_stm32[i]->hi2c == hi2c))
+        {
+            slot = i;
+            break;
+        }
+        if (!g_crumbs_stm32[i] && slot < 0)
+        {
+            slot = i;
+        }
+    }
+    if (slot < 0)
+    {
+        return -1;
+    }
+
+    memset(p, 0, sizeof(*p));
+    crumbs_init(ctx, CRUMBS_ROLE_PERIPHERAL, address);
+    p->ctx = ctx;
+    p->hi2c = hi2c;
+
+    hi2c->Init.OwnAddress1 = (uint32_t)address << 1;
+    hi2c->Init.AddressingMode = I2C_ADDRESSINGMODE_7BIT;
+    if (HAL_I2C_Init(hi2c) != HAL_OK)
+    {
+        return -2;
+    }
+
+    g_crumbs_stm32[slot] = p;
+    if (HAL_I2C_EnableListen_IT(hi2c) != HAL_OK)
+    {
+        g_crumbs_stm32[slot] = NULL;
+        return -2;
+    }
+    return 0;
+}
+
+void crumbs_stm32_close(crumbs_stm32_peripheral_t *p)
+{
+    if (!p || !p->hi2c)
+    {
+        return;
+    }
+    (void)HAL_I2C_DisableListen_IT(p->hi2c);
+    for (int i = 0; i < CRUMBS_STM32_MAX_PERIPHERALS; i++)
+    {
+        if (g_crumbs_stm32[i] == p)
+        {
+            g_crumbs_stm32[i] = NULL;
+        }
+    }
+    p->hi2c = NULL;
+}
+
+int crumbs_stm32_addr_callback(I2C_HandleTypeDef *hi2c, uint8_t direction)
+{
+    crumbs_stm32_peripheral_t *p = crumbs_stm32_find(hi2c);
+
+    if (!p)
+    {
+        return 0;
+    }
+    if (direction == I2C_DIRECTION_TRANSMIT)
+    {
+        crumbs_stm32_arm_rx(p);
+        return 1;
+    }
+
+    /* A read after a repeated START: the preceding write (usually
+     * SET_REPLY) has not seen a STOP yet, so dispatch it first. */
+    crumbs_stm32_take_rx(p);
+    crumbs_stm32_start_tx(p);
+    return 1;
+}
+
+int crumbs_stm32_listen_callback(I2C_HandleTypeDef *hi2c)
+{
+    crumbs_stm32_peripheral_t *p = crumbs_stm32_find(hi2c);
+
+    if (!p)
+    {
+        return 0;
+    }
+    crumbs_stm32_take_rx(p);
+    (void)HAL_I2C_EnableListen_IT(hi2c);
+    return 1;
+}
+
+int crumbs_stm32_error_callback(I2C_HandleTypeDef *hi2c)
+{
+    crumbs_stm32_peripheral_t *p = crumbs_stm32_find(hi2c);
+
+    if (!p)
+    {
+        return 0;
+    }
+    if (HAL_I2C_GetError(hi2c) != HAL_I2C_ERROR_AF)
+    {
+        p->errors++;
+        p->rx_pending = 0u; /* a broken write is not dispatched */
+    }
+    if (HAL_I2C_GetState(hi2c) == HAL_I2C_STATE_READY)
+    {
+        (void)HAL_I2C_EnableListen_IT(hi2c);
+    }
+    return 1;
+}
+
+#if defined(CRUMBS_STM32_DEFINE_HAL_CALLBACKS)
+
+void HAL_I2C_AddrCallback(I2C_HandleTypeDef *hi2c, uint8_t TransferDirection,
+                          uint16_t AddrMatchCode)
+{
+    (void)AddrMatchCode;
+    (void)crumbs_stm32_addr_callback(hi2c, TransferDirection);
+}
+
+void HAL_I2C_ListenCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    (void)crumbs_stm32_listen_callback(hi2c);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+    (void)crumbs_stm32_error_callback(hi2c);
+}
+
+#endif /* CRUMBS_STM32_DEFINE_HAL_CALLBACKS */
+
+#endif /* HAL_I2C_MODULE_ENABLED && HAL_DMA_MODULE_ENABLED */
+#endif /* defined(USE_HAL_DRIVER) && !defined(ARDUINO) */
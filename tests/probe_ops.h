@@ -0,0 +1,365 @@
+/**
+ * @file probe_ops.h
+ * @brief Test family covering every generator field type (Type ID 0x7E)
+ *
+ * Built by tests/test_codegen.c; not a real device.
+ *
+ * Generated by scripts/generate_family.py from probe_family.json; edit the
+ * schema and regenerate instead of editing this file.
+ *
+ * Commands:
+ * - PROBE_OP_CONFIGURE: Set every field type at once.
+ * - PROBE_OP_RESET: Reset with no payload.
+ * - PROBE_OP_GET_SAMPLE: Request the latest sample.
+ * - PROBE_OP_GET_PING: Empty reply, used as a liveness check.
+ */
+
+#ifndef PROBE_OPS_H
+#define PROBE_OPS_H
+
+#include "crumbs.h"
+#include "crumbs_ops.h"
+
+#include <string.h> /* memcpy */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ============================================================================
+ * Device Identity
+ * ============================================================================ */
+
+/** @brief Type ID for probe devices. */
+#define PROBE_TYPE_ID 0x7E
+
+/* Module protocol version (per versioning.md convention) */
+#define PROBE_MODULE_VER_MAJOR 0
+#define PROBE_MODULE_VER_MINOR 1
+#define PROBE_MODULE_VER_PATCH 0
+
+/* ============================================================================
+ * Command Definitions: SET Operations
+ * ============================================================================ */
+
+/**
+ * @brief Set every field type at once.
+ * Payload: [mode:u8][trim:i8][period:u16][offset:i16][mask:u32][bias:i32][gain:float][points:u16[3]]
+ *   - mode: Mode byte.
+ *   - trim: Signed trim.
+ *   - period: Period in ms.
+ *   - offset: Signed offset.
+ *   - mask: Channel mask.
+ *   - bias: Signed bias.
+ *   - gain: Gain factor.
+ *   - points: Calibration points.
+ */
+#define PROBE_OP_CONFIGURE 0x01
+/** @brief Payload bytes of PROBE_OP_CONFIGURE. */
+#define PROBE_OP_CONFIGURE_LEN 24u
+CRUMBS_STATIC_ASSERT(PROBE_OP_CONFIGURE_LEN <= CRUMBS_MAX_PAYLOAD, probe_configure_fits);
+
+/**
+ * @brief Reset with no payload.
+ * Payload: none
+ */
+#define PROBE_OP_RESET 0x02
+/** @brief Payload bytes of PROBE_OP_RESET. */
+#define PROBE_OP_RESET_LEN 0u
+CRUMBS_STATIC_ASSERT(PROBE_OP_RESET_LEN <= CRUMBS_MAX_PAYLOAD, probe_reset_fits);
+
+/* ============================================================================
+ * Command Definitions: GET Operations (Query State via SET_REPLY)
+ * ============================================================================ */
+
+/**
+ * @brief Request the latest sample.
+ * Payload: none
+ * Reply: [raw:i16[4]][celsius:float][uptime:u32]
+ *   - raw: Raw channel readings.
+ *   - celsius: Temperature.
+ *   - uptime: Seconds since boot.
+ */
+#define PROBE_OP_GET_SAMPLE 0x80
+/** @brief Reply payload bytes of PROBE_OP_GET_SAMPLE. */
+#define PROBE_OP_GET_SAMPLE_LEN 16u
+CRUMBS_STATIC_ASSERT(PROBE_OP_GET_SAMPLE_LEN <= CRUMBS_MAX_PAYLOAD, probe_sample_fits);
+
+/**
+ * @brief Empty reply, used as a liveness check.
+ * Payload: none
+ * Reply: none
+ */
+#define PROBE_OP_GET_PING 0x81
+/** @brief Reply payload bytes of PROBE_OP_GET_PING. */
+#define PROBE_OP_GET_PING_LEN 0u
+CRUMBS_STATIC_ASSERT(PROBE_OP_GET_PING_LEN <= CRUMBS_MAX_PAYLOAD, probe_ping_fits);
+
+    /* ============================================================================
+     * Controller Side: Command Senders
+     * ============================================================================ */
+
+    /**
+     * @brief Pack PROBE_OP_CONFIGURE into @p m (no bounds checks needed).
+     */
+    static inline void probe_pack_configure(crumbs_message_t *m,
+                                            uint8_t mode,
+                                            int8_t trim,
+                                            uint16_t period,
+                                            int16_t offset,
+                                            uint32_t mask,
+                                            int32_t bias,
+                                            float gain,
+                                            const uint16_t points[3])
+    {
+        m->type_id = PROBE_TYPE_ID;
+        m->opcode = PROBE_OP_CONFIGURE;
+        m->data_len = (uint8_t)PROBE_OP_CONFIGURE_LEN;
+        m->data[0] = (uint8_t)mode;
+        m->data[1] = (uint8_t)trim;
+        m->data[2] = (uint8_t)(period & 0xFFu);
+        m->data[3] = (uint8_t)(period >> 8);
+        m->data[4] = (uint8_t)((uint16_t)offset & 0xFFu);
+        m->data[5] = (uint8_t)((uint16_t)offset >> 8);
+        m->data[6] = (uint8_t)(mask & 0xFFu);
+        m->data[7] = (uint8_t)(mask >> 8);
+        m->data[8] = (uint8_t)(mask >> 16);
+        m->data[9] = (uint8_t)(mask >> 24);
+        m->data[10] = (uint8_t)((uint32_t)bias & 0xFFu);
+        m->data[11] = (uint8_t)((uint32_t)bias >> 8);
+        m->data[12] = (uint8_t)((uint32_t)bias >> 16);
+        m->data[13] = (uint8_t)((uint32_t)bias >> 24);
+        memcpy(&m->data[14], &gain, sizeof(float));
+        m->data[18] = (uint8_t)(points[0] & 0xFFu);
+        m->data[19] = (uint8_t)(points[0] >> 8);
+        m->data[20] = (uint8_t)(points[1] & 0xFFu);
+        m->data[21] = (uint8_t)(points[1] >> 8);
+        m->data[22] = (uint8_t)(points[2] & 0xFFu);
+        m->data[23] = (uint8_t)(points[2] >> 8);
+    }
+
+    /**
+     * @brief Set every field type at once.
+     *
+     * @param dev Bound device handle (see crumbs_device_t).
+     * @param mode Mode byte.
+     * @param trim Signed trim.
+     * @param period Period in ms.
+     * @param offset Signed offset.
+     * @param mask Channel mask.
+     * @param bias Signed bias.
+     * @param gain Gain factor.
+     * @param points Calibration points.
+     * @return 0 on success, non-zero on error.
+     */
+    static inline int probe_send_configure(const crumbs_device_t *dev,
+                                           uint8_t mode,
+                                           int8_t trim,
+                                           uint16_t period,
+                                           int16_t offset,
+                                           uint32_t mask,
+                                           int32_t bias,
+                                           float gain,
+                                           const uint16_t points[3])
+    {
+        crumbs_message_t msg;
+        probe_pack_configure(&msg, mode, trim, period, offset, mask, bias, gain, points);
+        return crumbs_controller_send(dev->ctx, dev->addr, &msg, dev->write_fn, dev->io);
+    }
+
+    /**
+     * @brief Pack PROBE_OP_RESET into @p m (no bounds checks needed).
+     */
+    static inline void probe_pack_reset(crumbs_message_t *m)
+    {
+        m->type_id = PROBE_TYPE_ID;
+        m->opcode = PROBE_OP_RESET;
+        m->data_len = (uint8_t)PROBE_OP_RESET_LEN;
+    }
+
+    /**
+     * @brief Reset with no payload.
+     *
+     * @param dev Bound device handle (see crumbs_device_t).
+     * @return 0 on success, non-zero on error.
+     */
+    static inline int probe_send_reset(const crumbs_device_t *dev)
+    {
+        crumbs_message_t msg;
+        probe_pack_reset(&msg);
+        return crumbs_controller_send(dev->ctx, dev->addr, &msg, dev->write_fn, dev->io);
+    }
+
+    /* ============================================================================
+     * Controller Side: Combined Query + Read (Receiver API)
+     * ============================================================================ */
+
+    /**
+     * @brief Result struct for PROBE_OP_GET_SAMPLE.
+     */
+    typedef struct
+    {
+        int16_t raw[4];  /**< Raw channel readings. */
+        float celsius;   /**< Temperature. */
+        uint32_t uptime; /**< Seconds since boot. */
+    } probe_sample_result_t;
+
+    /**
+     * @brief Parse a PROBE_OP_GET_SAMPLE reply payload (one length check).
+     *
+     * @return 0 on success, -1 if @p len is short or a pointer is NULL.
+     */
+    static inline int probe_parse_sample(const uint8_t *data,
+                                         size_t len,
+                                         probe_sample_result_t *out)
+    {
+        if (!data || !out || len < PROBE_OP_GET_SAMPLE_LEN)
+            return -1;
+        out->raw[0] = (int16_t)((uint16_t)data[0] | ((uint16_t)data[1] << 8));
+        out->raw[1] = (int16_t)((uint16_t)data[2] | ((uint16_t)data[3] << 8));
+        out->raw[2] = (int16_t)((uint16_t)data[4] | ((uint16_t)data[5] << 8));
+        out->raw[3] = (int16_t)((uint16_t)data[6] | ((uint16_t)data[7] << 8));
+        memcpy(&out->celsius, &data[8], sizeof(float));
+        out->uptime = (uint32_t)((uint32_t)data[12] | ((uint32_t)data[13] << 8) | ((uint32_t)data[14] << 16) | ((uint32_t)data[15] << 24));
+        return 0;
+    }
+
+    CRUMBS_DEFINE_GET_OP_LEN(probe, sample, PROBE_TYPE_ID, PROBE_OP_GET_SAMPLE,
+                             probe_sample_result_t, probe_parse_sample, PROBE_OP_GET_SAMPLE_LEN)
+
+    /**
+     * @brief Result struct for PROBE_OP_GET_PING.
+     */
+    typedef struct
+    {
+        uint8_t _unused; /**< The reply carries no payload. */
+    } probe_ping_result_t;
+
+    /**
+     * @brief Parse a PROBE_OP_GET_PING reply payload (one length check).
+     *
+     * @return 0 on success, -1 if @p len is short or a pointer is NULL.
+     */
+    static inline int probe_parse_ping(const uint8_t *data,
+                                       size_t len,
+                                       probe_ping_result_t *out)
+    {
+        (void)data;
+        (void)len;
+        if (!out)
+            return -1;
+        return 0;
+    }
+
+    CRUMBS_DEFINE_GET_OP_LEN(probe, ping, PROBE_TYPE_ID, PROBE_OP_GET_PING,
+                             probe_ping_result_t, probe_parse_ping, PROBE_OP_GET_PING_LEN)
+
+    /* ============================================================================
+     * Peripheral Side: Payload Decoders and Reply Builders
+     * ============================================================================ */
+
+    /**
+     * @brief Decoded PROBE_OP_CONFIGURE payload.
+     */
+    typedef struct
+    {
+        uint8_t mode;       /**< Mode byte. */
+        int8_t trim;        /**< Signed trim. */
+        uint16_t period;    /**< Period in ms. */
+        int16_t offset;     /**< Signed offset. */
+        uint32_t mask;      /**< Channel mask. */
+        int32_t bias;       /**< Signed bias. */
+        float gain;         /**< Gain factor. */
+        uint16_t points[3]; /**< Calibration points. */
+    } probe_configure_args_t;
+
+    /**
+     * @brief Decode a PROBE_OP_CONFIGURE payload in a command handler (one length check).
+     *
+     * @return 0 on success, -1 if @p len is short or a pointer is NULL.
+     */
+    static inline int probe_unpack_configure(const uint8_t *data,
+                                             uint8_t len,
+                                             probe_configure_args_t *out)
+    {
+        if (!data || !out || len < PROBE_OP_CONFIGURE_LEN)
+            return -1;
+        out->mode = (uint8_t)data[0];
+        out->trim = (int8_t)data[1];
+        out->period = (uint16_t)((uint16_t)data[2] | ((uint16_t)data[3] << 8));
+        out->offset = (int16_t)((uint16_t)data[4] | ((uint16_t)data[5] << 8));
+        out->mask = (uint32_t)((uint32_t)data[6] | ((uint32_t)data[7] << 8) | ((uint32_t)data[8] << 16) | ((uint32_t)data[9] << 24));
+        out->bias = (int32_t)((uint32_t)data[10] | ((uint32_t)data[11] << 8) | ((uint32_t)data[12] << 16) | ((uint32_t)data[13] << 24));
+        memcpy(&out->gain, &data[14], sizeof(float));
+        out->points[0] = (uint16_t)((uint16_t)data[18] | ((uint16_t)data[19] << 8));
+        out->points[1] = (uint16_t)((uint16_t)data[20] | ((uint16_t)data[21] << 8));
+        out->points[2] = (uint16_t)((uint16_t)data[22] | ((uint16_t)data[23] << 8));
+        return 0;
+    }
+
+    /**
+     * @brief Decoded PROBE_OP_RESET payload.
+     */
+    typedef struct
+    {
+        uint8_t _unused; /**< The command carries no payload. */
+    } probe_reset_args_t;
+
+    /**
+     * @brief Decode a PROBE_OP_RESET payload in a command handler (one length check).
+     *
+     * @return 0 on success, -1 if @p len is short or a pointer is NULL.
+     */
+    static inline int probe_unpack_reset(const uint8_t *data,
+                                         uint8_t len,
+                                         probe_reset_args_t *out)
+    {
+        (void)data;
+        (void)len;
+        if (!out)
+            return -1;
+        return 0;
+    }
+
+    /**
+     * @brief Fill a PROBE_OP_GET_SAMPLE reply from a reply handler.
+     */
+    static inline void probe_reply_sample(crumbs_message_t *reply,
+                                          const probe_sample_result_t *v)
+    {
+        reply->type_id = PROBE_TYPE_ID;
+        reply->opcode = PROBE_OP_GET_SAMPLE;
+        reply->data_len = (uint8_t)PROBE_OP_GET_SAMPLE_LEN;
+        reply->data[0] = (uint8_t)((uint16_t)v->raw[0] & 0xFFu);
+        reply->data[1] = (uint8_t)((uint16_t)v->raw[0] >> 8);
+        reply->data[2] = (uint8_t)((uint16_t)v->raw[1] & 0xFFu);
+        reply->data[3] = (uint8_t)((uint16_t)v->raw[1] >> 8);
+        reply->data[4] = (uint8_t)((uint16_t)v->raw[2] & 0xFFu);
+        reply->data[5] = (uint8_t)((uint16_t)v->raw[2] >> 8);
+        reply->data[6] = (uint8_t)((uint16_t)v->raw[3] & 0xFFu);
+        reply->data[7] = (uint8_t)((uint16_t)v->raw[3] >> 8);
+        memcpy(&reply->data[8], &v->celsius, sizeof(float));
+        reply->data[12] = (uint8_t)(v->uptime & 0xFFu);
+        reply->data[13] = (uint8_t)(v->uptime >> 8);
+        reply->data[14] = (uint8_t)(v->uptime >> 16);
+        reply->data[15] = (uint8_t)(v->uptime >> 24);
+    }
+
+    /**
+     * @brief Fill a PROBE_OP_GET_PING reply from a reply handler.
+     */
+    static inline void probe_reply_ping(crumbs_message_t *reply,
+                                        const probe_ping_result_t *v)
+    {
+        (void)v;
+        reply->type_id = PROBE_TYPE_ID;
+        reply->opcode = PROBE_OP_GET_PING;
+        reply->data_len = (uint8_t)PROBE_OP_GET_PING_LEN;
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PROBE_OPS_H */
@@ -0,0 +1,237 @@
+/*
+ * Tests for the attention line: the pin follows crumbs_raise_attention()
+ * until a reply is delivered, alert-response arbitration on the virtual
+ * bus, and scheduler tasks that only run when their device asks. Built
+ * with CRUMBS_ENABLE_ATTENTION=1.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_engine.h"
+#include "crumbs_sched.h"
+#include "crumbs_vbus.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define OP_STATUS 0x30
+#define FLEET 8
+#define MIN_INTERVAL_US 20000u
+
+static int g_pin = -1; /* level driven by the last pin call */
+static int g_pin_calls;
+static int g_not_ready;
+
+static void pin_write(void *user_data, int asserted)
+{
+    (void)user_data;
+    g_pin = asserted;
+    g_pin_calls++;
+}
+
+static void reply_status(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)user_data;
+    if (g_not_ready > 0)
+    {
+        g_not_ready--;
+        crumbs_reply_not_ready(reply);
+        return;
+    }
+    reply->type_id = 0x07;
+    reply->opcode = OP_STATUS;
+    reply->data_len = 1u;
+    reply->data[0] = ctx->address;
+}
+
+static void setup_periph(crumbs_context_t *p, uint8_t addr)
+{
+    crumbs_init(p, CRUMBS_ROLE_PERIPHERAL, addr);
+    crumbs_register_reply_handler(p, OP_STATUS, reply_status, NULL);
+}
+
+static void read_reply(crumbs_context_t *p, crumbs_message_t *reply)
+{
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t len = 0u;
+    memset(reply, 0, sizeof(*reply));
+    crumbs_peripheral_build_reply(p, frame, sizeof(frame), &len);
+    crumbs_decode_message(frame, len, reply, NULL);
+}
+
+/* Controller main loop: service the line, poll, let 100 us pass. */
+static void run_for(crumbs_vbus_t *bus, crumbs_sched_t *sched, uint32_t span_us)
+{
+    uint32_t start = crumbs_vbus_now_us(bus);
+    while (crumbs_vbus_now_us(bus) - start < span_us)
+    {
+        uint32_t now = crumbs_vbus_now_us(bus);
+        if (crumbs_vbus_alert(bus) && !sched->eng->head)
+        {
+            crumbs_sched_service_alert(sched, crumbs_vbus_read, bus, now);
+        }
+        crumbs_sched_poll(sched, now);
+        crumbs_vbus_advance_us(bus, 100u);
+    }
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_pin_follows_attention(void)
+{
+    const char *name = "line held until a reply is delivered";
+    crumbs_context_t p;
+    crumbs_message_t reply;
+    uint8_t ara = 0u;
+
+    setup_periph(&p, 0x21);
+    g_pin = -1;
+    TEST_ASSERT_EQ(name, crumbs_set_attention_pin(&p, pin_write, NULL), 0, "set pin");
+    TEST_ASSERT_EQ(name, g_pin, 0, "released on install");
+    TEST_ASSERT_EQ(name, crumbs_peripheral_alert_response(&p, &ara), 0, "quiet");
+
+    crumbs_raise_attention(&p);
+    TEST_ASSERT_EQ(name, g_pin, 1, "asserted");
+    TEST_ASSERT(name, crumbs_attention_pending(&p), "pending");
+
+    /* NOT_READY is no answer yet. */
+    p.requested_opcode = OP_STATUS;
+    g_not_ready = 1;
+    read_reply(&p, &reply);
+    TEST_ASSERT_EQ(name, reply.opcode, CRUMBS_CMD_NOT_READY, "not ready");
+    TEST_ASSERT_EQ(name, g_pin, 1, "still asserted");
+    read_reply(&p, &reply);
+    TEST_ASSERT_EQ(name, reply.opcode, OP_STATUS, "status");
+    TEST_ASSERT_EQ(name, g_pin, 0, "released by the reply");
+
+    crumbs_raise_attention(&p);
+    TEST_ASSERT_EQ(name, crumbs_peripheral_alert_response(&p, &ara), 1, "answers");
+    TEST_ASSERT_EQ(name, ara, 0x21 << 1, "address in bits 7..1");
+    TEST_ASSERT_EQ(name, g_pin, 0, "released by the alert response");
+
+    crumbs_raise_attention(&p);
+    crumbs_clear_attention(&p);
+    TEST_ASSERT(name, !crumbs_attention_pending(&p), "cleared");
+    TEST_ASSERT_EQ(name, crumbs_set_attention_pin(NULL, pin_write, NULL), -1, "NULL ctx");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_alert_arbitration(void)
+{
+    const char *name = "alert response picks the lowest address";
+    crumbs_vbus_t bus;
+    crumbs_context_t p[3];
+    uint8_t addr = 0u;
+
+    crumbs_vbus_init(&bus, 100000u);
+    for (uint8_t i = 0; i < 3u; i++)
+    {
+        setup_periph(&p[i], (uint8_t)(0x12 - i));
+        crumbs_vbus_attach(&bus, &p[i], 0u, 0u);
+    }
+
+    TEST_ASSERT(name, !crumbs_vbus_alert(&bus), "idle line");
+    TEST_ASSERT_EQ(name, crumbs_controller_alert_response(crumbs_vbus_read, &bus, &addr), 0, "nobody");
+
+    crumbs_raise_attention(&p[0]); /* 0x12 */
+    crumbs_raise_attention(&p[1]); /* 0x11 */
+    TEST_ASSERT(name, crumbs_vbus_alert(&bus), "line low");
+    TEST_ASSERT_EQ(name, crumbs_controller_alert_response(crumbs_vbus_read, &bus, &addr), 1, "first");
+    TEST_ASSERT_EQ(name, addr, 0x11, "lowest wins");
+    TEST_ASSERT(name, crumbs_vbus_alert(&bus), "0x12 still asserts");
+    TEST_ASSERT_EQ(name, crumbs_controller_alert_response(crumbs_vbus_read, &bus, &addr), 1, "second");
+    TEST_ASSERT_EQ(name, addr, 0x12, "next");
+    TEST_ASSERT(name, !crumbs_vbus_alert(&bus), "line released");
+    TEST_ASSERT_EQ(name, crumbs_controller_alert_response(crumbs_vbus_read, &bus, &addr), 0, "done");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_sched_on_attention(void)
+{
+    const char *name = "scheduler polls only on attention";
+    crumbs_vbus_t bus;
+    crumbs_context_t p[FLEET], ctrl;
+    crumbs_device_t dev[FLEET];
+    crumbs_engine_t eng;
+    crumbs_sched_t sched;
+
+    crumbs_vbus_init(&bus, 100000u);
+    crumbs_vbus_use(&bus);
+    test_init_controller(&ctrl);
+    crumbs_engine_init(&eng);
+    crumbs_sched_init(&sched, &eng);
+    for (uint8_t i = 0; i < FLEET; i++)
+    {
+        setup_periph(&p[i], (uint8_t)(0x20 + i));
+        crumbs_vbus_attach(&bus, &p[i], 0u, 0u);
+        crumbs_vbus_bind(&bus, &dev[i], &ctrl, (uint8_t)(0x20 + i));
+        int idx = crumbs_sched_add_on_attention(&sched, &dev[i], OP_STATUS, 1u, MIN_INTERVAL_US, 0u, NULL, NULL);
+        TEST_ASSERT_EQ(name, idx, i, "add");
+        sched.tasks[idx].req.delay_us = 300u;
+    }
+
+    /* Idle fleet: no traffic at all. */
+    run_for(&bus, &sched, 1000000u);
+    TEST_ASSERT_EQ(name, bus.transfers, 0, "silent while idle");
+    TEST_ASSERT_EQ(name, sched.tasks[0].runs, 0, "no runs");
+
+    /* One device raises the line. */
+    uint32_t t0 = bus.transfers;
+    crumbs_raise_attention(&p[5]);
+    run_for(&bus, &sched, 20000u);
+    TEST_ASSERT_EQ(name, sched.tasks[5].runs, 1, "device 5 polled once");
+    TEST_ASSERT_EQ(name, sched.tasks[4].runs, 0, "others left alone");
+    TEST_ASSERT(name, sched.tasks[5].last_latency_us < 1000u, "well under a poll period");
+    TEST_ASSERT_EQ(name, bus.transfers - t0, 4, "two alert reads, SET_REPLY, read");
+    TEST_ASSERT(name, !crumbs_vbus_alert(&bus), "released");
+
+    /* Attentions closer than the interval are merged. */
+    crumbs_raise_attention(&p[7]);
+    run_for(&bus, &sched, 500u);
+    crumbs_raise_attention(&p[7]);
+    run_for(&bus, &sched, 500u);
+    crumbs_raise_attention(&p[7]);
+    run_for(&bus, &sched, MIN_INTERVAL_US + 5000u);
+    TEST_ASSERT_EQ(name, sched.tasks[7].runs, 2, "first run, then one merged run");
+
+    /* A device that cannot answer the alert response: everyone is asked. */
+    crumbs_vbus_device(&bus, 0x23)->alert_response = 0u;
+    crumbs_raise_attention(&p[3]);
+    run_for(&bus, &sched, 20000u);
+    TEST_ASSERT(name, !crumbs_vbus_alert(&bus), "released by its reply");
+    TEST_ASSERT_EQ(name, sched.tasks[3].runs, 1, "sender polled");
+    TEST_ASSERT_EQ(name, sched.tasks[0].runs, 1, "fallback polls all");
+    TEST_ASSERT_EQ(name, sched.tasks[0].errors, 0, "no errors");
+
+    TEST_ASSERT_EQ(name, crumbs_sched_attention(&sched, 0x7Eu, 0u), 0, "unknown address");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Attention line tests:\n");
+
+    failures += test_pin_follows_attention();
+    failures += test_alert_arbitration();
+    failures += test_sched_on_attention();
+
+    if (failures == 0)
+    {
+        printf("All attention line tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d attention line test(s) failed.\n", failures);
+    return 1;
+}
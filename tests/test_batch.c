@@ -0,0 +1,208 @@
+/*
+ * Tests for CRUMBS_CMD_BATCH frames: packing with crumbs_fb_add_record()
+ * and in-order dispatch of each record on the peripheral.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define MAX_CALLS 16
+
+typedef struct
+{
+    uint8_t opcode;
+    uint8_t len;
+    uint8_t first;
+} call_t;
+
+static call_t g_calls[MAX_CALLS];
+static int g_ncalls;
+static int g_nmessages;
+
+static void record_handler(crumbs_context_t *ctx, uint8_t opcode,
+                           const uint8_t *data, uint8_t data_len, void *user_data)
+{
+    (void)ctx;
+    (void)user_data;
+    if (g_ncalls < MAX_CALLS)
+    {
+        g_calls[g_ncalls].opcode = opcode;
+        g_calls[g_ncalls].len = data_len;
+        g_calls[g_ncalls].first = data_len ? data[0] : 0u;
+    }
+    g_ncalls++;
+}
+
+static void count_message(crumbs_context_t *ctx, const crumbs_message_t *m)
+{
+    (void)ctx;
+    (void)m;
+    g_nmessages++;
+}
+
+static void setup(crumbs_context_t *ctx)
+{
+    test_init_peripheral(ctx);
+    crumbs_register_handler(ctx, 0x01, record_handler, NULL);
+    crumbs_register_handler(ctx, 0x02, record_handler, NULL);
+    crumbs_register_handler(ctx, 0x03, record_handler, NULL);
+    g_ncalls = 0;
+    g_nmessages = 0;
+}
+
+static int deliver(crumbs_context_t *ctx, crumbs_frame_builder_t *fb)
+{
+    size_t n = crumbs_fb_finish(fb);
+    return crumbs_peripheral_handle_receive(ctx, fb->frame, n);
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_dispatch_in_order(void)
+{
+    const char *name = "records dispatched in order";
+    crumbs_context_t ctx;
+    crumbs_frame_builder_t fb;
+    const uint8_t two[2] = {0xAA, 0xBB};
+
+    setup(&ctx);
+    crumbs_set_callbacks(&ctx, count_message, NULL, NULL);
+
+    crumbs_fb_init(&fb, 0x42, CRUMBS_CMD_BATCH);
+    TEST_ASSERT_EQ(name, crumbs_fb_add_record(&fb, 0x02, two, 2), 0, "add 1");
+    TEST_ASSERT_EQ(name, crumbs_fb_add_record(&fb, 0x01, NULL, 0), 0, "add 2");
+    TEST_ASSERT_EQ(name, crumbs_fb_add_record(&fb, 0x03, &two[1], 1), 0, "add 3");
+    TEST_ASSERT_EQ(name, deliver(&ctx, &fb), 0, "receive");
+
+    TEST_ASSERT_EQ(name, g_ncalls, 3, "handler calls");
+    TEST_ASSERT_EQ(name, g_calls[0].opcode, 0x02, "first opcode");
+    TEST_ASSERT_EQ(name, g_calls[0].len, 2, "first len");
+    TEST_ASSERT_EQ(name, g_calls[0].first, 0xAA, "first data");
+    TEST_ASSERT_EQ(name, g_calls[1].opcode, 0x01, "second opcode");
+    TEST_ASSERT_EQ(name, g_calls[1].len, 0, "second len");
+    TEST_ASSERT_EQ(name, g_calls[2].opcode, 0x03, "third opcode");
+    TEST_ASSERT_EQ(name, g_calls[2].first, 0xBB, "third data");
+    TEST_ASSERT_EQ(name, g_nmessages, 3, "on_message per record");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_capacity(void)
+{
+    const char *name = "nine one-byte records per frame";
+    crumbs_context_t ctx;
+    crumbs_frame_builder_t fb;
+    int added = 0;
+
+    setup(&ctx);
+    crumbs_fb_init(&fb, 0x42, CRUMBS_CMD_BATCH);
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        if (crumbs_fb_add_record(&fb, 0x01, &i, 1) != 0)
+            break;
+        added++;
+    }
+    TEST_ASSERT_EQ(name, added, 9, "records that fit");
+    TEST_ASSERT_EQ(name, fb.data_len, CRUMBS_MAX_PAYLOAD, "frame full");
+    TEST_ASSERT_EQ(name, crumbs_fb_add_record(&fb, 0x01, NULL, 0), -1, "empty record rejected when full");
+
+    TEST_ASSERT_EQ(name, deliver(&ctx, &fb), 0, "receive");
+    TEST_ASSERT_EQ(name, g_ncalls, 9, "handler calls");
+    TEST_ASSERT_EQ(name, g_calls[8].first, 8, "last record data");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_malformed_and_nested(void)
+{
+    const char *name = "truncated batch dropped, nested skipped";
+    crumbs_context_t ctx;
+    crumbs_message_t m;
+    uint8_t buf[CRUMBS_MESSAGE_MAX_SIZE];
+
+    /* [0x01][1][x] [0x02][5][only two bytes] -> nothing dispatched */
+    setup(&ctx);
+    test_msg_init(&m, 0x42, CRUMBS_CMD_BATCH);
+    const uint8_t bad[] = {0x01, 1, 0x11, 0x02, 5, 0x22, 0x33};
+    memcpy(m.data, bad, sizeof(bad));
+    m.data_len = sizeof(bad);
+    TEST_ASSERT_EQ(name, crumbs_peripheral_handle_receive(&ctx, buf, test_encode(&m, buf)), 0,
+                   "receive");
+    TEST_ASSERT_EQ(name, g_ncalls, 0, "truncated batch must not dispatch");
+
+    /* Odd trailing byte is also a truncated record header. */
+    const uint8_t odd[] = {0x01, 0, 0x02};
+    memcpy(m.data, odd, sizeof(odd));
+    m.data_len = sizeof(odd);
+    crumbs_peripheral_handle_receive(&ctx, buf, test_encode(&m, buf));
+    TEST_ASSERT_EQ(name, g_ncalls, 0, "trailing byte must not dispatch");
+
+    /* Nested BATCH record is skipped, the rest still run. */
+    const uint8_t nested[] = {CRUMBS_CMD_BATCH, 2, 0x01, 0, 0x03, 1, 0x44};
+    memcpy(m.data, nested, sizeof(nested));
+    m.data_len = sizeof(nested);
+    crumbs_peripheral_handle_receive(&ctx, buf, test_encode(&m, buf));
+    TEST_ASSERT_EQ(name, g_ncalls, 1, "only the outer record runs");
+    TEST_ASSERT_EQ(name, g_calls[0].opcode, 0x03, "outer record opcode");
+
+    /* An empty batch is valid and does nothing. */
+    m.data_len = 0;
+    TEST_ASSERT_EQ(name, crumbs_peripheral_handle_receive(&ctx, buf, test_encode(&m, buf)), 0,
+                   "empty batch");
+    TEST_ASSERT_EQ(name, g_ncalls, 1, "empty batch dispatches nothing");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_set_reply_record(void)
+{
+    const char *name = "SET_REPLY inside a batch";
+    crumbs_context_t ctx;
+    crumbs_frame_builder_t fb;
+    uint8_t target = 0x81;
+    uint8_t v = 7;
+
+    setup(&ctx);
+    crumbs_fb_init(&fb, 0x42, CRUMBS_CMD_BATCH);
+    crumbs_fb_add_record(&fb, 0x01, &v, 1);
+    crumbs_fb_add_record(&fb, CRUMBS_CMD_SET_REPLY, &target, 1);
+    deliver(&ctx, &fb);
+
+    TEST_ASSERT_EQ(name, g_ncalls, 1, "command record");
+    TEST_ASSERT_EQ(name, ctx.requested_opcode, 0x81, "requested_opcode");
+    TEST_ASSERT(name, (crumbs_peripheral_capabilities(&ctx) & CRUMBS_CAP_BATCH) != 0u,
+                "batch capability");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Batch frame tests:\n");
+
+    failures += test_dispatch_in_order();
+    failures += test_capacity();
+    failures += test_malformed_and_nested();
+    failures += test_set_reply_record();
+
+    if (failures == 0)
+    {
+        printf("All batch frame tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d batch frame test(s) failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,202 @@
+/*
+ * Tests for general-call broadcasts: the BROADCAST wire format, fan-out
+ * to a fleet on the virtual bus in one transaction, type filtering and
+ * the broadcast mark seen by handlers. Built with CRUMBS_ENABLE_BROADCAST=1.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_vbus.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define LED_TYPE 0x01
+#define CALC_TYPE 0x03
+#define OP_BRIGHTNESS 0x05
+#define FLEET 20
+
+static crumbs_vbus_t g_bus;
+static crumbs_context_t g_periph[FLEET];
+static int g_calls;
+static int g_broadcast_calls;
+static uint8_t g_value;
+
+static uint8_t g_frame[CRUMBS_MESSAGE_MAX_SIZE + 1];
+static size_t g_frame_len;
+static uint8_t g_frame_addr;
+
+static void on_brightness(crumbs_context_t *ctx, uint8_t opcode, const uint8_t *data,
+                          uint8_t data_len, void *user_data)
+{
+    (void)opcode;
+    (void)user_data;
+    g_calls++;
+    g_broadcast_calls += crumbs_is_broadcast(ctx);
+    g_value = data_len ? data[0] : 0u;
+}
+
+static int capture_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    (void)user_ctx;
+    g_frame_addr = addr;
+    g_frame_len = len;
+    memcpy(g_frame, data, len);
+    return 0;
+}
+
+static void brightness(crumbs_message_t *m, uint8_t type_id, uint8_t value)
+{
+    test_msg_create(m, type_id, OP_BRIGHTNESS, &value, 1);
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_wire_format(void)
+{
+    const char *name = "broadcast frame layout";
+    crumbs_context_t ctrl;
+    crumbs_message_t m;
+    uint8_t big[CRUMBS_MAX_PAYLOAD] = {0};
+
+    test_init_controller(&ctrl);
+    brightness(&m, LED_TYPE, 0x80);
+    TEST_ASSERT_EQ(name, crumbs_controller_broadcast(&ctrl, &m, capture_write, NULL), 0, "send");
+    TEST_ASSERT_EQ(name, g_frame_addr, CRUMBS_BROADCAST_ADDR, "general-call address");
+    TEST_ASSERT_SIZE_EQ(name, g_frame_len, 6u, "one extra byte");
+    TEST_ASSERT_EQ(name, g_frame[0], LED_TYPE, "type_id kept");
+    TEST_ASSERT_EQ(name, g_frame[1], CRUMBS_CMD_BROADCAST, "opcode");
+    TEST_ASSERT_EQ(name, g_frame[2], 2, "len");
+    TEST_ASSERT_EQ(name, g_frame[3], OP_BRIGHTNESS, "inner opcode");
+    TEST_ASSERT_EQ(name, g_frame[4], 0x80, "data");
+    TEST_ASSERT_EQ(name, g_frame[5], crumbs_crc8(g_frame, 5), "crc");
+
+    test_msg_create(&m, LED_TYPE, OP_BRIGHTNESS, big, CRUMBS_BROADCAST_MAX_PAYLOAD);
+    TEST_ASSERT_EQ(name, crumbs_controller_broadcast(&ctrl, &m, capture_write, NULL), 0, "largest");
+    test_msg_create(&m, LED_TYPE, OP_BRIGHTNESS, big, CRUMBS_MAX_PAYLOAD);
+    TEST_ASSERT(name, crumbs_controller_broadcast(&ctrl, &m, capture_write, NULL) != 0, "oversize");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_fan_out(void)
+{
+    const char *name = "one transaction reaches the fleet";
+    crumbs_context_t ctrl;
+    crumbs_message_t m;
+
+    test_init_controller(&ctrl);
+    crumbs_vbus_init(&g_bus, 100000u);
+    for (int i = 0; i < FLEET; i++)
+    {
+        test_init_peripheral(&g_periph[i]);
+        g_periph[i].address = (uint8_t)(0x10 + i);
+        crumbs_register_handler(&g_periph[i], OP_BRIGHTNESS, on_brightness, NULL);
+        crumbs_peripheral_set_broadcast(&g_periph[i], 1, LED_TYPE);
+        crumbs_vbus_attach(&g_bus, &g_periph[i], 0u, 0u)->general_call = 1u;
+    }
+    g_calls = 0;
+    g_broadcast_calls = 0;
+
+    brightness(&m, LED_TYPE, 42);
+    TEST_ASSERT_EQ(name, crumbs_controller_broadcast(&ctrl, &m, crumbs_vbus_write, &g_bus), 0, "broadcast");
+    TEST_ASSERT_EQ(name, g_calls, FLEET, "every handler ran");
+    TEST_ASSERT_EQ(name, g_broadcast_calls, FLEET, "marked as broadcast");
+    TEST_ASSERT_EQ(name, g_value, 42, "payload");
+    TEST_ASSERT_EQ(name, g_bus.transfers, 1, "single transfer");
+    /* START + 7 bytes x 9 clocks + STOP: one byte longer than a directed SET. */
+    uint32_t one = crumbs_vbus_now_us(&g_bus);
+    TEST_ASSERT_EQ(name, one, 650, "one transaction of bus time");
+
+    /* The same value sent device by device: 560 us each. */
+    for (int i = 0; i < FLEET; i++)
+        crumbs_controller_send(&ctrl, (uint8_t)(0x10 + i), &m, crumbs_vbus_write, &g_bus);
+    uint32_t each = crumbs_vbus_now_us(&g_bus) - one;
+    TEST_ASSERT_EQ(name, each, FLEET * 560, "O(N) versus one");
+    TEST_ASSERT_EQ(name, g_broadcast_calls, FLEET, "directed frames not marked");
+    TEST_ASSERT_EQ(name, crumbs_is_broadcast(&g_periph[0]), 0, "mark cleared after dispatch");
+
+    /* Nobody listening: NACK. */
+    for (int i = 0; i < FLEET; i++)
+        g_bus.devices[i].general_call = 0u;
+    TEST_ASSERT(name, crumbs_controller_broadcast(&ctrl, &m, crumbs_vbus_write, &g_bus) != 0, "NACK");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_filtering(void)
+{
+    const char *name = "type filter and disabled reception";
+    crumbs_context_t p;
+    crumbs_context_t ctrl;
+    crumbs_message_t m;
+
+    test_init_controller(&ctrl);
+    test_init_peripheral(&p);
+    crumbs_register_handler(&p, OP_BRIGHTNESS, on_brightness, NULL);
+    g_calls = 0;
+
+    /* Off: the frame is an ordinary unhandled opcode. */
+    brightness(&m, LED_TYPE, 1);
+    crumbs_controller_broadcast(&ctrl, &m, capture_write, NULL);
+    TEST_ASSERT_EQ(name, crumbs_peripheral_handle_receive(&p, g_frame, g_frame_len), 0, "rx");
+    TEST_ASSERT_EQ(name, g_calls, 0, "not unwrapped while off");
+    TEST_ASSERT_EQ(name, crumbs_peripheral_capabilities(&p) & CRUMBS_CAP_BROADCAST, 0, "no cap");
+
+    crumbs_peripheral_set_broadcast(&p, 1, CALC_TYPE);
+    TEST_ASSERT(name, crumbs_peripheral_capabilities(&p) & CRUMBS_CAP_BROADCAST, "cap");
+    crumbs_peripheral_handle_receive(&p, g_frame, g_frame_len);
+    TEST_ASSERT_EQ(name, g_calls, 0, "other type dropped");
+
+    brightness(&m, 0x00, 2);
+    crumbs_controller_broadcast(&ctrl, &m, capture_write, NULL);
+    crumbs_peripheral_handle_receive(&p, g_frame, g_frame_len);
+    TEST_ASSERT_EQ(name, g_calls, 1, "type 0 reaches every type");
+
+    crumbs_peripheral_set_broadcast(&p, 1, 0x00);
+    brightness(&m, LED_TYPE, 3);
+    crumbs_controller_broadcast(&ctrl, &m, capture_write, NULL);
+    crumbs_peripheral_handle_receive(&p, g_frame, g_frame_len);
+    TEST_ASSERT_EQ(name, g_calls, 2, "any type accepted");
+
+    /* A nested broadcast is dropped rather than unwrapped twice. */
+    test_msg_create(&m, LED_TYPE, CRUMBS_CMD_BROADCAST, NULL, 0);
+    crumbs_controller_broadcast(&ctrl, &m, capture_write, NULL);
+    crumbs_peripheral_handle_receive(&p, g_frame, g_frame_len);
+    TEST_ASSERT_EQ(name, g_calls, 2, "nested dropped");
+
+    /* SET_REPLY works through a broadcast too. */
+    uint8_t target = 0x42;
+    test_msg_create(&m, 0x00, CRUMBS_CMD_SET_REPLY, &target, 1);
+    crumbs_controller_broadcast(&ctrl, &m, capture_write, NULL);
+    crumbs_peripheral_handle_receive(&p, g_frame, g_frame_len);
+    TEST_ASSERT_EQ(name, p.requested_opcode, 0x42, "SET_REPLY");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Broadcast tests:\n");
+
+    failures += test_wire_format();
+    failures += test_fan_out();
+    failures += test_filtering();
+
+    if (failures == 0)
+    {
+        printf("All broadcast tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d broadcast test(s) failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,245 @@
+/*
+ * Tests for bulk queries: several reply handlers packed into one
+ * CRUMBS_CMD_BULK_GET stream, entries split across frames, oversize
+ * replies, and crumbs_controller_get_bulk() on the virtual bus. Built with
+ * CRUMBS_ENABLE_BULK=1.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_vbus.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+/* Calculator-like history: 12 entries of 6 bytes plus a 2-byte meta reply. */
+#define CALC_TYPE 0x03
+#define OP_HIST_0 0x90
+#define OP_HIST_META 0x81
+#define OP_BIG 0x82
+#define HIST 12
+
+static int g_calls;
+
+static void reply_hist(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    uint8_t idx = (uint8_t)(ctx->requested_opcode - OP_HIST_0);
+    (void)user_data;
+    g_calls++;
+    reply->type_id = CALC_TYPE;
+    reply->opcode = ctx->requested_opcode;
+    reply->data_len = 6u;
+    for (uint8_t i = 0; i < 6u; i++)
+    {
+        reply->data[i] = (uint8_t)(idx * 16u + i);
+    }
+}
+
+static void reply_meta(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)user_data;
+    g_calls++;
+    reply->type_id = CALC_TYPE;
+    reply->opcode = ctx->requested_opcode;
+    reply->data_len = 2u;
+    reply->data[0] = HIST;
+    reply->data[1] = 3u;
+}
+
+static void reply_big(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)user_data;
+    reply->type_id = CALC_TYPE;
+    reply->opcode = ctx->requested_opcode;
+    reply->data_len = CRUMBS_MAX_PAYLOAD;
+    memset(reply->data, 0xA5, CRUMBS_MAX_PAYLOAD);
+}
+
+static void setup_calc(crumbs_context_t *p)
+{
+    test_init_peripheral(p);
+    for (uint8_t i = 0; i < HIST; i++)
+    {
+        crumbs_register_reply_handler(p, (uint8_t)(OP_HIST_0 + i), reply_hist, NULL);
+    }
+    crumbs_register_reply_handler(p, OP_HIST_META, reply_meta, NULL);
+    crumbs_register_reply_handler(p, OP_BIG, reply_big, NULL);
+}
+
+static void snapshot_ops(uint8_t *ops)
+{
+    ops[0] = OP_HIST_META;
+    for (uint8_t i = 0; i < HIST; i++)
+    {
+        ops[1 + i] = (uint8_t)(OP_HIST_0 + i);
+    }
+}
+
+static size_t encode_bulk_select(uint8_t *frame, const uint8_t *ops, uint8_t count)
+{
+    crumbs_message_t m;
+    uint8_t payload[CRUMBS_MAX_PAYLOAD];
+    payload[0] = CRUMBS_CMD_BULK_GET;
+    memcpy(&payload[1], ops, count);
+    test_msg_create(&m, 0x00, CRUMBS_CMD_SET_REPLY, payload, (uint8_t)(count + 1u));
+    return test_encode(&m, frame);
+}
+
+static int read_frame(crumbs_context_t *p, crumbs_message_t *reply)
+{
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t len;
+    if (crumbs_peripheral_build_reply(p, frame, sizeof(frame), &len) != 0)
+    {
+        return -1;
+    }
+    return crumbs_decode_message(frame, len, reply, NULL);
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_stream_layout(void)
+{
+    const char *name = "bulk stream packs whole entries";
+    crumbs_context_t p;
+    crumbs_message_t reply, entry;
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    uint8_t ops[1 + HIST];
+    uint8_t pos;
+    size_t len;
+
+    setup_calc(&p);
+    TEST_ASSERT(name, crumbs_peripheral_capabilities(&p) & CRUMBS_CAP_BULK, "cap bit");
+    snapshot_ops(ops);
+    len = encode_bulk_select(frame, ops, sizeof(ops));
+    TEST_ASSERT_EQ(name, crumbs_peripheral_handle_receive(&p, frame, len), 0, "select");
+    TEST_ASSERT_EQ(name, p.requested_opcode, CRUMBS_CMD_BULK_GET, "selected");
+
+    /* Frame 1: hdr + meta (4) + three history entries (8 each) = 29 > 27,
+     * so meta and two entries. */
+    TEST_ASSERT_EQ(name, read_frame(&p, &reply), 0, "frame 1");
+    TEST_ASSERT_EQ(name, reply.opcode, CRUMBS_CMD_BULK_GET, "opcode");
+    TEST_ASSERT_EQ(name, reply.type_id, CALC_TYPE, "type of first entry");
+    TEST_ASSERT_EQ(name, reply.data[0], CRUMBS_BULK_MORE | 0u, "hdr 1");
+    TEST_ASSERT_EQ(name, reply.data_len, 21, "1 + 4 + 2 * 8");
+
+    pos = 0u;
+    TEST_ASSERT_EQ(name, crumbs_bulk_next(&reply, &pos, &entry), 1, "meta");
+    TEST_ASSERT_EQ(name, entry.opcode, OP_HIST_META, "meta opcode");
+    TEST_ASSERT_EQ(name, entry.data_len, 2, "meta len");
+    TEST_ASSERT_EQ(name, entry.data[0], HIST, "meta count");
+    TEST_ASSERT_EQ(name, crumbs_bulk_next(&reply, &pos, &entry), 1, "hist 0");
+    TEST_ASSERT_EQ(name, entry.opcode, OP_HIST_0, "hist 0 opcode");
+    TEST_ASSERT_EQ(name, entry.data[5], 5, "hist 0 data");
+    TEST_ASSERT_EQ(name, crumbs_bulk_next(&reply, &pos, &entry), 1, "hist 1");
+    TEST_ASSERT_EQ(name, entry.data[0], 16, "hist 1 data");
+    TEST_ASSERT_EQ(name, crumbs_bulk_next(&reply, &pos, &entry), 0, "end of frame");
+
+    /* The rest follows three entries per frame, without another write. */
+    uint8_t expect = 3u;
+    for (int f = 0; f < 4; f++)
+    {
+        TEST_ASSERT_EQ(name, read_frame(&p, &reply), 0, "next frame");
+        TEST_ASSERT_EQ(name, reply.data[0] & 0x7Fu, expect, "hdr index");
+        expect = (uint8_t)(expect + 3u);
+        TEST_ASSERT_EQ(name, (reply.data[0] & CRUMBS_BULK_MORE) != 0, f < 3, "more flag");
+    }
+    TEST_ASSERT_EQ(name, expect, 1 + HIST + 2, "all entries sent");
+
+    /* The stream starts over after its last frame. */
+    TEST_ASSERT_EQ(name, read_frame(&p, &reply), 0, "again");
+    TEST_ASSERT_EQ(name, reply.data[0], CRUMBS_BULK_MORE | 0u, "restarted");
+
+    /* Opcodes without a reply give empty entries; oversize ones are marked. */
+    ops[0] = 0x55u;
+    ops[1] = OP_BIG;
+    len = encode_bulk_select(frame, ops, 2u);
+    crumbs_peripheral_handle_receive(&p, frame, len);
+    TEST_ASSERT_EQ(name, read_frame(&p, &reply), 0, "odd entries");
+    TEST_ASSERT_EQ(name, reply.data[0], 0, "single frame");
+    pos = 0u;
+    TEST_ASSERT_EQ(name, crumbs_bulk_next(&reply, &pos, &entry), 1, "no reply");
+    TEST_ASSERT_EQ(name, entry.data_len, 0, "empty");
+    TEST_ASSERT_EQ(name, crumbs_bulk_next(&reply, &pos, &entry), 2, "too large");
+    TEST_ASSERT_EQ(name, entry.opcode, OP_BIG, "too large opcode");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_controller_snapshot(void)
+{
+    const char *name = "controller snapshot in one round trip";
+    crumbs_vbus_t bus;
+    crumbs_context_t p, ctrl;
+    crumbs_device_t dev;
+    crumbs_message_t out[CRUMBS_BULK_MAX_QUERY];
+    crumbs_message_t single;
+    uint8_t ops[1 + HIST];
+
+    crumbs_vbus_init(&bus, 100000u);
+    crumbs_vbus_use(&bus);
+    setup_calc(&p);
+    TEST_ASSERT(name, crumbs_vbus_attach(&bus, &p, 0u, 0u) != NULL, "attach");
+    test_init_controller(&ctrl);
+    crumbs_vbus_bind(&bus, &dev, &ctrl, 0x10);
+    snapshot_ops(ops);
+
+    g_calls = 0;
+    TEST_ASSERT_EQ(name, crumbs_controller_get_bulk(&dev, ops, sizeof(ops), out), 0, "bulk");
+    for (uint8_t i = 0; i < 1 + HIST; i++)
+    {
+        TEST_ASSERT_EQ(name, out[i].opcode, ops[i], "order");
+        TEST_ASSERT_EQ(name, out[i].type_id, CALC_TYPE, "type");
+    }
+    TEST_ASSERT_EQ(name, out[0].data[1], 3, "meta");
+    TEST_ASSERT_EQ(name, out[12].data_len, 6, "hist 11 len");
+    TEST_ASSERT_EQ(name, out[12].data[0], 11 * 16, "hist 11 data");
+
+    /* Each of the 13 handlers ran once (plus one rebuild per frame break). */
+    TEST_ASSERT(name, g_calls >= 1 + HIST && g_calls <= 1 + HIST + 4, "handler calls");
+
+    /* An oversize reply is fetched on its own. */
+    ops[1] = OP_BIG;
+    TEST_ASSERT_EQ(name, crumbs_controller_get_bulk(&dev, ops, 2u, out), 0, "with big");
+    TEST_ASSERT_EQ(name, out[1].opcode, OP_BIG, "big opcode");
+    TEST_ASSERT_EQ(name, out[1].data_len, CRUMBS_MAX_PAYLOAD, "big fetched");
+
+    /* More opcodes than the peripheral keeps is an error, not a short list. */
+    uint8_t many[CRUMBS_BULK_MAX_OPS + 1];
+    memset(many, OP_HIST_META, sizeof(many));
+    TEST_ASSERT_EQ(name, crumbs_controller_get_bulk(&dev, many, sizeof(many), out), -1, "too many");
+
+    /* A plain query still works afterwards. */
+    crumbs_message_t sr;
+    uint8_t op = OP_HIST_META;
+    test_msg_create(&sr, 0x00, CRUMBS_CMD_SET_REPLY, &op, 1);
+    crumbs_controller_send(&ctrl, 0x10, &sr, crumbs_vbus_write, &bus);
+    TEST_ASSERT_EQ(name, crumbs_controller_read(&ctrl, 0x10, &single, crumbs_vbus_read, &bus), 0, "plain");
+    TEST_ASSERT_EQ(name, single.opcode, OP_HIST_META, "plain opcode");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Bulk query tests:\n");
+
+    failures += test_stream_layout();
+    failures += test_controller_snapshot();
+
+    if (failures == 0)
+    {
+        printf("All bulk query tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d bulk query test(s) failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,255 @@
+/*
+ * Tests for the multi-bus controller: routing by io handle, one worker
+ * thread per bus, transfers on different buses overlapping, resubmission
+ * from completion callbacks, and stop/restart.
+ *
+ * Each fake bus answers every read with a frame whose type_id is the bus
+ * id and whose payload is the device address. Transfers sleep briefly so
+ * that overlap between buses is observable.
+ */
+
+#define _POSIX_C_SOURCE 200809L /* nanosleep */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "crumbs.h"
+#include "crumbs_bus_group.h"
+#include "crumbs_message_helpers.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define N_BUSES 3
+#define DEVS_PER_BUS 4
+#define XFER_US 1000u
+
+typedef struct
+{
+    uint8_t id;
+    uint8_t opcode[128];   /* SET_REPLY target per address (worker-only) */
+    pthread_t owner;       /* thread that ran the first transfer */
+    int owner_set;
+    int foreign;           /* transfers from any other thread */
+    crumbs_context_t ctx;  /* one context per bus */
+} fake_bus_t;
+
+static fake_bus_t g_bus[N_BUSES];
+static int g_active;
+static int g_max_active;
+
+static void xfer_enter(fake_bus_t *bus)
+{
+    if (!bus->owner_set)
+    {
+        bus->owner = pthread_self();
+        bus->owner_set = 1;
+    }
+    else if (!pthread_equal(bus->owner, pthread_self()))
+    {
+        bus->foreign++;
+    }
+
+    int now = __atomic_add_fetch(&g_active, 1, __ATOMIC_SEQ_CST);
+    int max = __atomic_load_n(&g_max_active, __ATOMIC_SEQ_CST);
+    while (now > max && !__atomic_compare_exchange_n(&g_max_active, &max, now, 0,
+                                                     __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+    {
+    }
+    struct timespec ts = {0, (long)XFER_US * 1000L};
+    nanosleep(&ts, NULL);
+    __atomic_sub_fetch(&g_active, 1, __ATOMIC_SEQ_CST);
+}
+
+static int fake_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    fake_bus_t *bus = (fake_bus_t *)user_ctx;
+    xfer_enter(bus);
+    if (len >= 4u && data[1] == CRUMBS_CMD_SET_REPLY)
+        bus->opcode[addr & 0x7Fu] = data[3];
+    return 0;
+}
+
+static int fake_read(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len, uint32_t timeout_us)
+{
+    fake_bus_t *bus = (fake_bus_t *)user_ctx;
+    crumbs_message_t m;
+    (void)timeout_us;
+    xfer_enter(bus);
+    crumbs_msg_init(&m, bus->id, bus->opcode[addr & 0x7Fu]);
+    crumbs_msg_add_u8(&m, addr);
+    return (int)crumbs_encode_message(&m, buffer, len);
+}
+
+static crumbs_device_t g_devs[N_BUSES * DEVS_PER_BUS];
+static crumbs_request_t g_reqs[N_BUSES * DEVS_PER_BUS];
+static int g_status[N_BUSES * DEVS_PER_BUS];
+static int g_calls[N_BUSES * DEVS_PER_BUS];
+static crumbs_bus_group_t g_group;
+
+static void on_done(crumbs_request_t *req, int status)
+{
+    int k = (int)(req - g_reqs);
+    g_status[k] = status;
+    g_calls[k]++;
+}
+
+static int setup(void)
+{
+    memset(g_bus, 0, sizeof(g_bus));
+    memset(g_status, 0xFF, sizeof(g_status));
+    memset(g_calls, 0, sizeof(g_calls));
+    g_active = 0;
+    g_max_active = 0;
+
+    if (crumbs_bus_group_init(&g_group) != 0)
+        return -1;
+    for (int b = 0; b < N_BUSES; b++)
+    {
+        g_bus[b].id = (uint8_t)(0x40 + b);
+        test_init_controller(&g_bus[b].ctx);
+        if (crumbs_bus_group_add_bus(&g_group, &g_bus[b]) != b)
+            return -1;
+    }
+    for (int k = 0; k < N_BUSES * DEVS_PER_BUS; k++)
+    {
+        fake_bus_t *bus = &g_bus[k % N_BUSES];
+        crumbs_device_t *dev = &g_devs[k];
+        memset(dev, 0, sizeof(*dev));
+        dev->ctx = &bus->ctx;
+        dev->addr = (uint8_t)(0x10 + k);
+        dev->write_fn = fake_write;
+        dev->read_fn = fake_read;
+        dev->io = bus;
+        crumbs_request_init(&g_reqs[k], dev, 0x21, on_done, NULL);
+        g_reqs[k].delay_us = 500u;
+    }
+    return 0;
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_parallel_buses(void)
+{
+    const char *name = "buses run in parallel";
+    const int n = N_BUSES * DEVS_PER_BUS;
+
+    TEST_ASSERT_EQ(name, setup(), 0, "setup");
+    TEST_ASSERT_EQ(name, crumbs_bus_group_submit_many(&g_group, g_reqs, (size_t)n), -3, "not started");
+    TEST_ASSERT_EQ(name, crumbs_bus_group_start(&g_group), 0, "start");
+    TEST_ASSERT_EQ(name, crumbs_bus_group_start(&g_group), -1, "already running");
+
+    TEST_ASSERT_EQ(name, crumbs_bus_group_submit_many(&g_group, g_reqs, (size_t)n), n, "all queued");
+    TEST_ASSERT_EQ(name, crumbs_bus_group_wait(&g_group, 5000000u), 0, "drained");
+
+    for (int k = 0; k < n; k++)
+    {
+        TEST_ASSERT_EQ(name, g_calls[k], 1, "one completion each");
+        TEST_ASSERT_EQ(name, g_status[k], 0, "success");
+        TEST_ASSERT_EQ(name, g_reqs[k].reply.type_id, g_bus[k % N_BUSES].id, "served by its bus");
+        TEST_ASSERT_EQ(name, g_reqs[k].reply.data[0], g_devs[k].addr, "payload");
+    }
+    for (int b = 0; b < N_BUSES; b++)
+    {
+        TEST_ASSERT_EQ(name, g_bus[b].foreign, 0, "one thread per bus");
+        TEST_ASSERT_EQ(name, crumbs_bus_group_pending(&g_group, (uint8_t)b), 0u, "nothing pending");
+        TEST_ASSERT_EQ(name, g_group.buses[b].completed, (uint32_t)DEVS_PER_BUS, "completed count");
+        for (int c = b + 1; c < N_BUSES; c++)
+            TEST_ASSERT(name, !pthread_equal(g_bus[b].owner, g_bus[c].owner), "distinct workers");
+    }
+    TEST_ASSERT(name, g_max_active >= 2, "transfers overlapped across buses");
+
+    crumbs_bus_group_stop(&g_group);
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int g_repeat_left;
+
+static void on_repeat(crumbs_request_t *req, int status)
+{
+    (void)status;
+    g_calls[0]++;
+    if (--g_repeat_left > 0)
+        (void)crumbs_bus_group_submit(&g_group, req);
+}
+
+static int test_resubmit_from_callback(void)
+{
+    const char *name = "callback resubmits";
+
+    TEST_ASSERT_EQ(name, setup(), 0, "setup");
+    TEST_ASSERT_EQ(name, crumbs_bus_group_start(&g_group), 0, "start");
+    g_repeat_left = 5;
+    g_reqs[0].on_done = on_repeat;
+    TEST_ASSERT_EQ(name, crumbs_bus_group_submit(&g_group, &g_reqs[0]), 0, "submit");
+    TEST_ASSERT_EQ(name, crumbs_bus_group_wait(&g_group, 5000000u), 0, "drained");
+    TEST_ASSERT_EQ(name, g_calls[0], 5, "five rounds");
+
+    crumbs_bus_group_stop(&g_group);
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_routing_and_lifecycle(void)
+{
+    const char *name = "routing and lifecycle";
+    fake_bus_t stray;
+    crumbs_device_t dev;
+    crumbs_request_t req;
+
+    TEST_ASSERT_EQ(name, setup(), 0, "setup");
+    TEST_ASSERT_EQ(name, crumbs_bus_group_add_bus(&g_group, &g_bus[0]), -1, "duplicate bus");
+    TEST_ASSERT_EQ(name, crumbs_bus_group_submit(&g_group, &g_reqs[0]), -3, "not started");
+    TEST_ASSERT_EQ(name, crumbs_bus_group_start(&g_group), 0, "start");
+    TEST_ASSERT_EQ(name, crumbs_bus_group_add_bus(&g_group, &stray), -1, "add while running");
+
+    dev = g_devs[0];
+    dev.io = &stray;
+    crumbs_request_init(&req, &dev, 0x21, NULL, NULL);
+    TEST_ASSERT_EQ(name, crumbs_bus_group_submit(&g_group, &req), -2, "unknown bus");
+    dev.read_fn = NULL;
+    dev.io = &g_bus[0];
+    TEST_ASSERT_EQ(name, crumbs_bus_group_submit(&g_group, &req), -1, "no read_fn");
+    dev.read_fn = g_devs[0].read_fn;
+    req.lane = CRUMBS_ENGINE_LANES;
+    TEST_ASSERT_EQ(name, crumbs_bus_group_submit(&g_group, &req), -1, "bad lane");
+    TEST_ASSERT_EQ(name, req.state, CRUMBS_REQ_IDLE, "not claimed");
+
+    /* Stop finishes queued work, then refuses new work until restarted. */
+    TEST_ASSERT_EQ(name, crumbs_bus_group_submit(&g_group, &g_reqs[1]), 0, "queued");
+    crumbs_bus_group_stop(&g_group);
+    TEST_ASSERT_EQ(name, g_calls[1], 1, "finished before stop returned");
+    TEST_ASSERT_EQ(name, crumbs_bus_group_submit(&g_group, &g_reqs[1]), -3, "stopped");
+    TEST_ASSERT_EQ(name, crumbs_bus_group_start(&g_group), 0, "restart");
+    TEST_ASSERT_EQ(name, crumbs_bus_group_submit(&g_group, &g_reqs[1]), 0, "queued again");
+    TEST_ASSERT_EQ(name, crumbs_bus_group_wait(&g_group, 5000000u), 0, "drained");
+    TEST_ASSERT_EQ(name, g_calls[1], 2, "second completion");
+
+    crumbs_bus_group_stop(&g_group);
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Bus group tests:\n");
+
+    failures += test_parallel_buses();
+    failures += test_resubmit_from_callback();
+    failures += test_routing_and_lifecycle();
+
+    if (failures == 0)
+    {
+        printf("All bus group tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d bus group test(s) failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,327 @@
+/*
+ * Tests for bus capture and replay: the record and header format, a
+ * capture wrapped around a virtual-bus controller, replay straight into a
+ * peripheral context and onto a fresh virtual bus (captured spacing and
+ * full speed), and on Linux the append-only file and its mapping.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_capture.h"
+#include "crumbs_message_helpers.h"
+#include "crumbs_transport.h"
+#include "crumbs_vbus.h"
+#include "test_common.h"
+
+#if defined(__linux__)
+#include <unistd.h>
+#include "crumbs_linux_capture.h"
+#endif
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define OP_SET 0x01
+#define OP_COUNT 0x40
+#define DEV 0x10
+#define LOG_MAX 32
+
+static uint8_t g_log[LOG_MAX * CRUMBS_CAPTURE_RECORD_SIZE];
+static size_t g_log_n;
+static int g_sets;
+static uint8_t g_count;
+
+static int mem_sink(void *user, const uint8_t *record)
+{
+    (void)user;
+    if (g_log_n == LOG_MAX)
+    {
+        return -1;
+    }
+    memcpy(&g_log[g_log_n++ * CRUMBS_CAPTURE_RECORD_SIZE], record, CRUMBS_CAPTURE_RECORD_SIZE);
+    return 0;
+}
+
+static void on_set(crumbs_context_t *ctx, uint8_t opcode, const uint8_t *data,
+                   uint8_t data_len, void *user_data)
+{
+    (void)ctx;
+    (void)opcode;
+    (void)data;
+    (void)data_len;
+    (void)user_data;
+    g_sets++;
+}
+
+static void reply_count(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)ctx;
+    (void)user_data;
+    crumbs_msg_init(reply, 0x07, OP_COUNT);
+    crumbs_msg_add_u8(reply, ++g_count);
+}
+
+static void device_setup(crumbs_context_t *periph)
+{
+    crumbs_init(periph, CRUMBS_ROLE_PERIPHERAL, DEV);
+    crumbs_register_handler(periph, OP_SET, on_set, NULL);
+    crumbs_register_reply_handler(periph, OP_COUNT, reply_count, NULL);
+    g_sets = 0;
+    g_count = 0u;
+}
+
+static void bus_setup(crumbs_vbus_t *bus, crumbs_context_t *periph)
+{
+    crumbs_vbus_init(bus, 100000u);
+    crumbs_vbus_use(bus);
+    device_setup(periph);
+    crumbs_vbus_attach(bus, periph, 0u, 0u);
+}
+
+static crumbs_capture_record_t record_at(size_t i)
+{
+    crumbs_capture_record_t rec;
+    crumbs_capture_decode(&g_log[i * CRUMBS_CAPTURE_RECORD_SIZE], &rec);
+    return rec;
+}
+
+/* SET, a GET over the combined transfer, a GET in two transfers, and a write nobody ACKs. */
+static int record_session(void)
+{
+    static crumbs_vbus_t bus;
+    static crumbs_context_t periph;
+    static crumbs_capture_t cap;
+    crumbs_context_t ctrl;
+    crumbs_device_t dev;
+    crumbs_message_t m;
+
+    bus_setup(&bus, &periph);
+    test_init_controller(&ctrl);
+    crumbs_set_transport(&ctrl, &crumbs_vbus_transport, &bus);
+    g_log_n = 0u;
+    if (crumbs_capture_attach(&cap, &ctrl, mem_sink, NULL, crumbs_vbus_clock_us) != 0 ||
+        crumbs_device_init(&dev, &ctrl, DEV, crumbs_vbus_delay_us) != 0)
+    {
+        return -1;
+    }
+
+    crumbs_msg_init(&m, 0x01, OP_SET);
+    crumbs_msg_add_u8(&m, 7);
+    crumbs_transport_send(&ctrl, DEV, &m);
+    crumbs_vbus_advance_us(&bus, 1000u);
+    crumbs_device_query(&dev, OP_COUNT, &m, CRUMBS_MAX_PAYLOAD);
+    crumbs_vbus_advance_us(&bus, 5000u);
+    dev.transport = NULL; /* two transfers through dev->write_fn / read_fn */
+    crumbs_device_query(&dev, OP_COUNT, &m, CRUMBS_MAX_PAYLOAD);
+    crumbs_transport_send(&ctrl, 0x50, &m);
+    return 0;
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_format(void)
+{
+    const char *name = "records and header round trip";
+    uint8_t hdr[CRUMBS_CAPTURE_HEADER_SIZE];
+    uint8_t raw[CRUMBS_CAPTURE_RECORD_SIZE];
+    crumbs_capture_record_t a, b;
+
+    crumbs_capture_header(hdr);
+    TEST_ASSERT(name, memcmp(hdr, "CRUMBCAP", 8) == 0, "magic");
+    TEST_ASSERT_EQ(name, crumbs_capture_check_header(hdr, sizeof(hdr)), 0, "valid");
+    TEST_ASSERT_EQ(name, crumbs_capture_check_header(hdr, 8u), -1, "short");
+    hdr[10] = 64u;
+    TEST_ASSERT_EQ(name, crumbs_capture_check_header(hdr, sizeof(hdr)), -1, "record size");
+
+    memset(&a, 0, sizeof(a));
+    a.t_us = 0x01020304u;
+    a.seq = 9u;
+    a.addr = 0x21;
+    a.dir = CRUMBS_CAPTURE_RX;
+    a.len = 200u;
+    a.decode = -3;
+    a.rc = -1234;
+    for (size_t i = 0; i < CRUMBS_CAPTURE_DATA_MAX; i++)
+    {
+        a.data[i] = (uint8_t)(0xA0u + i);
+    }
+    crumbs_capture_encode(&a, raw);
+    TEST_ASSERT_EQ(name, raw[0], 0x04, "little-endian");
+    crumbs_capture_decode(raw, &b);
+    TEST_ASSERT(name, b.t_us == a.t_us && b.seq == a.seq && b.addr == a.addr && b.dir == a.dir &&
+                          b.len == a.len && b.decode == a.decode && b.rc == a.rc &&
+                          memcmp(b.data, a.data, sizeof(a.data)) == 0,
+                "fields");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_capture(void)
+{
+    const char *name = "every transfer is recorded";
+    crumbs_capture_record_t r;
+
+    TEST_ASSERT_EQ(name, record_session(), 0, "session");
+    TEST_ASSERT_EQ(name, (int)g_log_n, 6, "SET, 2 x (SET_REPLY + read), NACKed write");
+
+    r = record_at(0);
+    TEST_ASSERT(name, r.dir == CRUMBS_CAPTURE_TX && r.addr == DEV && r.len == 5u, "SET");
+    TEST_ASSERT(name, r.decode == 0 && r.rc == 0 && r.data[1] == OP_SET, "SET decoded");
+    r = record_at(1);
+    TEST_ASSERT(name, r.dir == CRUMBS_CAPTURE_TX && r.data[1] == CRUMBS_CMD_SET_REPLY,
+                "combined transfer, write half");
+    r = record_at(2);
+    TEST_ASSERT(name, r.dir == CRUMBS_CAPTURE_RX && r.decode == 0 && r.rc == (int)r.len &&
+                          r.data[1] == OP_COUNT && r.data[3] == 1u,
+                "combined transfer, read half");
+    TEST_ASSERT(name, r.t_us >= record_at(0).t_us + 1000u, "timestamps from the bus clock");
+    r = record_at(4);
+    TEST_ASSERT(name, r.dir == CRUMBS_CAPTURE_RX && r.data[3] == 2u, "split read");
+    r = record_at(5);
+    TEST_ASSERT(name, r.addr == 0x50 && r.rc < 0, "NACK kept");
+    TEST_ASSERT_EQ(name, (int)r.seq, 5, "sequence");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_replay_peripheral(void)
+{
+    const char *name = "replay into a peripheral context";
+    crumbs_context_t periph;
+    crumbs_capture_replay_t r;
+
+    TEST_ASSERT_EQ(name, record_session(), 0, "session");
+    device_setup(&periph);
+    crumbs_capture_replay_init(&r);
+    r.peripheral = &periph;
+    TEST_ASSERT_EQ(name, crumbs_capture_replay(&r, g_log, g_log_n), 0, "matches");
+    TEST_ASSERT_EQ(name, g_sets, 1, "handler ran");
+    TEST_ASSERT_EQ(name, (int)r.replayed, 5, "records at DEV");
+    TEST_ASSERT_EQ(name, (int)r.skipped, 1, "NACKed write skipped");
+
+    /* The same traffic against a device in another state. */
+    TEST_ASSERT_EQ(name, crumbs_capture_replay(&r, g_log, g_log_n), 2, "replies differ");
+    TEST_ASSERT_EQ(name, (int)r.mismatches, 2, "counted");
+
+    crumbs_capture_replay_init(&r);
+    TEST_ASSERT_EQ(name, crumbs_capture_replay(&r, g_log, 1u), 1, "no target");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_replay_bus(void)
+{
+    const char *name = "replay on a virtual bus, paced and at full speed";
+    crumbs_vbus_t bus;
+    crumbs_context_t periph;
+    crumbs_capture_replay_t r;
+    uint32_t span;
+    uint32_t paced;
+
+    TEST_ASSERT_EQ(name, record_session(), 0, "session");
+    span = record_at(5).t_us - record_at(0).t_us;
+
+    bus_setup(&bus, &periph);
+    crumbs_capture_replay_init(&r);
+    r.bus = &crumbs_vbus_transport;
+    r.bus_io = &bus;
+    r.delay = crumbs_vbus_delay_us;
+    TEST_ASSERT_EQ(name, crumbs_capture_replay(&r, g_log, g_log_n), 0, "matches");
+    TEST_ASSERT_EQ(name, (int)r.replayed, 5, "replayed");
+    paced = crumbs_vbus_now_us(&bus);
+    TEST_ASSERT(name, paced >= span, "captured spacing kept");
+
+    bus_setup(&bus, &periph);
+    crumbs_capture_replay_init(&r);
+    r.bus = &crumbs_vbus_transport;
+    r.bus_io = &bus;
+    TEST_ASSERT_EQ(name, crumbs_capture_replay(&r, g_log, g_log_n), 0, "matches");
+    TEST_ASSERT(name, crumbs_vbus_now_us(&bus) + 6000u <= paced, "idle time removed");
+    TEST_ASSERT_EQ(name, g_sets, 1, "delivered");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+#if defined(__linux__)
+static int test_linux_file(void)
+{
+    const char *name = "capture file appends and maps";
+    char path[64];
+    crumbs_linux_capture_t f;
+    crumbs_linux_capture_map_t m;
+    crumbs_capture_replay_t r;
+    crumbs_context_t periph;
+    FILE *junk;
+
+    snprintf(path, sizeof(path), "/tmp/crumbs_capture_%d.cap", (int)getpid());
+    unlink(path);
+    TEST_ASSERT_EQ(name, record_session(), 0, "session");
+
+    /* Two runs into the same file. */
+    for (int run = 0; run < 2; run++)
+    {
+        TEST_ASSERT_EQ(name, crumbs_linux_capture_open(&f, path), 0, "open");
+        for (size_t i = 0; i < g_log_n; i++)
+        {
+            TEST_ASSERT_EQ(name, crumbs_linux_capture_sink(&f, &g_log[i * CRUMBS_CAPTURE_RECORD_SIZE]),
+                           0, "append");
+        }
+        crumbs_linux_capture_close(&f);
+    }
+
+    TEST_ASSERT_EQ(name, crumbs_linux_capture_map(&m, path), 0, "map");
+    TEST_ASSERT_EQ(name, (int)m.size, (int)(CRUMBS_CAPTURE_HEADER_SIZE + 12u * CRUMBS_CAPTURE_RECORD_SIZE),
+                   "one header");
+    TEST_ASSERT_EQ(name, (int)m.count, 12, "records");
+    TEST_ASSERT(name, memcmp(m.records, g_log, g_log_n * CRUMBS_CAPTURE_RECORD_SIZE) == 0, "contents");
+
+    device_setup(&periph);
+    crumbs_capture_replay_init(&r);
+    r.peripheral = &periph;
+    TEST_ASSERT_EQ(name, crumbs_capture_replay(&r, m.records, g_log_n), 0, "replay from the mapping");
+    crumbs_linux_capture_unmap(&m);
+    crumbs_linux_capture_unmap(&m);
+    unlink(path);
+
+    junk = fopen(path, "w");
+    TEST_ASSERT(name, junk != NULL, "junk file");
+    fputs("not a capture file", junk);
+    fclose(junk);
+    TEST_ASSERT_EQ(name, crumbs_linux_capture_open(&f, path), -3, "foreign file refused");
+    TEST_ASSERT_EQ(name, crumbs_linux_capture_map(&m, path), -3, "foreign file not mapped");
+    unlink(path);
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+#endif
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Capture tests:\n");
+
+    failures += test_format();
+    failures += test_capture();
+    failures += test_replay_peripheral();
+    failures += test_replay_bus();
+#if defined(__linux__)
+    failures += test_linux_file();
+#endif
+
+    if (failures == 0)
+    {
+        printf("All capture tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d capture test(s) failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,220 @@
+/*
+ * Tests for change sequences: conditional GETs answered with the 4-byte
+ * unchanged frame, replies wrapped with their sequence, fall-back cases,
+ * and the controller cache on the virtual bus. Built with
+ * CRUMBS_ENABLE_CHANGE_SEQ=1.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_vbus.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define SENSOR_TYPE 0x05
+#define OP_TEMP 0x80
+#define OP_DUMP 0x81
+
+static uint16_t g_temp = 215u;
+static int g_calls;
+
+static void reply_temp(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)ctx;
+    (void)user_data;
+    g_calls++;
+    reply->type_id = SENSOR_TYPE;
+    reply->opcode = OP_TEMP;
+    reply->data_len = 2u;
+    reply->data[0] = (uint8_t)(g_temp & 0xFFu);
+    reply->data[1] = (uint8_t)(g_temp >> 8);
+}
+
+static void reply_dump(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)ctx;
+    (void)user_data;
+    reply->type_id = SENSOR_TYPE;
+    reply->opcode = OP_DUMP;
+    reply->data_len = CRUMBS_MAX_PAYLOAD;
+    memset(reply->data, 0x11, CRUMBS_MAX_PAYLOAD);
+}
+
+static void setup_sensor(crumbs_context_t *p)
+{
+    test_init_peripheral(p);
+    crumbs_register_reply_handler(p, OP_TEMP, reply_temp, NULL);
+    crumbs_register_reply_handler(p, OP_DUMP, reply_dump, NULL);
+    g_calls = 0;
+}
+
+static void send_if_changed(crumbs_context_t *p, uint8_t opcode, uint16_t seen)
+{
+    crumbs_message_t m;
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    uint8_t payload[3] = {opcode, (uint8_t)(seen & 0xFFu), (uint8_t)(seen >> 8)};
+    test_msg_create(&m, 0x00, CRUMBS_CMD_IF_CHANGED, payload, 3);
+    size_t n = test_encode(&m, frame);
+    crumbs_peripheral_handle_receive(p, frame, n);
+}
+
+static size_t read_reply(crumbs_context_t *p, crumbs_message_t *reply)
+{
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t len = 0u;
+    memset(reply, 0, sizeof(*reply));
+    crumbs_peripheral_build_reply(p, frame, sizeof(frame), &len);
+    crumbs_decode_message(frame, len, reply, NULL);
+    return len;
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_peripheral_condition(void)
+{
+    const char *name = "IF_CHANGED skips unchanged replies";
+    crumbs_context_t p;
+    crumbs_message_t reply;
+
+    setup_sensor(&p);
+    TEST_ASSERT_EQ(name, crumbs_change_seq(&p), 1, "starts at 1");
+    TEST_ASSERT(name, crumbs_peripheral_capabilities(&p) & CRUMBS_CAP_CHANGES, "cap bit");
+
+    /* Nothing seen yet: full reply behind the sequence. */
+    send_if_changed(&p, OP_TEMP, 0u);
+    TEST_ASSERT_EQ(name, p.requested_opcode, OP_TEMP, "selected");
+    read_reply(&p, &reply);
+    TEST_ASSERT_EQ(name, reply.opcode, CRUMBS_CMD_IF_CHANGED, "wrapped");
+    TEST_ASSERT_EQ(name, reply.type_id, SENSOR_TYPE, "handler type kept");
+    TEST_ASSERT_EQ(name, reply.data_len, 4, "seq + data");
+    TEST_ASSERT_EQ(name, reply.data[0], 1, "seq lo");
+    TEST_ASSERT_EQ(name, reply.data[2], 215 & 0xFF, "data");
+
+    /* Seen: 4 bytes, handler not called. */
+    send_if_changed(&p, OP_TEMP, 1u);
+    g_calls = 0;
+    TEST_ASSERT_SIZE_EQ(name, read_reply(&p, &reply), 4u, "4-byte frame");
+    TEST_ASSERT_EQ(name, reply.opcode, CRUMBS_CMD_IF_CHANGED, "unchanged opcode");
+    TEST_ASSERT_EQ(name, reply.data_len, 0, "no payload");
+    TEST_ASSERT_EQ(name, g_calls, 0, "handler skipped");
+
+    /* A change shows on the next read without a new request. */
+    g_temp = 230u;
+    crumbs_mark_changed(&p);
+    read_reply(&p, &reply);
+    TEST_ASSERT_EQ(name, reply.data_len, 4, "changed");
+    TEST_ASSERT_EQ(name, reply.data[0], 2, "new seq");
+    TEST_ASSERT_EQ(name, g_calls, 1, "handler ran");
+
+    /* Too large for the sequence: sent as is. */
+    send_if_changed(&p, OP_DUMP, 0u);
+    read_reply(&p, &reply);
+    TEST_ASSERT_EQ(name, reply.opcode, OP_DUMP, "plain");
+    TEST_ASSERT_EQ(name, reply.data_len, CRUMBS_MAX_PAYLOAD, "full payload");
+
+    /* A plain SET_REPLY ends the condition. */
+    crumbs_message_t m;
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    uint8_t op = OP_TEMP;
+    test_msg_create(&m, 0x00, CRUMBS_CMD_SET_REPLY, &op, 1);
+    size_t n = test_encode(&m, frame);
+    crumbs_peripheral_handle_receive(&p, frame, n);
+    read_reply(&p, &reply);
+    TEST_ASSERT_EQ(name, reply.opcode, OP_TEMP, "unconditional again");
+
+    /* The sequence skips 0 when it wraps. */
+    crumbs_set_change_seq(&p, 0xFFFFu);
+    crumbs_mark_changed(&p);
+    TEST_ASSERT_EQ(name, crumbs_change_seq(&p), 1, "wraps to 1");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_controller_cache(void)
+{
+    const char *name = "controller cache serves unchanged polls";
+    crumbs_vbus_t bus;
+    crumbs_context_t p, ctrl;
+    crumbs_device_t dev;
+    crumbs_change_cache_t cache;
+    crumbs_message_t out;
+
+    crumbs_vbus_init(&bus, 100000u);
+    crumbs_vbus_use(&bus);
+    setup_sensor(&p);
+    g_temp = 215u;
+    TEST_ASSERT(name, crumbs_vbus_attach(&bus, &p, 0u, 0u) != NULL, "attach");
+    test_init_controller(&ctrl);
+    crumbs_vbus_bind(&bus, &dev, &ctrl, 0x10);
+    crumbs_change_cache_init(&cache, OP_TEMP);
+
+    TEST_ASSERT_EQ(name, crumbs_controller_get_if_changed(&dev, &cache, &out), 1, "first poll");
+    TEST_ASSERT_EQ(name, out.opcode, OP_TEMP, "unwrapped opcode");
+    TEST_ASSERT_EQ(name, out.data_len, 2, "unwrapped len");
+    TEST_ASSERT_EQ(name, out.data[0], 215 & 0xFF, "value");
+    TEST_ASSERT_EQ(name, cache.seq, 1, "seq cached");
+
+    /* Idle polls: one write and a 4-byte read each. */
+    uint64_t busy0 = bus.busy_ns;
+    for (int i = 0; i < 10; i++)
+    {
+        memset(&out, 0, sizeof(out));
+        TEST_ASSERT_EQ(name, crumbs_controller_get_if_changed(&dev, &cache, &out), 0, "unchanged");
+        TEST_ASSERT_EQ(name, out.data[0], 215 & 0xFF, "served from cache");
+    }
+    uint64_t idle_ns = (bus.busy_ns - busy0) / 10u;
+    TEST_ASSERT_EQ(name, cache.hits, 10, "hits");
+
+    /* A plain query of the same value, for comparison. */
+    busy0 = bus.busy_ns;
+    crumbs_message_t m;
+    uint8_t op = OP_TEMP;
+    test_msg_create(&m, 0x00, CRUMBS_CMD_SET_REPLY, &op, 1);
+    crumbs_controller_send(&ctrl, 0x10, &m, crumbs_vbus_write, &bus);
+    crumbs_controller_read(&ctrl, 0x10, &out, crumbs_vbus_read, &bus);
+    uint64_t plain_ns = bus.busy_ns - busy0;
+    TEST_ASSERT(name, idle_ns * 2u < plain_ns, "much less bus time");
+
+    /* A change comes through with two reads. */
+    g_temp = 240u;
+    crumbs_mark_changed(&p);
+    TEST_ASSERT_EQ(name, crumbs_controller_get_if_changed(&dev, &cache, &out), 1, "changed");
+    TEST_ASSERT_EQ(name, out.data[0], 240, "new value");
+    TEST_ASSERT_EQ(name, cache.seq, 2, "new seq");
+    TEST_ASSERT_EQ(name, crumbs_controller_get_if_changed(&dev, &cache, &cache.reply), 0, "in place");
+    TEST_ASSERT_EQ(name, cache.misses, 2, "misses");
+
+    /* Replies without a sequence are always fetched in full. */
+    crumbs_change_cache_t dump;
+    crumbs_change_cache_init(&dump, OP_DUMP);
+    TEST_ASSERT_EQ(name, crumbs_controller_get_if_changed(&dev, &dump, &out), 1, "dump");
+    TEST_ASSERT_EQ(name, out.data_len, CRUMBS_MAX_PAYLOAD, "dump len");
+    TEST_ASSERT_EQ(name, crumbs_controller_get_if_changed(&dev, &dump, &out), 1, "dump again");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Change sequence tests:\n");
+
+    failures += test_peripheral_condition();
+    failures += test_controller_cache();
+
+    if (failures == 0)
+    {
+        printf("All change sequence tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d change sequence test(s) failed.\n", failures);
+    return 1;
+}
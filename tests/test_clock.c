@@ -0,0 +1,215 @@
+/*
+ * Tests for bus clock negotiation: the CAPABILITIES clock field, picking
+ * the fastest rate every device tolerates, and stepping down when CRC
+ * errors climb.
+ *
+ * Simulated peripherals are real peripheral contexts; reads return their
+ * built reply, optionally with a corrupted CRC byte.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_clock.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define SIM_DEVICES 3
+
+static crumbs_context_t g_periph[SIM_DEVICES];
+static int g_corrupt;
+static uint32_t g_clock_hz;
+static int g_clock_calls;
+static int g_clock_fail;
+
+static crumbs_context_t *sim_lookup(uint8_t addr)
+{
+    for (int i = 0; i < SIM_DEVICES; i++)
+    {
+        if (g_periph[i].address == addr)
+            return &g_periph[i];
+    }
+    return NULL;
+}
+
+static int sim_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    crumbs_context_t *p = sim_lookup(addr);
+    (void)user_ctx;
+    if (!p)
+        return -1;
+    return crumbs_peripheral_handle_receive(p, data, len);
+}
+
+static int sim_read(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len, uint32_t timeout_us)
+{
+    crumbs_context_t *p = sim_lookup(addr);
+    size_t n = 0;
+    (void)user_ctx;
+    (void)timeout_us;
+    if (!p || crumbs_peripheral_build_reply(p, buffer, len, &n) != 0)
+        return -1;
+    if (g_corrupt && n > 0u)
+        buffer[n - 1u] ^= 0xFFu;
+    return (int)n;
+}
+
+static void sim_delay(uint32_t us)
+{
+    (void)us;
+}
+
+static int sim_set_clock(void *io, uint32_t hz)
+{
+    (void)io;
+    g_clock_calls++;
+    if (g_clock_fail)
+        return -5;
+    g_clock_hz = hz;
+    return 0;
+}
+
+static void setup(crumbs_context_t *ctrl, crumbs_device_t *devs)
+{
+    test_init_controller(ctrl);
+    for (int i = 0; i < SIM_DEVICES; i++)
+    {
+        crumbs_init(&g_periph[i], CRUMBS_ROLE_PERIPHERAL, (uint8_t)(0x20 + i));
+        memset(&devs[i], 0, sizeof(devs[i]));
+        devs[i].ctx = ctrl;
+        devs[i].addr = (uint8_t)(0x20 + i);
+        devs[i].write_fn = sim_write;
+        devs[i].read_fn = sim_read;
+        devs[i].delay_fn = sim_delay;
+    }
+    g_corrupt = 0;
+    g_clock_hz = 0u;
+    g_clock_calls = 0;
+    g_clock_fail = 0;
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_capabilities_field(void)
+{
+    const char *name = "capabilities carry the clock";
+    crumbs_context_t ctrl;
+    crumbs_device_t devs[SIM_DEVICES];
+    crumbs_capabilities_t caps;
+
+    setup(&ctrl, devs);
+    TEST_ASSERT_EQ(name, crumbs_controller_get_capabilities(&devs[0], &caps), 0, "query");
+    TEST_ASSERT_EQ(name, caps.max_bus_khz, 0, "not advertised");
+
+    TEST_ASSERT_EQ(name, crumbs_set_max_bus_clock(&g_periph[0], CRUMBS_BUS_KHZ_FAST_PLUS), 0, "set");
+    TEST_ASSERT_EQ(name, crumbs_controller_get_capabilities(&devs[0], &caps), 0, "query");
+    TEST_ASSERT_EQ(name, caps.max_bus_khz, CRUMBS_BUS_KHZ_FAST_PLUS, "advertised");
+    TEST_ASSERT_EQ(name, crumbs_set_max_bus_clock(NULL, 400u), -1, "NULL ctx");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_negotiate(void)
+{
+    const char *name = "negotiation picks the common fastest rate";
+    crumbs_context_t ctrl;
+    crumbs_device_t devs[SIM_DEVICES];
+    crumbs_bus_clock_t clk;
+
+    setup(&ctrl, devs);
+    crumbs_set_max_bus_clock(&g_periph[0], CRUMBS_BUS_KHZ_FAST_PLUS);
+    crumbs_set_max_bus_clock(&g_periph[1], CRUMBS_BUS_KHZ_FAST_PLUS);
+    crumbs_set_max_bus_clock(&g_periph[2], 3400u); /* high-speed capable */
+
+    crumbs_bus_clock_init(&clk, &ctrl, sim_set_clock, NULL, 0u);
+    TEST_ASSERT_EQ(name, clk.current_hz, 100000, "starts at standard mode");
+    TEST_ASSERT_EQ(name, crumbs_bus_clock_negotiate(&clk, devs, SIM_DEVICES), 1000000, "all fast-plus");
+    TEST_ASSERT_EQ(name, g_clock_hz, 1000000, "clock applied");
+
+    /* One fast-mode device caps the segment; 700 kHz snaps down to 400. */
+    crumbs_set_max_bus_clock(&g_periph[1], 700u);
+    TEST_ASSERT_EQ(name, crumbs_bus_clock_negotiate(&clk, devs, SIM_DEVICES), 400000, "capped");
+    TEST_ASSERT_EQ(name, g_clock_hz, 400000, "clock applied");
+
+    /* A device that does not advertise counts as standard mode. */
+    crumbs_set_max_bus_clock(&g_periph[1], 0u);
+    TEST_ASSERT_EQ(name, crumbs_bus_clock_negotiate(&clk, devs, SIM_DEVICES), 100000, "legacy device");
+
+    /* The host limit applies too. */
+    crumbs_set_max_bus_clock(&g_periph[1], CRUMBS_BUS_KHZ_FAST_PLUS);
+    crumbs_bus_clock_init(&clk, &ctrl, sim_set_clock, NULL, 400000u);
+    TEST_ASSERT_EQ(name, crumbs_bus_clock_negotiate(&clk, devs, SIM_DEVICES), 400000, "host limit");
+
+    g_clock_fail = 1;
+    TEST_ASSERT_EQ(name, crumbs_bus_clock_negotiate(&clk, devs, SIM_DEVICES), -5, "set_clock error");
+    TEST_ASSERT_EQ(name, crumbs_bus_clock_negotiate(NULL, devs, SIM_DEVICES), -1, "NULL clk");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_fallback(void)
+{
+    const char *name = "CRC errors step the clock down";
+    crumbs_context_t ctrl;
+    crumbs_device_t devs[SIM_DEVICES];
+    crumbs_bus_clock_t clk;
+    crumbs_capabilities_t caps;
+
+    setup(&ctrl, devs);
+    for (int i = 0; i < SIM_DEVICES; i++)
+        crumbs_set_max_bus_clock(&g_periph[i], CRUMBS_BUS_KHZ_FAST_PLUS);
+    crumbs_bus_clock_init(&clk, &ctrl, sim_set_clock, NULL, 0u);
+    TEST_ASSERT_EQ(name, crumbs_bus_clock_negotiate(&clk, devs, SIM_DEVICES), 1000000, "fast-plus");
+    TEST_ASSERT_EQ(name, crumbs_bus_clock_check(&clk), 0, "clean bus");
+
+    /* A few bad frames below the limit are tolerated. */
+    g_corrupt = 1;
+    for (unsigned i = 0; i + 1u < CRUMBS_BUS_CLOCK_CRC_LIMIT; i++)
+        (void)crumbs_controller_get_capabilities(&devs[0], &caps);
+    TEST_ASSERT_EQ(name, crumbs_bus_clock_check(&clk), 0, "below limit");
+
+    for (unsigned i = 0; i < CRUMBS_BUS_CLOCK_CRC_LIMIT; i++)
+        (void)crumbs_controller_get_capabilities(&devs[0], &caps);
+    TEST_ASSERT_EQ(name, crumbs_bus_clock_check(&clk), 1, "stepped down");
+    TEST_ASSERT_EQ(name, g_clock_hz, 400000, "fast mode");
+
+    for (unsigned i = 0; i < CRUMBS_BUS_CLOCK_CRC_LIMIT; i++)
+        (void)crumbs_controller_get_capabilities(&devs[0], &caps);
+    TEST_ASSERT_EQ(name, crumbs_bus_clock_check(&clk), 1, "stepped down again");
+    TEST_ASSERT_EQ(name, g_clock_hz, 100000, "standard mode");
+
+    for (unsigned i = 0; i < CRUMBS_BUS_CLOCK_CRC_LIMIT; i++)
+        (void)crumbs_controller_get_capabilities(&devs[0], &caps);
+    TEST_ASSERT_EQ(name, crumbs_bus_clock_check(&clk), 0, "floor reached");
+    TEST_ASSERT_EQ(name, clk.fallbacks, 2, "fallbacks");
+    TEST_ASSERT_EQ(name, clk.ceiling_hz, 100000, "ceiling lowered");
+    TEST_ASSERT_EQ(name, crumbs_bus_clock_check(NULL), -1, "NULL clk");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Bus clock tests:\n");
+
+    failures += test_capabilities_field();
+    failures += test_negotiate();
+    failures += test_fallback();
+
+    if (failures == 0)
+    {
+        printf("All bus clock tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d bus clock test(s) failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,231 @@
+/*
+ * Tests for headers from scripts/generate_family.py: generated packers match
+ * the crumbs_msg_add_*() layout, decoders make their one length check, and
+ * controller and peripheral halves of the same schema talk over the virtual
+ * bus. tests/probe_ops.h covers every field type; servo_ops.h is the
+ * lhwit_family header generated from servo.json.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_message_helpers.h"
+#include "crumbs_vbus.h"
+#include "probe_ops.h"
+#include "servo_ops.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+static probe_configure_args_t g_cfg;
+static int g_cfg_rc;
+static int g_resets;
+static servo_sweep_args_t g_sweep;
+
+static void on_configure(crumbs_context_t *ctx, uint8_t opcode, const uint8_t *data,
+                         uint8_t len, void *user_data)
+{
+    (void)ctx;
+    (void)opcode;
+    (void)user_data;
+    g_cfg_rc = probe_unpack_configure(data, len, &g_cfg);
+}
+
+static void on_reset(crumbs_context_t *ctx, uint8_t opcode, const uint8_t *data,
+                     uint8_t len, void *user_data)
+{
+    probe_reset_args_t args;
+    (void)ctx;
+    (void)opcode;
+    (void)user_data;
+    if (probe_unpack_reset(data, len, &args) == 0)
+    {
+        g_resets++;
+    }
+}
+
+static void on_sample(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    probe_sample_result_t s;
+    (void)ctx;
+    (void)user_data;
+    s.raw[0] = -1;
+    s.raw[1] = 300;
+    s.raw[2] = -32768;
+    s.raw[3] = 32767;
+    s.celsius = 21.5f;
+    s.uptime = 0x01020304u;
+    probe_reply_sample(reply, &s);
+}
+
+static void on_sweep(crumbs_context_t *ctx, uint8_t opcode, const uint8_t *data,
+                     uint8_t len, void *user_data)
+{
+    (void)ctx;
+    (void)opcode;
+    (void)user_data;
+    servo_unpack_sweep(data, len, &g_sweep);
+}
+
+static void on_servo_pos(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    servo_pos_result_t r;
+    (void)ctx;
+    (void)user_data;
+    r.pos[0] = 45u;
+    r.pos[1] = 135u;
+    servo_reply_pos(reply, &r);
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_layout(void)
+{
+    const char *name = "packers match the msg helper layout";
+    const uint16_t points[3] = {0x1234u, 0u, 0xFFFFu};
+    crumbs_message_t gen, ref;
+    probe_configure_args_t args;
+
+    TEST_ASSERT_EQ(name, PROBE_OP_CONFIGURE_LEN, 24, "configure size");
+    TEST_ASSERT_EQ(name, PROBE_OP_GET_SAMPLE_LEN, 16, "sample size");
+    TEST_ASSERT_EQ(name, PROBE_OP_RESET_LEN, 0, "reset size");
+
+    memset(&gen, 0xEE, sizeof(gen));
+    probe_pack_configure(&gen, 7u, -3, 0xBEEFu, -2, 0xA1B2C3D4u, -100000, 1.25f, points);
+
+    crumbs_msg_init(&ref, PROBE_TYPE_ID, PROBE_OP_CONFIGURE);
+    crumbs_msg_add_u8(&ref, 7u);
+    crumbs_msg_add_i8(&ref, -3);
+    crumbs_msg_add_u16(&ref, 0xBEEFu);
+    crumbs_msg_add_i16(&ref, -2);
+    crumbs_msg_add_u32(&ref, 0xA1B2C3D4u);
+    crumbs_msg_add_i32(&ref, -100000);
+    crumbs_msg_add_float(&ref, 1.25f);
+    for (int i = 0; i < 3; i++)
+    {
+        crumbs_msg_add_u16(&ref, points[i]);
+    }
+
+    TEST_ASSERT_EQ(name, gen.type_id, ref.type_id, "type");
+    TEST_ASSERT_EQ(name, gen.opcode, ref.opcode, "opcode");
+    TEST_ASSERT_EQ(name, gen.data_len, ref.data_len, "length");
+    TEST_ASSERT(name, memcmp(gen.data, ref.data, ref.data_len) == 0, "bytes");
+
+    /* Decoding gives the arguments back. */
+    TEST_ASSERT_EQ(name, probe_unpack_configure(gen.data, gen.data_len, &args), 0, "unpack");
+    TEST_ASSERT_EQ(name, args.trim, -3, "i8");
+    TEST_ASSERT_EQ(name, args.period, 0xBEEF, "u16");
+    TEST_ASSERT_EQ(name, args.offset, -2, "i16");
+    TEST_ASSERT(name, args.mask == 0xA1B2C3D4u, "u32");
+    TEST_ASSERT(name, args.bias == -100000, "i32");
+    TEST_ASSERT(name, args.gain == 1.25f, "float");
+    TEST_ASSERT_EQ(name, args.points[2], 0xFFFF, "array");
+
+    /* One length check: a short payload or NULL pointer is refused. */
+    TEST_ASSERT_EQ(name, probe_unpack_configure(gen.data, 23u, &args), -1, "short");
+    TEST_ASSERT_EQ(name, probe_unpack_configure(NULL, 24u, &args), -1, "null data");
+    TEST_ASSERT_EQ(name, probe_unpack_configure(gen.data, 24u, NULL), -1, "null out");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_probe_bus(void)
+{
+    const char *name = "probe schema end to end";
+    const uint16_t points[3] = {1u, 2u, 3u};
+    crumbs_vbus_t bus;
+    crumbs_context_t p, ctrl;
+    crumbs_device_t dev;
+    probe_sample_result_t s;
+    probe_ping_result_t ping;
+
+    crumbs_vbus_init(&bus, 100000u);
+    crumbs_vbus_use(&bus);
+    test_init_peripheral(&p);
+    crumbs_register_handler(&p, PROBE_OP_CONFIGURE, on_configure, NULL);
+    crumbs_register_handler(&p, PROBE_OP_RESET, on_reset, NULL);
+    crumbs_register_reply_handler(&p, PROBE_OP_GET_SAMPLE, on_sample, NULL);
+    TEST_ASSERT(name, crumbs_vbus_attach(&bus, &p, 0u, 0u) != NULL, "attach");
+    test_init_controller(&ctrl);
+    crumbs_vbus_bind(&bus, &dev, &ctrl, 0x10);
+
+    g_cfg_rc = -99;
+    TEST_ASSERT_EQ(name, probe_send_configure(&dev, 1u, 2, 3u, -4, 5u, -6, 0.5f, points), 0, "send");
+    TEST_ASSERT_EQ(name, g_cfg_rc, 0, "peripheral decoded");
+    TEST_ASSERT_EQ(name, g_cfg.offset, -4, "offset");
+    TEST_ASSERT(name, g_cfg.gain == 0.5f, "gain");
+    TEST_ASSERT_EQ(name, g_cfg.points[1], 2, "points");
+
+    g_resets = 0;
+    TEST_ASSERT_EQ(name, probe_send_reset(&dev), 0, "reset");
+    TEST_ASSERT_EQ(name, g_resets, 1, "reset seen");
+
+    memset(&s, 0, sizeof(s));
+    TEST_ASSERT_EQ(name, probe_get_sample(&dev, &s), 0, "get");
+    TEST_ASSERT_EQ(name, s.raw[0], -1, "raw 0");
+    TEST_ASSERT_EQ(name, s.raw[2], -32768, "raw 2");
+    TEST_ASSERT_EQ(name, s.raw[3], 32767, "raw 3");
+    TEST_ASSERT(name, s.celsius == 21.5f, "celsius");
+    TEST_ASSERT(name, s.uptime == 0x01020304u, "uptime");
+
+    /* A GET nobody answers fails the type/opcode check. */
+    TEST_ASSERT(name, probe_get_ping(&dev, &ping) != 0, "unanswered");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_servo_bus(void)
+{
+    const char *name = "generated servo header on the bus";
+    crumbs_vbus_t bus;
+    crumbs_context_t p, ctrl;
+    crumbs_device_t dev;
+    servo_pos_result_t pos;
+
+    crumbs_vbus_init(&bus, 100000u);
+    crumbs_vbus_use(&bus);
+    test_init_peripheral(&p);
+    crumbs_register_handler(&p, SERVO_OP_SWEEP, on_sweep, NULL);
+    crumbs_register_reply_handler(&p, SERVO_OP_GET_POS, on_servo_pos, NULL);
+    TEST_ASSERT(name, crumbs_vbus_attach(&bus, &p, 0u, 0u) != NULL, "attach");
+    test_init_controller(&ctrl);
+    crumbs_vbus_bind(&bus, &dev, &ctrl, 0x10);
+
+    memset(&g_sweep, 0, sizeof(g_sweep));
+    TEST_ASSERT_EQ(name, servo_send_sweep(&dev, 1u, 1u, 10u, 170u, 5u), 0, "sweep");
+    TEST_ASSERT_EQ(name, g_sweep.servo_idx, 1, "idx");
+    TEST_ASSERT_EQ(name, g_sweep.max_pos, 170, "max");
+    TEST_ASSERT_EQ(name, g_sweep.step, 5, "step");
+
+    memset(&pos, 0, sizeof(pos));
+    TEST_ASSERT_EQ(name, servo_get_pos(&dev, &pos), 0, "get pos");
+    TEST_ASSERT_EQ(name, pos.pos[0], 45, "pos 0");
+    TEST_ASSERT_EQ(name, pos.pos[1], 135, "pos 1");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Generated family header tests:\n");
+
+    failures += test_layout();
+    failures += test_probe_bus();
+    failures += test_servo_bus();
+
+    if (failures == 0)
+    {
+        printf("All generated family header tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d generated family header test(s) failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,229 @@
+/*
+ * Tests for the role sections of crumbs_context_t and per-handler user
+ * data.
+ *
+ * Built by CMake once per CRUMBS_CONTEXT_ROLE (with CRUMBS_ENABLE_STATS so
+ * the controller section exists) and once with CRUMBS_HANDLER_USERDATA=0.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define OP_SET 0x01
+
+static int g_calls;
+static int g_messages;
+static void *g_last_user;
+static int g_token;
+static uint32_t g_now;
+
+static uint8_t g_reply[CRUMBS_MESSAGE_MAX_SIZE];
+static size_t g_reply_len;
+
+static void on_set(crumbs_context_t *ctx, uint8_t opcode, const uint8_t *data,
+                   uint8_t data_len, void *user_data)
+{
+    (void)ctx;
+    (void)opcode;
+    (void)data;
+    (void)data_len;
+    g_calls++;
+    g_last_user = user_data;
+}
+
+static void on_message(crumbs_context_t *ctx, const crumbs_message_t *msg)
+{
+    (void)ctx;
+    (void)msg;
+    g_messages++;
+}
+
+static uint32_t fake_clock(void)
+{
+    return g_now;
+}
+
+static int fake_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    (void)user_ctx;
+    (void)addr;
+    (void)data;
+    (void)len;
+    g_now += 300u;
+    return 0;
+}
+
+static int fake_read(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len, uint32_t timeout_us)
+{
+    (void)user_ctx;
+    (void)addr;
+    (void)timeout_us;
+    size_t n = g_reply_len < len ? g_reply_len : len;
+    memcpy(buffer, g_reply, n);
+    return (int)n;
+}
+
+static size_t encode_set(uint8_t *frame)
+{
+    crumbs_message_t m;
+    uint8_t v = 7;
+    test_msg_create(&m, 0x01, OP_SET, &v, 1);
+    return test_encode(&m, frame);
+}
+
+#if CRUMBS_CONTEXT_ROLE == CRUMBS_CONTEXT_CONTROLLER || !CRUMBS_HANDLER_USERDATA
+CRUMBS_STATIC_HANDLERS(g_static_cmds,
+                       {OP_SET, on_set, &g_token});
+#endif
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_sizes(void)
+{
+    const char *name = "context size and saved bytes";
+    size_t saved = crumbs_context_saved_bytes();
+
+    TEST_ASSERT_SIZE_EQ(name, crumbs_context_size(), sizeof(crumbs_context_t), "size");
+
+#if CRUMBS_CONTEXT_ROLE == CRUMBS_CONTEXT_CONTROLLER
+    /* At least both opcode, function and user_data arrays. */
+    TEST_ASSERT(name, saved >= 2u * CRUMBS_MAX_HANDLERS * (1u + 2u * sizeof(void *)), "tables saved");
+#elif CRUMBS_CONTEXT_ROLE == CRUMBS_CONTEXT_PERIPHERAL
+    TEST_ASSERT(name, saved >= sizeof(crumbs_addr_stats_t) * CRUMBS_STATS_ADDRS, "latencies saved");
+#elif !CRUMBS_HANDLER_USERDATA
+    TEST_ASSERT_SIZE_EQ(name, saved, 2u * CRUMBS_MAX_HANDLERS * sizeof(void *), "user_data saved");
+#else
+    TEST_ASSERT_SIZE_EQ(name, saved, 0u, "full context");
+#endif
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_peripheral_section(void)
+{
+    const char *name = "handler registration follows the role";
+    crumbs_context_t ctx;
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t len = encode_set(frame);
+
+    test_init_peripheral(&ctx);
+    crumbs_set_callbacks(&ctx, on_message, NULL, NULL);
+    g_calls = 0;
+    g_messages = 0;
+
+#if CRUMBS_CONTEXT_ROLE == CRUMBS_CONTEXT_CONTROLLER
+    TEST_ASSERT(name, crumbs_register_handler(&ctx, OP_SET, on_set, NULL) != 0, "no handler table");
+    TEST_ASSERT(name, crumbs_set_static_handlers(&ctx, g_static_cmds,
+                                                 CRUMBS_STATIC_TABLE_LEN(g_static_cmds)) != 0,
+                "no static table");
+    TEST_ASSERT_EQ(name, crumbs_peripheral_handle_receive(&ctx, frame, len), 0, "receive");
+    TEST_ASSERT_EQ(name, g_calls, 0, "nothing dispatched");
+#else
+    TEST_ASSERT_EQ(name, crumbs_register_handler(&ctx, OP_SET, on_set, NULL), 0, "register");
+    TEST_ASSERT_EQ(name, crumbs_peripheral_handle_receive(&ctx, frame, len), 0, "receive");
+    TEST_ASSERT_EQ(name, g_calls, 1, "dispatched");
+#endif
+    /* The common header still carries on_message in every role. */
+    TEST_ASSERT_EQ(name, g_messages, 1, "on_message");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+#if CRUMBS_CONTEXT_ROLE != CRUMBS_CONTEXT_CONTROLLER
+static int test_handler_userdata(void)
+{
+    const char *name = "per-handler user_data";
+    crumbs_context_t ctx;
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t len = encode_set(frame);
+
+    test_init_peripheral(&ctx);
+
+#if CRUMBS_HANDLER_USERDATA
+    TEST_ASSERT_EQ(name, crumbs_register_handler(&ctx, OP_SET, on_set, &g_token), 0, "register");
+    crumbs_peripheral_handle_receive(&ctx, frame, len);
+    TEST_ASSERT(name, g_last_user == &g_token, "forwarded");
+#else
+    TEST_ASSERT(name, crumbs_register_handler(&ctx, OP_SET, on_set, &g_token) != 0, "rejected");
+    TEST_ASSERT_EQ(name, crumbs_register_handler(&ctx, OP_SET, on_set, NULL), 0, "NULL accepted");
+    g_last_user = &g_token;
+    crumbs_peripheral_handle_receive(&ctx, frame, len);
+    TEST_ASSERT_NULL(name, g_last_user, "handler gets NULL");
+    TEST_ASSERT_EQ(name, crumbs_unregister_handler(&ctx, OP_SET), 0, "unregister");
+
+    /* Static tables keep theirs: it lives in flash. */
+    TEST_ASSERT_EQ(name, crumbs_set_static_handlers(&ctx, g_static_cmds,
+                                                    CRUMBS_STATIC_TABLE_LEN(g_static_cmds)),
+                   0, "static table");
+    crumbs_peripheral_handle_receive(&ctx, frame, len);
+    TEST_ASSERT(name, g_last_user == &g_token, "static user_data");
+#endif
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+#endif
+
+static int test_controller_section(void)
+{
+    const char *name = "controller latencies follow the role";
+    crumbs_context_t ctx;
+    crumbs_message_t m;
+    crumbs_message_t out;
+
+    test_init_controller(&ctx);
+#if CRUMBS_ENABLE_STATS
+    crumbs_set_stats_clock(&ctx, fake_clock);
+#else
+    (void)fake_clock;
+#endif
+    test_msg_create(&m, 0x01, OP_SET, NULL, 0);
+    g_reply_len = test_encode(&m, g_reply);
+
+    TEST_ASSERT_EQ(name, crumbs_controller_send(&ctx, 0x20, &m, fake_write, NULL), 0, "send");
+    TEST_ASSERT_EQ(name, crumbs_controller_read(&ctx, 0x20, &out, fake_read, NULL), 0, "read");
+
+#if CRUMBS_ENABLE_STATS && CRUMBS_CONTEXT_ROLE != CRUMBS_CONTEXT_PERIPHERAL
+    const crumbs_addr_stats_t *a = crumbs_get_addr_stats(&ctx, 0x20);
+    TEST_ASSERT(name, a != NULL, "latency recorded");
+    TEST_ASSERT_EQ(name, a->max_us, 300, "latency");
+#else
+    TEST_ASSERT_NULL(name, crumbs_get_addr_stats(&ctx, 0x20), "no controller section");
+#endif
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Context role tests (role %d, user_data %d, %u bytes, %u saved):\n",
+           CRUMBS_CONTEXT_ROLE, CRUMBS_HANDLER_USERDATA,
+           (unsigned)crumbs_context_size(), (unsigned)crumbs_context_saved_bytes());
+
+    failures += test_sizes();
+    failures += test_peripheral_section();
+#if CRUMBS_CONTEXT_ROLE != CRUMBS_CONTEXT_CONTROLLER
+    failures += test_handler_userdata();
+#endif
+    failures += test_controller_section();
+
+    if (failures == 0)
+    {
+        printf("All context role tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d context role test(s) failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,207 @@
+/*
+ * Tests for the C++ layer (crumbs.hpp): descriptor-typed commands and
+ * queries between a crumbs::Device and a crumbs::Peripheral on the virtual
+ * bus, short commands dropped before the handler, and the compile-time
+ * dispatch coexisting with a registered C reply handler.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.hpp"
+#include "crumbs_vbus.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+struct Mixer
+{
+    static constexpr uint8_t type_id = 0x21;
+    typedef crumbs::Command<type_id, 0x01, 7> SetChannel; /* [ch:u8][gain:i16][mask:u32] */
+    typedef crumbs::Command<type_id, 0x02> Mute;
+    typedef crumbs::Query<type_id, 0x80, 6> GetLevel;    /* reply [level:f32][peak:u16] */
+    typedef crumbs::Query<type_id, 0x81, 1> GetLegacy;   /* answered by a C reply handler */
+};
+
+struct Other
+{
+    static constexpr uint8_t type_id = 0x22;
+};
+
+static struct
+{
+    int set_calls;
+    uint8_t ch;
+    int16_t gain;
+    uint32_t mask;
+    int mutes;
+} g;
+
+struct OnSetChannel
+{
+    typedef Mixer::SetChannel op;
+    static void handle(crumbs_context_t &ctx, crumbs::View<op::len> v)
+    {
+        (void)ctx;
+        g.set_calls++;
+        g.ch = v.u8<0>();
+        g.gain = v.i16<1>();
+        g.mask = v.u32<3>();
+    }
+};
+
+struct OnMute
+{
+    typedef Mixer::Mute op;
+    static void handle(crumbs_context_t &ctx, crumbs::View<op::len> v)
+    {
+        (void)ctx;
+        (void)v;
+        g.mutes++;
+    }
+};
+
+struct OnGetLevel
+{
+    typedef Mixer::GetLevel op;
+    static void reply(crumbs_context_t &ctx, crumbs::Writer<op::reply_len> w)
+    {
+        (void)ctx;
+        w.put_f32<0>(-6.5f);
+        w.put_u16<4>(0xCAFEu);
+    }
+};
+
+typedef crumbs::Peripheral<OnSetChannel, OnMute, OnGetLevel> MixerPeripheral;
+
+static void reply_legacy(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)ctx;
+    (void)user_data;
+    reply->type_id = Mixer::type_id;
+    reply->opcode = Mixer::GetLegacy::opcode;
+    reply->data_len = 1u;
+    reply->data[0] = 0x5Au;
+}
+
+static void setup(crumbs_vbus_t &bus, crumbs_context_t &p, crumbs_context_t &ctrl, crumbs_device_t &dev)
+{
+    memset(&g, 0, sizeof(g));
+    crumbs_vbus_init(&bus, 100000u);
+    crumbs_vbus_use(&bus);
+    test_init_peripheral(&p);
+    MixerPeripheral::attach(p);
+    crumbs_vbus_attach(&bus, &p, 0u, 0u);
+    test_init_controller(&ctrl);
+    crumbs_vbus_bind(&bus, &dev, &ctrl, 0x10);
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_commands(void)
+{
+    const char *name = "typed commands reach their handlers";
+    crumbs_vbus_t bus;
+    crumbs_context_t p, ctrl;
+    crumbs_device_t dev;
+    setup(bus, p, ctrl, dev);
+    crumbs::Device<Mixer> mixer(dev);
+
+    crumbs::Frame<Mixer::SetChannel> f;
+    f.put_u8<0>(3u);
+    f.put_i16<1>(-1200);
+    f.put_u32<3>(0x80000001u);
+    TEST_ASSERT_EQ(name, mixer.send(f), 0, "send");
+    TEST_ASSERT_EQ(name, g.set_calls, 1, "handled");
+    TEST_ASSERT_EQ(name, g.ch, 3, "u8");
+    TEST_ASSERT_EQ(name, g.gain, -1200, "i16");
+    TEST_ASSERT(name, g.mask == 0x80000001u, "u32");
+
+    /* The same frame can be changed and sent again. */
+    f.put_u8<0>(4u);
+    TEST_ASSERT_EQ(name, mixer.send(f), 0, "resend");
+    TEST_ASSERT_EQ(name, g.ch, 4, "resent value");
+
+    TEST_ASSERT_EQ(name, mixer.send<Mixer::Mute>(), 0, "no payload");
+    TEST_ASSERT_EQ(name, g.mutes, 1, "mute");
+
+    /* A frame shorter than the descriptor never reaches handle(). */
+    crumbs_message_t m;
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    uint8_t short_payload[2] = {1u, 2u};
+    test_msg_create(&m, Mixer::type_id, Mixer::SetChannel::opcode, short_payload, 2);
+    crumbs_peripheral_handle_receive(&p, frame, test_encode(&m, frame));
+    TEST_ASSERT_EQ(name, g.set_calls, 2, "short command dropped");
+
+    TEST_ASSERT_EQ(name, MixerPeripheral::dispatch(p, 0x42u, NULL, 0u), 0, "unknown opcode");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_queries(void)
+{
+    const char *name = "typed queries and C handlers together";
+    crumbs_vbus_t bus;
+    crumbs_context_t p, ctrl;
+    crumbs_device_t dev;
+    setup(bus, p, ctrl, dev);
+    crumbs::Device<Mixer> mixer(dev);
+
+    crumbs::Reply<Mixer::GetLevel> level;
+    uint64_t t0 = bus.busy_ns;
+    TEST_ASSERT_EQ(name, mixer.get(level), 0, "get");
+    TEST_ASSERT(name, level.view().f32<0>() == -6.5f, "float");
+    TEST_ASSERT_EQ(name, level.view().u16<4>(), 0xCAFE, "u16");
+    TEST_ASSERT_EQ(name, level.msg.data_len, 6, "length set by dispatcher");
+    uint64_t sized = bus.busy_ns - t0;
+
+    crumbs::Reply<Mixer::GetLevel> again;
+    TEST_ASSERT_EQ(name, mixer.get_ready(again), 0, "get_ready");
+    TEST_ASSERT_EQ(name, again.view().u16<4>(), 0xCAFE, "ready value");
+
+    /* A registered reply handler runs ahead of on_request. */
+    crumbs_register_reply_handler(&p, Mixer::GetLegacy::opcode, reply_legacy, NULL);
+    crumbs::Reply<Mixer::GetLegacy> legacy;
+    TEST_ASSERT_EQ(name, mixer.get(legacy), 0, "C handler");
+    TEST_ASSERT_EQ(name, legacy.view().u8<0>(), 0x5A, "C handler value");
+
+    /* A query nobody answers fails the opcode check. */
+    crumbs::Device<Other> other(dev);
+    crumbs::Reply<crumbs::Query<Other::type_id, 0x90, 1> > none;
+    TEST_ASSERT(name, other.get(none) != 0, "unanswered");
+
+    /* The read is sized from the descriptor (10 bytes), so the whole GET
+     * costs less bus time than one plain 31-byte read. */
+    crumbs_message_t full;
+    uint8_t op = Mixer::GetLevel::opcode;
+    crumbs_message_t sr;
+    test_msg_create(&sr, 0x00, CRUMBS_CMD_SET_REPLY, &op, 1);
+    crumbs_controller_send(&ctrl, 0x10, &sr, crumbs_vbus_write, &bus);
+    t0 = bus.busy_ns;
+    crumbs_controller_read(&ctrl, 0x10, &full, crumbs_vbus_read, &bus);
+    TEST_ASSERT(name, sized < bus.busy_ns - t0, "short read");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("C++ wrapper tests:\n");
+
+    failures += test_commands();
+    failures += test_queries();
+
+    if (failures == 0)
+    {
+        printf("All C++ wrapper tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d C++ wrapper test(s) failed.\n", failures);
+    return 1;
+}
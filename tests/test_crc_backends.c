@@ -0,0 +1,158 @@
+/*
+ * CRC-8 back end tests, run once per CRUMBS_CRC_BACKEND.
+ *
+ * CMake builds this file (together with the core sources) for every back
+ * end. Each build must agree with the pycrc nibble implementation that
+ * CRUMBS has always used on the wire.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crc8_nibble.h"
+#include "test_common.h"
+
+#if CRUMBS_CRC_BACKEND == CRUMBS_CRC_BACKEND_HW
+/* Stand-in for an MCU CRC unit: plain bitwise CRC-8, poly 0x07. */
+static int g_hw_calls;
+
+crumbs_crc8_t crumbs_crc8_hw_update(crumbs_crc8_t crc, const uint8_t *data, size_t len)
+{
+    g_hw_calls++;
+    while (len--)
+    {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++)
+            crc = (crumbs_crc8_t)((crc & 0x80u) ? ((unsigned)(crc << 1) ^ 0x07u) : (unsigned)(crc << 1));
+    }
+    return crc;
+}
+#endif
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+static uint8_t reference_crc(const uint8_t *data, size_t len)
+{
+    return (uint8_t)crc_finalize(crc_update(crc_init(), data, len));
+}
+
+static void fill_pattern(uint8_t *buf, size_t len, uint32_t seed)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        buf[i] = (uint8_t)(seed >> 16);
+    }
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_single_bytes(void)
+{
+    const char *name = "every single byte";
+    for (unsigned b = 0; b < 256; b++)
+    {
+        uint8_t in = (uint8_t)b;
+        TEST_ASSERT_EQ(name, crumbs_crc8(&in, 1), reference_crc(&in, 1), "mismatch");
+    }
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_all_lengths(void)
+{
+    const char *name = "lengths 1..64";
+    uint8_t buf[64];
+
+    for (uint32_t seed = 1; seed <= 32; seed++)
+    {
+        fill_pattern(buf, sizeof(buf), seed);
+        for (size_t len = 1; len <= sizeof(buf); len++)
+        {
+            TEST_ASSERT_EQ(name, crumbs_crc8(buf, len), reference_crc(buf, len), "mismatch");
+        }
+    }
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_unaligned_start(void)
+{
+    const char *name = "unaligned start";
+    uint8_t buf[CRUMBS_MESSAGE_MAX_SIZE + 8];
+    fill_pattern(buf, sizeof(buf), 77);
+
+    for (size_t off = 0; off < 8; off++)
+    {
+        TEST_ASSERT_EQ(name, crumbs_crc8(buf + off, CRUMBS_MESSAGE_MAX_SIZE),
+                       reference_crc(buf + off, CRUMBS_MESSAGE_MAX_SIZE), "mismatch");
+    }
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_chunked_update(void)
+{
+    const char *name = "chunked update";
+    uint8_t buf[CRUMBS_MESSAGE_MAX_SIZE];
+    fill_pattern(buf, sizeof(buf), 5);
+    uint8_t whole = reference_crc(buf, sizeof(buf));
+
+    for (size_t split = 0; split <= sizeof(buf); split++)
+    {
+        crumbs_crc8_t crc = crumbs_crc8_update(0u, buf, split);
+        crc = crumbs_crc8_update(crc, buf + split, sizeof(buf) - split);
+        TEST_ASSERT_EQ(name, crc, whole, "split mismatch");
+    }
+
+    TEST_ASSERT_EQ(name, crumbs_crc8(NULL, 0), 0, "empty crc");
+    TEST_ASSERT_EQ(name, crumbs_crc8_update(0x5A, NULL, 0), 0x5A, "empty update");
+
+#if CRUMBS_CRC_BACKEND == CRUMBS_CRC_BACKEND_HW
+    TEST_ASSERT(name, g_hw_calls > 0, "hardware hook never called");
+#endif
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_frame_roundtrip(void)
+{
+    const char *name = "frame roundtrip";
+    crumbs_message_t msg, out;
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+
+    test_msg_init(&msg, 0x12, 0x34);
+    msg.data_len = CRUMBS_MAX_PAYLOAD;
+    fill_pattern(msg.data, CRUMBS_MAX_PAYLOAD, 9);
+    size_t n = test_encode(&msg, frame);
+    TEST_ASSERT_EQ(name, frame[n - 1], reference_crc(frame, n - 1), "encoded crc");
+    TEST_ASSERT_EQ(name, crumbs_decode_message(frame, n, &out, NULL), 0, "decode");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("CRC back end tests (CRUMBS_CRC_BACKEND=%d):\n", CRUMBS_CRC_BACKEND);
+
+    failures += test_single_bytes();
+    failures += test_all_lengths();
+    failures += test_unaligned_start();
+    failures += test_chunked_update();
+    failures += test_frame_roundtrip();
+
+    if (failures == 0)
+    {
+        printf("All CRC back end tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d CRC back end test(s) failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,240 @@
+/*
+ * Tests for the reply cursor: opcode and index stepping, wrap-around,
+ * NOT_READY holding the cursor, cursors ended by a plain SET_REPLY,
+ * crumbs_controller_read_sequence() on the virtual bus, and two-phase
+ * reads refusing a moving cursor. Built with
+ * CRUMBS_ENABLE_REPLY_CURSOR=1.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_vbus.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define OP_HIST_0 0x82
+#define OP_LOG 0x40
+#define HIST 12
+
+static int g_not_ready; /* NOT_READY replies still to give */
+
+static void reply_hist(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)user_data;
+    reply->type_id = 0x03;
+    reply->opcode = ctx->requested_opcode;
+    reply->data_len = 2u;
+    reply->data[0] = (uint8_t)(ctx->requested_opcode - OP_HIST_0);
+    reply->data[1] = crumbs_reply_cursor(ctx);
+}
+
+static void reply_log(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)user_data;
+    if (g_not_ready > 0)
+    {
+        g_not_ready--;
+        crumbs_reply_not_ready(reply);
+        return;
+    }
+    reply->type_id = 0x03;
+    reply->opcode = OP_LOG;
+    reply->data_len = 1u;
+    reply->data[0] = crumbs_reply_cursor(ctx); /* page number */
+}
+
+static void setup_periph(crumbs_context_t *p)
+{
+    test_init_peripheral(p);
+    for (uint8_t i = 0; i < HIST; i++)
+    {
+        crumbs_register_reply_handler(p, (uint8_t)(OP_HIST_0 + i), reply_hist, NULL);
+    }
+    crumbs_register_reply_handler(p, OP_LOG, reply_log, NULL);
+    g_not_ready = 0;
+}
+
+static void set_reply(crumbs_context_t *p, const uint8_t *payload, uint8_t len)
+{
+    crumbs_message_t m;
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    test_msg_create(&m, 0x00, CRUMBS_CMD_SET_REPLY, payload, len);
+    size_t n = test_encode(&m, frame);
+    crumbs_peripheral_handle_receive(p, frame, n);
+}
+
+static void read_reply(crumbs_context_t *p, crumbs_message_t *reply)
+{
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t len = 0u;
+    memset(reply, 0, sizeof(*reply));
+    crumbs_peripheral_build_reply(p, frame, sizeof(frame), &len);
+    crumbs_decode_message(frame, len, reply, NULL);
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_opcode_cursor(void)
+{
+    const char *name = "opcode cursor steps and wraps";
+    crumbs_context_t p;
+    crumbs_message_t reply;
+    uint8_t sr[3] = {OP_HIST_0, CRUMBS_CURSOR_OPCODE, 3u};
+
+    setup_periph(&p);
+    set_reply(&p, sr, 3);
+    for (int round = 0; round < 2; round++)
+    {
+        for (uint8_t i = 0; i < 3u; i++)
+        {
+            read_reply(&p, &reply);
+            TEST_ASSERT_EQ(name, reply.opcode, OP_HIST_0 + i, "opcode");
+            TEST_ASSERT_EQ(name, reply.data[1], i, "cursor seen by handler");
+        }
+    }
+
+    /* A plain SET_REPLY ends the cursor. */
+    sr[0] = OP_HIST_0 + 5u;
+    set_reply(&p, sr, 1);
+    read_reply(&p, &reply);
+    read_reply(&p, &reply);
+    TEST_ASSERT_EQ(name, reply.opcode, OP_HIST_0 + 5u, "fixed again");
+    TEST_ASSERT_EQ(name, reply.data[1], 0, "no cursor");
+
+    /* Unknown modes behave as a plain SET_REPLY. */
+    uint8_t bad[3] = {OP_HIST_0, 9u, 3u};
+    set_reply(&p, bad, 3);
+    read_reply(&p, &reply);
+    read_reply(&p, &reply);
+    TEST_ASSERT_EQ(name, reply.opcode, OP_HIST_0, "unknown mode");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_index_cursor(void)
+{
+    const char *name = "index cursor pages within one opcode";
+    crumbs_context_t p;
+    crumbs_message_t reply;
+    uint8_t sr[3] = {OP_LOG, CRUMBS_CURSOR_INDEX, 4u};
+
+    setup_periph(&p);
+    set_reply(&p, sr, 3);
+    for (uint8_t i = 0; i < 6u; i++)
+    {
+        read_reply(&p, &reply);
+        TEST_ASSERT_EQ(name, reply.opcode, OP_LOG, "opcode fixed");
+        TEST_ASSERT_EQ(name, reply.data[0], i % 4u, "page");
+    }
+
+    /* NOT_READY holds the cursor. */
+    set_reply(&p, sr, 3);
+    read_reply(&p, &reply);
+    g_not_ready = 2;
+    read_reply(&p, &reply);
+    TEST_ASSERT_EQ(name, reply.opcode, CRUMBS_CMD_NOT_READY, "not ready");
+    read_reply(&p, &reply);
+    read_reply(&p, &reply);
+    TEST_ASSERT_EQ(name, reply.data[0], 1, "same page after NOT_READY");
+
+    /* count 0 runs through 256 pages. */
+    sr[2] = 0u;
+    set_reply(&p, sr, 3);
+    for (int i = 0; i < 256; i++)
+    {
+        read_reply(&p, &reply);
+    }
+    TEST_ASSERT_EQ(name, reply.data[0], 255, "last of 256");
+    read_reply(&p, &reply);
+    TEST_ASSERT_EQ(name, reply.data[0], 0, "wrapped at 256");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_controller_sequence(void)
+{
+    const char *name = "back-to-back reads over the bus";
+    crumbs_vbus_t bus;
+    crumbs_context_t p, ctrl;
+    crumbs_device_t dev;
+    crumbs_message_t out[HIST];
+
+    crumbs_vbus_init(&bus, 100000u);
+    crumbs_vbus_use(&bus);
+    setup_periph(&p);
+    TEST_ASSERT(name, crumbs_vbus_attach(&bus, &p, 0u, 0u) != NULL, "attach");
+    test_init_controller(&ctrl);
+    crumbs_vbus_bind(&bus, &dev, &ctrl, 0x10);
+
+    /* One SET_REPLY per page, the old way. */
+    uint32_t t0 = bus.transfers;
+    for (uint8_t i = 0; i < HIST; i++)
+    {
+        crumbs_message_t sr;
+        uint8_t op = (uint8_t)(OP_HIST_0 + i);
+        test_msg_create(&sr, 0x00, CRUMBS_CMD_SET_REPLY, &op, 1);
+        crumbs_controller_send(&ctrl, 0x10, &sr, crumbs_vbus_write, &bus);
+        crumbs_controller_read(&ctrl, 0x10, &out[i], crumbs_vbus_read, &bus);
+    }
+    uint32_t paged = bus.transfers - t0;
+
+    memset(out, 0, sizeof(out));
+    t0 = bus.transfers;
+    TEST_ASSERT_EQ(name, crumbs_controller_read_sequence(&dev, OP_HIST_0, CRUMBS_CURSOR_OPCODE, HIST, out),
+                   0, "sequence");
+    uint32_t cursor = bus.transfers - t0;
+    for (uint8_t i = 0; i < HIST; i++)
+    {
+        TEST_ASSERT_EQ(name, out[i].opcode, OP_HIST_0 + i, "opcode");
+        TEST_ASSERT_EQ(name, out[i].data[0], i, "entry");
+    }
+    TEST_ASSERT_EQ(name, paged, 2 * HIST, "write + read per page");
+    TEST_ASSERT_EQ(name, cursor, 1 + HIST, "one write, then reads only");
+
+    /* Index pages with a NOT_READY on the first page. */
+    g_not_ready = 1;
+    TEST_ASSERT_EQ(name, crumbs_controller_read_sequence(&dev, OP_LOG, CRUMBS_CURSOR_INDEX, 3u, out),
+                   0, "pages");
+    TEST_ASSERT_EQ(name, out[2].data[0], 2, "page 2");
+
+    /* A device whose replies stop matching the cursor fails the sequence. */
+    TEST_ASSERT_EQ(name, crumbs_controller_read_sequence(&dev, OP_HIST_0 + 10u, CRUMBS_CURSOR_OPCODE, 3u, out),
+                   -1, "ran off the table");
+    TEST_ASSERT_EQ(name, crumbs_controller_read_sequence(&dev, OP_LOG, 0u, 3u, out), -1, "bad mode");
+
+    /* The header peek of a two-phase read moves the cursor on by itself. */
+    TEST_ASSERT_EQ(name, crumbs_controller_set_cursor(&dev, OP_HIST_0, CRUMBS_CURSOR_OPCODE, 3u), 0, "cursor");
+    TEST_ASSERT_EQ(name, crumbs_controller_read_two_phase(&ctrl, 0x10, &out[0], crumbs_vbus_read, &bus),
+                   -1, "two-phase rejected");
+    TEST_ASSERT_EQ(name, crumbs_controller_read(&ctrl, 0x10, &out[0], crumbs_vbus_read, &bus), 0, "read");
+    TEST_ASSERT_EQ(name, out[0].opcode, OP_HIST_0 + 2u, "two pages gone");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Reply cursor tests:\n");
+
+    failures += test_opcode_cursor();
+    failures += test_index_cursor();
+    failures += test_controller_sequence();
+
+    if (failures == 0)
+    {
+        printf("All reply cursor tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d reply cursor test(s) failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,315 @@
+/*
+ * Tests for crumbsd: a daemon in a child process serving a virtual bus,
+ * with two clients in the parent. Covers pass-through transfers, identical
+ * GETs sharing one bus read and the reply cache, a conflicting SET_REPLY
+ * waiting for the other client's read (and for an expired selection),
+ * and a disconnect releasing its selection.
+ */
+
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE /* kill, usleep */
+#endif
+
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "crumbs.h"
+#include "crumbs_linux_daemon.h"
+#include "crumbs_message_helpers.h"
+#include "crumbs_transport.h"
+#include "crumbs_vbus.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define OP_SET 0x01
+#define OP_COUNT 0x40 /* replies with how many times it was built */
+#define OP_FIXED 0x41 /* replies 0xAA */
+#define DEV 0x10
+
+static char g_path[64];
+static pid_t g_child = -1;
+static crumbs_context_t g_ctx_a, g_ctx_b;
+static crumbs_daemon_client_t g_a, g_b;
+
+/* Only the child's copies change. */
+static crumbs_vbus_t g_bus;
+static crumbs_context_t g_periph;
+static uint8_t g_count;
+
+static void on_set(crumbs_context_t *ctx, uint8_t opcode, const uint8_t *data,
+                   uint8_t data_len, void *user_data)
+{
+    (void)ctx;
+    (void)opcode;
+    (void)data;
+    (void)data_len;
+    (void)user_data;
+}
+
+static void reply_count(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)ctx;
+    (void)user_data;
+    crumbs_msg_init(reply, 0x07, OP_COUNT);
+    crumbs_msg_add_u8(reply, ++g_count);
+}
+
+static void reply_fixed(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)ctx;
+    (void)user_data;
+    crumbs_msg_init(reply, 0x07, OP_FIXED);
+    crumbs_msg_add_u8(reply, 0xAA);
+}
+
+static void no_delay(uint32_t us)
+{
+    (void)us;
+}
+
+static int start_daemon(void)
+{
+    static crumbs_daemon_t d;
+
+    crumbs_vbus_init(&g_bus, 400000u);
+    crumbs_vbus_use(&g_bus);
+    crumbs_init(&g_periph, CRUMBS_ROLE_PERIPHERAL, DEV);
+    crumbs_register_handler(&g_periph, OP_SET, on_set, NULL);
+    crumbs_register_reply_handler(&g_periph, OP_COUNT, reply_count, NULL);
+    crumbs_register_reply_handler(&g_periph, OP_FIXED, reply_fixed, NULL);
+    crumbs_vbus_attach(&g_bus, &g_periph, 0u, 0u);
+
+    snprintf(g_path, sizeof(g_path), "/tmp/crumbsd_test_%d.sock", (int)getpid());
+    if (crumbs_daemon_init(&d, g_path, &crumbs_vbus_transport, &g_bus) != 0)
+    {
+        return -1;
+    }
+    /* Long enough that a slow runner never sees the cache expire mid-test. */
+    d.cache_ttl_us = 2000000u;
+    d.select_timeout_us = 200000u;
+
+    /* Listening before the fork, so the clients cannot connect too early. */
+    g_child = fork();
+    if (g_child == 0)
+    {
+        for (;;)
+        {
+            crumbs_daemon_poll(&d, 100);
+        }
+    }
+    close(d.listen_fd);
+    return (g_child > 0) ? 0 : -1;
+}
+
+static void stop_daemon(void)
+{
+    crumbs_daemon_disconnect(&g_a);
+    crumbs_daemon_disconnect(&g_b);
+    if (g_child > 0)
+    {
+        kill(g_child, SIGTERM);
+        waitpid(g_child, NULL, 0);
+    }
+    unlink(g_path);
+}
+
+static int select_reply(crumbs_daemon_client_t *c, uint8_t opcode)
+{
+    crumbs_message_t m;
+    crumbs_msg_init(&m, 0x00, CRUMBS_CMD_SET_REPLY);
+    crumbs_msg_add_u8(&m, opcode);
+    return crumbs_controller_send(&g_ctx_a, DEV, &m, crumbs_daemon_write, c);
+}
+
+/* The reply's first payload byte, or -1. */
+static int read_value(crumbs_context_t *ctx, crumbs_daemon_client_t *c, uint8_t opcode)
+{
+    crumbs_message_t m;
+    if (crumbs_controller_read(ctx, DEV, &m, crumbs_daemon_read, c) != 0 ||
+        m.opcode != opcode || m.data_len < 1u)
+    {
+        return -1;
+    }
+    return m.data[0];
+}
+
+static int send_set(void)
+{
+    crumbs_message_t m;
+    crumbs_msg_init(&m, 0x01, OP_SET);
+    crumbs_msg_add_u8(&m, 1);
+    return crumbs_transport_send(&g_ctx_a, DEV, &m);
+}
+
+static crumbs_daemon_stats_t stats(void)
+{
+    crumbs_daemon_stats_t s;
+    memset(&s, 0, sizeof(s));
+    crumbs_daemon_get_stats(&g_a, &s);
+    return s;
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_passthrough(void)
+{
+    const char *name = "transfers pass through the daemon";
+    crumbs_device_t dev;
+    crumbs_message_t m;
+    crumbs_daemon_stats_t s0 = stats(), s1;
+
+    TEST_ASSERT_EQ(name, (int)s0.clients, 2, "two clients");
+    TEST_ASSERT_EQ(name, send_set(), 0, "command");
+    TEST_ASSERT(name, crumbs_daemon_write(&g_a, 0x50, (const uint8_t *)"\x01", 1u) != 0,
+                "NACK reaches the client");
+
+    /* crumbs_device_query() takes the combined-transfer route. */
+    TEST_ASSERT_EQ(name, crumbs_device_init(&dev, &g_ctx_b, DEV, no_delay), 0, "device");
+    TEST_ASSERT_EQ(name, crumbs_device_query(&dev, OP_FIXED, &m, CRUMBS_MAX_PAYLOAD), 0, "query");
+    TEST_ASSERT_EQ(name, m.data[0], 0xAA, "reply");
+
+    s1 = stats();
+    TEST_ASSERT_EQ(name, (int)(s1.transfers - s0.transfers), 3, "one bus transfer each");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_coalesce(void)
+{
+    const char *name = "identical GETs share one bus read";
+    crumbs_device_t dev;
+    crumbs_message_t m;
+    crumbs_daemon_stats_t s0, s1;
+
+    TEST_ASSERT_EQ(name, send_set(), 0, "start from a fresh device state");
+    s0 = stats();
+
+    TEST_ASSERT_EQ(name, select_reply(&g_a, OP_COUNT), 0, "A selects");
+    TEST_ASSERT_EQ(name, select_reply(&g_b, OP_COUNT), 0, "B joins");
+    TEST_ASSERT_EQ(name, read_value(&g_ctx_a, &g_a, OP_COUNT), 1, "A reads");
+    TEST_ASSERT_EQ(name, read_value(&g_ctx_b, &g_b, OP_COUNT), 1, "B sees the same reply");
+
+    s1 = stats();
+    TEST_ASSERT_EQ(name, (int)(s1.transfers - s0.transfers), 2, "one SET_REPLY, one read");
+    TEST_ASSERT_EQ(name, (int)(s1.coalesced - s0.coalesced), 1, "joined");
+    TEST_ASSERT_EQ(name, (int)(s1.cache_hits - s0.cache_hits), 1, "served from cache");
+
+    /* A GET within the TTL, combined or split, does not touch the bus. */
+    TEST_ASSERT_EQ(name, crumbs_device_init(&dev, &g_ctx_b, DEV, no_delay), 0, "device");
+    TEST_ASSERT_EQ(name, crumbs_device_query(&dev, OP_COUNT, &m, CRUMBS_MAX_PAYLOAD), 0, "query");
+    TEST_ASSERT_EQ(name, m.data[0], 1, "cached");
+    TEST_ASSERT_EQ(name, select_reply(&g_a, OP_COUNT), 0, "select again");
+    TEST_ASSERT_EQ(name, read_value(&g_ctx_a, &g_a, OP_COUNT), 1, "cached read");
+    TEST_ASSERT_EQ(name, (int)(stats().transfers - s1.transfers), 0, "no bus time");
+
+    /* A command invalidates the cache. */
+    TEST_ASSERT_EQ(name, send_set(), 0, "command");
+    TEST_ASSERT_EQ(name, crumbs_device_query(&dev, OP_COUNT, &m, CRUMBS_MAX_PAYLOAD), 0, "query");
+    TEST_ASSERT_EQ(name, m.data[0], 2, "fresh read");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_conflict(void)
+{
+    const char *name = "a different SET_REPLY waits for the pending read";
+    uint8_t req[CRUMBS_DAEMON_HEADER_LEN + CRUMBS_MESSAGE_MAX_SIZE];
+    uint8_t resp[8];
+    crumbs_frame_builder_t fb;
+    crumbs_daemon_stats_t s0;
+    size_t len;
+
+    TEST_ASSERT_EQ(name, send_set(), 0, "fresh device state");
+    s0 = stats();
+    TEST_ASSERT_EQ(name, select_reply(&g_a, OP_COUNT), 0, "A selects");
+
+    /* B's request goes out by hand so the parent can let A read meanwhile. */
+    crumbs_fb_init(&fb, 0x00, CRUMBS_CMD_SET_REPLY);
+    crumbs_fb_add_u8(&fb, OP_FIXED);
+    len = crumbs_fb_finish(&fb);
+    memset(req, 0, CRUMBS_DAEMON_HEADER_LEN);
+    req[0] = CRUMBS_DAEMON_OP_WRITE;
+    req[1] = DEV;
+    memcpy(&req[CRUMBS_DAEMON_HEADER_LEN], fb.frame, len);
+    TEST_ASSERT(name, send(g_b.fd, req, CRUMBS_DAEMON_HEADER_LEN + len, 0) > 0, "B selects");
+    usleep(20000);
+    TEST_ASSERT_EQ(name, (int)recv(g_b.fd, resp, sizeof(resp), MSG_DONTWAIT), -1, "B waits");
+
+    TEST_ASSERT_EQ(name, read_value(&g_ctx_a, &g_a, OP_COUNT), 3, "A gets its own reply");
+    TEST_ASSERT_EQ(name, (int)recv(g_b.fd, resp, sizeof(resp), 0), 4, "B released");
+    TEST_ASSERT_EQ(name, resp[0], 0, "B's write went out");
+    TEST_ASSERT_EQ(name, read_value(&g_ctx_b, &g_b, OP_FIXED), 0xAA, "B gets its own reply");
+    TEST_ASSERT_EQ(name, (int)(stats().waits - s0.waits), 1, "wait counted");
+
+    /* A selection nobody reads holds others off only for select_timeout_us. */
+    TEST_ASSERT_EQ(name, select_reply(&g_a, OP_COUNT), 0, "A selects, never reads");
+    TEST_ASSERT_EQ(name, select_reply(&g_b, OP_FIXED), 0, "B goes ahead after the timeout");
+    TEST_ASSERT_EQ(name, read_value(&g_ctx_b, &g_b, OP_FIXED), 0xAA, "B's reply");
+    TEST_ASSERT_EQ(name, (int)(stats().expired - s0.expired), 1, "expiry counted");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_disconnect(void)
+{
+    const char *name = "a disconnect releases its selection";
+    crumbs_daemon_stats_t s0;
+
+    TEST_ASSERT_EQ(name, select_reply(&g_b, OP_COUNT), 0, "B selects");
+    crumbs_daemon_disconnect(&g_b);
+    usleep(20000);
+
+    s0 = stats();
+    TEST_ASSERT_EQ(name, (int)s0.clients, 1, "B gone");
+    TEST_ASSERT_EQ(name, select_reply(&g_a, OP_FIXED), 0, "A selects");
+    TEST_ASSERT_EQ(name, read_value(&g_ctx_a, &g_a, OP_FIXED), 0xAA, "A reads");
+    TEST_ASSERT_EQ(name, (int)(stats().waits - s0.waits), 0, "no wait");
+    TEST_ASSERT_EQ(name, (int)(stats().expired - s0.expired), 0, "no expiry");
+
+    TEST_ASSERT(name, crumbs_daemon_write(&g_b, DEV, (const uint8_t *)"\x01", 1u) < 0,
+                "closed client fails");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Daemon tests:\n");
+
+    if (start_daemon() != 0 ||
+        crumbs_daemon_init_controller(&g_ctx_a, &g_a, g_path) != 0 ||
+        crumbs_daemon_init_controller(&g_ctx_b, &g_b, g_path) != 0)
+    {
+        fprintf(stderr, "could not start the daemon\n");
+        stop_daemon();
+        return 1;
+    }
+
+    failures += test_passthrough();
+    failures += test_coalesce();
+    failures += test_conflict();
+    failures += test_disconnect();
+
+    stop_daemon();
+
+    if (failures == 0)
+    {
+        printf("All daemon tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d daemon test(s) failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,370 @@
+/*
+ * Handler table tests run once per CRUMBS_DISPATCH strategy.
+ *
+ * CMake builds this file (together with the core sources) three times with
+ * CRUMBS_DISPATCH set to LINEAR, SORTED and DIRECT. Every build must produce
+ * identical dispatch behaviour.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+static int g_hits[256];
+static void *g_last_user;
+
+static void count_handler(crumbs_context_t *ctx,
+                          uint8_t opcode,
+                          const uint8_t *data,
+                          uint8_t data_len,
+                          void *user_data)
+{
+    (void)ctx;
+    (void)data;
+    (void)data_len;
+    g_hits[opcode]++;
+    g_last_user = user_data;
+}
+
+static uint8_t g_last_offset;
+
+static void offset_handler(crumbs_context_t *ctx,
+                           uint8_t opcode,
+                           const uint8_t *data,
+                           uint8_t data_len,
+                           void *user_data)
+{
+    count_handler(ctx, opcode, data, data_len, user_data);
+    g_last_offset = crumbs_handler_offset(ctx);
+}
+
+static void offset_reply(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)user_data;
+    reply->type_id = 0x33;
+    reply->opcode = ctx->requested_opcode;
+    reply->data_len = 1;
+    reply->data[0] = crumbs_handler_offset(ctx);
+}
+
+static void tag_reply(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    reply->type_id = 0x33;
+    reply->opcode = ctx->requested_opcode;
+    reply->data_len = 1;
+    reply->data[0] = (uint8_t)(uintptr_t)user_data;
+}
+
+static int send_cmd(crumbs_context_t *ctx, uint8_t opcode)
+{
+    crumbs_message_t msg;
+    uint8_t buf[CRUMBS_MESSAGE_MAX_SIZE];
+    test_msg_init(&msg, 0x33, opcode);
+    size_t n = test_encode(&msg, buf);
+    return crumbs_peripheral_handle_receive(ctx, buf, n);
+}
+
+static int request_reply(crumbs_context_t *ctx, uint8_t opcode, crumbs_message_t *out)
+{
+    uint8_t buf[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t n = 0;
+    ctx->requested_opcode = opcode;
+    if (crumbs_peripheral_build_reply(ctx, buf, sizeof(buf), &n) != 0)
+        return -1;
+    if (n == 0)
+        return 1; /* no reply configured */
+    return crumbs_decode_message(buf, n, out, NULL) == 0 ? 0 : -1;
+}
+
+/* Deterministic, non-monotonic opcode order to exercise sorted inserts. */
+static uint8_t scrambled_opcode(unsigned i)
+{
+    return (uint8_t)((i * 97u + 13u) & 0xFFu);
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_fill_and_dispatch(void)
+{
+    const char *name = "fill and dispatch";
+    crumbs_context_t ctx;
+    test_init_peripheral(&ctx);
+    memset(g_hits, 0, sizeof(g_hits));
+
+    for (unsigned i = 0; i < CRUMBS_MAX_HANDLERS; i++)
+    {
+        uint8_t op = scrambled_opcode(i);
+        TEST_ASSERT_EQ(name, crumbs_register_handler(&ctx, op, count_handler,
+                                                     (void *)(uintptr_t)(op + 1u)),
+                       0, "register failed");
+    }
+    TEST_ASSERT_EQ(name, crumbs_register_handler(&ctx, 0xFD, count_handler, NULL), -1,
+                   "full table should reject new opcode");
+
+    for (unsigned op = 0; op < 256; op++)
+    {
+        if (op == CRUMBS_CMD_SET_REPLY)
+            continue;
+        g_last_user = NULL;
+        TEST_ASSERT_EQ(name, send_cmd(&ctx, (uint8_t)op), 0, "handle_receive failed");
+    }
+
+    for (unsigned op = 0; op < 256; op++)
+    {
+        int expected = 0;
+        for (unsigned i = 0; i < CRUMBS_MAX_HANDLERS; i++)
+        {
+            if (scrambled_opcode(i) == op)
+                expected = 1;
+        }
+        if (op == CRUMBS_CMD_SET_REPLY)
+            expected = 0;
+        TEST_ASSERT_EQ(name, g_hits[op], expected, "unexpected hit count");
+    }
+
+    /* User data must follow its opcode */
+    uint8_t probe = scrambled_opcode(3);
+    send_cmd(&ctx, probe);
+    TEST_ASSERT(name, g_last_user == (void *)(uintptr_t)(probe + 1u), "wrong user_data");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_unregister_keeps_others(void)
+{
+    const char *name = "unregister keeps others";
+    crumbs_context_t ctx;
+    test_init_peripheral(&ctx);
+
+    for (unsigned i = 0; i < 8; i++)
+    {
+        uint8_t op = scrambled_opcode(i);
+        crumbs_register_handler(&ctx, op, count_handler, (void *)(uintptr_t)(op + 1u));
+    }
+
+    /* Remove first, middle and last registered entries */
+    crumbs_unregister_handler(&ctx, scrambled_opcode(0));
+    crumbs_unregister_handler(&ctx, scrambled_opcode(4));
+    crumbs_unregister_handler(&ctx, scrambled_opcode(7));
+    TEST_ASSERT_EQ(name, ctx.periph.handler_count, 5, "handler_count after removal");
+
+    memset(g_hits, 0, sizeof(g_hits));
+    for (unsigned i = 0; i < 8; i++)
+    {
+        uint8_t op = scrambled_opcode(i);
+        g_last_user = NULL;
+        send_cmd(&ctx, op);
+        int removed = (i == 0 || i == 4 || i == 7);
+        TEST_ASSERT_EQ(name, g_hits[op], removed ? 0 : 1, "dispatch after removal");
+        if (!removed)
+        {
+            TEST_ASSERT(name, g_last_user == (void *)(uintptr_t)(op + 1u),
+                        "user_data moved with slot");
+        }
+    }
+
+    /* Re-register a removed opcode and overwrite an existing one */
+    crumbs_register_handler(&ctx, scrambled_opcode(4), count_handler, (void *)(uintptr_t)0x55);
+    crumbs_register_handler(&ctx, scrambled_opcode(1), count_handler, (void *)(uintptr_t)0x66);
+    TEST_ASSERT_EQ(name, ctx.periph.handler_count, 6, "handler_count after re-register");
+    send_cmd(&ctx, scrambled_opcode(4));
+    TEST_ASSERT(name, g_last_user == (void *)(uintptr_t)0x55, "re-registered user_data");
+    send_cmd(&ctx, scrambled_opcode(1));
+    TEST_ASSERT(name, g_last_user == (void *)(uintptr_t)0x66, "overwritten user_data");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_reply_table(void)
+{
+    const char *name = "reply table";
+    crumbs_context_t ctx;
+    test_init_peripheral(&ctx);
+
+    for (unsigned i = 0; i < 6; i++)
+    {
+        uint8_t op = scrambled_opcode(i);
+        crumbs_register_reply_handler(&ctx, op, tag_reply, (void *)(uintptr_t)(i + 1u));
+    }
+    crumbs_register_reply_handler(&ctx, scrambled_opcode(2), NULL, NULL);
+
+    for (unsigned i = 0; i < 6; i++)
+    {
+        crumbs_message_t out;
+        int rc = request_reply(&ctx, scrambled_opcode(i), &out);
+        if (i == 2)
+        {
+            TEST_ASSERT_EQ(name, rc, 1, "removed reply handler still answers");
+            continue;
+        }
+        TEST_ASSERT_EQ(name, rc, 0, "reply missing");
+        TEST_ASSERT_EQ(name, out.opcode, scrambled_opcode(i), "reply opcode");
+        TEST_ASSERT_EQ(name, out.data[0], i + 1u, "reply user_data");
+    }
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_reinit_ignores_stale_tables(void)
+{
+    const char *name = "reinit ignores stale tables";
+    crumbs_context_t ctx;
+
+    /* Simulate a context whose memory was never zeroed */
+    memset(&ctx, 0xA5, sizeof(ctx));
+    crumbs_init(&ctx, CRUMBS_ROLE_PERIPHERAL, 0x10);
+
+    memset(g_hits, 0, sizeof(g_hits));
+    for (unsigned op = 0; op < 256; op++)
+    {
+        if (op != CRUMBS_CMD_SET_REPLY)
+            send_cmd(&ctx, (uint8_t)op);
+    }
+    for (unsigned op = 0; op < 256; op++)
+    {
+        TEST_ASSERT_EQ(name, g_hits[op], 0, "stale entry dispatched");
+    }
+
+    crumbs_register_handler(&ctx, 0xA5, count_handler, NULL);
+    send_cmd(&ctx, 0xA5);
+    TEST_ASSERT_EQ(name, g_hits[0xA5], 1, "fresh registration after reinit");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_handler_ranges(void)
+{
+    const char *name = "handler ranges";
+    crumbs_context_t ctx;
+    test_init_peripheral(&ctx);
+    memset(g_hits, 0, sizeof(g_hits));
+
+    TEST_ASSERT_EQ(name, crumbs_register_handler_range(&ctx, 0x40, 0x4B, offset_handler,
+                                                       (void *)(uintptr_t)0x11),
+                   0, "register range");
+    TEST_ASSERT_EQ(name, crumbs_register_handler_range(&ctx, 0x10, 0x13, offset_handler,
+                                                       (void *)(uintptr_t)0x22),
+                   0, "register lower range");
+    TEST_ASSERT_EQ(name, crumbs_register_handler_range(&ctx, 0x4B, 0x50, offset_handler, NULL),
+                   -1, "overlap rejected");
+    TEST_ASSERT_EQ(name, crumbs_register_handler_range(&ctx, 0x60, 0x5F, offset_handler, NULL),
+                   -1, "lo > hi rejected");
+    TEST_ASSERT_EQ(name, crumbs_register_handler_range(&ctx, 0x80, 0x8F, offset_handler, NULL),
+                   -1, "full table");
+
+    /* An exact entry inside a range wins with offset 0. */
+    crumbs_register_handler(&ctx, 0x45, offset_handler, (void *)(uintptr_t)0x33);
+
+    for (unsigned op = 0; op < 256; op++)
+    {
+        if (op == CRUMBS_CMD_SET_REPLY)
+            continue;
+        g_last_user = NULL;
+        g_last_offset = 0xEE;
+        send_cmd(&ctx, (uint8_t)op);
+        if (op == 0x45)
+        {
+            TEST_ASSERT(name, g_last_user == (void *)(uintptr_t)0x33, "exact entry first");
+            TEST_ASSERT_EQ(name, g_last_offset, 0, "exact offset");
+        }
+        else if (op >= 0x40 && op <= 0x4B)
+        {
+            TEST_ASSERT(name, g_last_user == (void *)(uintptr_t)0x11, "upper range user_data");
+            TEST_ASSERT_EQ(name, g_last_offset, op - 0x40u, "upper range offset");
+        }
+        else if (op >= 0x10 && op <= 0x13)
+        {
+            TEST_ASSERT(name, g_last_user == (void *)(uintptr_t)0x22, "lower range user_data");
+            TEST_ASSERT_EQ(name, g_last_offset, op - 0x10u, "lower range offset");
+        }
+        else
+        {
+            TEST_ASSERT_EQ(name, g_hits[op], 0, "outside every range");
+        }
+    }
+
+    /* Same lo..hi replaces, NULL removes; then a wildcard takes the rest. */
+    TEST_ASSERT_EQ(name, crumbs_register_handler_range(&ctx, 0x10, 0x13, offset_handler,
+                                                       (void *)(uintptr_t)0x44),
+                   0, "replace");
+    send_cmd(&ctx, 0x12);
+    TEST_ASSERT(name, g_last_user == (void *)(uintptr_t)0x44, "replaced user_data");
+    TEST_ASSERT_EQ(name, crumbs_register_handler_range(&ctx, 0x10, 0x13, NULL, NULL), 0, "remove");
+    TEST_ASSERT_EQ(name, crumbs_register_handler_range(&ctx, 0x40, 0x4B, NULL, NULL), 0, "remove");
+    TEST_ASSERT_EQ(name, ctx.periph.range_count, 0, "range_count after removal");
+    TEST_ASSERT_EQ(name, crumbs_register_handler_range(&ctx, 0x00, 0xFF, offset_handler, NULL),
+                   0, "wildcard");
+    memset(g_hits, 0, sizeof(g_hits));
+    send_cmd(&ctx, 0x00);
+    send_cmd(&ctx, 0xC7);
+    TEST_ASSERT_EQ(name, g_hits[0xC7], 1, "wildcard dispatch");
+    TEST_ASSERT_EQ(name, g_last_offset, 0xC7, "wildcard offset");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_reply_ranges(void)
+{
+    const char *name = "reply ranges";
+    crumbs_context_t ctx;
+    crumbs_message_t out;
+    test_init_peripheral(&ctx);
+
+    crumbs_register_reply_handler(&ctx, 0x83, tag_reply, (void *)(uintptr_t)0x77);
+    TEST_ASSERT_EQ(name, crumbs_register_reply_handler_range(&ctx, 0x80, 0x8B, offset_reply, NULL),
+                   0, "register");
+
+    TEST_ASSERT_EQ(name, request_reply(&ctx, 0x87, &out), 0, "range reply");
+    TEST_ASSERT_EQ(name, out.opcode, 0x87, "opcode");
+    TEST_ASSERT_EQ(name, out.data[0], 7, "offset");
+    TEST_ASSERT_EQ(name, request_reply(&ctx, 0x83, &out), 0, "exact reply");
+    TEST_ASSERT_EQ(name, out.data[0], 0x77, "exact entry first");
+    TEST_ASSERT_EQ(name, request_reply(&ctx, 0x8C, &out), 1, "outside the range");
+
+    /* A wildcard does not shadow the replies the core answers itself. */
+    TEST_ASSERT_EQ(name, crumbs_register_reply_handler_range(&ctx, 0x80, 0x8B, NULL, NULL), 0,
+                   "remove");
+    TEST_ASSERT_EQ(name, crumbs_register_reply_handler_range(&ctx, 0x00, 0xFF, offset_reply, NULL),
+                   0, "wildcard");
+    TEST_ASSERT_EQ(name, request_reply(&ctx, CRUMBS_CMD_CAPABILITIES, &out), 0, "capabilities");
+    TEST_ASSERT(name, out.data_len > 1, "answered by the core");
+    TEST_ASSERT_EQ(name, request_reply(&ctx, 0x21, &out), 0, "wildcard reply");
+    TEST_ASSERT_EQ(name, out.data[0], 0x21, "wildcard offset");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Dispatch mode tests (CRUMBS_DISPATCH=%d, CRUMBS_MAX_HANDLERS=%d):\n",
+           CRUMBS_DISPATCH, CRUMBS_MAX_HANDLERS);
+
+    failures += test_fill_and_dispatch();
+    failures += test_unregister_keeps_others();
+    failures += test_reply_table();
+    failures += test_reinit_ignores_stale_tables();
+    failures += test_handler_ranges();
+    failures += test_reply_ranges();
+
+    if (failures == 0)
+    {
+        printf("All dispatch mode tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d dispatch mode test(s) failed.\n", failures);
+    return 1;
+}
@@ -313,6 +313,106 @@ static int test_decode_buffer_len_too_short(void)
     return 0;
 }
 
+static int test_decode_view_aliases_buffer(void)
+{
+    crumbs_context_t ctx;
+    crumbs_init(&ctx, CRUMBS_ROLE_CONTROLLER, 0);
+
+    crumbs_message_t m;
+    memset(&m, 0, sizeof(m));
+    m.type_id = 0x21;
+    m.opcode = 0x42;
+    m.data_len = 3;
+    m.data[0] = 0x10;
+    m.data[1] = 0x20;
+    m.data[2] = 0x30;
+
+    uint8_t buf[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t w = crumbs_encode_message(&m, buf, sizeof(buf));
+
+    crumbs_frame_view_t v;
+    if (crumbs_decode_view(buf, w, &v, &ctx) != 0)
+    {
+        fprintf(stderr, "decode_view failed on valid frame\n");
+        return 1;
+    }
+    if (v.type_id != 0x21 || v.opcode != 0x42 || v.data_len != 3 || v.crc8 != buf[w - 1])
+    {
+        fprintf(stderr, "decode_view header mismatch\n");
+        return 1;
+    }
+    if (v.data != &buf[3])
+    {
+        fprintf(stderr, "decode_view data should point into the source buffer\n");
+        return 1;
+    }
+
+    /* Corrupt the CRC: view decode reports -2 and counts the error. */
+    buf[w - 1] ^= 0xFF;
+    if (crumbs_decode_view(buf, w, &v, &ctx) != -2 || crumbs_get_crc_error_count(&ctx) != 1u)
+    {
+        fprintf(stderr, "decode_view CRC failure not reported\n");
+        return 1;
+    }
+
+    if (crumbs_decode_view(buf, 3, &v, &ctx) != -1 || crumbs_decode_view(NULL, w, &v, NULL) != -1)
+    {
+        fprintf(stderr, "decode_view accepted invalid input\n");
+        return 1;
+    }
+
+    printf("  decode view aliases buffer: PASS\n");
+    return 0;
+}
+
+static int test_encode_batch(void)
+{
+    crumbs_message_t msgs[3];
+    uint8_t frames[3][CRUMBS_MESSAGE_MAX_SIZE];
+    size_t lens[3];
+
+    for (size_t i = 0; i < 3; ++i)
+    {
+        memset(&msgs[i], 0, sizeof(msgs[i]));
+        msgs[i].type_id = 0x00;
+        msgs[i].opcode = CRUMBS_CMD_SET_REPLY;
+        msgs[i].data_len = 1;
+        msgs[i].data[0] = (uint8_t)(0x10 + i);
+    }
+
+    if (crumbs_encode_frames(msgs, 3, frames, lens) != 3)
+    {
+        fprintf(stderr, "encode_batch did not encode all messages\n");
+        return 1;
+    }
+    for (size_t i = 0; i < 3; ++i)
+    {
+        crumbs_message_t out;
+        if (lens[i] != 5 || crumbs_decode_message(frames[i], lens[i], &out, NULL) != 0 ||
+            out.data[0] != (uint8_t)(0x10 + i))
+        {
+            fprintf(stderr, "encode_batch frame %zu mismatch\n", i);
+            return 1;
+        }
+    }
+
+    /* An invalid message stops the batch. */
+    msgs[1].data_len = CRUMBS_MAX_PAYLOAD + 1;
+    if (crumbs_encode_frames(msgs, 3, frames, lens) != 1 || lens[1] != 0)
+    {
+        fprintf(stderr, "encode_batch should stop at the invalid message\n");
+        return 1;
+    }
+    if (crumbs_encode_frames(NULL, 3, frames, lens) != 0)
+    {
+        fprintf(stderr, "encode_batch accepted NULL msgs\n");
+        return 1;
+    }
+
+    printf("  encode batch: PASS\n");
+    return 0;
+}
+
 int main(void)
 {
     int failures = 0;
@@ -327,6 +427,8 @@ int main(void)
     failures += test_malformed_data_len_in_frame();
     failures += test_decode_minimum_valid_frame();
     failures += test_decode_buffer_len_too_short();
+    failures += test_decode_view_aliases_buffer();
+    failures += test_encode_batch();
 
     if (failures == 0)
     {
@@ -0,0 +1,422 @@
+/*
+ * Tests for the non-blocking controller request engine.
+ *
+ * A fake bus routes writes and reads to peripheral contexts by address and
+ * logs every transaction, so the tests can check that SET_REPLY writes to
+ * different devices overlap while each device sees write-then-read.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_ops.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define NDEV 12
+#define OP_GET_VALUE 0x81
+#define OP_GET_OTHER 0x82
+#define ENG_TYPE 0x42
+
+typedef struct
+{
+    crumbs_context_t periph[NDEV];
+    char log[256]; /* 'W' / 'R' per transaction */
+    size_t nlog;
+    int fail_read;
+} fake_bus_t;
+
+static fake_bus_t g_bus;
+
+static crumbs_context_t *bus_find(uint8_t addr)
+{
+    for (int i = 0; i < NDEV; i++)
+    {
+        if (g_bus.periph[i].address == addr)
+            return &g_bus.periph[i];
+    }
+    return NULL;
+}
+
+static void bus_log(char c)
+{
+    if (g_bus.nlog + 1 < sizeof(g_bus.log))
+    {
+        g_bus.log[g_bus.nlog++] = c;
+        g_bus.log[g_bus.nlog] = '\0';
+    }
+}
+
+static int bus_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    (void)user_ctx;
+    crumbs_context_t *p = bus_find(addr);
+    if (!p)
+        return 2; /* NACK */
+    bus_log('W');
+    crumbs_peripheral_handle_receive(p, data, len);
+    return 0;
+}
+
+static int bus_read(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len, uint32_t timeout_us)
+{
+    size_t n = 0;
+    (void)user_ctx;
+    (void)timeout_us;
+    crumbs_context_t *p = bus_find(addr);
+    if (!p || g_bus.fail_read)
+        return -1;
+    bus_log('R');
+    crumbs_peripheral_build_reply(p, buffer, len, &n);
+    return (int)n;
+}
+
+/* Replies [address][opcode] so the test can tell devices apart. */
+static void reply_value(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)user_data;
+    crumbs_msg_init(reply, ENG_TYPE, ctx->requested_opcode);
+    crumbs_msg_add_u8(reply, ctx->address);
+    crumbs_msg_add_u8(reply, ctx->requested_opcode);
+}
+
+static crumbs_context_t g_ctrl;
+static crumbs_device_t g_devs[NDEV];
+
+static void setup(void)
+{
+    memset(&g_bus, 0, sizeof(g_bus));
+    test_init_controller(&g_ctrl);
+    for (int i = 0; i < NDEV; i++)
+    {
+        crumbs_init(&g_bus.periph[i], CRUMBS_ROLE_PERIPHERAL, (uint8_t)(0x10 + i));
+        crumbs_register_reply_handler(&g_bus.periph[i], OP_GET_VALUE, reply_value, NULL);
+        crumbs_register_reply_handler(&g_bus.periph[i], OP_GET_OTHER, reply_value, NULL);
+
+        memset(&g_devs[i], 0, sizeof(g_devs[i]));
+        g_devs[i].ctx = &g_ctrl;
+        g_devs[i].addr = (uint8_t)(0x10 + i);
+        g_devs[i].write_fn = bus_write;
+        g_devs[i].read_fn = bus_read;
+    }
+}
+
+static int g_done;
+static int g_last_status;
+static uint8_t g_order[NDEV * 2];
+
+static void on_done(crumbs_request_t *req, int status)
+{
+    g_last_status = status;
+    if (status == 0 && g_done < (int)sizeof(g_order))
+        g_order[g_done] = req->reply.data[0];
+    g_done++;
+}
+
+/* Ops generated from the GET macro, including the async form. */
+typedef struct
+{
+    uint8_t addr;
+} eng_value_t;
+
+static int parse_value(const uint8_t *data, size_t len, eng_value_t *out)
+{
+    return crumbs_msg_read_u8(data, (uint8_t)len, 0, &out->addr);
+}
+CRUMBS_DEFINE_GET_OP(eng, value, ENG_TYPE, OP_GET_VALUE, eng_value_t, parse_value)
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_overlapped_delays(void)
+{
+    const char *name = "12 devices share one delay";
+    crumbs_engine_t eng;
+    crumbs_request_t reqs[NDEV];
+
+    setup();
+    crumbs_engine_init(&eng);
+    g_done = 0;
+    for (int i = 0; i < NDEV; i++)
+    {
+        crumbs_request_init(&reqs[i], &g_devs[i], OP_GET_VALUE, on_done, NULL);
+        TEST_ASSERT_EQ(name, crumbs_engine_submit(&eng, &reqs[i]), 0, "submit");
+    }
+    TEST_ASSERT_EQ(name, crumbs_engine_submit(&eng, &reqs[0]), -1, "double submit rejected");
+    TEST_ASSERT_SIZE_EQ(name, g_bus.nlog, 0, "submit must not touch the bus");
+
+    uint32_t t = 1000u;
+    TEST_ASSERT_EQ(name, crumbs_engine_poll(&eng, t), NDEV, "pending after first poll");
+    TEST_ASSERT_EQ(name, strcmp(g_bus.log, "WWWWWWWWWWWW"), 0, "all SET_REPLYs in one poll");
+    TEST_ASSERT_EQ(name, crumbs_engine_idle_us(&eng, t), CRUMBS_DEFAULT_QUERY_DELAY_US, "idle time");
+
+    TEST_ASSERT_EQ(name, crumbs_engine_poll(&eng, t + CRUMBS_DEFAULT_QUERY_DELAY_US - 1u), NDEV,
+                   "not due yet");
+    TEST_ASSERT_SIZE_EQ(name, g_bus.nlog, NDEV, "no reads before the delay");
+
+    TEST_ASSERT_EQ(name, crumbs_engine_poll(&eng, t + CRUMBS_DEFAULT_QUERY_DELAY_US), 0, "all done");
+    TEST_ASSERT_EQ(name, g_done, NDEV, "callbacks");
+    TEST_ASSERT_EQ(name, g_last_status, 0, "status");
+    for (int i = 0; i < NDEV; i++)
+        TEST_ASSERT_EQ(name, g_order[i], 0x10 + i, "reply order / content");
+    TEST_ASSERT_EQ(name, crumbs_engine_idle_us(&eng, t), UINT32_MAX, "idle when empty");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_same_device_serialized(void)
+{
+    const char *name = "same device requests serialized";
+    crumbs_engine_t eng;
+    crumbs_request_t a, b;
+
+    setup();
+    crumbs_engine_init(&eng);
+    g_done = 0;
+    crumbs_request_init(&a, &g_devs[0], OP_GET_VALUE, on_done, NULL);
+    crumbs_request_init(&b, &g_devs[0], OP_GET_OTHER, on_done, NULL);
+    a.delay_us = 100u;
+    b.delay_us = 100u;
+    crumbs_engine_submit(&eng, &a);
+    crumbs_engine_submit(&eng, &b);
+
+    crumbs_engine_poll(&eng, 0u);
+    TEST_ASSERT_EQ(name, strcmp(g_bus.log, "W"), 0, "second SET_REPLY held back");
+    crumbs_engine_poll(&eng, 100u);
+    TEST_ASSERT_EQ(name, strcmp(g_bus.log, "WRW"), 0, "read then next SET_REPLY");
+    TEST_ASSERT_EQ(name, a.reply.data[1], OP_GET_VALUE, "first reply opcode");
+    TEST_ASSERT_EQ(name, crumbs_engine_poll(&eng, 200u), 0, "done");
+    TEST_ASSERT_EQ(name, b.reply.data[1], OP_GET_OTHER, "second reply opcode");
+    TEST_ASSERT_EQ(name, g_done, 2, "callbacks");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int g_repeats;
+
+static void resubmit(crumbs_request_t *req, int status)
+{
+    (void)status;
+    if (++g_repeats < 3)
+        crumbs_engine_submit((crumbs_engine_t *)req->user_data, req);
+}
+
+static int test_errors_and_resubmit(void)
+{
+    const char *name = "errors and resubmit from callback";
+    crumbs_engine_t eng;
+    crumbs_request_t r;
+    crumbs_device_t missing;
+
+    setup();
+    crumbs_engine_init(&eng);
+
+    /* NACK on the SET_REPLY write completes immediately with the error. */
+    missing = g_devs[0];
+    missing.addr = 0x70;
+    g_done = 0;
+    crumbs_request_init(&r, &missing, OP_GET_VALUE, on_done, NULL);
+    crumbs_engine_submit(&eng, &r);
+    TEST_ASSERT_EQ(name, crumbs_engine_poll(&eng, 0u), 0, "write error completes");
+    TEST_ASSERT_EQ(name, g_last_status, 2, "write error code");
+
+    /* Failed read. */
+    crumbs_request_init(&r, &g_devs[1], OP_GET_VALUE, on_done, NULL);
+    crumbs_engine_submit(&eng, &r);
+    crumbs_engine_poll(&eng, 0u);
+    g_bus.fail_read = 1;
+    crumbs_engine_poll(&eng, CRUMBS_DEFAULT_QUERY_DELAY_US);
+    TEST_ASSERT(name, g_last_status != 0, "read error reported");
+    g_bus.fail_read = 0;
+
+    /* Opcode with no reply handler -> empty reply -> error. */
+    crumbs_request_init(&r, &g_devs[1], 0x90, on_done, NULL);
+    crumbs_engine_submit(&eng, &r);
+    crumbs_engine_poll(&eng, 0u);
+    crumbs_engine_poll(&eng, CRUMBS_DEFAULT_QUERY_DELAY_US);
+    TEST_ASSERT(name, g_last_status != 0, "missing reply reported");
+
+    /* Periodic polling by resubmitting from the callback. */
+    g_repeats = 0;
+    crumbs_request_init(&r, &g_devs[2], OP_GET_VALUE, resubmit, &eng);
+    r.delay_us = 10u;
+    crumbs_engine_submit(&eng, &r);
+    for (uint32_t t = 0; t < 100u; t += 10u)
+        crumbs_engine_poll(&eng, t);
+    TEST_ASSERT_EQ(name, g_repeats, 3, "resubmitted twice");
+    TEST_ASSERT(name, eng.head == NULL && eng.tail == NULL, "queue empty");
+
+    /* Clock wraparound. */
+    g_done = 0;
+    crumbs_request_init(&r, &g_devs[3], OP_GET_VALUE, on_done, NULL);
+    crumbs_engine_submit(&eng, &r);
+    crumbs_engine_poll(&eng, 0xFFFFFF00u);
+    TEST_ASSERT_EQ(name, crumbs_engine_poll(&eng, 0x00000010u), 1, "not due across wrap");
+    TEST_ASSERT_EQ(name, crumbs_engine_poll(&eng, 0xFFFFFF00u + CRUMBS_DEFAULT_QUERY_DELAY_US), 0,
+                   "due across wrap");
+    TEST_ASSERT_EQ(name, g_done, 1, "wrap callback");
+
+    TEST_ASSERT_EQ(name, crumbs_engine_poll(NULL, 0u), -1, "NULL engine");
+    TEST_ASSERT_EQ(name, crumbs_engine_submit(&eng, NULL), -1, "NULL request");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static eng_value_t g_async_value;
+static int g_async_rc;
+
+static void on_value(crumbs_request_t *req, int status)
+{
+    g_async_rc = status ? status : eng_parse_value_reply(&req->reply, &g_async_value);
+}
+
+static int test_ops_async(void)
+{
+    const char *name = "ops macro async form";
+    crumbs_engine_t eng;
+    crumbs_request_t r;
+
+    setup();
+    crumbs_engine_init(&eng);
+    g_async_rc = 99;
+    TEST_ASSERT_EQ(name, eng_request_value(&eng, &r, &g_devs[5], on_value, NULL), 0, "request");
+    crumbs_engine_poll(&eng, 0u);
+    crumbs_engine_poll(&eng, CRUMBS_DEFAULT_QUERY_DELAY_US);
+    TEST_ASSERT_EQ(name, g_async_rc, 0, "parse");
+    TEST_ASSERT_EQ(name, g_async_value.addr, 0x15, "value");
+
+    crumbs_message_t wrong;
+    crumbs_msg_init(&wrong, ENG_TYPE + 1, OP_GET_VALUE);
+    crumbs_msg_add_u8(&wrong, 1);
+    TEST_ASSERT_EQ(name, eng_parse_value_reply(&wrong, &g_async_value), -1, "type mismatch");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static uint8_t g_cmd_value;
+
+static void on_cmd(crumbs_context_t *ctx, uint8_t opcode, const uint8_t *data, uint8_t data_len, void *user_data)
+{
+    (void)ctx;
+    (void)opcode;
+    (void)user_data;
+    if (data_len == 1u)
+        g_cmd_value = data[0];
+}
+
+static int test_priority_lanes(void)
+{
+    const char *name = "control lane preempts telemetry";
+    crumbs_engine_t eng;
+    crumbs_request_t tele[4];
+    crumbs_request_t ctrl_send, ctrl_get;
+    crumbs_message_t cmd;
+
+    setup();
+    crumbs_register_handler(&g_bus.periph[0], 0x05, on_cmd, NULL);
+    g_cmd_value = 0;
+    crumbs_engine_init(&eng);
+    g_done = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        crumbs_request_init(&tele[i], &g_devs[i], OP_GET_VALUE, on_done, NULL);
+        tele[i].delay_us = 1000u;
+        crumbs_engine_submit(&eng, &tele[i]);
+    }
+    crumbs_engine_poll(&eng, 0u);
+    TEST_ASSERT_EQ(name, strcmp(g_bus.log, "WWWW"), 0, "sweep under way");
+
+    /* An urgent command to device 0 and a control GET to device 1. */
+    crumbs_msg_init(&cmd, ENG_TYPE, 0x05);
+    crumbs_msg_add_u8(&cmd, 90);
+    crumbs_request_init_send(&ctrl_send, &g_devs[0], &cmd, on_done, NULL);
+    crumbs_request_init(&ctrl_get, &g_devs[1], OP_GET_OTHER, on_done, NULL);
+    ctrl_get.lane = CRUMBS_LANE_CONTROL;
+    ctrl_get.delay_us = 100u;
+    TEST_ASSERT_EQ(name, ctrl_send.lane, CRUMBS_LANE_CONTROL, "sends default to control");
+    TEST_ASSERT_EQ(name, crumbs_engine_submit(&eng, &ctrl_send), 0, "submit send");
+    TEST_ASSERT_EQ(name, crumbs_engine_submit(&eng, &ctrl_get), 0, "submit control get");
+    TEST_ASSERT(name, eng.head == &ctrl_send && ctrl_send.next == &ctrl_get, "control queued first");
+
+    g_bus.nlog = 0;
+    crumbs_engine_poll(&eng, 10u);
+    TEST_ASSERT_EQ(name, eng.lanes[CRUMBS_LANE_TELEMETRY].postponed, 2, "two GETs postponed");
+    TEST_ASSERT_EQ(name, g_done, 1, "command written at once");
+    TEST_ASSERT_EQ(name, g_last_status, 0, "command status");
+    TEST_ASSERT_EQ(name, g_cmd_value, 90, "peripheral saw the command");
+    TEST_ASSERT_EQ(name, strcmp(g_bus.log, "WWW"), 0, "command, control SET_REPLY, re-issued SET_REPLY");
+
+    TEST_ASSERT_EQ(name, crumbs_engine_poll(&eng, 110u), 4, "control GET read first");
+    TEST_ASSERT_EQ(name, ctrl_get.reply.data[1], OP_GET_OTHER, "control reply");
+    TEST_ASSERT_EQ(name, crumbs_engine_poll(&eng, 1110u), 0, "telemetry done");
+    TEST_ASSERT_EQ(name, g_done, 6, "all callbacks");
+    for (int i = 0; i < 4; i++)
+        TEST_ASSERT_EQ(name, tele[i].reply.data[1], OP_GET_VALUE, "telemetry reply");
+
+    TEST_ASSERT_EQ(name, eng.lanes[CRUMBS_LANE_CONTROL].completed, 2, "control completed");
+    TEST_ASSERT_EQ(name, eng.lanes[CRUMBS_LANE_CONTROL].max_latency_us, 100, "control latency");
+    TEST_ASSERT_EQ(name, eng.lanes[CRUMBS_LANE_TELEMETRY].completed, 4, "telemetry completed");
+    TEST_ASSERT_EQ(name, eng.lanes[CRUMBS_LANE_TELEMETRY].max_latency_us, 1110, "telemetry latency");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_cancel(void)
+{
+    const char *name = "cancel requests and lanes";
+    crumbs_engine_t eng;
+    crumbs_request_t reqs[3];
+
+    setup();
+    crumbs_engine_init(&eng);
+    g_done = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        crumbs_request_init(&reqs[i], &g_devs[i], OP_GET_VALUE, on_done, NULL);
+        crumbs_engine_submit(&eng, &reqs[i]);
+    }
+
+    TEST_ASSERT_EQ(name, crumbs_engine_cancel(&eng, &reqs[1]), 0, "cancel one");
+    TEST_ASSERT_EQ(name, g_last_status, CRUMBS_REQ_CANCELLED, "cancelled status");
+    TEST_ASSERT_EQ(name, crumbs_engine_cancel(&eng, &reqs[1]), -1, "not queued any more");
+
+    TEST_ASSERT_EQ(name, crumbs_engine_cancel_lane(&eng, CRUMBS_LANE_TELEMETRY), 2, "cancel lane");
+    TEST_ASSERT(name, eng.head == NULL && eng.tail == NULL, "queue empty");
+    TEST_ASSERT_EQ(name, g_done, 3, "callbacks");
+    TEST_ASSERT_EQ(name, eng.lanes[CRUMBS_LANE_TELEMETRY].cancelled, 3, "cancel counter");
+    TEST_ASSERT_EQ(name, crumbs_engine_cancel_lane(&eng, CRUMBS_ENGINE_LANES), -1, "bad lane");
+    TEST_ASSERT_EQ(name, crumbs_engine_submit(&eng, &reqs[0]), 0, "resubmit after cancel");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Request engine tests:\n");
+
+    failures += test_overlapped_delays();
+    failures += test_same_device_serialized();
+    failures += test_errors_and_resubmit();
+    failures += test_ops_async();
+    failures += test_priority_lanes();
+    failures += test_cancel();
+
+    if (failures == 0)
+    {
+        printf("All request engine tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d request engine test(s) failed.\n", failures);
+    return 1;
+}
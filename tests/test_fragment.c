@@ -0,0 +1,272 @@
+/*
+ * Tests for fragmented transfers, reassembly and the CAPABILITIES reply.
+ *
+ * Built with CRUMBS_ENABLE_FRAGMENTS=1. A loopback transport connects a
+ * controller device straight to a peripheral context and can drop frames.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+typedef struct
+{
+    crumbs_context_t *peripheral;
+    int writes;
+    int reads;
+    int drop_write; /* 1-based write number to drop, 0 = none */
+} loopback_t;
+
+static int loop_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    loopback_t *lb = (loopback_t *)user_ctx;
+    (void)addr;
+    lb->writes++;
+    if (lb->writes == lb->drop_write)
+        return 0; /* lost on the bus, ACKed anyway */
+    crumbs_peripheral_handle_receive(lb->peripheral, data, len);
+    return 0;
+}
+
+static int loop_read(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len, uint32_t timeout_us)
+{
+    loopback_t *lb = (loopback_t *)user_ctx;
+    size_t n = 0;
+    (void)addr;
+    (void)timeout_us;
+    lb->reads++;
+    if (crumbs_peripheral_build_reply(lb->peripheral, buffer, len, &n) != 0)
+        return -1;
+    return (int)n;
+}
+
+static void no_delay(uint32_t us)
+{
+    (void)us;
+}
+
+static int g_done;
+static uint8_t g_done_opcode;
+static size_t g_done_len;
+
+static void on_done(crumbs_context_t *ctx, uint8_t opcode, const uint8_t *data,
+                    size_t len, void *user_data)
+{
+    (void)ctx;
+    (void)data;
+    (void)user_data;
+    g_done++;
+    g_done_opcode = opcode;
+    g_done_len = len;
+}
+
+static crumbs_context_t g_ctrl;
+static crumbs_context_t g_periph;
+static uint8_t g_rx_buf[600];
+static loopback_t g_lb;
+
+static void setup(crumbs_device_t *dev)
+{
+    test_init_controller(&g_ctrl);
+    test_init_peripheral(&g_periph);
+    crumbs_set_fragment_buffer(&g_periph, g_rx_buf, sizeof(g_rx_buf), on_done, NULL);
+    memset(g_rx_buf, 0, sizeof(g_rx_buf));
+    memset(&g_lb, 0, sizeof(g_lb));
+    g_lb.peripheral = &g_periph;
+    g_done = 0;
+
+    memset(dev, 0, sizeof(*dev));
+    dev->ctx = &g_ctrl;
+    dev->addr = 0x10;
+    dev->write_fn = loop_write;
+    dev->read_fn = loop_read;
+    dev->delay_fn = no_delay;
+    dev->io = &g_lb;
+}
+
+static void fill_pattern(uint8_t *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+        buf[i] = (uint8_t)(i * 7u + (i >> 8));
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_blind_512(void)
+{
+    const char *name = "512 bytes without round trips";
+    crumbs_device_t dev;
+    uint8_t src[512];
+
+    setup(&dev);
+    fill_pattern(src, sizeof(src));
+
+    TEST_ASSERT_EQ(name, crumbs_controller_send_fragmented(&dev, 0x42, 0x30, src, sizeof(src), 0), 0,
+                   "send");
+    TEST_ASSERT_EQ(name, g_lb.writes, 22, "fragment count");
+    TEST_ASSERT_EQ(name, g_lb.reads, 0, "no reads expected");
+    TEST_ASSERT_EQ(name, g_done, 1, "completion callback");
+    TEST_ASSERT_EQ(name, g_done_opcode, 0x30, "target opcode");
+    TEST_ASSERT_SIZE_EQ(name, g_done_len, sizeof(src), "length");
+    TEST_ASSERT_EQ(name, memcmp(g_rx_buf, src, sizeof(src)), 0, "payload");
+
+    crumbs_fragment_status_t st;
+    TEST_ASSERT_EQ(name, crumbs_controller_get_fragment_status(&dev, &st), 0, "status");
+    TEST_ASSERT_EQ(name, st.state, CRUMBS_FRAG_COMPLETE, "state");
+    TEST_ASSERT_EQ(name, st.next_index, 22, "next_index");
+    TEST_ASSERT_EQ(name, st.received, 512, "received");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_windowed_resume(void)
+{
+    const char *name = "windowed send resumes after a drop";
+    crumbs_device_t dev;
+    uint8_t src[300];
+
+    setup(&dev);
+    fill_pattern(src, sizeof(src));
+
+    /*
+     * 13 fragments, window 4. Writes are counted with the status queries:
+     * write 4 is index 3 (last of the first window), so the peripheral just
+     * reports next_index 3 and the controller resends from there.
+     */
+    g_lb.drop_write = 4;
+    TEST_ASSERT_EQ(name, crumbs_controller_send_fragmented(&dev, 0x42, 0x31, src, sizeof(src), 4), 0,
+                   "send");
+    TEST_ASSERT_EQ(name, g_done, 1, "completion callback");
+    TEST_ASSERT_SIZE_EQ(name, g_done_len, sizeof(src), "length");
+    TEST_ASSERT_EQ(name, memcmp(g_rx_buf, src, sizeof(src)), 0, "payload");
+    TEST_ASSERT_EQ(name, g_periph.frag_errors, 0, "resume is not an error");
+
+    /* Write 6 is index 4: index 5 then leaves a gap, the transfer aborts
+     * and the controller restarts it from index 0. */
+    setup(&dev);
+    g_lb.drop_write = 6;
+    TEST_ASSERT_EQ(name, crumbs_controller_send_fragmented(&dev, 0x42, 0x31, src, sizeof(src), 4), 0,
+                   "send after gap");
+    TEST_ASSERT_EQ(name, g_done, 1, "completion callback after restart");
+    TEST_ASSERT_EQ(name, memcmp(g_rx_buf, src, sizeof(src)), 0, "payload after restart");
+    TEST_ASSERT_EQ(name, g_periph.frag_errors, 1, "gap counted once");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_reassembly_rules(void)
+{
+    const char *name = "reassembly rules";
+    uint8_t buf[CRUMBS_MESSAGE_MAX_SIZE];
+    crumbs_message_t m;
+    crumbs_device_t dev;
+
+    setup(&dev);
+
+    /* Non-final fragment with a short chunk aborts. */
+    test_msg_init(&m, 0, CRUMBS_CMD_FRAGMENT);
+    m.data_len = 3 + 5;
+    m.data[0] = 0x40;
+    m.data[1] = 0;
+    m.data[2] = 2;
+    TEST_ASSERT_EQ(name, crumbs_peripheral_handle_receive(&g_periph, buf, test_encode(&m, buf)), 0,
+                   "receive");
+    TEST_ASSERT_EQ(name, g_periph.frag_state, CRUMBS_FRAG_ERROR, "short chunk aborts");
+
+    /* A transfer of one (final) fragment completes immediately. */
+    m.data[2] = 1;
+    crumbs_peripheral_handle_receive(&g_periph, buf, test_encode(&m, buf));
+    TEST_ASSERT_EQ(name, g_periph.frag_state, CRUMBS_FRAG_COMPLETE, "single fragment");
+    TEST_ASSERT_EQ(name, g_done, 1, "callback");
+
+    /* Overflow past the buffer aborts. */
+    crumbs_set_fragment_buffer(&g_periph, g_rx_buf, 30, on_done, NULL);
+    uint8_t big[60];
+    fill_pattern(big, sizeof(big));
+    crumbs_controller_send_fragmented(&dev, 0, 0x41, big, sizeof(big), 0);
+    TEST_ASSERT_EQ(name, g_periph.frag_state, CRUMBS_FRAG_ERROR, "overflow aborts");
+    TEST_ASSERT_EQ(name, g_done, 1, "no callback on overflow");
+
+    /* Without a buffer, FRAGMENT reaches user handlers like any opcode. */
+    crumbs_set_fragment_buffer(&g_periph, NULL, 0, NULL, NULL);
+    g_lb.writes = 0;
+    crumbs_controller_send_fragmented(&dev, 0, 0x41, big, 10, 0);
+    TEST_ASSERT_EQ(name, g_periph.frag_state, CRUMBS_FRAG_IDLE, "not intercepted");
+
+    /* Bad args */
+    TEST_ASSERT_EQ(name, crumbs_controller_send_fragmented(&dev, 0, 0x41, NULL, 4, 0), -1, "NULL data");
+    TEST_ASSERT_EQ(name, crumbs_controller_send_fragmented(&dev, 0, 0x41, big,
+                                                           CRUMBS_FRAGMENT_MAX_TRANSFER + 1u, 0),
+                   -1, "oversize");
+    TEST_ASSERT_EQ(name, crumbs_set_fragment_buffer(NULL, g_rx_buf, 1, NULL, NULL), -1, "NULL ctx");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_verification_fails(void)
+{
+    const char *name = "verification gives up without a peripheral buffer";
+    crumbs_device_t dev;
+    uint8_t src[100];
+
+    setup(&dev);
+    fill_pattern(src, sizeof(src));
+    crumbs_set_fragment_buffer(&g_periph, NULL, 0, NULL, NULL);
+
+    /* No status reply is configured, so every status read fails. */
+    TEST_ASSERT(name, crumbs_controller_send_fragmented(&dev, 0, 0x50, src, sizeof(src), 2) != 0,
+                "send should fail");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_capabilities(void)
+{
+    const char *name = "capabilities reply";
+    crumbs_device_t dev;
+    crumbs_capabilities_t caps;
+
+    setup(&dev);
+    TEST_ASSERT_EQ(name, crumbs_controller_get_capabilities(&dev, &caps), 0, "query");
+    TEST_ASSERT_EQ(name, caps.flags & CRUMBS_CAP_FRAGMENTS, CRUMBS_CAP_FRAGMENTS, "fragments bit");
+    TEST_ASSERT_EQ(name, caps.frag_capacity, sizeof(g_rx_buf), "capacity");
+
+    crumbs_set_fragment_buffer(&g_periph, NULL, 0, NULL, NULL);
+    TEST_ASSERT_EQ(name, crumbs_controller_get_capabilities(&dev, &caps), 0, "query");
+    TEST_ASSERT_EQ(name, caps.flags & CRUMBS_CAP_FRAGMENTS, 0u, "no fragments bit");
+    TEST_ASSERT_EQ(name, caps.frag_capacity, 0, "no capacity");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Fragmented transfer tests:\n");
+
+    failures += test_blind_512();
+    failures += test_windowed_resume();
+    failures += test_reassembly_rules();
+    failures += test_verification_fails();
+    failures += test_capabilities();
+
+    if (failures == 0)
+    {
+        printf("All fragmented transfer tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d fragmented transfer test(s) failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,276 @@
+/*
+ * Tests for the in-place frame builder and the ops macros built on it.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_ops.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+typedef struct
+{
+    uint8_t addr;
+    uint8_t data[64];
+    size_t len;
+    int calls;
+} capture_io_t;
+
+static int capture_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    capture_io_t *io = (capture_io_t *)user_ctx;
+    io->addr = addr;
+    io->len = len;
+    memcpy(io->data, data, len);
+    io->calls++;
+    return 0;
+}
+
+static int compare_frames(const crumbs_message_t *msg, crumbs_frame_builder_t *fb)
+{
+    uint8_t ref[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t ref_len = crumbs_encode_message(msg, ref, sizeof(ref));
+    size_t fb_len = crumbs_fb_finish(fb);
+    if (ref_len == 0u || ref_len != fb_len)
+        return -1;
+    return memcmp(ref, fb->frame, ref_len) == 0 ? 0 : -1;
+}
+
+/* Ops generated from the macros, as a family header would. */
+#define FB_TYPE 0x42
+#define FB_OP_SET 0x07
+#define FB_OP_RESET 0x08
+#define FB_OP_GET 0x81
+
+CRUMBS_DEFINE_SEND_OP_FB(fbt, set_value, FB_TYPE, FB_OP_SET,
+                         uint16_t value, crumbs_fb_add_u16(&_fb, value))
+CRUMBS_DEFINE_SEND_OP(fbt, set_value_msg, FB_TYPE, FB_OP_SET,
+                      uint16_t value, crumbs_msg_add_u16(&_m, value))
+CRUMBS_DEFINE_SEND_OP_0(fbt, reset, FB_TYPE, FB_OP_RESET)
+
+static int parse_u8(const uint8_t *data, size_t len, uint8_t *out)
+{
+    return crumbs_msg_read_u8(data, (uint8_t)len, 0, out);
+}
+CRUMBS_DEFINE_GET_OP(fbt, value, FB_TYPE, FB_OP_GET, uint8_t, parse_u8)
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_matches_encoder_all_lengths(void)
+{
+    const char *name = "matches encoder for every length";
+
+    for (unsigned n = 0; n <= CRUMBS_MAX_PAYLOAD; n++)
+    {
+        crumbs_message_t msg;
+        crumbs_frame_builder_t fb;
+        crumbs_msg_init(&msg, 0xA0, (uint8_t)(0x10 + n));
+        crumbs_fb_init(&fb, 0xA0, (uint8_t)(0x10 + n));
+        for (unsigned i = 0; i < n; i++)
+        {
+            uint8_t b = (uint8_t)(i * 37u + n * 11u + 1u);
+            crumbs_msg_add_u8(&msg, b);
+            TEST_ASSERT_EQ(name, crumbs_fb_add_u8(&fb, b), 0, "add_u8 failed");
+        }
+        TEST_ASSERT_EQ(name, compare_frames(&msg, &fb), 0, "frame differs from encoder");
+
+        /* The finished frame must also decode cleanly */
+        crumbs_message_t out;
+        TEST_ASSERT_EQ(name, crumbs_decode_message(fb.frame, 4u + n, &out, NULL), 0,
+                       "decode of built frame failed");
+    }
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_typed_adds(void)
+{
+    const char *name = "typed adds match msg helpers";
+    crumbs_message_t msg;
+    crumbs_frame_builder_t fb;
+    const uint8_t raw[3] = {0xDE, 0xAD, 0x01};
+
+    crumbs_msg_init(&msg, 0x05, 0x06);
+    crumbs_fb_init(&fb, 0x05, 0x06);
+
+    crumbs_msg_add_u8(&msg, 0x12);
+    crumbs_msg_add_u16(&msg, 0x3456);
+    crumbs_msg_add_u32(&msg, 0x789ABCDEu);
+    crumbs_msg_add_i8(&msg, -3);
+    crumbs_msg_add_i16(&msg, -1234);
+    crumbs_msg_add_i32(&msg, -123456);
+    crumbs_msg_add_float(&msg, 3.25f);
+    crumbs_msg_add_bytes(&msg, raw, sizeof(raw));
+
+    crumbs_fb_add_u8(&fb, 0x12);
+    crumbs_fb_add_u16(&fb, 0x3456);
+    crumbs_fb_add_u32(&fb, 0x789ABCDEu);
+    crumbs_fb_add_i8(&fb, -3);
+    crumbs_fb_add_i16(&fb, -1234);
+    crumbs_fb_add_i32(&fb, -123456);
+    crumbs_fb_add_float(&fb, 3.25f);
+    crumbs_fb_add_bytes(&fb, raw, sizeof(raw));
+
+    TEST_ASSERT_EQ(name, fb.data_len, msg.data_len, "data_len");
+    TEST_ASSERT_EQ(name, compare_frames(&msg, &fb), 0, "frame differs from encoder");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_overflow_rejected(void)
+{
+    const char *name = "overflow rejected";
+    crumbs_frame_builder_t fb;
+    uint8_t fill[CRUMBS_MAX_PAYLOAD];
+    memset(fill, 0x5A, sizeof(fill));
+
+    crumbs_fb_init(&fb, 1, 2);
+    TEST_ASSERT_EQ(name, crumbs_fb_add_bytes(&fb, fill, 25), 0, "fill failed");
+    TEST_ASSERT_EQ(name, crumbs_fb_add_u32(&fb, 1u), -1, "u32 should overflow");
+    TEST_ASSERT_EQ(name, crumbs_fb_add_u16(&fb, 1u), 0, "u16 should fit exactly");
+    TEST_ASSERT_EQ(name, crumbs_fb_add_u8(&fb, 1u), -1, "u8 should overflow");
+    TEST_ASSERT_EQ(name, fb.data_len, CRUMBS_MAX_PAYLOAD, "data_len after overflow");
+
+    /* Rejected appends must not disturb the CRC */
+    crumbs_message_t out;
+    size_t n = crumbs_fb_finish(&fb);
+    TEST_ASSERT_SIZE_EQ(name, n, CRUMBS_MESSAGE_MAX_SIZE, "finish length");
+    TEST_ASSERT_EQ(name, crumbs_decode_message(fb.frame, n, &out, NULL), 0, "decode failed");
+
+    TEST_ASSERT_SIZE_EQ(name, crumbs_fb_finish(NULL), 0, "NULL finish");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_append_after_finish(void)
+{
+    const char *name = "append after finish";
+    crumbs_frame_builder_t fb;
+    crumbs_message_t msg;
+
+    crumbs_fb_init(&fb, 9, 9);
+    crumbs_fb_add_u8(&fb, 1);
+    crumbs_fb_finish(&fb);
+    crumbs_fb_add_u8(&fb, 2);
+
+    crumbs_msg_init(&msg, 9, 9);
+    crumbs_msg_add_u8(&msg, 1);
+    crumbs_msg_add_u8(&msg, 2);
+    TEST_ASSERT_EQ(name, compare_frames(&msg, &fb), 0, "refinished frame differs");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_send_frame(void)
+{
+    const char *name = "controller_send_frame";
+    crumbs_context_t ctx;
+    crumbs_frame_builder_t fb;
+    capture_io_t io;
+    memset(&io, 0, sizeof(io));
+
+    crumbs_fb_init(&fb, 0x11, 0x22);
+    crumbs_fb_add_u16(&fb, 0xBEEF);
+
+    test_init_peripheral(&ctx);
+    TEST_ASSERT_EQ(name, crumbs_controller_send_frame(&ctx, 0x20, &fb, capture_write, &io), -2,
+                   "peripheral role should be rejected");
+    TEST_ASSERT_EQ(name, io.calls, 0, "write on wrong role");
+
+    test_init_controller(&ctx);
+    TEST_ASSERT_EQ(name, crumbs_controller_send_frame(NULL, 0x20, &fb, capture_write, &io), -1,
+                   "NULL ctx");
+    TEST_ASSERT_EQ(name, crumbs_controller_send_frame(&ctx, 0x20, NULL, capture_write, &io), -1,
+                   "NULL builder");
+    TEST_ASSERT_EQ(name, crumbs_controller_send_frame(&ctx, 0x20, &fb, NULL, &io), -1,
+                   "NULL write_fn");
+
+    TEST_ASSERT_EQ(name, crumbs_controller_send_frame(&ctx, 0x20, &fb, capture_write, &io), 0,
+                   "send failed");
+    TEST_ASSERT_EQ(name, io.addr, 0x20, "address");
+    TEST_ASSERT_SIZE_EQ(name, io.len, 6, "frame length");
+
+    crumbs_message_t out;
+    TEST_ASSERT_EQ(name, crumbs_decode_message(io.data, io.len, &out, NULL), 0, "decode");
+    TEST_ASSERT_EQ(name, out.type_id, 0x11, "type_id");
+    TEST_ASSERT_EQ(name, out.opcode, 0x22, "opcode");
+    TEST_ASSERT_EQ(name, out.data[0] | (out.data[1] << 8), 0xBEEF, "payload");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_ops_macros(void)
+{
+    const char *name = "ops macros";
+    crumbs_context_t ctx;
+    capture_io_t io_fb, io_msg;
+    crumbs_device_t dev;
+
+    test_init_controller(&ctx);
+    memset(&dev, 0, sizeof(dev));
+    dev.ctx = &ctx;
+    dev.addr = 0x30;
+    dev.write_fn = capture_write;
+
+    /* SEND_OP_FB must put the same bytes on the wire as SEND_OP */
+    memset(&io_fb, 0, sizeof(io_fb));
+    memset(&io_msg, 0, sizeof(io_msg));
+    dev.io = &io_fb;
+    TEST_ASSERT_EQ(name, fbt_send_set_value(&dev, 0x1234), 0, "SEND_OP_FB failed");
+    dev.io = &io_msg;
+    TEST_ASSERT_EQ(name, fbt_send_set_value_msg(&dev, 0x1234), 0, "SEND_OP failed");
+    TEST_ASSERT_SIZE_EQ(name, io_fb.len, io_msg.len, "length mismatch");
+    TEST_ASSERT_EQ(name, memcmp(io_fb.data, io_msg.data, io_fb.len), 0, "bytes mismatch");
+
+    /* SEND_OP_0: empty payload */
+    memset(&io_fb, 0, sizeof(io_fb));
+    dev.io = &io_fb;
+    TEST_ASSERT_EQ(name, fbt_send_reset(&dev), 0, "SEND_OP_0 failed");
+    TEST_ASSERT_SIZE_EQ(name, io_fb.len, 4, "SEND_OP_0 length");
+    TEST_ASSERT_EQ(name, io_fb.data[1], FB_OP_RESET, "SEND_OP_0 opcode");
+
+    /* GET_OP query: SET_REPLY carrying the target opcode */
+    crumbs_message_t out;
+    memset(&io_fb, 0, sizeof(io_fb));
+    TEST_ASSERT_EQ(name, fbt_query_value(&dev), 0, "query failed");
+    TEST_ASSERT_EQ(name, crumbs_decode_message(io_fb.data, io_fb.len, &out, NULL), 0,
+                   "query decode");
+    TEST_ASSERT_EQ(name, out.opcode, CRUMBS_CMD_SET_REPLY, "query opcode");
+    TEST_ASSERT_EQ(name, out.data_len, 1, "query data_len");
+    TEST_ASSERT_EQ(name, out.data[0], FB_OP_GET, "query target");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Frame builder tests:\n");
+
+    failures += test_matches_encoder_all_lengths();
+    failures += test_typed_adds();
+    failures += test_overflow_rejected();
+    failures += test_append_after_finish();
+    failures += test_send_frame();
+    failures += test_ops_macros();
+
+    if (failures == 0)
+    {
+        printf("All frame builder tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d frame builder test(s) failed.\n", failures);
+    return 1;
+}
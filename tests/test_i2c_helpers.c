@@ -123,7 +123,13 @@ static int test_dev_write_and_read(void)
 
     crumbs_context_t ctx;
     test_init_controller(&ctx);
-    crumbs_device_t dev = {&ctx, 0x20, helper_write, helper_read, NULL, &io};
+    crumbs_device_t dev;
+    memset(&dev, 0xA5, sizeof(dev));
+    TEST_ASSERT_EQ(t, crumbs_device_bind(&dev, &ctx, 0x20, helper_write, helper_read, NULL, &io),
+                   0, "bind failed");
+    TEST_ASSERT(t, dev.latency == NULL && dev.transport == NULL, "optional fields not zeroed");
+    TEST_ASSERT_EQ(t, crumbs_device_bind(&dev, NULL, 0x20, helper_write, helper_read, NULL, &io),
+                   -1, "NULL ctx accepted");
 
     uint8_t tx[2] = {0xAA, 0xBB};
     int rc = crumbs_i2c_dev_write(&dev, tx, sizeof(tx));
@@ -151,7 +157,8 @@ static int test_write_then_read_fallback_and_repeated_requirements(void)
 
     crumbs_context_t ctx;
     test_init_controller(&ctx);
-    crumbs_device_t dev = {&ctx, 0x21, helper_write, helper_read, NULL, &io};
+    crumbs_device_t dev;
+    crumbs_device_bind(&dev, &ctx, 0x21, helper_write, helper_read, NULL, &io);
 
     uint8_t tx[1] = {0xA0};
     uint8_t rx[2] = {0};
@@ -180,7 +187,8 @@ static int test_write_then_read_combined(void)
 
     crumbs_context_t ctx;
     test_init_controller(&ctx);
-    crumbs_device_t dev = {&ctx, 0x22, helper_write, helper_read, NULL, &io};
+    crumbs_device_t dev;
+    crumbs_device_bind(&dev, &ctx, 0x22, helper_write, helper_read, NULL, &io);
 
     uint8_t tx[2] = {0x0A, 0x0B};
     uint8_t rx[2] = {0};
@@ -212,7 +220,8 @@ static int test_reg_helpers(void)
 
     crumbs_context_t ctx;
     test_init_controller(&ctx);
-    crumbs_device_t dev = {&ctx, 0x23, helper_write, helper_read, NULL, &io};
+    crumbs_device_t dev;
+    crumbs_device_bind(&dev, &ctx, 0x23, helper_write, helper_read, NULL, &io);
 
     uint8_t out[2] = {0};
     int rc = crumbs_i2c_dev_read_reg_u8(&dev, 0x12, out, sizeof(out),
@@ -0,0 +1,231 @@
+/*
+ * Tests for the per-(address, opcode) reply-delay estimator and its use by
+ * the ops GET helpers and the request engine.
+ *
+ * A simulated peripheral only has its reply ready once a fixed latency has
+ * passed since the SET_REPLY write; earlier reads return an empty frame.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_ops.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define SIM_TYPE 0x33
+#define SIM_OP_GET 0x90
+
+typedef struct
+{
+    uint32_t now_us;
+    uint32_t written_at;
+    uint32_t latency_us;
+    int reads;
+    int good_reads;
+} sim_t;
+
+static sim_t g_sim;
+
+static int sim_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    (void)user_ctx;
+    (void)addr;
+    (void)data;
+    (void)len;
+    g_sim.written_at = g_sim.now_us;
+    return 0;
+}
+
+static int sim_read(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len, uint32_t timeout_us)
+{
+    crumbs_message_t m;
+    (void)user_ctx;
+    (void)addr;
+    (void)timeout_us;
+    g_sim.reads++;
+    if (g_sim.now_us - g_sim.written_at < g_sim.latency_us)
+        return 0; /* not staged yet */
+    g_sim.good_reads++;
+    crumbs_msg_init(&m, SIM_TYPE, SIM_OP_GET);
+    crumbs_msg_add_u8(&m, 0x5A);
+    return (int)crumbs_encode_message(&m, buffer, len);
+}
+
+static void sim_delay(uint32_t us)
+{
+    g_sim.now_us += us;
+}
+
+static int parse_u8(const uint8_t *data, size_t len, uint8_t *out)
+{
+    return crumbs_msg_read_u8(data, (uint8_t)len, 0, out);
+}
+CRUMBS_DEFINE_GET_OP(sim, value, SIM_TYPE, SIM_OP_GET, uint8_t, parse_u8)
+
+static crumbs_context_t g_ctrl;
+
+static void setup(crumbs_device_t *dev, crumbs_latency_t *lat, uint32_t latency_us)
+{
+    memset(&g_sim, 0, sizeof(g_sim));
+    g_sim.latency_us = latency_us;
+    test_init_controller(&g_ctrl);
+    memset(dev, 0, sizeof(*dev));
+    dev->ctx = &g_ctrl;
+    dev->addr = 0x20;
+    dev->write_fn = sim_write;
+    dev->read_fn = sim_read;
+    dev->delay_fn = sim_delay;
+    dev->latency = lat;
+    if (lat)
+        crumbs_latency_init(lat, 0u, 0u);
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_table_basics(void)
+{
+    const char *name = "table basics";
+    crumbs_latency_t lat;
+    crumbs_device_t dev;
+
+    crumbs_latency_init(&lat, 500u, 4000u);
+    TEST_ASSERT_EQ(name, crumbs_latency_estimate(&lat, 1, 2), 4000u, "unknown pair uses ceiling");
+
+    for (int i = 0; i < 2000; i++)
+        crumbs_latency_report(&lat, 1, 2, crumbs_latency_estimate(&lat, 1, 2), 1);
+    TEST_ASSERT_EQ(name, crumbs_latency_estimate(&lat, 1, 2), 500u, "floor");
+
+    for (int i = 0; i < 50; i++)
+        crumbs_latency_report(&lat, 1, 2, crumbs_latency_estimate(&lat, 1, 2), 0);
+    TEST_ASSERT_EQ(name, crumbs_latency_estimate(&lat, 1, 2), 4000u, "ceiling");
+    TEST_ASSERT_EQ(name, crumbs_latency_estimate(&lat, 1, 3), 4000u, "pairs are independent");
+
+    /* Filling the table replaces the oldest pair. */
+    for (int i = 0; i < CRUMBS_LATENCY_ENTRIES; i++)
+        crumbs_latency_report(&lat, (uint8_t)(0x40 + i), 2, 1000u, 1);
+    TEST_ASSERT_EQ(name, lat.count, CRUMBS_LATENCY_ENTRIES, "table full");
+    TEST_ASSERT(name, crumbs_latency_estimate(&lat, 0x40, 2) < 4000u, "newer pair kept");
+
+    /* No estimator: fixed default delay, reports ignored. */
+    memset(&dev, 0, sizeof(dev));
+    TEST_ASSERT_EQ(name, crumbs_device_query_delay(&dev, 2), CRUMBS_DEFAULT_QUERY_DELAY_US, "default");
+    crumbs_device_query_result(&dev, 2, 100u, 1);
+    TEST_ASSERT_EQ(name, crumbs_device_query_delay(NULL, 2), CRUMBS_DEFAULT_QUERY_DELAY_US, "NULL dev");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_get_op_converges(void)
+{
+    const char *name = "GET helper learns a fast device";
+    crumbs_latency_t lat;
+    crumbs_device_t dev;
+    uint8_t v;
+
+    setup(&dev, &lat, 800u);
+    for (int i = 0; i < 400; i++)
+        (void)sim_get_value(&dev, &v);
+
+    uint32_t est = crumbs_latency_estimate(&lat, dev.addr, SIM_OP_GET);
+    TEST_ASSERT(name, est >= 800u / 2u && est <= 2000u, "estimate near the real latency");
+
+    /* Measure the settled behaviour. */
+    g_sim.reads = 0;
+    g_sim.good_reads = 0;
+    uint32_t start = g_sim.now_us;
+    for (int i = 0; i < 200; i++)
+        (void)sim_get_value(&dev, &v);
+    uint32_t per_get = (g_sim.now_us - start) / 200u;
+    TEST_ASSERT(name, g_sim.good_reads * 100 >= g_sim.reads * 70, "most reads succeed");
+    TEST_ASSERT(name, per_get * 4u < CRUMBS_DEFAULT_QUERY_DELAY_US, "well under the fixed delay");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_slow_device_stays_safe(void)
+{
+    const char *name = "slow device keeps a long delay";
+    crumbs_latency_t lat;
+    crumbs_device_t dev;
+    uint8_t v;
+    int ok = 0;
+
+    setup(&dev, &lat, 7000u);
+    for (int i = 0; i < 400; i++)
+        ok += (sim_get_value(&dev, &v) == 0);
+
+    uint32_t est = crumbs_latency_estimate(&lat, dev.addr, SIM_OP_GET);
+    TEST_ASSERT(name, est >= 7000u * 9u / 10u, "estimate stays near 7 ms");
+    TEST_ASSERT(name, ok >= 280, "most GETs succeed");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int g_engine_waits;
+
+static void count_done(crumbs_request_t *req, int status)
+{
+    (void)status;
+    g_engine_waits += (int)req->wait_us;
+}
+
+static int test_engine_uses_estimate(void)
+{
+    const char *name = "engine uses the learned delay";
+    crumbs_latency_t lat;
+    crumbs_device_t dev;
+    crumbs_engine_t eng;
+    crumbs_request_t req;
+
+    setup(&dev, &lat, 300u);
+    crumbs_engine_init(&eng);
+    for (int i = 0; i < 300; i++)
+    {
+        g_engine_waits = 0;
+        crumbs_request_init(&req, &dev, SIM_OP_GET, count_done, NULL);
+        crumbs_engine_submit(&eng, &req);
+        crumbs_engine_poll(&eng, g_sim.now_us);
+        g_sim.now_us += req.wait_us;
+        crumbs_engine_poll(&eng, g_sim.now_us);
+    }
+    TEST_ASSERT(name, crumbs_latency_estimate(&lat, dev.addr, SIM_OP_GET) < 2000u, "engine fed the estimator");
+    TEST_ASSERT(name, (uint32_t)g_engine_waits < 2000u, "engine waited the estimate");
+
+    /* An explicit delay_us bypasses the estimator. */
+    crumbs_request_init(&req, &dev, SIM_OP_GET, count_done, NULL);
+    req.delay_us = 5000u;
+    crumbs_engine_submit(&eng, &req);
+    crumbs_engine_poll(&eng, 0u);
+    TEST_ASSERT_EQ(name, req.wait_us, 5000u, "explicit delay");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Latency estimator tests:\n");
+
+    failures += test_table_basics();
+    failures += test_get_op_converges();
+    failures += test_slow_device_stays_safe();
+    failures += test_engine_uses_estimate();
+
+    if (failures == 0)
+    {
+        printf("All latency estimator tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d latency estimator test(s) failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,148 @@
+/*
+ * Tests for the timerfd event-loop adapter: the fd becomes readable only
+ * when the engine has work, requests complete through poll() +
+ * crumbs_linux_loop_dispatch() without sleeping, and an idle loop leaves
+ * the fd quiet.
+ *
+ * Simulated peripherals have their reply ready 2 ms after SET_REPLY; an
+ * early read returns an empty frame.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <poll.h>
+
+#include "crumbs.h"
+#include "crumbs_linux_loop.h"
+#include "crumbs_message_helpers.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define N_DEVS 3
+#define REPLY_US 2000u
+#define OP_GET 0x42
+
+static uint32_t g_written_at[128];
+static int g_early_reads;
+
+static int sim_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    (void)user_ctx;
+    (void)data;
+    (void)len;
+    g_written_at[addr & 0x7Fu] = crumbs_linux_loop_now_us();
+    return 0;
+}
+
+static int sim_read(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len, uint32_t timeout_us)
+{
+    crumbs_message_t m;
+    (void)user_ctx;
+    (void)timeout_us;
+    if (crumbs_linux_loop_now_us() - g_written_at[addr & 0x7Fu] < REPLY_US)
+    {
+        g_early_reads++;
+        return 0;
+    }
+    crumbs_msg_init(&m, 0x01, OP_GET);
+    crumbs_msg_add_u8(&m, addr);
+    return (int)crumbs_encode_message(&m, buffer, len);
+}
+
+static int g_done;
+static int g_status[N_DEVS];
+
+static void on_done(crumbs_request_t *req, int status)
+{
+    g_status[(int)(intptr_t)req->user_data] = status;
+    g_done++;
+}
+
+static int fd_readable(int fd, int timeout_ms)
+{
+    struct pollfd p = {fd, POLLIN, 0};
+    return poll(&p, 1, timeout_ms) == 1;
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_requests_complete(void)
+{
+    const char *name = "requests complete from the event loop";
+    crumbs_context_t ctx;
+    crumbs_engine_t eng;
+    crumbs_linux_loop_t loop;
+    crumbs_device_t devs[N_DEVS];
+    crumbs_request_t reqs[N_DEVS];
+
+    test_init_controller(&ctx);
+    crumbs_engine_init(&eng);
+    TEST_ASSERT_EQ(name, crumbs_linux_loop_init(&loop, &eng), 0, "init");
+    TEST_ASSERT(name, crumbs_linux_loop_fd(&loop) >= 0, "fd");
+    TEST_ASSERT(name, !fd_readable(loop.fd, 0), "idle loop is quiet");
+
+    g_done = 0;
+    g_early_reads = 0;
+    for (int i = 0; i < N_DEVS; i++)
+    {
+        memset(&devs[i], 0, sizeof(devs[i]));
+        devs[i].ctx = &ctx;
+        devs[i].addr = (uint8_t)(0x20 + i);
+        devs[i].write_fn = sim_write;
+        devs[i].read_fn = sim_read;
+        crumbs_request_init(&reqs[i], &devs[i], OP_GET, on_done, (void *)(intptr_t)i);
+        reqs[i].delay_us = REPLY_US + 500u;
+        TEST_ASSERT_EQ(name, crumbs_linux_loop_submit(&loop, &reqs[i]), 0, "submit");
+    }
+    TEST_ASSERT(name, fd_readable(loop.fd, 0), "submit makes the fd readable");
+
+    uint32_t start = crumbs_linux_loop_now_us();
+    while (g_done < N_DEVS && crumbs_linux_loop_now_us() - start < 1000000u)
+    {
+        if (fd_readable(loop.fd, 100))
+            crumbs_linux_loop_dispatch(&loop);
+    }
+
+    TEST_ASSERT_EQ(name, g_done, N_DEVS, "all completed");
+    for (int i = 0; i < N_DEVS; i++)
+    {
+        TEST_ASSERT_EQ(name, g_status[i], 0, "success");
+        TEST_ASSERT_EQ(name, reqs[i].reply.data[0], devs[i].addr, "payload");
+    }
+    TEST_ASSERT_EQ(name, g_early_reads, 0, "timer fired no earlier than the delay");
+    TEST_ASSERT(name, loop.dispatches <= 4u, "one wake-up to write, one to read");
+    TEST_ASSERT(name, !fd_readable(loop.fd, 20), "timer disarmed when idle");
+
+    /* A spurious dispatch is harmless. */
+    TEST_ASSERT_EQ(name, crumbs_linux_loop_dispatch(&loop), 0, "spurious dispatch");
+
+    crumbs_linux_loop_close(&loop);
+    TEST_ASSERT_EQ(name, crumbs_linux_loop_fd(&loop), -1, "closed");
+    TEST_ASSERT_EQ(name, crumbs_linux_loop_dispatch(&loop), -1, "dispatch after close");
+    TEST_ASSERT_EQ(name, crumbs_linux_loop_submit(&loop, &reqs[0]), -1, "submit after close");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Linux event loop tests:\n");
+
+    failures += test_requests_complete();
+
+    if (failures == 0)
+    {
+        printf("All Linux event loop tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d Linux event loop test(s) failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,220 @@
+/*
+ * Tests for the shared-memory metrics: transfers, errors and latencies
+ * counted per address through the wrapping transport, engine lane depths,
+ * a reader that maps the region by shm name or memfd path, snapshots that
+ * refuse an update in progress, and the Prometheus text output.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "crumbs.h"
+#include "crumbs_engine.h"
+#include "crumbs_linux_metrics.h"
+#include "crumbs_message_helpers.h"
+#include "crumbs_transport.h"
+#include "crumbs_vbus.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define DEV 0x10
+#define ABSENT 0x50
+#define OP_SET 0x01
+#define OP_GET 0x40
+
+static char g_name[64];
+static crumbs_metrics_region_t g_snap;
+static char g_prom[64u * 1024u];
+
+static void reply_get(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)ctx;
+    (void)user_data;
+    crumbs_msg_init(reply, 0x01, OP_GET);
+    crumbs_msg_add_u8(reply, 42);
+}
+
+static void bus_setup(crumbs_vbus_t *bus, crumbs_context_t *periph)
+{
+    crumbs_vbus_init(bus, 400000u);
+    crumbs_vbus_use(bus);
+    test_init_peripheral(periph);
+    periph->address = DEV;
+    crumbs_register_reply_handler(periph, OP_GET, reply_get, NULL);
+    crumbs_vbus_attach(bus, periph, 0u, 0u);
+}
+
+/* Inner transport that takes about 300 us per write. */
+static int slow_send(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    struct timespec ts = {0, 300000L};
+    (void)user_ctx;
+    (void)addr;
+    (void)data;
+    (void)len;
+    nanosleep(&ts, NULL);
+    return 0;
+}
+
+static const crumbs_transport_t slow_transport = {"slow", slow_send, NULL, NULL, 0u, 0u};
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_counts(void)
+{
+    const char *name = "transfers and errors counted per address";
+    static crumbs_vbus_t bus;
+    static crumbs_context_t periph;
+    static crumbs_linux_metrics_t met;
+    crumbs_linux_metrics_reader_t r;
+    crumbs_context_t ctrl;
+    crumbs_device_t dev;
+    crumbs_message_t m;
+
+    bus_setup(&bus, &periph);
+    test_init_controller(&ctrl);
+    crumbs_set_transport(&ctrl, &crumbs_vbus_transport, &bus);
+
+    TEST_ASSERT_EQ(name, crumbs_linux_metrics_open(&met, "no-slash"), -1, "bad name");
+    TEST_ASSERT_EQ(name, crumbs_linux_metrics_open(&met, g_name), 0, "open");
+    TEST_ASSERT_EQ(name, crumbs_linux_metrics_attach(&met, &ctrl), 0, "attach");
+    TEST_ASSERT(name, ctrl.transport == &met.transport, "transport replaced");
+    TEST_ASSERT_EQ(name, crumbs_device_init(&dev, &ctrl, DEV, crumbs_vbus_delay_us), 0, "device");
+
+    crumbs_msg_init(&m, 0x01, OP_SET);
+    crumbs_msg_add_u8(&m, 7);
+    TEST_ASSERT_EQ(name, crumbs_transport_send(&ctrl, DEV, &m), 0, "send");
+    TEST_ASSERT_EQ(name, crumbs_device_query(&dev, OP_GET, &m, CRUMBS_MAX_PAYLOAD), 0, "query");
+    TEST_ASSERT_EQ(name, m.data[0], 42, "reply through the wrapper");
+    TEST_ASSERT(name, crumbs_transport_send(&ctrl, ABSENT, &m) != 0, "absent device");
+
+    TEST_ASSERT_EQ(name, crumbs_linux_metrics_map(&r, g_name), 0, "map");
+    TEST_ASSERT_EQ(name, crumbs_linux_metrics_snapshot(&r, &g_snap), 0, "snapshot");
+    TEST_ASSERT_EQ(name, g_snap.pid, (uint32_t)getpid(), "writer pid");
+    TEST_ASSERT_EQ(name, g_snap.addr[DEV].transfers, 2u, "send + combined query");
+    TEST_ASSERT_EQ(name, g_snap.addr[DEV].errors, 0u, "no errors");
+    TEST_ASSERT_EQ(name, g_snap.addr[ABSENT].transfers, 1u, "NACKed write");
+    TEST_ASSERT_EQ(name, g_snap.addr[ABSENT].errors, 1u, "counted as an error");
+    TEST_ASSERT_EQ(name, g_snap.addr[ABSENT].err_kind[1], 1u, "kind from rc -1");
+    TEST_ASSERT_EQ(name, g_snap.transfers, 3u, "total");
+    TEST_ASSERT_EQ(name, g_snap.errors, 1u, "total errors");
+    TEST_ASSERT_EQ(name, (int)(g_snap.seq & 1u), 0, "no update in progress");
+
+    /* A region caught mid-update is refused rather than copied torn. */
+    met.region->seq++;
+    TEST_ASSERT_EQ(name, crumbs_linux_metrics_snapshot(&r, &g_snap), -2, "odd sequence");
+    met.region->seq++;
+    TEST_ASSERT_EQ(name, crumbs_linux_metrics_snapshot(&r, &g_snap), 0, "even again");
+
+    crumbs_linux_metrics_close(&met);
+    crumbs_linux_metrics_close(&met);
+    TEST_ASSERT_EQ(name, g_snap.addr[DEV].transfers, 2u, "reader keeps its view");
+    crumbs_linux_metrics_unmap(&r);
+    TEST_ASSERT_EQ(name, crumbs_linux_metrics_map(&r, g_name), -2, "name unlinked");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_latency_and_queues(void)
+{
+    const char *name = "latency histogram and engine lanes";
+    static crumbs_linux_metrics_t met;
+    static crumbs_engine_t eng;
+    static crumbs_request_t reqs[3];
+    crumbs_linux_metrics_reader_t r;
+    crumbs_context_t ctrl;
+    crumbs_device_t dev;
+    crumbs_message_t m;
+    char path[64];
+
+    /* An anonymous memfd, read back through /proc. */
+    TEST_ASSERT_EQ(name, crumbs_linux_metrics_open(&met, NULL), 0, "memfd");
+    TEST_ASSERT_EQ(name, crumbs_linux_metrics_wrap(&met, &slow_transport, NULL), 0, "wrap");
+    TEST_ASSERT(name, met.transport.receive == NULL, "caps mirror inner");
+    test_init_controller(&ctrl);
+    crumbs_set_transport(&ctrl, &met.transport, &met);
+
+    crumbs_msg_init(&m, 0x01, OP_SET);
+    for (int i = 0; i < 3; i++)
+    {
+        TEST_ASSERT_EQ(name, crumbs_transport_send(&ctrl, DEV, &m), 0, "slow send");
+    }
+
+    crumbs_engine_init(&eng);
+    crumbs_device_init(&dev, &ctrl, DEV, NULL);
+    dev.read_fn = crumbs_vbus_read;
+    crumbs_request_init(&reqs[0], &dev, OP_GET, NULL, NULL);
+    crumbs_request_init(&reqs[1], &dev, OP_GET, NULL, NULL);
+    crumbs_request_init_send(&reqs[2], &dev, &m, NULL, NULL);
+    for (int i = 0; i < 3; i++)
+    {
+        crumbs_engine_submit(&eng, &reqs[i]);
+    }
+    crumbs_linux_metrics_engine(&met, &eng);
+    crumbs_engine_cancel_lane(&eng, CRUMBS_LANE_TELEMETRY);
+    crumbs_linux_metrics_engine(&met, &eng);
+    crumbs_linux_metrics_set_queue(&met, CRUMBS_METRICS_QUEUES, 9u); /* ignored */
+
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", met.fd);
+    TEST_ASSERT_EQ(name, crumbs_linux_metrics_map(&r, path), 0, "map by path");
+    TEST_ASSERT_EQ(name, crumbs_linux_metrics_snapshot(&r, &g_snap), 0, "snapshot");
+
+    const crumbs_metrics_addr_t *a = &g_snap.addr[DEV];
+    TEST_ASSERT_EQ(name, a->transfers, 3u, "transfers");
+    TEST_ASSERT(name, a->max_us >= 300u && a->sum_us >= 900u, "latency measured");
+    TEST_ASSERT_EQ(name, a->hist[0] + a->hist[1] + a->hist[2] + a->hist[3] + a->hist[4], 0u,
+                   "nothing under 256 us");
+    TEST_ASSERT(name, g_snap.busy_us >= a->sum_us, "busy time");
+    TEST_ASSERT(name, g_snap.uptime_us >= g_snap.busy_us, "uptime");
+    TEST_ASSERT_EQ(name, g_snap.queue_depth[CRUMBS_LANE_TELEMETRY], 0u, "telemetry drained");
+    TEST_ASSERT_EQ(name, g_snap.queue_high[CRUMBS_LANE_TELEMETRY], 2u, "telemetry high water");
+    TEST_ASSERT_EQ(name, g_snap.queue_depth[CRUMBS_LANE_CONTROL], 1u, "control lane");
+
+    /* Prometheus text for the same snapshot. */
+    int n = crumbs_linux_metrics_format_prom(&g_snap, g_prom, sizeof(g_prom));
+    TEST_ASSERT(name, n > 0 && (size_t)n == strlen(g_prom), "formatted");
+    TEST_ASSERT(name, strstr(g_prom, "# TYPE crumbs_latency_us histogram\n") != NULL, "type line");
+    TEST_ASSERT(name, strstr(g_prom, "crumbs_transfers_total{addr=\"0x10\"} 3\n") != NULL,
+                "transfers");
+    TEST_ASSERT(name, strstr(g_prom, "crumbs_latency_us_bucket{addr=\"0x10\",le=\"256\"} 0\n") != NULL,
+                "cumulative bucket");
+    TEST_ASSERT(name, strstr(g_prom, "crumbs_latency_us_count{addr=\"0x10\"} 3\n") != NULL,
+                "count");
+    TEST_ASSERT(name, strstr(g_prom, "crumbs_queue_depth{queue=\"1\"} 1\n") != NULL, "queue");
+    TEST_ASSERT(name, strstr(g_prom, "addr=\"0x11\"") == NULL, "idle addresses left out");
+    TEST_ASSERT_EQ(name, crumbs_linux_metrics_format_prom(&g_snap, g_prom, 64u), -1, "too small");
+    TEST_ASSERT_EQ(name, strcmp(crumbs_linux_metrics_kind_name(3), "transfer"), 0, "kind name");
+
+    crumbs_engine_cancel_lane(&eng, CRUMBS_LANE_CONTROL);
+    crumbs_linux_metrics_unmap(&r);
+    crumbs_linux_metrics_close(&met);
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Linux metrics tests:\n");
+    snprintf(g_name, sizeof(g_name), "/crumbs-metrics-test-%ld", (long)getpid());
+
+    failures += test_counts();
+    failures += test_latency_and_queues();
+
+    if (failures == 0)
+    {
+        printf("All Linux metrics tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d Linux metrics test(s) failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,212 @@
+/*
+ * Tests for the Linux cycle executive: cycles land on an absolute deadline
+ * grid, an over-long cycle is counted as an overrun and the missed periods
+ * are skipped, and arena requests return to the arena after completion.
+ *
+ * SCHED_FIFO / mlockall need privileges the test host may not have, so
+ * crumbs_linux_rt_setup() is only checked for argument validation.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_linux_loop.h"
+#include "crumbs_linux_rt.h"
+#include "crumbs_message_helpers.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define PERIOD_US 10000u /* loose enough for a loaded CI runner */
+#define OP_GET 0x42
+
+static int sim_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    (void)user_ctx;
+    (void)addr;
+    (void)data;
+    (void)len;
+    return 0;
+}
+
+static int sim_read(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len, uint32_t timeout_us)
+{
+    crumbs_message_t m;
+    (void)user_ctx;
+    (void)timeout_us;
+    crumbs_msg_init(&m, 0x01, OP_GET);
+    crumbs_msg_add_u8(&m, addr);
+    return (int)crumbs_encode_message(&m, buffer, len);
+}
+
+static int g_done;
+static int g_last_status;
+
+static void on_done(crumbs_request_t *req, int status)
+{
+    (void)req;
+    g_last_status = status;
+    g_done++;
+}
+
+static void make_dev(crumbs_device_t *dev, crumbs_context_t *ctx)
+{
+    memset(dev, 0, sizeof(*dev));
+    dev->ctx = ctx;
+    dev->addr = 0x20;
+    dev->write_fn = sim_write;
+    dev->read_fn = sim_read;
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_deadline_grid(void)
+{
+    const char *name = "cycles follow the deadline grid";
+    static crumbs_linux_rt_t rt;
+    crumbs_linux_rt_stats_t st;
+    crumbs_linux_rt_config_t bad = {100, -1, 0};
+
+    TEST_ASSERT_EQ(name, crumbs_linux_rt_setup(NULL), -1, "setup NULL");
+    TEST_ASSERT_EQ(name, crumbs_linux_rt_setup(&bad), -1, "priority out of range");
+    TEST_ASSERT_EQ(name, crumbs_linux_rt_init(&rt, 0u), -1, "zero period");
+    TEST_ASSERT_EQ(name, crumbs_linux_rt_wait(NULL), -1, "wait NULL");
+
+    TEST_ASSERT_EQ(name, crumbs_linux_rt_init(&rt, PERIOD_US), 0, "init");
+    uint64_t first = rt.next_ns;
+    uint64_t start = crumbs_linux_rt_now_ns();
+    for (int i = 0; i < 10; i++)
+    {
+        TEST_ASSERT_EQ(name, crumbs_linux_rt_wait(&rt), 0, "on time");
+        TEST_ASSERT(name, crumbs_linux_rt_now_ns() >= first + (uint64_t)i * PERIOD_US * 1000u,
+                    "not before its deadline");
+    }
+    uint64_t elapsed = crumbs_linux_rt_now_ns() - start;
+
+    crumbs_linux_rt_get_stats(&rt, &st);
+    TEST_ASSERT(name, st.cycles == 10u, "cycle count");
+    TEST_ASSERT_EQ(name, st.overruns, 0u, "no overruns");
+    TEST_ASSERT_EQ(name, rt.next_ns, first + 10u * PERIOD_US * 1000u, "grid does not drift");
+    TEST_ASSERT(name, elapsed >= 9u * PERIOD_US * 1000u, "periods were slept");
+    TEST_ASSERT(name, st.max_jitter_us >= st.mean_jitter_us, "max >= mean jitter");
+
+    crumbs_linux_rt_reset_stats(&rt);
+    crumbs_linux_rt_get_stats(&rt, &st);
+    TEST_ASSERT(name, st.cycles == 0u, "reset");
+    TEST_ASSERT_EQ(name, rt.next_ns, first + 10u * PERIOD_US * 1000u, "reset keeps the grid");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_overrun_skips(void)
+{
+    const char *name = "an overrun skips the missed periods";
+    static crumbs_linux_rt_t rt;
+    crumbs_linux_rt_stats_t st;
+
+    TEST_ASSERT_EQ(name, crumbs_linux_rt_init(&rt, PERIOD_US), 0, "init");
+    TEST_ASSERT_EQ(name, crumbs_linux_rt_wait(&rt), 0, "first cycle");
+    uint64_t grid = rt.next_ns;
+
+    /* Run 3.5 periods: the deadline is missed and two more pass entirely. */
+    crumbs_linux_rt_sleep_until(crumbs_linux_rt_now_ns() + 7u * PERIOD_US * 500u);
+    TEST_ASSERT_EQ(name, crumbs_linux_rt_wait(&rt), 1, "late");
+
+    crumbs_linux_rt_get_stats(&rt, &st);
+    TEST_ASSERT_EQ(name, st.overruns, 1u, "overrun counted");
+    TEST_ASSERT(name, st.skipped >= 2u, "missed periods skipped");
+    TEST_ASSERT(name, st.last_exec_us >= 3u * PERIOD_US, "execution time measured");
+    TEST_ASSERT_EQ(name, (rt.next_ns - grid) % (PERIOD_US * 1000u), 0u, "still on the grid");
+    TEST_ASSERT(name, rt.next_ns > crumbs_linux_rt_now_ns(), "next deadline is ahead");
+
+    TEST_ASSERT_EQ(name, crumbs_linux_rt_wait(&rt), 0, "back on time");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_arena(void)
+{
+    const char *name = "arena requests are recycled";
+    static crumbs_linux_rt_t rt;
+    crumbs_request_t *reqs[CRUMBS_LINUX_RT_ARENA];
+    crumbs_context_t ctx;
+    crumbs_device_t dev;
+    crumbs_engine_t eng;
+
+    test_init_controller(&ctx);
+    make_dev(&dev, &ctx);
+    crumbs_engine_init(&eng);
+    TEST_ASSERT_EQ(name, crumbs_linux_rt_init(&rt, PERIOD_US), 0, "init");
+
+    for (int i = 0; i < CRUMBS_LINUX_RT_ARENA; i++)
+    {
+        reqs[i] = crumbs_linux_rt_request(&rt, &dev, OP_GET, on_done, NULL);
+        TEST_ASSERT(name, reqs[i] != NULL, "take");
+    }
+    TEST_ASSERT(name, crumbs_linux_rt_request(&rt, &dev, OP_GET, on_done, NULL) == NULL,
+                "empty arena");
+    TEST_ASSERT_EQ(name, rt.arena_misses, 1u, "miss counted");
+
+    /* Release, double release, foreign request. */
+    crumbs_request_t foreign;
+    crumbs_request_init(&foreign, &dev, OP_GET, on_done, NULL);
+    TEST_ASSERT_EQ(name, crumbs_linux_rt_release(&rt, reqs[0]), 0, "release");
+    TEST_ASSERT_EQ(name, crumbs_linux_rt_release(&rt, reqs[0]), -1, "double release");
+    TEST_ASSERT_EQ(name, crumbs_linux_rt_release(&rt, &foreign), -1, "foreign request");
+    for (int i = 1; i < CRUMBS_LINUX_RT_ARENA; i++)
+    {
+        TEST_ASSERT_EQ(name, crumbs_linux_rt_release(&rt, reqs[i]), 0, "release all");
+    }
+    TEST_ASSERT_EQ(name, rt.free_count, CRUMBS_LINUX_RT_ARENA, "arena full again");
+
+    /* A completed request returns to the arena after its callback. */
+    g_done = 0;
+    crumbs_request_t *req = crumbs_linux_rt_request(&rt, &dev, OP_GET, on_done, NULL);
+    TEST_ASSERT(name, req != NULL, "take for submit");
+    TEST_ASSERT_EQ(name, crumbs_engine_submit(&eng, req), 0, "submit");
+    TEST_ASSERT_EQ(name, rt.free_count, CRUMBS_LINUX_RT_ARENA - 1, "in flight");
+    uint64_t start = crumbs_linux_rt_now_us();
+    while (g_done == 0 && crumbs_linux_rt_now_us() - start < 1000000u)
+    {
+        crumbs_engine_poll(&eng, crumbs_linux_loop_now_us());
+    }
+    TEST_ASSERT_EQ(name, g_done, 1, "completed");
+    TEST_ASSERT_EQ(name, g_last_status, 0, "success");
+    TEST_ASSERT_EQ(name, rt.free_count, CRUMBS_LINUX_RT_ARENA, "recycled after completion");
+
+    /* So does a cancelled one. */
+    req = crumbs_linux_rt_request(&rt, &dev, OP_GET, on_done, NULL);
+    TEST_ASSERT_EQ(name, crumbs_engine_submit(&eng, req), 0, "submit again");
+    TEST_ASSERT_EQ(name, crumbs_engine_cancel(&eng, req), 0, "cancel");
+    TEST_ASSERT_EQ(name, g_last_status, CRUMBS_REQ_CANCELLED, "cancelled status");
+    TEST_ASSERT_EQ(name, rt.free_count, CRUMBS_LINUX_RT_ARENA, "recycled after cancel");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Linux cycle executive tests:\n");
+
+    failures += test_deadline_grid();
+    failures += test_overrun_skips();
+    failures += test_arena();
+
+    if (failures == 0)
+    {
+        printf("All Linux cycle executive tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d Linux cycle executive test(s) failed.\n", failures);
+    return 1;
+}
@@ -3,6 +3,9 @@
  *
  * These test the inline helper functions for type-safe payload construction
  * and bounds-checked reading.
+ *
+ * Built a second time with CRUMBS_LITTLE_ENDIAN=0 so the array helpers'
+ * per-element path is checked against the scalar helpers as well.
  */
 
 #include <stdio.h>
@@ -534,6 +537,174 @@ static int test_roundtrip(void)
     return 0;
 }
 
+/* ---- Array Tests ------------------------------------------------------ */
+
+static int test_add_arrays(void)
+{
+    const uint16_t u16s[13] = {0x0000, 0x0001, 0x00FF, 0x0100, 0x1234, 0x8000, 0xFFFF,
+                               0xBEEF, 0x7FFF, 0x0F0F, 0xF0F0, 0xA55A, 0x5AA5};
+    const int16_t i16s[8] = {-1, 0, 1, -32768, 32767, -300, 300, -2};
+    const uint32_t u32s[6] = {0u, 1u, 0xDEADBEEFu, 0x80000000u, 0xFFFFFFFFu, 0x01020304u};
+    const int32_t i32s[4] = {-1, -100000, 100000, (int32_t)0x80000000u};
+    const float floats[6] = {0.0f, -0.0f, 1.5f, -273.15f, 3.4e38f, 1e-38f};
+    crumbs_message_t arr, ref;
+    uint8_t i;
+
+    /* Each array helper gives the same bytes as the scalar helper in a loop,
+     * starting at an odd offset. */
+    crumbs_msg_init(&arr, 1, 2);
+    crumbs_msg_init(&ref, 1, 2);
+    crumbs_msg_add_u8(&arr, 0x77);
+    crumbs_msg_add_u8(&ref, 0x77);
+    if (crumbs_msg_add_u16_array(&arr, u16s, 13) != 0)
+    {
+        fprintf(stderr, "add_arrays: u16 array failed\n");
+        return 1;
+    }
+    for (i = 0; i < 13; i++)
+        crumbs_msg_add_u16(&ref, u16s[i]);
+    if (arr.data_len != ref.data_len || memcmp(arr.data, ref.data, ref.data_len) != 0)
+    {
+        fprintf(stderr, "add_arrays: u16 bytes differ\n");
+        return 1;
+    }
+
+    crumbs_msg_init(&arr, 1, 2);
+    crumbs_msg_init(&ref, 1, 2);
+    crumbs_msg_add_i16_array(&arr, i16s, 8);
+    for (i = 0; i < 8; i++)
+        crumbs_msg_add_i16(&ref, i16s[i]);
+    crumbs_msg_add_i32_array(&arr, i32s, 2);
+    for (i = 0; i < 2; i++)
+        crumbs_msg_add_i32(&ref, i32s[i]);
+    if (arr.data_len != 24 || arr.data_len != ref.data_len ||
+        memcmp(arr.data, ref.data, ref.data_len) != 0)
+    {
+        fprintf(stderr, "add_arrays: i16/i32 bytes differ\n");
+        return 1;
+    }
+
+    crumbs_msg_init(&arr, 1, 2);
+    crumbs_msg_init(&ref, 1, 2);
+    crumbs_msg_add_u32_array(&arr, u32s, 6);
+    for (i = 0; i < 6; i++)
+        crumbs_msg_add_u32(&ref, u32s[i]);
+    if (arr.data_len != ref.data_len || memcmp(arr.data, ref.data, ref.data_len) != 0)
+    {
+        fprintf(stderr, "add_arrays: u32 bytes differ\n");
+        return 1;
+    }
+
+    crumbs_msg_init(&arr, 1, 2);
+    crumbs_msg_init(&ref, 1, 2);
+    crumbs_msg_add_float_array(&arr, floats, 6);
+    for (i = 0; i < 6; i++)
+        crumbs_msg_add_float(&ref, floats[i]);
+    if (arr.data_len != ref.data_len || memcmp(arr.data, ref.data, ref.data_len) != 0)
+    {
+        fprintf(stderr, "add_arrays: float bytes differ\n");
+        return 1;
+    }
+
+    /* One bounds check: an array that does not fit appends nothing. */
+    crumbs_msg_init(&arr, 1, 2);
+    crumbs_msg_add_u8(&arr, 0);
+    if (crumbs_msg_add_u16_array(&arr, u16s, 13) != 0 ||
+        crumbs_msg_add_u16_array(&arr, u16s, 1) != -1 || arr.data_len != 27)
+    {
+        fprintf(stderr, "add_arrays: u16 overflow not rejected\n");
+        return 1;
+    }
+    crumbs_msg_init(&arr, 1, 2);
+    if (crumbs_msg_add_u32_array(&arr, u32s, 6) != 0 ||
+        crumbs_msg_add_float_array(&arr, floats, 1) != -1 || arr.data_len != 24)
+    {
+        fprintf(stderr, "add_arrays: float overflow not rejected\n");
+        return 1;
+    }
+    if (crumbs_msg_add_i16_array(&arr, i16s, 0) != 0 || arr.data_len != 24)
+    {
+        fprintf(stderr, "add_arrays: empty array changed the payload\n");
+        return 1;
+    }
+
+    printf("  add_arrays: PASS\n");
+    return 0;
+}
+
+static int test_read_arrays(void)
+{
+    uint8_t data[CRUMBS_MAX_PAYLOAD];
+    uint16_t u16s[13];
+    int16_t i16s[13];
+    uint32_t u32s[6];
+    int32_t i32s[6];
+    float floats[6];
+    uint8_t i;
+
+    for (i = 0; i < sizeof(data); i++)
+        data[i] = (uint8_t)(i * 37u + 11u);
+
+    /* Every value matches the scalar reader at the same offset. */
+    if (crumbs_msg_read_u16_array(data, 27, 1, u16s, 13) != 0 ||
+        crumbs_msg_read_i16_array(data, 27, 1, i16s, 13) != 0)
+    {
+        fprintf(stderr, "read_arrays: 16-bit read failed\n");
+        return 1;
+    }
+    for (i = 0; i < 13; i++)
+    {
+        uint16_t u;
+        int16_t s;
+        crumbs_msg_read_u16(data, 27, (uint8_t)(1 + 2 * i), &u);
+        crumbs_msg_read_i16(data, 27, (uint8_t)(1 + 2 * i), &s);
+        if (u16s[i] != u || i16s[i] != s)
+        {
+            fprintf(stderr, "read_arrays: 16-bit element %u differs\n", i);
+            return 1;
+        }
+    }
+
+    if (crumbs_msg_read_u32_array(data, 27, 3, u32s, 6) != 0 ||
+        crumbs_msg_read_i32_array(data, 27, 3, i32s, 6) != 0 ||
+        crumbs_msg_read_float_array(data, 27, 3, floats, 6) != 0)
+    {
+        fprintf(stderr, "read_arrays: 32-bit read failed\n");
+        return 1;
+    }
+    for (i = 0; i < 6; i++)
+    {
+        uint32_t u;
+        int32_t s;
+        float f;
+        crumbs_msg_read_u32(data, 27, (uint8_t)(3 + 4 * i), &u);
+        crumbs_msg_read_i32(data, 27, (uint8_t)(3 + 4 * i), &s);
+        crumbs_msg_read_float(data, 27, (uint8_t)(3 + 4 * i), &f);
+        if (u32s[i] != u || i32s[i] != s || memcmp(&floats[i], &f, sizeof(f)) != 0)
+        {
+            fprintf(stderr, "read_arrays: 32-bit element %u differs\n", i);
+            return 1;
+        }
+    }
+
+    /* Out of bounds by one byte is rejected without touching the output. */
+    u16s[0] = 0xAAAA;
+    if (crumbs_msg_read_u16_array(data, 26, 1, u16s, 13) != -1 || u16s[0] != 0xAAAA)
+    {
+        fprintf(stderr, "read_arrays: short 16-bit read not rejected\n");
+        return 1;
+    }
+    if (crumbs_msg_read_u32_array(data, 27, 4, u32s, 6) != -1 ||
+        crumbs_msg_read_float_array(data, 27, 4, floats, 6) != -1)
+    {
+        fprintf(stderr, "read_arrays: short 32-bit read not rejected\n");
+        return 1;
+    }
+
+    printf("  read_arrays: PASS\n");
+    return 0;
+}
+
 /* ---- Main ------------------------------------------------------------- */
 
 int main(void)
@@ -563,6 +734,11 @@ int main(void)
     failures += test_read_float();
     failures += test_read_bytes();
 
+    printf("  Arrays:\n");
+
+    failures += test_add_arrays();
+    failures += test_read_arrays();
+
     printf("  Integration:\n");
 
     failures += test_roundtrip();
@@ -0,0 +1,316 @@
+/*
+ * Tests for I2C mux paths: select writes are cached and skipped while the
+ * path stays open, equal addresses on different channels never answer
+ * together, the engine groups requests by port, and the mux scan finds
+ * devices in one ACK-scan per channel.
+ *
+ * The simulated upstream bus has two TCA9548A at 0x70 / 0x71 and routes
+ * each transfer to the devices whose channel is open.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_engine.h"
+#include "crumbs_message_helpers.h"
+#include "crumbs_mux.h"
+#include "crumbs_transport.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define MUX_A 0x70
+#define MUX_B 0x71
+#define OP_SET 0x01
+#define N_SIM 5
+
+typedef struct
+{
+    int mux;         /* 0 = A, 1 = B, -1 = upstream */
+    uint8_t channel;
+    uint8_t addr;
+    uint8_t type_id;
+    int writes;
+} sim_dev_t;
+
+static sim_dev_t g_devs[N_SIM] = {
+    {0, 2, 0x20, 0x11, 0},
+    {1, 2, 0x20, 0x12, 0}, /* same address and channel, other mux */
+    {0, 5, 0x20, 0x13, 0}, /* same address, other channel */
+    {1, 7, 0x30, 0x14, 0},
+    {-1, 0, 0x40, 0x15, 0}, /* on the upstream bus */
+};
+
+static uint8_t g_control[2];
+static int g_control_writes;
+static int g_collisions;
+static int g_scans;
+static uint8_t g_log[64]; /* addresses written, in order */
+static int g_log_n;
+
+/** @brief Devices that would answer @p addr now; counts collisions. */
+static sim_dev_t *sim_route(uint8_t addr)
+{
+    sim_dev_t *hit = NULL;
+    int n = 0;
+    for (int i = 0; i < N_SIM; i++)
+    {
+        sim_dev_t *d = &g_devs[i];
+        if (d->addr == addr && (d->mux < 0 || (g_control[d->mux] >> d->channel) & 1u))
+        {
+            hit = d;
+            n++;
+        }
+    }
+    if (n > 1)
+    {
+        g_collisions++;
+    }
+    return hit;
+}
+
+static int sim_send(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    (void)user_ctx;
+    if (addr == MUX_A || addr == MUX_B)
+    {
+        g_control[addr - MUX_A] = data[0];
+        g_control_writes++;
+        return len == 1u ? 0 : -1;
+    }
+    sim_dev_t *d = sim_route(addr);
+    if (!d)
+    {
+        return -1;
+    }
+    d->writes++;
+    if (g_log_n < (int)sizeof(g_log))
+    {
+        g_log[g_log_n++] = (uint8_t)(d - g_devs);
+    }
+    return 0;
+}
+
+static int sim_receive(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len,
+                       uint32_t timeout_us)
+{
+    crumbs_message_t m;
+    (void)user_ctx;
+    (void)timeout_us;
+    sim_dev_t *d = sim_route(addr);
+    if (!d)
+    {
+        return -1;
+    }
+    crumbs_msg_init(&m, d->type_id, 0x00);
+    return (int)crumbs_encode_message(&m, buffer, len);
+}
+
+static int sim_scan(void *user_ctx, uint8_t start_addr, uint8_t end_addr, int strict,
+                    uint8_t *found, size_t max_found)
+{
+    size_t n = 0u;
+    (void)user_ctx;
+    (void)strict;
+    g_scans++;
+    for (unsigned a = start_addr; a <= end_addr && n < max_found; a++)
+    {
+        int ack = (a == MUX_A || a == MUX_B);
+        for (int i = 0; i < N_SIM && !ack; i++)
+        {
+            const sim_dev_t *d = &g_devs[i];
+            ack = d->addr == a && (d->mux < 0 || (g_control[d->mux] >> d->channel) & 1u);
+        }
+        if (ack)
+        {
+            found[n++] = (uint8_t)a;
+        }
+    }
+    return (int)n;
+}
+
+static const crumbs_transport_t sim_transport = {
+    "sim", sim_send, sim_receive, NULL, CRUMBS_TRANSPORT_CAP_ADDRESSED | CRUMBS_TRANSPORT_CAP_BROADCAST, 0u};
+
+static void sim_reset(void)
+{
+    for (int i = 0; i < N_SIM; i++)
+    {
+        g_devs[i].writes = 0;
+    }
+    g_control[0] = 0xA5u; /* power-up garbage the cache must not trust */
+    g_control[1] = 0x5Au;
+    g_control_writes = 0;
+    g_collisions = 0;
+    g_scans = 0;
+    g_log_n = 0;
+}
+
+static void mux_setup(crumbs_context_t *ctx, crumbs_mux_t *mux, crumbs_device_t *devs)
+{
+    sim_reset();
+    test_init_controller(ctx);
+    crumbs_set_transport(ctx, &sim_transport, NULL);
+    crumbs_mux_init(mux, ctx->transport, ctx->transport_io);
+    crumbs_mux_add(mux, MUX_A);
+    crumbs_mux_add(mux, MUX_B);
+    for (int i = 0; i < 4; i++)
+    {
+        crumbs_mux_device_init(&devs[i], ctx, mux, g_devs[i].mux ? MUX_B : MUX_A,
+                               g_devs[i].channel, g_devs[i].addr, NULL);
+    }
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_select_cache(void)
+{
+    const char *name = "selects are cached per path";
+    crumbs_context_t ctx;
+    crumbs_mux_t mux;
+    crumbs_device_t devs[4];
+    crumbs_message_t m;
+    uint8_t mux_addr = 0u;
+    uint8_t channel = 0u;
+
+    mux_setup(&ctx, &mux, devs);
+    TEST_ASSERT_EQ(name, crumbs_mux_add(&mux, MUX_A), -1, "duplicate mux");
+    TEST_ASSERT(name, crumbs_mux_port(&mux, MUX_A, 8) == NULL, "bad channel");
+    TEST_ASSERT(name, crumbs_mux_port(&mux, 0x72, 0) == NULL, "unknown mux");
+    TEST_ASSERT(name, !(mux.transport.caps & CRUMBS_TRANSPORT_CAP_BROADCAST), "no broadcast");
+    TEST_ASSERT_EQ(name, crumbs_mux_device_path(&devs[3], &mux_addr, &channel), 0, "path");
+    TEST_ASSERT_EQ(name, mux_addr, MUX_B, "path mux");
+    TEST_ASSERT_EQ(name, channel, 7, "path channel");
+
+    crumbs_msg_init(&m, 0x01, OP_SET);
+    for (int i = 0; i < 3; i++)
+    {
+        TEST_ASSERT_EQ(name, crumbs_controller_send(&ctx, devs[0].addr, &m, devs[0].write_fn,
+                                                    devs[0].io), 0, "send A/2");
+    }
+    TEST_ASSERT_EQ(name, g_control_writes, 2, "unknown state written once per mux");
+    TEST_ASSERT_EQ(name, g_devs[0].writes, 3, "delivered");
+    TEST_ASSERT_EQ(name, mux.hits, 2u, "later sends skip the select");
+
+    /* Same address and channel on the other mux: close A, open B. */
+    TEST_ASSERT_EQ(name, crumbs_controller_send(&ctx, devs[1].addr, &m, devs[1].write_fn,
+                                                devs[1].io), 0, "send B/2");
+    TEST_ASSERT_EQ(name, g_control_writes, 4, "two selects to change mux");
+    TEST_ASSERT_EQ(name, g_devs[1].writes, 1, "reached the other device");
+    /* Same mux, other channel: one select. */
+    TEST_ASSERT_EQ(name, crumbs_controller_send(&ctx, devs[3].addr, &m, devs[3].write_fn,
+                                                devs[3].io), 0, "send B/7");
+    TEST_ASSERT_EQ(name, g_control_writes, 5, "one select to change channel");
+    TEST_ASSERT_EQ(name, g_devs[0].writes, 3, "first device untouched");
+    TEST_ASSERT_EQ(name, g_collisions, 0, "never two paths open");
+
+    /* Someone else wrote the mux: invalidate rewrites it. */
+    g_control[1] = 0u;
+    crumbs_mux_invalidate(&mux);
+    TEST_ASSERT_EQ(name, crumbs_controller_send(&ctx, devs[3].addr, &m, devs[3].write_fn,
+                                                devs[3].io), 0, "send after invalidate");
+    TEST_ASSERT_EQ(name, g_devs[3].writes, 2, "reached after rewrite");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_engine_grouping(void)
+{
+    const char *name = "engine groups requests by port";
+    crumbs_context_t ctx;
+    crumbs_mux_t mux;
+    crumbs_device_t devs[4];
+    crumbs_engine_t eng;
+    crumbs_request_t reqs[6];
+    crumbs_message_t m;
+    static const int order[6] = {0, 1, 0, 1, 0, 1};
+
+    for (int grouped = 0; grouped <= 1; grouped++)
+    {
+        mux_setup(&ctx, &mux, devs);
+        crumbs_engine_init(&eng);
+        TEST_ASSERT_EQ(name, eng.group_io, 0, "off after init");
+        eng.group_io = (uint8_t)grouped;
+        crumbs_msg_init(&m, 0x01, OP_SET);
+        for (int i = 0; i < 6; i++)
+        {
+            crumbs_request_init_send(&reqs[i], &devs[order[i]], &m, NULL, NULL);
+            reqs[i].lane = CRUMBS_LANE_TELEMETRY;
+            TEST_ASSERT_EQ(name, crumbs_engine_submit(&eng, &reqs[i]), 0, "submit");
+        }
+        TEST_ASSERT_EQ(name, crumbs_engine_poll(&eng, 0u), 0, "all sent in one poll");
+        TEST_ASSERT_EQ(name, g_log_n, 6, "six writes");
+        TEST_ASSERT_EQ(name, g_collisions, 0, "no collisions");
+        if (grouped)
+        {
+            for (int i = 0; i < 6; i++)
+            {
+                TEST_ASSERT_EQ(name, g_log[i], (i < 3) ? 0 : 1, "grouped order");
+            }
+            TEST_ASSERT_EQ(name, g_control_writes, 4, "one path change");
+        }
+        else
+        {
+            TEST_ASSERT_EQ(name, g_control_writes, 12, "path change per request");
+        }
+    }
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_scan(void)
+{
+    const char *name = "scan finds every path in one ACK-scan per channel";
+    crumbs_context_t ctx;
+    crumbs_mux_t mux;
+    crumbs_device_t devs[4];
+    crumbs_mux_found_t found[8];
+
+    mux_setup(&ctx, &mux, devs);
+    int n = crumbs_mux_scan(&mux, &ctx, sim_scan, 0x08, 0x77, 1, found, 8, 1000u);
+    TEST_ASSERT_EQ(name, n, 4, "devices behind muxes");
+    TEST_ASSERT_EQ(name, g_scans, 9, "upstream scan plus one per channel");
+    TEST_ASSERT_EQ(name, g_collisions, 0, "probes never collide");
+
+    /* Grouped by channel, then mux. */
+    TEST_ASSERT(name, found[0].mux_addr == MUX_A && found[0].channel == 2 &&
+                          found[0].addr == 0x20 && found[0].type_id == 0x11, "A/2");
+    TEST_ASSERT(name, found[1].mux_addr == MUX_B && found[1].channel == 2 &&
+                          found[1].type_id == 0x12, "B/2");
+    TEST_ASSERT(name, found[2].mux_addr == MUX_A && found[2].channel == 5 &&
+                          found[2].type_id == 0x13, "A/5");
+    TEST_ASSERT(name, found[3].mux_addr == MUX_B && found[3].channel == 7 &&
+                          found[3].addr == 0x30 && found[3].type_id == 0x14, "B/7");
+    TEST_ASSERT(name, g_control[0] == 0u && g_control[1] == 0u, "closed afterwards");
+
+    /* A short buffer stops early. */
+    n = crumbs_mux_scan(&mux, &ctx, sim_scan, 0x08, 0x77, 1, found, 2, 1000u);
+    TEST_ASSERT_EQ(name, n, 2, "capped at max_found");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Mux tests:\n");
+
+    failures += test_select_cache();
+    failures += test_engine_grouping();
+    failures += test_scan();
+
+    if (failures == 0)
+    {
+        printf("All mux tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d mux test(s) failed.\n", failures);
+    return 1;
+}
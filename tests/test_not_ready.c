@@ -0,0 +1,260 @@
+/*
+ * Tests for the NOT_READY reply marker: crumbs_reply_not_ready() on the
+ * peripheral, crumbs_controller_read_ready() and the ops/engine polling on
+ * the controller.
+ *
+ * A loopback bus connects a controller context to a real peripheral
+ * context whose reply handler only has data once a simulated conversion
+ * time has passed since the SET_REPLY write.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_ops.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define SIM_TYPE 0x44
+#define SIM_OP_GET 0x91
+
+typedef struct
+{
+    crumbs_context_t periph;
+    uint32_t now_us;
+    uint32_t written_at;
+    uint32_t busy_us;
+    int reads;
+} bus_t;
+
+static bus_t g_bus;
+
+static void sim_reply(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)ctx;
+    (void)user_data;
+    if (g_bus.now_us - g_bus.written_at < g_bus.busy_us)
+    {
+        crumbs_reply_not_ready(reply);
+        return;
+    }
+    crumbs_msg_init(reply, SIM_TYPE, SIM_OP_GET);
+    crumbs_msg_add_u8(reply, 0x5A);
+}
+
+static int bus_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    (void)user_ctx;
+    (void)addr;
+    g_bus.written_at = g_bus.now_us;
+    return crumbs_peripheral_handle_receive(&g_bus.periph, data, len);
+}
+
+static int bus_read(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len, uint32_t timeout_us)
+{
+    size_t n = 0;
+    (void)user_ctx;
+    (void)addr;
+    (void)timeout_us;
+    g_bus.reads++;
+    if (crumbs_peripheral_build_reply(&g_bus.periph, buffer, len, &n) != 0)
+        return -1;
+    return (int)n;
+}
+
+static void bus_delay(uint32_t us)
+{
+    g_bus.now_us += us;
+}
+
+static int parse_u8(const uint8_t *data, size_t len, uint8_t *out)
+{
+    return crumbs_msg_read_u8(data, (uint8_t)len, 0, out);
+}
+CRUMBS_DEFINE_GET_OP(sim, value, SIM_TYPE, SIM_OP_GET, uint8_t, parse_u8)
+
+static crumbs_context_t g_ctrl;
+
+static void setup(crumbs_device_t *dev, uint32_t busy_us)
+{
+    memset(&g_bus, 0, sizeof(g_bus));
+    g_bus.busy_us = busy_us;
+    test_init_peripheral(&g_bus.periph);
+    crumbs_register_reply_handler(&g_bus.periph, SIM_OP_GET, sim_reply, NULL);
+    test_init_controller(&g_ctrl);
+    memset(dev, 0, sizeof(*dev));
+    dev->ctx = &g_ctrl;
+    dev->addr = 0x10;
+    dev->write_fn = bus_write;
+    dev->read_fn = bus_read;
+    dev->delay_fn = bus_delay;
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_marker_frame(void)
+{
+    const char *name = "marker is a 4-byte frame";
+    crumbs_device_t dev;
+    uint8_t buf[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t n = 0;
+
+    setup(&dev, 1000u);
+    TEST_ASSERT_EQ(name, sim_query_value(&dev), 0, "SET_REPLY");
+    TEST_ASSERT_EQ(name, crumbs_peripheral_build_reply(&g_bus.periph, buf, sizeof(buf), &n), 0, "build");
+    TEST_ASSERT_SIZE_EQ(name, n, 4u, "length");
+    TEST_ASSERT_EQ(name, buf[0], 0u, "type_id");
+    TEST_ASSERT_EQ(name, buf[1], CRUMBS_CMD_NOT_READY, "opcode");
+    TEST_ASSERT_EQ(name, buf[2], 0u, "data_len");
+    TEST_ASSERT_EQ(name, g_bus.periph.requested_opcode, SIM_OP_GET, "request kept");
+
+    crumbs_reply_not_ready(NULL); /* must not crash */
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_read_ready(void)
+{
+    const char *name = "read_ready polls until data";
+    crumbs_device_t dev;
+    crumbs_message_t m;
+
+    setup(&dev, 2000u);
+    TEST_ASSERT_EQ(name, sim_query_value(&dev), 0, "SET_REPLY");
+    TEST_ASSERT_EQ(name, crumbs_controller_read_ready(&g_ctrl, dev.addr, &m, bus_read, NULL,
+                                                      bus_delay, 500u, 10000u),
+                   0, "read_ready");
+    TEST_ASSERT_EQ(name, m.opcode, SIM_OP_GET, "real reply");
+    TEST_ASSERT_EQ(name, m.data[0], 0x5A, "payload");
+    TEST_ASSERT_EQ(name, g_bus.reads, 5, "reads at 0, 500, ... 2000 us");
+    TEST_ASSERT_EQ(name, g_bus.now_us, 2000u, "no extra wait");
+
+    /* Timeout. */
+    setup(&dev, 100000u);
+    TEST_ASSERT_EQ(name, sim_query_value(&dev), 0, "SET_REPLY 2");
+    TEST_ASSERT_EQ(name, crumbs_controller_read_ready(&g_ctrl, dev.addr, &m, bus_read, NULL,
+                                                      bus_delay, 0u, 3000u),
+                   -3, "timeout");
+    TEST_ASSERT_EQ(name, g_bus.now_us, 3000u, "gave up at the timeout");
+
+    /* Bad args. */
+    TEST_ASSERT_EQ(name, crumbs_controller_read_ready(&g_ctrl, dev.addr, &m, bus_read, NULL,
+                                                      NULL, 500u, 3000u),
+                   -1, "NULL delay_fn");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_get_ready(void)
+{
+    const char *name = "GET _ready helper";
+    crumbs_device_t dev;
+    uint8_t v = 0;
+
+    setup(&dev, 1200u);
+    TEST_ASSERT_EQ(name, sim_get_value_ready(&dev, &v), 0, "get");
+    TEST_ASSERT_EQ(name, v, 0x5A, "value");
+    TEST_ASSERT(name, g_bus.now_us < 1200u + CRUMBS_READY_POLL_INTERVAL_US + 1u, "bounded by one interval");
+    TEST_ASSERT(name, g_bus.now_us < CRUMBS_DEFAULT_QUERY_DELAY_US, "beats the fixed delay");
+
+    /* The plain GET sees the marker as a mismatched reply. */
+    setup(&dev, CRUMBS_DEFAULT_QUERY_DELAY_US * 2u);
+    TEST_ASSERT_EQ(name, sim_get_value(&dev, &v), -1, "plain GET rejects marker");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int g_status;
+static int g_done;
+
+static void on_done(crumbs_request_t *req, int status)
+{
+    (void)req;
+    g_status = status;
+    g_done++;
+}
+
+static int run_engine(crumbs_engine_t *eng)
+{
+    for (int i = 0; i < 1000 && crumbs_engine_poll(eng, g_bus.now_us) > 0; i++)
+    {
+        uint32_t idle = crumbs_engine_idle_us(eng, g_bus.now_us);
+        g_bus.now_us += idle ? idle : 1u;
+    }
+    return g_done;
+}
+
+static int test_engine_polls(void)
+{
+    const char *name = "engine re-reads NOT_READY";
+    crumbs_device_t dev;
+    crumbs_engine_t eng;
+    crumbs_request_t req;
+    crumbs_latency_t lat;
+
+    setup(&dev, 1700u);
+    crumbs_latency_init(&lat, 0u, 0u);
+    dev.latency = &lat;
+    crumbs_engine_init(&eng);
+    g_done = 0;
+    crumbs_request_init(&req, &dev, SIM_OP_GET, on_done, NULL);
+    req.delay_us = 500u;
+    TEST_ASSERT_EQ(name, crumbs_engine_submit(&eng, &req), 0, "submit");
+    TEST_ASSERT_EQ(name, run_engine(&eng), 1, "completed once");
+    TEST_ASSERT_EQ(name, g_status, 0, "success");
+    TEST_ASSERT_EQ(name, req.reply.data[0], 0x5A, "payload");
+    TEST_ASSERT_EQ(name, g_bus.reads, 4, "500 + 3 polls");
+    TEST_ASSERT_EQ(name, lat.count, 0u, "explicit delay not learned");
+
+    /* Learned delay: only the first read is reported. */
+    setup(&dev, 1700u);
+    crumbs_latency_init(&lat, 0u, 1000u);
+    dev.latency = &lat;
+    g_done = 0;
+    crumbs_request_init(&req, &dev, SIM_OP_GET, on_done, NULL);
+    crumbs_engine_submit(&eng, &req);
+    run_engine(&eng);
+    TEST_ASSERT_EQ(name, g_status, 0, "success 2");
+    TEST_ASSERT_EQ(name, lat.entries[0].samples, 1u, "one report");
+    TEST_ASSERT(name, crumbs_latency_estimate(&lat, dev.addr, SIM_OP_GET) >= 1000u, "NOT_READY counts as too early");
+
+    /* Never ready. */
+    setup(&dev, UINT32_MAX);
+    g_done = 0;
+    crumbs_request_init(&req, &dev, SIM_OP_GET, on_done, NULL);
+    req.delay_us = 100u;
+    crumbs_engine_submit(&eng, &req);
+    TEST_ASSERT_EQ(name, run_engine(&eng), 1, "completed");
+    TEST_ASSERT_EQ(name, g_status, -3, "timeout status");
+    TEST_ASSERT(name, g_bus.now_us >= CRUMBS_READY_POLL_TIMEOUT_US, "polled until the timeout");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("NOT_READY tests:\n");
+
+    failures += test_marker_frame();
+    failures += test_read_ready();
+    failures += test_get_ready();
+    failures += test_engine_polls();
+
+    if (failures == 0)
+    {
+        printf("All NOT_READY tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d NOT_READY test(s) failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,184 @@
+/*
+ * Tests for the bus time profiler on a 100 kHz virtual bus, where every
+ * wire time is exact: bytes asked for, clocked and used by the frame, the
+ * split of transfer time into addressing, payload, padding and stalls,
+ * timed delays, goodput, combined transfers and errors.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_message_helpers.h"
+#include "crumbs_profile.h"
+#include "crumbs_transport.h"
+#include "crumbs_vbus.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define DEV 0x10
+#define ABSENT 0x50
+#define OP_GET 0x40
+#define REPLY_US 200u
+
+static crumbs_vbus_t g_bus;
+static crumbs_context_t g_periph;
+static crumbs_profile_t g_prof;
+
+static void reply_get(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)ctx;
+    (void)user_data;
+    crumbs_msg_init(reply, 0x01, OP_GET);
+    crumbs_msg_add_u8(reply, 42);
+}
+
+/* Controller on a 100 kHz bus (10 us per clock), profiled from the start. */
+static void setup(crumbs_context_t *ctrl)
+{
+    crumbs_vbus_init(&g_bus, 100000u);
+    crumbs_vbus_use(&g_bus);
+    test_init_peripheral(&g_periph);
+    g_periph.address = DEV;
+    crumbs_register_reply_handler(&g_periph, OP_GET, reply_get, NULL);
+    crumbs_vbus_attach(&g_bus, &g_periph, 0u, REPLY_US);
+
+    test_init_controller(ctrl);
+    crumbs_set_transport(ctrl, &crumbs_vbus_transport, &g_bus);
+    crumbs_profile_attach(&g_prof, ctrl, crumbs_vbus_clock_us, 100000u);
+    g_prof.delay = crumbs_vbus_delay_us;
+    crumbs_profile_use(&g_prof);
+}
+
+static void set_reply_msg(crumbs_message_t *m)
+{
+    crumbs_msg_init(m, 0x00, CRUMBS_CMD_SET_REPLY);
+    crumbs_msg_add_u8(m, OP_GET);
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_breakdown(void)
+{
+    const char *name = "SET_REPLY, wait, padded read";
+    crumbs_context_t ctrl;
+    crumbs_message_t m;
+    crumbs_profile_summary_t s;
+
+    setup(&ctrl);
+    TEST_ASSERT(name, ctrl.transport == &g_prof.transport, "transport replaced");
+
+    /* 5-byte write: 11 + 45 clocks. */
+    set_reply_msg(&m);
+    TEST_ASSERT_EQ(name, crumbs_controller_send(&ctrl, DEV, &m, g_prof.transport.send, &g_prof),
+                   0, "SET_REPLY");
+    crumbs_profile_delay_us(1000u);
+    /* 31-byte read of a 5-byte frame: 200 us stretch + 11 + 279 clocks. */
+    TEST_ASSERT_EQ(name, crumbs_controller_read(&ctrl, DEV, &m, g_prof.transport.receive, &g_prof),
+                   0, "read");
+    TEST_ASSERT_EQ(name, m.data[0], 42, "reply");
+    crumbs_vbus_advance_us(&g_bus, 340u);
+
+    const crumbs_profile_stat_t *w = &g_prof.kinds[CRUMBS_PROFILE_WRITE];
+    const crumbs_profile_stat_t *r = &g_prof.kinds[CRUMBS_PROFILE_READ];
+    TEST_ASSERT_EQ(name, w->count, 1u, "one write");
+    TEST_ASSERT_EQ(name, w->time_us, 560u, "write time");
+    TEST_ASSERT_EQ(name, r->requested, CRUMBS_MESSAGE_MAX_SIZE, "read asked for a full frame");
+    TEST_ASSERT_EQ(name, r->moved, CRUMBS_MESSAGE_MAX_SIZE, "and clocked it");
+    TEST_ASSERT_EQ(name, r->used, 5u, "5 bytes were the frame");
+    TEST_ASSERT_EQ(name, r->max_us, 3100u, "read time");
+    TEST_ASSERT_EQ(name, g_prof.delays, 1u, "delay timed");
+    TEST_ASSERT_EQ(name, g_prof.delay_us, 1000u, "delay time");
+
+    crumbs_profile_summary(&g_prof, &s);
+    TEST_ASSERT_EQ(name, s.elapsed_us, 5000u, "window");
+    TEST_ASSERT_EQ(name, s.transfer_us, 3660u, "transfer time");
+    TEST_ASSERT_EQ(name, s.delay_us, 1000u, "delay");
+    TEST_ASSERT_EQ(name, s.other_us, 340u, "other");
+    TEST_ASSERT_EQ(name, s.addr_us, 220u, "addressing");
+    TEST_ASSERT_EQ(name, s.payload_us, 900u, "payload");
+    TEST_ASSERT_EQ(name, s.padding_us, 2340u, "padding");
+    TEST_ASSERT_EQ(name, s.stall_us, REPLY_US, "reply build time shows as stall");
+    TEST_ASSERT_EQ(name, s.used, 10u, "frame bytes");
+    TEST_ASSERT_EQ(name, s.goodput_bps, 2000u, "goodput");
+    TEST_ASSERT_EQ(name, s.bus_bps, 2732u, "goodput while transferring");
+    TEST_ASSERT_EQ(name, s.busy_pct, 73u, "busy");
+    TEST_ASSERT_EQ(name, s.efficiency_pct, 24u, "efficiency");
+
+    /* A new window starts empty. */
+    crumbs_profile_reset(&g_prof);
+    crumbs_profile_summary(&g_prof, &s);
+    TEST_ASSERT_EQ(name, s.transfers + s.elapsed_us + s.delay_us + s.goodput_bps, 0u, "reset");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_transact_and_errors(void)
+{
+    const char *name = "combined transfers and errors";
+    crumbs_context_t ctrl;
+    crumbs_message_t m;
+    crumbs_profile_summary_t s;
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    uint8_t rx[CRUMBS_MESSAGE_MAX_SIZE];
+
+    setup(&ctrl);
+    TEST_ASSERT(name, g_prof.transport.transact != NULL, "caps mirror inner");
+    set_reply_msg(&m);
+    size_t len = crumbs_encode_message(&m, frame, sizeof(frame));
+    TEST_ASSERT_EQ(name, len, 5u, "encode");
+    int n = g_prof.transport.transact(&g_prof, DEV, frame, len, rx, sizeof(rx), 0u, 1);
+    TEST_ASSERT_EQ(name, n, 5, "reply bytes");
+
+    const crumbs_profile_stat_t *t = &g_prof.kinds[CRUMBS_PROFILE_TRANSACT];
+    TEST_ASSERT_EQ(name, t->count, 1u, "counted as combined");
+    TEST_ASSERT_EQ(name, t->phases, 2u, "two address phases");
+    TEST_ASSERT_EQ(name, t->requested, 36u, "asked");
+    TEST_ASSERT_EQ(name, t->moved, 36u, "clocked");
+    TEST_ASSERT_EQ(name, t->used, 10u, "used");
+
+    crumbs_profile_reset(&g_prof);
+    TEST_ASSERT(name, crumbs_controller_send(&ctrl, ABSENT, &m, g_prof.transport.send, &g_prof) != 0,
+                "absent device");
+    TEST_ASSERT(name, g_prof.transport.receive(&g_prof, ABSENT, rx, sizeof(rx), 0u) < 0,
+                "absent read");
+    crumbs_profile_summary(&g_prof, &s);
+    TEST_ASSERT_EQ(name, s.transfers, 2u, "transfers");
+    TEST_ASSERT_EQ(name, s.errors, 2u, "errors");
+    TEST_ASSERT_EQ(name, s.moved, 0u, "only the address was clocked");
+    TEST_ASSERT_EQ(name, s.requested, 5u + CRUMBS_MESSAGE_MAX_SIZE, "asked anyway");
+    TEST_ASSERT_EQ(name, s.addr_us, 220u, "address phases");
+    TEST_ASSERT_EQ(name, s.goodput_bps, 0u, "no goodput");
+
+    /* Without a selected profiler the delay hook is inert. */
+    crumbs_profile_use(NULL);
+    uint32_t before = crumbs_vbus_clock_us();
+    crumbs_profile_delay_us(500u);
+    TEST_ASSERT_EQ(name, crumbs_vbus_clock_us(), before, "no delay");
+    TEST_ASSERT_EQ(name, crumbs_profile_attach(&g_prof, &ctrl, NULL, 0u), -1, "clock required");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Profile tests:\n");
+
+    failures += test_breakdown();
+    failures += test_transact_and_errors();
+
+    if (failures == 0)
+    {
+        printf("All profile tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d profile test(s) failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,293 @@
+/*
+ * Tests for stuck-bus recovery: the 9-clock + STOP sequence against a
+ * modeled slave holding SDA, and the guarding transport on a virtual bus.
+ * It should trip at once on a stalled transfer and after a run of quick
+ * failures, respect the holdoff, pause, record outages and re-validate
+ * the registry.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_message_helpers.h"
+#include "crumbs_recover.h"
+#include "crumbs_registry.h"
+#include "crumbs_transport.h"
+#include "crumbs_vbus.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define DEV 0x10
+#define GONE 0x11
+#define ABSENT 0x50
+#define TIMEOUT_US 50000u
+#define RECOVER_US 1000u
+
+/* Open-drain lines with a slave that holds SDA low for `hold` more clocks. */
+typedef struct
+{
+    int scl;
+    int sda;     /* master's side: 1 = released */
+    int hold;    /* clocks until the slave lets go */
+    int stops;   /* SDA rising edges with SCL high and the line free */
+} pins_model_t;
+
+static int model_sda(const pins_model_t *m)
+{
+    return m->sda && m->hold == 0;
+}
+
+static void model_set_scl(void *user, int level)
+{
+    pins_model_t *m = (pins_model_t *)user;
+    if (!m->scl && level && m->hold > 0)
+    {
+        m->hold--;
+    }
+    m->scl = level;
+}
+
+static void model_set_sda(void *user, int level)
+{
+    pins_model_t *m = (pins_model_t *)user;
+    int before = model_sda(m);
+    m->sda = level;
+    if (m->scl && !before && model_sda(m))
+    {
+        m->stops++;
+    }
+}
+
+static int model_get_sda(void *user)
+{
+    return model_sda((const pins_model_t *)user);
+}
+
+static crumbs_vbus_t g_bus;
+static crumbs_context_t g_periph;
+static crumbs_context_t g_gone;
+static crumbs_recover_t g_rec;
+static int g_stuck;
+static int g_recover_calls;
+
+/* vbus behind a switch: while stuck, every transfer times out. */
+static int stuck_send(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    if (g_stuck)
+    {
+        crumbs_vbus_advance_us(&g_bus, TIMEOUT_US);
+        return -3;
+    }
+    return crumbs_vbus_write(user_ctx, addr, data, len);
+}
+
+static int stuck_read(void *user_ctx, uint8_t addr, uint8_t *buf, size_t len, uint32_t timeout_us)
+{
+    if (g_stuck)
+    {
+        crumbs_vbus_advance_us(&g_bus, TIMEOUT_US);
+        return -3;
+    }
+    return crumbs_vbus_read(user_ctx, addr, buf, len, timeout_us);
+}
+
+static const crumbs_transport_t stuck_transport = {"stuck", stuck_send, stuck_read, NULL, 0u, 0u};
+
+static int fake_recover(void *io)
+{
+    (void)io;
+    g_recover_calls++;
+    crumbs_vbus_advance_us(&g_bus, RECOVER_US);
+    g_stuck = 0;
+    return 0;
+}
+
+static void reply_version(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)user_data;
+    crumbs_msg_init(reply, 0x01, 0x00);
+    crumbs_msg_add_u8(reply, ctx->address);
+}
+
+static void setup(crumbs_context_t *ctrl)
+{
+    crumbs_vbus_init(&g_bus, 400000u);
+    crumbs_vbus_use(&g_bus);
+    test_init_peripheral(&g_periph);
+    g_periph.address = DEV;
+    crumbs_register_reply_handler(&g_periph, 0x00, reply_version, NULL);
+    crumbs_vbus_attach(&g_bus, &g_periph, 0u, 0u);
+    test_init_peripheral(&g_gone);
+    g_gone.address = GONE;
+    crumbs_register_reply_handler(&g_gone, 0x00, reply_version, NULL);
+    crumbs_vbus_attach(&g_bus, &g_gone, 0u, 0u);
+
+    test_init_controller(ctrl);
+    crumbs_set_transport(ctrl, &stuck_transport, &g_bus);
+    crumbs_recover_attach(&g_rec, ctrl, crumbs_vbus_clock_us, fake_recover, NULL);
+    g_stuck = 0;
+    g_recover_calls = 0;
+}
+
+static int send_to(crumbs_context_t *ctrl, uint8_t addr)
+{
+    crumbs_message_t m;
+    crumbs_msg_init(&m, 0x01, 0x01);
+    return crumbs_transport_send(ctrl, addr, &m);
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_bus_clear(void)
+{
+    const char *name = "9 clocks and a STOP";
+    pins_model_t m = {1, 1, 4, 0};
+    crumbs_bus_pins_t pins = {model_set_scl, model_set_sda, model_get_sda, NULL, &m, 0u};
+
+    TEST_ASSERT_EQ(name, crumbs_bus_clear(&pins), 4, "clocked until SDA was free");
+    TEST_ASSERT_EQ(name, m.stops, 1, "STOP sent");
+    TEST_ASSERT(name, m.scl && model_sda(&m), "lines released");
+
+    m.hold = 0;
+    m.stops = 0;
+    TEST_ASSERT_EQ(name, crumbs_bus_clear(&pins), 0, "free bus: no clocks");
+    TEST_ASSERT_EQ(name, m.stops, 1, "still a STOP");
+
+    m.hold = 100;
+    TEST_ASSERT_EQ(name, crumbs_bus_clear(&pins), CRUMBS_RECOVER_E_STUCK, "gives up");
+    TEST_ASSERT_EQ(name, m.hold, 100 - 9 - 1, "after 9 clocks (and the STOP's)");
+
+    pins.get_sda = NULL;
+    TEST_ASSERT_EQ(name, crumbs_bus_clear(&pins), -1, "bad args");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_stall(void)
+{
+    const char *name = "stalled transfer trips at once";
+    crumbs_context_t ctrl;
+    crumbs_registry_t reg;
+    uint8_t found[4];
+    uint8_t types[4];
+
+    setup(&ctrl);
+    TEST_ASSERT(name, ctrl.transport == &g_rec.transport, "transport replaced");
+    TEST_ASSERT(name, g_rec.transport.transact == NULL, "caps mirror inner");
+
+    /* Registry of both devices; one of them will not come back. */
+    int n = crumbs_controller_scan_for_crumbs_with_types(&ctrl, DEV, GONE, 0, crumbs_vbus_write,
+                                                         crumbs_vbus_read, &g_bus, found, types,
+                                                         4u, 0u);
+    TEST_ASSERT_EQ(name, n, 2, "both found");
+    crumbs_registry_init(&reg);
+    crumbs_registry_update_bus(&reg, 0u, found, types, (size_t)n);
+    crumbs_recover_set_registry(&g_rec, &reg, 0u, &ctrl);
+
+    TEST_ASSERT_EQ(name, send_to(&ctrl, DEV), 0, "healthy");
+    g_bus.devices[1].online = 0u;
+    g_stuck = 1;
+    uint32_t t0 = crumbs_vbus_clock_us();
+    TEST_ASSERT_EQ(name, send_to(&ctrl, DEV), -3, "the tripping transfer keeps its error");
+    TEST_ASSERT_EQ(name, g_recover_calls, 1, "recovered after one timeout");
+    TEST_ASSERT_EQ(name, g_rec.stall_trips, 1u, "stall trip");
+    TEST_ASSERT_EQ(name, g_rec.recoveries, 1u, "counted");
+    TEST_ASSERT_EQ(name, g_rec.last_validate, 1, "registry re-validated");
+    TEST_ASSERT_EQ(name, reg.count, 1u, "device that did not come back dropped");
+    TEST_ASSERT_EQ(name, reg.entries[0].addr, DEV, "survivor");
+    TEST_ASSERT(name, g_rec.last_outage_us >= TIMEOUT_US + RECOVER_US &&
+                          g_rec.last_outage_us <= crumbs_vbus_clock_us() - t0,
+                "outage measured");
+    TEST_ASSERT_EQ(name, g_rec.fails, 0u, "run cleared");
+    TEST_ASSERT_EQ(name, send_to(&ctrl, DEV), 0, "bus back");
+
+    /* Retripping inside the holdoff does not recover again. */
+    g_stuck = 1;
+    send_to(&ctrl, DEV);
+    TEST_ASSERT_EQ(name, g_rec.held_off, 1u, "held off");
+    TEST_ASSERT_EQ(name, g_recover_calls, 1, "no second recovery");
+    crumbs_vbus_advance_us(&g_bus, CRUMBS_RECOVER_HOLDOFF_US);
+    send_to(&ctrl, DEV);
+    TEST_ASSERT_EQ(name, g_recover_calls, 2, "after the holdoff");
+    TEST_ASSERT_EQ(name, g_rec.max_outage_us >= g_rec.last_outage_us, 1, "max kept");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_fail_run(void)
+{
+    const char *name = "a run of quick failures trips";
+    crumbs_context_t ctrl;
+    uint8_t buf[CRUMBS_MESSAGE_MAX_SIZE];
+
+    setup(&ctrl);
+    g_rec.holdoff_us = 0u;
+
+    /* Quick NACKs interleaved with successes never build a run. */
+    for (int i = 0; i < 4; i++)
+    {
+        send_to(&ctrl, ABSENT);
+        send_to(&ctrl, ABSENT);
+        TEST_ASSERT_EQ(name, send_to(&ctrl, DEV), 0, "healthy device");
+    }
+    TEST_ASSERT_EQ(name, g_rec.fail_trips, 0u, "no trip");
+
+    send_to(&ctrl, ABSENT);
+    TEST_ASSERT(name, g_rec.transport.receive(&g_rec, ABSENT, buf, sizeof(buf), 0u) < 0, "read");
+    TEST_ASSERT_EQ(name, g_recover_calls, 0, "two in a row");
+    send_to(&ctrl, ABSENT);
+    TEST_ASSERT_EQ(name, g_rec.fail_trips, 1u, "third trips");
+    TEST_ASSERT_EQ(name, g_recover_calls, 1, "recovered");
+    TEST_ASSERT_EQ(name, g_rec.stall_trips, 0u, "not a stall");
+    TEST_ASSERT_EQ(name, g_rec.last_validate, 0, "no registry");
+
+    /* Paused (a scan): failures do not count. */
+    g_rec.paused = 1u;
+    for (int i = 0; i < 10; i++)
+    {
+        send_to(&ctrl, ABSENT);
+    }
+    g_rec.paused = 0u;
+    TEST_ASSERT_EQ(name, g_recover_calls, 1, "paused");
+
+    /* Without a hook trips are only counted. */
+    g_rec.recover = NULL;
+    for (int i = 0; i < 3; i++)
+    {
+        send_to(&ctrl, ABSENT);
+    }
+    TEST_ASSERT_EQ(name, g_rec.fail_trips, 2u, "counted");
+    TEST_ASSERT_EQ(name, crumbs_recover_now(&g_rec), -1, "no hook");
+    g_rec.recover = fake_recover;
+    TEST_ASSERT_EQ(name, crumbs_recover_now(&g_rec), 0, "manual recovery");
+    TEST_ASSERT_EQ(name, g_rec.recoveries, 2u, "counted");
+    TEST_ASSERT_EQ(name, crumbs_recover_init(&g_rec, NULL, NULL, NULL, NULL, NULL), -1, "bad args");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Recover tests:\n");
+
+    failures += test_bus_clear();
+    failures += test_stall();
+    failures += test_fail_run();
+
+    if (failures == 0)
+    {
+        printf("All recover tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d recover test(s) failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,175 @@
+/*
+ * Tests for register-file mode: REG_READ ranges served from memory without
+ * reply handlers, clamping at the end of the region, and the controller
+ * helpers on the virtual bus. Built with CRUMBS_ENABLE_REGISTERS=1.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_vbus.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define REGS_SIZE 40
+
+static uint8_t g_regs[REGS_SIZE];
+static int g_requests;
+
+static void on_request(crumbs_context_t *ctx, crumbs_message_t *reply)
+{
+    (void)ctx;
+    g_requests++;
+    reply->data_len = 0u;
+}
+
+static void fill_regs(uint8_t seed)
+{
+    for (int i = 0; i < REGS_SIZE; i++)
+    {
+        g_regs[i] = (uint8_t)(seed + i);
+    }
+}
+
+static size_t encode_reg_read(uint8_t *frame, uint16_t offset, uint8_t count)
+{
+    crumbs_message_t m;
+    uint8_t payload[3] = {(uint8_t)(offset & 0xFFu), (uint8_t)(offset >> 8), count};
+    test_msg_create(&m, 0x00, CRUMBS_CMD_REG_READ, payload, 3);
+    return test_encode(&m, frame);
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_peripheral_ranges(void)
+{
+    const char *name = "REG_READ selects and serves a range";
+    crumbs_context_t p;
+    crumbs_message_t reply;
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t len;
+
+    fill_regs(0x40);
+    g_requests = 0;
+    test_init_peripheral(&p);
+    crumbs_set_callbacks(&p, NULL, on_request, NULL);
+    TEST_ASSERT_EQ(name, crumbs_set_register_file(&p, g_regs, REGS_SIZE), 0, "install");
+    TEST_ASSERT(name, crumbs_peripheral_capabilities(&p) & CRUMBS_CAP_REGISTERS, "cap bit");
+
+    /* One write picks the reply; no SET_REPLY, no on_request. */
+    len = encode_reg_read(frame, 0x0003u, 4u);
+    TEST_ASSERT_EQ(name, crumbs_peripheral_handle_receive(&p, frame, len), 0, "receive");
+    TEST_ASSERT_EQ(name, p.requested_opcode, CRUMBS_CMD_REG_READ, "selected");
+    TEST_ASSERT_EQ(name, crumbs_peripheral_build_reply(&p, frame, sizeof(frame), &len), 0, "build");
+    TEST_ASSERT_EQ(name, crumbs_decode_message(frame, len, &reply, NULL), 0, "decode");
+    TEST_ASSERT_EQ(name, reply.opcode, CRUMBS_CMD_REG_READ, "opcode");
+    TEST_ASSERT_EQ(name, reply.data_len, 6, "offset + 4 bytes");
+    TEST_ASSERT_EQ(name, reply.data[0], 3, "offset lo");
+    TEST_ASSERT_EQ(name, reply.data[1], 0, "offset hi");
+    TEST_ASSERT(name, memcmp(&reply.data[2], &g_regs[3], 4) == 0, "bytes");
+    TEST_ASSERT_EQ(name, g_requests, 0, "on_request skipped");
+
+    /* The same range is re-read from live memory. */
+    g_regs[3] = 0xEEu;
+    crumbs_peripheral_build_reply(&p, frame, sizeof(frame), &len);
+    crumbs_decode_message(frame, len, &reply, NULL);
+    TEST_ASSERT_EQ(name, reply.data[2], 0xEE, "live value");
+
+    /* Ranges are cut at the end of the region and at CRUMBS_REG_MAX_READ. */
+    len = encode_reg_read(frame, REGS_SIZE - 2u, 10u);
+    crumbs_peripheral_handle_receive(&p, frame, len);
+    crumbs_peripheral_build_reply(&p, frame, sizeof(frame), &len);
+    crumbs_decode_message(frame, len, &reply, NULL);
+    TEST_ASSERT_EQ(name, reply.data_len, 4, "clamped to end");
+
+    len = encode_reg_read(frame, 0u, 200u);
+    crumbs_peripheral_handle_receive(&p, frame, len);
+    crumbs_peripheral_build_reply(&p, frame, sizeof(frame), &len);
+    crumbs_decode_message(frame, len, &reply, NULL);
+    TEST_ASSERT_EQ(name, reply.data_len, CRUMBS_MAX_PAYLOAD, "clamped to frame");
+
+    len = encode_reg_read(frame, 0x1000u, 4u);
+    crumbs_peripheral_handle_receive(&p, frame, len);
+    crumbs_peripheral_build_reply(&p, frame, sizeof(frame), &len);
+    crumbs_decode_message(frame, len, &reply, NULL);
+    TEST_ASSERT_EQ(name, reply.data_len, 2, "past the end: offset only");
+
+    /* Detached: REG_READ is an ordinary opcode again. */
+    crumbs_set_register_file(&p, NULL, 0u);
+    TEST_ASSERT(name, !(crumbs_peripheral_capabilities(&p) & CRUMBS_CAP_REGISTERS), "cap cleared");
+    p.requested_opcode = 0u;
+    len = encode_reg_read(frame, 0u, 4u);
+    crumbs_peripheral_handle_receive(&p, frame, len);
+    TEST_ASSERT_EQ(name, p.requested_opcode, 0, "not selected");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_controller_reads(void)
+{
+    const char *name = "controller reads ranges over the bus";
+    crumbs_vbus_t bus;
+    crumbs_context_t p, ctrl;
+    crumbs_device_t dev;
+    uint8_t out[REGS_SIZE];
+
+    fill_regs(0x10);
+    g_requests = 0;
+    crumbs_vbus_init(&bus, 100000u);
+    crumbs_vbus_use(&bus);
+    test_init_peripheral(&p);
+    crumbs_set_callbacks(&p, NULL, on_request, NULL);
+    crumbs_set_register_file(&p, g_regs, REGS_SIZE);
+    TEST_ASSERT(name, crumbs_vbus_attach(&bus, &p, 0u, 0u) != NULL, "attach");
+    test_init_controller(&ctrl);
+    crumbs_vbus_bind(&bus, &dev, &ctrl, 0x10);
+
+    /* The whole region takes two chunks. */
+    memset(out, 0, sizeof(out));
+    TEST_ASSERT_EQ(name, crumbs_controller_read_registers(&dev, 0u, out, REGS_SIZE), 0, "read all");
+    TEST_ASSERT(name, memcmp(out, g_regs, REGS_SIZE) == 0, "all bytes");
+
+    memset(out, 0, sizeof(out));
+    TEST_ASSERT_EQ(name, crumbs_controller_read_registers(&dev, 30u, out, 4u), 0, "read part");
+    TEST_ASSERT(name, memcmp(out, &g_regs[30], 4) == 0, "part bytes");
+
+    /* One repeated-START transaction. */
+    memset(out, 0, sizeof(out));
+    TEST_ASSERT_EQ(name, crumbs_controller_query_registers(&ctrl, 0x10, 8u, out, 6u,
+                                                           crumbs_vbus_write_read, &bus),
+                   0, "query");
+    TEST_ASSERT(name, memcmp(out, &g_regs[8], 6) == 0, "query bytes");
+    TEST_ASSERT_EQ(name, g_requests, 0, "no reply handler ran");
+
+    /* A range the region cannot satisfy is an error, not a short copy. */
+    TEST_ASSERT_EQ(name, crumbs_controller_read_registers(&dev, REGS_SIZE - 2u, out, 4u), -1, "past end");
+    TEST_ASSERT_EQ(name, crumbs_controller_query_registers(&ctrl, 0x10, 0u, out, 26u,
+                                                           crumbs_vbus_write_read, &bus),
+                   -1, "too long for one frame");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Register file tests:\n");
+
+    failures += test_peripheral_ranges();
+    failures += test_controller_reads();
+
+    if (failures == 0)
+    {
+        printf("All register file tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d register file test(s) failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,209 @@
+/*
+ * Tests for the discovered-device registry: put/find, the binary blob
+ * round trip and its error checks, update after a full scan, and
+ * validation of cached entries against a fake bus.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_message_helpers.h"
+#include "crumbs_registry.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+/* type_id answered at each address; 0 = nothing there. */
+static uint8_t g_types[128];
+static int g_reads;
+
+static int fake_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    (void)user_ctx;
+    (void)data;
+    (void)len;
+    return (addr < 128u && g_types[addr]) ? 0 : -1;
+}
+
+static int fake_read(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len, uint32_t timeout_us)
+{
+    crumbs_message_t m;
+    (void)user_ctx;
+    (void)timeout_us;
+    g_reads++;
+    if (addr >= 128u || !g_types[addr])
+        return 0;
+    crumbs_msg_init(&m, g_types[addr], 0x00);
+    crumbs_msg_add_u8(&m, 0x01);
+    return (int)crumbs_encode_message(&m, buffer, len);
+}
+
+static crumbs_registry_entry_t make_entry(uint8_t bus, uint8_t addr, uint8_t type_id)
+{
+    crumbs_registry_entry_t e;
+    memset(&e, 0, sizeof(e));
+    e.bus = bus;
+    e.addr = addr;
+    e.type_id = type_id;
+    e.mod_major = 1;
+    e.mod_minor = 2;
+    e.mod_patch = 3;
+    e.crumbs_version = 0x0A0Bu;
+    return e;
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_put_find(void)
+{
+    const char *name = "put and find";
+    crumbs_registry_t reg;
+    crumbs_registry_entry_t e = make_entry(0, 0x20, 0x11);
+
+    crumbs_registry_init(&reg);
+    TEST_ASSERT_EQ(name, crumbs_registry_put(&reg, &e), 0, "put");
+    e.type_id = 0x12;
+    TEST_ASSERT_EQ(name, crumbs_registry_put(&reg, &e), 0, "replace");
+    TEST_ASSERT_EQ(name, reg.count, 1u, "replaced in place");
+    TEST_ASSERT_EQ(name, crumbs_registry_find(&reg, 0, 0x20)->type_id, 0x12, "new type");
+    TEST_ASSERT(name, crumbs_registry_find(&reg, 1, 0x20) == NULL, "bus is part of the key");
+
+    for (int i = 1; i < CRUMBS_REGISTRY_MAX; i++)
+    {
+        e = make_entry(1, (uint8_t)i, 0x11);
+        crumbs_registry_put(&reg, &e);
+    }
+    e = make_entry(2, 0x30, 0x11);
+    TEST_ASSERT_EQ(name, crumbs_registry_put(&reg, &e), -1, "full");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_blob_round_trip(void)
+{
+    const char *name = "blob round trip";
+    crumbs_registry_t reg, back;
+    uint8_t blob[CRUMBS_REGISTRY_BLOB_MAX];
+    crumbs_registry_entry_t e;
+
+    crumbs_registry_init(&reg);
+    e = make_entry(0, 0x20, 0x11);
+    crumbs_registry_put(&reg, &e);
+    e = make_entry(1, 0x21, 0x22);
+    e.crumbs_version = 0xBEEFu;
+    crumbs_registry_put(&reg, &e);
+
+    size_t n = crumbs_registry_save(&reg, blob, sizeof(blob));
+    TEST_ASSERT_SIZE_EQ(name, n, 5u + 2u * CRUMBS_REGISTRY_ENTRY_SIZE + 1u, "size");
+    TEST_ASSERT_SIZE_EQ(name, crumbs_registry_save(&reg, blob, n - 1u), 0u, "short buffer");
+
+    TEST_ASSERT_EQ(name, crumbs_registry_load(&back, blob, n), 0, "load");
+    TEST_ASSERT_EQ(name, back.count, 2u, "count");
+    TEST_ASSERT(name, memcmp(back.entries, reg.entries, 2u * sizeof(e)) == 0, "entries");
+
+    blob[7] ^= 0x40u;
+    TEST_ASSERT_EQ(name, crumbs_registry_load(&back, blob, n), -2, "CRC");
+    TEST_ASSERT_EQ(name, back.count, 0u, "emptied on error");
+    blob[7] ^= 0x40u;
+
+    TEST_ASSERT_EQ(name, crumbs_registry_load(&back, blob, n - 1u), -1, "truncated");
+    blob[0] = 'X';
+    TEST_ASSERT_EQ(name, crumbs_registry_load(&back, blob, n), -1, "magic");
+    TEST_ASSERT_EQ(name, crumbs_registry_load(&back, NULL, 0u), -1, "no blob");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_validate(void)
+{
+    const char *name = "validate probes cached addresses only";
+    crumbs_context_t ctx;
+    crumbs_registry_t reg;
+    crumbs_registry_entry_t e;
+
+    test_init_controller(&ctx);
+    memset(g_types, 0, sizeof(g_types));
+    g_types[0x20] = 0x11;
+    g_types[0x21] = 0x22;
+    g_types[0x40] = 0x33; /* not cached: must not be probed */
+
+    crumbs_registry_init(&reg);
+    e = make_entry(0, 0x20, 0x11);
+    crumbs_registry_put(&reg, &e);
+    e = make_entry(0, 0x21, 0x22);
+    crumbs_registry_put(&reg, &e);
+    e = make_entry(1, 0x20, 0x55); /* other bus, untouched */
+    crumbs_registry_put(&reg, &e);
+
+    g_reads = 0;
+    TEST_ASSERT_EQ(name, crumbs_registry_validate(&reg, 0, &ctx, 0, fake_write, fake_read, NULL, 1000u),
+                   0, "cache confirmed");
+    TEST_ASSERT_EQ(name, g_reads, 2, "one probe per entry");
+    TEST_ASSERT_EQ(name, reg.count, 3u, "nothing dropped");
+
+    /* One device gone, one swapped for another type. */
+    g_types[0x20] = 0;
+    g_types[0x21] = 0x23;
+    TEST_ASSERT_EQ(name, crumbs_registry_validate(&reg, 0, &ctx, 0, fake_write, fake_read, NULL, 1000u),
+                   2, "two stale");
+    TEST_ASSERT_EQ(name, reg.count, 1u, "stale entries dropped");
+    TEST_ASSERT(name, crumbs_registry_find(&reg, 1, 0x20) != NULL, "other bus kept");
+    TEST_ASSERT_EQ(name, crumbs_registry_validate(&reg, 0, &ctx, 0, fake_write, fake_read, NULL, 1000u),
+                   -2, "nothing cached");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_update_bus(void)
+{
+    const char *name = "update after a full scan";
+    crumbs_registry_t reg;
+    crumbs_registry_entry_t e;
+    const uint8_t addrs[] = {0x20, 0x22};
+    const uint8_t types[] = {0x11, 0x44};
+
+    crumbs_registry_init(&reg);
+    e = make_entry(0, 0x20, 0x11);
+    crumbs_registry_put(&reg, &e);
+    e = make_entry(0, 0x21, 0x22);
+    crumbs_registry_put(&reg, &e);
+    e = make_entry(1, 0x21, 0x22);
+    crumbs_registry_put(&reg, &e);
+
+    TEST_ASSERT_EQ(name, crumbs_registry_update_bus(&reg, 0, addrs, types, 2u), 2, "recorded");
+    TEST_ASSERT_EQ(name, reg.count, 3u, "count");
+    TEST_ASSERT_EQ(name, crumbs_registry_find(&reg, 0, 0x20)->mod_minor, 2u, "unchanged keeps version");
+    TEST_ASSERT(name, crumbs_registry_find(&reg, 0, 0x21) == NULL, "missing dropped");
+    TEST_ASSERT_EQ(name, crumbs_registry_find(&reg, 0, 0x22)->type_id, 0x44, "new added");
+    TEST_ASSERT_EQ(name, crumbs_registry_find(&reg, 0, 0x22)->mod_major, 0u, "new has no version");
+    TEST_ASSERT(name, crumbs_registry_find(&reg, 1, 0x21) != NULL, "other bus kept");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Registry tests:\n");
+
+    failures += test_put_find();
+    failures += test_blob_round_trip();
+    failures += test_validate();
+    failures += test_update_bus();
+
+    if (failures == 0)
+    {
+        printf("All registry tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d registry test(s) failed.\n", failures);
+    return 1;
+}
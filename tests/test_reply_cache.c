@@ -0,0 +1,170 @@
+/*
+ * Tests for pre-built reply frames.
+ *
+ * Built with CRUMBS_ENABLE_REPLY_CACHE=1. A peripheral context receives
+ * SET_REPLY frames directly; the tests count reply-handler calls to check
+ * that a ready frame is served without running the handler.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_message_helpers.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define OP_GET_A 0x10
+#define OP_GET_B 0x11
+#define OP_GET_SLOW 0x12
+#define OP_GET_PUSHED 0x13
+
+static int g_calls;
+static uint8_t g_value;
+
+static void reply_value(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)user_data;
+    g_calls++;
+    crumbs_msg_init(reply, 0x01, ctx->requested_opcode);
+    crumbs_msg_add_u8(reply, g_value);
+}
+
+static void reply_not_ready(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)ctx;
+    (void)user_data;
+    g_calls++;
+    crumbs_msg_init(reply, 0x01, CRUMBS_CMD_NOT_READY);
+}
+
+static void set_reply(crumbs_context_t *ctx, uint8_t opcode)
+{
+    crumbs_message_t m;
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    crumbs_msg_init(&m, 0x00, CRUMBS_CMD_SET_REPLY);
+    crumbs_msg_add_u8(&m, opcode);
+    size_t n = crumbs_encode_message(&m, frame, sizeof(frame));
+    crumbs_peripheral_handle_receive(ctx, frame, n);
+}
+
+/* Build a reply the way a request handler would and return its first data byte. */
+static int served_value(crumbs_context_t *ctx)
+{
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t n = 0;
+    crumbs_message_t m;
+    if (crumbs_peripheral_build_reply(ctx, frame, sizeof(frame), &n) != 0 || n == 0u)
+        return -1;
+    if (crumbs_decode_message(frame, n, &m, NULL) != 0 || m.data_len != 1u)
+        return -1;
+    return m.data[0];
+}
+
+static void setup(crumbs_context_t *ctx)
+{
+    test_init_peripheral(ctx);
+    crumbs_register_reply_handler(ctx, OP_GET_A, reply_value, NULL);
+    crumbs_register_reply_handler(ctx, OP_GET_B, reply_value, NULL);
+    crumbs_register_reply_handler(ctx, OP_GET_SLOW, reply_not_ready, NULL);
+    g_calls = 0;
+    g_value = 7;
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_refresh_and_serve(void)
+{
+    const char *name = "refreshed frame served without the handler";
+    crumbs_context_t ctx;
+    const uint8_t *frame;
+    size_t len;
+
+    setup(&ctx);
+    set_reply(&ctx, OP_GET_A);
+    TEST_ASSERT_EQ(name, crumbs_peripheral_ready_reply(&ctx, &frame, &len), 0, "nothing ready yet");
+    TEST_ASSERT_EQ(name, served_value(&ctx), 7, "live build");
+    TEST_ASSERT_EQ(name, g_calls, 1, "handler ran in the request path");
+
+    TEST_ASSERT_EQ(name, crumbs_peripheral_refresh_reply(&ctx), 1, "refresh builds");
+    TEST_ASSERT_EQ(name, g_calls, 2, "handler ran in loop()");
+    TEST_ASSERT_EQ(name, crumbs_peripheral_refresh_reply(&ctx), 0, "already current");
+    TEST_ASSERT_EQ(name, crumbs_peripheral_ready_reply(&ctx, &frame, &len), 1, "ready");
+    TEST_ASSERT_SIZE_EQ(name, len, 5u, "frame length");
+
+    g_value = 9; /* data changed but not invalidated: the old frame is served */
+    TEST_ASSERT_EQ(name, served_value(&ctx), 7, "served from cache");
+    TEST_ASSERT_EQ(name, g_calls, 2, "no handler call");
+
+    crumbs_peripheral_invalidate_reply(&ctx);
+    TEST_ASSERT_EQ(name, served_value(&ctx), 9, "stale frame not served");
+    TEST_ASSERT_EQ(name, crumbs_peripheral_refresh_reply(&ctx), 1, "rebuilt after invalidate");
+    TEST_ASSERT_EQ(name, served_value(&ctx), 9, "new frame");
+
+    /* A new SET_REPLY opcode falls back to live building until the next refresh. */
+    int before = g_calls;
+    set_reply(&ctx, OP_GET_B);
+    TEST_ASSERT_EQ(name, crumbs_peripheral_ready_reply(&ctx, &frame, &len), 0, "other opcode");
+    TEST_ASSERT_EQ(name, served_value(&ctx), 9, "live build for B");
+    TEST_ASSERT_EQ(name, g_calls, before + 1, "handler ran");
+    TEST_ASSERT_EQ(name, crumbs_peripheral_refresh_reply(&ctx), 1, "refresh for B");
+    TEST_ASSERT_EQ(name, crumbs_peripheral_ready_reply(&ctx, &frame, &len), 1, "B ready");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_publish_and_not_ready(void)
+{
+    const char *name = "published frames and NOT_READY";
+    crumbs_context_t ctx;
+    crumbs_message_t m;
+    const uint8_t *frame;
+    size_t len;
+
+    setup(&ctx);
+
+    /* No handler for this opcode: the application pushes the data. */
+    crumbs_msg_init(&m, 0x01, OP_GET_PUSHED);
+    crumbs_msg_add_u8(&m, 42);
+    TEST_ASSERT_EQ(name, crumbs_peripheral_publish_reply(&ctx, &m), 0, "publish");
+    set_reply(&ctx, OP_GET_PUSHED);
+    TEST_ASSERT_EQ(name, served_value(&ctx), 42, "published frame served");
+    TEST_ASSERT_EQ(name, crumbs_peripheral_refresh_reply(&ctx), 0, "refresh keeps it");
+    TEST_ASSERT_EQ(name, served_value(&ctx), 42, "still served");
+
+    /* A NOT_READY answer is never frozen into the cache. */
+    set_reply(&ctx, OP_GET_SLOW);
+    TEST_ASSERT_EQ(name, crumbs_peripheral_refresh_reply(&ctx), 0, "not cached");
+    TEST_ASSERT_EQ(name, crumbs_peripheral_ready_reply(&ctx, &frame, &len), 0, "nothing ready");
+
+    TEST_ASSERT_EQ(name, crumbs_peripheral_publish_reply(NULL, &m), -1, "NULL ctx");
+    TEST_ASSERT_EQ(name, crumbs_peripheral_publish_reply(&ctx, NULL), -1, "NULL msg");
+    crumbs_context_t ctrl;
+    test_init_controller(&ctrl);
+    TEST_ASSERT_EQ(name, crumbs_peripheral_refresh_reply(&ctrl), -1, "controller role");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Reply cache tests:\n");
+
+    failures += test_refresh_and_serve();
+    failures += test_publish_and_not_ready();
+
+    if (failures == 0)
+    {
+        printf("All reply cache tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d reply cache test(s) failed.\n", failures);
+    return 1;
+}
@@ -98,6 +98,10 @@ static int simulate_read_reply(crumbs_context_t *peripheral_ctx,
 static uint8_t g_mock_read_buf[CRUMBS_MESSAGE_MAX_SIZE];
 /** Length to return from the mock read function. Negative = simulate error. */
 static int g_mock_read_len = 0;
+/** Lengths requested by each call to the mock read function. */
+static size_t g_mock_req_len[4];
+/** Number of calls to the mock read function. */
+static int g_mock_reads = 0;
 
 /**
  * @brief Mock crumbs_i2c_read_fn: returns bytes from g_mock_read_buf.
@@ -112,12 +116,55 @@ static int mock_i2c_read(void *user_ctx,
     (void)addr;
     (void)timeout_us;
 
+    if (g_mock_reads < 4)
+        g_mock_req_len[g_mock_reads] = len;
+    g_mock_reads++;
+
     if (g_mock_read_len < 0)
         return g_mock_read_len; /* simulated I2C error */
 
     size_t n = (size_t)g_mock_read_len < len ? (size_t)g_mock_read_len : len;
     memcpy(buffer, g_mock_read_buf, n);
-    return g_mock_read_len;
+    return (int)n;
+}
+
+/* ---- Mock combined transfer for crumbs_controller_query tests -------- */
+
+/** Peripheral the mock combined transfer talks to. */
+static crumbs_context_t *g_rs_periph;
+/** Number of combined transfers issued. */
+static int g_rs_calls;
+/** require_repeated_start seen on the last transfer. */
+static int g_rs_flag;
+
+/**
+ * @brief Mock crumbs_i2c_write_read_fn: delivers tx to g_rs_periph, then
+ *        returns its reply padded to rx_len like a fixed-length I2C read.
+ */
+static int mock_write_read(void *user_ctx,
+                           uint8_t addr,
+                           const uint8_t *tx,
+                           size_t tx_len,
+                           uint8_t *rx,
+                           size_t rx_len,
+                           uint32_t timeout_us,
+                           int require_repeated_start)
+{
+    size_t n = 0;
+    (void)user_ctx;
+    (void)addr;
+    (void)timeout_us;
+
+    g_rs_calls++;
+    g_rs_flag = require_repeated_start;
+    if (!g_rs_periph)
+        return CRUMBS_I2C_DEV_E_NO_REPEATED_START;
+    if (crumbs_peripheral_handle_receive(g_rs_periph, tx, tx_len) != 0)
+        return -1;
+    if (crumbs_peripheral_build_reply(g_rs_periph, rx, rx_len, &n) != 0)
+        return -1;
+    memset(rx + n, 0xFF, rx_len - n);
+    return (int)rx_len;
 }
 
 /* ---- Tests ------------------------------------------------------------ */
@@ -397,6 +444,106 @@ static int test_controller_read_short(void)
     return 0;
 }
 
+/**
+ * Test: crumbs_controller_query does SET_REPLY + read in one transfer.
+ */
+static int test_controller_query(void)
+{
+    const char *test_name = "controller_query";
+
+    crumbs_context_t periph = {0};
+    crumbs_init(&periph, CRUMBS_ROLE_PERIPHERAL, 0x20);
+    crumbs_set_callbacks(&periph, NULL, test_on_request, NULL);
+
+    crumbs_context_t ctrl = {0};
+    crumbs_init(&ctrl, CRUMBS_ROLE_CONTROLLER, 0);
+
+    g_rs_periph = &periph;
+    g_rs_calls = 0;
+    g_rs_flag = 0;
+
+    crumbs_message_t out_msg;
+    int rc = crumbs_controller_query(&ctrl, 0x20, 0x11, &out_msg, mock_write_read, NULL);
+    TEST_ASSERT_EQ(test_name, rc, 0, "query should succeed");
+    TEST_ASSERT_EQ(test_name, g_rs_calls, 1, "one combined transfer");
+    TEST_ASSERT_EQ(test_name, g_rs_flag, 1, "repeated START required");
+    TEST_ASSERT_EQ(test_name, periph.requested_opcode, 0x11, "SET_REPLY delivered");
+    TEST_ASSERT_EQ(test_name, out_msg.opcode, 0x11, "reply opcode");
+    TEST_ASSERT_EQ(test_name, out_msg.data[0], g_status_byte, "reply data (padding ignored)");
+
+    /* Transport without repeated START. */
+    g_rs_periph = NULL;
+    rc = crumbs_controller_query(&ctrl, 0x20, 0x11, &out_msg, mock_write_read, NULL);
+    TEST_ASSERT_EQ(test_name, rc, CRUMBS_I2C_DEV_E_NO_REPEATED_START, "no repeated START");
+
+    /* Bad args and wrong role. */
+    rc = crumbs_controller_query(&ctrl, 0x20, 0x11, &out_msg, NULL, NULL);
+    TEST_ASSERT_EQ(test_name, rc, -1, "NULL write_read_fn");
+    rc = crumbs_controller_query(&periph, 0x20, 0x11, &out_msg, mock_write_read, NULL);
+    TEST_ASSERT_EQ(test_name, rc, -1, "peripheral role");
+
+    printf("  %s: PASS\n", test_name);
+    return 0;
+}
+
+/**
+ * Test: crumbs_controller_read_len / _two_phase only clock in the frame.
+ */
+static int test_controller_read_len(void)
+{
+    const char *test_name = "controller_read_len";
+
+    crumbs_context_t periph = {0};
+    crumbs_init(&periph, CRUMBS_ROLE_PERIPHERAL, 0x20);
+    crumbs_set_callbacks(&periph, NULL, test_on_request, NULL);
+    simulate_set_reply(&periph, 0x11); /* 1-byte status reply */
+
+    size_t frame_len = 0;
+    crumbs_peripheral_build_reply(&periph, g_mock_read_buf, sizeof(g_mock_read_buf), &frame_len);
+    TEST_ASSERT_SIZE_EQ(test_name, frame_len, 5u, "5-byte frame");
+    g_mock_read_len = (int)frame_len;
+
+    crumbs_context_t ctrl = {0};
+    crumbs_init(&ctrl, CRUMBS_ROLE_CONTROLLER, 0);
+    crumbs_message_t out_msg;
+
+    /* Full read asks for the maximum frame. */
+    g_mock_reads = 0;
+    TEST_ASSERT_EQ(test_name, crumbs_controller_read(&ctrl, 0x20, &out_msg, mock_i2c_read, NULL), 0, "read");
+    TEST_ASSERT_SIZE_EQ(test_name, g_mock_req_len[0], (size_t)CRUMBS_MESSAGE_MAX_SIZE, "full read length");
+
+    /* Known length: exactly 4 + 1 bytes. */
+    g_mock_reads = 0;
+    TEST_ASSERT_EQ(test_name, crumbs_controller_read_len(&ctrl, 0x20, &out_msg, mock_i2c_read, NULL, 1), 0, "read_len");
+    TEST_ASSERT_SIZE_EQ(test_name, g_mock_req_len[0], 5u, "read_len length");
+    TEST_ASSERT_EQ(test_name, out_msg.data[0], g_status_byte, "read_len data");
+
+    /* Too short a limit truncates the frame, which is rejected. */
+    TEST_ASSERT_EQ(test_name, crumbs_controller_read_len(&ctrl, 0x20, &out_msg, mock_i2c_read, NULL, 0), -1, "truncated");
+
+    /* Oversized limit is clamped. */
+    g_mock_reads = 0;
+    crumbs_controller_read_len(&ctrl, 0x20, &out_msg, mock_i2c_read, NULL, 200);
+    TEST_ASSERT_SIZE_EQ(test_name, g_mock_req_len[0], (size_t)CRUMBS_MESSAGE_MAX_SIZE, "clamped");
+
+    /* Two-phase: 3-byte header, then the 5-byte frame. */
+    g_mock_reads = 0;
+    TEST_ASSERT_EQ(test_name, crumbs_controller_read_two_phase(&ctrl, 0x20, &out_msg, mock_i2c_read, NULL), 0, "two_phase");
+    TEST_ASSERT_EQ(test_name, g_mock_reads, 2, "two reads");
+    TEST_ASSERT_SIZE_EQ(test_name, g_mock_req_len[0], 3u, "header read");
+    TEST_ASSERT_SIZE_EQ(test_name, g_mock_req_len[1], 5u, "frame read");
+    TEST_ASSERT_EQ(test_name, out_msg.data[0], g_status_byte, "two_phase data");
+
+    /* A bogus header length is rejected before the second read. */
+    g_mock_read_buf[2] = 0x40;
+    g_mock_reads = 0;
+    TEST_ASSERT_EQ(test_name, crumbs_controller_read_two_phase(&ctrl, 0x20, &out_msg, mock_i2c_read, NULL), -1, "bad header");
+    TEST_ASSERT_EQ(test_name, g_mock_reads, 1, "no second read");
+
+    printf("  %s: PASS\n", test_name);
+    return 0;
+}
+
 /* ---- Main ------------------------------------------------------------- */
 
 int main(void)
@@ -413,6 +560,8 @@ int main(void)
     failures += test_persistent_opcode();
     failures += test_controller_read_ok();
     failures += test_controller_read_short();
+    failures += test_controller_query();
+    failures += test_controller_read_len();
 
     printf("\n");
     if (failures == 0)
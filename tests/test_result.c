@@ -0,0 +1,197 @@
+/*
+ * Tests for command results: the read after a command returns its result
+ * once, handlers report failures with crumbs_set_result(), SET_REPLY
+ * disarms the slot, and the controller gets send + ack in one write and
+ * one read on the virtual bus. Built with CRUMBS_ENABLE_RESULT=1.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_vbus.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define MOTOR_TYPE 0x09
+#define OP_SET_SPEED 0x10
+#define OP_UNKNOWN 0x11
+#define OP_GET_SPEED 0x80
+#define E_RANGE 0x02
+
+static uint8_t g_speed;
+
+static void on_set_speed(crumbs_context_t *ctx, uint8_t opcode, const uint8_t *data,
+                         uint8_t len, void *user_data)
+{
+    (void)opcode;
+    (void)user_data;
+    if (len < 1u || data[0] > 100u)
+    {
+        crumbs_set_result(ctx, E_RANGE);
+        return;
+    }
+    g_speed = data[0];
+}
+
+static void reply_speed(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)ctx;
+    (void)user_data;
+    reply->type_id = MOTOR_TYPE;
+    reply->opcode = OP_GET_SPEED;
+    reply->data_len = 1u;
+    reply->data[0] = g_speed;
+}
+
+static void setup_motor(crumbs_context_t *p)
+{
+    test_init_peripheral(p);
+    crumbs_register_handler(p, OP_SET_SPEED, on_set_speed, NULL);
+    crumbs_register_reply_handler(p, OP_GET_SPEED, reply_speed, NULL);
+    g_speed = 0u;
+}
+
+static void send_cmd(crumbs_context_t *p, uint8_t opcode, uint8_t value)
+{
+    crumbs_message_t m;
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    test_msg_create(&m, MOTOR_TYPE, opcode, &value, 1);
+    size_t n = test_encode(&m, frame);
+    crumbs_peripheral_handle_receive(p, frame, n);
+}
+
+static void read_reply(crumbs_context_t *p, crumbs_message_t *reply)
+{
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t len = 0u;
+    memset(reply, 0, sizeof(*reply));
+    crumbs_peripheral_build_reply(p, frame, sizeof(frame), &len);
+    crumbs_decode_message(frame, len, reply, NULL);
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_peripheral_slot(void)
+{
+    const char *name = "the read after a command carries its result";
+    crumbs_context_t p;
+    crumbs_message_t r;
+    crumbs_result_t res;
+
+    setup_motor(&p);
+    send_cmd(&p, CRUMBS_CMD_SET_REPLY, OP_GET_SPEED);
+
+    send_cmd(&p, OP_SET_SPEED, 40);
+    read_reply(&p, &r);
+    TEST_ASSERT_EQ(name, r.opcode, CRUMBS_CMD_RESULT, "result frame");
+    TEST_ASSERT_EQ(name, r.data_len, 3, "result len");
+    TEST_ASSERT_EQ(name, r.data[0], OP_SET_SPEED, "opcode");
+    TEST_ASSERT_EQ(name, r.data[1], CRUMBS_RESULT_OK, "ok by default");
+    TEST_ASSERT_EQ(name, r.data[2], 1, "count");
+    read_reply(&p, &r);
+    TEST_ASSERT_EQ(name, r.opcode, OP_GET_SPEED, "then the selected reply");
+    TEST_ASSERT_EQ(name, r.data[0], 40, "value");
+
+    send_cmd(&p, OP_SET_SPEED, 200);
+    read_reply(&p, &r);
+    TEST_ASSERT_EQ(name, r.data[1], E_RANGE, "handler status");
+    TEST_ASSERT_EQ(name, g_speed, 40, "not applied");
+
+    send_cmd(&p, OP_UNKNOWN, 1);
+    TEST_ASSERT_EQ(name, crumbs_last_result(&p, &res), 0, "last result");
+    TEST_ASSERT_EQ(name, res.opcode, OP_UNKNOWN, "unknown opcode");
+    TEST_ASSERT_EQ(name, res.status, CRUMBS_RESULT_UNHANDLED, "unhandled");
+    TEST_ASSERT_EQ(name, res.count, 3, "count");
+
+    /* A SET_REPLY in between selects its reply instead. */
+    send_cmd(&p, CRUMBS_CMD_SET_REPLY, OP_GET_SPEED);
+    read_reply(&p, &r);
+    TEST_ASSERT_EQ(name, r.opcode, OP_GET_SPEED, "disarmed by SET_REPLY");
+
+    /* The slot can be selected explicitly too, without disarming later ones. */
+    send_cmd(&p, CRUMBS_CMD_SET_REPLY, CRUMBS_CMD_RESULT);
+    read_reply(&p, &r);
+    TEST_ASSERT_EQ(name, r.opcode, CRUMBS_CMD_RESULT, "explicit");
+    read_reply(&p, &r);
+    TEST_ASSERT_EQ(name, r.data[0], OP_UNKNOWN, "explicit again");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_controller_checked(void)
+{
+    const char *name = "send_checked acks in one write and one read";
+    crumbs_vbus_t bus;
+    crumbs_context_t p, ctrl;
+    crumbs_device_t dev;
+    crumbs_message_t m;
+    crumbs_result_t res;
+    crumbs_capabilities_t caps;
+    uint8_t v;
+
+    crumbs_vbus_init(&bus, 100000u);
+    crumbs_vbus_use(&bus);
+    setup_motor(&p);
+    TEST_ASSERT(name, crumbs_vbus_attach(&bus, &p, 0u, 0u) != NULL, "attach");
+    test_init_controller(&ctrl);
+    crumbs_vbus_bind(&bus, &dev, &ctrl, 0x10);
+
+    TEST_ASSERT_EQ(name, crumbs_controller_get_capabilities(&dev, &caps), 0, "caps");
+    TEST_ASSERT(name, (caps.flags & CRUMBS_CAP_RESULT) != 0u, "capability bit");
+
+    v = 70;
+    test_msg_create(&m, MOTOR_TYPE, OP_SET_SPEED, &v, 1);
+    uint32_t transfers = bus.transfers;
+    TEST_ASSERT_EQ(name, crumbs_controller_send_checked(&dev, &m, &res), 0, "checked send");
+    TEST_ASSERT_EQ(name, bus.transfers - transfers, 2u, "two transactions");
+    TEST_ASSERT_EQ(name, res.status, CRUMBS_RESULT_OK, "ok");
+    TEST_ASSERT_EQ(name, g_speed, 70, "applied");
+
+    v = 101;
+    test_msg_create(&m, MOTOR_TYPE, OP_SET_SPEED, &v, 1);
+    TEST_ASSERT_EQ(name, crumbs_controller_send_checked(&dev, &m, &res), 0, "rejected send");
+    TEST_ASSERT_EQ(name, res.status, E_RANGE, "range error");
+
+    TEST_ASSERT_EQ(name, crumbs_controller_get_result(&dev, &res), 0, "get_result");
+    TEST_ASSERT_EQ(name, res.opcode, OP_SET_SPEED, "opcode");
+    TEST_ASSERT_EQ(name, res.count, 2, "count");
+    TEST_ASSERT_EQ(name, crumbs_controller_send_checked(&dev, NULL, &res), -1, "NULL msg");
+
+    /* A two-phase header read uses the unasked result up. */
+    v = OP_GET_SPEED;
+    test_msg_create(&m, 0x00, CRUMBS_CMD_SET_REPLY, &v, 1);
+    TEST_ASSERT_EQ(name, crumbs_controller_send(&ctrl, 0x10, &m, crumbs_vbus_write, &bus), 0, "select");
+    v = 30;
+    test_msg_create(&m, MOTOR_TYPE, OP_SET_SPEED, &v, 1);
+    TEST_ASSERT_EQ(name, crumbs_controller_send(&ctrl, 0x10, &m, crumbs_vbus_write, &bus), 0, "send");
+    TEST_ASSERT_EQ(name, crumbs_controller_read_two_phase(&ctrl, 0x10, &m, crumbs_vbus_read, &bus),
+                   -1, "two-phase rejected");
+    TEST_ASSERT_EQ(name, crumbs_controller_get_result(&dev, &res), 0, "fetched again");
+    TEST_ASSERT_EQ(name, res.count, 3, "third command");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Command result tests:\n");
+
+    failures += test_peripheral_slot();
+    failures += test_controller_checked();
+
+    if (failures == 0)
+    {
+        printf("All command result tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d command result test(s) failed.\n", failures);
+    return 1;
+}
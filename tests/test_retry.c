@@ -0,0 +1,309 @@
+/*
+ * Tests for the controller retry layer: failure classes, exponential
+ * backoff with jitter, the separate CRC budget, and the per-address
+ * circuit breaker quarantining a dead device on the virtual bus.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_retry.h"
+#include "crumbs_vbus.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define OP_SET 0x01
+#define OP_TEMP 0x02
+
+/* Scripted transport: the n-th write returns g_write_rc[n] (0 past the end),
+ * the n-th read is corrupted if g_read_bad[n]. */
+static int g_write_rc[8];
+static uint8_t g_read_bad[8];
+static int g_writes;
+static int g_reads;
+static uint32_t g_waits[8];
+static int g_wait_count;
+static crumbs_message_t g_reply;
+
+static int script_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    (void)user_ctx;
+    (void)addr;
+    (void)data;
+    (void)len;
+    int n = g_writes++;
+    return n < 8 ? g_write_rc[n] : 0;
+}
+
+static int script_read(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len, uint32_t timeout_us)
+{
+    (void)user_ctx;
+    (void)addr;
+    (void)timeout_us;
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t n = test_encode(&g_reply, frame);
+    int i = g_reads++;
+    if (i < 8 && g_read_bad[i])
+    {
+        frame[n - 1] ^= 0x01u;
+    }
+    n = n < len ? n : len;
+    memcpy(buffer, frame, n);
+    return (int)n;
+}
+
+static void record_wait(uint32_t us)
+{
+    if (us == CRUMBS_DEFAULT_QUERY_DELAY_US)
+    {
+        return; /* the GET's reply delay, not a backoff */
+    }
+    if (g_wait_count < 8)
+    {
+        g_waits[g_wait_count] = us;
+    }
+    g_wait_count++;
+}
+
+static void script_reset(void)
+{
+    memset(g_write_rc, 0, sizeof(g_write_rc));
+    memset(g_read_bad, 0, sizeof(g_read_bad));
+    g_writes = 0;
+    g_reads = 0;
+    g_wait_count = 0;
+}
+
+static void script_device(crumbs_device_t *dev, crumbs_context_t *ctrl)
+{
+    memset(dev, 0, sizeof(*dev));
+    dev->ctx = ctrl;
+    dev->addr = 0x20;
+    dev->write_fn = script_write;
+    dev->read_fn = script_read;
+    dev->delay_fn = record_wait;
+}
+
+static crumbs_retry_policy_t no_jitter(void)
+{
+    crumbs_retry_policy_t p;
+    crumbs_retry_policy_default(&p);
+    p.jitter_pct = 0u;
+    return p;
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_classify(void)
+{
+    const char *name = "NACK and CRC failures are told apart";
+
+    TEST_ASSERT_EQ(name, crumbs_retry_classify(0, 0), CRUMBS_FAIL_NONE, "success");
+    TEST_ASSERT_EQ(name, crumbs_retry_classify(2, 0), CRUMBS_FAIL_NACK, "Wire address NACK");
+    TEST_ASSERT_EQ(name, crumbs_retry_classify(5, 0), CRUMBS_FAIL_NACK, "Wire timeout");
+    TEST_ASSERT_EQ(name, crumbs_retry_classify(-2, 0), CRUMBS_FAIL_NACK, "Linux write failure");
+    TEST_ASSERT_EQ(name, crumbs_retry_classify(-2, 1), CRUMBS_FAIL_CRC, "read CRC");
+    TEST_ASSERT_EQ(name, crumbs_retry_classify(-1, 1), CRUMBS_FAIL_NACK, "short read");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_backoff(void)
+{
+    const char *name = "NACKs back off exponentially";
+    crumbs_context_t ctrl;
+    crumbs_device_t dev;
+    crumbs_retry_t r;
+    crumbs_message_t m;
+    crumbs_retry_policy_t p = no_jitter();
+
+    test_init_controller(&ctrl);
+    script_device(&dev, &ctrl);
+    test_msg_create(&m, 0x01, OP_SET, NULL, 0);
+
+    /* Two NACKs, then success. */
+    crumbs_retry_init(&r, &p, NULL, 1u);
+    script_reset();
+    g_write_rc[0] = 2;
+    g_write_rc[1] = 2;
+    TEST_ASSERT_EQ(name, crumbs_retry_send(&r, &dev, &m), 0, "recovered");
+    TEST_ASSERT_EQ(name, g_writes, 3, "three tries");
+    TEST_ASSERT_EQ(name, g_wait_count, 2, "two waits");
+    TEST_ASSERT_EQ(name, g_waits[0], 1000, "first wait");
+    TEST_ASSERT_EQ(name, g_waits[1], 2000, "doubled");
+    TEST_ASSERT_EQ(name, r.retries, 2, "retries counted");
+    TEST_ASSERT_EQ(name, r.nack_failures, 2, "NACKs counted");
+
+    /* Always failing: gives up after max_attempts, capped waits. */
+    p.max_attempts = 4u;
+    p.backoff_max_us = 1500u;
+    crumbs_retry_init(&r, &p, NULL, 1u);
+    script_reset();
+    for (int i = 0; i < 8; i++)
+        g_write_rc[i] = 3;
+    TEST_ASSERT_EQ(name, crumbs_retry_send(&r, &dev, &m), 3, "last error");
+    TEST_ASSERT_EQ(name, g_writes, 4, "max_attempts");
+    TEST_ASSERT_EQ(name, g_wait_count, 3, "no wait after the last try");
+    TEST_ASSERT_EQ(name, g_waits[1], 1500, "capped");
+    TEST_ASSERT_EQ(name, g_waits[2], 1500, "stays capped");
+
+    /* Jitter only ever shortens a wait, and a seed replays it. */
+    p = no_jitter();
+    p.jitter_pct = 50u;
+    uint32_t first[2];
+    for (int run = 0; run < 2; run++)
+    {
+        crumbs_retry_init(&r, &p, NULL, 42u);
+        script_reset();
+        g_write_rc[0] = 2;
+        g_write_rc[1] = 2;
+        crumbs_retry_send(&r, &dev, &m);
+        TEST_ASSERT(name, g_waits[0] >= 500u && g_waits[0] <= 1000u, "within 50%");
+        TEST_ASSERT(name, g_waits[1] >= 1000u && g_waits[1] <= 2000u, "within 50%");
+        if (run == 0)
+        {
+            first[0] = g_waits[0];
+            first[1] = g_waits[1];
+        }
+    }
+    TEST_ASSERT_EQ(name, g_waits[0], first[0], "reproducible");
+    TEST_ASSERT_EQ(name, g_waits[1], first[1], "reproducible");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_crc_budget(void)
+{
+    const char *name = "CRC failures retry at once";
+    crumbs_context_t ctrl;
+    crumbs_device_t dev;
+    crumbs_retry_t r;
+    crumbs_message_t out;
+    crumbs_retry_policy_t p = no_jitter();
+
+    test_init_controller(&ctrl);
+    script_device(&dev, &ctrl);
+    test_msg_create(&g_reply, 0x01, OP_TEMP, NULL, 0);
+
+    crumbs_retry_init(&r, &p, NULL, 1u);
+    script_reset();
+    g_read_bad[0] = 1u;
+    g_read_bad[1] = 1u;
+    TEST_ASSERT_EQ(name, crumbs_retry_get(&r, &dev, OP_TEMP, &out), 0, "third read good");
+    TEST_ASSERT_EQ(name, g_reads, 3, "three reads");
+    TEST_ASSERT_EQ(name, g_writes, 3, "SET_REPLY before each");
+    TEST_ASSERT_EQ(name, g_wait_count, 0, "no backoff");
+    TEST_ASSERT_EQ(name, r.crc_failures, 2, "CRC counted");
+    TEST_ASSERT_EQ(name, r.nack_failures, 0, "not as NACKs");
+
+    /* The CRC budget runs out on its own. */
+    p.crc_attempts = 2u;
+    crumbs_retry_init(&r, &p, NULL, 1u);
+    script_reset();
+    memset(g_read_bad, 1, sizeof(g_read_bad));
+    TEST_ASSERT_EQ(name, crumbs_retry_get(&r, &dev, OP_TEMP, &out), -2, "CRC error");
+    TEST_ASSERT_EQ(name, g_reads, 2, "crc_attempts");
+
+    /* A stale reply for another opcode is retried like a NACK. */
+    crumbs_retry_init(&r, &p, NULL, 1u);
+    script_reset();
+    TEST_ASSERT(name, crumbs_retry_get(&r, &dev, OP_SET, &out) != 0, "wrong opcode");
+    TEST_ASSERT_EQ(name, r.nack_failures, 3, "NACK class");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_breaker(void)
+{
+    const char *name = "dead device is quarantined and probed";
+    static crumbs_vbus_t bus;
+    static crumbs_context_t periph;
+    crumbs_context_t ctrl;
+    crumbs_device_t dev;
+    crumbs_retry_t r;
+    crumbs_message_t m;
+    crumbs_retry_policy_t p = no_jitter();
+
+    test_init_controller(&ctrl);
+    crumbs_vbus_init(&bus, 100000u);
+    crumbs_vbus_use(&bus);
+    crumbs_init(&periph, CRUMBS_ROLE_PERIPHERAL, 0x30);
+    crumbs_vbus_attach(&bus, &periph, 0u, 0u);
+    crumbs_vbus_bind(&bus, &dev, &ctrl, 0x30);
+    crumbs_retry_init(&r, &p, crumbs_vbus_clock_us, 1u);
+    test_msg_create(&m, 0x01, OP_SET, NULL, 0);
+
+    TEST_ASSERT_EQ(name, crumbs_retry_send(&r, &dev, &m), 0, "healthy");
+    TEST_ASSERT_EQ(name, r.breakers[0].failures, 0, "no slot taken");
+
+    crumbs_vbus_device(&bus, 0x30)->online = 0u;
+    for (int i = 0; i < 2; i++)
+    {
+        TEST_ASSERT(name, crumbs_retry_send(&r, &dev, &m) != 0, "fails");
+        TEST_ASSERT_EQ(name, crumbs_breaker_state(&r, 0x30), CRUMBS_BREAKER_CLOSED, "still closed");
+    }
+    TEST_ASSERT(name, crumbs_retry_send(&r, &dev, &m) != 0, "third failure");
+    TEST_ASSERT_EQ(name, crumbs_breaker_state(&r, 0x30), CRUMBS_BREAKER_OPEN, "tripped");
+
+    /* Quarantined: no bus time at all. */
+    uint32_t t = crumbs_vbus_now_us(&bus);
+    uint32_t transfers = bus.transfers;
+    for (int i = 0; i < 10; i++)
+        TEST_ASSERT_EQ(name, crumbs_retry_send(&r, &dev, &m), CRUMBS_RETRY_E_OPEN, "rejected");
+    TEST_ASSERT_EQ(name, crumbs_vbus_now_us(&bus), t, "bus untouched");
+    TEST_ASSERT_EQ(name, bus.transfers, transfers, "no transfers");
+    TEST_ASSERT_EQ(name, r.rejected, 10, "counted");
+
+    /* A due probe is a single attempt; failing keeps it open. */
+    crumbs_vbus_advance_us(&bus, p.probe_interval_us);
+    transfers = bus.transfers;
+    TEST_ASSERT(name, crumbs_retry_send(&r, &dev, &m) != 0, "probe fails");
+    TEST_ASSERT_EQ(name, bus.transfers - transfers, 1, "one probe");
+    TEST_ASSERT_EQ(name, crumbs_breaker_state(&r, 0x30), CRUMBS_BREAKER_OPEN, "reopened");
+    TEST_ASSERT_EQ(name, crumbs_retry_send(&r, &dev, &m), CRUMBS_RETRY_E_OPEN, "wait again");
+
+    /* Plugged back in: the next probe closes it. */
+    crumbs_vbus_device(&bus, 0x30)->online = 1u;
+    crumbs_vbus_advance_us(&bus, p.probe_interval_us);
+    TEST_ASSERT_EQ(name, crumbs_retry_send(&r, &dev, &m), 0, "probe succeeds");
+    TEST_ASSERT_EQ(name, crumbs_breaker_state(&r, 0x30), CRUMBS_BREAKER_CLOSED, "closed");
+    TEST_ASSERT_EQ(name, r.breakers[0].failures, 0, "slot freed");
+
+    /* Manual reset. */
+    crumbs_breaker_report(&r, 0x31, 0);
+    crumbs_breaker_report(&r, 0x31, 0);
+    crumbs_breaker_report(&r, 0x31, 0);
+    TEST_ASSERT_EQ(name, crumbs_breaker_allow(&r, 0x31), 0, "open");
+    crumbs_breaker_reset(&r, 0x31);
+    TEST_ASSERT_EQ(name, crumbs_breaker_allow(&r, 0x31), 1, "reset");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Retry tests:\n");
+
+    failures += test_classify();
+    failures += test_backoff();
+    failures += test_crc_budget();
+    failures += test_breaker();
+
+    if (failures == 0)
+    {
+        printf("All retry tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d retry test(s) failed.\n", failures);
+    return 1;
+}
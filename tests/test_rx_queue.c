@@ -0,0 +1,148 @@
+/*
+ * Tests for deferred dispatch through the receive ring.
+ *
+ * Built with CRUMBS_ENABLE_RX_QUEUE=1 and CRUMBS_RX_QUEUE_DEPTH=4. Frames
+ * are fed through crumbs_peripheral_handle_receive() as a HAL's receive
+ * interrupt would; handlers must only run from crumbs_peripheral_process().
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_message_helpers.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define OP_SET 0x01
+
+static uint8_t g_seen[16];
+static int g_calls;
+
+static void on_set(crumbs_context_t *ctx, uint8_t opcode, const uint8_t *data,
+                   uint8_t data_len, void *user_data)
+{
+    (void)ctx;
+    (void)opcode;
+    (void)user_data;
+    if (data_len == 1u && g_calls < (int)sizeof(g_seen))
+        g_seen[g_calls] = data[0];
+    g_calls++;
+}
+
+static int receive(crumbs_context_t *ctx, uint8_t opcode, uint8_t value)
+{
+    crumbs_message_t m;
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    crumbs_msg_init(&m, 0x01, opcode);
+    crumbs_msg_add_u8(&m, value);
+    size_t n = crumbs_encode_message(&m, frame, sizeof(frame));
+    return crumbs_peripheral_handle_receive(ctx, frame, n);
+}
+
+static void setup(crumbs_context_t *ctx)
+{
+    test_init_peripheral(ctx);
+    crumbs_register_handler(ctx, OP_SET, on_set, NULL);
+    memset(g_seen, 0, sizeof(g_seen));
+    g_calls = 0;
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_deferred_order(void)
+{
+    const char *name = "handlers run from process, in order";
+    crumbs_context_t ctx;
+    crumbs_rx_queue_stats_t st;
+
+    setup(&ctx);
+    TEST_ASSERT_EQ(name, receive(&ctx, OP_SET, 1), 0, "immediate receive");
+    TEST_ASSERT_EQ(name, g_calls, 1, "dispatched at once while disabled");
+
+    TEST_ASSERT_EQ(name, crumbs_set_deferred_dispatch(&ctx, 1), 0, "enable");
+    for (uint8_t v = 2; v <= 4; v++)
+        TEST_ASSERT_EQ(name, receive(&ctx, OP_SET, v), 0, "queued");
+    TEST_ASSERT_EQ(name, g_calls, 1, "no handler in the receive path");
+
+    /* SET_REPLY is applied at once so the next read gets the right reply. */
+    TEST_ASSERT_EQ(name, receive(&ctx, CRUMBS_CMD_SET_REPLY, 0x42), 0, "set reply");
+    TEST_ASSERT_EQ(name, ctx.requested_opcode, 0x42, "requested opcode updated");
+
+    TEST_ASSERT_EQ(name, crumbs_get_rx_queue_stats(&ctx, &st), 0, "stats");
+    TEST_ASSERT_EQ(name, st.pending, 3, "pending");
+
+    TEST_ASSERT_EQ(name, crumbs_peripheral_process(&ctx), 3, "process");
+    TEST_ASSERT_EQ(name, g_calls, 4, "all dispatched");
+    for (int i = 0; i < 4; i++)
+        TEST_ASSERT_EQ(name, g_seen[i], i + 1, "order");
+    TEST_ASSERT_EQ(name, crumbs_peripheral_process(&ctx), 0, "empty");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_overflow(void)
+{
+    const char *name = "overflow and high-water counters";
+    crumbs_context_t ctx;
+    crumbs_rx_queue_stats_t st;
+
+    setup(&ctx);
+    crumbs_set_deferred_dispatch(&ctx, 1);
+
+    /* Wrap the free-running indices a few times around the 4-slot ring. */
+    for (int round = 0; round < 70; round++)
+    {
+        TEST_ASSERT_EQ(name, receive(&ctx, OP_SET, (uint8_t)round), 0, "queued");
+        TEST_ASSERT_EQ(name, receive(&ctx, OP_SET, (uint8_t)round), 0, "queued");
+        TEST_ASSERT_EQ(name, crumbs_peripheral_process(&ctx), 2, "drained");
+    }
+    g_calls = 0;
+
+    for (uint8_t v = 0; v < 6; v++)
+    {
+        int rc = receive(&ctx, OP_SET, v);
+        TEST_ASSERT_EQ(name, rc, v < CRUMBS_RX_QUEUE_DEPTH ? 0 : -3, "full ring drops");
+    }
+    TEST_ASSERT_EQ(name, crumbs_get_rx_queue_stats(&ctx, &st), 0, "stats");
+    TEST_ASSERT_EQ(name, st.pending, CRUMBS_RX_QUEUE_DEPTH, "ring full");
+    TEST_ASSERT_EQ(name, st.high_water, CRUMBS_RX_QUEUE_DEPTH, "high water");
+    TEST_ASSERT_EQ(name, st.overflows, 2, "overflows");
+
+    TEST_ASSERT_EQ(name, crumbs_peripheral_process(&ctx), CRUMBS_RX_QUEUE_DEPTH, "process");
+    for (int i = 0; i < CRUMBS_RX_QUEUE_DEPTH; i++)
+        TEST_ASSERT_EQ(name, g_seen[i], i, "oldest frames kept");
+
+    /* Disabling leaves nothing behind and dispatches inline again. */
+    crumbs_set_deferred_dispatch(&ctx, 0);
+    TEST_ASSERT_EQ(name, receive(&ctx, OP_SET, 9), 0, "inline");
+    TEST_ASSERT_EQ(name, g_calls, CRUMBS_RX_QUEUE_DEPTH + 1, "dispatched inline");
+
+    TEST_ASSERT_EQ(name, crumbs_peripheral_process(NULL), -1, "NULL ctx");
+    TEST_ASSERT_EQ(name, crumbs_get_rx_queue_stats(&ctx, NULL), -1, "NULL out");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Receive queue tests:\n");
+
+    failures += test_deferred_order();
+    failures += test_overflow();
+
+    if (failures == 0)
+    {
+        printf("All receive queue tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d receive queue test(s) failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,203 @@
+/*
+ * Tests for the incremental CRC API and the streaming receive decoder.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+static int g_calls;
+static uint8_t g_last_opcode;
+static uint8_t g_last_len;
+static uint8_t g_last_data[CRUMBS_MAX_PAYLOAD];
+
+static void record_handler(crumbs_context_t *ctx, uint8_t opcode,
+                           const uint8_t *data, uint8_t data_len, void *user_data)
+{
+    (void)ctx;
+    (void)user_data;
+    g_calls++;
+    g_last_opcode = opcode;
+    g_last_len = data_len;
+    memcpy(g_last_data, data, data_len);
+}
+
+static size_t make_frame(uint8_t *buf, uint8_t opcode, uint8_t data_len)
+{
+    crumbs_message_t msg;
+    test_msg_init(&msg, 0x42, opcode);
+    msg.data_len = data_len;
+    for (uint8_t i = 0; i < data_len; i++)
+        msg.data[i] = (uint8_t)(i * 13u + opcode);
+    return test_encode(&msg, buf);
+}
+
+/* Feed a whole buffer, returning the status after the last byte. */
+static int feed_all(crumbs_rx_t *rx, const uint8_t *buf, size_t len)
+{
+    int st = CRUMBS_RX_PENDING;
+    crumbs_rx_reset(rx);
+    for (size_t i = 0; i < len; i++)
+        st = crumbs_rx_feed_byte(rx, buf[i]);
+    return st;
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_incremental_crc(void)
+{
+    const char *name = "incremental crc api";
+    uint8_t buf[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t n = make_frame(buf, 0x10, CRUMBS_MAX_PAYLOAD);
+
+    crumbs_crc8_t crc = crumbs_crc8_init();
+    for (size_t i = 0; i + 1 < n; i++)
+        crc = crumbs_crc8_update(crc, &buf[i], 1);
+    TEST_ASSERT_EQ(name, crumbs_crc8_final(crc), crumbs_crc8(buf, n - 1), "byte-wise crc");
+    TEST_ASSERT_EQ(name, crumbs_crc8_final(crc), buf[n - 1], "frame crc");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_completes_on_last_byte(void)
+{
+    const char *name = "completes on last byte";
+    uint8_t buf[CRUMBS_MESSAGE_MAX_SIZE];
+    crumbs_rx_t rx;
+
+    for (uint8_t dl = 0; dl <= CRUMBS_MAX_PAYLOAD; dl++)
+    {
+        size_t n = make_frame(buf, 0x20, dl);
+        crumbs_rx_reset(&rx);
+        for (size_t i = 0; i < n; i++)
+        {
+            int st = crumbs_rx_feed_byte(&rx, buf[i]);
+            TEST_ASSERT_EQ(name, st, (i + 1 == n) ? CRUMBS_RX_COMPLETE : CRUMBS_RX_PENDING,
+                           "status while feeding");
+        }
+
+        crumbs_frame_view_t sv, bv;
+        TEST_ASSERT_EQ(name, crumbs_rx_view(&rx, &sv), 0, "rx_view");
+        TEST_ASSERT_EQ(name, crumbs_decode_view(buf, n, &bv, NULL), 0, "decode_view");
+        TEST_ASSERT_EQ(name, sv.type_id, bv.type_id, "type_id");
+        TEST_ASSERT_EQ(name, sv.opcode, bv.opcode, "opcode");
+        TEST_ASSERT_EQ(name, sv.data_len, bv.data_len, "data_len");
+        TEST_ASSERT_EQ(name, sv.crc8, bv.crc8, "crc8");
+        TEST_ASSERT(name, sv.data == &rx.buf[3], "view must alias rx buffer");
+        TEST_ASSERT_EQ(name, memcmp(sv.data, bv.data, dl), 0, "payload");
+    }
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_errors(void)
+{
+    const char *name = "errors are detected and sticky";
+    uint8_t buf[CRUMBS_MESSAGE_MAX_SIZE];
+    crumbs_rx_t rx;
+    crumbs_frame_view_t view;
+
+    /* Corrupt payload -> CRC error exactly at the last byte */
+    size_t n = make_frame(buf, 0x30, 5);
+    buf[4] ^= 0x01;
+    TEST_ASSERT_EQ(name, feed_all(&rx, buf, n), CRUMBS_RX_E_CRC, "crc error");
+    TEST_ASSERT_EQ(name, crumbs_rx_feed_byte(&rx, 0x00), CRUMBS_RX_E_CRC, "crc error sticky");
+    TEST_ASSERT_EQ(name, crumbs_rx_view(&rx, &view), -2, "view of crc error");
+
+    /* Oversized data_len rejected at the third byte */
+    const uint8_t bad_len[] = {0x01, 0x02, CRUMBS_MAX_PAYLOAD + 1};
+    TEST_ASSERT_EQ(name, feed_all(&rx, bad_len, sizeof(bad_len)), CRUMBS_RX_E_FRAME, "bad data_len");
+    TEST_ASSERT_EQ(name, rx.len, 3, "no bytes stored after error");
+    TEST_ASSERT_EQ(name, crumbs_rx_view(&rx, &view), -1, "view of framing error");
+
+    /* Incomplete frame */
+    n = make_frame(buf, 0x30, 5);
+    TEST_ASSERT_EQ(name, feed_all(&rx, buf, n - 1), CRUMBS_RX_PENDING, "incomplete");
+    TEST_ASSERT_EQ(name, crumbs_rx_view(&rx, &view), -1, "view of incomplete frame");
+
+    /* Trailing bytes after a complete frame are ignored */
+    TEST_ASSERT_EQ(name, crumbs_rx_feed_byte(&rx, buf[n - 1]), CRUMBS_RX_COMPLETE, "complete");
+    TEST_ASSERT_EQ(name, crumbs_rx_feed_byte(&rx, 0xAA), CRUMBS_RX_COMPLETE, "trailing byte");
+    TEST_ASSERT_SIZE_EQ(name, rx.len, n, "trailing byte not stored");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_handle_rx(void)
+{
+    const char *name = "handle_rx dispatch and stats";
+    uint8_t buf[CRUMBS_MESSAGE_MAX_SIZE];
+    crumbs_context_t ctx;
+    crumbs_rx_t rx;
+
+    test_init_peripheral(&ctx);
+    crumbs_register_handler(&ctx, 0x40, record_handler, NULL);
+    g_calls = 0;
+
+    size_t n = make_frame(buf, 0x40, 6);
+    feed_all(&rx, buf, n);
+    TEST_ASSERT_EQ(name, crumbs_peripheral_handle_rx(&ctx, &rx), 0, "handle_rx");
+    TEST_ASSERT_EQ(name, g_calls, 1, "handler not called");
+    TEST_ASSERT_EQ(name, g_last_opcode, 0x40, "opcode");
+    TEST_ASSERT_EQ(name, g_last_len, 6, "data_len");
+    TEST_ASSERT_EQ(name, memcmp(g_last_data, &buf[3], 6), 0, "payload");
+    TEST_ASSERT_EQ(name, crumbs_last_crc_ok(&ctx), 1, "last_crc_ok");
+
+    /* SET_REPLY is intercepted exactly like handle_receive */
+    crumbs_message_t q;
+    test_msg_init(&q, 0, CRUMBS_CMD_SET_REPLY);
+    q.data_len = 1;
+    q.data[0] = 0x81;
+    n = test_encode(&q, buf);
+    feed_all(&rx, buf, n);
+    TEST_ASSERT_EQ(name, crumbs_peripheral_handle_rx(&ctx, &rx), 0, "SET_REPLY");
+    TEST_ASSERT_EQ(name, ctx.requested_opcode, 0x81, "requested_opcode");
+    TEST_ASSERT_EQ(name, g_calls, 1, "SET_REPLY must not dispatch");
+
+    /* CRC failure counted once, nothing dispatched */
+    n = make_frame(buf, 0x40, 2);
+    buf[n - 1] ^= 0xFF;
+    feed_all(&rx, buf, n);
+    TEST_ASSERT_EQ(name, crumbs_peripheral_handle_rx(&ctx, &rx), -2, "crc error");
+    TEST_ASSERT_EQ(name, crumbs_get_crc_error_count(&ctx), 1u, "crc_error_count");
+    TEST_ASSERT_EQ(name, crumbs_last_crc_ok(&ctx), 0, "last_crc_ok after error");
+    TEST_ASSERT_EQ(name, g_calls, 1, "bad frame dispatched");
+
+    /* Short frame and bad args */
+    feed_all(&rx, buf, 2);
+    TEST_ASSERT_EQ(name, crumbs_peripheral_handle_rx(&ctx, &rx), -1, "short frame");
+    TEST_ASSERT_EQ(name, crumbs_peripheral_handle_rx(&ctx, NULL), -1, "NULL rx");
+    TEST_ASSERT_EQ(name, crumbs_peripheral_handle_rx(NULL, &rx), -1, "NULL ctx");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Streaming receive tests:\n");
+
+    failures += test_incremental_crc();
+    failures += test_completes_on_last_byte();
+    failures += test_errors();
+    failures += test_handle_rx();
+
+    if (failures == 0)
+    {
+        printf("All streaming receive tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d streaming receive test(s) failed.\n", failures);
+    return 1;
+}
@@ -265,6 +265,101 @@ static int test_scan_null_ctx_strict(void)
     return 0;
 }
 
+/* ---- Fast scan ---- */
+
+static int g_reads;
+static int g_combined;
+
+static int fake_ack_scan(void *user_ctx, uint8_t start_addr, uint8_t end_addr, int strict,
+                         uint8_t *found, size_t max_found)
+{
+    size_t n = 0;
+    (void)user_ctx;
+    if (strict)
+        return -1; /* the fast scan must use the address-only probe */
+    for (int addr = start_addr; addr <= end_addr; ++addr)
+    {
+        /* 0x30 ACKs but is not a CRUMBS device. */
+        if ((addr == DEV_A || addr == DEV_B || addr == 0x30) && n < max_found)
+            found[n++] = (uint8_t)addr;
+    }
+    return (int)n;
+}
+
+static int counting_read(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len, uint32_t timeout_us)
+{
+    g_reads++;
+    return fake_read(user_ctx, addr, buffer, len, timeout_us);
+}
+
+static int fake_write_read(void *user_ctx, uint8_t addr, const uint8_t *tx, size_t tx_len,
+                           uint8_t *rx, size_t rx_len, uint32_t timeout_us, int require_repeated_start)
+{
+    g_combined++;
+    if (!require_repeated_start || tx_len != 5 || tx[1] != CRUMBS_CMD_SET_REPLY)
+        return -1;
+    if (addr == DEV_B)
+        return CRUMBS_I2C_DEV_E_NO_REPEATED_START; /* forces the fallback */
+    return fake_read(user_ctx, addr, rx, rx_len, timeout_us);
+}
+
+static int test_scan_fast(void)
+{
+    crumbs_context_t ctx;
+    crumbs_init(&ctx, CRUMBS_ROLE_CONTROLLER, 0);
+    uint8_t found[16];
+    uint8_t types[16];
+
+    g_reads = 0;
+    int n = crumbs_controller_scan_for_crumbs_fast(&ctx, 0x03, 0x77, 1, fake_ack_scan,
+                                                   fake_write, counting_read, NULL, NULL,
+                                                   found, types, sizeof(found), 10000);
+    if (n != 2 || found[0] != DEV_A || found[1] != DEV_B || types[1] != DEV_B)
+    {
+        fprintf(stderr, "scan_fast: expected DEV_A and DEV_B, got n=%d\n", n);
+        return 1;
+    }
+    if (g_reads != 3)
+    {
+        fprintf(stderr, "scan_fast: expected 3 reads (ACKing addresses only), got %d\n", g_reads);
+        return 1;
+    }
+
+    /* Combined probe: DEV_A in one transaction, DEV_B falls back to a read. */
+    g_reads = 0;
+    g_combined = 0;
+    n = crumbs_controller_scan_for_crumbs_fast(&ctx, 0x03, 0x77, 1, fake_ack_scan,
+                                               NULL, counting_read, fake_write_read, NULL,
+                                               found, NULL, sizeof(found), 10000);
+    if (n != 2 || g_combined != 3 || g_reads != 2)
+    {
+        fprintf(stderr, "scan_fast: combined probe n=%d combined=%d reads=%d\n",
+                n, g_combined, g_reads);
+        return 1;
+    }
+
+    /* max_found limits the probe phase too. */
+    g_reads = 0;
+    n = crumbs_controller_scan_for_crumbs_fast(&ctx, 0x03, 0x77, 1, fake_ack_scan,
+                                               NULL, counting_read, NULL, NULL,
+                                               found, NULL, 1, 10000);
+    if (n != 1 || g_reads != 1)
+    {
+        fprintf(stderr, "scan_fast: max_found=1 gave n=%d reads=%d\n", n, g_reads);
+        return 1;
+    }
+
+    if (crumbs_controller_scan_for_crumbs_fast(&ctx, 0x03, 0x77, 1, NULL, NULL, counting_read,
+                                               NULL, NULL, found, NULL, sizeof(found), 0) != -1)
+    {
+        fprintf(stderr, "scan_fast: accepted NULL scan_fn\n");
+        return 1;
+    }
+
+    printf("  scan fast (ACK prefilter): PASS\n");
+    return 0;
+}
+
 int main(void)
 {
     int failures = 0;
@@ -277,6 +372,7 @@ int main(void)
     failures += test_scan_with_types();
     failures += test_scan_with_types_null_types();
     failures += test_scan_null_ctx_strict();
+    failures += test_scan_fast();
 
     if (failures == 0)
     {
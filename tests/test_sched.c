@@ -0,0 +1,234 @@
+/*
+ * Tests for the periodic telemetry scheduler: admission against the
+ * utilization cap, rate-monotonic release order, on-time periodic runs
+ * driven from a simulated clock, and miss accounting when a device
+ * cannot keep up with its period.
+ *
+ * Simulated peripherals answer instantly with the opcode of their last
+ * SET_REPLY; time only advances between polls.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_message_helpers.h"
+#include "crumbs_sched.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define OP_GET_POS 0x10
+#define OP_GET_LED 0x20
+#define SERVO_PERIOD_US 20000u /* 50 Hz */
+#define LED_PERIOD_US 500000u  /* 2 Hz */
+
+static uint8_t g_last_op[128];
+static uint8_t g_write_order[64];
+static int g_writes;
+
+static int sim_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    (void)user_ctx;
+    if (len >= 4u)
+        g_last_op[addr & 0x7Fu] = data[3];
+    if (g_writes < (int)sizeof(g_write_order))
+        g_write_order[g_writes] = addr;
+    g_writes++;
+    return 0;
+}
+
+static int sim_read(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len, uint32_t timeout_us)
+{
+    crumbs_message_t m;
+    (void)user_ctx;
+    (void)timeout_us;
+    crumbs_msg_init(&m, 0x01, g_last_op[addr & 0x7Fu]);
+    crumbs_msg_add_u8(&m, addr);
+    return (int)crumbs_encode_message(&m, buffer, len);
+}
+
+static int g_replies;
+
+static void on_reply(crumbs_sched_task_t *task, int status, const crumbs_message_t *reply)
+{
+    (void)task;
+    if (status == 0 && reply->data_len == 1u)
+        g_replies++;
+}
+
+static void init_dev(crumbs_device_t *dev, crumbs_context_t *ctx, uint8_t addr)
+{
+    memset(dev, 0, sizeof(*dev));
+    dev->ctx = ctx;
+    dev->addr = addr;
+    dev->write_fn = sim_write;
+    dev->read_fn = sim_read;
+}
+
+/* Run the scheduler for @p span_us, sleeping as crumbs_sched_idle_us() suggests. */
+static void run_for(crumbs_sched_t *sched, uint32_t start_us, uint32_t span_us)
+{
+    uint32_t now = start_us;
+    while (now - start_us < span_us)
+    {
+        crumbs_sched_poll(sched, now);
+        uint32_t idle = crumbs_sched_idle_us(sched, now);
+        now += (idle == 0u) ? 1u : (idle > 1000u ? 1000u : idle);
+    }
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_admission(void)
+{
+    const char *name = "admission keeps utilization under the cap";
+    crumbs_context_t ctx;
+    crumbs_engine_t eng;
+    crumbs_sched_t sched;
+    crumbs_device_t devs[20];
+    int admitted = 0;
+
+    test_init_controller(&ctx);
+    crumbs_engine_init(&eng);
+    crumbs_sched_init(&sched, &eng);
+
+    TEST_ASSERT_EQ(name, crumbs_sched_add(&sched, NULL, OP_GET_POS, 4, SERVO_PERIOD_US, 0, NULL, NULL), -1,
+                   "NULL device");
+    init_dev(&devs[0], &ctx, 0x10);
+    TEST_ASSERT_EQ(name, crumbs_sched_add(&sched, &devs[0], OP_GET_POS, 4, 0, 0, NULL, NULL), -1,
+                   "zero period");
+    TEST_ASSERT_EQ(name, crumbs_sched_add(&sched, &devs[0], OP_GET_POS, 4, 1000, 2000, NULL, NULL), -1,
+                   "deadline past period");
+
+    /* 20 servos at 50 Hz do not fit on a 100 kHz bus; admission stops early. */
+    for (int i = 0; i < 20; i++)
+    {
+        init_dev(&devs[i], &ctx, (uint8_t)(0x10 + i));
+        int rc = crumbs_sched_add(&sched, &devs[i], OP_GET_POS, 4, SERVO_PERIOD_US, 0, NULL, NULL);
+        if (rc < 0)
+        {
+            TEST_ASSERT_EQ(name, rc, -2, "over budget");
+            break;
+        }
+        admitted++;
+    }
+    TEST_ASSERT(name, admitted > 0 && admitted < 20, "some admitted, some refused");
+    TEST_ASSERT(name, crumbs_sched_utilization_pct(&sched) <= CRUMBS_SCHED_MAX_UTIL_PCT, "under cap");
+    TEST_ASSERT(name, sched.tasks[0].cost_us > 0u, "cost estimated");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_periodic_runs(void)
+{
+    const char *name = "rate-monotonic periodic runs meet deadlines";
+    crumbs_context_t ctx;
+    crumbs_engine_t eng;
+    crumbs_sched_t sched;
+    crumbs_device_t servo[6];
+    crumbs_device_t led[2];
+
+    test_init_controller(&ctx);
+    crumbs_engine_init(&eng);
+    crumbs_sched_init(&sched, &eng);
+    memset(g_write_order, 0, sizeof(g_write_order));
+    g_writes = 0;
+    g_replies = 0;
+
+    /* LEDs are added first, but the shorter servo period goes first. */
+    for (int i = 0; i < 2; i++)
+    {
+        init_dev(&led[i], &ctx, (uint8_t)(0x40 + i));
+        TEST_ASSERT(name, crumbs_sched_add(&sched, &led[i], OP_GET_LED, 1, LED_PERIOD_US, 0, on_reply, NULL) >= 0,
+                    "add led");
+        sched.tasks[i].req.delay_us = 3000u;
+    }
+    for (int i = 0; i < 6; i++)
+    {
+        init_dev(&servo[i], &ctx, (uint8_t)(0x10 + i));
+        int idx = crumbs_sched_add(&sched, &servo[i], OP_GET_POS, 4, SERVO_PERIOD_US, 5000u, on_reply, NULL);
+        TEST_ASSERT(name, idx >= 0, "add servo");
+        sched.tasks[idx].req.delay_us = 2000u;
+    }
+
+    crumbs_sched_poll(&sched, 0u);
+    TEST_ASSERT_EQ(name, g_writes, 8, "all released at the first poll");
+    for (int i = 0; i < 6; i++)
+        TEST_ASSERT_EQ(name, g_write_order[i], 0x10 + i, "servos first");
+    TEST_ASSERT_EQ(name, g_write_order[6], 0x40, "then leds");
+
+    run_for(&sched, 1u, 1000000u);
+
+    for (int i = 2; i < 8; i++)
+    {
+        const crumbs_sched_task_t *t = &sched.tasks[i];
+        TEST_ASSERT(name, t->runs >= 49u && t->runs <= 51u, "servo ran at 50 Hz");
+        TEST_ASSERT_EQ(name, t->misses, 0, "servo misses");
+        TEST_ASSERT_EQ(name, t->errors, 0, "servo errors");
+        TEST_ASSERT(name, t->max_latency_us <= 5000u, "servo latency within deadline");
+        TEST_ASSERT(name, t->max_jitter_us <= 1000u, "servo released on time");
+    }
+    for (int i = 0; i < 2; i++)
+    {
+        TEST_ASSERT(name, sched.tasks[i].runs >= 2u && sched.tasks[i].runs <= 3u, "led ran at 2 Hz");
+        TEST_ASSERT_EQ(name, sched.tasks[i].misses, 0, "led misses");
+    }
+    TEST_ASSERT(name, g_replies >= 6 * 49 + 2 * 2, "callbacks saw the replies");
+
+    crumbs_sched_reset_stats(&sched);
+    TEST_ASSERT_EQ(name, sched.tasks[2].runs, 0, "stats reset");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_overrun_counts_misses(void)
+{
+    const char *name = "slow device records misses";
+    crumbs_context_t ctx;
+    crumbs_engine_t eng;
+    crumbs_sched_t sched;
+    crumbs_device_t dev;
+
+    test_init_controller(&ctx);
+    crumbs_engine_init(&eng);
+    crumbs_sched_init(&sched, &eng);
+    init_dev(&dev, &ctx, 0x30);
+
+    int idx = crumbs_sched_add(&sched, &dev, OP_GET_POS, 4, SERVO_PERIOD_US, 0, NULL, NULL);
+    TEST_ASSERT_EQ(name, idx, 0, "add");
+    sched.tasks[idx].req.delay_us = 30000u; /* longer than the period */
+
+    run_for(&sched, 0u, 200000u);
+
+    const crumbs_sched_task_t *t = &sched.tasks[idx];
+    TEST_ASSERT(name, t->runs > 0u, "still runs");
+    TEST_ASSERT(name, t->misses >= t->runs, "every run late or skipped");
+    TEST_ASSERT(name, t->max_latency_us >= 30000u, "latency recorded");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Scheduler tests:\n");
+
+    failures += test_admission();
+    failures += test_periodic_runs();
+    failures += test_overrun_counts_misses();
+
+    if (failures == 0)
+    {
+        printf("All scheduler tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d scheduler test(s) failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,205 @@
+/*
+ * Tests for sequence-numbered commands: duplicates dropped, a gap holds
+ * later commands back, sessions start with seq 0 and wrap past 255, and a
+ * controller session reconciles lost and repeated writes on the virtual
+ * bus with one status read. Built with CRUMBS_ENABLE_SEQUENCED=1.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_seq.h"
+#include "crumbs_vbus.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define SERVO_TYPE 0x07
+#define OP_ADD 0x10
+
+static int g_total;
+static int g_calls;
+
+static void on_add(crumbs_context_t *ctx, uint8_t opcode, const uint8_t *data, uint8_t len,
+                   void *user_data)
+{
+    (void)ctx;
+    (void)opcode;
+    (void)user_data;
+    g_calls++;
+    if (len >= 1u)
+    {
+        g_total += data[0];
+    }
+}
+
+static void setup_servo(crumbs_context_t *p)
+{
+    test_init_peripheral(p);
+    crumbs_register_handler(p, OP_ADD, on_add, NULL);
+    g_total = 0;
+    g_calls = 0;
+}
+
+static void send_seq(crumbs_context_t *p, uint8_t seq, uint8_t value)
+{
+    crumbs_message_t m;
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    uint8_t payload[3] = {seq, OP_ADD, value};
+    test_msg_create(&m, SERVO_TYPE, CRUMBS_CMD_SEQUENCED, payload, seq ? 3 : 1);
+    size_t n = test_encode(&m, frame);
+    crumbs_peripheral_handle_receive(p, frame, n);
+}
+
+/* Writes are numbered from 1; the ones in g_drop vanish after reporting
+ * success, the ones in g_ghost arrive but report an error. */
+static unsigned g_writes;
+static unsigned g_drop;
+static unsigned g_ghost;
+
+static int lossy_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    g_writes++;
+    if (g_writes == g_drop)
+    {
+        return 0;
+    }
+    int rc = crumbs_vbus_write(user_ctx, addr, data, len);
+    return (rc == 0 && g_writes == g_ghost) ? -1 : rc;
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_peripheral_order(void)
+{
+    const char *name = "duplicates dropped, gaps held back";
+    crumbs_context_t p;
+    crumbs_seq_status_t st;
+
+    setup_servo(&p);
+    TEST_ASSERT_EQ(name, crumbs_seq_last_applied(&p), -1, "no session");
+    send_seq(&p, 1, 5);
+    TEST_ASSERT_EQ(name, g_calls, 0, "ignored before a session");
+
+    send_seq(&p, 0, 0);
+    TEST_ASSERT_EQ(name, crumbs_seq_last_applied(&p), 0, "session started");
+    send_seq(&p, 1, 5);
+    send_seq(&p, 1, 5);
+    send_seq(&p, 2, 7);
+    TEST_ASSERT_EQ(name, g_total, 12, "repeat applied once");
+
+    send_seq(&p, 4, 100);
+    TEST_ASSERT_EQ(name, g_total, 12, "after a gap: not applied");
+    send_seq(&p, 3, 1);
+    send_seq(&p, 4, 100);
+    TEST_ASSERT_EQ(name, g_total, 113, "gap filled, then applied");
+    send_seq(&p, 2, 7);
+    TEST_ASSERT_EQ(name, g_total, 113, "late repeat dropped");
+
+    TEST_ASSERT_EQ(name, crumbs_seq_get_status(&p, &st), 0, "status");
+    TEST_ASSERT_EQ(name, st.last, 4, "last");
+    TEST_ASSERT_EQ(name, st.applied, 4, "applied");
+    TEST_ASSERT_EQ(name, st.duplicates, 2, "duplicates");
+    TEST_ASSERT_EQ(name, st.rejected, 1, "rejected");
+
+    /* Past 255 the sequence continues at 1. */
+    p.seq_last = 254u;
+    send_seq(&p, 255, 1);
+    send_seq(&p, 1, 1);
+    send_seq(&p, 255, 1);
+    TEST_ASSERT_EQ(name, g_total, 115, "wrap");
+    TEST_ASSERT_EQ(name, crumbs_seq_last_applied(&p), 1, "last after wrap");
+
+    /* A new session forgets the old one. */
+    send_seq(&p, 0, 0);
+    send_seq(&p, 1, 1);
+    TEST_ASSERT_EQ(name, g_total, 116, "new session");
+    TEST_ASSERT_EQ(name, crumbs_seq_get_status(&p, &st), 0, "status");
+    TEST_ASSERT_EQ(name, st.duplicates, 0, "counters reset");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_controller_reconcile(void)
+{
+    const char *name = "pipelined session reconciles with one read";
+    crumbs_vbus_t bus;
+    crumbs_context_t p, ctrl;
+    crumbs_device_t dev;
+    crumbs_seq_session_t s;
+    crumbs_message_t m;
+    crumbs_capabilities_t caps;
+
+    crumbs_vbus_init(&bus, 100000u);
+    crumbs_vbus_use(&bus);
+    setup_servo(&p);
+    TEST_ASSERT(name, crumbs_vbus_attach(&bus, &p, 0u, 0u) != NULL, "attach");
+    test_init_controller(&ctrl);
+    crumbs_vbus_bind(&bus, &dev, &ctrl, 0x10);
+    dev.write_fn = lossy_write;
+    dev.io = &bus;
+
+    TEST_ASSERT_EQ(name, crumbs_controller_get_capabilities(&dev, &caps), 0, "caps");
+    TEST_ASSERT(name, (caps.flags & CRUMBS_CAP_SEQUENCED) != 0u, "capability bit");
+
+    g_writes = 0u;
+    TEST_ASSERT_EQ(name, crumbs_seq_begin(&s, &dev), 0, "begin");
+
+    /* Write 2 (seq 1) arrives but reports an error, so its retry is a
+     * repeat. Write 5 (seq 3) is lost, which holds back seq 4 and 5. */
+    g_ghost = 2u;
+    g_drop = 5u;
+    for (uint8_t i = 1; i <= 5; i++)
+    {
+        test_msg_create(&m, SERVO_TYPE, OP_ADD, &i, 1);
+        TEST_ASSERT_EQ(name, crumbs_seq_send(&s, &m), 0, "pipelined send");
+    }
+    TEST_ASSERT_EQ(name, s.pending, 5, "all unconfirmed");
+    TEST_ASSERT_EQ(name, g_total, 3, "applied up to the lost one");
+
+    TEST_ASSERT_EQ(name, crumbs_seq_reconcile(&s), 3, "resent after the gap");
+    TEST_ASSERT_EQ(name, g_total, 15, "each applied exactly once");
+    TEST_ASSERT_EQ(name, crumbs_seq_reconcile(&s), 0, "all confirmed");
+    TEST_ASSERT_EQ(name, s.pending, 0, "window empty");
+
+    /* A full window must be reconciled before more are sent. */
+    g_drop = g_ghost = 0u;
+    for (int i = 0; i < CRUMBS_SEQ_WINDOW; i++)
+    {
+        TEST_ASSERT_EQ(name, crumbs_seq_send(&s, &m), 0, "fill window");
+    }
+    TEST_ASSERT_EQ(name, crumbs_seq_send(&s, &m), -2, "window full");
+    TEST_ASSERT_EQ(name, crumbs_seq_reconcile(&s), 0, "reconcile");
+    TEST_ASSERT_EQ(name, crumbs_seq_send(&s, &m), 0, "room again");
+    m.data_len = CRUMBS_SEQ_MAX_PAYLOAD + 1u;
+    TEST_ASSERT_EQ(name, crumbs_seq_send(&s, &m), -1, "payload too long");
+
+    /* A peripheral that lost its session (rebooted) is reported. */
+    p.seq_active = 0u;
+    TEST_ASSERT_EQ(name, crumbs_seq_reconcile(&s), -4, "session lost");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Sequenced command tests:\n");
+
+    failures += test_peripheral_order();
+    failures += test_controller_reconcile();
+
+    if (failures == 0)
+    {
+        printf("All sequenced command tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d sequenced command test(s) failed.\n", failures);
+    return 1;
+}
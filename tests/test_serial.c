@@ -0,0 +1,409 @@
+/*
+ * Tests for the serial transport: COBS vectors, resynchronization and
+ * error counting on the receive ring, a controller and two multidrop
+ * peripherals exchanging frames through byte pipes, and (on Linux) the
+ * termios port over a pseudo-terminal with the peripheral in a child
+ * process.
+ */
+
+#if defined(__linux__) && !defined(_XOPEN_SOURCE)
+#define _XOPEN_SOURCE 700 /* posix_openpt, grantpt, ptsname */
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_serial.h"
+#include "crumbs_transport.h"
+#include "test_common.h"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "crumbs_linux_serial.h"
+#endif
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define OP_SET 0x01
+#define OP_VALUE 0x40
+
+/* One direction of a serial line. */
+typedef struct
+{
+    uint8_t buf[512];
+    size_t len;
+    size_t pos;
+} pipe_t;
+
+static pipe_t g_up;                  /* peripherals -> controller */
+static crumbs_serial_port_t g_ports[2];
+static crumbs_context_t g_periph[2];
+static uint8_t g_set_value[2];
+static int g_set_calls[2];
+
+static void pipe_reset(pipe_t *p)
+{
+    p->len = 0u;
+    p->pos = 0u;
+}
+
+/* Controller write: every device on the line hears it (ISR path). A
+ * device write reaches the controller and the other device. */
+static int bus_write(void *user, const uint8_t *data, size_t len)
+{
+    (void)user;
+    for (int i = 0; i < 2; i++)
+    {
+        crumbs_serial_rx_push(&g_ports[i], data, len);
+    }
+    return 0;
+}
+
+/* Controller read: let the devices run, then hand over what they sent. */
+static int bus_read(void *user, uint8_t *buf, size_t len, uint32_t timeout_us)
+{
+    (void)user;
+    (void)timeout_us;
+    for (int i = 0; i < 2; i++)
+    {
+        crumbs_serial_peripheral_poll(&g_periph[i], &g_ports[i]);
+    }
+    size_t n = g_up.len - g_up.pos;
+    if (n > len)
+    {
+        n = len;
+    }
+    memcpy(buf, &g_up.buf[g_up.pos], n);
+    g_up.pos += n;
+    return (int)n;
+}
+
+static int device_write(void *user, const uint8_t *data, size_t len)
+{
+    crumbs_serial_rx_push(&g_ports[1 - (int)(intptr_t)user], data, len);
+    if (g_up.len + len > sizeof(g_up.buf))
+    {
+        return -1;
+    }
+    memcpy(&g_up.buf[g_up.len], data, len);
+    g_up.len += len;
+    return 0;
+}
+
+static void on_set(crumbs_context_t *ctx, uint8_t opcode, const uint8_t *data, uint8_t len,
+                   void *user_data)
+{
+    int i = (int)(intptr_t)user_data;
+    (void)ctx;
+    (void)opcode;
+    g_set_calls[i]++;
+    g_set_value[i] = (len > 0u) ? data[0] : 0u;
+}
+
+static void reply_value(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    int i = (int)(intptr_t)user_data;
+    reply->type_id = 0x09;
+    reply->opcode = OP_VALUE;
+    reply->data_len = 2u;
+    reply->data[0] = ctx->address;
+    reply->data[1] = g_set_value[i];
+}
+
+static void setup_line(crumbs_context_t *ctrl, crumbs_serial_port_t *cport)
+{
+    pipe_reset(&g_up);
+    for (int i = 0; i < 2; i++)
+    {
+        crumbs_init(&g_periph[i], CRUMBS_ROLE_PERIPHERAL, (uint8_t)(0x20 + i));
+        crumbs_register_handler(&g_periph[i], OP_SET, on_set, (void *)(intptr_t)i);
+        crumbs_register_reply_handler(&g_periph[i], OP_VALUE, reply_value, (void *)(intptr_t)i);
+        crumbs_serial_init(&g_ports[i], device_write, NULL, (void *)(intptr_t)i);
+        g_set_calls[i] = 0;
+        g_set_value[i] = 0u;
+    }
+    test_init_controller(ctrl);
+    crumbs_serial_init(cport, bus_write, bus_read, NULL);
+    crumbs_set_transport(ctrl, &crumbs_serial_transport, cport);
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_cobs(void)
+{
+    const char *name = "COBS vectors and limits";
+    const uint8_t a[] = {0x00};
+    const uint8_t a_enc[] = {0x01, 0x01};
+    const uint8_t b[] = {0x11, 0x22, 0x00, 0x33};
+    const uint8_t b_enc[] = {0x03, 0x11, 0x22, 0x02, 0x33};
+    const uint8_t c[] = {0x11, 0x00, 0x00, 0x00};
+    const uint8_t c_enc[] = {0x02, 0x11, 0x01, 0x01, 0x01};
+    uint8_t run[254];
+    uint8_t enc[300];
+    uint8_t dec[300];
+    size_t n;
+
+    n = crumbs_cobs_encode(a, sizeof(a), enc, sizeof(enc));
+    TEST_ASSERT(name, n == sizeof(a_enc) && memcmp(enc, a_enc, n) == 0, "single zero");
+    n = crumbs_cobs_encode(b, sizeof(b), enc, sizeof(enc));
+    TEST_ASSERT(name, n == sizeof(b_enc) && memcmp(enc, b_enc, n) == 0, "embedded zero");
+    n = crumbs_cobs_encode(c, sizeof(c), enc, sizeof(enc));
+    TEST_ASSERT(name, n == sizeof(c_enc) && memcmp(enc, c_enc, n) == 0, "trailing zeros");
+    TEST_ASSERT_EQ(name, crumbs_cobs_decode(c_enc, sizeof(c_enc), dec, sizeof(dec)), 4, "decode");
+    TEST_ASSERT(name, memcmp(dec, c, sizeof(c)) == 0, "decoded bytes");
+
+    /* A full 254-byte run needs one extra block code. */
+    for (size_t i = 0; i < sizeof(run); i++)
+    {
+        run[i] = (uint8_t)(i + 1u);
+    }
+    n = crumbs_cobs_encode(run, sizeof(run), enc, sizeof(enc));
+    TEST_ASSERT_EQ(name, (int)n, 256, "long run");
+    TEST_ASSERT_EQ(name, enc[0], 0xFF, "max code");
+    for (size_t i = 0; i < n; i++)
+    {
+        TEST_ASSERT(name, enc[i] != 0u, "no zero in output");
+    }
+    TEST_ASSERT_EQ(name, crumbs_cobs_decode(enc, n, dec, sizeof(dec)), 254, "long decode");
+    TEST_ASSERT(name, memcmp(dec, run, sizeof(run)) == 0, "long bytes");
+
+    TEST_ASSERT_EQ(name, (int)crumbs_cobs_encode(b, sizeof(b), enc, 4u), 0, "small output");
+    TEST_ASSERT_EQ(name, crumbs_cobs_decode(b_enc, sizeof(b_enc), dec, 3u), -1, "small decode");
+    TEST_ASSERT_EQ(name, crumbs_cobs_decode((const uint8_t *)"\x03\x11", 2u, dec, sizeof(dec)), -1,
+                   "truncated");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_ring(void)
+{
+    const char *name = "receive ring resynchronizes";
+    crumbs_serial_port_t port, tx;
+    crumbs_message_t m;
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    uint8_t body[CRUMBS_MESSAGE_MAX_SIZE];
+    uint8_t addr;
+    size_t len, flen;
+    uint8_t payload[3] = {0x00, 0x7F, 0x00};
+    uint8_t noise[5] = {0x55, 0x00, 0x12, 0x34, 0x56};
+    uint8_t junk[40];
+
+    /* Capture what a port writes, then feed it to another port's ring. */
+    crumbs_serial_init(&port, NULL, NULL, NULL);
+    crumbs_serial_init(&tx, device_write, NULL, (void *)(intptr_t)1);
+    pipe_reset(&g_up);
+    test_msg_create(&m, 0x09, OP_SET, payload, 3);
+    flen = test_encode(&m, frame);
+    TEST_ASSERT_EQ(name, crumbs_serial_send_packet(&tx, 0x21, frame, flen), 0, "send");
+    TEST_ASSERT(name, memchr(&g_up.buf[1], 0, g_up.len - 2u) == NULL, "no zero inside");
+    TEST_ASSERT_EQ(name, g_up.buf[g_up.len - 1u], 0, "delimiter");
+
+    /* Noise, then the packet one byte at a time (per-byte ISR). */
+    crumbs_serial_rx_push(&port, noise, sizeof(noise));
+    for (size_t i = 0; i < g_up.len; i++)
+    {
+        crumbs_serial_rx_push(&port, &g_up.buf[i], 1u);
+    }
+    TEST_ASSERT_EQ(name, crumbs_serial_next_packet(&port, &addr, body, &len), 1, "packet");
+    TEST_ASSERT_EQ(name, addr, 0x21, "address");
+    TEST_ASSERT(name, len == flen && memcmp(body, frame, flen) == 0, "frame");
+    TEST_ASSERT_EQ(name, crumbs_serial_next_packet(&port, &addr, body, &len), 0, "nothing more");
+    TEST_ASSERT_EQ(name, (int)port.rx_errors, 2, "noise counted");
+    TEST_ASSERT_EQ(name, (int)port.rx_packets, 1, "one packet");
+
+    /* An over-long packet is dropped as a whole (DMA-sized push). */
+    memset(junk, 0x01, sizeof(junk));
+    junk[sizeof(junk) - 1u] = 0u;
+    crumbs_serial_rx_push(&port, junk, sizeof(junk));
+    crumbs_serial_rx_push(&port, g_up.buf, g_up.len);
+    TEST_ASSERT_EQ(name, crumbs_serial_next_packet(&port, &addr, body, &len), 1, "after overflow");
+    TEST_ASSERT_EQ(name, (int)port.rx_errors, 3, "overflow counted");
+
+    /* Bytes beyond the ring are lost and counted. */
+    uint8_t fill[CRUMBS_SERIAL_RX_RING + 10u];
+    memset(fill, 0x01, sizeof(fill));
+    TEST_ASSERT_EQ(name, (int)crumbs_serial_rx_push(&port, fill, sizeof(fill)),
+                   CRUMBS_SERIAL_RX_RING - 1, "ring capacity");
+    TEST_ASSERT_EQ(name, (int)port.rx_overruns, 11, "overruns");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_multidrop(void)
+{
+    const char *name = "controller and two devices on one line";
+    crumbs_context_t ctrl;
+    crumbs_serial_port_t cport;
+    crumbs_device_t dev0, dev1;
+    crumbs_message_t m, r;
+    uint8_t v = 0x5A;
+
+    setup_line(&ctrl, &cport);
+    TEST_ASSERT_EQ(name, crumbs_device_init(&dev0, &ctrl, 0x20, NULL), 0, "dev0");
+    TEST_ASSERT_EQ(name, crumbs_device_init(&dev1, &ctrl, 0x21, NULL), 0, "dev1");
+
+    /* A write reaches only its device. */
+    test_msg_create(&m, 0x09, OP_SET, &v, 1);
+    TEST_ASSERT_EQ(name, crumbs_transport_send(&ctrl, 0x21, &m), 0, "send");
+    crumbs_serial_peripheral_poll(&g_periph[0], &g_ports[0]);
+    crumbs_serial_peripheral_poll(&g_periph[1], &g_ports[1]);
+    TEST_ASSERT_EQ(name, g_set_calls[0], 0, "other device ignores");
+    TEST_ASSERT_EQ(name, g_set_calls[1], 1, "addressed device");
+    TEST_ASSERT_EQ(name, g_set_value[1], 0x5A, "value");
+
+    /* Queries use the combined request; each device answers for itself.
+     * Device 1's reply passes device 0's port, which must ignore it. */
+    TEST_ASSERT_EQ(name, crumbs_device_query(&dev1, OP_VALUE, &r, 2u), 0, "query 1");
+    TEST_ASSERT_EQ(name, r.data[0], 0x21, "reply from 1");
+    TEST_ASSERT_EQ(name, r.data[1], 0x5A, "state of 1");
+    TEST_ASSERT_EQ(name, crumbs_device_query(&dev0, OP_VALUE, &r, 2u), 0, "query 0");
+    TEST_ASSERT_EQ(name, r.data[0], 0x20, "reply from 0");
+
+    /* The plain controller read path works the same way. */
+    uint8_t op = OP_VALUE;
+    test_msg_create(&m, 0x00, CRUMBS_CMD_SET_REPLY, &op, 1);
+    crumbs_controller_send(&ctrl, 0x21, &m, dev1.write_fn, dev1.io);
+    TEST_ASSERT_EQ(name, crumbs_controller_read(&ctrl, 0x21, &r, dev1.read_fn, dev1.io), 0, "read");
+    TEST_ASSERT_EQ(name, r.opcode, OP_VALUE, "read opcode");
+
+    /* Broadcast only reaches ports with general_call. */
+    g_ports[0].general_call = 1u;
+    v = 0x33;
+    test_msg_create(&m, 0x09, OP_SET, &v, 1);
+    TEST_ASSERT_EQ(name, crumbs_transport_send(&ctrl, 0x00, &m), 0, "broadcast");
+    crumbs_serial_peripheral_poll(&g_periph[0], &g_ports[0]);
+    crumbs_serial_peripheral_poll(&g_periph[1], &g_ports[1]);
+    TEST_ASSERT_EQ(name, g_set_value[0], 0x33, "general call on");
+    TEST_ASSERT_EQ(name, g_set_calls[1], 1, "general call off");
+
+    /* Nobody at 0x30: the read times out instead of blocking. */
+    TEST_ASSERT(name, crumbs_controller_read(&ctrl, 0x30, &r, crumbs_serial_read, &cport) != 0,
+                "absent device");
+    TEST_ASSERT_EQ(name, crumbs_serial_write(&cport, 0x90, m.data, 1u), -1, "flagged address");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+#if defined(__linux__)
+static int pty_write(void *user, const uint8_t *data, size_t len)
+{
+    return (write(*(int *)user, data, len) == (ssize_t)len) ? 0 : -1;
+}
+
+static int pty_read(void *user, uint8_t *buf, size_t len, uint32_t timeout_us)
+{
+    struct pollfd pfd = {*(int *)user, POLLIN, 0};
+    if (poll(&pfd, 1, (int)(timeout_us / 1000u)) <= 0)
+    {
+        return 0;
+    }
+    ssize_t n = read(*(int *)user, buf, len);
+    return (n < 0) ? 0 : (int)n;
+}
+
+/* Child: serve one device on the pty master until the line stays idle. */
+static int pty_peripheral(int master)
+{
+    crumbs_serial_port_t port;
+    int idle = 0;
+
+    g_set_calls[1] = 0;
+    crumbs_init(&g_periph[1], CRUMBS_ROLE_PERIPHERAL, 0x21);
+    crumbs_register_handler(&g_periph[1], OP_SET, on_set, (void *)(intptr_t)1);
+    crumbs_register_reply_handler(&g_periph[1], OP_VALUE, reply_value, (void *)(intptr_t)1);
+    crumbs_serial_init(&port, pty_write, pty_read, &master);
+    while (idle < 5)
+    {
+        uint8_t b[64];
+        int n = pty_read(&master, b, sizeof(b), 100000u);
+        if (n <= 0)
+        {
+            idle++;
+            continue;
+        }
+        idle = 0;
+        crumbs_serial_rx_push(&port, b, (size_t)n);
+        crumbs_serial_peripheral_poll(&g_periph[1], &port);
+    }
+    return g_set_calls[1] == 1 ? 0 : 1;
+}
+
+static int test_linux_pty(void)
+{
+    const char *name = "termios port over a pseudo-terminal";
+    crumbs_linux_serial_t tty;
+    crumbs_serial_port_t port;
+    crumbs_context_t ctrl;
+    crumbs_device_t dev;
+    crumbs_message_t m, r;
+    uint8_t v = 0x77;
+    int status = -1;
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+    {
+        printf("  %s: SKIP (no pty)\n", name);
+        return 0;
+    }
+    TEST_ASSERT_EQ(name, crumbs_linux_serial_open(&tty, "/dev/null", 1234u, 0), -1, "bad rate");
+    TEST_ASSERT_EQ(name, crumbs_linux_serial_init_controller(&ctrl, &port, &tty, ptsname(master),
+                                                             3000000u, 0), 0, "open");
+    TEST_ASSERT(name, ctrl.transport == &crumbs_serial_transport, "transport");
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        crumbs_linux_serial_close(&tty);
+        _exit(pty_peripheral(master));
+    }
+    TEST_ASSERT(name, pid > 0, "fork");
+
+    port.timeout_us = 500000u;
+    crumbs_device_init(&dev, &ctrl, 0x21, NULL);
+    test_msg_create(&m, 0x09, OP_SET, &v, 1);
+    TEST_ASSERT_EQ(name, crumbs_transport_send(&ctrl, 0x21, &m), 0, "send");
+    TEST_ASSERT_EQ(name, crumbs_device_query(&dev, OP_VALUE, &r, 2u), 0, "query");
+    TEST_ASSERT_EQ(name, r.data[0], 0x21, "reply address");
+    TEST_ASSERT_EQ(name, r.data[1], 0x77, "device state");
+
+    waitpid(pid, &status, 0);
+    TEST_ASSERT(name, WIFEXITED(status) && WEXITSTATUS(status) == 0, "child saw one write");
+    crumbs_linux_serial_close(&tty);
+    close(master);
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+#endif
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Serial transport tests:\n");
+
+    failures += test_cobs();
+    failures += test_ring();
+    failures += test_multidrop();
+#if defined(__linux__)
+    failures += test_linux_pty();
+#endif
+
+    if (failures == 0)
+    {
+        printf("All serial transport tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d serial transport test(s) failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,277 @@
+/*
+ * Tests for staged commands: latched opcodes held until COMMIT, commit
+ * groups, overflow and discard, and the controller transaction committed
+ * by broadcast on the virtual bus. Built with CRUMBS_ENABLE_STAGING=1 and
+ * CRUMBS_ENABLE_BROADCAST=1.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_stage.h"
+#include "crumbs_vbus.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define SERVO_TYPE 0x02
+#define OP_SET_POS 0x10
+#define OP_PING 0x11
+#define RIG 8
+
+static crumbs_vbus_t g_bus;
+static crumbs_context_t g_servo[RIG];
+static crumbs_device_t g_dev[RIG];
+static uint32_t g_applied_us[RIG];
+static uint8_t g_pos[RIG];
+static int g_calls;
+
+static void on_set_pos(crumbs_context_t *ctx, uint8_t opcode, const uint8_t *data,
+                       uint8_t data_len, void *user_data)
+{
+    (void)opcode;
+    (void)user_data;
+    int i = ctx->address - 0x20;
+    g_calls++;
+    g_applied_us[i] = crumbs_vbus_now_us(&g_bus);
+    g_pos[i] = data_len ? data[0] : 0u;
+}
+
+static void setup_rig(int latched)
+{
+    crumbs_vbus_init(&g_bus, 100000u);
+    crumbs_vbus_use(&g_bus);
+    g_calls = 0;
+    for (int i = 0; i < RIG; i++)
+    {
+        crumbs_init(&g_servo[i], CRUMBS_ROLE_PERIPHERAL, (uint8_t)(0x20 + i));
+        crumbs_register_handler(&g_servo[i], OP_SET_POS, on_set_pos, NULL);
+        crumbs_set_latched(&g_servo[i], OP_SET_POS, latched);
+        crumbs_peripheral_set_broadcast(&g_servo[i], 1, SERVO_TYPE);
+        crumbs_vbus_attach(&g_bus, &g_servo[i], 0u, 0u)->general_call = 1u;
+        g_applied_us[i] = 0u;
+        g_pos[i] = 0u;
+    }
+}
+
+static void set_pos(crumbs_message_t *m, uint8_t pos)
+{
+    test_msg_create(m, SERVO_TYPE, OP_SET_POS, &pos, 1);
+}
+
+static size_t encode_commit(uint8_t *frame, uint8_t group, int discard)
+{
+    crumbs_message_t m;
+    uint8_t payload[2] = {group, CRUMBS_COMMIT_DISCARD};
+    test_msg_create(&m, 0x00, CRUMBS_CMD_COMMIT, payload, discard ? 2 : 1);
+    return test_encode(&m, frame);
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_latch_and_commit(void)
+{
+    const char *name = "latched opcodes wait for COMMIT";
+    crumbs_context_t p;
+    crumbs_message_t m;
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t len;
+
+    test_init_peripheral(&p);
+    crumbs_register_handler(&p, OP_SET_POS, on_set_pos, NULL);
+    crumbs_register_handler(&p, OP_PING, on_set_pos, NULL);
+    p.address = 0x20;
+    g_calls = 0;
+
+    TEST_ASSERT_EQ(name, crumbs_peripheral_capabilities(&p) & CRUMBS_CAP_STAGING, 0, "no cap yet");
+    TEST_ASSERT(name, crumbs_set_latched(&p, CRUMBS_CMD_COMMIT, 1) != 0, "extension rejected");
+    TEST_ASSERT_EQ(name, crumbs_set_latched(&p, OP_SET_POS, 1), 0, "latch");
+    TEST_ASSERT(name, crumbs_peripheral_capabilities(&p) & CRUMBS_CAP_STAGING, "cap");
+
+    set_pos(&m, 10);
+    len = test_encode(&m, frame);
+    crumbs_peripheral_handle_receive(&p, frame, len);
+    set_pos(&m, 20);
+    len = test_encode(&m, frame);
+    crumbs_peripheral_handle_receive(&p, frame, len);
+    TEST_ASSERT_EQ(name, g_calls, 0, "held");
+    TEST_ASSERT_EQ(name, crumbs_stage_pending(&p), 2, "two staged");
+
+    /* Other opcodes still run at once. */
+    test_msg_create(&m, SERVO_TYPE, OP_PING, NULL, 0);
+    len = test_encode(&m, frame);
+    crumbs_peripheral_handle_receive(&p, frame, len);
+    TEST_ASSERT_EQ(name, g_calls, 1, "immediate opcode");
+
+    len = encode_commit(frame, 0, 0);
+    crumbs_peripheral_handle_receive(&p, frame, len);
+    TEST_ASSERT_EQ(name, g_calls, 3, "both applied");
+    TEST_ASSERT_EQ(name, g_pos[0], 20, "in arrival order");
+    TEST_ASSERT_EQ(name, crumbs_stage_pending(&p), 0, "stage empty");
+
+    /* Discard drops without applying. */
+    set_pos(&m, 30);
+    len = test_encode(&m, frame);
+    crumbs_peripheral_handle_receive(&p, frame, len);
+    len = encode_commit(frame, 0, 1);
+    crumbs_peripheral_handle_receive(&p, frame, len);
+    TEST_ASSERT_EQ(name, crumbs_stage_pending(&p), 0, "discarded");
+    TEST_ASSERT_EQ(name, g_calls, 3, "not applied");
+
+    /* Unlatched again: dispatched on arrival. */
+    crumbs_set_latched(&p, OP_SET_POS, 0);
+    set_pos(&m, 40);
+    len = test_encode(&m, frame);
+    crumbs_peripheral_handle_receive(&p, frame, len);
+    TEST_ASSERT_EQ(name, g_calls, 4, "immediate again");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_groups_and_overflow(void)
+{
+    const char *name = "commit groups and a full stage";
+    crumbs_context_t p;
+    crumbs_message_t m;
+    crumbs_message_t reply;
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t len;
+
+    test_init_peripheral(&p);
+    p.address = 0x20;
+    crumbs_register_handler(&p, OP_SET_POS, on_set_pos, NULL);
+    crumbs_set_latched(&p, OP_SET_POS, 1);
+    crumbs_set_commit_group(&p, 2);
+    g_calls = 0;
+
+    set_pos(&m, 1);
+    len = test_encode(&m, frame);
+    crumbs_peripheral_handle_receive(&p, frame, len);
+    len = encode_commit(frame, 3, 0);
+    crumbs_peripheral_handle_receive(&p, frame, len);
+    TEST_ASSERT_EQ(name, g_calls, 0, "other group ignored");
+    len = encode_commit(frame, 2, 0);
+    crumbs_peripheral_handle_receive(&p, frame, len);
+    TEST_ASSERT_EQ(name, g_calls, 1, "own group applies");
+
+    /* One more than the stage holds: the whole update is dropped. */
+    for (int i = 0; i <= CRUMBS_STAGE_DEPTH; i++)
+    {
+        set_pos(&m, (uint8_t)i);
+        len = test_encode(&m, frame);
+        crumbs_peripheral_handle_receive(&p, frame, len);
+    }
+    p.requested_opcode = CRUMBS_CMD_COMMIT;
+    TEST_ASSERT_EQ(name, crumbs_peripheral_build_reply(&p, frame, sizeof(frame), &len), 0, "status");
+    TEST_ASSERT_EQ(name, crumbs_decode_message(frame, len, &reply, NULL), 0, "decode");
+    TEST_ASSERT_EQ(name, reply.data[0], CRUMBS_STAGE_DEPTH, "staged");
+    TEST_ASSERT_EQ(name, reply.data[1], 1, "overflow");
+    TEST_ASSERT_EQ(name, reply.data[2], 2, "group");
+
+    len = encode_commit(frame, 0, 0);
+    crumbs_peripheral_handle_receive(&p, frame, len);
+    TEST_ASSERT_EQ(name, g_calls, 1, "nothing half-applied");
+    TEST_ASSERT_EQ(name, crumbs_stage_pending(&p), 0, "cleared");
+
+    /* Local trigger. */
+    set_pos(&m, 9);
+    len = test_encode(&m, frame);
+    crumbs_peripheral_handle_receive(&p, frame, len);
+    TEST_ASSERT_EQ(name, crumbs_stage_apply(&p), 1, "apply");
+    TEST_ASSERT_EQ(name, g_pos[0], 9, "applied");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_rig_transaction(void)
+{
+    const char *name = "rig transaction commits by broadcast";
+    crumbs_context_t ctrl;
+    crumbs_message_t m;
+    crumbs_txn_t txn;
+
+    /* Sequential immediate writes: the last servo moves a whole loop later. */
+    test_init_controller(&ctrl);
+    setup_rig(0);
+    for (int i = 0; i < RIG; i++)
+    {
+        set_pos(&m, (uint8_t)(100 + i));
+        crumbs_controller_send(&ctrl, (uint8_t)(0x20 + i), &m, crumbs_vbus_write, &g_bus);
+    }
+    uint32_t loop_skew = g_applied_us[RIG - 1] - g_applied_us[0];
+    TEST_ASSERT_EQ(name, loop_skew, (RIG - 1) * 560, "skew of the write loop");
+
+    setup_rig(1);
+    for (int i = 0; i < RIG; i++)
+    {
+        crumbs_vbus_bind(&g_bus, &g_dev[i], &ctrl, (uint8_t)(0x20 + i));
+    }
+    crumbs_txn_begin(&txn, 1);
+    for (int i = 0; i < RIG; i++)
+    {
+        set_pos(&m, (uint8_t)(100 + i));
+        TEST_ASSERT_EQ(name, crumbs_txn_stage(&txn, &g_dev[i], &m), 0, "stage");
+    }
+    TEST_ASSERT_EQ(name, g_calls, 0, "nothing moved yet");
+    TEST_ASSERT_EQ(name, crumbs_txn_verify(&txn), 0, "verified");
+    TEST_ASSERT_EQ(name, crumbs_txn_commit(&txn, 1), 0, "commit");
+    TEST_ASSERT_EQ(name, g_calls, RIG, "all applied");
+    for (int i = 0; i < RIG; i++)
+    {
+        TEST_ASSERT_EQ(name, g_applied_us[i], g_applied_us[0], "same instant");
+        TEST_ASSERT_EQ(name, g_pos[i], 100 + i, "own position");
+    }
+
+    /* A device that missed its write aborts the whole transaction. */
+    crumbs_txn_begin(&txn, 1);
+    set_pos(&m, 1);
+    crumbs_txn_stage(&txn, &g_dev[0], &m);
+    crumbs_vbus_device(&g_bus, 0x21)->online = 0u;
+    TEST_ASSERT(name, crumbs_txn_stage(&txn, &g_dev[1], &m) != 0, "stage fails");
+    crumbs_vbus_device(&g_bus, 0x21)->online = 1u;
+    TEST_ASSERT(name, crumbs_txn_commit(&txn, 1) != 0, "commit reports it");
+    TEST_ASSERT_EQ(name, g_calls, RIG, "nothing applied");
+    TEST_ASSERT_EQ(name, crumbs_stage_pending(&g_servo[0]), 0, "aborted");
+
+    /* Leftovers from an earlier update fail verification. */
+    crumbs_controller_send(&ctrl, 0x20, &m, crumbs_vbus_write, &g_bus);
+    crumbs_txn_begin(&txn, 1);
+    crumbs_txn_stage(&txn, &g_dev[0], &m);
+    TEST_ASSERT_EQ(name, crumbs_txn_verify(&txn), -4, "mismatch");
+    TEST_ASSERT_EQ(name, crumbs_txn_commit(&txn, 0), -4, "aborted");
+    TEST_ASSERT_EQ(name, crumbs_stage_pending(&g_servo[0]), 0, "cleared");
+
+    /* Per-device commits without broadcast. */
+    crumbs_txn_begin(&txn, 0);
+    crumbs_txn_stage(&txn, &g_dev[2], &m);
+    crumbs_txn_stage(&txn, &g_dev[3], &m);
+    TEST_ASSERT_EQ(name, crumbs_txn_commit(&txn, 0), 0, "directed commit");
+    TEST_ASSERT_EQ(name, g_calls, RIG + 2, "both applied");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Staging tests:\n");
+
+    failures += test_latch_and_commit();
+    failures += test_groups_and_overflow();
+    failures += test_rig_transaction();
+
+    if (failures == 0)
+    {
+        printf("All staging tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d staging test(s) failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,206 @@
+/*
+ * Unit tests for static (flash-resident) handler tables.
+ *
+ * Built twice by CMake: with the default CRUMBS_MAX_HANDLERS and with
+ * CRUMBS_MAX_HANDLERS=0, where static tables are the only dispatch path.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+static int g_calls;
+static uint8_t g_last_opcode;
+static void *g_last_user;
+
+static void cmd_handler(crumbs_context_t *ctx, uint8_t opcode,
+                        const uint8_t *data, uint8_t data_len, void *user_data)
+{
+    (void)ctx;
+    (void)data;
+    (void)data_len;
+    g_calls++;
+    g_last_opcode = opcode;
+    g_last_user = user_data;
+}
+
+static void reply_a(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)user_data;
+    reply->type_id = 0x20;
+    reply->opcode = ctx->requested_opcode;
+    reply->data_len = 1;
+    reply->data[0] = 0xA1;
+}
+
+static void reply_b(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)user_data;
+    reply->type_id = 0x20;
+    reply->opcode = ctx->requested_opcode;
+    reply->data_len = 1;
+    reply->data[0] = 0xB2;
+}
+
+static int g_user_tag;
+
+CRUMBS_STATIC_HANDLERS(g_cmds,
+                       {0x01, cmd_handler, NULL},
+                       {0x02, cmd_handler, &g_user_tag},
+                       {0x10, cmd_handler, NULL},
+                       {0x7F, cmd_handler, NULL});
+
+CRUMBS_STATIC_REPLY_HANDLERS(g_replies,
+                             {0x00, reply_a, NULL},
+                             {0x80, reply_b, NULL});
+
+CRUMBS_STATIC_HANDLERS(g_unsorted,
+                       {0x05, cmd_handler, NULL},
+                       {0x03, cmd_handler, NULL});
+
+static void send_cmd(crumbs_context_t *ctx, uint8_t opcode)
+{
+    crumbs_message_t msg;
+    uint8_t buf[CRUMBS_MESSAGE_MAX_SIZE];
+    test_msg_init(&msg, 0x20, opcode);
+    size_t n = test_encode(&msg, buf);
+    crumbs_peripheral_handle_receive(ctx, buf, n);
+}
+
+static int get_reply_byte(crumbs_context_t *ctx, uint8_t opcode)
+{
+    uint8_t buf[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t n = 0;
+    crumbs_message_t out;
+    ctx->requested_opcode = opcode;
+    if (crumbs_peripheral_build_reply(ctx, buf, sizeof(buf), &n) != 0 || n == 0)
+        return -1;
+    if (crumbs_decode_message(buf, n, &out, NULL) != 0 || out.data_len != 1)
+        return -1;
+    return out.data[0];
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_static_dispatch(void)
+{
+    const char *name = "static dispatch";
+    crumbs_context_t ctx;
+    test_init_peripheral(&ctx);
+
+    TEST_ASSERT_EQ(name, crumbs_set_static_handlers(&ctx, g_cmds, CRUMBS_STATIC_TABLE_LEN(g_cmds)),
+                   0, "install table");
+
+    static const uint8_t hits[] = {0x01, 0x02, 0x10, 0x7F};
+    for (size_t i = 0; i < sizeof(hits); i++)
+    {
+        g_calls = 0;
+        send_cmd(&ctx, hits[i]);
+        TEST_ASSERT_EQ(name, g_calls, 1, "static handler not called");
+        TEST_ASSERT_EQ(name, g_last_opcode, hits[i], "wrong opcode");
+    }
+
+    send_cmd(&ctx, 0x02);
+    TEST_ASSERT(name, g_last_user == &g_user_tag, "user_data from table");
+
+    static const uint8_t misses[] = {0x00, 0x03, 0x0F, 0x11, 0x80, 0xFF};
+    for (size_t i = 0; i < sizeof(misses); i++)
+    {
+        g_calls = 0;
+        send_cmd(&ctx, misses[i]);
+        TEST_ASSERT_EQ(name, g_calls, 0, "unexpected dispatch");
+    }
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_static_replies(void)
+{
+    const char *name = "static replies";
+    crumbs_context_t ctx;
+    test_init_peripheral(&ctx);
+
+    TEST_ASSERT_EQ(name, crumbs_set_static_reply_handlers(&ctx, g_replies,
+                                                          CRUMBS_STATIC_TABLE_LEN(g_replies)),
+                   0, "install reply table");
+    TEST_ASSERT_EQ(name, get_reply_byte(&ctx, 0x00), 0xA1, "reply 0x00");
+    TEST_ASSERT_EQ(name, get_reply_byte(&ctx, 0x80), 0xB2, "reply 0x80");
+    TEST_ASSERT_EQ(name, get_reply_byte(&ctx, 0x81), -1, "no reply for 0x81");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_rejects_unsorted(void)
+{
+    const char *name = "rejects unsorted";
+    crumbs_context_t ctx;
+    test_init_peripheral(&ctx);
+
+    TEST_ASSERT_EQ(name, crumbs_set_static_handlers(&ctx, g_unsorted,
+                                                    CRUMBS_STATIC_TABLE_LEN(g_unsorted)),
+                   -1, "unsorted table accepted");
+    TEST_ASSERT_NULL(name, ctx.periph.static_handlers, "table installed after rejection");
+    TEST_ASSERT_EQ(name, crumbs_set_static_handlers(NULL, g_cmds, 1), -1, "NULL ctx");
+    TEST_ASSERT_EQ(name, crumbs_set_static_handlers(&ctx, NULL, 2), -1, "NULL table");
+    TEST_ASSERT_EQ(name, crumbs_set_static_handlers(&ctx, NULL, 0), 0, "clear table");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+#if CRUMBS_MAX_HANDLERS > 0
+static int test_runtime_overrides_static(void)
+{
+    const char *name = "runtime overrides static";
+    crumbs_context_t ctx;
+    test_init_peripheral(&ctx);
+    int runtime_tag = 0;
+
+    crumbs_set_static_handlers(&ctx, g_cmds, CRUMBS_STATIC_TABLE_LEN(g_cmds));
+    crumbs_register_handler(&ctx, 0x10, cmd_handler, &runtime_tag);
+
+    send_cmd(&ctx, 0x10);
+    TEST_ASSERT(name, g_last_user == &runtime_tag, "runtime handler should win");
+
+    crumbs_unregister_handler(&ctx, 0x10);
+    send_cmd(&ctx, 0x10);
+    TEST_ASSERT_NULL(name, g_last_user, "static handler after unregister");
+
+    crumbs_set_static_reply_handlers(&ctx, g_replies, CRUMBS_STATIC_TABLE_LEN(g_replies));
+    crumbs_register_reply_handler(&ctx, 0x80, reply_a, NULL);
+    TEST_ASSERT_EQ(name, get_reply_byte(&ctx, 0x80), 0xA1, "runtime reply should win");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+#endif
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Static handler table tests (CRUMBS_MAX_HANDLERS=%d):\n", CRUMBS_MAX_HANDLERS);
+
+    failures += test_static_dispatch();
+    failures += test_static_replies();
+    failures += test_rejects_unsorted();
+#if CRUMBS_MAX_HANDLERS > 0
+    failures += test_runtime_overrides_static();
+#endif
+
+    if (failures == 0)
+    {
+        printf("All static handler tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d static handler test(s) failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,262 @@
+/*
+ * Tests for the statistics block and the STATS extension opcode.
+ *
+ * Built with CRUMBS_ENABLE_STATS=1. A simulated clock only advances when a
+ * handler, reply builder or the simulated bus says so, which makes every
+ * timing exact.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_message_helpers.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define OP_FAST 0x01
+#define OP_SLOW 0x02
+#define OP_GET 0x80
+#define PERIPH_ADDR 0x20
+
+static uint32_t g_now;
+static crumbs_context_t g_periph;
+static uint32_t g_bus_us;
+
+static uint32_t sim_clock(void)
+{
+    return g_now;
+}
+
+static void on_fast(crumbs_context_t *ctx, uint8_t opcode, const uint8_t *data,
+                    uint8_t data_len, void *user_data)
+{
+    (void)ctx;
+    (void)opcode;
+    (void)data;
+    (void)data_len;
+    (void)user_data;
+    g_now += 5u;
+}
+
+static void on_slow(crumbs_context_t *ctx, uint8_t opcode, const uint8_t *data,
+                    uint8_t data_len, void *user_data)
+{
+    (void)ctx;
+    (void)opcode;
+    (void)data;
+    (void)data_len;
+    (void)user_data;
+    g_now += 700u;
+}
+
+static void reply_get(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)user_data;
+    g_now += 40u;
+    crumbs_msg_init(reply, 0x01, ctx->requested_opcode);
+    crumbs_msg_add_u8(reply, 1);
+}
+
+static int sim_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    (void)user_ctx;
+    if (addr != PERIPH_ADDR)
+        return -1;
+    g_now += g_bus_us;
+    return crumbs_peripheral_handle_receive(&g_periph, data, len);
+}
+
+static int sim_read(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len, uint32_t timeout_us)
+{
+    size_t n = 0;
+    (void)user_ctx;
+    (void)timeout_us;
+    if (addr != PERIPH_ADDR || crumbs_peripheral_build_reply(&g_periph, buffer, len, &n) != 0)
+        return -1;
+    g_now += g_bus_us;
+    return (int)n;
+}
+
+static void sim_delay(uint32_t us)
+{
+    g_now += us;
+}
+
+static int send_cmd(crumbs_context_t *ctrl, uint8_t opcode)
+{
+    crumbs_message_t m;
+    crumbs_msg_init(&m, 0x01, opcode);
+    return crumbs_controller_send(ctrl, PERIPH_ADDR, &m, sim_write, NULL);
+}
+
+static void setup(crumbs_context_t *ctrl, crumbs_device_t *dev)
+{
+    test_init_controller(ctrl);
+    crumbs_init(&g_periph, CRUMBS_ROLE_PERIPHERAL, PERIPH_ADDR);
+    crumbs_register_handler(&g_periph, OP_FAST, on_fast, NULL);
+    crumbs_register_handler(&g_periph, OP_SLOW, on_slow, NULL);
+    crumbs_register_reply_handler(&g_periph, OP_GET, reply_get, NULL);
+    crumbs_set_stats_clock(&g_periph, sim_clock);
+    crumbs_set_stats_clock(ctrl, sim_clock);
+    memset(dev, 0, sizeof(*dev));
+    dev->ctx = ctrl;
+    dev->addr = PERIPH_ADDR;
+    dev->write_fn = sim_write;
+    dev->read_fn = sim_read;
+    dev->delay_fn = sim_delay;
+    g_now = 1000u;
+    g_bus_us = 100u;
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_local_counters(void)
+{
+    const char *name = "peripheral counters and handler timings";
+    crumbs_context_t ctrl;
+    crumbs_device_t dev;
+    crumbs_stats_t st;
+    uint8_t bad[8] = {0x01, OP_FAST, 0x01, 0x00, 0x00};
+
+    setup(&ctrl, &dev);
+    for (int i = 0; i < 3; i++)
+        TEST_ASSERT_EQ(name, send_cmd(&ctrl, OP_FAST), 0, "fast");
+    TEST_ASSERT_EQ(name, send_cmd(&ctrl, OP_SLOW), 0, "slow");
+    TEST_ASSERT_EQ(name, send_cmd(&ctrl, 0x33), 0, "unhandled");
+
+    crumbs_peripheral_handle_receive(&g_periph, bad, 3);  /* short */
+    bad[2] = 40;
+    crumbs_peripheral_handle_receive(&g_periph, bad, 8);  /* bad data_len */
+    bad[2] = 1;
+    crumbs_peripheral_handle_receive(&g_periph, bad, 5);  /* bad CRC */
+
+    TEST_ASSERT_EQ(name, crumbs_get_stats(&g_periph, &st), 0, "get");
+    TEST_ASSERT_EQ(name, st.frames_rx, 5, "frames rx");
+    TEST_ASSERT_EQ(name, st.err_short, 1, "short");
+    TEST_ASSERT_EQ(name, st.err_len, 1, "len");
+    TEST_ASSERT_EQ(name, st.err_crc, 1, "crc");
+    TEST_ASSERT_EQ(name, st.unhandled, 1, "unhandled");
+
+    /* 5 us is in the first bucket (< 16), 700 us in the seventh (512..1023). */
+    TEST_ASSERT_EQ(name, st.handler_hist[0], 3, "fast bucket");
+    TEST_ASSERT_EQ(name, st.handler_hist[6], 1, "slow bucket");
+    TEST_ASSERT_EQ(name, st.opcode_count, 2, "opcode entries");
+    TEST_ASSERT_EQ(name, st.opcodes[0].opcode, OP_FAST, "first entry");
+    TEST_ASSERT_EQ(name, st.opcodes[0].calls, 3, "fast calls");
+    TEST_ASSERT_EQ(name, st.opcodes[0].total_us, 15, "fast total");
+    TEST_ASSERT_EQ(name, st.opcodes[1].max_us, 700, "slow max");
+
+    TEST_ASSERT_EQ(name, crumbs_get_stats(&ctrl, &st), 0, "controller");
+    TEST_ASSERT_EQ(name, st.frames_tx, 5, "controller frames tx");
+
+    TEST_ASSERT_EQ(name, crumbs_reset_stats(&g_periph), 0, "reset");
+    crumbs_get_stats(&g_periph, &st);
+    TEST_ASSERT_EQ(name, st.frames_rx, 0, "cleared");
+    TEST_ASSERT_EQ(name, crumbs_get_stats(NULL, &st), -1, "NULL ctx");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_transaction_latency(void)
+{
+    const char *name = "controller latency per address";
+    crumbs_context_t ctrl;
+    crumbs_device_t dev;
+    crumbs_message_t reply;
+    crumbs_stats_t st;
+
+    setup(&ctrl, &dev);
+    TEST_ASSERT(name, crumbs_get_addr_stats(&ctrl, PERIPH_ADDR) == NULL, "no entry yet");
+
+    for (int i = 0; i < 4; i++)
+    {
+        crumbs_message_t m;
+        crumbs_msg_init(&m, 0x00, CRUMBS_CMD_SET_REPLY);
+        crumbs_msg_add_u8(&m, OP_GET);
+        TEST_ASSERT_EQ(name, crumbs_controller_send(&ctrl, PERIPH_ADDR, &m, sim_write, NULL), 0, "set reply");
+        sim_delay(1000u);
+        TEST_ASSERT_EQ(name, crumbs_controller_read(&ctrl, PERIPH_ADDR, &reply, sim_read, NULL), 0, "read");
+    }
+
+    /* write 100 + wait 1000 + reply build 40 + read 100 = 1240 us: [1024, 2048) is bucket 3 at base 256. */
+    const crumbs_addr_stats_t *a = crumbs_get_addr_stats(&ctrl, PERIPH_ADDR);
+    TEST_ASSERT(name, a != NULL, "entry");
+    TEST_ASSERT_EQ(name, a->hist[3], 4, "latency bucket");
+    TEST_ASSERT_EQ(name, a->max_us, 1240, "max latency");
+
+    /* A second read without a new write is not a transaction. */
+    crumbs_controller_read(&ctrl, PERIPH_ADDR, &reply, sim_read, NULL);
+    TEST_ASSERT_EQ(name, a->hist[3], 4, "unchanged");
+
+    crumbs_get_stats(&g_periph, &st);
+    TEST_ASSERT_EQ(name, st.frames_tx, 5, "replies built");
+    TEST_ASSERT_EQ(name, st.reply_hist[2], 5, "reply build bucket");
+    TEST_ASSERT_EQ(name, st.reply_max_us, 40, "reply max");
+    TEST_ASSERT_EQ(name, st.reply_max_opcode, OP_GET, "reply max opcode");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_remote_read(void)
+{
+    const char *name = "read statistics over STATS";
+    crumbs_context_t ctrl;
+    crumbs_device_t dev;
+    crumbs_stats_t local;
+    crumbs_stats_t remote;
+    crumbs_capabilities_t caps;
+
+    setup(&ctrl, &dev);
+    TEST_ASSERT_EQ(name, crumbs_controller_get_capabilities(&dev, &caps), 0, "caps");
+    TEST_ASSERT(name, (caps.flags & CRUMBS_CAP_STATS) != 0u, "advertised");
+
+    /* Five opcodes need three opcode pages. */
+    for (uint8_t op = 0x40; op < 0x45; op++)
+        crumbs_register_handler(&g_periph, op, on_fast, NULL);
+    for (uint8_t op = 0x40; op < 0x45; op++)
+        send_cmd(&ctrl, op);
+    send_cmd(&ctrl, OP_SLOW);
+
+    crumbs_get_stats(&g_periph, &local);
+    TEST_ASSERT_EQ(name, crumbs_controller_get_stats(&dev, &remote), 0, "read");
+    TEST_ASSERT_EQ(name, remote.err_crc, local.err_crc, "crc");
+    TEST_ASSERT_EQ(name, remote.handler_hist[0], 5, "handler hist");
+    TEST_ASSERT_EQ(name, remote.handler_hist[6], 1, "slow hist");
+    TEST_ASSERT_EQ(name, remote.opcode_count, 6, "all opcodes");
+    TEST_ASSERT_EQ(name, remote.opcodes[5].opcode, OP_SLOW, "last opcode");
+    TEST_ASSERT_EQ(name, remote.opcodes[5].max_us, 700, "slow max");
+    TEST_ASSERT(name, remote.frames_rx >= local.frames_rx, "frames");
+
+    TEST_ASSERT_EQ(name, crumbs_controller_reset_stats(&dev), 0, "remote reset");
+    crumbs_get_stats(&g_periph, &local);
+    TEST_ASSERT_EQ(name, local.opcode_count, 0, "cleared");
+    TEST_ASSERT_EQ(name, crumbs_controller_get_stats(NULL, &remote), -1, "NULL dev");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Statistics tests:\n");
+
+    failures += test_local_counters();
+    failures += test_transaction_latency();
+    failures += test_remote_read();
+
+    if (failures == 0)
+    {
+        printf("All statistics tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d statistics test(s) failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,220 @@
+/*
+ * Tests for the thread-safe controller mode (CRUMBS_THREAD_SAFE=1) and
+ * crumbs_locked_bus_t: several threads share one controller context and
+ * one bus, each driving its own device.
+ *
+ * The fake bus checks that no two transfers overlap and corrupts the CRC
+ * of every fifth reply per device, so the shared crc_error_count must come
+ * out exact. Built with -fsanitize=thread as thread_safe_tsan_test when the
+ * toolchain supports it.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "crumbs.h"
+#include "crumbs_locked_bus.h"
+#include "crumbs_message_helpers.h"
+#include "test_common.h"
+
+#if !CRUMBS_THREAD_SAFE
+#error "test_thread_safe must be built with CRUMBS_THREAD_SAFE=1"
+#endif
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define N_THREADS 4
+#define ROUNDS 250
+#define BASE_ADDR 0x20
+#define OP_GET 0x31
+
+/* Touched only inside transfers, i.e. under the locked bus mutex. */
+typedef struct
+{
+    int busy;
+    int overlaps;
+    uint8_t opcode[N_THREADS];
+    uint32_t replies[N_THREADS];
+    uint32_t corrupted;
+} fake_bus_t;
+
+static fake_bus_t g_fake;
+static crumbs_locked_bus_t g_bus;
+static crumbs_context_t g_ctx;
+
+static void xfer_begin(void)
+{
+    if (g_fake.busy)
+        g_fake.overlaps++;
+    g_fake.busy = 1;
+}
+
+static int fill_reply(uint8_t addr, uint8_t *buffer, size_t len)
+{
+    crumbs_message_t m;
+    unsigned dev = (unsigned)(addr - BASE_ADDR);
+
+    crumbs_msg_init(&m, 0x01, g_fake.opcode[dev]);
+    crumbs_msg_add_u8(&m, addr);
+    size_t n = crumbs_encode_message(&m, buffer, len);
+    if (++g_fake.replies[dev] % 5u == 0u)
+    {
+        buffer[n - 1u] ^= 0xFFu;
+        g_fake.corrupted++;
+    }
+    return (int)n;
+}
+
+static int fake_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    (void)user_ctx;
+    xfer_begin();
+    if (len >= 4u && data[1] == CRUMBS_CMD_SET_REPLY)
+        g_fake.opcode[addr - BASE_ADDR] = data[3];
+    g_fake.busy = 0;
+    return 0;
+}
+
+static int fake_read(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len, uint32_t timeout_us)
+{
+    (void)user_ctx;
+    (void)timeout_us;
+    xfer_begin();
+    int n = fill_reply(addr, buffer, len);
+    g_fake.busy = 0;
+    return n;
+}
+
+static int fake_write_read(void *user_ctx, uint8_t addr, const uint8_t *tx, size_t tx_len,
+                           uint8_t *rx, size_t rx_len, uint32_t timeout_us, int require_rs)
+{
+    (void)user_ctx;
+    (void)timeout_us;
+    (void)require_rs;
+    xfer_begin();
+    if (tx_len >= 4u && tx[1] == CRUMBS_CMD_SET_REPLY)
+        g_fake.opcode[addr - BASE_ADDR] = tx[3];
+    int n = fill_reply(addr, rx, rx_len);
+    g_fake.busy = 0;
+    return n;
+}
+
+typedef struct
+{
+    uint8_t addr;
+    int ok;
+    int crc_fail;
+    int wrong;
+} worker_t;
+
+static void *worker(void *arg)
+{
+    worker_t *w = (worker_t *)arg;
+    crumbs_message_t out;
+
+    for (int i = 0; i < ROUNDS; i++)
+    {
+        int rc;
+        if (i & 1)
+        {
+            /* One locked transaction. */
+            rc = crumbs_controller_query(&g_ctx, w->addr, OP_GET, &out,
+                                         crumbs_locked_bus_write_read, &g_bus);
+        }
+        else
+        {
+            /* Two locked transfers; encode and decode run unlocked. */
+            crumbs_message_t q;
+            crumbs_msg_init(&q, 0, CRUMBS_CMD_SET_REPLY);
+            crumbs_msg_add_u8(&q, OP_GET);
+            rc = crumbs_controller_send(&g_ctx, w->addr, &q, crumbs_locked_bus_write, &g_bus);
+            if (rc == 0)
+                rc = crumbs_controller_read(&g_ctx, w->addr, &out, crumbs_locked_bus_read, &g_bus);
+        }
+
+        if (rc == 0 && out.opcode == OP_GET && out.data_len == 1u && out.data[0] == w->addr)
+            w->ok++;
+        else if (rc == -2)
+            w->crc_fail++;
+        else
+            w->wrong++;
+    }
+    return NULL;
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_shared_context(void)
+{
+    const char *name = "threads share one context and bus";
+    pthread_t th[N_THREADS];
+    worker_t w[N_THREADS];
+
+    memset(&g_fake, 0, sizeof(g_fake));
+    test_init_controller(&g_ctx);
+    TEST_ASSERT_EQ(name, crumbs_locked_bus_init(&g_bus, NULL, fake_write, fake_read, fake_write_read), 0, "init");
+
+    for (int t = 0; t < N_THREADS; t++)
+    {
+        memset(&w[t], 0, sizeof(w[t]));
+        w[t].addr = (uint8_t)(BASE_ADDR + t);
+        TEST_ASSERT_EQ(name, pthread_create(&th[t], NULL, worker, &w[t]), 0, "spawn");
+    }
+    for (int t = 0; t < N_THREADS; t++)
+        pthread_join(th[t], NULL);
+
+    int ok = 0, crc_fail = 0;
+    for (int t = 0; t < N_THREADS; t++)
+    {
+        TEST_ASSERT_EQ(name, w[t].wrong, 0, "no mixed-up replies");
+        ok += w[t].ok;
+        crc_fail += w[t].crc_fail;
+    }
+    TEST_ASSERT_EQ(name, g_fake.overlaps, 0, "transfers serialized");
+    TEST_ASSERT_EQ(name, ok + crc_fail, N_THREADS * ROUNDS, "every round accounted for");
+    TEST_ASSERT_EQ(name, (uint32_t)crc_fail, g_fake.corrupted, "failures match corruptions");
+    TEST_ASSERT_EQ(name, crumbs_get_crc_error_count(&g_ctx), g_fake.corrupted, "exact shared count");
+    TEST_ASSERT_EQ(name, g_bus.transfers, (uint32_t)(N_THREADS * ROUNDS * 3 / 2), "transfer count");
+
+    crumbs_locked_bus_destroy(&g_bus);
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_missing_functions(void)
+{
+    const char *name = "missing underlying functions";
+    crumbs_locked_bus_t bus;
+    uint8_t b[4] = {0};
+
+    TEST_ASSERT_EQ(name, crumbs_locked_bus_init(&bus, NULL, NULL, NULL, NULL), 0, "init");
+    TEST_ASSERT_EQ(name, crumbs_locked_bus_write(&bus, 0x10, b, sizeof(b)), -1, "write");
+    TEST_ASSERT_EQ(name, crumbs_locked_bus_read(&bus, 0x10, b, sizeof(b), 0u), -1, "read");
+    TEST_ASSERT_EQ(name, crumbs_locked_bus_write_read(&bus, 0x10, b, 1u, b, 1u, 0u, 1), -1, "write_read");
+    TEST_ASSERT_EQ(name, crumbs_locked_bus_init(NULL, NULL, NULL, NULL, NULL), -1, "NULL bus");
+    crumbs_locked_bus_destroy(&bus);
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Thread-safe controller tests:\n");
+
+    failures += test_shared_context();
+    failures += test_missing_functions();
+
+    if (failures == 0)
+    {
+        printf("All thread-safe controller tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d thread-safe controller test(s) failed.\n", failures);
+    return 1;
+}
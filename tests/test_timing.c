@@ -0,0 +1,243 @@
+/*
+ * Tests for the hot-path timing recorder and its TIMING dump.
+ *
+ * Built with CRUMBS_ENABLE_TRACE=1. The clock ticks once per read and the
+ * handlers burn a known number of extra ticks, so every phase has an
+ * exact length. A minimal HAL reports the I2C callback entry and exit the
+ * way the Arduino HAL does; the controller reads back over a virtual bus.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_message_helpers.h"
+#include "crumbs_timing.h"
+#include "crumbs_vbus.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define DEV 0x10
+#define OP_ECHO 0x02
+#define OP_OTHER 0x03
+
+static uint32_t g_ticks;
+static uint8_t g_echo[CRUMBS_MAX_PAYLOAD];
+static uint8_t g_echo_len;
+
+static uint32_t tick_clock(void)
+{
+    return ++g_ticks;
+}
+
+/* 50 + 10 ticks per payload byte. */
+static void on_echo(crumbs_context_t *ctx, uint8_t opcode, const uint8_t *data,
+                    uint8_t data_len, void *user_data)
+{
+    (void)ctx;
+    (void)opcode;
+    (void)user_data;
+    memcpy(g_echo, data, data_len);
+    g_echo_len = data_len;
+    g_ticks += 50u + 10u * data_len;
+}
+
+static void on_other(crumbs_context_t *ctx, uint8_t opcode, const uint8_t *data,
+                     uint8_t data_len, void *user_data)
+{
+    (void)ctx;
+    (void)opcode;
+    (void)data;
+    (void)user_data;
+    g_ticks += data_len;
+}
+
+/* 20 + 5 ticks per payload byte. */
+static void reply_echo(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)ctx;
+    (void)user_data;
+    crumbs_msg_init(reply, 0x01, OP_ECHO);
+    for (uint8_t i = 0; i < g_echo_len; i++)
+    {
+        crumbs_msg_add_u8(reply, g_echo[i]);
+    }
+    g_ticks += 20u + 5u * g_echo_len;
+}
+
+/* The two callbacks of an interrupt-driven HAL. */
+static void hal_receive(crumbs_context_t *ctx, const crumbs_message_t *m)
+{
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t n = crumbs_encode_message(m, frame, sizeof(frame));
+    (void)crumbs_peripheral_handle_receive(ctx, frame, n);
+    CRUMBS_TRACE(ctx, CRUMBS_TRACE_RX_DONE, frame[1], n);
+}
+
+static void hal_request(crumbs_context_t *ctx)
+{
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t n = 0;
+    CRUMBS_TRACE(ctx, CRUMBS_TRACE_REQUEST_START, ctx->requested_opcode, 0u);
+    if (crumbs_peripheral_build_reply(ctx, frame, sizeof(frame), &n) == 0 && n > 0u)
+    {
+        CRUMBS_TRACE(ctx, CRUMBS_TRACE_TX_START, frame[1], n);
+        CRUMBS_TRACE(ctx, CRUMBS_TRACE_TX_DONE, frame[1], n);
+    }
+}
+
+static void send_echo(crumbs_context_t *ctx, uint8_t opcode, uint8_t len)
+{
+    crumbs_message_t m;
+    crumbs_msg_init(&m, 0x01, opcode);
+    for (uint8_t i = 0; i < len; i++)
+    {
+        crumbs_msg_add_u8(&m, i);
+    }
+    hal_receive(ctx, &m);
+}
+
+static void select_reply(crumbs_context_t *ctx, uint8_t opcode)
+{
+    crumbs_message_t m;
+    crumbs_msg_init(&m, 0x00, CRUMBS_CMD_SET_REPLY);
+    crumbs_msg_add_u8(&m, opcode);
+    hal_receive(ctx, &m);
+}
+
+static void setup_peripheral(crumbs_context_t *p, crumbs_timing_t *t)
+{
+    test_init_peripheral(p);
+    p->address = DEV;
+    crumbs_register_handler(p, OP_ECHO, on_echo, NULL);
+    crumbs_register_handler(p, OP_OTHER, on_other, NULL);
+    crumbs_register_reply_handler(p, OP_ECHO, reply_echo, NULL);
+    g_ticks = 0u;
+    g_echo_len = 0u;
+    crumbs_timing_attach(p, t, tick_clock, 1000000u);
+}
+
+#define ASSERT_STAT(name, s, n, lo, hi, sum)                       \
+    do                                                             \
+    {                                                              \
+        TEST_ASSERT_EQ(name, (s).count, (uint32_t)(n), "count");   \
+        TEST_ASSERT_EQ(name, (s).min, (uint32_t)(lo), "min");      \
+        TEST_ASSERT_EQ(name, (s).max, (uint32_t)(hi), "max");      \
+        TEST_ASSERT_EQ(name, (s).total, (uint32_t)(sum), "total"); \
+    } while (0)
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_phases(void)
+{
+    const char *name = "phases in clock ticks";
+    crumbs_context_t p;
+    crumbs_timing_t t;
+
+    setup_peripheral(&p, &t);
+    TEST_ASSERT_EQ(name, t.overhead, 1u, "one clock read per empty interval");
+    TEST_ASSERT(name, (crumbs_peripheral_capabilities(&p) & CRUMBS_CAP_TIMING) != 0u, "advertised");
+
+    crumbs_timing_clear(&t, OP_ECHO);
+    send_echo(&p, OP_ECHO, 4);   /* handler burns 90 */
+    send_echo(&p, OP_ECHO, 20);  /* handler burns 250 */
+    send_echo(&p, OP_OTHER, 27); /* filtered out */
+    select_reply(&p, OP_ECHO);   /* SET_REPLY: filtered out */
+    hal_request(&p);             /* reply handler burns 120 */
+
+    /* Each point reads the clock once: 1 tick between neighbouring points. */
+    ASSERT_STAT(name, t.phases[CRUMBS_TIMING_DECODE], 2, 1, 1, 2);
+    ASSERT_STAT(name, t.phases[CRUMBS_TIMING_DISPATCH], 2, 91, 251, 342);
+    ASSERT_STAT(name, t.phases[CRUMBS_TIMING_RX_ISR], 2, 94, 254, 348);
+    ASSERT_STAT(name, t.phases[CRUMBS_TIMING_REPLY], 1, 121, 121, 121);
+    ASSERT_STAT(name, t.phases[CRUMBS_TIMING_TX_ISR], 1, 123, 123, 123);
+
+    /* An end without its start is not a sample. */
+    CRUMBS_TRACE(&p, CRUMBS_TRACE_TX_DONE, OP_ECHO, 0u);
+    TEST_ASSERT_EQ(name, t.phases[CRUMBS_TIMING_TX_ISR].count, 1u, "unmatched end");
+
+    crumbs_timing_clear(&t, CRUMBS_TIMING_ANY);
+    send_echo(&p, OP_OTHER, 0);
+    TEST_ASSERT_EQ(name, t.phases[CRUMBS_TIMING_DISPATCH].count, 1u, "any opcode");
+    TEST_ASSERT_EQ(name, t.phases[CRUMBS_TIMING_REPLY].count, 0u, "cleared");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_dump(void)
+{
+    const char *name = "TIMING over the bus";
+    crumbs_vbus_t bus;
+    crumbs_context_t p;
+    crumbs_context_t ctrl;
+    crumbs_timing_t t;
+    crumbs_device_t dev;
+    crumbs_timing_report_t r;
+
+    crumbs_vbus_init(&bus, 400000u);
+    crumbs_vbus_use(&bus);
+    setup_peripheral(&p, &t);
+    crumbs_vbus_attach(&bus, &p, 0u, 0u);
+    test_init_controller(&ctrl);
+    memset(&dev, 0, sizeof(dev));
+    dev.ctx = &ctrl;
+    dev.addr = DEV;
+    dev.write_fn = crumbs_vbus_write;
+    dev.read_fn = crumbs_vbus_read;
+    dev.delay_fn = crumbs_vbus_delay_us;
+    dev.io = &bus;
+
+    TEST_ASSERT_EQ(name, crumbs_controller_reset_timing(&dev, OP_ECHO), 0, "reset");
+    TEST_ASSERT_EQ(name, t.filter, OP_ECHO, "filter set");
+    send_echo(&p, OP_ECHO, 4);
+    send_echo(&p, OP_ECHO, 20);
+
+    TEST_ASSERT_EQ(name, crumbs_controller_read_timing(&dev, CRUMBS_TIMING_DISPATCH, &r), 0, "read");
+    TEST_ASSERT_EQ(name, r.phase, CRUMBS_TIMING_DISPATCH, "phase");
+    ASSERT_STAT(name, r.stat, 2, 91, 251, 342);
+    TEST_ASSERT_EQ(name, r.overhead, 1u, "overhead");
+    TEST_ASSERT_EQ(name, r.clock_hz, 1000000u, "clock rate");
+
+    /* Reading does not add samples of its own. */
+    TEST_ASSERT_EQ(name, crumbs_controller_read_timing(&dev, CRUMBS_TIMING_DECODE, &r), 0, "read");
+    ASSERT_STAT(name, r.stat, 2, 1, 1, 2);
+    TEST_ASSERT_EQ(name, crumbs_controller_read_timing(&dev, CRUMBS_TIMING_DECODE, &r), 0, "again");
+    TEST_ASSERT_EQ(name, r.stat.count, 2u, "unchanged");
+
+    TEST_ASSERT_EQ(name, crumbs_controller_reset_timing(&dev, CRUMBS_TIMING_ANY), 0, "reset");
+    TEST_ASSERT_EQ(name, t.filter, CRUMBS_TIMING_ANY, "any");
+    TEST_ASSERT_EQ(name, t.phases[CRUMBS_TIMING_DISPATCH].count, 0u, "cleared");
+    TEST_ASSERT_EQ(name, crumbs_controller_read_timing(&dev, CRUMBS_TIMING_PHASES, &r), -1, "bad phase");
+
+    /* Without a recorder the opcode is not answered. */
+    crumbs_set_trace_hook(&p, NULL, NULL, NULL);
+    TEST_ASSERT(name, (crumbs_peripheral_capabilities(&p) & CRUMBS_CAP_TIMING) == 0u, "not advertised");
+    TEST_ASSERT(name, crumbs_controller_read_timing(&dev, CRUMBS_TIMING_DISPATCH, &r) != 0, "no recorder");
+    TEST_ASSERT_EQ(name, crumbs_timing_attach(&p, &t, NULL, 0u), -1, "clock required");
+    TEST_ASSERT(name, strcmp(crumbs_timing_phase_name(CRUMBS_TIMING_TX_ISR), "tx-isr") == 0, "name");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Timing tests:\n");
+
+    failures += test_phases();
+    failures += test_dump();
+
+    if (failures == 0)
+    {
+        printf("All timing tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d timing test(s) failed.\n", failures);
+    return 1;
+}
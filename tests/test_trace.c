@@ -0,0 +1,190 @@
+/*
+ * Tests for the trace hook points.
+ *
+ * Built with CRUMBS_ENABLE_TRACE=1. The hook records every event with the
+ * reading of a counter clock that ticks once per call, so each event gets
+ * a distinct, ordered timestamp.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_message_helpers.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define OP_SET 0x01
+#define OP_GET 0x80
+#define MAX_EVENTS 32
+
+typedef struct
+{
+    uint8_t event;
+    uint8_t opcode;
+    uint8_t len;
+    uint32_t ts;
+} rec_t;
+
+static rec_t g_rec[MAX_EVENTS];
+static int g_count;
+static uint32_t g_ticks;
+static int g_tag;
+
+static uint32_t tick_clock(void)
+{
+    return ++g_ticks;
+}
+
+static void record(uint8_t event, uint8_t opcode, uint8_t len, uint32_t ts, void *user_data)
+{
+    if (user_data == &g_tag && g_count < MAX_EVENTS)
+    {
+        g_rec[g_count].event = event;
+        g_rec[g_count].opcode = opcode;
+        g_rec[g_count].len = len;
+        g_rec[g_count].ts = ts;
+    }
+    g_count++;
+}
+
+static void on_set(crumbs_context_t *ctx, uint8_t opcode, const uint8_t *data,
+                   uint8_t data_len, void *user_data)
+{
+    (void)ctx;
+    (void)opcode;
+    (void)data;
+    (void)data_len;
+    (void)user_data;
+}
+
+static void reply_get(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)user_data;
+    crumbs_msg_init(reply, 0x01, ctx->requested_opcode);
+    crumbs_msg_add_u16(reply, 0x1234);
+}
+
+static int null_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    (void)user_ctx;
+    (void)addr;
+    (void)data;
+    (void)len;
+    return 0;
+}
+
+static void reset_log(void)
+{
+    memset(g_rec, 0, sizeof(g_rec));
+    g_count = 0;
+    g_ticks = 0u;
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_peripheral_events(void)
+{
+    const char *name = "receive, dispatch and reply events";
+    crumbs_context_t ctx;
+    crumbs_message_t m;
+    uint8_t frame[CRUMBS_MESSAGE_MAX_SIZE];
+    size_t n;
+
+    test_init_peripheral(&ctx);
+    crumbs_register_handler(&ctx, OP_SET, on_set, NULL);
+    crumbs_register_reply_handler(&ctx, OP_GET, reply_get, NULL);
+    TEST_ASSERT_EQ(name, crumbs_set_trace_hook(&ctx, record, tick_clock, &g_tag), 0, "install");
+    reset_log();
+
+    crumbs_msg_init(&m, 0x01, OP_SET);
+    crumbs_msg_add_u8(&m, 7);
+    n = crumbs_encode_message(&m, frame, sizeof(frame));
+    TEST_ASSERT_EQ(name, crumbs_peripheral_handle_receive(&ctx, frame, n), 0, "receive");
+
+    TEST_ASSERT_EQ(name, g_count, 4, "four events");
+    TEST_ASSERT_EQ(name, g_rec[0].event, CRUMBS_TRACE_RX_START, "rx start");
+    TEST_ASSERT_EQ(name, g_rec[0].len, 5, "rx bytes");
+    TEST_ASSERT_EQ(name, g_rec[1].event, CRUMBS_TRACE_DECODE_DONE, "decode done");
+    TEST_ASSERT_EQ(name, g_rec[1].len, 1, "data_len");
+    TEST_ASSERT_EQ(name, g_rec[2].event, CRUMBS_TRACE_DISPATCH_ENTER, "enter");
+    TEST_ASSERT_EQ(name, g_rec[3].event, CRUMBS_TRACE_DISPATCH_EXIT, "exit");
+    for (int i = 0; i < 4; i++)
+    {
+        TEST_ASSERT_EQ(name, g_rec[i].opcode, OP_SET, "opcode");
+        TEST_ASSERT_EQ(name, g_rec[i].ts, (uint32_t)(i + 1), "timestamps in order");
+    }
+
+    /* SET_REPLY is not dispatched; the reply build reports the frame size. */
+    crumbs_msg_init(&m, 0x00, CRUMBS_CMD_SET_REPLY);
+    crumbs_msg_add_u8(&m, OP_GET);
+    n = crumbs_encode_message(&m, frame, sizeof(frame));
+    reset_log();
+    crumbs_peripheral_handle_receive(&ctx, frame, n);
+    TEST_ASSERT_EQ(name, g_count, 2, "rx start + decode only");
+    TEST_ASSERT_EQ(name, crumbs_peripheral_build_reply(&ctx, frame, sizeof(frame), &n), 0, "reply");
+    TEST_ASSERT_EQ(name, g_rec[2].event, CRUMBS_TRACE_REPLY_BUILT, "reply built");
+    TEST_ASSERT_EQ(name, g_rec[2].opcode, OP_GET, "reply opcode");
+    TEST_ASSERT_SIZE_EQ(name, g_rec[2].len, n, "frame bytes");
+
+    /* Bad frames stop after RX_START. */
+    frame[n - 1u] ^= 0xFFu;
+    reset_log();
+    crumbs_peripheral_handle_receive(&ctx, frame, n);
+    TEST_ASSERT_EQ(name, g_count, 1, "no decode event for a bad frame");
+
+    /* Removing the hook silences every point. */
+    crumbs_set_trace_hook(&ctx, NULL, NULL, NULL);
+    reset_log();
+    crumbs_peripheral_handle_receive(&ctx, frame, n);
+    TEST_ASSERT_EQ(name, g_count, 0, "hook removed");
+    TEST_ASSERT_EQ(name, g_ticks, 0, "clock not read");
+    TEST_ASSERT_EQ(name, crumbs_set_trace_hook(NULL, record, NULL, NULL), -1, "NULL ctx");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_controller_events(void)
+{
+    const char *name = "controller transmit events";
+    crumbs_context_t ctx;
+    crumbs_message_t m;
+
+    test_init_controller(&ctx);
+    crumbs_set_trace_hook(&ctx, record, NULL, &g_tag);
+    reset_log();
+
+    crumbs_msg_init(&m, 0x01, OP_SET);
+    crumbs_msg_add_u8(&m, 1);
+    TEST_ASSERT_EQ(name, crumbs_controller_send(&ctx, 0x20, &m, null_write, NULL), 0, "send");
+    TEST_ASSERT_EQ(name, g_count, 2, "two events");
+    TEST_ASSERT_EQ(name, g_rec[0].event, CRUMBS_TRACE_TX_START, "tx start");
+    TEST_ASSERT_EQ(name, g_rec[1].event, CRUMBS_TRACE_TX_DONE, "tx done");
+    TEST_ASSERT_EQ(name, g_rec[0].len, 5, "frame bytes");
+    TEST_ASSERT_EQ(name, g_rec[0].ts, 0, "no clock");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Trace hook tests:\n");
+
+    failures += test_peripheral_events();
+    failures += test_controller_events();
+
+    if (failures == 0)
+    {
+        printf("All trace hook tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d trace hook test(s) failed.\n", failures);
+    return 1;
+}
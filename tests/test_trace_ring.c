@@ -0,0 +1,242 @@
+/*
+ * Tests for the trace ring and the TRACE extension opcode.
+ *
+ * Built with CRUMBS_ENABLE_TRACE=1 and CRUMBS_TRACE_RING_DEPTH=8 so a few
+ * frames of traffic wrap the ring. The simulated bus hands controller
+ * writes and reads straight to a peripheral context.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_message_helpers.h"
+#include "crumbs_trace.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define OP_SET 0x01
+#define PERIPH_ADDR 0x20
+
+static uint32_t g_now;
+static crumbs_context_t g_periph;
+static crumbs_trace_ring_t g_ring;
+
+static uint32_t sim_clock(void)
+{
+    return g_now;
+}
+
+static void on_set(crumbs_context_t *ctx, uint8_t opcode, const uint8_t *data,
+                   uint8_t data_len, void *user_data)
+{
+    (void)ctx;
+    (void)opcode;
+    (void)data;
+    (void)data_len;
+    (void)user_data;
+    g_now += 30u;
+}
+
+static void other_hook(uint8_t event, uint8_t opcode, uint8_t len, uint32_t timestamp, void *user_data)
+{
+    (void)event;
+    (void)opcode;
+    (void)len;
+    (void)timestamp;
+    (void)user_data;
+}
+
+static int sim_write(void *user_ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    (void)user_ctx;
+    if (addr != PERIPH_ADDR)
+        return -1;
+    g_now += 10u;
+    return crumbs_peripheral_handle_receive(&g_periph, data, len);
+}
+
+static int sim_read(void *user_ctx, uint8_t addr, uint8_t *buffer, size_t len, uint32_t timeout_us)
+{
+    size_t n = 0;
+    (void)user_ctx;
+    (void)timeout_us;
+    if (addr != PERIPH_ADDR || crumbs_peripheral_build_reply(&g_periph, buffer, len, &n) != 0)
+        return -1;
+    return (int)n;
+}
+
+static void sim_delay(uint32_t us)
+{
+    g_now += us;
+}
+
+static int send_set(crumbs_context_t *ctrl)
+{
+    crumbs_message_t m;
+    crumbs_msg_init(&m, 0x01, OP_SET);
+    crumbs_msg_add_u8(&m, 7);
+    return crumbs_controller_send(ctrl, PERIPH_ADDR, &m, sim_write, NULL);
+}
+
+static void setup(crumbs_context_t *ctrl, crumbs_device_t *dev)
+{
+    g_now = 5000u;
+    test_init_controller(ctrl);
+    crumbs_init(&g_periph, CRUMBS_ROLE_PERIPHERAL, PERIPH_ADDR);
+    crumbs_register_handler(&g_periph, OP_SET, on_set, NULL);
+    crumbs_trace_ring_attach(&g_periph, &g_ring, sim_clock);
+    memset(dev, 0, sizeof(*dev));
+    dev->ctx = ctrl;
+    dev->addr = PERIPH_ADDR;
+    dev->write_fn = sim_write;
+    dev->read_fn = sim_read;
+    dev->delay_fn = sim_delay;
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_record_and_wrap(void)
+{
+    const char *name = "packed events keep the newest DEPTH";
+    crumbs_context_t ctrl;
+    crumbs_device_t dev;
+    crumbs_trace_event_t ev[16];
+
+    setup(&ctrl, &dev);
+    TEST_ASSERT_EQ(name, crumbs_trace_ring_snapshot(&g_ring, ev, 16), 0, "empty");
+
+    for (uint8_t i = 0; i < 11; i++)
+    {
+        g_now += 3u * i;
+        crumbs_trace_ring_record(CRUMBS_TRACE_TX_START, (uint8_t)(0x40 + i), i, g_now, &g_ring);
+    }
+
+    int n = crumbs_trace_ring_snapshot(&g_ring, ev, 16);
+    TEST_ASSERT_EQ(name, n, CRUMBS_TRACE_RING_DEPTH, "ring full");
+    for (int i = 0; i < n; i++)
+    {
+        uint8_t k = (uint8_t)(i + 3);
+        TEST_ASSERT_EQ(name, ev[i].index, k, "oldest first");
+        TEST_ASSERT_EQ(name, ev[i].opcode, 0x40 + k, "opcode");
+        TEST_ASSERT_EQ(name, ev[i].len, k, "len");
+        TEST_ASSERT_EQ(name, ev[i].delta, 3u * k, "delta to previous event");
+    }
+    TEST_ASSERT(name, (uint8_t)(g_ring.events[10 % CRUMBS_TRACE_RING_DEPTH] >> 56) == 10u, "seq byte");
+    TEST_ASSERT_EQ(name, crumbs_trace_ring_snapshot(&g_ring, ev, 2), 2, "bounded copy");
+
+    /* The wire form is the stored word, little-endian. */
+    uint8_t raw[8] = {0x10, 0x00, 0x00, 0x00, CRUMBS_TRACE_REPLY_BUILT, 0x80, 5, 0x2A};
+    crumbs_trace_event_t one;
+    crumbs_trace_unpack(raw, 0x122Au, &one);
+    TEST_ASSERT_EQ(name, one.delta, 0x10u, "unpack delta");
+    TEST_ASSERT_EQ(name, one.event, CRUMBS_TRACE_REPLY_BUILT, "unpack event");
+    TEST_ASSERT_EQ(name, one.opcode, 0x80, "unpack opcode");
+    TEST_ASSERT_EQ(name, one.len, 5, "unpack len");
+    TEST_ASSERT_EQ(name, one.index, 0x122Au, "unpack index");
+    TEST_ASSERT(name, strcmp(crumbs_trace_event_name(CRUMBS_TRACE_REPLY_BUILT), "reply") == 0, "name");
+    TEST_ASSERT(name, strcmp(crumbs_trace_event_name(0xEE), "?") == 0, "unknown name");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_dump_over_bus(void)
+{
+    const char *name = "TRACE dump pauses, pages and resumes";
+    crumbs_context_t ctrl;
+    crumbs_device_t dev;
+    crumbs_capabilities_t caps;
+    crumbs_trace_event_t ev[16];
+
+    setup(&ctrl, &dev);
+    TEST_ASSERT_EQ(name, crumbs_controller_get_capabilities(&dev, &caps), 0, "capabilities");
+    TEST_ASSERT(name, (caps.flags & CRUMBS_CAP_TRACE) != 0u, "advertised");
+
+    for (int i = 0; i < 3; i++)
+        TEST_ASSERT_EQ(name, send_set(&ctrl), 0, "send");
+
+    int n = crumbs_controller_read_trace(&dev, ev, 16);
+    TEST_ASSERT_EQ(name, n, CRUMBS_TRACE_RING_DEPTH, "whole ring read");
+    for (int i = 1; i < n; i++)
+        TEST_ASSERT_EQ(name, ev[i].index, (uint16_t)(ev[0].index + i), "consecutive");
+    TEST_ASSERT_EQ(name, g_ring.paused, 0, "recording resumed");
+
+    /* The last event before the pause is the dump command being decoded. */
+    TEST_ASSERT_EQ(name, ev[n - 1].event, CRUMBS_TRACE_DECODE_DONE, "dump command");
+    TEST_ASSERT_EQ(name, ev[n - 1].opcode, CRUMBS_CMD_TRACE, "dump opcode");
+    int found = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (ev[i].event == CRUMBS_TRACE_DISPATCH_EXIT && ev[i].opcode == OP_SET)
+        {
+            TEST_ASSERT_EQ(name, ev[i].delta, 30u, "handler time");
+            found = 1;
+        }
+    }
+    TEST_ASSERT(name, found, "handler exit recorded");
+
+    /* A short read still resumes recording. */
+    TEST_ASSERT_EQ(name, crumbs_controller_read_trace(&dev, ev, 2), 2, "bounded read");
+    TEST_ASSERT_EQ(name, g_ring.paused, 0, "resumed after short read");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_clear_and_absent(void)
+{
+    const char *name = "CLEAR and peripherals without a ring";
+    crumbs_context_t ctrl;
+    crumbs_device_t dev;
+    crumbs_capabilities_t caps;
+    crumbs_trace_event_t ev[16];
+    crumbs_message_t m;
+
+    setup(&ctrl, &dev);
+    send_set(&ctrl);
+    crumbs_msg_init(&m, 0x00, CRUMBS_CMD_TRACE);
+    crumbs_msg_add_u8(&m, CRUMBS_TRACE_CMD_CLEAR);
+    TEST_ASSERT_EQ(name, crumbs_controller_send(&ctrl, PERIPH_ADDR, &m, sim_write, NULL), 0, "clear");
+    TEST_ASSERT_EQ(name, g_ring.count, 0, "cleared");
+
+    /* Only the dump command itself is in the ring now. */
+    int n = crumbs_controller_read_trace(&dev, ev, 16);
+    TEST_ASSERT_EQ(name, n, 2, "rx + decode");
+    TEST_ASSERT_EQ(name, ev[0].event, CRUMBS_TRACE_RX_START, "rx first");
+
+    /* Another trace hook: TRACE is not answered. */
+    crumbs_set_trace_hook(&g_periph, other_hook, sim_clock, NULL);
+    TEST_ASSERT_EQ(name, crumbs_controller_get_capabilities(&dev, &caps), 0, "capabilities");
+    TEST_ASSERT_EQ(name, caps.flags & CRUMBS_CAP_TRACE, 0, "not advertised");
+    TEST_ASSERT(name, crumbs_controller_read_trace(&dev, ev, 16) < 0, "no trace reply");
+
+    TEST_ASSERT_EQ(name, crumbs_trace_ring_attach(NULL, &g_ring, NULL), -1, "NULL ctx");
+    TEST_ASSERT_EQ(name, crumbs_trace_ring_attach(&g_periph, NULL, NULL), -1, "NULL ring");
+    TEST_ASSERT_EQ(name, crumbs_controller_read_trace(NULL, ev, 16), -1, "NULL dev");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Trace ring tests:\n");
+
+    failures += test_record_and_wrap();
+    failures += test_dump_over_bus();
+    failures += test_clear_and_absent();
+
+    if (failures == 0)
+    {
+        printf("All trace ring tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d trace ring test(s) failed.\n", failures);
+    return 1;
+}
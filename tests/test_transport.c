@@ -0,0 +1,228 @@
+/*
+ * Tests for the transport vtable: device handles filled from a context's
+ * transport, frame limits of a narrow link, and crumbs_device_query()
+ * taking the combined transfer when the link offers one and SET_REPLY +
+ * read when it does not. Everything runs on the virtual bus.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_transport.h"
+#include "crumbs_vbus.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define OP_LEVEL 0x31
+
+static int g_sends;
+static int g_receives;
+static int g_transacts;
+static int g_level_calls;
+static crumbs_message_t g_last;
+
+static int count_send(void *io, uint8_t addr, const uint8_t *data, size_t len)
+{
+    g_sends++;
+    return crumbs_vbus_write(io, addr, data, len);
+}
+
+static int count_receive(void *io, uint8_t addr, uint8_t *buf, size_t len, uint32_t timeout_us)
+{
+    g_receives++;
+    return crumbs_vbus_read(io, addr, buf, len, timeout_us);
+}
+
+static int count_transact(void *io, uint8_t addr, const uint8_t *tx, size_t tx_len,
+                          uint8_t *rx, size_t rx_len, uint32_t timeout_us, int require_repeated_start)
+{
+    g_transacts++;
+    return crumbs_vbus_write_read(io, addr, tx, tx_len, rx, rx_len, timeout_us,
+                                  require_repeated_start);
+}
+
+/* Same primitives, with and without the combined transfer, and a link
+ * that only carries 12-byte frames (8-byte payloads). */
+static const crumbs_transport_t g_fast = {
+    "count", count_send, count_receive, count_transact,
+    CRUMBS_TRANSPORT_CAP_ADDRESSED | CRUMBS_TRANSPORT_CAP_TRANSACT, 0u};
+static const crumbs_transport_t g_plain = {
+    "count", count_send, count_receive, count_transact,
+    CRUMBS_TRANSPORT_CAP_ADDRESSED, 0u};
+static const crumbs_transport_t g_narrow = {
+    "narrow", count_send, count_receive, NULL,
+    CRUMBS_TRANSPORT_CAP_ADDRESSED, 12u};
+
+static void on_message(crumbs_context_t *ctx, const crumbs_message_t *m)
+{
+    (void)ctx;
+    g_last = *m;
+}
+
+static void reply_level(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)ctx;
+    (void)user_data;
+    g_level_calls++;
+    reply->type_id = 0x05;
+    reply->opcode = OP_LEVEL;
+    reply->data_len = 2u;
+    reply->data[0] = 0x34u;
+    reply->data[1] = 0x12u;
+}
+
+static void setup(crumbs_vbus_t *bus, crumbs_context_t *p, crumbs_context_t *ctrl)
+{
+    g_sends = g_receives = g_transacts = g_level_calls = 0;
+    memset(&g_last, 0, sizeof(g_last));
+    crumbs_vbus_init(bus, 100000u);
+    crumbs_vbus_use(bus);
+    test_init_peripheral(p);
+    crumbs_set_callbacks(p, on_message, NULL, NULL);
+    crumbs_register_reply_handler(p, OP_LEVEL, reply_level, NULL);
+    crumbs_vbus_attach(bus, p, 0u, 0u);
+    test_init_controller(ctrl);
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_device_init(void)
+{
+    const char *name = "devices filled from the context transport";
+    crumbs_vbus_t bus;
+    crumbs_context_t p, ctrl;
+    crumbs_device_t dev;
+    crumbs_transport_t no_send = g_plain;
+    no_send.send = NULL;
+
+    setup(&bus, &p, &ctrl);
+    TEST_ASSERT(name, ctrl.transport == NULL, "none after init");
+    TEST_ASSERT_EQ(name, crumbs_device_init(&dev, &ctrl, 0x10, crumbs_vbus_delay_us), -1, "no transport");
+    TEST_ASSERT_EQ(name, crumbs_set_transport(&ctrl, &no_send, &bus), -1, "send required");
+
+    TEST_ASSERT_EQ(name, crumbs_set_transport(&ctrl, &crumbs_vbus_transport, &bus), 0, "set");
+    TEST_ASSERT_EQ(name, crumbs_device_init(&dev, &ctrl, 0x10, crumbs_vbus_delay_us), 0, "init");
+    TEST_ASSERT(name, dev.ctx == &ctrl && dev.addr == 0x10, "ctx and addr");
+    TEST_ASSERT(name, dev.write_fn == crumbs_vbus_write, "write_fn");
+    TEST_ASSERT(name, dev.read_fn == crumbs_vbus_read, "read_fn");
+    TEST_ASSERT(name, dev.io == &bus && dev.latency == NULL, "io");
+    TEST_ASSERT(name, dev.transport == &crumbs_vbus_transport, "transport");
+
+    /* A handle from crumbs_vbus_bind() is the same. */
+    crumbs_device_t bound;
+    crumbs_vbus_bind(&bus, &bound, &ctrl, 0x10);
+    TEST_ASSERT(name, memcmp(&bound, &dev, sizeof(dev)) == 0, "bind matches");
+
+    TEST_ASSERT_EQ(name, crumbs_transport_max_payload(NULL), CRUMBS_MAX_PAYLOAD, "null");
+    TEST_ASSERT_EQ(name, crumbs_transport_max_payload(&g_plain), CRUMBS_MAX_PAYLOAD, "default");
+    TEST_ASSERT_EQ(name, crumbs_transport_max_payload(&g_narrow), 8, "narrow");
+
+    TEST_ASSERT_EQ(name, crumbs_set_transport(&ctrl, NULL, &bus), 0, "clear");
+    TEST_ASSERT(name, ctrl.transport == NULL && ctrl.transport_io == NULL, "cleared");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_send_read(void)
+{
+    const char *name = "send and read through the vtable";
+    crumbs_vbus_t bus;
+    crumbs_context_t p, ctrl;
+    crumbs_message_t m, r;
+    uint8_t payload[10] = {1u, 2u, 3u, 4u, 5u, 6u, 7u, 8u, 9u, 10u};
+    uint8_t op = OP_LEVEL;
+
+    setup(&bus, &p, &ctrl);
+    test_msg_create(&m, 0x05, 0x01, payload, 8);
+    TEST_ASSERT_EQ(name, crumbs_transport_send(&ctrl, 0x10, &m), -1, "no transport");
+
+    crumbs_set_transport(&ctrl, &g_narrow, &bus);
+    TEST_ASSERT_EQ(name, crumbs_transport_send(&ctrl, 0x10, &m), 0, "fits");
+    TEST_ASSERT_EQ(name, g_sends, 1, "sent once");
+    TEST_ASSERT_EQ(name, g_last.data_len, 8, "received");
+    TEST_ASSERT_EQ(name, g_last.data[7], 8, "payload");
+
+    /* Nine bytes do not fit a 12-byte frame and never reach the link. */
+    test_msg_create(&m, 0x05, 0x01, payload, 9);
+    TEST_ASSERT_EQ(name, crumbs_transport_send(&ctrl, 0x10, &m), -1, "too long");
+    TEST_ASSERT_EQ(name, g_sends, 1, "not sent");
+
+    test_msg_create(&m, 0x00, CRUMBS_CMD_SET_REPLY, &op, 1);
+    TEST_ASSERT_EQ(name, crumbs_transport_send(&ctrl, 0x10, &m), 0, "set reply");
+    TEST_ASSERT_EQ(name, crumbs_transport_read(&ctrl, 0x10, &r), 0, "read");
+    TEST_ASSERT_EQ(name, g_receives, 1, "received once");
+    TEST_ASSERT_EQ(name, r.opcode, OP_LEVEL, "opcode");
+    TEST_ASSERT_EQ(name, r.data[1], 0x12, "data");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_query_routes(void)
+{
+    const char *name = "query picks the transfer the link offers";
+    crumbs_vbus_t bus;
+    crumbs_context_t p, ctrl;
+    crumbs_device_t dev;
+    crumbs_message_t r;
+
+    setup(&bus, &p, &ctrl);
+    crumbs_set_transport(&ctrl, &g_fast, &bus);
+    crumbs_device_init(&dev, &ctrl, 0x10, crumbs_vbus_delay_us);
+    TEST_ASSERT_EQ(name, crumbs_device_query(&dev, OP_LEVEL, &r, 2u), 0, "combined");
+    TEST_ASSERT_EQ(name, g_transacts, 1, "one transaction");
+    TEST_ASSERT_EQ(name, g_sends + g_receives, 0, "no separate transfers");
+    TEST_ASSERT_EQ(name, r.data[0], 0x34, "value");
+
+    /* Same link without the capability: SET_REPLY, delay, short read. */
+    crumbs_device_set_transport(&dev, &g_plain, &bus);
+    TEST_ASSERT_EQ(name, crumbs_device_query(&dev, OP_LEVEL, &r, 2u), 0, "split");
+    TEST_ASSERT_EQ(name, g_transacts, 1, "transact unused");
+    TEST_ASSERT_EQ(name, g_sends, 1, "set reply");
+    TEST_ASSERT_EQ(name, g_receives, 1, "read");
+    TEST_ASSERT_EQ(name, r.data[1], 0x12, "value");
+    TEST_ASSERT_EQ(name, g_level_calls, 2, "handler per query");
+
+    /* Nobody answers 0x40: the default reply carries another opcode. */
+    TEST_ASSERT(name, crumbs_device_query(&dev, 0x40, &r, CRUMBS_MAX_PAYLOAD) != 0, "split mismatch");
+    crumbs_device_set_transport(&dev, &g_fast, &bus);
+    TEST_ASSERT(name, crumbs_device_query(&dev, 0x40, &r, CRUMBS_MAX_PAYLOAD) != 0, "combined mismatch");
+
+    /* Handles set up by hand, without a transport, still query in two transfers. */
+    crumbs_device_t legacy = {
+        .ctx = &ctrl,
+        .addr = 0x10,
+        .write_fn = crumbs_vbus_write,
+        .read_fn = crumbs_vbus_read,
+        .delay_fn = crumbs_vbus_delay_us,
+        .io = &bus};
+    TEST_ASSERT_EQ(name, crumbs_device_query(&legacy, OP_LEVEL, &r, 2u), 0, "no transport");
+    TEST_ASSERT_EQ(name, crumbs_device_query(NULL, OP_LEVEL, &r, 2u), -1, "null");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Transport tests:\n");
+
+    failures += test_device_init();
+    failures += test_send_read();
+    failures += test_query_routes();
+
+    if (failures == 0)
+    {
+        printf("All transport tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d transport test(s) failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,231 @@
+/*
+ * Tests for the virtual I2C bus: byte timing at 100 and 400 kHz, clock
+ * stretching from handler latency, GETs and fast scans across a
+ * 100-device bus, and injected NACKs and bit errors.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "crumbs.h"
+#include "crumbs_message_helpers.h"
+#include "crumbs_vbus.h"
+#include "test_common.h"
+
+/* ---- Test infrastructure ---------------------------------------------- */
+
+#define OP_SET 0x01
+#define FLEET 100
+
+static crumbs_vbus_t g_bus;
+static crumbs_context_t g_periph[FLEET];
+static int g_calls;
+
+static void on_set(crumbs_context_t *ctx, uint8_t opcode, const uint8_t *data,
+                   uint8_t data_len, void *user_data)
+{
+    (void)ctx;
+    (void)opcode;
+    (void)data;
+    (void)data_len;
+    (void)user_data;
+    g_calls++;
+}
+
+static void reply_version(crumbs_context_t *ctx, crumbs_message_t *reply, void *user_data)
+{
+    (void)ctx;
+    (void)user_data;
+    crumbs_msg_init(reply, 0x07, 0x00);
+    crumbs_msg_add_u8(reply, 1);
+}
+
+static void setup(uint32_t hz, int devices, uint32_t handler_us, uint32_t reply_us)
+{
+    crumbs_vbus_init(&g_bus, hz);
+    crumbs_vbus_use(&g_bus);
+    g_calls = 0;
+    for (int i = 0; i < devices; i++)
+    {
+        crumbs_init(&g_periph[i], CRUMBS_ROLE_PERIPHERAL, (uint8_t)(0x10 + i));
+        crumbs_register_handler(&g_periph[i], OP_SET, on_set, NULL);
+        crumbs_register_reply_handler(&g_periph[i], 0x00, reply_version, NULL);
+        crumbs_vbus_attach(&g_bus, &g_periph[i], handler_us, reply_us);
+    }
+}
+
+/* A 5-byte frame: [type][opcode][len=1][value][crc]. */
+static int send_set(crumbs_context_t *ctrl, uint8_t addr)
+{
+    crumbs_message_t m;
+    crumbs_msg_init(&m, 0x01, OP_SET);
+    crumbs_msg_add_u8(&m, 1);
+    return crumbs_controller_send(ctrl, addr, &m, crumbs_vbus_write, &g_bus);
+}
+
+/* ---- Tests ------------------------------------------------------------ */
+
+static int test_byte_timing(void)
+{
+    const char *name = "transfers cost their wire time";
+    crumbs_context_t ctrl;
+
+    test_init_controller(&ctrl);
+
+    /* START + 6 bytes x 9 clocks + STOP = 56 clocks. */
+    setup(100000u, 1, 0u, 0u);
+    TEST_ASSERT_EQ(name, send_set(&ctrl, 0x10), 0, "write");
+    TEST_ASSERT_EQ(name, crumbs_vbus_now_us(&g_bus), 560, "100 kHz");
+    TEST_ASSERT_EQ(name, g_calls, 1, "delivered");
+
+    /* An empty address costs START + address + STOP. */
+    TEST_ASSERT(name, send_set(&ctrl, 0x50) != 0, "NACK");
+    TEST_ASSERT_EQ(name, crumbs_vbus_now_us(&g_bus), 670, "address only");
+    TEST_ASSERT_EQ(name, g_bus.nacks, 1, "nack counted");
+
+    setup(400000u, 1, 0u, 0u);
+    TEST_ASSERT_EQ(name, send_set(&ctrl, 0x10), 0, "write");
+    TEST_ASSERT_EQ(name, crumbs_vbus_now_us(&g_bus), 140, "400 kHz");
+    TEST_ASSERT_EQ(name, crumbs_vbus_utilization_pct(&g_bus), 100, "all bus time");
+    crumbs_vbus_advance_us(&g_bus, 140u);
+    TEST_ASSERT_EQ(name, crumbs_vbus_utilization_pct(&g_bus), 50, "idle time");
+
+    TEST_ASSERT_NULL(name, crumbs_vbus_attach(&g_bus, &g_periph[0], 0u, 0u), "duplicate address");
+    TEST_ASSERT_NULL(name, crumbs_vbus_attach(&g_bus, &ctrl, 0u, 0u), "controller context");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_handler_latency(void)
+{
+    const char *name = "busy devices stretch the next transfer";
+    crumbs_context_t ctrl;
+    crumbs_device_t dev;
+    crumbs_capabilities_t caps;
+
+    test_init_controller(&ctrl);
+    setup(100000u, 2, 500u, 200u);
+
+    TEST_ASSERT_EQ(name, send_set(&ctrl, 0x10), 0, "first");
+    uint32_t t = crumbs_vbus_now_us(&g_bus);
+
+    /* Another device is not held up. */
+    TEST_ASSERT_EQ(name, send_set(&ctrl, 0x11), 0, "other device");
+    TEST_ASSERT_EQ(name, crumbs_vbus_now_us(&g_bus) - t, 560, "no stretch");
+
+    /* That write outlasted 0x10's busy time; now write 0x10 twice back to back. */
+    TEST_ASSERT_EQ(name, send_set(&ctrl, 0x10), 0, "again");
+    t = crumbs_vbus_now_us(&g_bus);
+    TEST_ASSERT_EQ(name, send_set(&ctrl, 0x10), 0, "back to back");
+    /* Held after the address byte until 500 us past the previous STOP. */
+    TEST_ASSERT_EQ(name, crumbs_vbus_now_us(&g_bus) - t, 560 + 400, "stretched");
+    TEST_ASSERT_EQ(name, crumbs_vbus_device(&g_bus, 0x10)->stretch_us, 400, "stretch counted");
+
+    /* A GET pays the query delay, then reply_us inside the read. */
+    crumbs_vbus_bind(&g_bus, &dev, &ctrl, 0x11);
+    t = crumbs_vbus_now_us(&g_bus);
+    TEST_ASSERT_EQ(name, crumbs_controller_get_capabilities(&dev, &caps), 0, "GET");
+    uint32_t spent = crumbs_vbus_now_us(&g_bus) - t;
+    TEST_ASSERT(name, spent >= CRUMBS_EXT_QUERY_DELAY_US + 200u, "delay and reply time");
+    TEST_ASSERT(name, spent < CRUMBS_DEFAULT_QUERY_DELAY_US, "core reply needs no handler delay");
+    TEST_ASSERT_EQ(name, crumbs_vbus_device(&g_bus, 0x11)->reads, 1, "one read");
+    TEST_ASSERT_EQ(name, crumbs_vbus_clock_us(), crumbs_vbus_now_us(&g_bus), "selected clock");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_fleet_scan(void)
+{
+    const char *name = "fast scan across a 100-device bus";
+    crumbs_context_t ctrl;
+    uint8_t found[128];
+    uint8_t types[128];
+
+    test_init_controller(&ctrl);
+    setup(400000u, FLEET, 50u, 20u);
+    TEST_ASSERT_EQ(name, g_bus.count, FLEET, "attached");
+
+    int n = crumbs_controller_scan_for_crumbs_fast(&ctrl, 0x08, 0x77, 0, crumbs_vbus_scan,
+                                                   crumbs_vbus_write, crumbs_vbus_read,
+                                                   crumbs_vbus_write_read, &g_bus,
+                                                   found, types, sizeof(found), 1000u);
+    TEST_ASSERT_EQ(name, n, FLEET, "all found");
+    for (int i = 0; i < n; i++)
+    {
+        TEST_ASSERT_EQ(name, found[i], 0x10 + i, "in address order");
+        TEST_ASSERT_EQ(name, types[i], 0x07, "type from the version reply");
+    }
+
+    /* Every device saw exactly one combined probe. */
+    for (int i = 0; i < FLEET; i++)
+        TEST_ASSERT_EQ(name, g_bus.devices[i].reads, 1, "one probe each");
+    TEST_ASSERT(name, crumbs_vbus_now_us(&g_bus) < 200000u, "well under a second of bus time");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+static int test_error_injection(void)
+{
+    const char *name = "injected NACKs and bit errors";
+    crumbs_context_t ctrl;
+
+    test_init_controller(&ctrl);
+    setup(100000u, 1, 0u, 0u);
+
+    crumbs_vbus_set_errors(&g_bus, 0u, 65535u, 1234u);
+    for (int i = 0; i < 20; i++)
+        TEST_ASSERT_EQ(name, send_set(&ctrl, 0x10), 0, "write still ACKed");
+    TEST_ASSERT(name, g_bus.corrupted >= 19u, "corrupted");
+    TEST_ASSERT(name, g_calls <= 1, "single-bit errors never dispatched");
+    TEST_ASSERT(name, crumbs_get_crc_error_count(&g_periph[0]) > 0u, "CRC errors seen");
+
+    crumbs_vbus_set_errors(&g_bus, 65535u, 0u, 99u);
+    int fails = 0;
+    for (int i = 0; i < 20; i++)
+        fails += (send_set(&ctrl, 0x10) != 0);
+    TEST_ASSERT(name, fails >= 19, "NACKed");
+
+    /* Same seed, same outcome. */
+    uint32_t first = g_bus.nacks;
+    crumbs_vbus_set_errors(&g_bus, 32768u, 0u, 7u);
+    for (int i = 0; i < 50; i++)
+        send_set(&ctrl, 0x10);
+    uint32_t run1 = g_bus.nacks - first;
+    crumbs_vbus_set_errors(&g_bus, 32768u, 0u, 7u);
+    for (int i = 0; i < 50; i++)
+        send_set(&ctrl, 0x10);
+    TEST_ASSERT_EQ(name, g_bus.nacks - first - run1, run1, "reproducible");
+    TEST_ASSERT(name, run1 > 10u && run1 < 40u, "about half");
+
+    crumbs_vbus_set_errors(&g_bus, 0u, 0u, 0u);
+    crumbs_vbus_device(&g_bus, 0x10)->online = 0u;
+    TEST_ASSERT(name, send_set(&ctrl, 0x10) != 0, "offline");
+
+    printf("  %s: PASS\n", name);
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("Virtual bus tests:\n");
+
+    failures += test_byte_timing();
+    failures += test_handler_latency();
+    failures += test_fleet_scan();
+    failures += test_error_injection();
+
+    if (failures == 0)
+    {
+        printf("All virtual bus tests passed.\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d virtual bus test(s) failed.\n", failures);
+    return 1;
+}